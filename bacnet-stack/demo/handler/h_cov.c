@@ -69,6 +69,8 @@ typedef struct BACnet_COV_Subscription {
     uint32_t subscriberProcessIdentifier;
     uint32_t lifetime;  /* optional */
     BACNET_OBJECT_ID monitoredObjectIdentifier;
+    /* Present_Value and Status_Flags notifications, encoded once */
+    BACNET_COV_NOTIFY_TEMPLATE notify_template;
 } BACNET_COV_SUBSCRIPTION;
 
 #ifndef MAX_COV_SUBCRIPTIONS
@@ -443,6 +445,35 @@ static bool cov_list_subscribe(
     return found;
 }
 
+/**
+ * Tells whether a list of values is the Present_Value and Status_Flags
+ * of an object, which is what cov_notify_template_encode() sends.
+ *
+ * @param  value_list - the values for a COV notification
+ *
+ * @return true if the values fit the notification template
+ */
+static bool cov_value_list_fixed_shape(
+    BACNET_PROPERTY_VALUE * value_list)
+{
+    BACNET_PROPERTY_VALUE *status_flags = NULL;
+
+    if (!value_list || !value_list->next) {
+        return false;
+    }
+    status_flags = value_list->next;
+
+    return (value_list->propertyIdentifier == PROP_PRESENT_VALUE) &&
+        (value_list->propertyArrayIndex == BACNET_ARRAY_ALL) &&
+        (value_list->priority == BACNET_NO_PRIORITY) &&
+        (value_list->value.next == NULL) &&
+        (status_flags->propertyIdentifier == PROP_STATUS_FLAGS) &&
+        (status_flags->propertyArrayIndex == BACNET_ARRAY_ALL) &&
+        (status_flags->priority == BACNET_NO_PRIORITY) &&
+        (status_flags->value.tag == BACNET_APPLICATION_TAG_BIT_STRING) &&
+        (status_flags->value.next == NULL) && (status_flags->next == NULL);
+}
+
 static bool cov_send_request(
     BACNET_COV_SUBSCRIPTION * cov_subscription,
     BACNET_PROPERTY_VALUE * value_list)
@@ -456,6 +487,7 @@ static bool cov_send_request(
     bool status = false;        /* return value */
     BACNET_COV_DATA cov_data;
     BACNET_ADDRESS *dest = NULL;
+    bool confirmed = false;
 
     if (!dcc_communication_enabled()) {
         return status;
@@ -488,24 +520,38 @@ static bool cov_send_request(
         cov_subscription->monitoredObjectIdentifier.instance;
     cov_data.timeRemaining = cov_subscription->lifetime;
     cov_data.listOfValues = value_list;
-    if (cov_subscription->flag.issueConfirmedNotifications) {
+    confirmed = cov_subscription->flag.issueConfirmedNotifications;
+    if (confirmed) {
         npdu_data.data_expecting_reply = true;
         invoke_id = tsm_next_free_invokeID();
         if (invoke_id) {
             cov_subscription->invokeID = invoke_id;
-            len =
-                ccov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-                invoke_id, &cov_data);
         } else {
             goto COV_FAILED;
         }
+    }
+    if (cov_value_list_fixed_shape(value_list)) {
+        if (!cov_notify_template_valid(&cov_subscription->notify_template,
+                confirmed, &cov_data)) {
+            cov_notify_template_init(&cov_subscription->notify_template,
+                confirmed, &cov_data);
+        }
+        len =
+            cov_notify_template_encode(&Handler_Transmit_Buffer[pdu_len],
+            &cov_subscription->notify_template, invoke_id,
+            cov_data.timeRemaining, &value_list->value,
+            &value_list->next->value);
+    } else if (confirmed) {
+        len =
+            ccov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            invoke_id, &cov_data);
     } else {
         len =
             ucov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
             &cov_data);
     }
     pdu_len += len;
-    if (cov_subscription->flag.issueConfirmedNotifications) {
+    if (confirmed) {
         tsm_set_confirmed_unsegmented_transaction(invoke_id, dest, &npdu_data,
             &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
     }
@@ -35,6 +35,7 @@
 #include "apdu.h"
 #include "npdu.h"
 #include "abort.h"
+#include "evindex.h"
 #include "handlers.h"
 
 /** @file h_alarm_sum.c  Handles Get Alarm Summary request. */
@@ -63,10 +64,13 @@ void handler_get_alarm_summary(
     int alarm_value = 0;
     unsigned i = 0;
     unsigned j = 0;
+    unsigned position = 0;
+    BACNET_OBJECT_TYPE object_type = OBJECT_ANALOG_INPUT;
     bool error = false;
     BACNET_ADDRESS my_address;
     BACNET_NPDU_DATA npdu_data;
     BACNET_GET_ALARM_SUMMARY_DATA getalarm_data;
+    bool index_complete = false;
 
 
 
@@ -94,9 +98,35 @@ void handler_get_alarm_summary(
         get_alarm_summary_ack_encode_apdu_init(&Handler_Transmit_Buffer
         [pdu_len], service_data->invoke_id);
 
-
+    index_complete = evindex_complete();
+    if (index_complete) {
+        /* objects in alarm have active events */
+        for (position = 0; position < evindex_count(); position++) {
+            (void) evindex_entry(position, &object_type, NULL, &j);
+            if ((object_type >= MAX_BACNET_OBJECT_TYPE) ||
+                (!Get_Alarm_Summary[object_type]) ||
+                (!evindex_maintained(object_type))) {
+                continue;
+            }
+            alarm_value = Get_Alarm_Summary[object_type] (j, &getalarm_data);
+            if (alarm_value > 0) {
+                len =
+                    get_alarm_summary_ack_encode_apdu_data
+                    (&Handler_Transmit_Buffer[pdu_len + apdu_len],
+                    service_data->max_resp - apdu_len, &getalarm_data);
+                if (len <= 0) {
+                    error = true;
+                    goto GET_ALARM_SUMMARY_ERROR;
+                } else
+                    apdu_len += len;
+            }
+        }
+    }
+    /* every object of the other types is asked for its alarms, and
+       of all types once the index is incomplete */
     for (i = 0; i < MAX_BACNET_OBJECT_TYPE; i++) {
-        if (Get_Alarm_Summary[i]) {
+        if (Get_Alarm_Summary[i] && !(index_complete &&
+                evindex_maintained((BACNET_OBJECT_TYPE) i))) {
             for (j = 0; j < 0xffff; j++) {
                 alarm_value = Get_Alarm_Summary[i] (j, &getalarm_data);
                 if (alarm_value > 0) {
@@ -37,6 +37,7 @@
 #include "abort.h"
 #include "event.h"
 #include "getevent.h"
+#include "evindex.h"
 #include "handlers.h"
 
 /** @file h_getevent.c  Handles Get Event Information request. */
@@ -77,6 +78,39 @@ void handler_get_event_information_set(
     }
 }
 
+/* Encode one event summary after the others.
+   Returns the number of octets added, zero if the summary has to wait
+   for the next request, or the negative status of the error. */
+static int get_event_encode_summary(
+    uint8_t * apdu,
+    int apdu_size,
+    int *apdu_len,
+    BACNET_CONFIRMED_SERVICE_DATA * service_data,
+    BACNET_GET_EVENT_INFORMATION_DATA * getevent_data)
+{
+    int len = 0;
+
+    getevent_data->next = NULL;
+    len = getevent_ack_encode_apdu_data(apdu, apdu_size, getevent_data);
+    if (len <= 0) {
+        return BACNET_STATUS_ERROR;
+    }
+    *apdu_len += len;
+    if ((*apdu_len >= service_data->max_resp - 2) ||
+        (*apdu_len >= MAX_APDU - 2)) {
+        /* Device must be able to fit minimum
+           one event information.
+           Length of one event informations needs
+           more than 50 octets. */
+        if ((service_data->max_resp < 128) || (MAX_APDU < 128)) {
+            return BACNET_STATUS_ABORT;
+        }
+        return 0;
+    }
+
+    return len;
+}
+
 void handler_get_event_information(
     uint8_t * service_request,
     uint16_t service_len,
@@ -95,8 +129,11 @@ void handler_get_event_information(
     BACNET_ADDRESS my_address;
     BACNET_OBJECT_ID object_id;
     unsigned i = 0, j = 0;      /* counter */
+    unsigned position = 0;
+    BACNET_OBJECT_TYPE object_type = OBJECT_ANALOG_INPUT;
     BACNET_GET_EVENT_INFORMATION_DATA getevent_data;
     int valid_event = 0;
+    bool index_complete = false;
 
     /* initialize type of 'Last Received Object Identifier' using max value */
     object_id.type = MAX_BACNET_OBJECT_TYPE;
@@ -143,8 +180,48 @@ void handler_get_event_information(
     }
     pdu_len += len;
     apdu_len = len;
-    for (i = 0; i < MAX_BACNET_OBJECT_TYPE; i++) {
-        if (Get_Event_Info[i]) {
+    /* the events of the types that maintain the index come first,
+       unless the last one received was of another type */
+    index_complete = evindex_complete();
+    if (index_complete && ((object_id.type == MAX_BACNET_OBJECT_TYPE) ||
+            evindex_maintained((BACNET_OBJECT_TYPE) object_id.type))) {
+        /* only the objects with active events are asked */
+        if (object_id.type != MAX_BACNET_OBJECT_TYPE) {
+            position =
+                evindex_position_after((BACNET_OBJECT_TYPE) object_id.type,
+                object_id.instance);
+            object_id.type = MAX_BACNET_OBJECT_TYPE;
+        }
+        for (; position < evindex_count(); position++) {
+            (void) evindex_entry(position, &object_type, NULL, &j);
+            if ((object_type >= MAX_BACNET_OBJECT_TYPE) ||
+                (!Get_Event_Info[object_type]) ||
+                (!evindex_maintained(object_type))) {
+                continue;
+            }
+            valid_event = Get_Event_Info[object_type] (j, &getevent_data);
+            if (valid_event <= 0) {
+                continue;
+            }
+            len =
+                get_event_encode_summary(&Handler_Transmit_Buffer[pdu_len],
+                sizeof(Handler_Transmit_Buffer) - pdu_len, &apdu_len,
+                service_data, &getevent_data);
+            if (len < 0) {
+                error = true;
+                goto GET_EVENT_ERROR;
+            } else if (len == 0) {
+                more_events = true;
+                break;
+            }
+            pdu_len += len;
+        }
+    }
+    /* every object of the other types is asked for its events, and
+       of all types once the index is incomplete */
+    for (i = 0; (i < MAX_BACNET_OBJECT_TYPE) && !more_events; i++) {
+        if (Get_Event_Info[i] && !(index_complete &&
+                evindex_maintained((BACNET_OBJECT_TYPE) i))) {
             for (j = 0; j < 0xffff; j++) {
                 valid_event = Get_Event_Info[i] (j, &getevent_data);
                 if (valid_event > 0) {
@@ -161,34 +238,18 @@ void handler_get_event_information(
                         continue;
                     }
 
-                    getevent_data.next = NULL;
                     len =
-                        getevent_ack_encode_apdu_data(&Handler_Transmit_Buffer
+                        get_event_encode_summary(&Handler_Transmit_Buffer
                         [pdu_len], sizeof(Handler_Transmit_Buffer) - pdu_len,
-                        &getevent_data);
-                    if (len <= 0) {
+                        &apdu_len, service_data, &getevent_data);
+                    if (len < 0) {
                         error = true;
                         goto GET_EVENT_ERROR;
-                    }
-                    apdu_len += len;
-                    if ((apdu_len >= service_data->max_resp - 2)  ||
-                        (apdu_len >= MAX_APDU - 2)) {
-                        /* Device must be able to fit minimum
-                           one event information.
-                           Length of one event informations needs
-                           more than 50 octets. */
-                        if ((service_data->max_resp < 128) ||
-                            (MAX_APDU < 128)) {
-                            len = BACNET_STATUS_ABORT;
-                            error = true;
-                            goto GET_EVENT_ERROR;
-                        } else {
-                            more_events = true;
-                        }
+                    } else if (len == 0) {
+                        more_events = true;
                         break;
-                    } else {
-                        pdu_len += len;
                     }
+                    pdu_len += len;
                 } else if (valid_event < 0) {
                     break;
                 }
@@ -38,12 +38,102 @@
 #include "abort.h"
 #include "reject.h"
 #include "rp.h"
+#include "bacaddr.h"
 /* device object has custom handler for all objects */
 #include "device.h"
 #include "handlers.h"
 
 /** @file h_rp.c  Handles Read Property requests. */
 
+/* the NPDU of every reply is the same, except for the destination,
+   for as long as our address stays the same; a routing gateway
+   answers from the address of each of its virtual devices */
+static BACNET_NPDU_TEMPLATE NPDU_Template;
+static BACNET_ADDRESS NPDU_Template_Address;
+static bool NPDU_Template_Valid;
+
+/* the values of the Present_Value properties that can be got without
+   encoding them are put in the ReadProperty-ACK of a template */
+static read_property_value_function Read_Property_Value;
+/* the templates of recently read properties, one for each slot that
+   the object identifier hashes to */
+#ifndef MAX_RP_ACK_TEMPLATES
+#define MAX_RP_ACK_TEMPLATES 16
+#endif
+static struct rp_ack_template_slot {
+    bool valid;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    BACNET_PROPERTY_ID object_property;
+    BACNET_RP_ACK_TEMPLATE ack;
+} RP_ACK_Template[MAX_RP_ACK_TEMPLATES];
+
+/** Set the function that gets the values of properties without encoding
+ * them, so that the ReadProperty-ACK of a REAL, ENUMERATED or Unsigned
+ * Present_Value is built from a template.
+ *
+ * @param pFunction - function such as Device_Value_Get(), or NULL
+ */
+void handler_read_property_value_set(
+    read_property_value_function pFunction)
+{
+    unsigned i = 0;
+
+    Read_Property_Value = pFunction;
+    for (i = 0; i < MAX_RP_ACK_TEMPLATES; i++) {
+        RP_ACK_Template[i].valid = false;
+    }
+}
+
+/* Encode the ReadProperty-ACK of a Present_Value from a template.
+   Returns the number of octets encoded, or zero if the value can't
+   be got or is not a REAL, ENUMERATED or Unsigned value */
+static int rp_ack_template_value_encode(
+    uint8_t * apdu,
+    uint8_t invoke_id,
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+    struct rp_ack_template_slot *slot = NULL;
+
+    if (!Read_Property_Value ||
+        (rpdata->object_property != PROP_PRESENT_VALUE) ||
+        (rpdata->array_index != BACNET_ARRAY_ALL)) {
+        return 0;
+    }
+    if (!Read_Property_Value(rpdata->object_type, rpdata->object_instance,
+            rpdata->object_property, &value)) {
+        return 0;
+    }
+    if ((value.tag != BACNET_APPLICATION_TAG_REAL) &&
+        (value.tag != BACNET_APPLICATION_TAG_ENUMERATED) &&
+        (value.tag != BACNET_APPLICATION_TAG_UNSIGNED_INT)) {
+        return 0;
+    }
+    slot =
+        &RP_ACK_Template[(rpdata->object_instance +
+            ((uint32_t) rpdata->object_type * 7)) % MAX_RP_ACK_TEMPLATES];
+    if (!slot->valid || (slot->object_type != rpdata->object_type) ||
+        (slot->object_instance != rpdata->object_instance) ||
+        (slot->object_property != rpdata->object_property)) {
+        rp_ack_template_init(&slot->ack, rpdata);
+        slot->object_type = rpdata->object_type;
+        slot->object_instance = rpdata->object_instance;
+        slot->object_property = rpdata->object_property;
+        slot->valid = true;
+    }
+    if (value.tag == BACNET_APPLICATION_TAG_REAL) {
+        return rp_ack_template_encode_real(apdu, &slot->ack, invoke_id,
+            value.type.Real);
+    } else if (value.tag == BACNET_APPLICATION_TAG_ENUMERATED) {
+        return rp_ack_template_encode_enumerated(apdu, &slot->ack,
+            invoke_id, value.type.Enumerated);
+    }
+
+    return rp_ack_template_encode_unsigned(apdu, &slot->ack, invoke_id,
+        value.type.Unsigned_Int);
+}
+
 
 /** Handler for a ReadProperty Service request.
  * @ingroup DSRP
@@ -83,11 +173,17 @@ void handler_read_property(
     /* configure default error code as an abort since it is common */
     rpdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
     /* encode the NPDU portion of the packet */
-    datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    datalink_get_my_address(&my_address);
+    if (!NPDU_Template_Valid ||
+        !bacnet_address_same(&my_address, &NPDU_Template_Address)) {
+        npdu_template_init(&NPDU_Template, &my_address, &npdu_data);
+        bacnet_address_copy(&NPDU_Template_Address, &my_address);
+        NPDU_Template_Valid = true;
+    }
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
-        &npdu_data);
+        npdu_template_encode(&Handler_Transmit_Buffer[0], &NPDU_Template,
+        src);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         len = BACNET_STATUS_ABORT;
@@ -115,6 +211,17 @@ void handler_read_property(
         (rpdata.object_instance == BACNET_MAX_INSTANCE)) {
         rpdata.object_instance = Device_Object_Instance_Number();
     }
+    apdu_len =
+        rp_ack_template_value_encode(&Handler_Transmit_Buffer[npdu_len],
+        service_data->invoke_id, &rpdata);
+    if (apdu_len > 0) {
+        /* a few dozen octets always fit in the smallest max_resp */
+#if PRINT_ENABLED
+        fprintf(stderr, "RP: Sending Ack!\n");
+#endif
+        error = false;
+        goto RP_FAILURE;
+    }
 
     apdu_len =
         rp_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
@@ -30,23 +30,30 @@
 #include <string.h>
 #include <errno.h>
 #include "config.h"
-#include "txbuf.h"
-#include "memcopy.h"
 #include "bacdef.h"
+#include "datalink.h"
 #include "bacdcode.h"
 #include "apdu.h"
 #include "npdu.h"
 #include "abort.h"
 #include "reject.h"
 #include "bacerror.h"
+#include "encbuf.h"
 #include "rpm.h"
+#include "tsm.h"
 #include "handlers.h"
 /* device object has custom handler for all objects */
 #include "device.h"
 
 /** @file h_rpm.c  Handles Read Property Multiple requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+/* The reply is encoded in place, and the property values are read
+   straight into it.  An object may write up to MAX_APDU octets of value
+   wherever it is pointed, so there are that many octets past the end of
+   the largest PDU.  They are also where a value is read when the reply
+   is too full to read it in place. */
+static uint8_t RPM_Transmit_Buffer[MAX_PDU + MAX_APDU];
+#define RPM_VALUE_SCRATCH (&RPM_Transmit_Buffer[MAX_PDU])
 
 static BACNET_PROPERTY_ID RPM_Object_Property(
     struct special_property_list_t *pPropertyList,
@@ -102,67 +109,57 @@ static unsigned RPM_Object_Property_Count(
 }
 
 /** Encode the RPM property returning the length of the encoding,
-   or 0 if there is no room to fit the encoding.  */
+   or an abort if there is no room to fit the encoding, in which
+   case the reply is left as it was.  */
 static int RPM_Encode_Property(
-    uint8_t * apdu,
-    uint16_t offset,
-    uint16_t max_apdu,
+    BACNET_ENCODE_BUFFER * buffer,
     BACNET_RPM_DATA * rpmdata)
 {
     int len = 0;
-    size_t copy_len = 0;
-    int apdu_len = 0;
+    unsigned mark = 0;
+    uint8_t *value = NULL;
     BACNET_READ_PROPERTY_DATA rpdata;
 
-    len =
-        rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
-        rpmdata->object_property, rpmdata->array_index);
-    copy_len = memcopy(&apdu[0], &Temp_Buf[0], offset, len, max_apdu);
-    if (copy_len == 0) {
-        rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-        return BACNET_STATUS_ABORT;
-    }
-    apdu_len += len;
-    len = 0;
+    mark = encbuf_mark(buffer);
+    rpm_ack_encode_buffer_object_property(buffer, rpmdata->object_property,
+        rpmdata->array_index);
     rpdata.error_class = ERROR_CLASS_OBJECT;
     rpdata.error_code = ERROR_CODE_UNKNOWN_OBJECT;
     rpdata.object_type = rpmdata->object_type;
     rpdata.object_instance = rpmdata->object_instance;
     rpdata.object_property = rpmdata->object_property;
     rpdata.array_index = rpmdata->array_index;
-    rpdata.application_data = &Temp_Buf[0];
-    rpdata.application_data_len = sizeof(Temp_Buf);
+    /* past the opening tag, if there is room for the largest value */
+    value = encbuf_reserve(buffer, 1 + MAX_APDU + 1);
+    if (value) {
+        rpdata.application_data = &value[1];
+    } else {
+        rpdata.application_data = RPM_VALUE_SCRATCH;
+    }
+    rpdata.application_data_len = MAX_APDU;
     len = Device_Read_Property(&rpdata);
     if (len < 0) {
         if ((len == BACNET_STATUS_ABORT) || (len == BACNET_STATUS_REJECT)) {
+            encbuf_rollback(buffer, mark);
             rpmdata->error_code = rpdata.error_code;
             /* pass along aborts and rejects for now */
             return len; /* Ie, Abort */
         }
         /* error was returned - encode that for the response */
-        len =
-            rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
+        rpm_ack_encode_buffer_object_property_error(buffer,
             rpdata.error_class, rpdata.error_code);
-        copy_len =
-            memcopy(&apdu[0], &Temp_Buf[0], offset + apdu_len, len, max_apdu);
-
-        if (copy_len == 0) {
-            rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-            return BACNET_STATUS_ABORT;
-        }
-    } else if ((offset + apdu_len + 1 + len + 1) < max_apdu) {
-        /* enough room to fit the property value and tags */
-        len =
-            rpm_ack_encode_apdu_object_property_value(&apdu[offset + apdu_len],
-            &Temp_Buf[0], len);
     } else {
+        rpm_ack_encode_buffer_object_property_value(buffer,
+            rpdata.application_data, (unsigned) len);
+    }
+    if (buffer->overflow) {
         /* not enough room - abort! */
+        encbuf_rollback(buffer, mark);
         rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
         return BACNET_STATUS_ABORT;
     }
-    apdu_len += len;
 
-    return apdu_len;
+    return (int) (buffer->len - mark);
 }
 
 /** Handler for a ReadPropertyMultiple Service request.
@@ -191,24 +188,26 @@ void handler_read_property_multiple(
     BACNET_CONFIRMED_SERVICE_DATA * service_data)
 {
     int len = 0;
-    uint16_t copy_len = 0;
     uint16_t decode_len = 0;
     int pdu_len = 0;
     BACNET_NPDU_DATA npdu_data;
     int bytes_sent;
     BACNET_ADDRESS my_address;
     BACNET_RPM_DATA rpmdata;
+    BACNET_ENCODE_BUFFER buffer;
     int apdu_len = 0;
     int npdu_len = 0;
     int error = 0;
+    unsigned apdu_max = MAX_APDU;
+#if MAX_SEGMENTS
+    uint8_t *segment_buffer = NULL;
+#endif
 
-    /* jps_debug - see if we are utilizing all the buffer */
-    /* memset(&Handler_Transmit_Buffer[0], 0xff, sizeof(Handler_Transmit_Buffer)); */
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&RPM_Transmit_Buffer[0], src, &my_address,
         &npdu_data);
     if (service_data->segmented_message) {
         rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
@@ -218,11 +217,29 @@ void handler_read_property_multiple(
 #endif
         goto RPM_FAILURE;
     }
+    /* the reply is built where it is sent from,
+       and may be as large as the sender accepts */
+    if (service_data->max_resp < apdu_max) {
+        apdu_max = service_data->max_resp;
+    }
+    encbuf_init(&buffer, &RPM_Transmit_Buffer[npdu_len], apdu_max,
+        sizeof(RPM_Transmit_Buffer) - npdu_len);
+#if MAX_SEGMENTS
+    /* when the client accepts a segmented response,
+       build the response in a buffer that holds all the segments */
+    if (tsm_segmented_complex_ack_max(service_data) > MAX_APDU) {
+        segment_buffer = tsm_segment_buffer_claim();
+    }
+    if (segment_buffer) {
+        encbuf_init(&buffer, segment_buffer,
+            tsm_segmented_complex_ack_max(service_data),
+            TSM_SEGMENT_BUFFER_SIZE);
+    }
+#endif
     /* decode apdu request & encode apdu reply
        encode complex ack, invoke id, service choice */
-    apdu_len =
-        rpm_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
-        service_data->invoke_id);
+    encbuf_commit(&buffer, (unsigned) rpm_ack_encode_apdu_init(buffer.buffer,
+            service_data->invoke_id));
     for (;;) {
         /* Start by looking for an object ID */
         len =
@@ -247,11 +264,7 @@ void handler_read_property_multiple(
         }
 
         /* Stick this object id into the reply - if it will fit */
-        len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
-        copy_len =
-            memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0], apdu_len,
-            len, MAX_APDU);
-        if (copy_len == 0) {
+        if (!rpm_ack_encode_buffer_object_begin(&buffer, &rpmdata)) {
 #if PRINT_ENABLED
             fprintf(stderr, "RPM: Response too big!\r\n");
 #endif
@@ -259,8 +272,6 @@ void handler_read_property_multiple(
             error = BACNET_STATUS_ABORT;
             goto RPM_FAILURE;
         }
-
-        apdu_len += copy_len;
         /* do each property of this object of the RPM request */
         for (;;) {
             /* Fetch a property */
@@ -288,31 +299,12 @@ void handler_read_property_multiple(
                 if (rpmdata.array_index != BACNET_ARRAY_ALL) {
                     /*  No array index options for this special property.
                        Encode error for this object property response */
-                    len =
-                        rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
+                    rpm_ack_encode_buffer_object_property(&buffer,
                         rpmdata.object_property, rpmdata.array_index);
-                    copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
-                    if (copy_len == 0) {
-#if PRINT_ENABLED
-                        fprintf(stderr,
-                            "RPM: Too full to encode property!\r\n");
-#endif
-                        rpmdata.error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        error = BACNET_STATUS_ABORT;
-                        goto RPM_FAILURE;
-                    }
-                    apdu_len += len;
-                    len =
-                        rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
+                    rpm_ack_encode_buffer_object_property_error(&buffer,
                         ERROR_CLASS_PROPERTY,
                         ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
-                    copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
-                    if (copy_len == 0) {
+                    if (buffer.overflow) {
 #if PRINT_ENABLED
                         fprintf(stderr, "RPM: Too full to encode error!\r\n");
 #endif
@@ -321,7 +313,6 @@ void handler_read_property_multiple(
                         error = BACNET_STATUS_ABORT;
                         goto RPM_FAILURE;
                     }
-                    apdu_len += len;
                 } else {
                     special_object_property = rpmdata.object_property;
                     Device_Objects_Property_List(rpmdata.object_type,
@@ -331,13 +322,8 @@ void handler_read_property_multiple(
                         special_object_property);
                     if (property_count == 0) {
                         /* handle the error code - but use the special property */
-                        len =
-                            RPM_Encode_Property(&Handler_Transmit_Buffer
-                            [npdu_len], (uint16_t) apdu_len, MAX_APDU,
-                            &rpmdata);
-                        if (len > 0) {
-                            apdu_len += len;
-                        } else {
+                        len = RPM_Encode_Property(&buffer, &rpmdata);
+                        if (len <= 0) {
 #if PRINT_ENABLED
                             fprintf(stderr,
                                 "RPM: Too full for special property!\r\n");
@@ -350,13 +336,8 @@ void handler_read_property_multiple(
                             rpmdata.object_property =
                                 RPM_Object_Property(&property_list,
                                 special_object_property, index);
-                            len =
-                                RPM_Encode_Property(&Handler_Transmit_Buffer
-                                [npdu_len], (uint16_t) apdu_len, MAX_APDU,
-                                &rpmdata);
-                            if (len > 0) {
-                                apdu_len += len;
-                            } else {
+                            len = RPM_Encode_Property(&buffer, &rpmdata);
+                            if (len <= 0) {
 #if PRINT_ENABLED
                                 fprintf(stderr,
                                     "RPM: Too full for property!\r\n");
@@ -369,12 +350,8 @@ void handler_read_property_multiple(
                 }
             } else {
                 /* handle an individual property */
-                len =
-                    RPM_Encode_Property(&Handler_Transmit_Buffer[npdu_len],
-                    (uint16_t) apdu_len, MAX_APDU, &rpmdata);
-                if (len > 0) {
-                    apdu_len += len;
-                } else {
+                len = RPM_Encode_Property(&buffer, &rpmdata);
+                if (len <= 0) {
 #if PRINT_ENABLED
                     fprintf(stderr,
                         "RPM: Too full for individual property!\r\n");
@@ -386,11 +363,7 @@ void handler_read_property_multiple(
             if (decode_is_closing_tag_number(&service_request[decode_len], 1)) {
                 /* Reached end of property list so cap the result list */
                 decode_len++;
-                len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
-                copy_len =
-                    memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0],
-                    apdu_len, len, MAX_APDU);
-                if (copy_len == 0) {
+                if (!rpm_ack_encode_buffer_object_end(&buffer)) {
 #if PRINT_ENABLED
                     fprintf(stderr, "RPM: Too full to encode object end!\r\n");
 #endif
@@ -398,8 +371,6 @@ void handler_read_property_multiple(
                         ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
                     error = BACNET_STATUS_ABORT;
                     goto RPM_FAILURE;
-                } else {
-                    apdu_len += copy_len;
                 }
                 break;  /* finished with this property list */
             }
@@ -409,22 +380,34 @@ void handler_read_property_multiple(
             break;
         }
     }
-
-    if (apdu_len > service_data->max_resp) {
-        /* too big for the sender - send an abort */
-        rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-        error = BACNET_STATUS_ABORT;
-#if PRINT_ENABLED
-        fprintf(stderr, "RPM: Message too large.  Sending Abort!\n");
-#endif
-        goto RPM_FAILURE;
+    apdu_len = (int) buffer.len;
+#if MAX_SEGMENTS
+    if (segment_buffer) {
+        if ((apdu_len <= service_data->max_resp) && (apdu_len <= MAX_APDU)) {
+            /* it fits in one APDU after all */
+            memcpy(&RPM_Transmit_Buffer[npdu_len], segment_buffer,
+                apdu_len);
+        } else if (tsm_segmented_complex_ack_send(src, &npdu_data,
+                service_data, segment_buffer, apdu_len)) {
+            /* the TSM sends the segments and releases the buffer */
+            return;
+        } else {
+            segment_buffer = NULL;
+            rpmdata.error_code = ERROR_CODE_ABORT_BUFFER_OVERFLOW;
+            error = BACNET_STATUS_ABORT;
+            goto RPM_FAILURE;
+        }
     }
+#endif
 
   RPM_FAILURE:
+#if MAX_SEGMENTS
+    tsm_segment_buffer_release(segment_buffer);
+#endif
     if (error) {
         if (error == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&RPM_Transmit_Buffer[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(rpmdata.error_code), true);
 #if PRINT_ENABLED
@@ -432,7 +415,7 @@ void handler_read_property_multiple(
 #endif
         } else if (error == BACNET_STATUS_ERROR) {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                bacerror_encode_apdu(&RPM_Transmit_Buffer[npdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
                 rpmdata.error_class, rpmdata.error_code);
 #if PRINT_ENABLED
@@ -440,7 +423,7 @@ void handler_read_property_multiple(
 #endif
         } else if (error == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&RPM_Transmit_Buffer[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(rpmdata.error_code));
 #if PRINT_ENABLED
@@ -451,7 +434,7 @@ void handler_read_property_multiple(
 
     pdu_len = apdu_len + npdu_len;
     bytes_sent =
-        datalink_send_pdu(src, &npdu_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npdu_data, &RPM_Transmit_Buffer[0],
         pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
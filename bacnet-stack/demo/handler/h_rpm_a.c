@@ -38,6 +38,8 @@
 #include "datalink.h"
 #include "bactext.h"
 #include "rpm.h"
+#include "rpm_ack.h"
+#include "arena.h"
 /* some demo stuff needed */
 #include "handlers.h"
 #include "txbuf.h"
@@ -283,10 +285,107 @@ void rpm_ack_print_data(
     }
 }
 
+/* for debugging... */
+void rpm_ack_print_compact(
+    BACNET_RPM_ACK_DATA * ack_data,
+    BACNET_RPM_ACK_OBJECT * rpm_object)
+{
+    BACNET_OBJECT_PROPERTY_VALUE object_value;  /* for bacapp printing */
+    BACNET_APPLICATION_DATA_VALUE application_value;
+    BACNET_RPM_ACK_PROPERTY *listOfProperties;
+    BACNET_COMPACT_VALUE *value;
+    bool array_value = false;
+
+    if (ack_data && rpm_object) {
+#if PRINT_ENABLED
+        fprintf(stdout, "%s #%lu\r\n",
+            bactext_object_type_name(rpm_object->object_type),
+            (unsigned long) rpm_object->object_instance);
+        fprintf(stdout, "{\r\n");
+#endif
+        listOfProperties = rpm_object->listOfProperties;
+        while (listOfProperties) {
+#if PRINT_ENABLED
+            if (listOfProperties->propertyIdentifier < 512) {
+                fprintf(stdout, "    %s: ",
+                    bactext_property_name(listOfProperties->
+                        propertyIdentifier));
+            } else {
+                fprintf(stdout, "    proprietary %u: ",
+                    (unsigned) listOfProperties->propertyIdentifier);
+            }
+            if (listOfProperties->propertyArrayIndex != BACNET_ARRAY_ALL) {
+                fprintf(stdout, "[%d]", listOfProperties->propertyArrayIndex);
+            }
+#endif
+            value = listOfProperties->value;
+            if (listOfProperties->error_present) {
+#if PRINT_ENABLED
+                /* AccessError */
+                fprintf(stdout, "BACnet Error: %s: %s\r\n",
+                    bactext_error_class_name((int) listOfProperties->
+                        error.error_class),
+                    bactext_error_code_name((int) listOfProperties->
+                        error.error_code));
+#endif
+            } else if (value) {
+#if PRINT_ENABLED
+                if (value->next) {
+                    fprintf(stdout, "{");
+                    array_value = true;
+                } else {
+                    array_value = false;
+                }
+#endif
+                object_value.object_type = rpm_object->object_type;
+                object_value.object_instance = rpm_object->object_instance;
+                object_value.object_property =
+                    listOfProperties->propertyIdentifier;
+                object_value.array_index =
+                    listOfProperties->propertyArrayIndex;
+                object_value.value = &application_value;
+                while (value) {
+                    if (rpm_ack_value_expand(ack_data, value,
+                            &application_value)) {
+                        bacapp_print_value(stdout, &object_value);
+                    } else {
+#if PRINT_ENABLED
+                        /* constructed data is not decoded */
+                        fprintf(stdout, "(%lu octets)",
+                            (unsigned long) value->type.Octets.length);
+#endif
+                    }
+#if PRINT_ENABLED
+                    if (value->next) {
+                        fprintf(stdout, ",\r\n        ");
+                    } else {
+                        if (array_value) {
+                            fprintf(stdout, "}\r\n");
+                        } else {
+                            fprintf(stdout, "\r\n");
+                        }
+                    }
+#endif
+                    value = value->next;
+                }
+            } else {
+#if PRINT_ENABLED
+                /* empty list */
+                fprintf(stdout, "{}\r\n");
+#endif
+            }
+            listOfProperties = listOfProperties->next;
+        }
+#if PRINT_ENABLED
+        fprintf(stdout, "}\r\n");
+#endif
+    }
+}
+
 /** Handler for a ReadPropertyMultiple ACK.
  * @ingroup DSRPM
  * For each read property, print out the ACK'd data for debugging,
- * and free the request data items from linked property list.
+ * which is decoded into compact values that are freed in a single call.
  *
  * @param service_request [in] The contents of the service request.
  * @param service_len [in] The length of the service_request.
@@ -301,64 +400,31 @@ void handler_read_property_multiple_ack(
     BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
 {
     int len = 0;
-    BACNET_READ_ACCESS_DATA *rpm_data;
-    BACNET_READ_ACCESS_DATA *old_rpm_data;
-    BACNET_PROPERTY_REFERENCE *rpm_property;
-    BACNET_PROPERTY_REFERENCE *old_rpm_property;
-    BACNET_APPLICATION_DATA_VALUE *value;
-    BACNET_APPLICATION_DATA_VALUE *old_value;
+    ARENA arena;
+    BACNET_RPM_ACK_DATA ack_data;
+    BACNET_RPM_ACK_OBJECT *rpm_object;
 
     (void) src;
     (void) service_data;        /* we could use these... */
 
-    rpm_data = calloc(1, sizeof(BACNET_READ_ACCESS_DATA));
-    if (rpm_data) {
-        len =
-            rpm_ack_decode_service_request(service_request, service_len,
-            rpm_data);
-    }
+    /* the whole ACK is decoded into one arena, and freed at once */
+    arena_init(&arena, 0);
+    len =
+        rpm_ack_decode_compact(service_request, service_len, false, &arena,
+        &ack_data);
 #if 1
     fprintf(stderr, "Received Read-Property-Multiple Ack!\n");
 #endif
     if (len > 0) {
-        while (rpm_data) {
-            rpm_ack_print_data(rpm_data);
-            rpm_property = rpm_data->listOfProperties;
-            while (rpm_property) {
-                value = rpm_property->value;
-                while (value) {
-                    old_value = value;
-                    value = value->next;
-                    free(old_value);
-                }
-                old_rpm_property = rpm_property;
-                rpm_property = rpm_property->next;
-                free(old_rpm_property);
-            }
-            old_rpm_data = rpm_data;
-            rpm_data = rpm_data->next;
-            free(old_rpm_data);
+        rpm_object = ack_data.objects;
+        while (rpm_object) {
+            rpm_ack_print_compact(&ack_data, rpm_object);
+            rpm_object = rpm_object->next;
         }
     } else {
 #if 1
         fprintf(stderr, "RPM Ack Malformed! Freeing memory...\n");
 #endif
-        while (rpm_data) {
-            rpm_property = rpm_data->listOfProperties;
-            while (rpm_property) {
-                value = rpm_property->value;
-                while (value) {
-                    old_value = value;
-                    value = value->next;
-                    free(old_value);
-                }
-                old_rpm_property = rpm_property;
-                rpm_property = rpm_property->next;
-                free(old_rpm_property);
-            }
-            old_rpm_data = rpm_data;
-            rpm_data = rpm_data->next;
-            free(old_rpm_data);
-        }
     }
+    arena_free(&arena);
 }
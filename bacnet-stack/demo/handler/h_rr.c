@@ -35,13 +35,17 @@
 #include "apdu.h"
 #include "npdu.h"
 #include "abort.h"
+#include "encbuf.h"
 #include "readrange.h"
+#include "tsm.h"
 #include "device.h"
 #include "handlers.h"
 
 /** @file h_rr.c  Handles Read Range requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+/* Where the items go in the reply: past the largest ReadRange-ACK
+   header (27 octets), which rr_ack_encode_apdu() writes in front of them */
+#define RR_ITEMS_OFFSET 32
 
 /* Encodes the property APDU and returns the length,
    or sets the error, and returns -1 */
@@ -100,6 +104,12 @@ void handler_read_range(
     bool error = false;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    BACNET_ENCODE_BUFFER buffer;
+    unsigned apdu_max = MAX_APDU;
+    unsigned items_max = 0;
+#if MAX_SEGMENTS
+    uint8_t *segment_buffer = NULL;
+#endif
 
     data.error_class = ERROR_CLASS_OBJECT;
     data.error_code = ERROR_CODE_UNKNOWN_OBJECT;
@@ -137,17 +147,61 @@ void handler_read_range(
         goto RR_ABORT;
     }
 
+    /* the items are encoded in place in the reply,
+       which may be as large as the sender accepts */
+    if (service_data->max_resp < apdu_max) {
+        apdu_max = service_data->max_resp;
+    }
+    encbuf_init(&buffer, &Handler_Transmit_Buffer[pdu_len], apdu_max,
+        sizeof(Handler_Transmit_Buffer) - pdu_len);
+#if MAX_SEGMENTS
+    /* when the client accepts a segmented response,
+       fill a buffer that holds all the segments with items */
+    if (tsm_segmented_complex_ack_max(service_data) > MAX_APDU) {
+        segment_buffer = tsm_segment_buffer_claim();
+    }
+    if (segment_buffer) {
+        encbuf_init(&buffer, segment_buffer,
+            tsm_segmented_complex_ack_max(service_data),
+            TSM_SEGMENT_BUFFER_SIZE);
+    }
+#endif
+    /* the objects fill MaxApdu less the Overhead with items */
+    items_max = buffer.room - RR_ITEMS_OFFSET + data.Overhead;
+    data.MaxApdu = (int) ((buffer.size < items_max) ? buffer.size : items_max);
     /* assume that there is an error */
     error = true;
-    len = Encode_RR_payload(&Temp_Buf[0], &data);
+    len = Encode_RR_payload(&buffer.buffer[RR_ITEMS_OFFSET], &data);
     if (len >= 0) {
         /* encode the APDU portion of the packet */
-        data.application_data = &Temp_Buf[0];
+        data.application_data = &buffer.buffer[RR_ITEMS_OFFSET];
         data.application_data_len = len;
-        /* FIXME: probably need a length limitation sent with encode */
-        len =
-            rr_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-            service_data->invoke_id, &data);
+        len = rr_ack_encode_apdu(buffer.buffer, service_data->invoke_id, &data);
+        if (!encbuf_commit(&buffer, (unsigned) len)) {
+            /* the Overhead was not enough */
+            len = -2;
+        }
+    }
+    if (len >= 0) {
+#if MAX_SEGMENTS
+        if (segment_buffer) {
+            if ((len > service_data->max_resp) || (len > MAX_APDU)) {
+                /* the TSM sends the segments and releases the buffer */
+                if (tsm_segmented_complex_ack_send(src, &npdu_data,
+                        service_data, segment_buffer, len)) {
+                    return;
+                }
+                segment_buffer = NULL;
+                len =
+                    abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    service_data->invoke_id, ABORT_REASON_BUFFER_OVERFLOW,
+                    true);
+                goto RR_ABORT;
+            }
+            /* it fits in one APDU after all */
+            memcpy(&Handler_Transmit_Buffer[pdu_len], segment_buffer, len);
+        }
+#endif
 #if PRINT_ENABLED
         fprintf(stderr, "RR: Sending Ack!\n");
 #endif
@@ -174,6 +228,9 @@ void handler_read_range(
         }
     }
   RR_ABORT:
+#if MAX_SEGMENTS
+    tsm_segment_buffer_release(segment_buffer);
+#endif
     pdu_len += len;
     bytes_sent =
         datalink_send_pdu(src, &npdu_data, &Handler_Transmit_Buffer[0],
@@ -37,6 +37,7 @@
 #include "abort.h"
 #include "wp.h"
 #include "reject.h"
+#include "encbuf.h"
 #include "wpm.h"
 /* device object has the handling for all objects */
 #include "device.h"
@@ -77,6 +78,8 @@ void handler_write_property_multiple(
     BACNET_WRITE_PROPERTY_DATA wp_data;
     BACNET_NPDU_DATA npdu_data;
     BACNET_ADDRESS my_address;
+    BACNET_ENCODE_BUFFER buffer;
+    unsigned apdu_max = MAX_APDU;
     int bytes_sent = 0;
 
     if (service_data->segmented_message) {
@@ -175,12 +178,26 @@ void handler_write_property_multiple(
             fprintf(stderr, "WPM: Sending Abort!\n");
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
-            apdu_len =
-                wpm_error_ack_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
-                service_data->invoke_id, &wp_data);
+            if (service_data->max_resp < apdu_max) {
+                apdu_max = service_data->max_resp;
+            }
+            encbuf_init(&buffer, &Handler_Transmit_Buffer[npdu_len],
+                apdu_max, sizeof(Handler_Transmit_Buffer) - npdu_len);
+            if (wpm_error_ack_encode_buffer(&buffer, service_data->invoke_id,
+                    &wp_data)) {
+                apdu_len = (int) buffer.len;
 #if PRINT_ENABLED
-            fprintf(stderr, "WPM: Sending Error!\n");
+                fprintf(stderr, "WPM: Sending Error!\n");
 #endif
+            } else {
+                apdu_len =
+                    abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                    service_data->invoke_id,
+                    ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
+#if PRINT_ENABLED
+                fprintf(stderr, "WPM: Error too big.  Sending Abort!\n");
+#endif
+            }
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len =
                 reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
@@ -39,58 +39,57 @@
 
 /** @file s_cevent.c  Send a ConfirmedEventNotification Request. */
 
-/** Sends an Confirmed Alarm/Event Notification.
+/** Sends a Confirmed Alarm/Event Notification that is already encoded.
+ * The invoke id of the transaction is written into the APDU, so that
+ * one encoding can be sent to many devices.
  * @ingroup EVNOTFCN
  *
- * @param device_id [in] ID of the destination device
- * @param data [in] The information about the Event to be sent.
+ * @param dest [in] The address of the destination device.
+ * @param max_apdu [in] The largest APDU the destination device accepts.
+ * @param apdu [in,out] The APDU from cevent_notify_encode_apdu().
+ * @param apdu_len [in] The length of the APDU.
  * @return invoke id of outgoing message, or 0 if communication is disabled,
  *         or no tsm slot is available.
  */
-uint8_t Send_CEvent_Notify(
-    uint32_t device_id,
-    BACNET_EVENT_NOTIFICATION_DATA * data)
+uint8_t Send_CEvent_Notify_Encoded(
+    BACNET_ADDRESS * dest,
+    unsigned max_apdu,
+    uint8_t * apdu,
+    int apdu_len)
 {
-    int len = 0;
     int pdu_len = 0;
     int bytes_sent = 0;
     BACNET_NPDU_DATA npdu_data;
-    BACNET_ADDRESS dest;
     BACNET_ADDRESS my_address;
-    unsigned max_apdu = 0;
-    bool status = false;
     uint8_t invoke_id = 0;
 
     if (!dcc_communication_enabled())
         return 0;
 
-    /* is the device bound? */
-    status = address_get_by_device(device_id, &max_apdu, &dest);
     /* is there a tsm available? */
-    if (status)
+    if (apdu_len > 0)
         invoke_id = tsm_next_free_invokeID();
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
             &npdu_data);
-        /* encode the APDU portion of the packet */
-        len =
-            cevent_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-            invoke_id, data);
-        pdu_len += len;
+        /* the APDU portion of the packet, for this transaction */
+        apdu[2] = invoke_id;
+        memcpy(&Handler_Transmit_Buffer[pdu_len], apdu, (size_t) apdu_len);
+        pdu_len += apdu_len;
         /* will it fit in the sender?
            note: if there is a bottleneck router in between
            us and the destination, we won't know unless
            we have a way to check for that and update the
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
-            tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
+            tsm_set_confirmed_unsegmented_transaction(invoke_id, dest,
                 &npdu_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
             bytes_sent =
-                datalink_send_pdu(&dest, &npdu_data,
+                datalink_send_pdu(dest, &npdu_data,
                 &Handler_Transmit_Buffer[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0) {
@@ -112,3 +111,31 @@ uint8_t Send_CEvent_Notify(
 
     return invoke_id;
 }
+
+/** Sends an Confirmed Alarm/Event Notification.
+ * @ingroup EVNOTFCN
+ *
+ * @param device_id [in] ID of the destination device
+ * @param data [in] The information about the Event to be sent.
+ * @return invoke id of outgoing message, or 0 if communication is disabled,
+ *         or no tsm slot is available.
+ */
+uint8_t Send_CEvent_Notify(
+    uint32_t device_id,
+    BACNET_EVENT_NOTIFICATION_DATA * data)
+{
+    uint8_t apdu[MAX_PDU];
+    int apdu_len = 0;
+    BACNET_ADDRESS dest;
+    unsigned max_apdu = 0;
+
+    if (!dcc_communication_enabled())
+        return 0;
+
+    /* is the device bound? */
+    if (!address_get_by_device(device_id, &max_apdu, &dest))
+        return 0;
+    apdu_len = cevent_notify_encode_apdu(&apdu[0], 0, data);
+
+    return Send_CEvent_Notify_Encoded(&dest, max_apdu, &apdu[0], apdu_len);
+}
@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <errno.h>
+#include <string.h>
 #include "event.h"
 #include "datalink.h"
 #include "client.h"
@@ -63,3 +64,39 @@ int Send_UEvent_Notify(
 
     return bytes_sent;
 }
+
+/** Sends an Unconfirmed Alarm/Event Notification that is already encoded,
+ * so that one encoding can be sent to many destinations.
+ * @ingroup EVNOTFCN
+ *
+ * @param buffer [in,out] The buffer to build the message in for sending.
+ * @param apdu [in] The APDU from uevent_notify_encode_apdu().
+ * @param apdu_len [in] The length of the APDU.
+ * @param dest [in] The destination address information (may be a broadcast).
+ * @return Size of the message sent (bytes), or a negative value on error.
+ */
+int Send_UEvent_Notify_Encoded(
+    uint8_t * buffer,
+    uint8_t * apdu,
+    int apdu_len,
+    BACNET_ADDRESS * dest)
+{
+    int pdu_len = 0;
+    int bytes_sent = 0;
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS my_address;
+
+    if (apdu_len <= 0)
+        return -1;
+    datalink_get_my_address(&my_address);
+    /* encode the NPDU portion of the packet */
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(buffer, dest, &my_address, &npdu_data);
+    /* the APDU portion of the packet */
+    memcpy(&buffer[pdu_len], apdu, (size_t) apdu_len);
+    pdu_len += apdu_len;
+    /* send the data */
+    bytes_sent = datalink_send_pdu(dest, &npdu_data, &buffer[0], pdu_len);
+
+    return bytes_sent;
+}
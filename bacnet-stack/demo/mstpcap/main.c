@@ -52,13 +52,17 @@
 #include "dlmstp.h"
 /* I-Am decoding */
 #include "iam.h"
+/* token-loop analysis */
+#include "mstpstat.h"
+/* capture file I/O */
+#include "pcapfile.h"
 
 #ifdef _WIN32
 #define strncasecmp(x,y,z) _strnicmp(x,y,z)
 #endif
 
 /* define our Data Link Type for libPCAP */
-#define DLT_BACNET_MS_TP 165
+#define DLT_BACNET_MS_TP PCAP_DLT_BACNET_MS_TP
 /* local min/max macros */
 #ifndef max
 #define max(a,b) (((a) (b)) ? (a) : (b))
@@ -78,6 +82,8 @@ static uint8_t TxBuffer[MAX_MPDU];
 static volatile bool Exit_Requested;
 /* flag to indicate Wireshark is running the show - no stdout or stderr */
 static bool Wireshark_Capture;
+/* number of packets in the current capture file */
+static uint32_t Packet_Count;
 
 /* statistics derived from monitoring the network for each node */
 struct mstp_statistics {
@@ -132,6 +138,21 @@ struct mstp_statistics {
 #define MAX_MSTP_DEVICES 256
 static struct mstp_statistics MSTP_Statistics[MAX_MSTP_DEVICES];
 static uint32_t Invalid_Frame_Count;
+/* token-loop analysis - rotation, latency, and bandwidth usage */
+static struct mstp_stats MSTP_Analysis;
+/* format of the statistics report */
+typedef enum {
+    REPORT_FORMAT_TEXT = 0,
+    REPORT_FORMAT_CSV = 1,
+    REPORT_FORMAT_JSON = 2
+} REPORT_FORMAT;
+static REPORT_FORMAT Report_Format = REPORT_FORMAT_TEXT;
+
+static uint64_t timeval_microseconds(
+    struct timeval *tv)
+{
+    return ((uint64_t) tv->tv_sec * 1000000UL) + (uint64_t) tv->tv_usec;
+}
 
 static uint32_t timeval_diff_ms(
     struct timeval *old,
@@ -188,22 +209,25 @@ static void mstp_monitor_i_am(
     }
 }
 
+/* statistics from a frame with a valid header and data CRC */
 static void packet_statistics(
     struct timeval *tv,
-    volatile struct mstp_port_struct_t *mstp_port)
+    uint8_t frame,
+    uint8_t src,
+    uint8_t dst,
+    uint8_t * pdu,
+    uint16_t pdu_len)
 {
     static struct timeval old_tv = { 0 };
     static uint8_t old_frame = 255;
     static uint8_t old_src = 255;
     static uint8_t old_dst = 255;
     static uint8_t old_token_dst = 255;
-    uint8_t frame, src, dst;
     uint32_t delta;
     uint32_t npoll;
 
-    dst = mstp_port->DestinationAddress;
-    src = mstp_port->SourceAddress;
-    frame = mstp_port->FrameType;
+    MSTP_Stats_Frame(&MSTP_Analysis, timeval_microseconds(tv), frame, src,
+        dst, pdu_len, true);
     switch (frame) {
         case FRAME_TYPE_TOKEN:
             MSTP_Statistics[src].token_count++;
@@ -292,13 +316,8 @@ static void packet_statistics(
                     MSTP_Statistics[src].der_reply = delta;
                 }
             }
-            if ((mstp_port->ReceivedValidFrame) ||
-                (mstp_port->ReceivedValidFrameNotForUs)) {
-                if ((mstp_port->DataLength <= mstp_port->InputBufferSize) &&
-                    (mstp_port->DataLength > 0)) {
-                    mstp_monitor_i_am(src, &mstp_port->InputBuffer[0],
-                        mstp_port->DataLength);
-                }
+            if (pdu && (pdu_len > 0)) {
+                mstp_monitor_i_am(src, pdu, pdu_len);
             }
             break;
         case FRAME_TYPE_REPLY_POSTPONED:
@@ -324,7 +343,7 @@ static void packet_statistics(
     old_tv.tv_usec = tv->tv_usec;
 }
 
-static void packet_statistics_print(
+static void packet_statistics_print_counts(
     void)
 {
     unsigned i; /* loop counter */
@@ -397,6 +416,20 @@ static void packet_statistics_print(
         (long unsigned int) Invalid_Frame_Count);
 }
 
+static void packet_statistics_print(
+    void)
+{
+    if (Report_Format == REPORT_FORMAT_CSV) {
+        MSTP_Stats_Print_CSV(&MSTP_Analysis, stdout);
+        return;
+    } else if (Report_Format == REPORT_FORMAT_JSON) {
+        MSTP_Stats_Print_JSON(&MSTP_Analysis, stdout);
+        return;
+    }
+    packet_statistics_print_counts();
+    MSTP_Stats_Print_Text(&MSTP_Analysis, stdout);
+}
+
 static void packet_statistics_clear(
     void)
 {
@@ -407,6 +440,7 @@ static void packet_statistics_clear(
         MSTP_Statistics[i].device_id = 0xFFFFFFFF;
     }
     Invalid_Frame_Count = 0;
+    MSTP_Stats_Init(&MSTP_Analysis, RS485_Get_Baud_Rate());
 }
 
 static uint32_t Timer_Silence(
@@ -450,8 +484,6 @@ uint16_t MSTP_Get_Reply(
     return 0;
 }
 
-static char Capture_Filename[32] = "mstp_20090123091200.cap";
-static FILE *pFile = NULL;      /* stream pointer */
 #if defined(_WIN32)
 static HANDLE hPipe = INVALID_HANDLE_VALUE;     /* pipe handle */
 static void named_pipe_create(
@@ -488,39 +520,20 @@ static void named_pipe_create(
     ConnectNamedPipe(hPipe, NULL);
 }
 
-size_t data_write(
-    const void *ptr,
-    size_t size,
-    size_t nitems)
+/* copy of the capture for the named pipe */
+static void named_pipe_write(
+    const uint8_t * buffer,
+    size_t length)
 {
     DWORD cbWritten = 0;
-    if (hPipe != INVALID_HANDLE_VALUE) {
-        (void) WriteFile(hPipe, /* handle to pipe  */
-            ptr,        /* buffer to write from  */
-            size * nitems,      /* number of bytes to write  */
-            &cbWritten, /* number of bytes written  */
-            NULL);      /* not overlapped I/O  */
-    }
-
-    return fwrite(ptr, size, nitems, pFile);
-}
 
-size_t data_write_header(
-    const void *ptr,
-    size_t size,
-    size_t nitems,
-    bool pipe_enable)
-{
-    DWORD cbWritten = 0;
-    if (pipe_enable && (hPipe != INVALID_HANDLE_VALUE)) {
+    if (hPipe != INVALID_HANDLE_VALUE) {
         (void) WriteFile(hPipe, /* handle to pipe  */
-            ptr,        /* buffer to write from  */
-            size * nitems,      /* number of bytes to write  */
+            buffer,     /* buffer to write from  */
+            length,     /* number of bytes to write  */
             &cbWritten, /* number of bytes written  */
             NULL);      /* not overlapped I/O  */
     }
-
-    return fwrite(ptr, size, nitems, pFile);
 }
 #else
 static int FD_Pipe = -1;
@@ -540,130 +553,73 @@ static void named_pipe_create(
     }
 }
 
-size_t data_write(
-    const void *ptr,
-    size_t size,
-    size_t nitems)
+/* copy of the capture for the named pipe */
+static void named_pipe_write(
+    const uint8_t * buffer,
+    size_t length)
 {
     ssize_t bytes = 0;
-    if (FD_Pipe != -1) {
-        bytes = write(FD_Pipe, ptr, size * nitems);
-        bytes = bytes;
-    }
-    return fwrite(ptr, size, nitems, pFile);
-}
 
-size_t data_write_header(
-    const void *ptr,
-    size_t size,
-    size_t nitems,
-    bool pipe_enable)
-{
-    ssize_t bytes = 0;
-    if (pipe_enable && (FD_Pipe != -1)) {
-        bytes = write(FD_Pipe, ptr, size * nitems);
+    if (FD_Pipe != -1) {
+        bytes = write(FD_Pipe, buffer, length);
         bytes = bytes;
     }
-    return fwrite(ptr, size, nitems, pFile);
 }
 #endif
 
-static void filename_create(
-    char *filename)
-{
-    time_t my_time;
-    struct tm *today;
-
-    if (filename) {
-        my_time = time(NULL);
-        today = localtime(&my_time);
-        sprintf(filename, "mstp_%04d%02d%02d%02d%02d%02d.cap",
-            1900 + today->tm_year, 1 + today->tm_mon, today->tm_mday,
-            today->tm_hour, today->tm_min, today->tm_sec);
-    }
-}
-
-/* write packet to file in libpcap format */
-static void write_global_header(
+/* called when a capture file is full and the next one is started */
+static void capture_file_rotated(
     const char *filename)
 {
-    static bool pipe_enable = true;     /* don't write more than one header */
-    uint32_t magic_number = 0xa1b2c3d4; /* magic number */
-    uint16_t version_major = 2; /* major version number */
-    uint16_t version_minor = 4; /* minor version number */
-    int32_t thiszone = 0;       /* GMT to local correction */
-    uint32_t sigfigs = 0;       /* accuracy of timestamps */
-    uint32_t snaplen = 65535;   /* max length of captured packets, in octets */
-    uint32_t network = DLT_BACNET_MS_TP;     /* data link type - BACNET_MS_TP */
-
-    /* create a new file. */
-    pFile = fopen(filename, "wb");
-    if (pFile) {
-        (void) data_write_header(&magic_number, sizeof(magic_number), 1,
-            pipe_enable);
-        (void) data_write_header(&version_major, sizeof(version_major), 1,
-            pipe_enable);
-        (void) data_write_header(&version_minor, sizeof(version_minor), 1,
-            pipe_enable);
-        (void) data_write_header(&thiszone, sizeof(thiszone), 1, pipe_enable);
-        (void) data_write_header(&sigfigs, sizeof(sigfigs), 1, pipe_enable);
-        (void) data_write_header(&snaplen, sizeof(snaplen), 1, pipe_enable);
-        (void) data_write_header(&network, sizeof(network), 1, pipe_enable);
-        fflush(pFile);
-        if (!Wireshark_Capture) {
-            fprintf(stdout, "mstpcap: saving capture to %s\n", filename);
-        }
-    } else {
-        fprintf(stderr, "mstpcap[header]: failed to open %s: %s\n", filename,
-            strerror(errno));
-    }
-    if (pipe_enable) {
-        pipe_enable = false;
+    if (!Wireshark_Capture) {
+        packet_statistics_print();
+        fprintf(stdout, "mstpcap: closing capture %s\n", filename);
     }
+    packet_statistics_clear();
+    Packet_Count = 0;
 }
 
-
+/* write packet to file in libpcap format */
 static void write_received_packet(
     volatile struct mstp_port_struct_t *mstp_port,
     size_t header_len)
 {
-    uint32_t ts_sec = 0;    /* timestamp seconds */
-    uint32_t ts_usec = 0;   /* timestamp microseconds */
     uint32_t incl_len = 0;  /* number of octets of packet saved in file */
-    uint32_t orig_len = 0;  /* actual length of packet */
     uint8_t header[MSTP_HEADER_MAX] = {0};  /* MS/TP header */
+    uint8_t *packet = NULL;
     struct timeval tv;
     size_t max_data = 0;
 
-    if (pFile) {
-        gettimeofday(&tv, NULL);
-        ts_sec = tv.tv_sec;
-        ts_usec = tv.tv_usec;
-        if ((mstp_port->ReceivedValidFrame) ||
-            (mstp_port->ReceivedValidFrameNotForUs)) {
-            packet_statistics(&tv, mstp_port);
+    gettimeofday(&tv, NULL);
+    if (mstp_port->ReceivedInvalidFrame) {
+        if (mstp_port->Index) {
+            max_data = min(mstp_port->InputBufferSize, mstp_port->Index);
+            incl_len = header_len + max_data + 2/* checksum*/;
+        } else {
+            /* header only */
+            incl_len = header_len;
         }
-        (void) data_write(&ts_sec, sizeof(ts_sec), 1);
-        (void) data_write(&ts_usec, sizeof(ts_usec), 1);
-        if (mstp_port->ReceivedInvalidFrame) {
-            if (mstp_port->Index) {
-                max_data = min(mstp_port->InputBufferSize, mstp_port->Index);
-                incl_len = orig_len = header_len + max_data + 2/* checksum*/;
-            } else {
-                /* header only */
-                incl_len = orig_len = header_len;
-            }
+    } else {
+        if (mstp_port->DataLength) {
+            max_data = min(mstp_port->InputBufferSize, mstp_port->DataLength);
+            incl_len = header_len + max_data + 2/* checksum*/;
         } else {
-            if (mstp_port->DataLength) {
-                max_data = min(mstp_port->InputBufferSize, mstp_port->DataLength);
-                incl_len = orig_len = header_len + max_data + 2/* checksum*/;
-            } else {
-                /* header only - or at least some bytes of the header */
-                incl_len = orig_len = header_len;
-            }
+            /* header only - or at least some bytes of the header */
+            incl_len = header_len;
         }
-        (void) data_write(&incl_len, sizeof(incl_len), 1);
-        (void) data_write(&orig_len, sizeof(orig_len), 1);
+    }
+    if ((mstp_port->ReceivedValidFrame) ||
+        (mstp_port->ReceivedValidFrameNotForUs)) {
+        packet_statistics(&tv, mstp_port->FrameType,
+            mstp_port->SourceAddress, mstp_port->DestinationAddress,
+            mstp_port->InputBuffer, max_data);
+    } else {
+        MSTP_Stats_Invalid_Frame(&MSTP_Analysis,
+            timeval_microseconds(&tv), incl_len);
+    }
+    /* the packet is built in place in the capture write buffer */
+    packet = Pcap_Writer_Packet(tv.tv_sec, tv.tv_usec, incl_len);
+    if (packet) {
         if (header_len == 1) {
             header[0] = mstp_port->DataRegister;
         } else if (header_len == 2) {
@@ -679,211 +635,92 @@ static void write_received_packet(
             header[6] = LO_BYTE(mstp_port->DataLength);
             header[7] = mstp_port->HeaderCRCActual;
         }
-        (void) data_write(header, header_len, 1);
+        memcpy(packet, header, header_len);
         if (max_data) {
-            (void) data_write(mstp_port->InputBuffer, max_data, 1);
-            (void) data_write((char *) &mstp_port->DataCRCActualMSB, 1, 1);
-            (void) data_write((char *) &mstp_port->DataCRCActualLSB, 1, 1);
+            memcpy(&packet[header_len], mstp_port->InputBuffer, max_data);
+            packet[header_len + max_data] = mstp_port->DataCRCActualMSB;
+            packet[header_len + max_data + 1] = mstp_port->DataCRCActualLSB;
         }
     } else {
-        fprintf(stderr, "mstpcap[packet]: failed to open %s: %s\n",
-            Capture_Filename, strerror(errno));
+        fprintf(stderr, "mstpcap[packet]: failed to write %s\n",
+            Pcap_Writer_Filename());
     }
 }
 
-/* read header from file in libpcap format */
-static bool test_global_header(
-    const char *filename)
+/* validate one captured MS/TP frame in place and gather its statistics */
+static void scan_frame(
+    struct timeval *tv,
+    uint8_t * frame,
+    uint32_t frame_len)
 {
-    uint32_t magic_number = 0;  /* magic number */
-    uint16_t version_major = 0; /* major version number */
-    uint16_t version_minor = 0; /* minor version number */
-    int32_t thiszone = 0;       /* GMT to local correction */
-    uint32_t sigfigs = 0;       /* accuracy of timestamps */
-    uint32_t snaplen = 0;       /* max length of captured packets, in octets */
-    uint32_t network = 0;       /* data link type - BACNET_MS_TP */
-    size_t count = 0;
+    uint8_t header_crc = 0xFF;
+    uint16_t data_crc = 0xFFFF;
+    uint16_t data_len = 0;
+    uint32_t i;
 
-    /* open existing file. */
-    pFile = fopen(filename, "rb");
-    if (pFile) {
-        count = fread(&magic_number, sizeof(magic_number), 1, pFile);
-        if ((count != 1) || (magic_number != 0xa1b2c3d4)) {
-            fprintf(stderr, "mstpcap: invalid magic number\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&version_major, sizeof(version_major), 1, pFile);
-        if ((count != 1) || (version_major != 2)) {
-            fprintf(stderr, "mstpcap: invalid major version\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&version_minor, sizeof(version_minor), 1, pFile);
-        if ((count != 1) || (version_minor != 4)) {
-            fprintf(stderr, "mstpcap: invalid minor version\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&thiszone, sizeof(thiszone), 1, pFile);
-        if ((count != 1) || (thiszone != 0)) {
-            fprintf(stderr, "mstpcap: invalid time zone\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&sigfigs, sizeof(sigfigs), 1, pFile);
-        if ((count != 1) || (sigfigs != 0)) {
-            fprintf(stderr, "mstpcap: invalid time stamp accuracy\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&snaplen, sizeof(snaplen), 1, pFile);
-        if (count != 1) {
-            fprintf(stderr, "mstpcap: unable to read SNAP length\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
+    if ((frame_len < 8) || (frame[0] != 0x55) || (frame[1] != 0xFF)) {
+        /* preamble error or partial header */
+        Invalid_Frame_Count++;
+        MSTP_Stats_Invalid_Frame(&MSTP_Analysis, timeval_microseconds(tv),
+            frame_len);
+        return;
+    }
+    for (i = 2; i < 8; i++) {
+        header_crc = CRC_Calc_Header(frame[i], header_crc);
+    }
+    if (header_crc != 0x55) {
+        Invalid_Frame_Count++;
+        MSTP_Stats_Invalid_Frame(&MSTP_Analysis, timeval_microseconds(tv),
+            frame_len);
+        return;
+    }
+    if (frame_len > (8 + 2)) {
+        /* packet includes data */
+        data_len = frame_len - 8 - 2;
+        for (i = 8; i < frame_len; i++) {
+            data_crc = CRC_Calc_Data(frame[i], data_crc);
         }
-        count = fread(&network, sizeof(network), 1, pFile);
-        if ((count != 1) || (network != DLT_BACNET_MS_TP)) {
-            fprintf(stderr, "mstpcap: invalid data link type (DLT)\n");
-            fclose(pFile);
-            pFile = NULL;
-            return false;
+        if (data_crc != 0xF0B8) {
+            Invalid_Frame_Count++;
+            MSTP_Stats_Frame(&MSTP_Analysis, timeval_microseconds(tv),
+                frame[2], frame[4], frame[3], data_len, false);
+            return;
         }
-    } else {
-        fprintf(stderr, "mstpcap[scan]: failed to open %s: %s\n", filename,
-            strerror(errno));
-        return false;
     }
-
-    return true;
+    packet_statistics(tv, frame[2], frame[4], frame[3],
+        data_len ? &frame[8] : NULL, data_len);
 }
 
-static bool read_received_packet(
-    volatile struct mstp_port_struct_t *mstp_port)
+/* perform statistics on a capture file.  The file is mapped into memory
+   and the frames are analyzed in place, which keeps large captures
+   limited by the disk rather than by many small reads. */
+static bool scan_capture_file(
+    const char *filename,
+    uint32_t * packet_count)
 {
-    uint32_t ts_sec = 0;        /* timestamp seconds */
-    uint32_t ts_usec = 0;       /* timestamp microseconds */
-    uint32_t incl_len = 0;      /* number of octets of packet saved in file */
-    uint32_t orig_len = 0;      /* actual length of packet */
-    uint8_t header[8] = { 0 };  /* MS/TP header */
+    struct pcap_packet packet;
     struct timeval tv;
-    size_t count = 0;
-    unsigned i = 0;
+    uint32_t link_type = 0;
 
-    if (pFile) {
-        count = fread(&ts_sec, sizeof(ts_sec), 1, pFile);
-        if (count != 1) {
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&ts_usec, sizeof(ts_usec), 1, pFile);
-        if (count != 1) {
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        tv.tv_sec = ts_sec;
-        tv.tv_usec = ts_usec;
-        count = fread(&incl_len, sizeof(incl_len), 1, pFile);
-        if (count != 1) {
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&orig_len, sizeof(orig_len), 1, pFile);
-        if (count != 1) {
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        count = fread(&header, sizeof(header), 1, pFile);
-        if (count != 1) {
-            fclose(pFile);
-            pFile = NULL;
-            return false;
-        }
-        mstp_port->FrameType = header[2];
-        mstp_port->DestinationAddress = header[3];
-        mstp_port->SourceAddress = header[4];
-        mstp_port->DataLength = MAKE_WORD(header[6], header[5]);
-        mstp_port->HeaderCRCActual = header[7];
-        mstp_port->HeaderCRC = 0xFF;
-        for (i = 2; i < 8; i++) {
-            mstp_port->HeaderCRC =
-                CRC_Calc_Header(header[i], mstp_port->HeaderCRC);
-        }
-        if (mstp_port->HeaderCRC == 0x55) {
-            mstp_port->ReceivedValidFrame = true;
-            mstp_port->ReceivedInvalidFrame = false;
-            if (mstp_port->DataLength == 0) {
-                mstp_port->ReceivedValidFrame = true;
-                mstp_port->ReceivedValidFrameNotForUs = true;
-            }
-        } else {
-            mstp_port->ReceivedValidFrame = false;
-            mstp_port->ReceivedInvalidFrame = true;
-        }
-        if (orig_len > 8) {
-            /* packet includes data */
-            mstp_port->DataLength = orig_len - 8 - 2;
-            count =
-                fread(mstp_port->InputBuffer, mstp_port->DataLength, 1, pFile);
-            if (count != 1) {
-                fclose(pFile);
-                pFile = NULL;
-                return false;
-            }
-            count = fread((char *) &mstp_port->DataCRCActualMSB, 1, 1, pFile);
-            if (count != 1) {
-                fclose(pFile);
-                pFile = NULL;
-                return false;
-            }
-            count = fread((char *) &mstp_port->DataCRCActualLSB, 1, 1, pFile);
-            if (count != 1) {
-                fclose(pFile);
-                pFile = NULL;
-                return false;
-            }
-            mstp_port->DataCRC = 0xFFFF;
-            for (i = 0; i < mstp_port->DataLength; i++) {
-                mstp_port->DataCRC =
-                    CRC_Calc_Data(mstp_port->InputBuffer[i],
-                    mstp_port->DataCRC);
-            }
-            mstp_port->DataCRC =
-                CRC_Calc_Data(mstp_port->DataCRCActualMSB, mstp_port->DataCRC);
-            mstp_port->DataCRC =
-                CRC_Calc_Data(mstp_port->DataCRCActualLSB, mstp_port->DataCRC);
-            if (mstp_port->DataCRC == 0xF0B8) {
-                mstp_port->ReceivedInvalidFrame = false;
-                mstp_port->ReceivedValidFrame = true;
-                mstp_port->ReceivedValidFrameNotForUs = true;
-            } else {
-                mstp_port->ReceivedInvalidFrame = true;
-                mstp_port->ReceivedValidFrame = false;
-                mstp_port->ReceivedValidFrameNotForUs = false;
-            }
-        } else {
-            mstp_port->DataLength = 0;
-        }
-        if (mstp_port->ReceivedInvalidFrame) {
-            Invalid_Frame_Count++;
-        } else if ((mstp_port->ReceivedValidFrame) ||
-            (mstp_port->ReceivedValidFrameNotForUs)) {
-            packet_statistics(&tv, mstp_port);
-        }
-    } else {
+    if (!Pcap_Reader_Open(filename, &link_type)) {
+        fprintf(stderr, "mstpcap[scan]: failed to open %s\n", filename);
+        return false;
+    }
+    if (link_type != DLT_BACNET_MS_TP) {
+        fprintf(stderr, "mstpcap: invalid data link type (DLT)\n");
+        Pcap_Reader_Close();
         return false;
     }
+    while (Pcap_Reader_Next(&packet)) {
+        tv.tv_sec = packet.ts_sec;
+        tv.tv_usec = packet.ts_usec;
+        scan_frame(&tv, packet.data, packet.incl_len);
+        (*packet_count)++;
+        if (!(*packet_count % 10000)) {
+            fprintf(stderr, "\r%u packets", (unsigned) *packet_count);
+        }
+    }
+    Pcap_Reader_Close();
 
     return true;
 }
@@ -894,11 +731,7 @@ static void cleanup(
     if (!Wireshark_Capture) {
         packet_statistics_print();
     }
-    if (pFile) {
-        fflush(pFile);  /* stream pointer */
-        fclose(pFile);  /* stream pointer */
-    }
-    pFile = NULL;
+    Pcap_Writer_Close();
 }
 
 #if defined(_WIN32)
@@ -929,6 +762,7 @@ static void sig_int(
     (void) signo;
     if (FD_Pipe != -1) {
         close(FD_Pipe);
+        FD_Pipe = -1;
     }
     Exit_Requested = true;
     exit(0);
@@ -943,25 +777,15 @@ void signal_init(
 }
 #endif
 
-void filename_create_new(
-    void)
-{
-    if (pFile) {
-        fclose(pFile);
-    }
-    pFile = NULL;
-    filename_create(&Capture_Filename[0]);
-    write_global_header(&Capture_Filename[0]);
-}
-
 static void print_usage(
     char *filename)
 {
     printf("Usage: %s", filename);
-    printf(" [--scan <filename>]\n");
+    printf(" [--scan <filename>][--csv][--json]\n");
     printf(" [--extcap-interface port]\n");
     printf(" [--extcap-interfaces][--extcap-dlts][--extcap-config]\n");
     printf(" [--capture][--baud baud][--fifo pipe]\n");
+    printf(" [--max-packets count][--max-size kilobytes][--max-time seconds]\n");
     printf(" [--version][--help]\n");
 }
 
@@ -969,11 +793,16 @@ static void print_help(char *filename) {
     printf("%s --scan <filename>\n"
         "perform statistic analysis on MS/TP capture file.\n",
         filename);
+    printf("[--baud baud] - baud rate of the captured trunk, used\n"
+        "    for the bandwidth usage and latency figures.\n"
+        "[--csv] - emit the token-loop analysis as CSV.\n"
+        "[--json] - emit the token-loop analysis as JSON.\n");
     printf("\n");
     printf("Captures MS/TP packets from a serial interface\n"
         "and saves them to a file. Saves packets in a\n"
         "filename mstp_20090123091200.cap that has data and time.\n"
-        "After receiving 65535 packets, a new file is created.\n" "\n"
+        "After receiving 65535 packets, a new file is created.\n"
+        "Packets are written in large blocks at least once a second.\n" "\n"
         "Command line options:\n"
         "[--extcap-interface port] - serial interface.\n"
 #if defined(_WIN32)
@@ -990,7 +819,11 @@ static void print_help(char *filename) {
 #else
         "    Supported values: any file name\n"
 #endif
-        "    Use that name as the interface name in Wireshark.\n");
+        "    Use that name as the interface name in Wireshark.\n"
+        "[--max-packets count] - start a new file after this many packets.\n"
+        "    Defaults to 65535.  Use 0 for no limit.\n"
+        "[--max-size kilobytes] - start a new file at this size.\n"
+        "[--max-time seconds] - start a new file after this many seconds.\n");
     printf("\n");
     printf("%s [--extcap-interfaces][--extcap-dlts][--extcap-config]\n"
         "[--capture][--baud baud][--fifo pipe]\n"
@@ -1029,6 +862,11 @@ int main(
     uint32_t header_len = 0;
     int argi = 0;
     char *filename = NULL;
+    char *scan_filename = NULL;
+    char *pipe_name = NULL;
+    uint32_t max_packets = 65535;
+    uint32_t max_kilobytes = 0;
+    uint32_t max_seconds = 0;
 
     MSTP_Port.InputBuffer = &RxBuffer[0];
     MSTP_Port.InputBufferSize = sizeof(RxBuffer);
@@ -1065,22 +903,13 @@ int main(
                 printf("An file name must be provided.\n");
                 return 1;
             }
-            printf("Scanning %s\n", argv[argi]);
-            /* perform statistics on the file */
-            if (test_global_header(argv[argi])) {
-                while (read_received_packet(mstp_port)) {
-                    packet_count++;
-                    fprintf(stderr, "\r%u packets",
-                        (unsigned) packet_count);
-                }
-                if (packet_count) {
-                    packet_statistics_print();
-                }
-                Exit_Requested = true;
-            } else {
-                fprintf(stderr, "File header does not match.\n");
-                return 1;
-            }
+            scan_filename = argv[argi];
+        }
+        if (strcmp(argv[argi], "--csv") == 0) {
+            Report_Format = REPORT_FORMAT_CSV;
+        }
+        if (strcmp(argv[argi], "--json") == 0) {
+            Report_Format = REPORT_FORMAT_JSON;
         }
         if (strcmp(argv[argi], "--extcap-interfaces") == 0) {
             RS485_Print_Ports();
@@ -1158,7 +987,49 @@ int main(
                 printf("A named pipe must be provided.\n");
                 return 0;
             }
-            named_pipe_create(argv[argi]);
+            pipe_name = argv[argi];
+            named_pipe_create(pipe_name);
+        }
+        if (strcmp(argv[argi], "--max-packets") == 0) {
+            argi++;
+            if (argi >= argc) {
+                printf("A packet count must be provided.\n");
+                return 0;
+            }
+            max_packets = strtoul(argv[argi], NULL, 0);
+        }
+        if (strcmp(argv[argi], "--max-size") == 0) {
+            argi++;
+            if (argi >= argc) {
+                printf("A file size must be provided.\n");
+                return 0;
+            }
+            max_kilobytes = strtoul(argv[argi], NULL, 0);
+        }
+        if (strcmp(argv[argi], "--max-time") == 0) {
+            argi++;
+            if (argi >= argc) {
+                printf("A number of seconds must be provided.\n");
+                return 0;
+            }
+            max_seconds = strtoul(argv[argi], NULL, 0);
+        }
+    }
+    if (scan_filename) {
+        if (Report_Format == REPORT_FORMAT_TEXT) {
+            printf("Scanning %s\n", scan_filename);
+        }
+        /* perform statistics on the file */
+        packet_statistics_clear();
+        if (scan_capture_file(scan_filename, &packet_count)) {
+            fprintf(stderr, "\r%u packets\n", (unsigned) packet_count);
+            if (packet_count) {
+                packet_statistics_print();
+            }
+            return 0;
+        } else {
+            fprintf(stderr, "File header does not match.\n");
+            return 1;
         }
     }
     if (Exit_Requested) {
@@ -1181,7 +1052,26 @@ int main(
 #else
     signal_init();
 #endif
-    filename_create_new();
+    Pcap_Writer_Init("mstp", DLT_BACNET_MS_TP);
+    if (Wireshark_Capture) {
+        /* one continuous stream for Wireshark */
+        Pcap_Writer_Rotate_Set(0, 0, 0);
+    } else {
+        Pcap_Writer_Rotate_Set(max_packets, max_kilobytes, max_seconds);
+    }
+    Pcap_Writer_Rotate_Callback_Set(capture_file_rotated);
+    Pcap_Writer_Mirror_Set(named_pipe_write);
+    if (pipe_name) {
+        /* keep the live view responsive */
+        Pcap_Writer_Flush_Interval_Set(100);
+    }
+    if (!Pcap_Writer_Open()) {
+        return 1;
+    }
+    if (!Wireshark_Capture) {
+        fprintf(stdout, "mstpcap: saving capture to %s\n",
+            Pcap_Writer_Filename());
+    }
     /* run forever */
     for (;;) {
         RS485_Check_UART_Data(mstp_port);
@@ -1190,11 +1080,11 @@ int main(
         if (mstp_port->ReceivedValidFrame) {
             write_received_packet(mstp_port, MSTP_HEADER_MAX);
             mstp_structure_init(mstp_port);
-            packet_count++;
+            Packet_Count++;
         } else if (mstp_port->ReceivedValidFrameNotForUs) {
             write_received_packet(mstp_port, MSTP_HEADER_MAX);
             mstp_structure_init(mstp_port);
-            packet_count++;
+            Packet_Count++;
         } else if (mstp_port->ReceivedInvalidFrame) {
             if (MSTP_Receive_State == MSTP_RECEIVE_STATE_HEADER) {
                 mstp_port->Index = 0;
@@ -1202,7 +1092,7 @@ int main(
             write_received_packet(mstp_port, MSTP_HEADER_MAX);
             mstp_structure_init(mstp_port);
             Invalid_Frame_Count++;
-            packet_count++;
+            Packet_Count++;
         } else if (mstp_port->receive_state == MSTP_RECEIVE_STATE_IDLE) {
             if (MSTP_Receive_State == MSTP_RECEIVE_STATE_IDLE) {
                 if (mstp_port->EventCount) {
@@ -1227,17 +1117,13 @@ int main(
             }
         }
         if (!Wireshark_Capture) {
-            if (!(packet_count % 100)) {
-                fprintf(stdout, "\r%hu packets, %hu invalid frames", packet_count,
-                    Invalid_Frame_Count);
-            }
-            if (packet_count >= 65535) {
-                packet_statistics_print();
-                packet_statistics_clear();
-                filename_create_new();
-                packet_count = 0;
+            if (!(Packet_Count % 100)) {
+                fprintf(stdout, "\r%lu packets, %lu invalid frames",
+                    (unsigned long) Packet_Count,
+                    (unsigned long) Invalid_Frame_Count);
             }
         }
+        Pcap_Writer_Poll();
         if (Exit_Requested) {
             break;
         }
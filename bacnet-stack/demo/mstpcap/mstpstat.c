@@ -0,0 +1,511 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "mstpdef.h"
+#include "mstpstat.h"
+
+/** @file mstpstat.c  MS/TP token-loop analysis for the capture tool */
+
+/* upper edge of each histogram bucket, in microseconds */
+static const uint32_t Histogram_Edge[MSTP_STATS_HISTOGRAM_BINS] = {
+    250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000,
+    500000, 1000000, 5000000, UINT32_MAX
+};
+
+/* MS/TP header: preamble, frame type, destination, source,
+   length and header CRC */
+#define MSTP_FRAME_HEADER_OCTETS 8
+/* data CRC */
+#define MSTP_FRAME_CRC_OCTETS 2
+
+static void histogram_add(
+    struct mstp_stats_histogram *histogram,
+    uint32_t value)
+{
+    unsigned i;
+
+    for (i = 0; i < MSTP_STATS_HISTOGRAM_BINS; i++) {
+        if (value <= Histogram_Edge[i]) {
+            histogram->bin[i]++;
+            break;
+        }
+    }
+    if ((histogram->count == 0) || (value < histogram->min)) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->sum += value;
+    histogram->count++;
+}
+
+/* returns the average of the histogram samples in microseconds */
+uint32_t MSTP_Stats_Histogram_Average(
+    struct mstp_stats_histogram *histogram)
+{
+    if (histogram->count) {
+        return (uint32_t) (histogram->sum / histogram->count);
+    }
+
+    return 0;
+}
+
+/* returns the upper edge of the bucket holding the given percentile,
+   limited to the largest sample seen, in microseconds */
+uint32_t MSTP_Stats_Histogram_Percentile(
+    struct mstp_stats_histogram *histogram,
+    unsigned percent)
+{
+    uint64_t target;
+    uint64_t total = 0;
+    unsigned i;
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+    target = ((uint64_t) histogram->count * percent + 99) / 100;
+    for (i = 0; i < MSTP_STATS_HISTOGRAM_BINS; i++) {
+        total += histogram->bin[i];
+        if (total >= target) {
+            if (Histogram_Edge[i] < histogram->max) {
+                return Histogram_Edge[i];
+            }
+            break;
+        }
+    }
+
+    return histogram->max;
+}
+
+/* returns the time on the wire for a number of octets, in microseconds */
+uint32_t MSTP_Stats_Frame_Time(
+    struct mstp_stats *stats,
+    uint32_t octets)
+{
+    /* start bit, 8 data bits, stop bit */
+    if (stats->baud) {
+        return (uint32_t) (((uint64_t) octets * 10UL * 1000000UL) /
+            stats->baud);
+    }
+
+    return 0;
+}
+
+void MSTP_Stats_Init(
+    struct mstp_stats *stats,
+    uint32_t baud)
+{
+    memset(stats, 0, sizeof(struct mstp_stats));
+    stats->baud = baud;
+}
+
+static uint64_t time_difference(
+    uint64_t start,
+    uint64_t end)
+{
+    if (end > start) {
+        return end - start;
+    }
+
+    return 0;
+}
+
+static void capture_time_update(
+    struct mstp_stats *stats,
+    uint64_t timestamp)
+{
+    if (stats->frames == 0) {
+        stats->first_time = timestamp;
+    }
+    if (timestamp > stats->last_time) {
+        stats->last_time = timestamp;
+    }
+}
+
+/* feed one frame with a valid header into the analysis.
+   timestamp is the capture time of the end of the frame in microseconds. */
+void MSTP_Stats_Frame(
+    struct mstp_stats *stats,
+    uint64_t timestamp,
+    uint8_t frame_type,
+    uint8_t src,
+    uint8_t dst,
+    uint16_t data_len,
+    bool data_crc_ok)
+{
+    struct mstp_stats_node *node = &stats->node[src];
+    uint32_t octets = MSTP_FRAME_HEADER_OCTETS;
+    uint64_t start;
+    uint64_t delay;
+
+    if (data_len) {
+        octets += data_len + MSTP_FRAME_CRC_OCTETS;
+    }
+    capture_time_update(stats, timestamp);
+    start = timestamp - MSTP_Stats_Frame_Time(stats, octets);
+    if (start > timestamp) {
+        start = 0;
+    }
+    stats->frames++;
+    stats->octets += octets;
+    node->frames++;
+    node->octets += octets;
+    if (stats->prior_valid) {
+        delay = time_difference(stats->prior_time, start);
+        if (stats->prior_frame_type == FRAME_TYPE_POLL_FOR_MASTER) {
+            /* silence after a poll-for-master is part of the poll cost */
+            stats->node[stats->prior_src].pfm_time += delay;
+            stats->pfm_time += delay;
+        }
+        if ((stats->prior_frame_type == FRAME_TYPE_TOKEN) &&
+            (stats->prior_dst == src) && (stats->prior_src != src)) {
+            histogram_add(&node->token_reply, (uint32_t) delay);
+        } else if ((stats->prior_frame_type ==
+                FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) &&
+            (stats->prior_dst == src) &&
+            ((frame_type == FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY) ||
+                (frame_type == FRAME_TYPE_REPLY_POSTPONED))) {
+            histogram_add(&node->der_reply, (uint32_t) delay);
+        }
+    }
+    if (!data_crc_ok) {
+        node->crc_errors++;
+        stats->invalid_frames++;
+    } else {
+        switch (frame_type) {
+            case FRAME_TYPE_TOKEN:
+                if ((stats->prior_valid) &&
+                    (stats->prior_frame_type == FRAME_TYPE_TOKEN) &&
+                    (stats->prior_src == src) && (stats->prior_dst == dst)) {
+                    /* token retry - rotation is counted from the first */
+                    break;
+                }
+                if (node->last_token_time) {
+                    delay = time_difference(node->last_token_time, timestamp);
+                    histogram_add(&node->token_rotation, (uint32_t) delay);
+                    histogram_add(&stats->token_rotation, (uint32_t) delay);
+                }
+                node->last_token_time = timestamp;
+                break;
+            case FRAME_TYPE_POLL_FOR_MASTER:
+                node->pfm_frames++;
+                node->pfm_time += MSTP_Stats_Frame_Time(stats, octets);
+                stats->pfm_time += MSTP_Stats_Frame_Time(stats, octets);
+                break;
+            case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
+            case FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY:
+                node->data_frames++;
+                node->payload_octets += data_len;
+                stats->payload_octets += data_len;
+                break;
+            default:
+                break;
+        }
+    }
+    stats->prior_time = timestamp;
+    stats->prior_frame_type = frame_type;
+    stats->prior_src = src;
+    stats->prior_dst = dst;
+    stats->prior_valid = true;
+}
+
+/* feed a frame with a broken header or a framing error into the analysis */
+void MSTP_Stats_Invalid_Frame(
+    struct mstp_stats *stats,
+    uint64_t timestamp,
+    uint32_t octets)
+{
+    capture_time_update(stats, timestamp);
+    stats->frames++;
+    stats->invalid_frames++;
+    stats->octets += octets;
+    /* latency measurements across a broken frame are meaningless */
+    stats->prior_valid = false;
+}
+
+static uint64_t capture_duration(
+    struct mstp_stats *stats)
+{
+    return time_difference(stats->first_time, stats->last_time);
+}
+
+/* returns the share of the capture duration as a percentage */
+static double capture_percent(
+    struct mstp_stats *stats,
+    uint64_t microseconds)
+{
+    uint64_t duration = capture_duration(stats);
+
+    if (duration) {
+        return ((double) microseconds * 100.0) / (double) duration;
+    }
+
+    return 0.0;
+}
+
+static double octets_percent(
+    struct mstp_stats *stats,
+    uint64_t octets)
+{
+    uint64_t microseconds;
+
+    if (stats->baud == 0) {
+        return 0.0;
+    }
+    microseconds = (octets * 10UL * 1000000UL) / stats->baud;
+
+    return capture_percent(stats, microseconds);
+}
+
+static double error_percent(
+    uint32_t errors,
+    uint32_t frames)
+{
+    if (frames) {
+        return ((double) errors * 100.0) / (double) frames;
+    }
+
+    return 0.0;
+}
+
+static bool node_active(
+    struct mstp_stats_node *node)
+{
+    return (node->frames > 0);
+}
+
+static double milliseconds(
+    uint32_t microseconds)
+{
+    return (double) microseconds / 1000.0;
+}
+
+void MSTP_Stats_Print_Text(
+    struct mstp_stats *stats,
+    FILE * stream)
+{
+    struct mstp_stats_node *node;
+    unsigned i;
+
+    fprintf(stream, "\n");
+    fprintf(stream, "==== MS/TP Token Loop Analysis ====\n");
+    fprintf(stream, "Frames: %lu  Invalid: %lu (%.2f%%)  Duration: %.3fs"
+        "  Baud: %lu\n", (unsigned long) stats->frames,
+        (unsigned long) stats->invalid_frames,
+        error_percent(stats->invalid_frames, stats->frames),
+        (double) capture_duration(stats) / 1000000.0,
+        (unsigned long) stats->baud);
+    fprintf(stream, "Bus Usage: %.1f%%  Payload: %.1f%%  PFM Overhead: %.1f%%\n",
+        octets_percent(stats, stats->octets),
+        octets_percent(stats, stats->payload_octets),
+        capture_percent(stats, stats->pfm_time));
+    fprintf(stream, "Token Rotation (ms): count %lu  avg %.2f  p50 %.2f"
+        "  p90 %.2f  p99 %.2f  max %.2f\n",
+        (unsigned long) stats->token_rotation.count,
+        milliseconds(MSTP_Stats_Histogram_Average(&stats->token_rotation)),
+        milliseconds(MSTP_Stats_Histogram_Percentile(&stats->token_rotation,
+                50)),
+        milliseconds(MSTP_Stats_Histogram_Percentile(&stats->token_rotation,
+                90)),
+        milliseconds(MSTP_Stats_Histogram_Percentile(&stats->token_rotation,
+                99)), milliseconds(stats->token_rotation.max));
+    fprintf(stream, "%-6s%-9s%-8s%-8s%-8s%-8s%-8s%-8s%-8s%-8s%-8s%-7s\n",
+        "MAC", "Frames", "Errors", "Usage%", "Data%", "PFM%", "Trot", "Trotmx",
+        "Treply", "Trplmx", "Tder", "Tdermx");
+    for (i = 0; i < MSTP_STATS_NODES; i++) {
+        node = &stats->node[i];
+        if (!node_active(node)) {
+            continue;
+        }
+        fprintf(stream, "%-6u%-9lu%-8lu%-8.1f%-8.1f%-8.1f", i,
+            (unsigned long) node->frames, (unsigned long) node->crc_errors,
+            octets_percent(stats, node->octets),
+            octets_percent(stats, node->payload_octets),
+            capture_percent(stats, node->pfm_time));
+        fprintf(stream, "%-8.1f%-8.1f%-8.2f%-8.2f%-8.1f%-7.1f\n",
+            milliseconds(MSTP_Stats_Histogram_Average(&node->token_rotation)),
+            milliseconds(node->token_rotation.max),
+            milliseconds(MSTP_Stats_Histogram_Average(&node->token_reply)),
+            milliseconds(node->token_reply.max),
+            milliseconds(MSTP_Stats_Histogram_Average(&node->der_reply)),
+            milliseconds(node->der_reply.max));
+    }
+}
+
+static void print_csv_row(
+    struct mstp_stats *stats,
+    FILE * stream,
+    const char *mac,
+    struct mstp_stats_node *node)
+{
+    fprintf(stream, "%s,%lu,%lu,%lu,%lu,%llu,%llu,%.3f,%.3f,%.3f,", mac,
+        (unsigned long) node->frames, (unsigned long) node->data_frames,
+        (unsigned long) node->pfm_frames, (unsigned long) node->crc_errors,
+        (unsigned long long) node->octets,
+        (unsigned long long) node->payload_octets,
+        octets_percent(stats, node->octets),
+        octets_percent(stats, node->payload_octets),
+        capture_percent(stats, node->pfm_time));
+    fprintf(stream, "%lu,%lu,%lu,%lu,",
+        (unsigned long) node->token_rotation.count,
+        (unsigned long) MSTP_Stats_Histogram_Average(&node->token_rotation),
+        (unsigned long) MSTP_Stats_Histogram_Percentile(&node->token_rotation,
+            90), (unsigned long) node->token_rotation.max);
+    fprintf(stream, "%lu,%lu,%lu,%lu,%lu,%lu\n",
+        (unsigned long) node->token_reply.count,
+        (unsigned long) MSTP_Stats_Histogram_Average(&node->token_reply),
+        (unsigned long) node->token_reply.max,
+        (unsigned long) node->der_reply.count,
+        (unsigned long) MSTP_Stats_Histogram_Average(&node->der_reply),
+        (unsigned long) node->der_reply.max);
+}
+
+/* one row per node, then a summary row with MAC "all".
+   Times are in microseconds, usage columns are percent of the capture. */
+void MSTP_Stats_Print_CSV(
+    struct mstp_stats *stats,
+    FILE * stream)
+{
+    struct mstp_stats_node total;
+    struct mstp_stats_node *node;
+    char mac[8];
+    unsigned i;
+
+    fprintf(stream, "mac,frames,data_frames,pfm_frames,errors,octets,"
+        "payload_octets,usage_percent,payload_percent,pfm_percent,"
+        "rotation_count,rotation_avg_us,rotation_p90_us,rotation_max_us,"
+        "treply_count,treply_avg_us,treply_max_us,"
+        "tder_count,tder_avg_us,tder_max_us\n");
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < MSTP_STATS_NODES; i++) {
+        node = &stats->node[i];
+        if (!node_active(node)) {
+            continue;
+        }
+        sprintf(mac, "%u", i);
+        print_csv_row(stats, stream, mac, node);
+        total.data_frames += node->data_frames;
+        total.pfm_frames += node->pfm_frames;
+    }
+    total.frames = stats->frames;
+    total.crc_errors = stats->invalid_frames;
+    total.octets = stats->octets;
+    total.payload_octets = stats->payload_octets;
+    total.pfm_time = stats->pfm_time;
+    total.token_rotation = stats->token_rotation;
+    print_csv_row(stats, stream, "all", &total);
+}
+
+static void print_json_histogram(
+    FILE * stream,
+    const char *name,
+    struct mstp_stats_histogram *histogram,
+    bool buckets)
+{
+    unsigned i;
+
+    fprintf(stream, "\"%s\":{\"count\":%lu,\"min\":%lu,\"avg\":%lu,"
+        "\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu", name,
+        (unsigned long) histogram->count, (unsigned long) histogram->min,
+        (unsigned long) MSTP_Stats_Histogram_Average(histogram),
+        (unsigned long) MSTP_Stats_Histogram_Percentile(histogram, 50),
+        (unsigned long) MSTP_Stats_Histogram_Percentile(histogram, 90),
+        (unsigned long) MSTP_Stats_Histogram_Percentile(histogram, 99),
+        (unsigned long) histogram->max);
+    if (buckets) {
+        fprintf(stream, ",\"buckets\":[");
+        for (i = 0; i < MSTP_STATS_HISTOGRAM_BINS; i++) {
+            if (Histogram_Edge[i] == UINT32_MAX) {
+                fprintf(stream, "%s{\"le\":null,\"count\":%lu}",
+                    i ? "," : "", (unsigned long) histogram->bin[i]);
+            } else {
+                fprintf(stream, "%s{\"le\":%lu,\"count\":%lu}", i ? "," : "",
+                    (unsigned long) Histogram_Edge[i],
+                    (unsigned long) histogram->bin[i]);
+            }
+        }
+        fprintf(stream, "]");
+    }
+    fprintf(stream, "}");
+}
+
+/* times are in microseconds, usage values are percent of the capture */
+void MSTP_Stats_Print_JSON(
+    struct mstp_stats *stats,
+    FILE * stream)
+{
+    struct mstp_stats_node *node;
+    bool first = true;
+    unsigned i;
+
+    fprintf(stream, "{\"baud\":%lu,\"duration_us\":%llu,\"frames\":%lu,"
+        "\"invalid_frames\":%lu,\"error_percent\":%.3f,\"octets\":%llu,"
+        "\"payload_octets\":%llu,\"usage_percent\":%.3f,"
+        "\"payload_percent\":%.3f,\"pfm_percent\":%.3f,",
+        (unsigned long) stats->baud,
+        (unsigned long long) capture_duration(stats),
+        (unsigned long) stats->frames, (unsigned long) stats->invalid_frames,
+        error_percent(stats->invalid_frames, stats->frames),
+        (unsigned long long) stats->octets,
+        (unsigned long long) stats->payload_octets,
+        octets_percent(stats, stats->octets),
+        octets_percent(stats, stats->payload_octets),
+        capture_percent(stats, stats->pfm_time));
+    print_json_histogram(stream, "token_rotation", &stats->token_rotation,
+        true);
+    fprintf(stream, ",\"nodes\":[");
+    for (i = 0; i < MSTP_STATS_NODES; i++) {
+        node = &stats->node[i];
+        if (!node_active(node)) {
+            continue;
+        }
+        fprintf(stream, "%s\n{\"mac\":%u,\"frames\":%lu,\"data_frames\":%lu,"
+            "\"pfm_frames\":%lu,\"errors\":%lu,\"octets\":%llu,"
+            "\"payload_octets\":%llu,\"usage_percent\":%.3f,"
+            "\"payload_percent\":%.3f,\"pfm_percent\":%.3f,",
+            first ? "" : ",", i, (unsigned long) node->frames,
+            (unsigned long) node->data_frames,
+            (unsigned long) node->pfm_frames,
+            (unsigned long) node->crc_errors,
+            (unsigned long long) node->octets,
+            (unsigned long long) node->payload_octets,
+            octets_percent(stats, node->octets),
+            octets_percent(stats, node->payload_octets),
+            capture_percent(stats, node->pfm_time));
+        print_json_histogram(stream, "token_rotation", &node->token_rotation,
+            false);
+        fprintf(stream, ",");
+        print_json_histogram(stream, "treply", &node->token_reply, false);
+        fprintf(stream, ",");
+        print_json_histogram(stream, "tder", &node->der_reply, false);
+        fprintf(stream, "}");
+        first = false;
+    }
+    fprintf(stream, "]}\n");
+}
@@ -0,0 +1,131 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+#ifndef MSTPSTAT_H
+#define MSTPSTAT_H
+
+/* Functional Description: MS/TP token-loop analysis for the capture tool.
+   Frames are fed one at a time with their capture timestamp, so a capture
+   of any size is analyzed in a single pass using a fixed amount of memory.
+   Timestamps are the end-of-frame times recorded in the pcap file. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* number of buckets in a latency histogram - see mstpstat.c for edges */
+#define MSTP_STATS_HISTOGRAM_BINS 14
+/* one entry per possible MS/TP MAC address */
+#define MSTP_STATS_NODES 256
+
+struct mstp_stats_histogram {
+    uint32_t bin[MSTP_STATS_HISTOGRAM_BINS];
+    uint32_t count;
+    /* microseconds */
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+};
+
+struct mstp_stats_node {
+    /* time between two tokens sent by this node */
+    struct mstp_stats_histogram token_rotation;
+    /* Treply: token received until first octet sent by this node */
+    struct mstp_stats_histogram token_reply;
+    /* DataExpectingReply received until first octet of the reply */
+    struct mstp_stats_histogram der_reply;
+    /* frames and octets sent by this node */
+    uint32_t frames;
+    uint32_t data_frames;
+    uint32_t pfm_frames;
+    /* frames from this node with a good header but bad data CRC */
+    uint32_t crc_errors;
+    uint64_t octets;
+    uint64_t payload_octets;
+    /* bus time used by poll-for-master frames and the silence after them */
+    uint64_t pfm_time;
+    /* microsecond timestamp of the last token sent, zero if none */
+    uint64_t last_token_time;
+};
+
+struct mstp_stats {
+    uint32_t baud;
+    struct mstp_stats_node node[MSTP_STATS_NODES];
+    /* token rotation samples of all the nodes */
+    struct mstp_stats_histogram token_rotation;
+    uint64_t first_time;
+    uint64_t last_time;
+    uint32_t frames;
+    uint32_t invalid_frames;
+    uint64_t octets;
+    uint64_t payload_octets;
+    uint64_t pfm_time;
+    /* state of the previous frame for the latency calculations */
+    uint64_t prior_time;
+    uint8_t prior_frame_type;
+    uint8_t prior_src;
+    uint8_t prior_dst;
+    bool prior_valid;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void MSTP_Stats_Init(
+        struct mstp_stats *stats,
+        uint32_t baud);
+    uint32_t MSTP_Stats_Frame_Time(
+        struct mstp_stats *stats,
+        uint32_t octets);
+    void MSTP_Stats_Frame(
+        struct mstp_stats *stats,
+        uint64_t timestamp,
+        uint8_t frame_type,
+        uint8_t src,
+        uint8_t dst,
+        uint16_t data_len,
+        bool data_crc_ok);
+    void MSTP_Stats_Invalid_Frame(
+        struct mstp_stats *stats,
+        uint64_t timestamp,
+        uint32_t octets);
+    uint32_t MSTP_Stats_Histogram_Average(
+        struct mstp_stats_histogram *histogram);
+    uint32_t MSTP_Stats_Histogram_Percentile(
+        struct mstp_stats_histogram *histogram,
+        unsigned percent);
+    void MSTP_Stats_Print_Text(
+        struct mstp_stats *stats,
+        FILE * stream);
+    void MSTP_Stats_Print_CSV(
+        struct mstp_stats *stats,
+        FILE * stream);
+    void MSTP_Stats_Print_JSON(
+        struct mstp_stats *stats,
+        FILE * stream);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,1124 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+/* MS/TP load and replay harness.  A virtual RS-485 trunk is built from
+   pseudo-terminals: every simulated node runs the real MS/TP state
+   machines (src/mstp.c through ports/linux/dlmstp_linux.c) on the slave
+   side of its own pty, and the bus thread copies the octets written by
+   one node to all of the others at the wire speed of the trunk.  The bus
+   thread also decodes every frame for the token-loop analysis that
+   mstpcap uses, so runs can be compared with captures from real trunks. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+/* local includes */
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacdcode.h"
+#include "npdu.h"
+#include "crc.h"
+#include "mstp.h"
+#include "mstpdef.h"
+#include "dlmstp_linux.h"
+#include "version.h"
+/* token-loop analysis */
+#include "mstpstat.h"
+/* capture file I/O */
+#include "pcapfile.h"
+
+/* largest number of simulated nodes on the trunk */
+#ifndef MSTPSIM_NODES_MAX
+#define MSTPSIM_NODES_MAX 128
+#endif
+/* slave nodes use MAC addresses above the master range */
+#define MSTPSIM_SLAVE_MAC_FIRST 128
+
+struct sim_node {
+    /* the MS/TP port and its data link layer */
+    struct mstp_port_struct_t mstp_port;
+    SHARED_MSTP_DATA shared;
+    /* bus side of the pseudo-terminal, and the node side name */
+    int bus_fd;
+    char tty_name[64];
+    bool master;
+    bool generator;
+    pthread_t thread;
+    /* frame assembly for the bus monitor */
+    uint8_t frame[MAX_MPDU];
+    uint16_t frame_len;
+    /* traffic generator */
+    unsigned seed;
+    uint8_t invoke_id;
+    uint64_t next_send_time;
+    uint64_t request_time[256];
+    /* application layer counters */
+    uint32_t requests_sent;
+    uint32_t unconfirmed_sent;
+    uint32_t queue_full;
+    uint32_t requests_received;
+    uint32_t replies_received;
+    uint32_t pdus_received;
+    uint64_t octets_received;
+    uint64_t reply_latency_sum;
+    uint32_t reply_latency_max;
+};
+
+/* totals from the bus monitor */
+struct sim_bus {
+    uint64_t start_time;
+    uint64_t prior_time;
+    uint8_t prior_frame_type;
+    uint8_t prior_src;
+    uint8_t prior_dst;
+    bool prior_valid;
+    uint32_t token_retries;
+    uint32_t lost_tokens;
+    uint32_t der_no_reply;
+    uint32_t reply_postponed;
+    uint32_t collisions;
+    uint32_t replayed_frames;
+    uint64_t overrun_octets;
+};
+
+enum sim_report_format {
+    SIM_REPORT_TEXT,
+    SIM_REPORT_CSV,
+    SIM_REPORT_JSON
+};
+
+static struct sim_node Sim_Node[MSTPSIM_NODES_MAX];
+static unsigned Sim_Node_Count;
+/* frame assembly for the frames replayed from a capture file */
+static struct sim_node Replay_Monitor;
+static struct sim_bus Sim_Bus;
+static struct mstp_stats Sim_Analysis;
+static volatile bool Sim_Running = true;
+/* trunk configuration */
+static uint32_t Sim_Baud = 38400;
+static uint8_t Sim_Max_Master = DEFAULT_MAX_MASTER;
+static uint8_t Sim_Max_Info_Frames = DEFAULT_MAX_INFO_FRAMES;
+static uint8_t Sim_Adaptive;
+/* traffic mix */
+static unsigned Sim_Confirmed_Percent = 50;
+static unsigned Sim_APDU_Size = 50;
+static uint32_t Sim_Rate;
+static unsigned Sim_Queue_Depth = 1;
+/* replay */
+static char *Replay_Filename;
+static double Replay_Speed = 1.0;
+static uint8_t Replay_MAC;
+/* pass or fail limits for regression runs */
+static double Limit_Min_Throughput;
+static long Limit_Max_Lost_Tokens = -1;
+static bool Sim_Capture;
+static enum sim_report_format Report_Format = SIM_REPORT_TEXT;
+
+static uint64_t clock_microseconds(
+    void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000ULL) + (now.tv_nsec / 1000);
+}
+
+static void sleep_microseconds(
+    uint64_t microseconds)
+{
+    struct timespec delay;
+
+    delay.tv_sec = microseconds / 1000000ULL;
+    delay.tv_nsec = (microseconds % 1000000ULL) * 1000;
+    while ((nanosleep(&delay, &delay) == -1) && (errno == EINTR)) {
+        /* finish the sleep */
+    }
+}
+
+static void sig_int(
+    int signo)
+{
+    (void) signo;
+    Sim_Running = false;
+}
+
+/****************************************************************************
+* DESCRIPTION: Creates a pseudo-terminal pair for one node
+* RETURN:      true if the pair was created
+* NOTES:       the bus keeps the master side, the node opens the slave side
+*****************************************************************************/
+static bool sim_pty_open(
+    struct sim_node *node)
+{
+    unsigned int pty_number = 0;
+    int unlock = 0;
+    int fd;
+
+    fd = open("/dev/ptmx", O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return false;
+    }
+    if ((ioctl(fd, TIOCSPTLCK, &unlock) != 0) ||
+        (ioctl(fd, TIOCGPTN, &pty_number) != 0)) {
+        close(fd);
+        return false;
+    }
+    snprintf(node->tty_name, sizeof(node->tty_name), "/dev/pts/%u",
+        pty_number);
+    /* a node that stops reading must not stall the whole trunk */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    node->bus_fd = fd;
+
+    return true;
+}
+
+/****************************************************************************
+* DESCRIPTION: Starts the MS/TP data link of one node on its pty
+* RETURN:      true if the node was started
+* NOTES:       dlmstp_init() announces itself on stdout, which would spoil
+*              CSV or JSON output, so stdout is muted around it.
+*****************************************************************************/
+static bool sim_node_start(
+    struct sim_node *node,
+    uint8_t mac,
+    bool master)
+{
+    int saved_stdout;
+    int null_fd;
+    bool status;
+
+    if (!sim_pty_open(node)) {
+        return false;
+    }
+    node->master = master;
+    node->shared.Treply_timeout = 260;
+    node->shared.Tusage_timeout = 50;
+    node->shared.RS485_Handle = -1;
+    node->shared.RS485MOD = CS8;
+    node->mstp_port.UserData = &node->shared;
+    dlmstp_set_baud_rate(&node->mstp_port, Sim_Baud ? Sim_Baud : 38400);
+    node->mstp_port.Nmax_master = Sim_Max_Master;
+    node->mstp_port.Nmax_info_frames = Sim_Max_Info_Frames;
+    /* slaves are outside the range accepted by dlmstp_set_mac_address */
+    node->mstp_port.This_Station = mac;
+    if (master && (mac > Sim_Max_Master)) {
+        node->mstp_port.Nmax_master = mac;
+    }
+    if (master) {
+        dlmstp_set_adaptive(&node->mstp_port, Sim_Adaptive);
+    }
+    node->seed = mac + 1;
+    /* peers must not share invoke IDs, or a queued request of the peer
+       could pass for the reply to a request from the same peer */
+    node->invoke_id = (uint8_t) rand_r(&node->seed);
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    if ((saved_stdout >= 0) && (null_fd >= 0)) {
+        dup2(null_fd, STDOUT_FILENO);
+    }
+    status = dlmstp_init(&node->mstp_port, node->tty_name);
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    if (null_fd >= 0) {
+        close(null_fd);
+    }
+
+    return status;
+}
+
+/* NPDU and APDU header of the generated requests and replies */
+static int sim_encode_header(
+    uint8_t * pdu,
+    bool data_expecting_reply)
+{
+    BACNET_NPDU_DATA npdu_data;
+
+    npdu_encode_npdu_data(&npdu_data, data_expecting_reply,
+        MESSAGE_PRIORITY_NORMAL);
+
+    return npdu_encode_pdu(&pdu[0], NULL, NULL, &npdu_data);
+}
+
+/* queue one request from a master to a random peer */
+static void sim_node_send_request(
+    struct sim_node *node)
+{
+    struct sim_node *peer;
+    BACNET_ADDRESS dest;
+    uint8_t pdu[MAX_MPDU];
+    bool confirmed;
+    int len;
+    unsigned i;
+
+    if (Sim_Node_Count < 2) {
+        return;
+    }
+    do {
+        i = rand_r(&node->seed) % Sim_Node_Count;
+        peer = &Sim_Node[i];
+    } while (peer == node);
+    confirmed = ((unsigned) (rand_r(&node->seed) % 100)) <
+        Sim_Confirmed_Percent;
+    len = sim_encode_header(pdu, confirmed);
+    if (confirmed) {
+        node->invoke_id++;
+        pdu[len++] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+        pdu[len++] = encode_max_segs_max_apdu(0, MAX_APDU);
+        pdu[len++] = node->invoke_id;
+        pdu[len++] = SERVICE_CONFIRMED_PRIVATE_TRANSFER;
+    } else {
+        pdu[len++] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+        pdu[len++] = SERVICE_UNCONFIRMED_PRIVATE_TRANSFER;
+    }
+    /* the service parameters are filler - only the size matters */
+    while ((len < (int) (Sim_APDU_Size + 2)) && (len < MAX_PDU)) {
+        pdu[len] = (uint8_t) len;
+        len++;
+    }
+    dlmstp_fill_bacnet_address(&dest, peer->mstp_port.This_Station);
+    if (dlmstp_send_pdu(&node->mstp_port, &dest, pdu, len) > 0) {
+        if (confirmed) {
+            node->request_time[node->invoke_id] = clock_microseconds();
+            node->requests_sent++;
+        } else {
+            node->unconfirmed_sent++;
+        }
+    } else {
+        node->queue_full++;
+    }
+}
+
+/* handle one PDU that the data link passed up to the node */
+static void sim_node_receive(
+    struct sim_node *node,
+    BACNET_ADDRESS * src,
+    uint8_t * pdu,
+    uint16_t pdu_len)
+{
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS dest;
+    uint8_t reply[MAX_NPDU + 3];
+    uint8_t invoke_id;
+    uint32_t latency;
+    int offset;
+    int len;
+
+    node->pdus_received++;
+    node->octets_received += pdu_len;
+    offset = npdu_decode(&pdu[0], &dest, NULL, &npdu_data);
+    if ((offset <= 0) || (offset >= pdu_len) ||
+        npdu_data.network_layer_message) {
+        return;
+    }
+    switch (pdu[offset] & 0xF0) {
+        case PDU_TYPE_CONFIRMED_SERVICE_REQUEST:
+            if ((offset + 3) >= pdu_len) {
+                break;
+            }
+            node->requests_received++;
+            len = sim_encode_header(reply, false);
+            reply[len++] = PDU_TYPE_SIMPLE_ACK;
+            reply[len++] = pdu[offset + 2];
+            reply[len++] = pdu[offset + 3];
+            if (dlmstp_send_pdu(&node->mstp_port, src, reply, len) <= 0) {
+                node->queue_full++;
+            }
+            break;
+        case PDU_TYPE_SIMPLE_ACK:
+            if ((offset + 1) >= pdu_len) {
+                break;
+            }
+            invoke_id = pdu[offset + 1];
+            node->replies_received++;
+            if (node->request_time[invoke_id]) {
+                latency = (uint32_t) (clock_microseconds() -
+                    node->request_time[invoke_id]);
+                node->request_time[invoke_id] = 0;
+                node->reply_latency_sum += latency;
+                if (latency > node->reply_latency_max) {
+                    node->reply_latency_max = latency;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* application task of one node: answers requests and generates load */
+static void *sim_node_task(
+    void *pArg)
+{
+    struct sim_node *node = (struct sim_node *) pArg;
+    BACNET_ADDRESS src;
+    uint8_t pdu[MAX_MPDU];
+    uint16_t pdu_len;
+    uint64_t now;
+
+    node->next_send_time = clock_microseconds();
+    while (Sim_Running) {
+        pdu_len = dlmstp_receive(&node->mstp_port, &src, pdu, sizeof(pdu), 1);
+        if (pdu_len) {
+            sim_node_receive(node, &src, pdu, pdu_len);
+        }
+        if (!node->generator) {
+            continue;
+        }
+        while (Ringbuf_Count(&node->shared.PDU_Queue) < Sim_Queue_Depth) {
+            if (Sim_Rate) {
+                now = clock_microseconds();
+                if (now < node->next_send_time) {
+                    break;
+                }
+                node->next_send_time += 1000000UL / Sim_Rate;
+            }
+            sim_node_send_request(node);
+        }
+    }
+
+    return NULL;
+}
+
+/* feed one complete frame to the analysis and the retry counters */
+static void sim_bus_frame(
+    uint8_t * frame,
+    uint16_t frame_len,
+    uint64_t now)
+{
+    struct timeval tv;
+    uint8_t *packet;
+    uint8_t header_crc = 0xFF;
+    uint16_t data_crc = 0xFFFF;
+    uint16_t data_len = 0;
+    uint8_t frame_type, dst, src;
+    uint64_t timestamp;
+    unsigned i;
+
+    timestamp = now - Sim_Bus.start_time;
+    if (Sim_Capture) {
+        gettimeofday(&tv, NULL);
+        packet = Pcap_Writer_Packet(tv.tv_sec, tv.tv_usec, frame_len);
+        if (packet) {
+            memcpy(packet, frame, frame_len);
+        }
+    }
+    for (i = 2; i < 8; i++) {
+        header_crc = CRC_Calc_Header(frame[i], header_crc);
+    }
+    if (header_crc != 0x55) {
+        MSTP_Stats_Invalid_Frame(&Sim_Analysis, timestamp, frame_len);
+        return;
+    }
+    frame_type = frame[2];
+    dst = frame[3];
+    src = frame[4];
+    if (frame_len > (8 + 2)) {
+        data_len = frame_len - 8 - 2;
+        for (i = 8; i < frame_len; i++) {
+            data_crc = CRC_Calc_Data(frame[i], data_crc);
+        }
+    }
+    MSTP_Stats_Frame(&Sim_Analysis, timestamp, frame_type, src, dst, data_len,
+        (data_len == 0) || (data_crc == 0xF0B8));
+    if (Sim_Bus.prior_valid) {
+        if ((now - Sim_Bus.prior_time) >= (Tno_token * 1000UL)) {
+            /* the trunk was silent long enough to regenerate the token */
+            Sim_Bus.lost_tokens++;
+        }
+        if ((frame_type == FRAME_TYPE_TOKEN) &&
+            (Sim_Bus.prior_frame_type == FRAME_TYPE_TOKEN) &&
+            (Sim_Bus.prior_src == src) && (Sim_Bus.prior_dst == dst)) {
+            Sim_Bus.token_retries++;
+        }
+        if ((Sim_Bus.prior_frame_type ==
+                FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY) &&
+            (Sim_Bus.prior_dst != MSTP_BROADCAST_ADDRESS) &&
+            (Sim_Bus.prior_dst != src)) {
+            Sim_Bus.der_no_reply++;
+        }
+    }
+    if (frame_type == FRAME_TYPE_REPLY_POSTPONED) {
+        Sim_Bus.reply_postponed++;
+    }
+    Sim_Bus.prior_time = now;
+    Sim_Bus.prior_frame_type = frame_type;
+    Sim_Bus.prior_src = src;
+    Sim_Bus.prior_dst = dst;
+    Sim_Bus.prior_valid = true;
+}
+
+/* assemble the octets written by one node into frames */
+static void sim_bus_monitor(
+    struct sim_node *node,
+    uint8_t * buffer,
+    size_t length,
+    uint64_t now)
+{
+    uint16_t frame_len;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        if (node->frame_len == 0) {
+            if (buffer[i] == 0x55) {
+                node->frame[node->frame_len++] = buffer[i];
+            }
+            continue;
+        }
+        if ((node->frame_len == 1) && (buffer[i] != 0xFF)) {
+            node->frame_len = (buffer[i] == 0x55) ? 1 : 0;
+            continue;
+        }
+        node->frame[node->frame_len++] = buffer[i];
+        if (node->frame_len < 8) {
+            continue;
+        }
+        frame_len = 8;
+        if ((node->frame[5] | node->frame[6]) != 0) {
+            frame_len += ((node->frame[5] << 8) | node->frame[6]) + 2;
+        }
+        if ((frame_len > sizeof(node->frame)) ||
+            (node->frame_len >= frame_len)) {
+            sim_bus_frame(node->frame,
+                frame_len > sizeof(node->frame) ? 8 : frame_len, now);
+            node->frame_len = 0;
+        }
+    }
+}
+
+/* put octets on the trunk: every node except the sender receives them */
+static void sim_bus_transmit(
+    struct sim_node *sender,
+    uint8_t * buffer,
+    size_t length)
+{
+    struct sim_node *node;
+    ssize_t written;
+    unsigned i;
+
+    if (Sim_Baud) {
+        /* one start bit, eight data bits, one stop bit */
+        sleep_microseconds(((uint64_t) length * 10 * 1000000UL) / Sim_Baud);
+    }
+    for (i = 0; i < Sim_Node_Count; i++) {
+        node = &Sim_Node[i];
+        if (node == sender) {
+            continue;
+        }
+        written = write(node->bus_fd, buffer, length);
+        if (written < (ssize_t) length) {
+            Sim_Bus.overrun_octets += length - (written > 0 ? written : 0);
+        }
+    }
+}
+
+/* replay frames of a capture file onto the trunk at the captured pace */
+static bool sim_replay_poll(
+    struct pcap_packet *packet,
+    uint64_t * next_time,
+    uint64_t replay_start,
+    uint64_t capture_start)
+{
+    uint64_t captured;
+    uint64_t now;
+
+    for (;;) {
+        if (packet->data) {
+            now = clock_microseconds();
+            if (now < *next_time) {
+                return true;
+            }
+            if ((packet->incl_len >= 8) &&
+                (packet->data[4] != Replay_MAC)) {
+                sim_bus_transmit(NULL, packet->data, packet->incl_len);
+                sim_bus_monitor(&Replay_Monitor, packet->data,
+                    packet->incl_len, clock_microseconds());
+                Sim_Bus.replayed_frames++;
+            }
+        }
+        if (!Pcap_Reader_Next(packet)) {
+            packet->data = NULL;
+            return false;
+        }
+        captured = ((uint64_t) packet->ts_sec * 1000000ULL) +
+            packet->ts_usec - capture_start;
+        if (Replay_Speed > 0.0) {
+            *next_time = replay_start + (uint64_t) (captured / Replay_Speed);
+        } else {
+            *next_time = 0;
+        }
+    }
+}
+
+/****************************************************************************
+* DESCRIPTION: Runs the trunk until the time is up or replay is done
+* RETURN:      none
+* NOTES:       runs in the main thread
+*****************************************************************************/
+static void sim_bus_run(
+    uint32_t seconds)
+{
+    struct pollfd fds[MSTPSIM_NODES_MAX];
+    struct pcap_packet packet;
+    uint8_t buffer[MAX_MPDU];
+    uint64_t deadline = 0;
+    uint64_t next_time = 0;
+    uint64_t replay_start = 0;
+    uint64_t capture_start = 0;
+    uint64_t now;
+    uint32_t link_type = 0;
+    bool replaying = false;
+    int timeout;
+    int ready;
+    ssize_t n;
+    unsigned i;
+
+    memset(&packet, 0, sizeof(packet));
+    if (Replay_Filename) {
+        if (!Pcap_Reader_Open(Replay_Filename, &link_type)) {
+            fprintf(stderr, "mstpsim: failed to open %s\n", Replay_Filename);
+            return;
+        }
+        if (link_type != PCAP_DLT_BACNET_MS_TP) {
+            fprintf(stderr, "mstpsim: invalid data link type (DLT)\n");
+            Pcap_Reader_Close();
+            return;
+        }
+        if (Pcap_Reader_Next(&packet)) {
+            capture_start = ((uint64_t) packet.ts_sec * 1000000ULL) +
+                packet.ts_usec;
+            replaying = true;
+        }
+    }
+    for (i = 0; i < Sim_Node_Count; i++) {
+        fds[i].fd = Sim_Node[i].bus_fd;
+        fds[i].events = POLLIN;
+    }
+    Sim_Bus.start_time = clock_microseconds();
+    replay_start = Sim_Bus.start_time;
+    next_time = replay_start;
+    if (seconds) {
+        deadline = Sim_Bus.start_time + ((uint64_t) seconds * 1000000ULL);
+    }
+    while (Sim_Running) {
+        now = clock_microseconds();
+        if (deadline && (now >= deadline)) {
+            break;
+        }
+        if (replaying) {
+            replaying = sim_replay_poll(&packet, &next_time, replay_start,
+                capture_start);
+            if (!replaying && !deadline) {
+                /* let the node under test finish what it started */
+                deadline = clock_microseconds() + (Tno_token * 1000UL);
+            }
+        }
+        timeout = 5;
+        if (replaying) {
+            now = clock_microseconds();
+            if (next_time <= now) {
+                timeout = 0;
+            } else if ((next_time - now) < 5000) {
+                timeout = (int) ((next_time - now + 999) / 1000);
+            }
+        }
+        ready = poll(fds, Sim_Node_Count, timeout);
+        if (ready <= 0) {
+            continue;
+        }
+        if (ready > 1) {
+            /* more than one node was driving the trunk */
+            Sim_Bus.collisions++;
+        }
+        for (i = 0; i < Sim_Node_Count; i++) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            n = read(fds[i].fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                continue;
+            }
+            sim_bus_transmit(&Sim_Node[i], buffer, n);
+            sim_bus_monitor(&Sim_Node[i], buffer, n, clock_microseconds());
+        }
+        if (Sim_Capture) {
+            Pcap_Writer_Poll();
+        }
+    }
+    if (Replay_Filename) {
+        Pcap_Reader_Close();
+    }
+}
+
+/* application layer totals of all of the nodes */
+struct sim_totals {
+    uint64_t duration;
+    uint32_t requests_sent;
+    uint32_t unconfirmed_sent;
+    uint32_t replies_received;
+    uint32_t pdus_received;
+    uint32_t queue_full;
+    uint64_t octets_received;
+    uint64_t reply_latency_sum;
+    uint32_t reply_latency_max;
+    double pdu_rate;
+    double octet_rate;
+    /* adaptive tuning of the master nodes */
+    MSTP_ADAPTIVE_COUNTERS adaptive;
+    uint8_t max_info_frames;
+};
+
+static void sim_totals(
+    struct sim_totals *totals)
+{
+    struct sim_node *node;
+    unsigned i;
+
+    memset(totals, 0, sizeof(*totals));
+    totals->duration = clock_microseconds() - Sim_Bus.start_time;
+    for (i = 0; i < Sim_Node_Count; i++) {
+        node = &Sim_Node[i];
+        totals->requests_sent += node->requests_sent;
+        totals->unconfirmed_sent += node->unconfirmed_sent;
+        totals->replies_received += node->replies_received;
+        totals->pdus_received += node->pdus_received;
+        totals->queue_full += node->queue_full;
+        totals->octets_received += node->octets_received;
+        totals->reply_latency_sum += node->reply_latency_sum;
+        if (node->reply_latency_max > totals->reply_latency_max) {
+            totals->reply_latency_max = node->reply_latency_max;
+        }
+        if (node->mstp_port.Adaptive) {
+            MSTP_ADAPTIVE_COUNTERS *counters =
+                &node->mstp_port.AdaptiveCounters;
+            totals->adaptive.Tokens += counters->Tokens;
+            totals->adaptive.SaturatedHolds += counters->SaturatedHolds;
+            totals->adaptive.DrainedHolds += counters->DrainedHolds;
+            totals->adaptive.InfoFramesRaised += counters->InfoFramesRaised;
+            totals->adaptive.InfoFramesLowered +=
+                counters->InfoFramesLowered;
+            totals->adaptive.PollsSkipped += counters->PollsSkipped;
+            if (node->mstp_port.Nmax_info_frames > totals->max_info_frames) {
+                totals->max_info_frames = node->mstp_port.Nmax_info_frames;
+            }
+        }
+    }
+    if (totals->duration) {
+        totals->pdu_rate = (totals->pdus_received * 1000000.0) /
+            totals->duration;
+        totals->octet_rate = (totals->octets_received * 1000000.0) /
+            totals->duration;
+    }
+}
+
+static uint32_t sim_latency_average(
+    struct sim_totals *totals)
+{
+    if (totals->replies_received == 0) {
+        return 0;
+    }
+
+    return (uint32_t) (totals->reply_latency_sum / totals->replies_received);
+}
+
+static void sim_report(
+    struct sim_totals *totals)
+{
+    switch (Report_Format) {
+        case SIM_REPORT_CSV:
+            printf("duration_us,nodes,requests,unconfirmed,replies,"
+                "pdus_received,octets_received,pdus_per_sec,"
+                "octets_per_sec,reply_avg_us,reply_max_us,queue_full,"
+                "token_retries,lost_tokens,der_no_reply,reply_postponed,"
+                "collisions,overrun_octets,replayed_frames,"
+                "adaptive_tokens,saturated_holds,drained_holds,"
+                "info_frames_raised,info_frames_lowered,polls_skipped,"
+                "max_info_frames\n");
+            printf("%llu,%u,%lu,%lu,%lu,%lu,%llu,%.1f,%.1f,%lu,%lu,%lu,"
+                "%lu,%lu,%lu,%lu,%lu,%llu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,"
+                "%u\n",
+                (unsigned long long) totals->duration, Sim_Node_Count,
+                (unsigned long) totals->requests_sent,
+                (unsigned long) totals->unconfirmed_sent,
+                (unsigned long) totals->replies_received,
+                (unsigned long) totals->pdus_received,
+                (unsigned long long) totals->octets_received,
+                totals->pdu_rate, totals->octet_rate,
+                (unsigned long) sim_latency_average(totals),
+                (unsigned long) totals->reply_latency_max,
+                (unsigned long) totals->queue_full,
+                (unsigned long) Sim_Bus.token_retries,
+                (unsigned long) Sim_Bus.lost_tokens,
+                (unsigned long) Sim_Bus.der_no_reply,
+                (unsigned long) Sim_Bus.reply_postponed,
+                (unsigned long) Sim_Bus.collisions,
+                (unsigned long long) Sim_Bus.overrun_octets,
+                (unsigned long) Sim_Bus.replayed_frames,
+                (unsigned long) totals->adaptive.Tokens,
+                (unsigned long) totals->adaptive.SaturatedHolds,
+                (unsigned long) totals->adaptive.DrainedHolds,
+                (unsigned long) totals->adaptive.InfoFramesRaised,
+                (unsigned long) totals->adaptive.InfoFramesLowered,
+                (unsigned long) totals->adaptive.PollsSkipped,
+                (unsigned) totals->max_info_frames);
+            printf("\n");
+            MSTP_Stats_Print_CSV(&Sim_Analysis, stdout);
+            break;
+        case SIM_REPORT_JSON:
+            printf("{\"load\":{\"duration_us\":%llu,\"nodes\":%u,"
+                "\"requests\":%lu,\"unconfirmed\":%lu,\"replies\":%lu,"
+                "\"pdus_received\":%lu,\"octets_received\":%llu,"
+                "\"pdus_per_sec\":%.1f,\"octets_per_sec\":%.1f,"
+                "\"reply_avg_us\":%lu,\"reply_max_us\":%lu,"
+                "\"queue_full\":%lu,\"token_retries\":%lu,"
+                "\"lost_tokens\":%lu,\"der_no_reply\":%lu,"
+                "\"reply_postponed\":%lu,\"collisions\":%lu,"
+                "\"overrun_octets\":%llu,\"replayed_frames\":%lu,"
+                "\"adaptive\":{\"tokens\":%lu,\"saturated_holds\":%lu,"
+                "\"drained_holds\":%lu,\"info_frames_raised\":%lu,"
+                "\"info_frames_lowered\":%lu,\"polls_skipped\":%lu,"
+                "\"max_info_frames\":%u}},\n"
+                "\"analysis\":",
+                (unsigned long long) totals->duration, Sim_Node_Count,
+                (unsigned long) totals->requests_sent,
+                (unsigned long) totals->unconfirmed_sent,
+                (unsigned long) totals->replies_received,
+                (unsigned long) totals->pdus_received,
+                (unsigned long long) totals->octets_received,
+                totals->pdu_rate, totals->octet_rate,
+                (unsigned long) sim_latency_average(totals),
+                (unsigned long) totals->reply_latency_max,
+                (unsigned long) totals->queue_full,
+                (unsigned long) Sim_Bus.token_retries,
+                (unsigned long) Sim_Bus.lost_tokens,
+                (unsigned long) Sim_Bus.der_no_reply,
+                (unsigned long) Sim_Bus.reply_postponed,
+                (unsigned long) Sim_Bus.collisions,
+                (unsigned long long) Sim_Bus.overrun_octets,
+                (unsigned long) Sim_Bus.replayed_frames,
+                (unsigned long) totals->adaptive.Tokens,
+                (unsigned long) totals->adaptive.SaturatedHolds,
+                (unsigned long) totals->adaptive.DrainedHolds,
+                (unsigned long) totals->adaptive.InfoFramesRaised,
+                (unsigned long) totals->adaptive.InfoFramesLowered,
+                (unsigned long) totals->adaptive.PollsSkipped,
+                (unsigned) totals->max_info_frames);
+            MSTP_Stats_Print_JSON(&Sim_Analysis, stdout);
+            printf("}\n");
+            break;
+        case SIM_REPORT_TEXT:
+        default:
+            printf("==== MS/TP Load ====\n");
+            printf("Nodes: %u  Duration: %.3fs  Baud: %lu\n", Sim_Node_Count,
+                totals->duration / 1000000.0, (unsigned long) Sim_Baud);
+            if (Replay_Filename) {
+                printf("Replayed Frames: %lu\n",
+                    (unsigned long) Sim_Bus.replayed_frames);
+            }
+            printf("Sent: %lu confirmed, %lu unconfirmed  "
+                "Queue Full: %lu\n", (unsigned long) totals->requests_sent,
+                (unsigned long) totals->unconfirmed_sent,
+                (unsigned long) totals->queue_full);
+            printf("Received: %lu PDUs, %llu octets  Replies: %lu\n",
+                (unsigned long) totals->pdus_received,
+                (unsigned long long) totals->octets_received,
+                (unsigned long) totals->replies_received);
+            printf("Throughput: %.1f PDU/s, %.1f octets/s\n",
+                totals->pdu_rate, totals->octet_rate);
+            printf("Reply Latency (ms): avg %.2f  max %.2f\n",
+                sim_latency_average(totals) / 1000.0,
+                totals->reply_latency_max / 1000.0);
+            printf("Token Retries: %lu  Lost Tokens: %lu  "
+                "DER Without Reply: %lu  Reply Postponed: %lu\n",
+                (unsigned long) Sim_Bus.token_retries,
+                (unsigned long) Sim_Bus.lost_tokens,
+                (unsigned long) Sim_Bus.der_no_reply,
+                (unsigned long) Sim_Bus.reply_postponed);
+            printf("Collisions: %lu  Overrun Octets: %llu\n",
+                (unsigned long) Sim_Bus.collisions,
+                (unsigned long long) Sim_Bus.overrun_octets);
+            if (Sim_Adaptive) {
+                printf("Adaptive: %lu tokens, %lu saturated and %lu drained "
+                    "holds\n", (unsigned long) totals->adaptive.Tokens,
+                    (unsigned long) totals->adaptive.SaturatedHolds,
+                    (unsigned long) totals->adaptive.DrainedHolds);
+                printf("Max_Info_Frames: %lu raised, %lu lowered, "
+                    "highest now %u  Polls Skipped: %lu\n",
+                    (unsigned long) totals->adaptive.InfoFramesRaised,
+                    (unsigned long) totals->adaptive.InfoFramesLowered,
+                    (unsigned) totals->max_info_frames,
+                    (unsigned long) totals->adaptive.PollsSkipped);
+            }
+            printf("\n");
+            MSTP_Stats_Print_Text(&Sim_Analysis, stdout);
+            break;
+    }
+}
+
+static void print_usage(
+    char *filename)
+{
+    printf("Usage: %s", filename);
+    printf(" [--masters count][--slaves count][--baud baud]\n");
+    printf(" [--max-master mac][--max-info-frames count][--adaptive limit]\n");
+    printf(" [--confirmed percent][--size octets][--rate pdus][--queue count]\n");
+    printf(" [--replay <filename>][--speed factor][--mac mac]\n");
+    printf(" [--duration seconds][--capture][--csv][--json]\n");
+    printf(" [--min-throughput pdus][--max-lost-tokens count]\n");
+    printf(" [--version][--help]\n");
+}
+
+static void print_help(
+    char *filename)
+{
+    printf("Simulates an MS/TP trunk of virtual nodes connected by\n"
+        "pseudo-terminals and reports the token loop and throughput.\n"
+        "Each node runs the MS/TP state machines of this stack.\n");
+    printf("\n");
+    printf("[--masters count] - number of master nodes, MAC 0 and up.\n"
+        "    Defaults to 4.\n"
+        "[--slaves count] - number of slave nodes, MAC %u and up.\n"
+        "    Defaults to 0.\n"
+        "[--baud baud] - trunk speed used to pace the octets.\n"
+        "    Defaults to 38400.  Use 0 to deliver octets at once.\n"
+        "[--max-master mac] - Max_Master of the master nodes.\n"
+        "[--max-info-frames count] - Max_Info_Frames of the nodes.\n"
+        "[--adaptive limit] - let busy masters raise Max_Info_Frames up\n"
+        "    to limit, and skip polls of addresses that did not answer.\n",
+        MSTPSIM_SLAVE_MAC_FIRST);
+    printf("[--confirmed percent] - share of requests that expect a\n"
+        "    reply.  Defaults to 50.\n"
+        "[--size octets] - APDU size of each request.  Defaults to 50.\n"
+        "[--rate pdus] - requests per second from each master.\n"
+        "    Defaults to 0, which keeps the send queue busy.\n"
+        "[--queue count] - requests each master keeps queued.\n"
+        "    Defaults to 1.\n");
+    printf("[--replay filename] - replay an mstpcap capture file onto the\n"
+        "    trunk against one node.  Frames sent by that node in the\n"
+        "    capture are not replayed.\n"
+        "[--speed factor] - replay speed.  Defaults to 1, the captured\n"
+        "    timing.  Use 0 to replay as fast as the trunk allows.\n"
+        "[--mac mac] - MAC address of the node under test.  Defaults to 0.\n");
+    printf("[--duration seconds] - length of the run.  Defaults to 10,\n"
+        "    or the length of the capture when replaying.\n"
+        "[--capture] - save the trunk traffic in a capture file.\n"
+        "[--csv] - emit the report as CSV.\n"
+        "[--json] - emit the report as JSON.\n"
+        "[--min-throughput pdus] - exit with an error when fewer PDU/s\n"
+        "    are delivered.\n"
+        "[--max-lost-tokens count] - exit with an error when more tokens\n"
+        "    are lost.\n");
+    printf("\n");
+    printf("Example: %s --masters 8 --slaves 2 --duration 30 --csv\n",
+        filename);
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    struct sim_totals totals;
+    unsigned masters = 4;
+    unsigned slaves = 0;
+    unsigned long duration = 0;
+    bool duration_set = false;
+    char *filename = NULL;
+    int argi = 0;
+    int rc = 0;
+    unsigned i;
+
+    filename = argv[0];
+    for (argi = 1; argi < argc; argi++) {
+        if (strcmp(argv[argi], "--help") == 0) {
+            print_usage(filename);
+            print_help(filename);
+            return 0;
+        }
+        if (strcmp(argv[argi], "--version") == 0) {
+            printf("mstpsim %s\n", BACnet_Version);
+            printf("Copyright (C) 2016 by Steve Karg\n"
+                "This is free software; see the source for copying conditions.\n"
+                "There is NO warranty; not even for MERCHANTABILITY or\n"
+                "FITNESS FOR A PARTICULAR PURPOSE.\n");
+            return 0;
+        }
+        if (strcmp(argv[argi], "--capture") == 0) {
+            Sim_Capture = true;
+            continue;
+        }
+        if (strcmp(argv[argi], "--csv") == 0) {
+            Report_Format = SIM_REPORT_CSV;
+            continue;
+        }
+        if (strcmp(argv[argi], "--json") == 0) {
+            Report_Format = SIM_REPORT_JSON;
+            continue;
+        }
+        if ((argi + 1) >= argc) {
+            print_usage(filename);
+            return 1;
+        }
+        if (strcmp(argv[argi], "--masters") == 0) {
+            masters = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--slaves") == 0) {
+            slaves = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--baud") == 0) {
+            Sim_Baud = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--max-master") == 0) {
+            Sim_Max_Master = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--max-info-frames") == 0) {
+            Sim_Max_Info_Frames = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--adaptive") == 0) {
+            Sim_Adaptive = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--confirmed") == 0) {
+            Sim_Confirmed_Percent = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--size") == 0) {
+            Sim_APDU_Size = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--rate") == 0) {
+            Sim_Rate = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--queue") == 0) {
+            Sim_Queue_Depth = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--replay") == 0) {
+            Replay_Filename = argv[++argi];
+        } else if (strcmp(argv[argi], "--speed") == 0) {
+            Replay_Speed = strtod(argv[++argi], NULL);
+        } else if (strcmp(argv[argi], "--mac") == 0) {
+            Replay_MAC = strtoul(argv[++argi], NULL, 0);
+        } else if (strcmp(argv[argi], "--duration") == 0) {
+            duration = strtoul(argv[++argi], NULL, 0);
+            duration_set = true;
+        } else if (strcmp(argv[argi], "--min-throughput") == 0) {
+            Limit_Min_Throughput = strtod(argv[++argi], NULL);
+        } else if (strcmp(argv[argi], "--max-lost-tokens") == 0) {
+            Limit_Max_Lost_Tokens = strtol(argv[++argi], NULL, 0);
+        } else {
+            print_usage(filename);
+            return 1;
+        }
+    }
+    if (Replay_Filename) {
+        /* the node under test is the only node on the trunk */
+        masters = 1;
+        slaves = 0;
+    } else if (!duration_set) {
+        duration = 10;
+    }
+    if ((masters + slaves) > MSTPSIM_NODES_MAX) {
+        fprintf(stderr, "mstpsim: at most %u nodes\n", MSTPSIM_NODES_MAX);
+        return 1;
+    }
+    if (Sim_Max_Master > DEFAULT_MAX_MASTER) {
+        Sim_Max_Master = DEFAULT_MAX_MASTER;
+    }
+    if (Sim_Queue_Depth < 1) {
+        Sim_Queue_Depth = 1;
+    } else if (Sim_Queue_Depth > MSTP_PDU_PACKET_COUNT) {
+        Sim_Queue_Depth = MSTP_PDU_PACKET_COUNT;
+    }
+    if (Sim_APDU_Size > MAX_APDU) {
+        Sim_APDU_Size = MAX_APDU;
+    }
+    signal(SIGINT, sig_int);
+    signal(SIGTERM, sig_int);
+    signal(SIGPIPE, SIG_IGN);
+    MSTP_Stats_Init(&Sim_Analysis, Sim_Baud ? Sim_Baud : 38400);
+    for (i = 0; i < (masters + slaves); i++) {
+        struct sim_node *node = &Sim_Node[Sim_Node_Count];
+        bool master = (i < masters);
+        uint8_t mac;
+
+        if (Replay_Filename) {
+            mac = Replay_MAC;
+        } else if (master) {
+            mac = i;
+        } else {
+            mac = MSTPSIM_SLAVE_MAC_FIRST + (i - masters);
+        }
+        if (!sim_node_start(node, mac, (mac <= DEFAULT_MAX_MASTER))) {
+            fprintf(stderr, "mstpsim: unable to start node %u\n", mac);
+            return 1;
+        }
+        node->generator = master && !Replay_Filename;
+        Sim_Node_Count++;
+    }
+    if (Sim_Capture) {
+        Pcap_Writer_Init("mstpsim", PCAP_DLT_BACNET_MS_TP);
+        Pcap_Writer_Rotate_Set(0, 0, 0);
+        if (Pcap_Writer_Open()) {
+            fprintf(stderr, "mstpsim: saving capture to %s\n",
+                Pcap_Writer_Filename());
+        } else {
+            Sim_Capture = false;
+        }
+    }
+    for (i = 0; i < Sim_Node_Count; i++) {
+        if (pthread_create(&Sim_Node[i].thread, NULL, sim_node_task,
+                &Sim_Node[i]) != 0) {
+            fprintf(stderr, "mstpsim: unable to start node task\n");
+            return 1;
+        }
+    }
+    sim_bus_run(duration);
+    Sim_Running = false;
+    for (i = 0; i < Sim_Node_Count; i++) {
+        pthread_join(Sim_Node[i].thread, NULL);
+    }
+    if (Sim_Capture) {
+        Pcap_Writer_Close();
+    }
+    sim_totals(&totals);
+    sim_report(&totals);
+    if ((Limit_Min_Throughput > 0.0) &&
+        (totals.pdu_rate < Limit_Min_Throughput)) {
+        fprintf(stderr, "mstpsim: throughput %.1f PDU/s is below %.1f\n",
+            totals.pdu_rate, Limit_Min_Throughput);
+        rc = 2;
+    }
+    if ((Limit_Max_Lost_Tokens >= 0) &&
+        (Sim_Bus.lost_tokens > (unsigned long) Limit_Max_Lost_Tokens)) {
+        fprintf(stderr, "mstpsim: %lu lost tokens exceeds %ld\n",
+            (unsigned long) Sim_Bus.lost_tokens, Limit_Max_Lost_Tokens);
+        rc = 2;
+    }
+
+    /* the MS/TP state machine tasks do not stop on their own */
+    return rc;
+}
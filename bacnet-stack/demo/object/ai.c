@@ -37,6 +37,8 @@
 #include "config.h"     /* the custom stuff */
 #include "device.h"
 #include "handlers.h"
+#include "evindex.h"
+#include "evsched.h"
 #include "proplist.h"
 #include "timestamp.h"
 #include "ai.h"
@@ -104,6 +106,25 @@ void Analog_Input_Property_Lists(
 }
 
 
+#if defined(INTRINSIC_REPORTING)
+/* add the object to the active event index, or remove it */
+static void Analog_Input_Event_Index_Update(
+    unsigned index)
+{
+    bool active = false;
+    unsigned j;
+
+    active = (AI_Descr[index].Event_State != EVENT_STATE_NORMAL);
+    for (j = 0; j < MAX_BACNET_EVENT_TRANSITION; j++) {
+        if (!AI_Descr[index].Acked_Transitions[j].bIsAcked) {
+            active = true;
+        }
+    }
+    (void) evindex_update(OBJECT_ANALOG_INPUT,
+        Analog_Input_Index_To_Instance(index), index, active);
+}
+#endif
+
 void Analog_Input_Init(
     void)
 {
@@ -139,6 +160,12 @@ void Analog_Input_Init(
         /* Set handler for GetAlarmSummary Service */
         handler_get_alarm_summary_set(OBJECT_ANALOG_INPUT,
             Analog_Input_Alarm_Summary);
+        /* Keep the active events in the event index */
+        evindex_maintain(OBJECT_ANALOG_INPUT);
+        Analog_Input_Event_Index_Update(i);
+        evsched_timer_init(&AI_Descr[i].Event_Timer, OBJECT_ANALOG_INPUT,
+            Analog_Input_Index_To_Instance(i));
+        evsched_schedule(&AI_Descr[i].Event_Timer, 0);
 #endif
     }
 }
@@ -234,7 +261,13 @@ void Analog_Input_Present_Value_Set(
     index = Analog_Input_Instance_To_Index(object_instance);
     if (index < MAX_ANALOG_INPUTS) {
         Analog_Input_COV_Detect(index, value);
-        AI_Descr[index].Present_Value = value;
+        if (AI_Descr[index].Present_Value != value) {
+            AI_Descr[index].Present_Value = value;
+            Device_COV_Changed(OBJECT_ANALOG_INPUT, object_instance);
+        }
+#if defined(INTRINSIC_REPORTING)
+        evsched_schedule(&AI_Descr[index].Event_Timer, 0);
+#endif
     }
 }
 
@@ -286,6 +319,9 @@ bool Analog_Input_Encode_Value_List(
     BACNET_PROPERTY_VALUE * value_list)
 {
     bool status = false;
+#if defined(INTRINSIC_REPORTING)
+    unsigned index = 0;
+#endif
 
     if (value_list) {
         value_list->propertyIdentifier = PROP_PRESENT_VALUE;
@@ -306,6 +342,13 @@ bool Analog_Input_Encode_Value_List(
         bitstring_init(&value_list->value.type.Bit_String);
         bitstring_set_bit(&value_list->value.type.Bit_String,
             STATUS_FLAG_IN_ALARM, false);
+#if defined(INTRINSIC_REPORTING)
+        index = Analog_Input_Instance_To_Index(object_instance);
+        if ((index < MAX_ANALOG_INPUTS) && AI_Descr[index].Event_State) {
+            bitstring_set_bit(&value_list->value.type.Bit_String,
+                STATUS_FLAG_IN_ALARM, true);
+        }
+#endif
         bitstring_set_bit(&value_list->value.type.Bit_String,
             STATUS_FLAG_FAULT, false);
         bitstring_set_bit(&value_list->value.type.Bit_String,
@@ -385,11 +428,84 @@ void Analog_Input_Out_Of_Service_Set(
     		review by all interested parties. Say 6 months -> September 2016 */
         if (AI_Descr[index].Out_Of_Service != value) {
             AI_Descr[index].Changed = true;
+            AI_Descr[index].Out_Of_Service = value;
+            Device_COV_Changed(OBJECT_ANALOG_INPUT, object_instance);
         }
-        AI_Descr[index].Out_Of_Service = value;
     }
 }
 
+/* gets the value of a property without encoding it;
+   returns false for the properties that must be read */
+bool Analog_Input_Value_Get(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    ANALOG_INPUT_DESCR *CurrentAI;
+    unsigned index = 0;
+    bool status = true;
+
+    index = Analog_Input_Instance_To_Index(object_instance);
+    if ((index >= MAX_ANALOG_INPUTS) || (value == NULL)) {
+        return false;
+    }
+    CurrentAI = &AI_Descr[index];
+    value->context_specific = false;
+    value->next = NULL;
+    switch (object_property) {
+        case PROP_PRESENT_VALUE:
+            value->tag = BACNET_APPLICATION_TAG_REAL;
+            value->type.Real = CurrentAI->Present_Value;
+            break;
+        case PROP_STATUS_FLAGS:
+            value->tag = BACNET_APPLICATION_TAG_BIT_STRING;
+            bitstring_init(&value->type.Bit_String);
+#if defined(INTRINSIC_REPORTING)
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_IN_ALARM,
+                CurrentAI->Event_State ? true : false);
+#else
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_IN_ALARM,
+                false);
+#endif
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_FAULT,
+                false);
+            bitstring_set_bit(&value->type.Bit_String,
+                STATUS_FLAG_OVERRIDDEN, false);
+            bitstring_set_bit(&value->type.Bit_String,
+                STATUS_FLAG_OUT_OF_SERVICE, CurrentAI->Out_Of_Service);
+            break;
+        case PROP_EVENT_STATE:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+#if defined(INTRINSIC_REPORTING)
+            value->type.Enumerated = CurrentAI->Event_State;
+#else
+            value->type.Enumerated = EVENT_STATE_NORMAL;
+#endif
+            break;
+        case PROP_RELIABILITY:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+            value->type.Enumerated = CurrentAI->Reliability;
+            break;
+        case PROP_OUT_OF_SERVICE:
+            value->tag = BACNET_APPLICATION_TAG_BOOLEAN;
+            value->type.Boolean = CurrentAI->Out_Of_Service;
+            break;
+        case PROP_UNITS:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+            value->type.Enumerated = CurrentAI->Units;
+            break;
+        case PROP_COV_INCREMENT:
+            value->tag = BACNET_APPLICATION_TAG_REAL;
+            value->type.Real = CurrentAI->COV_Increment;
+            break;
+        default:
+            status = false;
+            break;
+    }
+
+    return status;
+}
+
 /* return apdu length, or BACNET_STATUS_ERROR on error */
 /* assumption - object already exists */
 int Analog_Input_Read_Property(
@@ -862,6 +978,13 @@ bool Analog_Input_Write_Property(
             break;
     }
 
+#if defined(INTRINSIC_REPORTING)
+    if (status) {
+        /* the event state may depend on the property */
+        evsched_schedule(&CurrentAI->Event_Timer, 0);
+    }
+#endif
+
     return status;
 }
 
@@ -895,6 +1018,8 @@ void Analog_Input_Intrinsic_Reporting(
     if (CurrentAI->Ack_notify_data.bSendAckNotify) {
         /* clean bSendAckNotify flag */
         CurrentAI->Ack_notify_data.bSendAckNotify = false;
+        /* the event state is evaluated again in the next second */
+        evsched_schedule(&CurrentAI->Event_Timer, 1);
         /* copy toState */
         ToState = CurrentAI->Ack_notify_data.EventState;
 
@@ -928,8 +1053,10 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_OFFNORMAL)) {
                     if (!CurrentAI->Remaining_Time_Delay)
                         CurrentAI->Event_State = EVENT_STATE_HIGH_LIMIT;
-                    else
+                    else {
                         CurrentAI->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAI->Event_Timer, 1);
+                    }
                     break;
                 }
 
@@ -945,8 +1072,10 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_OFFNORMAL)) {
                     if (!CurrentAI->Remaining_Time_Delay)
                         CurrentAI->Event_State = EVENT_STATE_LOW_LIMIT;
-                    else
+                    else {
                         CurrentAI->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAI->Event_Timer, 1);
+                    }
                     break;
                 }
                 /* value of the object is still in the same event state */
@@ -967,8 +1096,10 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_NORMAL)) {
                     if (!CurrentAI->Remaining_Time_Delay)
                         CurrentAI->Event_State = EVENT_STATE_NORMAL;
-                    else
+                    else {
                         CurrentAI->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAI->Event_Timer, 1);
+                    }
                     break;
                 }
                 /* value of the object is still in the same event state */
@@ -990,8 +1121,10 @@ void Analog_Input_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_NORMAL)) {
                     if (!CurrentAI->Remaining_Time_Delay)
                         CurrentAI->Event_State = EVENT_STATE_NORMAL;
-                    else
+                    else {
                         CurrentAI->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAI->Event_Timer, 1);
+                    }
                     break;
                 }
                 /* value of the object is still in the same event state */
@@ -1159,6 +1292,7 @@ void Analog_Input_Intrinsic_Reporting(
                     break;
             }
         }
+        Analog_Input_Event_Index_Update(object_index);
     }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
@@ -1334,7 +1468,9 @@ int Analog_Input_Alarm_Ack(
             return -2;
     }
     CurrentAI->Ack_notify_data.bSendAckNotify = true;
+    evsched_schedule(&CurrentAI->Event_Timer, 0);
     CurrentAI->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Analog_Input_Event_Index_Update(object_index);
 
     return 1;
 }
@@ -1407,6 +1543,14 @@ bool WPValidateArgType(
     return (bResult);
 }
 
+void Device_COV_Changed(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    object_type = object_type;
+    object_instance = object_instance;
+}
+
 void testAnalogInput(
     Test * pTest)
 {
@@ -1417,6 +1561,8 @@ void testAnalogInput(
     uint32_t decoded_instance = 0;
     uint16_t decoded_type = 0;
     BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_PROPERTY_VALUE value_list[2];
+    BACNET_APPLICATION_DATA_VALUE value;
 
     Analog_Input_Init();
     rpdata.application_data = &apdu[0];
@@ -1433,6 +1579,21 @@ void testAnalogInput(
     ct_test(pTest, decoded_type == rpdata.object_type);
     ct_test(pTest, decoded_instance == rpdata.object_instance);
 
+    /* a change of value has the status flags that a read gets */
+    value_list[0].next = &value_list[1];
+    value_list[1].next = NULL;
+    Analog_Input_Out_Of_Service_Set(1, true);
+#if defined(INTRINSIC_REPORTING)
+    AI_Descr[Analog_Input_Instance_To_Index(1)].Event_State =
+        EVENT_STATE_HIGH_LIMIT;
+#endif
+    (void) Analog_Input_Encode_Value_List(1, &value_list[0]);
+    ct_test(pTest, Analog_Input_Value_Get(1, PROP_STATUS_FLAGS, &value));
+    ct_test(pTest,
+        value_list[1].value.tag == BACNET_APPLICATION_TAG_BIT_STRING);
+    ct_test(pTest, bitstring_same(&value_list[1].value.type.Bit_String,
+            &value.type.Bit_String));
+
     return;
 }
 
@@ -36,6 +36,7 @@
 #include "getevent.h"
 #include "alarm_ack.h"
 #include "get_alarm_sum.h"
+#include "evsched.h"
 #endif
 
 #ifdef __cplusplus
@@ -66,6 +67,8 @@ extern "C" {
         uint32_t Remaining_Time_Delay;
         /* AckNotification informations */
         ACK_NOTIFICATION Ack_notify_data;
+        /* next evaluation of the event state */
+        BACNET_EVENT_TIMER Event_Timer;
 #endif
     } ANALOG_INPUT_DESCR;
 
@@ -128,6 +131,10 @@ extern "C" {
     bool Analog_Input_Encode_Value_List(
         uint32_t object_instance,
         BACNET_PROPERTY_VALUE * value_list);
+    bool Analog_Input_Value_Get(
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        BACNET_APPLICATION_DATA_VALUE * value);
     float Analog_Input_COV_Increment(
         uint32_t instance);
     void Analog_Input_COV_Increment_Set(
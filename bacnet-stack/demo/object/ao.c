@@ -298,11 +298,12 @@ void Analog_Output_Out_Of_Service_Set(
 int Analog_Output_Read_Property(
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
-    int len = 0;
     int apdu_len = 0;   /* return value */
     BACNET_BIT_STRING bit_string;
     BACNET_CHARACTER_STRING char_string;
     float real_value = (float) 1.414;
+    float priority_values[BACNET_MAX_PRIORITY] = { 0.0 };
+    uint16_t active_bits = 0;
     unsigned object_index = 0;
     unsigned i = 0;
     bool state = false;
@@ -364,25 +365,20 @@ int Analog_Output_Read_Property(
                 object_index =
                     Analog_Output_Instance_To_Index(rpdata->object_instance);
                 for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
-                    /* FIXME: check if we have room before adding it to APDU */
-                    if (Analog_Output_Level[object_index][i] == AO_LEVEL_NULL)
-                        len = encode_application_null(&apdu[apdu_len]);
-                    else {
-                        real_value = Analog_Output_Level[object_index][i];
-                        len =
-                            encode_application_real(&apdu[apdu_len],
-                            real_value);
-                    }
-                    /* add it if we have room */
-                    if ((apdu_len + len) < MAX_APDU)
-                        apdu_len += len;
-                    else {
-                        rpdata->error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        apdu_len = BACNET_STATUS_ABORT;
-                        break;
+                    if (Analog_Output_Level[object_index][i] != AO_LEVEL_NULL) {
+                        priority_values[i] =
+                            Analog_Output_Level[object_index][i];
+                        active_bits |= (1 << i);
                     }
                 }
+                apdu_len =
+                    encode_application_real_priority_array(&apdu[0],
+                    MAX_APDU, priority_values, active_bits);
+                if (apdu_len == BACNET_STATUS_ERROR) {
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                    apdu_len = BACNET_STATUS_ABORT;
+                }
             } else {
                 object_index =
                     Analog_Output_Instance_To_Index(rpdata->object_instance);
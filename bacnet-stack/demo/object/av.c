@@ -39,6 +39,8 @@
 #include "config.h"     /* the custom stuff */
 #include "device.h"
 #include "handlers.h"
+#include "evindex.h"
+#include "evsched.h"
 #include "av.h"
 
 
@@ -97,6 +99,25 @@ void Analog_Value_Property_Lists(
     return;
 }
 
+#if defined(INTRINSIC_REPORTING)
+/* add the object to the active event index, or remove it */
+static void Analog_Value_Event_Index_Update(
+    unsigned index)
+{
+    bool active = false;
+    unsigned j;
+
+    active = (AV_Descr[index].Event_State != EVENT_STATE_NORMAL);
+    for (j = 0; j < MAX_BACNET_EVENT_TRANSITION; j++) {
+        if (!AV_Descr[index].Acked_Transitions[j].bIsAcked) {
+            active = true;
+        }
+    }
+    (void) evindex_update(OBJECT_ANALOG_VALUE,
+        Analog_Value_Index_To_Instance(index), index, active);
+}
+#endif
+
 void Analog_Value_Init(
     void)
 {
@@ -128,6 +149,12 @@ void Analog_Value_Init(
         /* Set handler for GetAlarmSummary Service */
         handler_get_alarm_summary_set(OBJECT_ANALOG_VALUE,
             Analog_Value_Alarm_Summary);
+        /* Keep the active events in the event index */
+        evindex_maintain(OBJECT_ANALOG_VALUE);
+        Analog_Value_Event_Index_Update(i);
+        evsched_timer_init(&AV_Descr[i].Event_Timer, OBJECT_ANALOG_VALUE,
+            Analog_Value_Index_To_Instance(i));
+        evsched_schedule(&AV_Descr[i].Event_Timer, 0);
 #endif
     }
 }
@@ -196,6 +223,9 @@ bool Analog_Value_Present_Value_Set(
     index = Analog_Value_Instance_To_Index(object_instance);
     if (index < MAX_ANALOG_VALUES) {
         AV_Descr[index].Present_Value = value;
+#if defined(INTRINSIC_REPORTING)
+        evsched_schedule(&AV_Descr[index].Event_Timer, 0);
+#endif
         status = true;
     }
     return status;
@@ -670,6 +700,13 @@ bool Analog_Value_Write_Property(
             break;
     }
 
+#if defined(INTRINSIC_REPORTING)
+    if (status) {
+        /* the event state may depend on the property */
+        evsched_schedule(&CurrentAV->Event_Timer, 0);
+    }
+#endif
+
     return status;
 }
 
@@ -703,6 +740,8 @@ void Analog_Value_Intrinsic_Reporting(
     if (CurrentAV->Ack_notify_data.bSendAckNotify) {
         /* clean bSendAckNotify flag */
         CurrentAV->Ack_notify_data.bSendAckNotify = false;
+        /* the event state is evaluated again in the next second */
+        evsched_schedule(&CurrentAV->Event_Timer, 1);
         /* copy toState */
         ToState = CurrentAV->Ack_notify_data.EventState;
 
@@ -736,8 +775,10 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_OFFNORMAL)) {
                     if (!CurrentAV->Remaining_Time_Delay)
                         CurrentAV->Event_State = EVENT_STATE_HIGH_LIMIT;
-                    else
+                    else {
                         CurrentAV->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAV->Event_Timer, 1);
+                    }
                     break;
                 }
 
@@ -753,8 +794,10 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_OFFNORMAL)) {
                     if (!CurrentAV->Remaining_Time_Delay)
                         CurrentAV->Event_State = EVENT_STATE_LOW_LIMIT;
-                    else
+                    else {
                         CurrentAV->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAV->Event_Timer, 1);
+                    }
                     break;
                 }
                 /* value of the object is still in the same event state */
@@ -775,8 +818,10 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_NORMAL)) {
                     if (!CurrentAV->Remaining_Time_Delay)
                         CurrentAV->Event_State = EVENT_STATE_NORMAL;
-                    else
+                    else {
                         CurrentAV->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAV->Event_Timer, 1);
+                    }
                     break;
                 }
                 /* value of the object is still in the same event state */
@@ -798,8 +843,10 @@ void Analog_Value_Intrinsic_Reporting(
                         EVENT_ENABLE_TO_NORMAL)) {
                     if (!CurrentAV->Remaining_Time_Delay)
                         CurrentAV->Event_State = EVENT_STATE_NORMAL;
-                    else
+                    else {
                         CurrentAV->Remaining_Time_Delay--;
+                        evsched_schedule(&CurrentAV->Event_Timer, 1);
+                    }
                     break;
                 }
                 /* value of the object is still in the same event state */
@@ -967,6 +1014,7 @@ void Analog_Value_Intrinsic_Reporting(
                     break;
             }
         }
+        Analog_Value_Event_Index_Update(object_index);
     }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
@@ -1143,7 +1191,9 @@ int Analog_Value_Alarm_Ack(
 
     /* Need to send AckNotification. */
     CurrentAV->Ack_notify_data.bSendAckNotify = true;
+    evsched_schedule(&CurrentAV->Event_Timer, 0);
     CurrentAV->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Analog_Value_Event_Index_Update(object_index);
 
     /* Return OK */
     return 1;
@@ -37,6 +37,7 @@
 #include "alarm_ack.h"
 #include "getevent.h"
 #include "get_alarm_sum.h"
+#include "evsched.h"
 #endif
 
 #ifdef __cplusplus
@@ -63,6 +64,8 @@ extern "C" {
         uint32_t Remaining_Time_Delay;
         /* AckNotification informations */
         ACK_NOTIFICATION Ack_notify_data;
+        /* next evaluation of the event state */
+        BACNET_EVENT_TIMER Event_Timer;
 #endif
     } ANALOG_VALUE_DESCR;
 
@@ -37,6 +37,7 @@
 #include "cov.h"
 #include "config.h"     /* the custom stuff */
 #include "bi.h"
+#include "device.h"
 #include "handlers.h"
 
 #ifndef MAX_BINARY_INPUTS
@@ -281,8 +282,9 @@ bool Binary_Input_Present_Value_Set(
         }
         if (Present_Value[index] != value) {
             Change_Of_Value[index] = true;
+            Present_Value[index] = value;
+            Device_COV_Changed(OBJECT_BINARY_INPUT, object_instance);
         }
-        Present_Value[index] = value;
         status = true;
     }
 
@@ -299,8 +301,9 @@ void Binary_Input_Out_Of_Service_Set(
     if (index < MAX_BINARY_INPUTS) {
         if (Out_Of_Service[index] != value) {
             Change_Of_Value[index] = true;
+            Out_Of_Service[index] = value;
+            Device_COV_Changed(OBJECT_BINARY_INPUT, object_instance);
         }
-        Out_Of_Service[index] = value;
     }
 
     return;
@@ -353,6 +356,60 @@ bool Binary_Input_Polarity_Set(
     return status;
 }
 
+/* gets the value of a property without encoding it;
+   returns false for the properties that must be read */
+bool Binary_Input_Value_Get(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    bool status = true;
+
+    if ((Binary_Input_Instance_To_Index(object_instance) >=
+            MAX_BINARY_INPUTS) || (value == NULL)) {
+        return false;
+    }
+    value->context_specific = false;
+    value->next = NULL;
+    switch (object_property) {
+        case PROP_PRESENT_VALUE:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+            value->type.Enumerated =
+                Binary_Input_Present_Value(object_instance);
+            break;
+        case PROP_STATUS_FLAGS:
+            value->tag = BACNET_APPLICATION_TAG_BIT_STRING;
+            bitstring_init(&value->type.Bit_String);
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_IN_ALARM,
+                false);
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_FAULT,
+                false);
+            bitstring_set_bit(&value->type.Bit_String,
+                STATUS_FLAG_OVERRIDDEN, false);
+            bitstring_set_bit(&value->type.Bit_String,
+                STATUS_FLAG_OUT_OF_SERVICE,
+                Binary_Input_Out_Of_Service(object_instance));
+            break;
+        case PROP_EVENT_STATE:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+            value->type.Enumerated = EVENT_STATE_NORMAL;
+            break;
+        case PROP_OUT_OF_SERVICE:
+            value->tag = BACNET_APPLICATION_TAG_BOOLEAN;
+            value->type.Boolean = Binary_Input_Out_Of_Service(object_instance);
+            break;
+        case PROP_POLARITY:
+            value->tag = BACNET_APPLICATION_TAG_ENUMERATED;
+            value->type.Enumerated = Binary_Input_Polarity(object_instance);
+            break;
+        default:
+            status = false;
+            break;
+    }
+
+    return status;
+}
+
 /* return apdu length, or BACNET_STATUS_ERROR on error */
 /* assumption - object already exists, and has been bounds checked */
 int Binary_Input_Read_Property(
@@ -534,6 +591,14 @@ bool WPValidateArgType(
     return false;
 }
 
+void Device_COV_Changed(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    object_type = object_type;
+    object_instance = object_instance;
+}
+
 void testBinaryInput(
     Test * pTest)
 {
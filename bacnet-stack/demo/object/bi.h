@@ -97,6 +97,10 @@ extern "C" {
     bool Binary_Input_Encode_Value_List(
         uint32_t object_instance,
         BACNET_PROPERTY_VALUE * value_list);
+    bool Binary_Input_Value_Get(
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        BACNET_APPLICATION_DATA_VALUE * value);
     bool Binary_Input_Change_Of_Value(
         uint32_t instance);
     void Binary_Input_Change_Of_Value_Clear(
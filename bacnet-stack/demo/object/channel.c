@@ -1371,6 +1371,7 @@ int Channel_Read_Property(BACNET_READ_PROPERTY_DATA * rpdata)
     BACNET_CHARACTER_STRING char_string;
     BACNET_CHANNEL_VALUE * cvalue = NULL;
     uint32_t unsigned_value = 0;
+    uint32_t control_groups[CONTROL_GROUPS_MAX] = { 0 };
     unsigned i = 0;
     unsigned count = 0;
     bool state = false;
@@ -1484,20 +1485,15 @@ int Channel_Read_Property(BACNET_READ_PROPERTY_DATA * rpdata)
                 /* if no index was specified, then try to encode the entire list */
                 /* into one packet. */
                 for (i = 1; i <= CONTROL_GROUPS_MAX; i++) {
-                    unsigned_value = Channel_Control_Groups_Element(
+                    control_groups[i - 1] = Channel_Control_Groups_Element(
                         rpdata->object_instance, i);
-                    len =
-                        encode_application_unsigned(&apdu[apdu_len],
-                        unsigned_value);
-                    /* add it if we have room */
-                    if ((apdu_len + len) < MAX_APDU) {
-                        apdu_len += len;
-                    } else {
-                        rpdata->error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        apdu_len = BACNET_STATUS_ABORT;
-                        break;
-                    }
+                }
+                apdu_len = encode_application_unsigned_array(&apdu[0],
+                    MAX_APDU, control_groups, CONTROL_GROUPS_MAX);
+                if (apdu_len == BACNET_STATUS_ERROR) {
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                    apdu_len = BACNET_STATUS_ABORT;
                 }
             } else {
                 /* a specific element was requested */
@@ -35,6 +35,9 @@
 #include "config.h"     /* the custom stuff */
 #include "rp.h"
 #include "wp.h"
+#include "propcache.h"
+#include "strpool.h"
+#include "device.h"
 #include "csv.h"
 #include "handlers.h"
 
@@ -47,8 +50,8 @@
 static BACNET_CHARACTER_STRING Present_Value[MAX_CHARACTERSTRING_VALUES];
 /* Writable out-of-service allows others to manipulate our Present Value */
 static bool Out_Of_Service[MAX_CHARACTERSTRING_VALUES];
-static char Object_Name[MAX_CHARACTERSTRING_VALUES][64];
-static char Object_Description[MAX_CHARACTERSTRING_VALUES][64];
+static BACNET_STRING_HANDLE Object_Name[MAX_CHARACTERSTRING_VALUES];
+static BACNET_STRING_HANDLE Object_Description[MAX_CHARACTERSTRING_VALUES];
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = {
@@ -201,15 +204,15 @@ static void CharacterString_Value_Out_Of_Service_Set(
     return;
 }
 
-static char *CharacterString_Value_Description(
+static const char *CharacterString_Value_Description(
     uint32_t object_instance)
 {
     unsigned index = 0; /* offset from instance lookup */
-    char *pName = NULL; /* return value */
+    const char *pName = NULL;   /* return value */
 
     index = CharacterString_Value_Instance_To_Index(object_instance);
     if (index < MAX_CHARACTERSTRING_VALUES) {
-        pName = Object_Description[index];
+        pName = strpool_string(Object_Description[index]);
     }
 
     return pName;
@@ -220,24 +223,12 @@ bool CharacterString_Value_Description_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
     bool status = false;        /* return value */
 
     index = CharacterString_Value_Instance_To_Index(object_instance);
     if (index < MAX_CHARACTERSTRING_VALUES) {
-        status = true;
-        if (new_name) {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = 0;
-            }
-        }
+        status = strpool_intern_ansi(new_name, &Object_Description[index]);
+        propcache_invalidate(OBJECT_CHARACTERSTRING_VALUE, object_instance);
     }
 
     return status;
@@ -252,7 +243,7 @@ bool CharacterString_Value_Object_Name(
 
     index = CharacterString_Value_Instance_To_Index(object_instance);
     if (index < MAX_CHARACTERSTRING_VALUES) {
-        status = characterstring_init_ansi(object_name, Object_Name[index]);
+        status = strpool_characterstring(object_name, Object_Name[index]);
     }
 
     return status;
@@ -264,24 +255,16 @@ bool CharacterString_Value_Name_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
+    BACNET_STRING_HANDLE old_name = 0;
     bool status = false;        /* return value */
 
     index = CharacterString_Value_Instance_To_Index(object_instance);
     if (index < MAX_CHARACTERSTRING_VALUES) {
-        status = true;
         /* FIXME: check to see if there is a matching name */
-        if (new_name) {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = 0;
-            }
+        old_name = Object_Name[index];
+        status = strpool_intern_ansi(new_name, &Object_Name[index]);
+        if (Object_Name[index] != old_name) {
+            Device_Inc_Database_Revision();
         }
     }
 
@@ -461,6 +444,11 @@ bool WPValidateArgType(
     return false;
 }
 
+void Device_Inc_Database_Revision(
+    void)
+{
+}
+
 void testCharacterStringValue(
     Test * pTest)
 {
@@ -471,6 +459,9 @@ void testCharacterStringValue(
     uint16_t decoded_type = 0;
     uint32_t decoded_instance = 0;
     BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_CHARACTER_STRING char_string;
+    char name[64] = "";
+    unsigned i = 0;
 
     CharacterString_Value_Init();
     rpdata.application_data = &apdu[0];
@@ -486,6 +477,14 @@ void testCharacterStringValue(
     len = decode_object_id(&apdu[len], &decoded_type, &decoded_instance);
     ct_test(pTest, decoded_type == rpdata.object_type);
     ct_test(pTest, decoded_instance == rpdata.object_instance);
+    /* renames free the old names, so they never fill the pool */
+    for (i = 0; i < 10000; i++) {
+        sprintf(name, "CHARACTERSTRING VALUE RENAMED %u", i);
+        ct_test(pTest, CharacterString_Value_Name_Set(0, name));
+        ct_test(pTest, CharacterString_Value_Description_Set(0, name));
+    }
+    ct_test(pTest, CharacterString_Value_Object_Name(0, &char_string));
+    ct_test(pTest, characterstring_ansi_same(&char_string, name));
 
     return;
 }
@@ -132,7 +132,8 @@ static object_functions_t Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {MAX_BACNET_OBJECT_TYPE,
             NULL /* Init */ ,
             NULL /* Count */ ,
@@ -147,7 +148,8 @@ static object_functions_t Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ }
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ }
 };
 
 /** Glue function to let the Device object, when called by a handler,
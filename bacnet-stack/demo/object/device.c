@@ -28,6 +28,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>     /* for realloc */
 #include <string.h>     /* for memmove */
 #include <time.h>       /* for timezone, localtime */
 #include "bacdef.h"
@@ -44,6 +45,9 @@
 #include "handlers.h"
 #include "datalink.h"
 #include "address.h"
+#include "propcache.h"
+#include "evindex.h"
+#include "evsched.h"
 /* os specfic includes */
 #include "timer.h"
 /* include the device object */
@@ -97,6 +101,26 @@ extern bool Routed_Device_Write_Property_Local(
 /* may be overridden by outside table */
 static object_functions_t *Object_Table;
 
+/* The Object_List as one array of object identifiers, so that an
+   element can be found without walking the object table.  It is
+   allocated for the number of objects and built from the object table
+   when first used, and built again after the database revision or the
+   number of objects changed.  If it can't be allocated, the object
+   table is walked instead. */
+static uint32_t *Object_List;
+static unsigned Object_List_Size;
+static unsigned Object_List_Count;
+static bool Object_List_Valid;
+/* The object names hashed to their place in the Object_List array plus
+   one, zero for an empty slot, so that a name is found without reading
+   the name of every object.  Twice the size of the Object_List array,
+   and built with it when a name is first looked up.  Objects that can
+   be renamed increment the database revision, which is what makes the
+   index stale. */
+static unsigned *Object_Name_Index;
+static unsigned Object_Name_Index_Size;
+static bool Object_Name_Index_Valid;
+
 static object_functions_t My_Object_Table[] = {
     {OBJECT_DEVICE,
             NULL /* Init - don't init Device or it will recourse! */ ,
@@ -112,7 +136,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_ANALOG_INPUT,
             Analog_Input_Init,
             Analog_Input_Count,
@@ -127,7 +152,8 @@ static object_functions_t My_Object_Table[] = {
             Analog_Input_Encode_Value_List,
             Analog_Input_Change_Of_Value,
             Analog_Input_Change_Of_Value_Clear,
-        Analog_Input_Intrinsic_Reporting},
+            Analog_Input_Intrinsic_Reporting,
+        Analog_Input_Value_Get},
     {OBJECT_ANALOG_OUTPUT,
             Analog_Output_Init,
             Analog_Output_Count,
@@ -142,7 +168,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_ANALOG_VALUE,
             Analog_Value_Init,
             Analog_Value_Count,
@@ -157,7 +184,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        Analog_Value_Intrinsic_Reporting},
+            Analog_Value_Intrinsic_Reporting,
+        NULL /* Value Get */ },
     {OBJECT_BINARY_INPUT,
             Binary_Input_Init,
             Binary_Input_Count,
@@ -172,7 +200,8 @@ static object_functions_t My_Object_Table[] = {
             Binary_Input_Encode_Value_List,
             Binary_Input_Change_Of_Value,
             Binary_Input_Change_Of_Value_Clear,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        Binary_Input_Value_Get},
     {OBJECT_BINARY_OUTPUT,
             Binary_Output_Init,
             Binary_Output_Count,
@@ -187,7 +216,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_BINARY_VALUE,
             Binary_Value_Init,
             Binary_Value_Count,
@@ -202,7 +232,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_CHARACTERSTRING_VALUE,
             CharacterString_Value_Init,
             CharacterString_Value_Count,
@@ -217,7 +248,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_COMMAND,
             Command_Init,
             Command_Count,
@@ -232,7 +264,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_INTEGER_VALUE,
             Integer_Value_Init,
             Integer_Value_Count,
@@ -247,7 +280,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
 #if defined(INTRINSIC_REPORTING)
     {OBJECT_NOTIFICATION_CLASS,
             Notification_Class_Init,
@@ -263,7 +297,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
 #endif
     {OBJECT_LIFE_SAFETY_POINT,
             Life_Safety_Point_Init,
@@ -279,7 +314,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_LOAD_CONTROL,
             Load_Control_Init,
             Load_Control_Count,
@@ -294,7 +330,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_MULTI_STATE_INPUT,
             Multistate_Input_Init,
             Multistate_Input_Count,
@@ -309,7 +346,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_MULTI_STATE_OUTPUT,
             Multistate_Output_Init,
             Multistate_Output_Count,
@@ -324,7 +362,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_MULTI_STATE_VALUE,
             Multistate_Value_Init,
             Multistate_Value_Count,
@@ -339,7 +378,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_TRENDLOG,
             Trend_Log_Init,
             Trend_Log_Count,
@@ -354,7 +394,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
 #if (BACNET_PROTOCOL_REVISION >= 14)
     {OBJECT_LIGHTING_OUTPUT,
             Lighting_Output_Init,
@@ -370,7 +411,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_CHANNEL,
             Channel_Init,
             Channel_Count,
@@ -385,7 +427,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
 #endif
 #if defined(BACFILE)
     {OBJECT_FILE,
@@ -402,7 +445,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
 #endif
     {OBJECT_OCTETSTRING_VALUE,
             OctetString_Value_Init,
@@ -418,7 +462,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_POSITIVE_INTEGER_VALUE,
             PositiveInteger_Value_Init,
             PositiveInteger_Value_Count,
@@ -433,7 +478,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_SCHEDULE,
             Schedule_Init,
             Schedule_Count,
@@ -448,7 +494,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {MAX_BACNET_OBJECT_TYPE,
             NULL /* Init */ ,
             NULL /* Count */ ,
@@ -463,7 +510,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ }
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ }
 };
 
 /** Glue function to let the Device object, when called by a handler,
@@ -646,6 +694,10 @@ static const int Device_Properties_Optional[] = {
     PROP_DAYLIGHT_SAVINGS_STATUS,
     PROP_LOCATION,
     PROP_ACTIVE_COV_SUBSCRIPTIONS,
+#if MAX_SEGMENTS
+    PROP_MAX_SEGMENTS_ACCEPTED,
+    PROP_APDU_SEGMENT_TIMEOUT,
+#endif
 #if defined(BACNET_TIME_MASTER)
     PROP_TIME_SYNCHRONIZATION_RECIPIENTS,
     PROP_TIME_SYNCHRONIZATION_INTERVAL,
@@ -807,6 +859,8 @@ bool Device_Set_Object_Name(
 
 bool Device_Object_Name_ANSI_Init(const char * value)
 {
+    propcache_invalidate(OBJECT_DEVICE, Object_Instance_Number);
+    Object_Name_Index_Valid = false;
     return characterstring_init_ansi(&My_Object_Name, value);
 }
 
@@ -966,6 +1020,7 @@ bool Device_Set_Description(
     if (length < sizeof(Description)) {
         memmove(Description, name, length);
         Description[length] = 0;
+        propcache_invalidate(OBJECT_DEVICE, Object_Instance_Number);
         status = true;
     }
 
@@ -1008,7 +1063,12 @@ uint8_t Device_Protocol_Revision(
 BACNET_SEGMENTATION Device_Segmentation_Supported(
     void)
 {
+#if MAX_SEGMENTS
+    /* large ComplexACKs are sent segmented */
+    return SEGMENTATION_TRANSMIT;
+#else
     return SEGMENTATION_NONE;
+#endif
 }
 
 uint32_t Device_Database_Revision(
@@ -1032,6 +1092,10 @@ void Device_Inc_Database_Revision(
     void)
 {
     Database_Revision++;
+    /* objects were added, removed, renamed or renumbered */
+    Object_List_Valid = false;
+    Object_Name_Index_Valid = false;
+    propcache_invalidate_all();
 }
 
 /** Get the total count of objects supported by this Device Object.
@@ -1057,17 +1121,9 @@ unsigned Device_Object_List_Count(
     return count;
 }
 
-/** Lookup the Object at the given array index in the Device's Object List.
- * Even though we don't keep a single linear array of objects in the Device,
- * this method acts as though we do and works through a virtual, concatenated
- * array of all of our object type arrays.
- *
- * @param array_index [in] The desired array index (1 to N)
- * @param object_type [out] The object's type, if found.
- * @param instance [out] The object's instance number, if found.
- * @return True if found, else false.
- */
-bool Device_Object_List_Identifier(
+/* Lookup the Object at the given array index by walking through a
+   virtual, concatenated array of all of our object type arrays. */
+static bool Device_Object_List_Walk(
     unsigned array_index,
     int *object_type,
     uint32_t * instance)
@@ -1118,6 +1174,252 @@ bool Device_Object_List_Identifier(
     return status;
 }
 
+/* Build the Object_List array from the object table, once for every
+   type: the iterator of a type is stepped from one object to the next
+   rather than from the first object again. */
+static void Device_Object_List_Build(
+    unsigned count)
+{
+    unsigned index = 0;
+    unsigned object_count = 0;
+    unsigned object_index = 0;
+    unsigned i = 0;
+    struct object_functions *pObject = NULL;
+
+    pObject = Object_Table;
+    while ((pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) &&
+        (index < count)) {
+        if (pObject->Object_Count && pObject->Object_Index_To_Instance) {
+            object_count = pObject->Object_Count();
+            if (pObject->Object_Iterator) {
+                object_index = pObject->Object_Iterator(~(unsigned) 0);
+            } else {
+                object_index = 0;
+            }
+            for (i = 0; (i < object_count) && (index < count); i++) {
+                Object_List[index] = BACNET_ID_VALUE(
+                    pObject->Object_Index_To_Instance(object_index),
+                    pObject->Object_Type);
+                index++;
+                if (pObject->Object_Iterator) {
+                    object_index = pObject->Object_Iterator(object_index);
+                } else {
+                    object_index++;
+                }
+            }
+        } else if (pObject->Object_Count) {
+            /* no identifiers for these: keep to the walk */
+            index = 0;
+            break;
+        }
+        pObject++;
+    }
+    Object_List_Count = index;
+    Object_List_Valid = (index == count);
+    Object_Name_Index_Valid = false;
+}
+
+/* Grow the Object_List array and the name index for a number of
+   objects.  Returns false if there is not enough memory for them. */
+static bool Device_Object_List_Alloc(
+    unsigned count)
+{
+    uint32_t *object_list = NULL;
+    unsigned *name_index = NULL;
+
+    if (count > (SIZE_MAX / sizeof(unsigned)) / 2) {
+        return false;
+    }
+    object_list = realloc(Object_List, count * sizeof(uint32_t));
+    if (!object_list) {
+        return false;
+    }
+    Object_List = object_list;
+    name_index = realloc(Object_Name_Index, 2 * count * sizeof(unsigned));
+    if (!name_index) {
+        return false;
+    }
+    Object_Name_Index = name_index;
+    Object_List_Size = count;
+    Object_Name_Index_Size = 2 * count;
+    Object_Name_Index_Valid = false;
+
+    return true;
+}
+
+/* Make sure the Object_List array holds the current objects.
+   Returns the number of objects, or zero if the array can't hold them */
+static unsigned Device_Object_List_Refresh(
+    void)
+{
+    unsigned count = 0;
+
+    count = Device_Object_List_Count();
+    if ((count == 0) ||
+        ((count > Object_List_Size) && !Device_Object_List_Alloc(count))) {
+        Object_List_Valid = false;
+        return 0;
+    }
+    if ((!Object_List_Valid) || (count != Object_List_Count)) {
+        Device_Object_List_Build(count);
+        if (!Object_List_Valid) {
+            return 0;
+        }
+    }
+
+    return count;
+}
+
+/** Lookup the Object at the given array index in the Device's Object List.
+ * Objects are kept in the arrays of their object types, which together
+ * act as one array; a copy of that array is kept in the Device so that
+ * reading the Object List element by element takes linear time.
+ *
+ * @param array_index [in] The desired array index (1 to N)
+ * @param object_type [out] The object's type, if found.
+ * @param instance [out] The object's instance number, if found.
+ * @return True if found, else false.
+ */
+bool Device_Object_List_Identifier(
+    unsigned array_index,
+    int *object_type,
+    uint32_t * instance)
+{
+    unsigned count = 0;
+
+    count = Device_Object_List_Refresh();
+    if (count == 0) {
+        return Device_Object_List_Walk(array_index, object_type, instance);
+    }
+    if ((array_index == 0) || (array_index > count)) {
+        return false;
+    }
+    *object_type = BACNET_TYPE(Object_List[array_index - 1]);
+    *instance = BACNET_INSTANCE(Object_List[array_index - 1]);
+
+    return true;
+}
+
+/** Encode the elements of the Object List, starting at an array index,
+ * for as long as they fit.
+ *
+ * @param apdu [out] Where the object identifiers go
+ * @param apdu_max [in] Number of octets that may be used
+ * @param array_index [in,out] The first array index to encode (1 to N)
+ *  on entry, and the first one that was not encoded on return
+ * @return The number of octets encoded, or BACNET_STATUS_ERROR if an
+ *  object could not be found
+ */
+int Device_Object_List_Encode(
+    uint8_t * apdu,
+    int apdu_max,
+    unsigned *array_index)
+{
+    int apdu_len = 0;
+    unsigned count = 0;
+    unsigned i = 0;
+    int object_type = 0;
+    uint32_t instance = 0;
+
+    count = Device_Object_List_Refresh();
+    if (count) {
+        for (i = *array_index; i <= count; i++) {
+            /* each object identifier takes five octets */
+            if ((apdu_len + 5) > apdu_max) {
+                break;
+            }
+            apdu_len += encode_application_object_id(&apdu[apdu_len],
+                BACNET_TYPE(Object_List[i - 1]),
+                BACNET_INSTANCE(Object_List[i - 1]));
+        }
+    } else {
+        count = Device_Object_List_Count();
+        for (i = *array_index; i <= count; i++) {
+            if ((apdu_len + 5) > apdu_max) {
+                break;
+            }
+            if (!Device_Object_List_Walk(i, &object_type, &instance)) {
+                return BACNET_STATUS_ERROR;
+            }
+            apdu_len += encode_application_object_id(&apdu[apdu_len],
+                object_type, instance);
+        }
+    }
+    *array_index = i;
+
+    return apdu_len;
+}
+
+/* FNV-1a hash of the octets of an object name */
+static unsigned Device_Object_Name_Hash(
+    BACNET_CHARACTER_STRING * object_name)
+{
+    uint32_t hash = 2166136261UL;
+    const char *value = NULL;
+    size_t length = 0;
+    size_t i = 0;
+
+    value = characterstring_value(object_name);
+    length = characterstring_length(object_name);
+    for (i = 0; i < length; i++) {
+        hash ^= (uint8_t) value[i];
+        hash *= 16777619UL;
+    }
+
+    return (unsigned) (hash % Object_Name_Index_Size);
+}
+
+/* Hash the names of the objects in the Object_List array.  Objects
+   are added in list order, so that of two objects with the same name
+   the one earlier in the list is found first. */
+static void Device_Object_Name_Index_Build(
+    unsigned count)
+{
+    unsigned i = 0;
+    unsigned slot = 0;
+    BACNET_CHARACTER_STRING object_name;
+
+    memset(Object_Name_Index, 0,
+        Object_Name_Index_Size * sizeof(Object_Name_Index[0]));
+    for (i = 0; i < count; i++) {
+        if (Device_Object_Name_Copy((BACNET_OBJECT_TYPE)
+                BACNET_TYPE(Object_List[i]), BACNET_INSTANCE(Object_List[i]),
+                &object_name)) {
+            slot = Device_Object_Name_Hash(&object_name);
+            while (Object_Name_Index[slot]) {
+                slot = (slot + 1) % Object_Name_Index_Size;
+            }
+            Object_Name_Index[slot] = i + 1;
+        }
+    }
+    Object_Name_Index_Valid = true;
+}
+
+/* Look up an object name in the name index.
+   Returns the place of the object in the Object_List array plus one,
+   or zero if no object has that name */
+static unsigned Device_Object_Name_Index_Find(
+    BACNET_CHARACTER_STRING * object_name)
+{
+    unsigned slot = 0;
+    unsigned position = 0;
+    BACNET_CHARACTER_STRING object_name2;
+
+    slot = Device_Object_Name_Hash(object_name);
+    while (Object_Name_Index[slot]) {
+        position = Object_Name_Index[slot];
+        if (Device_Object_Name_Copy((BACNET_OBJECT_TYPE)
+                BACNET_TYPE(Object_List[position - 1]),
+                BACNET_INSTANCE(Object_List[position - 1]), &object_name2) &&
+            characterstring_same(object_name, &object_name2)) {
+            return position;
+        }
+        slot = (slot + 1) % Object_Name_Index_Size;
+    }
+
+    return 0;
+}
+
 /** Determine if we have an object with the given object_name.
  * If the object_type and object_instance pointers are not null,
  * and the lookup succeeds, they will be given the resulting values.
@@ -1139,6 +1441,24 @@ bool Device_Valid_Object_Name(
     BACNET_CHARACTER_STRING object_name2;
     struct object_functions *pObject = NULL;
 
+    max_objects = Device_Object_List_Refresh();
+    if (max_objects) {
+        if (!Object_Name_Index_Valid) {
+            Device_Object_Name_Index_Build(max_objects);
+        }
+        i = Device_Object_Name_Index_Find(object_name1);
+        if (i) {
+            found = true;
+            if (object_type) {
+                *object_type = BACNET_TYPE(Object_List[i - 1]);
+            }
+            if (object_instance) {
+                *object_instance = BACNET_INSTANCE(Object_List[i - 1]);
+            }
+        }
+
+        return found;
+    }
     max_objects = Device_Object_List_Count();
     for (i = 1; i <= max_objects; i++) {
         check_id = Device_Object_List_Identifier(i, &type, &instance);
@@ -1366,7 +1686,6 @@ int Device_Read_Property_Local(
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
     int apdu_len = 0;   /* return value */
-    int len = 0;        /* apdu len intermediate value */
     BACNET_BIT_STRING bit_string = { 0 };
     BACNET_CHARACTER_STRING char_string = { 0 };
     unsigned i = 0;
@@ -1501,31 +1820,18 @@ int Device_Read_Property_Local(
             /* to return an error if the number of encoded objects exceeds */
             /* your maximum APDU size. */
             else if (rpdata->array_index == BACNET_ARRAY_ALL) {
-                for (i = 1; i <= count; i++) {
-                    found =
-                        Device_Object_List_Identifier(i, &object_type,
-                        &instance);
-                    if (found) {
-                        len =
-                            encode_application_object_id(&apdu[apdu_len],
-                            object_type, instance);
-                        apdu_len += len;
-                        /* assume next one is the same size as this one */
-                        /* can we all fit into the APDU? Don't check for last entry */
-                        if ((i != count) && (apdu_len + len) >= apdu_max) {
-                            /* Abort response */
-                            rpdata->error_code =
-                                ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                            apdu_len = BACNET_STATUS_ABORT;
-                            break;
-                        }
-                    } else {
-                        /* error: internal error? */
-                        rpdata->error_class = ERROR_CLASS_SERVICES;
-                        rpdata->error_code = ERROR_CODE_OTHER;
-                        apdu_len = BACNET_STATUS_ERROR;
-                        break;
-                    }
+                i = 1;
+                apdu_len = Device_Object_List_Encode(&apdu[0], apdu_max, &i);
+                if (apdu_len < 0) {
+                    /* error: internal error? */
+                    rpdata->error_class = ERROR_CLASS_SERVICES;
+                    rpdata->error_code = ERROR_CODE_OTHER;
+                    apdu_len = BACNET_STATUS_ERROR;
+                } else if (i <= count) {
+                    /* Abort response */
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                    apdu_len = BACNET_STATUS_ABORT;
                 }
             } else {
                 found =
@@ -1556,6 +1862,15 @@ int Device_Read_Property_Local(
         case PROP_NUMBER_OF_APDU_RETRIES:
             apdu_len = encode_application_unsigned(&apdu[0], apdu_retries());
             break;
+#if MAX_SEGMENTS
+        case PROP_MAX_SEGMENTS_ACCEPTED:
+            apdu_len = encode_application_unsigned(&apdu[0], MAX_SEGMENTS);
+            break;
+        case PROP_APDU_SEGMENT_TIMEOUT:
+            apdu_len =
+                encode_application_unsigned(&apdu[0], apdu_segment_timeout());
+            break;
+#endif
         case PROP_DEVICE_ADDRESS_BINDING:
             apdu_len = address_list_encode(&apdu[0], apdu_max);
             break;
@@ -1617,9 +1932,39 @@ int Device_Read_Property_Local(
     return apdu_len;
 }
 
+/* Encodes the Value of a Property of a valid Object */
+static int Device_Read_Property_Object(
+    struct object_functions *pObject,
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    int apdu_len = BACNET_STATUS_ERROR;
+#if (BACNET_PROTOCOL_REVISION >= 14)
+    struct special_property_list_t property_list;
+
+    if ((int)rpdata->object_property == PROP_PROPERTY_LIST) {
+        Device_Objects_Property_List(
+            rpdata->object_type,
+            rpdata->object_instance,
+            &property_list);
+        apdu_len = property_list_encode(
+            rpdata,
+            property_list.Required.pList,
+            property_list.Optional.pList,
+            property_list.Proprietary.pList);
+    } else
+#endif
+    {
+        apdu_len = pObject->Object_Read_Property(rpdata);
+    }
+
+    return apdu_len;
+}
+
 /** Looks up the requested Object and Property, and encodes its Value in an APDU.
  * @ingroup ObjIntf
  * If the Object or Property can't be found, sets the error class and code.
+ * Values of Properties that seldom change come from the property cache
+ * when it is enabled (see MAX_PROPERTY_CACHE).
  *
  * @param rpdata [in,out] Structure with the desired Object and Property info
  *                 on entry, and APDU message on return.
@@ -1630,9 +1975,6 @@ int Device_Read_Property(
 {
     int apdu_len = BACNET_STATUS_ERROR;
     struct object_functions *pObject = NULL;
-#if (BACNET_PROTOCOL_REVISION >= 14)
-    struct special_property_list_t property_list;
-#endif
 
     /* initialize the default return values */
     rpdata->error_class = ERROR_CLASS_OBJECT;
@@ -1642,22 +1984,15 @@ int Device_Read_Property(
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(rpdata->object_instance)) {
             if (pObject->Object_Read_Property) {
-#if (BACNET_PROTOCOL_REVISION >= 14)
-                if ((int)rpdata->object_property == PROP_PROPERTY_LIST) {
-                    Device_Objects_Property_List(
-                        rpdata->object_type,
-                        rpdata->object_instance,
-                        &property_list);
-                    apdu_len = property_list_encode(
-                        rpdata,
-                        property_list.Required.pList,
-                        property_list.Optional.pList,
-                        property_list.Proprietary.pList);
-                } else
-#endif
-                {
-                    apdu_len = pObject->Object_Read_Property(rpdata);
+#if MAX_PROPERTY_CACHE
+                apdu_len = propcache_read(rpdata);
+                if (apdu_len < 0) {
+                    apdu_len = Device_Read_Property_Object(pObject, rpdata);
+                    propcache_store(rpdata, apdu_len);
                 }
+#else
+                apdu_len = Device_Read_Property_Object(pObject, rpdata);
+#endif
             }
         }
     }
@@ -1730,6 +2065,16 @@ bool Device_Write_Property_Local(
                 apdu_timeout_set((uint16_t) value.type.Unsigned_Int);
             }
             break;
+#if MAX_SEGMENTS
+        case PROP_APDU_SEGMENT_TIMEOUT:
+            status =
+                WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+            if (status) {
+                apdu_segment_timeout_set((uint16_t) value.type.Unsigned_Int);
+            }
+            break;
+#endif
         case PROP_VENDOR_IDENTIFIER:
             status =
                 WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
@@ -1928,6 +2273,9 @@ bool Device_Write_Property_Local(
         case PROP_OBJECT_LIST:
         case PROP_MAX_APDU_LENGTH_ACCEPTED:
         case PROP_SEGMENTATION_SUPPORTED:
+#if MAX_SEGMENTS
+        case PROP_MAX_SEGMENTS_ACCEPTED:
+#endif
         case PROP_DEVICE_ADDRESS_BINDING:
         case PROP_DATABASE_REVISION:
         case PROP_ACTIVE_COV_SUBSCRIPTIONS:
@@ -1977,6 +2325,10 @@ bool Device_Write_Property(
 #endif
                 {
                     status = pObject->Object_Write_Property(wp_data);
+                    if (status) {
+                        propcache_invalidate(wp_data->object_type,
+                            wp_data->object_instance);
+                    }
                 }
             } else {
                 wp_data->error_class = ERROR_CLASS_PROPERTY;
@@ -2072,31 +2424,80 @@ void Device_COV_Clear(
     }
 }
 
+/* the listener for local changes of value, such as the Trend Logs */
+static object_cov_listener_function COV_Listener;
+
+/** Sets the function told when the value or status of any local object
+ * with a COV Value List changes.
+ * @ingroup ObjHelpers
+ * @param [in] The function, or NULL for none.
+ */
+void Device_COV_Listener_Set(
+    object_cov_listener_function pFunction)
+{
+    COV_Listener = pFunction;
+}
+
+/** Called by an object when its Present_Value or Status_Flags change
+ * by any amount; the listener applies its own COV increment.
+ * @ingroup ObjHelpers
+ * @param [in] The object type that changed.
+ * @param [in] The object instance that changed.
+ */
+void Device_COV_Changed(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    if (COV_Listener) {
+        COV_Listener(object_type, object_instance);
+    }
+}
+
 #if defined(INTRINSIC_REPORTING)
+/* evaluates the event state of one object that is due */
+static void Device_Intrinsic_Reporting_Object(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    struct object_functions *pObject;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+    if (pObject != NULL) {
+        if (pObject->Object_Valid_Instance &&
+            pObject->Object_Valid_Instance(object_instance)) {
+            if (pObject->Object_Intrinsic_Reporting) {
+                pObject->Object_Intrinsic_Reporting(object_instance);
+            }
+        }
+    }
+}
+
+/** Evaluates the intrinsic reporting of the objects, once a second.
+ * Objects that keep a timer in the intrinsic reporting schedule are
+ * evaluated when their timer is due; the objects of other types are
+ * all evaluated, every second.
+ * @ingroup ObjHelpers
+ */
 void Device_local_reporting(
     void)
 {
     struct object_functions *pObject;
-    uint32_t objects_count;
-    uint32_t object_instance;
-    int object_type;
-    uint32_t idx;
-
-    objects_count = Device_Object_List_Count();
-
-    /* loop for all objects */
-    for (idx = 1; idx < objects_count; idx++) {
-        Device_Object_List_Identifier(idx, &object_type, &object_instance);
-
-        pObject = Device_Objects_Find_Functions(object_type);
-        if (pObject != NULL) {
-            if (pObject->Object_Valid_Instance &&
-                pObject->Object_Valid_Instance(object_instance)) {
-                if (pObject->Object_Intrinsic_Reporting) {
-                    pObject->Object_Intrinsic_Reporting(object_instance);
-                }
+    unsigned count;
+    unsigned index;
+
+    (void) evsched_run(Device_Intrinsic_Reporting_Object);
+    pObject = Object_Table;
+    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        if (pObject->Object_Intrinsic_Reporting && pObject->Object_Count &&
+            pObject->Object_Index_To_Instance &&
+            !evsched_object_type(pObject->Object_Type)) {
+            count = pObject->Object_Count();
+            for (index = 0; index < count; index++) {
+                pObject->Object_Intrinsic_Reporting(
+                    pObject->Object_Index_To_Instance(index));
             }
         }
+        pObject++;
     }
 }
 #endif
@@ -2122,6 +2523,39 @@ bool Device_Value_List_Supported(
     return (status);
 }
 
+/** Looks up the requested Object, and gets the value of one of its
+ * properties without encoding it, for local users such as the Trend Log.
+ * If the Object can't get the value this way, returns false, and the
+ * property should be read with Device_Read_Property() instead.
+ * @ingroup ObjHelpers
+ * @param [in] The object type to be looked up.
+ * @param [in] The object instance number to be looked up.
+ * @param [in] The property, which is not an array.
+ * @param [out] The value of the property.
+ * @return True if the value was got.
+ */
+bool Device_Value_Get(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    bool status = false;
+    struct object_functions *pObject = NULL;
+
+    pObject = Device_Objects_Find_Functions(object_type);
+    if (pObject != NULL) {
+        if (pObject->Object_Value_Get && pObject->Object_Valid_Instance &&
+            pObject->Object_Valid_Instance(object_instance)) {
+            status =
+                pObject->Object_Value_Get(object_instance, object_property,
+                value);
+        }
+    }
+
+    return (status);
+}
+
 /** Initialize the Device Object.
  Initialize the group of object helper functions for any supported Object.
  Initialize each of the Device Object child Object instances.
@@ -2157,6 +2591,13 @@ void Device_Init(
     } else {
         Object_Table = &My_Object_Table[0];
     }
+    Object_List_Valid = false;
+    /* Present_Value is answered from a ReadProperty-ACK template */
+    handler_read_property_value_set(Device_Value_Get);
+    /* the objects add their active events, and schedule their
+       intrinsic reporting, when they are initialized */
+    evindex_init();
+    evsched_init();
     pObject = Object_Table;
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
         if (pObject->Object_Init) {
@@ -130,6 +130,16 @@ typedef void (
     *object_cov_clear_function) (
     uint32_t object_instance);
 
+/** Told when the value or status of a local object changes.
+ * @ingroup ObjHelpers
+ * @param [in] The object type that changed.
+ * @param [in] The object instance that changed.
+ */
+typedef void (
+    *object_cov_listener_function) (
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance);
+
 /** Intrinsic Reporting funcionality.
  * @ingroup ObjHelpers
  * @param [in] Object instance.
@@ -138,6 +148,21 @@ typedef void (
     *object_intrinsic_reporting_function) (
     uint32_t object_instance);
 
+/** Look in the table of objects for this instance, and get the value of
+ * a property directly, without encoding it for a ReadProperty.
+ * @ingroup ObjHelpers
+ * @param [in] The object instance number to be looked up.
+ * @param [in] The property of the object, which is not an array.
+ * @param [out] The value of the property.
+ * @return True if the object instance has the property, and can get its
+ *         value this way; otherwise it may still be read with ReadProperty.
+ */
+typedef bool(
+    *object_value_get_function) (
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value);
+
 
 /** Defines the group of object helper functions for any supported Object.
  * @ingroup ObjHelpers
@@ -164,6 +189,7 @@ typedef struct object_functions {
     object_cov_function Object_COV;
     object_cov_clear_function Object_COV_Clear;
     object_intrinsic_reporting_function Object_Intrinsic_Reporting;
+    object_value_get_function Object_Value_Get;
 } object_functions_t;
 
 /* String Lengths - excluding any nul terminator */
@@ -259,12 +285,22 @@ extern "C" {
         BACNET_PROPERTY_VALUE * value_list);
     bool Device_Value_List_Supported(
         BACNET_OBJECT_TYPE object_type);
+    bool Device_Value_Get(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        BACNET_APPLICATION_DATA_VALUE * value);
     bool Device_COV(
         BACNET_OBJECT_TYPE object_type,
         uint32_t object_instance);
     void Device_COV_Clear(
         BACNET_OBJECT_TYPE object_type,
         uint32_t object_instance);
+    void Device_COV_Listener_Set(
+        object_cov_listener_function pFunction);
+    void Device_COV_Changed(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
 
     uint32_t Device_Object_Instance_Number(
         void);
@@ -278,6 +314,10 @@ extern "C" {
         unsigned array_index,
         int *object_type,
         uint32_t * instance);
+    int Device_Object_List_Encode(
+        uint8_t * apdu,
+        int apdu_max,
+        unsigned *array_index);
 
     unsigned Device_Count(
         void);
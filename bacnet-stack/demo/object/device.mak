@@ -30,6 +30,10 @@ SRCS = device.c \
 	$(SRC_DIR)/bacaddr.c \
 	$(SRC_DIR)/dcc.c \
 	$(SRC_DIR)/version.c \
+	$(SRC_DIR)/propcache.c \
+	$(SRC_DIR)/strpool.c \
+	$(SRC_DIR)/evindex.c \
+	$(SRC_DIR)/evsched.c \
 	$(TEST_DIR)/ctest.c
 
 TARGET = device
@@ -44,6 +44,7 @@
 #include "config.h"     /* the custom stuff */
 #include "device.h"
 #include "handlers.h"
+#include "propcache.h"
 /* me! */
 #include "iv.h"
 
@@ -291,6 +292,7 @@ bool Integer_Value_Units_Set(
     if (index < MAX_INTEGER_VALUES) {
         Integer_Value[index].Units = units;
         status = true;
+        propcache_invalidate(OBJECT_INTEGER_VALUE, instance);
     }
 
     return status;
@@ -120,7 +120,7 @@ static float Full_Duty_Baseline[MAX_LOAD_CONTROLS];
    shall be equal to the size of the Shed_Level_Descriptions
    array. The behavior of this object when the Shed_Levels
    array contains duplicate entries is a local matter. */
-static unsigned Shed_Levels[MAX_LOAD_CONTROLS][MAX_SHED_LEVELS];
+static uint32_t Shed_Levels[MAX_LOAD_CONTROLS][MAX_SHED_LEVELS];
 
 /* represents a description of the shed levels that the
    Load Control object can take on.  It is the same for
@@ -838,21 +838,13 @@ int Load_Control_Read_Property(
             /* if no index was specified, then try to encode the entire list */
             /* into one packet. */
             else if (rpdata->array_index == BACNET_ARRAY_ALL) {
-                apdu_len = 0;
-                for (i = 0; i < MAX_SHED_LEVELS; i++) {
-                    /* FIXME: check if we have room before adding it to APDU */
-                    len =
-                        encode_application_unsigned(&apdu[apdu_len],
-                        Shed_Levels[object_index][i]);
-                    /* add it if we have room */
-                    if ((apdu_len + len) < MAX_APDU)
-                        apdu_len += len;
-                    else {
-                        rpdata->error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        apdu_len = BACNET_STATUS_ABORT;
-                        break;
-                    }
+                apdu_len =
+                    encode_application_unsigned_array(&apdu[0], MAX_APDU,
+                    Shed_Levels[object_index], MAX_SHED_LEVELS);
+                if (apdu_len == BACNET_STATUS_ERROR) {
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                    apdu_len = BACNET_STATUS_ABORT;
                 }
             } else {
                 if (rpdata->array_index <= MAX_SHED_LEVELS) {
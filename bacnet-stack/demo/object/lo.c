@@ -962,12 +962,13 @@ bool Lighting_Output_Relinquish_Default_Set(
 int Lighting_Output_Read_Property(
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
-    int len = 0;
     int apdu_len = 0;   /* return value */
     BACNET_BIT_STRING bit_string;
     BACNET_CHARACTER_STRING char_string;
     BACNET_LIGHTING_COMMAND lighting_command;
     float real_value = (float) 1.414;
+    float priority_values[BACNET_MAX_PRIORITY] = { 0.0 };
+    uint16_t active_bits = 0;
     uint32_t unsigned_value = 0;
     unsigned i = 0;
     bool state = false;
@@ -1069,24 +1070,20 @@ int Lighting_Output_Read_Property(
                 for (i = 1; i <= BACNET_MAX_PRIORITY; i++) {
                     if (Lighting_Output_Priority_Active(
                         rpdata->object_instance, i)) {
-                        real_value = Lighting_Output_Priority_Value(
+                        priority_values[i - 1] =
+                            Lighting_Output_Priority_Value(
                             rpdata->object_instance, i);
-                        len =
-                            encode_application_real(&apdu[apdu_len],
-                            real_value);
-                    } else {
-                        len = encode_application_null(&apdu[apdu_len]);
-                    }
-                    /* add it if we have room */
-                    if ((apdu_len + len) < MAX_APDU)
-                        apdu_len += len;
-                    else {
-                        rpdata->error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        apdu_len = BACNET_STATUS_ABORT;
-                        break;
+                        active_bits |= (1 << (i - 1));
                     }
                 }
+                apdu_len =
+                    encode_application_real_priority_array(&apdu[0],
+                    MAX_APDU, priority_values, active_bits);
+                if (apdu_len == BACNET_STATUS_ERROR) {
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                    apdu_len = BACNET_STATUS_ABORT;
+                }
             } else {
                 if (rpdata->array_index <= BACNET_MAX_PRIORITY) {
                     if (Lighting_Output_Priority_Active(
@@ -1095,11 +1092,10 @@ int Lighting_Output_Read_Property(
                         real_value = Lighting_Output_Priority_Value(
                             rpdata->object_instance,
                             rpdata->array_index);
-                        len =
-                            encode_application_real(&apdu[apdu_len],
-                            real_value);
+                        apdu_len =
+                            encode_application_real(&apdu[0], real_value);
                     } else {
-                        len = encode_application_null(&apdu[apdu_len]);
+                        apdu_len = encode_application_null(&apdu[0]);
                     }
                 } else {
                     rpdata->error_class = ERROR_CLASS_PROPERTY;
@@ -35,6 +35,8 @@
 #include "config.h"     /* the custom stuff */
 #include "rp.h"
 #include "wp.h"
+#include "propcache.h"
+#include "strpool.h"
 #include "device.h"
 #include "ms-input.h"
 #include "handlers.h"
@@ -53,9 +55,10 @@
 static uint8_t Present_Value[MAX_MULTISTATE_INPUTS];
 /* Writable out-of-service allows others to manipulate our Present Value */
 static bool Out_Of_Service[MAX_MULTISTATE_INPUTS];
-static char Object_Name[MAX_MULTISTATE_INPUTS][64];
-static char Object_Description[MAX_MULTISTATE_INPUTS][64];
-static char State_Text[MAX_MULTISTATE_INPUTS][MULTISTATE_NUMBER_OF_STATES][64];
+static BACNET_STRING_HANDLE Object_Name[MAX_MULTISTATE_INPUTS];
+static BACNET_STRING_HANDLE Object_Description[MAX_MULTISTATE_INPUTS];
+static BACNET_STRING_HANDLE
+    State_Text[MAX_MULTISTATE_INPUTS][MULTISTATE_NUMBER_OF_STATES];
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = {
@@ -99,12 +102,14 @@ void Multistate_Input_Init(
     void)
 {
     unsigned i;
+    char text_string[32] = "";
 
     /* initialize all the analog output priority arrays to NULL */
     for (i = 0; i < MAX_MULTISTATE_INPUTS; i++) {
         Present_Value[i] = 1;
-        sprintf(&Object_Name[i][0], "MULTISTATE INPUT %u", i);
-        sprintf(&Object_Description[i][0], "MULTISTATE INPUT %u", i);
+        sprintf(text_string, "MULTISTATE INPUT %u", i);
+        strpool_intern_ansi(text_string, &Object_Name[i]);
+        strpool_intern_ansi(text_string, &Object_Description[i]);
     }
 
     return;
@@ -220,15 +225,15 @@ void Multistate_Input_Out_Of_Service_Set(
     return;
 }
 
-char *Multistate_Input_Description(
+const char *Multistate_Input_Description(
     uint32_t object_instance)
 {
     unsigned index = 0; /* offset from instance lookup */
-    char *pName = NULL; /* return value */
+    const char *pName = NULL;   /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_INPUTS) {
-        pName = Object_Description[index];
+        pName = strpool_string(Object_Description[index]);
     }
 
     return pName;
@@ -239,24 +244,12 @@ bool Multistate_Input_Description_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
     bool status = false;        /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_INPUTS) {
-        status = true;
-        if (new_name) {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = 0;
-            }
-        }
+        status = strpool_intern_ansi(new_name, &Object_Description[index]);
+        propcache_invalidate(OBJECT_MULTI_STATE_INPUT, object_instance);
     }
 
     return status;
@@ -269,30 +262,23 @@ static bool Multistate_Input_Description_Write(
     BACNET_ERROR_CODE * error_code)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t length = 0;
     uint8_t encoding = 0;
     bool status = false;        /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_INPUTS) {
-        length = characterstring_length(char_string);
-        if (length <= sizeof(Object_Description[index])) {
-            encoding = characterstring_encoding(char_string);
-            if (encoding == CHARACTER_UTF8) {
-                status =
-                    characterstring_ansi_copy(Object_Description[index],
-                    sizeof(Object_Description[index]), char_string);
-                if (!status) {
-                    *error_class = ERROR_CLASS_PROPERTY;
-                    *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
-                }
-            } else {
+        encoding = characterstring_encoding(char_string);
+        if (encoding == CHARACTER_UTF8) {
+            status =
+                strpool_intern_characterstring(char_string,
+                &Object_Description[index]);
+            if (!status) {
                 *error_class = ERROR_CLASS_PROPERTY;
-                *error_code = ERROR_CODE_CHARACTER_SET_NOT_SUPPORTED;
+                *error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
             }
         } else {
             *error_class = ERROR_CLASS_PROPERTY;
-            *error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+            *error_code = ERROR_CODE_CHARACTER_SET_NOT_SUPPORTED;
         }
     }
 
@@ -309,7 +295,7 @@ bool Multistate_Input_Object_Name(
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_INPUTS) {
-        status = characterstring_init_ansi(object_name, Object_Name[index]);
+        status = strpool_characterstring(object_name, Object_Name[index]);
     }
 
     return status;
@@ -321,24 +307,16 @@ bool Multistate_Input_Name_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
+    BACNET_STRING_HANDLE old_name = 0;
     bool status = false;        /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_INPUTS) {
-        status = true;
         /* FIXME: check to see if there is a matching name */
-        if (new_name) {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = 0;
-            }
+        old_name = Object_Name[index];
+        status = strpool_intern_ansi(new_name, &Object_Name[index]);
+        if (Object_Name[index] != old_name) {
+            Device_Inc_Database_Revision();
         }
     }
 
@@ -352,48 +330,45 @@ static bool Multistate_Input_Object_Name_Write(
     BACNET_ERROR_CODE * error_code)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t length = 0;
     uint8_t encoding = 0;
+    BACNET_STRING_HANDLE old_name = 0;
     bool status = false;        /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_INPUTS) {
-        length = characterstring_length(char_string);
-        if (length <= sizeof(Object_Name[index])) {
-            encoding = characterstring_encoding(char_string);
-            if (encoding == CHARACTER_UTF8) {
-                status =
-                    characterstring_ansi_copy(Object_Name[index],
-                    sizeof(Object_Name[index]), char_string);
-                if (!status) {
-                    *error_class = ERROR_CLASS_PROPERTY;
-                    *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
-                }
-            } else {
+        encoding = characterstring_encoding(char_string);
+        if (encoding == CHARACTER_UTF8) {
+            old_name = Object_Name[index];
+            status =
+                strpool_intern_characterstring(char_string,
+                &Object_Name[index]);
+            if (!status) {
                 *error_class = ERROR_CLASS_PROPERTY;
-                *error_code = ERROR_CODE_CHARACTER_SET_NOT_SUPPORTED;
+                *error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+            } else if (Object_Name[index] != old_name) {
+                Device_Inc_Database_Revision();
             }
         } else {
             *error_class = ERROR_CLASS_PROPERTY;
-            *error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+            *error_code = ERROR_CODE_CHARACTER_SET_NOT_SUPPORTED;
         }
     }
 
     return status;
 }
 
-char *Multistate_Input_State_Text(
+const char *Multistate_Input_State_Text(
     uint32_t object_instance,
     uint32_t state_index)
 {
     unsigned index = 0; /* offset from instance lookup */
-    char *pName = NULL; /* return value */
+    const char *pName = NULL;   /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if ((index < MAX_MULTISTATE_INPUTS) && (state_index > 0) &&
         (state_index <= MULTISTATE_NUMBER_OF_STATES)) {
         state_index--;
-        pName = State_Text[index][state_index];
+        pName = strpool_string(State_Text[index][state_index]);
     }
 
     return pName;
@@ -406,29 +381,17 @@ bool Multistate_Input_State_Text_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
     bool status = false;        /* return value */
 
     index = Multistate_Input_Instance_To_Index(object_instance);
     if ((index < MAX_MULTISTATE_INPUTS) && (state_index > 0) &&
         (state_index <= MULTISTATE_NUMBER_OF_STATES)) {
         state_index--;
-        status = true;
-        if (new_name) {
-            for (i = 0; i < sizeof(State_Text[index][state_index]); i++) {
-                State_Text[index][state_index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(State_Text[index][state_index]); i++) {
-                State_Text[index][state_index][i] = 0;
-            }
-        }
+        status =
+            strpool_intern_ansi(new_name, &State_Text[index][state_index]);
     }
 
-    return status;;
+    return status;
 }
 
 static bool Multistate_Input_State_Text_Write(
@@ -439,7 +402,6 @@ static bool Multistate_Input_State_Text_Write(
     BACNET_ERROR_CODE * error_code)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t length = 0;
     uint8_t encoding = 0;
     bool status = false;        /* return value */
 
@@ -447,24 +409,18 @@ static bool Multistate_Input_State_Text_Write(
     if ((index < MAX_MULTISTATE_INPUTS) && (state_index > 0) &&
         (state_index <= Multistate_Input_Max_States(object_instance))) {
         state_index--;
-        length = characterstring_length(char_string);
-        if (length <= sizeof(State_Text[index][state_index])) {
-            encoding = characterstring_encoding(char_string);
-            if (encoding == CHARACTER_UTF8) {
-                status =
-                    characterstring_ansi_copy(State_Text[index][state_index],
-                    sizeof(State_Text[index][state_index]), char_string);
-                if (!status) {
-                    *error_class = ERROR_CLASS_PROPERTY;
-                    *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
-                }
-            } else {
+        encoding = characterstring_encoding(char_string);
+        if (encoding == CHARACTER_UTF8) {
+            status =
+                strpool_intern_characterstring(char_string,
+                &State_Text[index][state_index]);
+            if (!status) {
                 *error_class = ERROR_CLASS_PROPERTY;
-                *error_code = ERROR_CODE_CHARACTER_SET_NOT_SUPPORTED;
+                *error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
             }
         } else {
             *error_class = ERROR_CLASS_PROPERTY;
-            *error_code = ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+            *error_code = ERROR_CODE_CHARACTER_SET_NOT_SUPPORTED;
         }
     } else {
         *error_class = ERROR_CLASS_PROPERTY;
@@ -794,6 +750,11 @@ bool Device_Valid_Object_Name(
     return true;
 }
 
+void Device_Inc_Database_Revision(
+    void)
+{
+}
+
 bool WPValidateArgType(
     BACNET_APPLICATION_DATA_VALUE * pValue,
     uint8_t ucExpectedTag,
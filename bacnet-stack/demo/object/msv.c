@@ -35,6 +35,9 @@
 #include "config.h"     /* the custom stuff */
 #include "rp.h"
 #include "wp.h"
+#include "propcache.h"
+#include "strpool.h"
+#include "device.h"
 #include "msv.h"
 #include "handlers.h"
 
@@ -52,9 +55,10 @@
 static uint8_t Present_Value[MAX_MULTISTATE_VALUES];
 /* Writable out-of-service allows others to manipulate our Present Value */
 static bool Out_Of_Service[MAX_MULTISTATE_VALUES];
-static char Object_Name[MAX_MULTISTATE_VALUES][64];
-static char Object_Description[MAX_MULTISTATE_VALUES][64];
-static char State_Text[MAX_MULTISTATE_VALUES][MULTISTATE_NUMBER_OF_STATES][64];
+static BACNET_STRING_HANDLE Object_Name[MAX_MULTISTATE_VALUES];
+static BACNET_STRING_HANDLE Object_Description[MAX_MULTISTATE_VALUES];
+static BACNET_STRING_HANDLE
+    State_Text[MAX_MULTISTATE_VALUES][MULTISTATE_NUMBER_OF_STATES];
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Properties_Required[] = {
@@ -98,12 +102,14 @@ void Multistate_Value_Init(
     void)
 {
     unsigned int i;
+    char text_string[32] = "";
 
     /* initialize all the analog output priority arrays to NULL */
     for (i = 0; i < MAX_MULTISTATE_VALUES; i++) {
         Present_Value[i] = 1;
-        sprintf(&Object_Name[i][0], "MULTISTATE VALUE %u", i);
-        sprintf(&Object_Description[i][0], "MULTISTATE VALUE %u", i);
+        sprintf(text_string, "MULTISTATE VALUE %u", i);
+        strpool_intern_ansi(text_string, &Object_Name[i]);
+        strpool_intern_ansi(text_string, &Object_Description[i]);
     }
 
     return;
@@ -213,15 +219,15 @@ void Multistate_Value_Out_Of_Service_Set(
     return;
 }
 
-char *Multistate_Value_Description(
+const char *Multistate_Value_Description(
     uint32_t object_instance)
 {
     unsigned index = 0; /* offset from instance lookup */
-    char *pName = NULL; /* return value */
+    const char *pName = NULL;   /* return value */
 
     index = Multistate_Value_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_VALUES) {
-        pName = Object_Description[index];
+        pName = strpool_string(Object_Description[index]);
     }
 
     return pName;
@@ -232,24 +238,12 @@ bool Multistate_Value_Description_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
     bool status = false;        /* return value */
 
     index = Multistate_Value_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_VALUES) {
-        status = true;
-        if (new_name) {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(Object_Description[index]); i++) {
-                Object_Description[index][i] = 0;
-            }
-        }
+        status = strpool_intern_ansi(new_name, &Object_Description[index]);
+        propcache_invalidate(OBJECT_MULTI_STATE_VALUE, object_instance);
     }
 
     return status;
@@ -264,7 +258,7 @@ bool Multistate_Value_Object_Name(
 
     index = Multistate_Value_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_VALUES) {
-        status = characterstring_init_ansi(object_name, Object_Name[index]);
+        status = strpool_characterstring(object_name, Object_Name[index]);
     }
 
     return status;
@@ -276,42 +270,34 @@ bool Multistate_Value_Name_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
+    BACNET_STRING_HANDLE old_name = 0;
     bool status = false;        /* return value */
 
     index = Multistate_Value_Instance_To_Index(object_instance);
     if (index < MAX_MULTISTATE_VALUES) {
-        status = true;
         /* FIXME: check to see if there is a matching name */
-        if (new_name) {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(Object_Name[index]); i++) {
-                Object_Name[index][i] = 0;
-            }
+        old_name = Object_Name[index];
+        status = strpool_intern_ansi(new_name, &Object_Name[index]);
+        if (Object_Name[index] != old_name) {
+            Device_Inc_Database_Revision();
         }
     }
 
     return status;
 }
 
-char *Multistate_Value_State_Text(
+const char *Multistate_Value_State_Text(
     uint32_t object_instance,
     uint32_t state_index)
 {
     unsigned index = 0; /* offset from instance lookup */
-    char *pName = NULL; /* return value */
+    const char *pName = NULL;   /* return value */
 
     index = Multistate_Value_Instance_To_Index(object_instance);
     if ((index < MAX_MULTISTATE_VALUES) && (state_index > 0) &&
         (state_index <= MULTISTATE_NUMBER_OF_STATES)) {
         state_index--;
-        pName = State_Text[index][state_index];
+        pName = strpool_string(State_Text[index][state_index]);
     }
 
     return pName;
@@ -324,29 +310,17 @@ bool Multistate_Value_State_Text_Set(
     char *new_name)
 {
     unsigned index = 0; /* offset from instance lookup */
-    size_t i = 0;       /* loop counter */
     bool status = false;        /* return value */
 
     index = Multistate_Value_Instance_To_Index(object_instance);
     if ((index < MAX_MULTISTATE_VALUES) && (state_index > 0) &&
         (state_index <= MULTISTATE_NUMBER_OF_STATES)) {
         state_index--;
-        status = true;
-        if (new_name) {
-            for (i = 0; i < sizeof(State_Text[index][state_index]); i++) {
-                State_Text[index][state_index][i] = new_name[i];
-                if (new_name[i] == 0) {
-                    break;
-                }
-            }
-        } else {
-            for (i = 0; i < sizeof(State_Text[index][state_index]); i++) {
-                State_Text[index][state_index][i] = 0;
-            }
-        }
+        status =
+            strpool_intern_ansi(new_name, &State_Text[index][state_index]);
     }
 
-    return status;;
+    return status;
 }
 
 
@@ -573,6 +547,11 @@ bool WPValidateArgType(
     return false;
 }
 
+void Device_Inc_Database_Revision(
+    void)
+{
+}
+
 void testMultistateInput(
     Test * pTest)
 {
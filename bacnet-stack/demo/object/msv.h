@@ -87,7 +87,7 @@ extern "C" {
         uint32_t object_instance,
         bool value);
 
-    char *Multistate_Value_Description(
+    const char *Multistate_Value_Description(
         uint32_t instance);
     bool Multistate_Value_Description_Set(
         uint32_t object_instance,
@@ -100,7 +100,7 @@ extern "C" {
     bool Multistate_Value_Max_States_Set(
         uint32_t instance,
         uint32_t max_states_requested);
-    char *Multistate_Value_State_Text(
+    const char *Multistate_Value_State_Text(
         uint32_t object_instance,
         uint32_t state_index);
 
@@ -18,6 +18,8 @@ SRCS = msv.c \
 	$(SRC_DIR)/bactext.c \
 	$(SRC_DIR)/lighting.c \
 	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/propcache.c \
+	$(SRC_DIR)/strpool.c \
 	$(TEST_DIR)/ctest.c
 
 TARGET = multistate_value
@@ -85,6 +85,173 @@ void Notification_Class_Property_Lists(
     return;
 }
 
+/* A time packed as hour, minute, second and hundredths octets, so that
+   the keys of two times compare as datetime_compare_time() does */
+static uint32_t NC_Time_Key(
+    BACNET_TIME * btime)
+{
+    return ((uint32_t) btime->hour << 24) | ((uint32_t) btime->min << 16) |
+        ((uint32_t) btime->sec << 8) | (uint32_t) btime->hundredths;
+}
+
+/* The transition to an event state, or MAX_BACNET_EVENT_TRANSITION */
+static unsigned NC_Transition(
+    uint8_t EventToState)
+{
+    switch (EventToState) {
+        case EVENT_STATE_OFFNORMAL:
+        case EVENT_STATE_HIGH_LIMIT:
+        case EVENT_STATE_LOW_LIMIT:
+            return TRANSITION_TO_OFFNORMAL;
+        case EVENT_STATE_FAULT:
+            return TRANSITION_TO_FAULT;
+        case EVENT_STATE_NORMAL:
+            return TRANSITION_TO_NORMAL;
+        default:
+            return MAX_BACNET_EVENT_TRANSITION; /* shouldn't happen */
+    }
+}
+
+/*
+ * Work out which recipients are active at a date and time, and for how
+ * long the same recipients stay active: from the latest FromTime or end
+ * of a ToTime until the next one, on the same day.
+ */
+static void NC_Active_Update(
+    NOTIFICATION_CLASS_INFO * CurrentNotify,
+    BACNET_DATE_TIME * DateTime)
+{
+    BACNET_DESTINATION *pBacDest;
+    uint32_t now = NC_Time_Key(&DateTime->time);
+    uint32_t from_time;
+    uint32_t to_time;
+    uint8_t idx;
+    unsigned transition;
+
+    for (transition = 0; transition < MAX_BACNET_EVENT_TRANSITION;
+        transition++) {
+        CurrentNotify->Active[transition] = 0;
+    }
+    CurrentNotify->Active_From = 0;
+    CurrentNotify->Active_Until = 0xFFFFFFFFUL;
+    pBacDest = &CurrentNotify->Recipient_List[0];
+    for (idx = 0; idx < NC_MAX_RECIPIENTS; idx++, pBacDest++) {
+        if (pBacDest->Recipient.RecipientType == RECIPIENT_TYPE_NOTINITIALIZED)
+            break;      /* recipient doesn't defined - end of list */
+        /* active from FromTime, until after ToTime */
+        from_time = NC_Time_Key(&pBacDest->FromTime);
+        to_time = NC_Time_Key(&pBacDest->ToTime);
+        if (from_time <= now) {
+            if (from_time > CurrentNotify->Active_From)
+                CurrentNotify->Active_From = from_time;
+        } else if (from_time < CurrentNotify->Active_Until) {
+            CurrentNotify->Active_Until = from_time;
+        }
+        if (to_time < now) {
+            if ((to_time + 1) > CurrentNotify->Active_From)
+                CurrentNotify->Active_From = to_time + 1;
+        } else if ((to_time < 0xFFFFFFFFUL) &&
+            ((to_time + 1) < CurrentNotify->Active_Until)) {
+            CurrentNotify->Active_Until = to_time + 1;
+        }
+        /* valid Days, FromTime and ToTime */
+        if (((0x01 << (DateTime->date.wday - 1)) & pBacDest->ValidDays) &&
+            (from_time <= now) && (now <= to_time)) {
+            for (transition = 0; transition < MAX_BACNET_EVENT_TRANSITION;
+                transition++) {
+                /* valid Transitions */
+                if (pBacDest->Transitions & (1 << transition))
+                    CurrentNotify->Active[transition] |= (1UL << idx);
+            }
+        }
+    }
+    CurrentNotify->Active_Day = DateTime->date.wday;
+}
+
+/* The devices among the recipients that are not bound yet: a Who-Is is
+   sent when one is added, and the list is made again from all the device
+   recipients when Notification_Class_find_recipient() is called */
+#define NC_MAX_PENDING_BINDINGS (MAX_NOTIFICATION_CLASSES * NC_MAX_RECIPIENTS)
+static uint32_t NC_Pending_Binding[NC_MAX_PENDING_BINDINGS];
+static unsigned NC_Pending_Bindings;
+
+/* Ask for the binding of a device, if it is not bound or asked for */
+static void NC_Bind(
+    uint32_t DeviceID)
+{
+    BACNET_ADDRESS src = { 0 };
+    unsigned max_apdu = 0;
+    unsigned i;
+
+    if (address_bind_request(DeviceID, &max_apdu, &src))
+        return;
+    for (i = 0; i < NC_Pending_Bindings; i++) {
+        if (NC_Pending_Binding[i] == DeviceID)
+            return;
+    }
+    if (NC_Pending_Bindings < NC_MAX_PENDING_BINDINGS)
+        NC_Pending_Binding[NC_Pending_Bindings++] = DeviceID;
+    /* Send who_ is request only when address of device is unknown. */
+    Send_WhoIs(DeviceID, DeviceID);
+}
+
+/* Ask for the bindings of the device recipients of all the classes */
+static void NC_Bind_All(
+    void)
+{
+    NOTIFICATION_CLASS_INFO *CurrentNotify;
+    uint32_t notify_index;
+    uint8_t idx;
+
+    NC_Pending_Bindings = 0;
+    for (notify_index = 0; notify_index < MAX_NOTIFICATION_CLASSES;
+        notify_index++) {
+        CurrentNotify = &NC_Info[notify_index];
+        for (idx = 0; idx < NC_MAX_RECIPIENTS; idx++) {
+            if (CurrentNotify->Recipient_List[idx].Recipient.RecipientType ==
+                RECIPIENT_TYPE_DEVICE)
+                NC_Bind(CurrentNotify->Recipient_List[idx].Recipient._.
+                    DeviceIdentifier);
+        }
+    }
+}
+
+/* Send an encoded notification to a recipient */
+static void NC_Send(
+    BACNET_DESTINATION * pBacDest,
+    uint8_t * apdu,
+    int apdu_len)
+{
+    BACNET_ADDRESS dest;
+    uint32_t device_id;
+    unsigned max_apdu;
+
+    if (pBacDest->Recipient.RecipientType == RECIPIENT_TYPE_DEVICE) {
+        /* send notification to the specified device */
+        device_id = pBacDest->Recipient._.DeviceIdentifier;
+        if (!address_get_by_device(device_id, &max_apdu, &dest)) {
+            NC_Bind(device_id);
+        } else if (pBacDest->ConfirmedNotify == true) {
+            Send_CEvent_Notify_Encoded(&dest, max_apdu, apdu, apdu_len);
+        } else {
+            Send_UEvent_Notify_Encoded(Handler_Transmit_Buffer, apdu,
+                apdu_len, &dest);
+        }
+    } else if (pBacDest->Recipient.RecipientType == RECIPIENT_TYPE_ADDRESS) {
+        /* send notification to the address indicated */
+        dest = pBacDest->Recipient._.Address;
+        if (pBacDest->ConfirmedNotify == true) {
+            if (address_get_device_id(&dest, &device_id) &&
+                address_get_by_device(device_id, &max_apdu, &dest))
+                Send_CEvent_Notify_Encoded(&dest, max_apdu, apdu, apdu_len);
+        } else {
+            Send_UEvent_Notify_Encoded(Handler_Transmit_Buffer, apdu,
+                apdu_len, &dest);
+        }
+    }
+}
+
+
 void Notification_Class_Init(
     void)
 {
@@ -99,6 +266,7 @@ void Notification_Class_Init(
         NC_Info[NotifyIdx].Priority[TRANSITION_TO_FAULT] = 255; /* The lowest priority for Normal message. */
         NC_Info[NotifyIdx].Priority[TRANSITION_TO_NORMAL] = 255;        /* The lowest priority for Normal message. */
     }
+    NC_Pending_Bindings = 0;
 
     return;
 }
@@ -692,28 +860,13 @@ bool Notification_Class_Write_Property(
             /* Decoded all recipient list */
             /* copy elements from temporary object */
             for (idx = 0; idx < NC_MAX_RECIPIENTS; idx++) {
-                BACNET_ADDRESS src = { 0 };
-                unsigned max_apdu = 0;
-                int32_t DeviceID;
-
                 CurrentNotify->Recipient_List[idx] =
                     TmpNotify.Recipient_List[idx];
-
-                if (CurrentNotify->Recipient_List[idx].Recipient.
-                    RecipientType == RECIPIENT_TYPE_DEVICE) {
-                    /* copy Device_ID */
-                    DeviceID =
-                        CurrentNotify->Recipient_List[idx].Recipient._.
-                        DeviceIdentifier;
-                    address_bind_request(DeviceID, &max_apdu, &src);
-
-                } else if (CurrentNotify->Recipient_List[idx].Recipient.
-                    RecipientType == RECIPIENT_TYPE_ADDRESS) {
-                    /* copy Address */
-                    /* src = CurrentNotify->Recipient_List[idx].Recipient._.Address; */
-                    /* address_bind_request(BACNET_MAX_INSTANCE, &max_apdu, &src); */
-                }
             }
+            /* the active recipients are worked out again */
+            CurrentNotify->Active_Day = 0;
+            /* bind the device recipients */
+            NC_Bind_All();
 
             status = true;
 
@@ -752,54 +905,6 @@ void Notification_Class_Get_Priorities(
 }
 
 
-static bool IsRecipientActive(
-    BACNET_DESTINATION * pBacDest,
-    uint8_t EventToState)
-{
-    BACNET_DATE_TIME DateTime;
-
-    /* valid Transitions */
-    switch (EventToState) {
-        case EVENT_STATE_OFFNORMAL:
-        case EVENT_STATE_HIGH_LIMIT:
-        case EVENT_STATE_LOW_LIMIT:
-            if (!(pBacDest->Transitions & TRANSITION_TO_OFFNORMAL_MASKED))
-                return false;
-            break;
-
-        case EVENT_STATE_FAULT:
-            if (!(pBacDest->Transitions & TRANSITION_TO_FAULT_MASKED))
-                return false;
-            break;
-
-        case EVENT_STATE_NORMAL:
-            if (!(pBacDest->Transitions & TRANSITION_TO_NORMAL_MASKED))
-                return false;
-            break;
-
-        default:
-            return false;       /* shouldn't happen */
-    }
-
-    /* get actual date and time */
-    Device_getCurrentDateTime(&DateTime);
-
-    /* valid Days */
-    if (!((0x01 << (DateTime.date.wday - 1)) & pBacDest->ValidDays))
-        return false;
-
-    /* valid FromTime */
-    if (datetime_compare_time(&DateTime.time, &pBacDest->FromTime) < 0)
-        return false;
-
-    /* valid ToTime */
-    if (datetime_compare_time(&pBacDest->ToTime, &DateTime.time) < 0)
-        return false;
-
-    return true;
-}
-
-
 void Notification_Class_common_reporting_function(
     BACNET_EVENT_NOTIFICATION_DATA * event_data)
 {
@@ -807,8 +912,16 @@ void Notification_Class_common_reporting_function(
 
     NOTIFICATION_CLASS_INFO *CurrentNotify;
     BACNET_DESTINATION *pBacDest;
+    BACNET_DESTINATION *pOtherDest;
+    BACNET_DATE_TIME DateTime;
+    uint8_t apdu[MAX_PDU];
+    int apdu_len;
     uint32_t notify_index;
+    uint32_t active;
+    uint32_t now;
+    unsigned transition;
     uint8_t index;
+    uint8_t other;
 
 
     notify_index =
@@ -857,84 +970,557 @@ void Notification_Class_common_reporting_function(
             break;
     }
 
-    /* send notifications for active recipients */
-    /* pointer to first recipient */
-    pBacDest = &CurrentNotify->Recipient_List[0];
-    for (index = 0; index < NC_MAX_RECIPIENTS; index++, pBacDest++) {
-        /* check if recipient is defined */
-        if (pBacDest->Recipient.RecipientType == RECIPIENT_TYPE_NOTINITIALIZED)
-            break;      /* recipient doesn't defined - end of list */
-
-        if (IsRecipientActive(pBacDest, event_data->toState) == true) {
-            BACNET_ADDRESS dest;
-            uint32_t device_id;
-            unsigned max_apdu;
-
-            /* Process Identifier */
-            event_data->processIdentifier = pBacDest->ProcessIdentifier;
-
-            /* send notification */
-            if (pBacDest->Recipient.RecipientType == RECIPIENT_TYPE_DEVICE) {
-                /* send notification to the specified device */
-                device_id = pBacDest->Recipient._.DeviceIdentifier;
-
-                if (pBacDest->ConfirmedNotify == true)
-                    Send_CEvent_Notify(device_id, event_data);
-                else if (address_get_by_device(device_id, &max_apdu, &dest))
-                    Send_UEvent_Notify(Handler_Transmit_Buffer, event_data,
-                        &dest);
-            } else if (pBacDest->Recipient.RecipientType ==
-                RECIPIENT_TYPE_ADDRESS) {
-                /* send notification to the address indicated */
-                if (pBacDest->ConfirmedNotify == true) {
-                    if (address_get_device_id(&dest, &device_id))
-                        Send_CEvent_Notify(device_id, event_data);
-                } else {
-                    dest = pBacDest->Recipient._.Address;
-                    Send_UEvent_Notify(Handler_Transmit_Buffer, event_data,
-                        &dest);
-                }
+    transition = NC_Transition(event_data->toState);
+    if (transition >= MAX_BACNET_EVENT_TRANSITION)
+        return;
+    /* the active recipients, worked out again when the day changes or
+       a recipient becomes active or inactive */
+    Device_getCurrentDateTime(&DateTime);
+    now = NC_Time_Key(&DateTime.time);
+    if ((CurrentNotify->Active_Day != DateTime.date.wday) ||
+        (now < CurrentNotify->Active_From) ||
+        (now >= CurrentNotify->Active_Until))
+        NC_Active_Update(CurrentNotify, &DateTime);
+
+    /* send notifications for active recipients: the notification is
+       encoded once for all the recipients with the same Process
+       Identifier, and confirmed or not */
+    active = CurrentNotify->Active[transition];
+    for (index = 0; (index < NC_MAX_RECIPIENTS) && active; index++) {
+        if (!(active & (1UL << index)))
+            continue;
+        pBacDest = &CurrentNotify->Recipient_List[index];
+        /* Process Identifier */
+        event_data->processIdentifier = pBacDest->ProcessIdentifier;
+        if (pBacDest->ConfirmedNotify == true)
+            apdu_len = cevent_notify_encode_apdu(&apdu[0], 0, event_data);
+        else
+            apdu_len = uevent_notify_encode_apdu(&apdu[0], event_data);
+        for (other = index; other < NC_MAX_RECIPIENTS; other++) {
+            pOtherDest = &CurrentNotify->Recipient_List[other];
+            if ((active & (1UL << other)) &&
+                (pOtherDest->ProcessIdentifier ==
+                    pBacDest->ProcessIdentifier) &&
+                (pOtherDest->ConfirmedNotify == pBacDest->ConfirmedNotify)) {
+                NC_Send(pOtherDest, &apdu[0], apdu_len);
+                active &= ~(1UL << other);
             }
         }
     }
 }
 
 /* This function tries to find the addresses of the defined devices. */
-/* It should be called periodically (example once per minute). */
+/* It should be called periodically (example once per minute), so that */
+/* the binding of a device is asked for again when it expires; between */
+/* calls, a device that could not be notified is asked for only once. */
 void Notification_Class_find_recipient(
     void)
 {
-    NOTIFICATION_CLASS_INFO *CurrentNotify;
-    BACNET_DESTINATION *pBacDest;
-    BACNET_ADDRESS src = { 0 };
-    unsigned max_apdu = 0;
-    uint32_t notify_index;
-    uint32_t DeviceID;
+    NC_Bind_All();
+}
+#ifdef TEST
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ctest.h"
+
+uint8_t Handler_Transmit_Buffer[MAX_PDU];
+
+/* devices below TEST_DEVICES, bound at the MAC address of their instance */
+#define TEST_DEVICES 16
+static bool Test_Bound[TEST_DEVICES];
+static unsigned Test_WhoIs[TEST_DEVICES];
+static BACNET_DATE_TIME Test_DateTime;
+
+/* the notifications sent */
+typedef struct Test_Notification {
+    BACNET_ADDRESS dest;
+    bool confirmed;
+    uint8_t apdu[MAX_PDU];
+    int apdu_len;
+} TEST_NOTIFICATION;
+#define TEST_NOTIFICATIONS 32
+static TEST_NOTIFICATION Test_Sent[TEST_NOTIFICATIONS];
+static unsigned Test_Sent_Count;
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    if (pValue->tag != ucExpectedTag) {
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 123;
+}
+
+void Device_getCurrentDateTime(
+    BACNET_DATE_TIME * DateTime)
+{
+    *DateTime = Test_DateTime;
+}
+
+static void testAddress(
+    uint32_t mac,
+    BACNET_ADDRESS * dest)
+{
+    memset(dest, 0, sizeof(BACNET_ADDRESS));
+    dest->mac_len = 1;
+    dest->mac[0] = (uint8_t) mac;
+}
+
+bool address_get_by_device(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    if ((device_id >= TEST_DEVICES) || !Test_Bound[device_id])
+        return false;
+    testAddress(device_id, src);
+    *max_apdu = MAX_APDU;
+
+    return true;
+}
+
+bool address_bind_request(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    return address_get_by_device(device_id, max_apdu, src);
+}
+
+bool address_get_device_id(
+    BACNET_ADDRESS * src,
+    uint32_t * device_id)
+{
+    if ((src->mac_len != 1) || (src->mac[0] >= TEST_DEVICES) ||
+        !Test_Bound[src->mac[0]])
+        return false;
+    *device_id = src->mac[0];
+
+    return true;
+}
+
+void Send_WhoIs(
+    int32_t low_limit,
+    int32_t high_limit)
+{
+    if ((low_limit == high_limit) && (low_limit >= 0) &&
+        (low_limit < TEST_DEVICES))
+        Test_WhoIs[low_limit]++;
+}
+
+static void testSent(
+    BACNET_ADDRESS * dest,
+    bool confirmed,
+    uint8_t * apdu,
+    int apdu_len)
+{
+    TEST_NOTIFICATION *sent = &Test_Sent[Test_Sent_Count % TEST_NOTIFICATIONS];
+
+    sent->dest = *dest;
+    sent->confirmed = confirmed;
+    memcpy(sent->apdu, apdu, apdu_len);
+    sent->apdu_len = apdu_len;
+    Test_Sent_Count++;
+}
+
+uint8_t Send_CEvent_Notify_Encoded(
+    BACNET_ADDRESS * dest,
+    unsigned max_apdu,
+    uint8_t * apdu,
+    int apdu_len)
+{
+    testSent(dest, true, apdu, apdu_len);
+
+    return 1;
+}
+
+int Send_UEvent_Notify_Encoded(
+    uint8_t * buffer,
+    uint8_t * apdu,
+    int apdu_len,
+    BACNET_ADDRESS * dest)
+{
+    testSent(dest, false, apdu, apdu_len);
+
+    return apdu_len;
+}
+
+/* IsRecipientActive() as it was, getting the time for each recipient */
+static bool testRecipientActive(
+    BACNET_DESTINATION * pBacDest,
+    uint8_t EventToState)
+{
+    BACNET_DATE_TIME DateTime;
+    unsigned transition = NC_Transition(EventToState);
+
+    if ((transition >= MAX_BACNET_EVENT_TRANSITION) ||
+        !(pBacDest->Transitions & (1 << transition)))
+        return false;
+    Device_getCurrentDateTime(&DateTime);
+    if (!((0x01 << (DateTime.date.wday - 1)) & pBacDest->ValidDays))
+        return false;
+    if (datetime_compare_time(&DateTime.time, &pBacDest->FromTime) < 0)
+        return false;
+    if (datetime_compare_time(&pBacDest->ToTime, &DateTime.time) < 0)
+        return false;
+
+    return true;
+}
+
+/* the reporting as it was: each active recipient encoded on its own */
+static void testReportReference(
+    NOTIFICATION_CLASS_INFO * CurrentNotify,
+    BACNET_EVENT_NOTIFICATION_DATA * event_data)
+{
+    BACNET_DESTINATION *pBacDest = &CurrentNotify->Recipient_List[0];
+    uint8_t apdu[MAX_PDU];
+    int apdu_len;
     uint8_t idx;
 
+    for (idx = 0; idx < NC_MAX_RECIPIENTS; idx++, pBacDest++) {
+        if (pBacDest->Recipient.RecipientType == RECIPIENT_TYPE_NOTINITIALIZED)
+            break;
+        if (testRecipientActive(pBacDest, event_data->toState)) {
+            event_data->processIdentifier = pBacDest->ProcessIdentifier;
+            if (pBacDest->ConfirmedNotify == true)
+                apdu_len = cevent_notify_encode_apdu(&apdu[0], 0, event_data);
+            else
+                apdu_len = uevent_notify_encode_apdu(&apdu[0], event_data);
+            NC_Send(pBacDest, &apdu[0], apdu_len);
+        }
+    }
+}
 
-    for (notify_index = 0; notify_index < MAX_NOTIFICATION_CLASSES;
-        notify_index++) {
-        /* pointer to current notification */
-        CurrentNotify =
-            &NC_Info[Notification_Class_Instance_To_Index(notify_index)];
-        /* pointer to first recipient */
-        pBacDest = &CurrentNotify->Recipient_List[0];
-        for (idx = 0; idx < NC_MAX_RECIPIENTS; idx++, pBacDest++) {
-            if (CurrentNotify->Recipient_List[idx].Recipient.RecipientType ==
-                RECIPIENT_TYPE_DEVICE) {
-                /* Device ID */
-                DeviceID =
-                    CurrentNotify->Recipient_List[idx].Recipient._.
-                    DeviceIdentifier;
-                /* Send who_ is request only when address of device is unknown. */
-                if (!address_bind_request(DeviceID, &max_apdu, &src))
-                    Send_WhoIs(DeviceID, DeviceID);
-            } else if (CurrentNotify->Recipient_List[idx].Recipient.
-                RecipientType == RECIPIENT_TYPE_ADDRESS) {
+static void testEventData(
+    BACNET_EVENT_NOTIFICATION_DATA * data,
+    BACNET_CHARACTER_STRING * message)
+{
+    memset(data, 0, sizeof(BACNET_EVENT_NOTIFICATION_DATA));
+    data->eventObjectIdentifier.type = OBJECT_ANALOG_INPUT;
+    data->eventObjectIdentifier.instance = 1;
+    data->timeStamp.tag = TIME_STAMP_SEQUENCE;
+    data->timeStamp.value.sequenceNum = 7;
+    data->notificationClass = 0;
+    data->eventType = EVENT_OUT_OF_RANGE;
+    characterstring_init_ansi(message, "High Limit");
+    data->messageText = message;
+    data->notifyType = NOTIFY_ALARM;
+    data->fromState = EVENT_STATE_NORMAL;
+    data->toState = EVENT_STATE_HIGH_LIMIT;
+    data->notificationParams.outOfRange.exceedingValue = 101.0;
+    bitstring_init(&data->notificationParams.outOfRange.statusFlags);
+    bitstring_set_bit(&data->notificationParams.outOfRange.statusFlags,
+        STATUS_FLAG_IN_ALARM, true);
+    bitstring_set_bit(&data->notificationParams.outOfRange.statusFlags,
+        STATUS_FLAG_FAULT, false);
+    bitstring_set_bit(&data->notificationParams.outOfRange.statusFlags,
+        STATUS_FLAG_OVERRIDDEN, false);
+    bitstring_set_bit(&data->notificationParams.outOfRange.statusFlags,
+        STATUS_FLAG_OUT_OF_SERVICE, false);
+    data->notificationParams.outOfRange.deadband = 1.0;
+    data->notificationParams.outOfRange.exceededLimit = 100.0;
+}
+
+/* a recipient every day, all day, for every transition */
+static void testRecipient(
+    BACNET_DESTINATION * pBacDest,
+    uint8_t RecipientType,
+    uint32_t id,
+    uint32_t ProcessIdentifier,
+    bool ConfirmedNotify)
+{
+    memset(pBacDest, 0, sizeof(BACNET_DESTINATION));
+    pBacDest->ValidDays = 0x7F;
+    datetime_set_time(&pBacDest->FromTime, 0, 0, 0, 0);
+    datetime_set_time(&pBacDest->ToTime, 23, 59, 59, 99);
+    pBacDest->Recipient.RecipientType = RecipientType;
+    if (RecipientType == RECIPIENT_TYPE_DEVICE)
+        pBacDest->Recipient._.DeviceIdentifier = id;
+    else
+        testAddress(id, &pBacDest->Recipient._.Address);
+    pBacDest->ProcessIdentifier = ProcessIdentifier;
+    pBacDest->Transitions =
+        TRANSITION_TO_OFFNORMAL_MASKED | TRANSITION_TO_FAULT_MASKED |
+        TRANSITION_TO_NORMAL_MASKED;
+    pBacDest->ConfirmedNotify = ConfirmedNotify;
+}
+
+static void testReset(
+    void)
+{
+    Notification_Class_Init();
+    memset(Test_Bound, 0, sizeof(Test_Bound));
+    memset(Test_WhoIs, 0, sizeof(Test_WhoIs));
+    Test_Sent_Count = 0;
+    datetime_set_values(&Test_DateTime, 2026, 10, 19, 12, 0, 0, 0);
+}
+
+/* the recipient a notification was sent to, and its encoding */
+static void testNotification(
+    Test * pTest,
+    unsigned index,
+    uint8_t mac,
+    uint32_t ProcessIdentifier,
+    bool ConfirmedNotify)
+{
+    BACNET_EVENT_NOTIFICATION_DATA data;
+    BACNET_CHARACTER_STRING message;
+    TEST_NOTIFICATION *sent = &Test_Sent[index];
+    uint8_t apdu[MAX_PDU];
+    int apdu_len;
+
+    testEventData(&data, &message);
+    data.initiatingObjectIdentifier.type = OBJECT_DEVICE;
+    data.initiatingObjectIdentifier.instance = 123;
+    data.priority = 255;
+    data.processIdentifier = ProcessIdentifier;
+    if (ConfirmedNotify)
+        apdu_len = cevent_notify_encode_apdu(&apdu[0], 0, &data);
+    else
+        apdu_len = uevent_notify_encode_apdu(&apdu[0], &data);
+    ct_test(pTest, sent->dest.mac[0] == mac);
+    ct_test(pTest, sent->confirmed == ConfirmedNotify);
+    ct_test(pTest, sent->apdu_len == apdu_len);
+    ct_test(pTest, memcmp(sent->apdu, apdu, apdu_len) == 0);
+}
+
+void testNotificationClassRecipients(
+    Test * pTest)
+{
+    BACNET_EVENT_NOTIFICATION_DATA data;
+    BACNET_CHARACTER_STRING message;
+    BACNET_DESTINATION *pBacDest = &NC_Info[0].Recipient_List[0];
+    unsigned i;
+
+    testReset();
+    testRecipient(&pBacDest[0], RECIPIENT_TYPE_DEVICE, 1, 1, true);
+    testRecipient(&pBacDest[1], RECIPIENT_TYPE_DEVICE, 2, 1, true);
+    testRecipient(&pBacDest[2], RECIPIENT_TYPE_DEVICE, 3, 2, true);
+    testRecipient(&pBacDest[3], RECIPIENT_TYPE_ADDRESS, 101, 1, false);
+    testRecipient(&pBacDest[4], RECIPIENT_TYPE_DEVICE, 4, 1, false);
+    testRecipient(&pBacDest[5], RECIPIENT_TYPE_DEVICE, 5, 1, false);
+    testRecipient(&pBacDest[6], RECIPIENT_TYPE_ADDRESS, 6, 2, true);
+    Test_Bound[1] = Test_Bound[2] = Test_Bound[3] = true;
+    Test_Bound[4] = Test_Bound[6] = true;
+    /* as written: only the unbound device is asked for */
+    NC_Bind_All();
+    for (i = 0; i < TEST_DEVICES; i++) {
+        ct_test(pTest, Test_WhoIs[i] == ((i == 5) ? 1 : 0));
+    }
+    ct_test(pTest, NC_Pending_Bindings == 1);
+
+    /* one encoding for each process identifier, and confirmed or not */
+    testEventData(&data, &message);
+    Notification_Class_common_reporting_function(&data);
+    ct_test(pTest, Test_Sent_Count == 6);
+    testNotification(pTest, 0, 1, 1, true);
+    testNotification(pTest, 1, 2, 1, true);
+    testNotification(pTest, 2, 3, 2, true);
+    testNotification(pTest, 3, 6, 2, true);
+    testNotification(pTest, 4, 101, 1, false);
+    testNotification(pTest, 5, 4, 1, false);
+
+    /* a flood asks for the unbound device once */
+    for (i = 0; i < 20; i++) {
+        testEventData(&data, &message);
+        Notification_Class_common_reporting_function(&data);
+    }
+    ct_test(pTest, Test_Sent_Count == (21 * 6));
+    ct_test(pTest, Test_WhoIs[5] == 1);
+    Notification_Class_find_recipient();
+    ct_test(pTest, Test_WhoIs[5] == 2);
+    ct_test(pTest, NC_Pending_Bindings == 1);
+    /* bound by its I-Am */
+    Test_Bound[5] = true;
+    Notification_Class_find_recipient();
+    ct_test(pTest, Test_WhoIs[5] == 2);
+    ct_test(pTest, NC_Pending_Bindings == 0);
+    Test_Sent_Count = 0;
+    testEventData(&data, &message);
+    Notification_Class_common_reporting_function(&data);
+    ct_test(pTest, Test_Sent_Count == 7);
+    testNotification(pTest, 6, 5, 1, false);
+    /* a binding that expires is asked for again before an event */
+    Test_Bound[1] = false;
+    Notification_Class_find_recipient();
+    ct_test(pTest, Test_WhoIs[1] == 1);
+    ct_test(pTest, NC_Pending_Bindings == 1);
+    Test_Bound[1] = true;
+    Notification_Class_find_recipient();
+    ct_test(pTest, Test_WhoIs[1] == 1);
+    ct_test(pTest, NC_Pending_Bindings == 0);
+
+    /* changed recipients are worked out again */
+    pBacDest[2].Transitions = TRANSITION_TO_NORMAL_MASKED;
+    NC_Info[0].Active_Day = 0;
+    Test_Sent_Count = 0;
+    testEventData(&data, &message);
+    Notification_Class_common_reporting_function(&data);
+    ct_test(pTest, Test_Sent_Count == 6);
+    for (i = 0; i < Test_Sent_Count; i++) {
+        ct_test(pTest, Test_Sent[i].dest.mac[0] != 3);
+    }
+    Test_Sent_Count = 0;
+    testEventData(&data, &message);
+    data.toState = EVENT_STATE_NORMAL;
+    Notification_Class_common_reporting_function(&data);
+    ct_test(pTest, Test_Sent_Count == 7);
+}
 
+static void testRandomTime(
+    BACNET_TIME * btime)
+{
+    switch (rand() % 8) {
+        case 0:
+            datetime_set_time(btime, 0, 0, 0, 0);
+            break;
+        case 1:
+            datetime_set_time(btime, 23, 59, 59, 99);
+            break;
+        case 2:
+            datetime_set_time(btime, 0xFF, 0xFF, 0xFF, 0xFF);
+            break;
+        default:
+            datetime_set_time(btime, (uint8_t) (rand() % 24),
+                (uint8_t) ((rand() % 4) * 15), 0, 0);
+            break;
+    }
+}
+
+/* the recipients are those IsRecipientActive() found at every time */
+void testNotificationClassActive(
+    Test * pTest)
+{
+    BACNET_EVENT_NOTIFICATION_DATA data;
+    BACNET_CHARACTER_STRING message;
+    BACNET_DESTINATION *pBacDest = &NC_Info[0].Recipient_List[0];
+    static const uint8_t states[] = {
+        EVENT_STATE_HIGH_LIMIT, EVENT_STATE_FAULT, EVENT_STATE_NORMAL
+    };
+    unsigned round, step, s, i, count;
+    uint32_t seconds, expected, sent;
+
+    srand(1);
+    for (round = 0; round < 50; round++) {
+        testReset();
+        count = 1 + (rand() % NC_MAX_RECIPIENTS);
+        for (i = 0; i < count; i++) {
+            testRecipient(&pBacDest[i], RECIPIENT_TYPE_ADDRESS, 100 + i,
+                rand() % 3, false);
+            pBacDest[i].ValidDays = (uint8_t) (rand() & 0x7F);
+            pBacDest[i].Transitions = (uint8_t) (rand() & 0x07);
+            testRandomTime(&pBacDest[i].FromTime);
+            testRandomTime(&pBacDest[i].ToTime);
+        }
+        Test_DateTime.date.wday = 1;
+        seconds = 0;
+        for (step = 0; step < 500; step++) {
+            if ((rand() % 20) == 0) {
+                /* the clock is set back or forward, to a quarter hour */
+                seconds = (rand() % 96) * 900;
+            } else if (rand() % 2) {
+                seconds += rand() % 60;
+            } else {
+                seconds += (rand() % 60) * 60;
+            }
+            if (seconds >= 86400) {
+                seconds %= 86400;
+                Test_DateTime.date.wday = (Test_DateTime.date.wday % 7) + 1;
+            }
+            datetime_set_time(&Test_DateTime.time, (uint8_t) (seconds / 3600),
+                (uint8_t) ((seconds / 60) % 60), (uint8_t) (seconds % 60), 0);
+            for (s = 0; s < sizeof(states); s++) {
+                expected = 0;
+                for (i = 0; i < count; i++) {
+                    if (testRecipientActive(&pBacDest[i], states[s]))
+                        expected |= (1UL << i);
+                }
+                testEventData(&data, &message);
+                data.toState = states[s];
+                Test_Sent_Count = 0;
+                Notification_Class_common_reporting_function(&data);
+                sent = 0;
+                for (i = 0; i < Test_Sent_Count; i++) {
+                    sent |= (1UL << (Test_Sent[i].dest.mac[0] - 100));
+                }
+                ct_test(pTest, Test_Sent_Count <= count);
+                ct_test(pTest, sent == expected);
             }
         }
     }
 }
+
+static void testNotificationClassBenchmark(
+    unsigned events)
+{
+    BACNET_EVENT_NOTIFICATION_DATA data;
+    BACNET_CHARACTER_STRING message;
+    BACNET_DESTINATION *pBacDest = &NC_Info[0].Recipient_List[0];
+    clock_t begin;
+    unsigned i;
+
+    testReset();
+    for (i = 0; i < NC_MAX_RECIPIENTS; i++) {
+        Test_Bound[i] = true;
+        testRecipient(&pBacDest[i], RECIPIENT_TYPE_DEVICE, i, 1, i & 1);
+    }
+    testEventData(&data, &message);
+    begin = clock();
+    for (i = 0; i < events; i++) {
+        testReportReference(&NC_Info[0], &data);
+    }
+    printf("%u recipients: each encoded %.2f us/event\n", NC_MAX_RECIPIENTS,
+        ((double) (clock() - begin) * 1000000.0 / CLOCKS_PER_SEC) / events);
+    begin = clock();
+    for (i = 0; i < events; i++) {
+        Notification_Class_common_reporting_function(&data);
+    }
+    printf("%u recipients: encoded once %.2f us/event\n", NC_MAX_RECIPIENTS,
+        ((double) (clock() - begin) * 1000000.0 / CLOCKS_PER_SEC) / events);
+}
+
+#ifdef TEST_NOTIFICATION_CLASS
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    unsigned events = 100000;
+
+    pTest = ct_create("BACnet Notification Class", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testNotificationClassRecipients);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testNotificationClassActive);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1)
+        events = strtoul(argv[1], NULL, 0);
+    testNotificationClassBenchmark(events);
+
+    return 0;
+}
+
+#endif /* TEST_NOTIFICATION_CLASS */
+#endif /* TEST */
 #endif /* defined(INTRINSIC_REPORTING) */
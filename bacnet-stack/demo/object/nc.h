@@ -37,6 +37,9 @@ extern "C" {
 
 /* max "length" of recipient_list */
 #define NC_MAX_RECIPIENTS 10
+#if (NC_MAX_RECIPIENTS > 32)
+#error NC_MAX_RECIPIENTS must fit in the active recipient bits
+#endif
 /* Recipient types */
     typedef enum {
         RECIPIENT_TYPE_NOTINITIALIZED = 0,
@@ -79,6 +82,14 @@ BACnetRecipient ::= CHOICE {
         uint8_t Priority[MAX_BACNET_EVENT_TRANSITION];  /* BACnetARRAY[3] of Unsigned */
         uint8_t Ack_Required;   /* BACnetEventTransitionBits */
         BACNET_DESTINATION Recipient_List[NC_MAX_RECIPIENTS];   /* List of BACnetDestination */
+        /* The recipients active for each transition, bit n for
+           Recipient_List[n], on Active_Day from Active_From until
+           before Active_Until - times packed as hour, minute, second
+           and hundredths octets, so that they compare as times do */
+        uint32_t Active[MAX_BACNET_EVENT_TRANSITION];
+        uint8_t Active_Day;     /* 1=Monday-7=Sunday, 0 when not known */
+        uint32_t Active_From;
+        uint32_t Active_Until;
     } NOTIFICATION_CLASS_INFO;
 
 
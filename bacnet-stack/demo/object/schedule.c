@@ -25,6 +25,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -43,6 +44,24 @@
 
 SCHEDULE_DESCR Schedule_Descr[MAX_SCHEDULES];
 
+/*
+ * The schedules wait in a timer wheel for the second of their next
+ * transition, at most a day away: 256 slots of a second, each holding
+ * the schedules due in that second of any turn of the wheel. When its
+ * slot comes round, a schedule that is due goes to the due slot, and
+ * the others wait for a later turn.
+ */
+#define SCHEDULE_WHEEL_SECONDS 256
+#define SCHEDULE_WHEEL_DUE SCHEDULE_WHEEL_SECONDS
+/* more seconds than this since the last turn, or going back, and the
+   schedules are all looked at again rather than the wheel turned */
+#define SCHEDULE_WHEEL_CATCH_UP 3600
+static int Schedule_Wheel[SCHEDULE_WHEEL_DUE + 1];
+static time_t Schedule_Wheel_Time;      /* the last second the wheel turned to */
+
+/* hundredths of a second in a day: the end of the last transition */
+#define SCHEDULE_DAY_END 8640000UL
+
 static const int Schedule_Properties_Required[] = {
     PROP_OBJECT_IDENTIFIER,
     PROP_OBJECT_NAME,
@@ -60,6 +79,7 @@ static const int Schedule_Properties_Required[] = {
 
 static const int Schedule_Properties_Optional[] = {
     PROP_WEEKLY_SCHEDULE,
+    PROP_EXCEPTION_SCHEDULE,
     -1
 };
 
@@ -84,17 +104,18 @@ void Schedule_Init(void)
     unsigned i, j;
     for (i = 0; i < MAX_SCHEDULES; i++) {
         /* whole year, change as neccessary */
-        Schedule_Descr[i].Start_Date.year = 0xFF;
+        Schedule_Descr[i].Start_Date.year = 1900 + 0xFF;
         Schedule_Descr[i].Start_Date.month = 1;
         Schedule_Descr[i].Start_Date.day = 1;
         Schedule_Descr[i].Start_Date.wday = 0xFF;
-        Schedule_Descr[i].End_Date.year = 0xFF;
+        Schedule_Descr[i].End_Date.year = 1900 + 0xFF;
         Schedule_Descr[i].End_Date.month = 12;
         Schedule_Descr[i].End_Date.day = 31;
         Schedule_Descr[i].End_Date.wday = 0xFF;
         for (j = 0; j < 7; j++) {
             Schedule_Descr[i].Weekly_Schedule[j].TV_Count = 0;
         }
+        Schedule_Descr[i].Exception_Count = 0;
         Schedule_Descr[i].Present_Value = &Schedule_Descr[i].Schedule_Default;
         Schedule_Descr[i].Schedule_Default.context_specific = false;
         Schedule_Descr[i].Schedule_Default.tag = BACNET_APPLICATION_TAG_REAL;
@@ -102,7 +123,11 @@ void Schedule_Init(void)
         Schedule_Descr[i].obj_prop_ref_cnt = 0; /* no references, add as needed */
         Schedule_Descr[i].Priority_For_Writing = 16;    /* lowest priority */
         Schedule_Descr[i].Out_Of_Service = false;
+        Schedule_Descr[i].Transition_Count = 0;
+        Schedule_Descr[i].Due_Slot = -1;
     }
+    /* the schedules are all looked at when the timer first runs */
+    Schedule_Wheel_Time = 0;
 }
 
 bool Schedule_Valid_Instance(uint32_t object_instance)
@@ -165,10 +190,68 @@ void Schedule_Out_Of_Service_Set(
 
     index = Schedule_Instance_To_Index(object_instance);
     if (index < MAX_SCHEDULES) {
+        if (Schedule_Descr[index].Out_Of_Service && !value) {
+            /* back to the value in effect, written again */
+            Schedule_Changed(object_instance);
+        }
         Schedule_Descr[index].Out_Of_Service = value;
     }
 }
 
+static int Schedule_Encode_Special_Event(uint8_t * apdu,
+    BACNET_SPECIAL_EVENT * event)
+{
+    BACNET_CALENDAR_ENTRY *entry = &event->Calendar_Entry;
+    BACNET_OCTET_STRING octet_string;
+    uint8_t weeknday[3];
+    int apdu_len = 0;
+    int i;
+
+    if (event->Calendar_Referenced) {
+        apdu_len +=
+            encode_context_object_id(&apdu[apdu_len], 1, OBJECT_CALENDAR,
+            event->Calendar_Instance);
+    } else {
+        apdu_len += encode_opening_tag(&apdu[apdu_len], 0);
+        switch (entry->tag) {
+            case CALENDAR_ENTRY_DATE:
+                apdu_len +=
+                    encode_context_date(&apdu[apdu_len], 0, &entry->type.Date);
+                break;
+            case CALENDAR_ENTRY_DATE_RANGE:
+                apdu_len += encode_opening_tag(&apdu[apdu_len], 1);
+                apdu_len +=
+                    encode_application_date(&apdu[apdu_len],
+                    &entry->type.Date_Range.Start_Date);
+                apdu_len +=
+                    encode_application_date(&apdu[apdu_len],
+                    &entry->type.Date_Range.End_Date);
+                apdu_len += encode_closing_tag(&apdu[apdu_len], 1);
+                break;
+            case CALENDAR_ENTRY_WEEK_N_DAY:
+            default:
+                weeknday[0] = entry->type.WeekNDay.month;
+                weeknday[1] = entry->type.WeekNDay.week_of_month;
+                weeknday[2] = entry->type.WeekNDay.day_of_week;
+                octetstring_init(&octet_string, weeknday, sizeof(weeknday));
+                apdu_len +=
+                    encode_context_octet_string(&apdu[apdu_len], 2,
+                    &octet_string);
+                break;
+        }
+        apdu_len += encode_closing_tag(&apdu[apdu_len], 0);
+    }
+    apdu_len += encode_opening_tag(&apdu[apdu_len], 2);
+    for (i = 0; i < event->TV_Count; i++) {
+        apdu_len +=
+            bacapp_encode_time_value(&apdu[apdu_len], &event->Time_Values[i]);
+    }
+    apdu_len += encode_closing_tag(&apdu[apdu_len], 2);
+    apdu_len += encode_context_unsigned(&apdu[apdu_len], 3, event->Priority);
+
+    return apdu_len;
+}
+
 
 int Schedule_Read_Property(BACNET_READ_PROPERTY_DATA * rpdata)
 {
@@ -252,6 +335,27 @@ int Schedule_Read_Property(BACNET_READ_PROPERTY_DATA * rpdata)
                 apdu_len = BACNET_STATUS_ERROR;
             }
             break;
+        case PROP_EXCEPTION_SCHEDULE:
+            if (rpdata->array_index == 0)
+                apdu_len =
+                    encode_application_unsigned(&apdu[0],
+                    CurrentSC->Exception_Count);
+            else if (rpdata->array_index == BACNET_ARRAY_ALL) {
+                for (i = 0; i < CurrentSC->Exception_Count; i++) {
+                    apdu_len +=
+                        Schedule_Encode_Special_Event(&apdu[apdu_len],
+                        &CurrentSC->Exception_Schedule[i]);
+                }
+            } else if (rpdata->array_index <= CurrentSC->Exception_Count) {
+                apdu_len =
+                    Schedule_Encode_Special_Event(&apdu[0],
+                    &CurrentSC->Exception_Schedule[rpdata->array_index - 1]);
+            } else {
+                rpdata->error_class = ERROR_CLASS_PROPERTY;
+                rpdata->error_code = ERROR_CODE_INVALID_ARRAY_INDEX;
+                apdu_len = BACNET_STATUS_ERROR;
+            }
+            break;
         case PROP_SCHEDULE_DEFAULT:
             apdu_len =
                 bacapp_encode_data(&apdu[0], &CurrentSC->Schedule_Default);
@@ -301,6 +405,7 @@ int Schedule_Read_Property(BACNET_READ_PROPERTY_DATA * rpdata)
     }
 
     if ((apdu_len >= 0) && (rpdata->object_property != PROP_WEEKLY_SCHEDULE)
+        && (rpdata->object_property != PROP_EXCEPTION_SCHEDULE)
         && (rpdata->array_index != BACNET_ARRAY_ALL)) {
         rpdata->error_class = ERROR_CLASS_PROPERTY;
         rpdata->error_code = ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY;
@@ -370,6 +475,7 @@ bool Schedule_Write_Property(BACNET_WRITE_PROPERTY_DATA * wp_data)
         case PROP_PRESENT_VALUE:
         case PROP_EFFECTIVE_PERIOD:
         case PROP_WEEKLY_SCHEDULE:
+        case PROP_EXCEPTION_SCHEDULE:
         case PROP_SCHEDULE_DEFAULT:
         case PROP_LIST_OF_OBJECT_PROPERTY_REFERENCES:
         case PROP_PRIORITY_FOR_WRITING:
@@ -401,43 +507,927 @@ bool Schedule_In_Effective_Period(SCHEDULE_DESCR * desc,
     return res;
 }
 
+/* hundredths of a second since midnight; a wildcard counts as zero */
+static uint32_t Schedule_Hundredths(BACNET_TIME * time)
+{
+    uint32_t hour = (time->hour == 0xFF) ? 0 : time->hour;
+    uint32_t min = (time->min == 0xFF) ? 0 : time->min;
+    uint32_t sec = (time->sec == 0xFF) ? 0 : time->sec;
+    uint32_t hundredths = (time->hundredths == 0xFF) ? 0 : time->hundredths;
+
+    return (((hour * 60) + min) * 60 + sec) * 100 + hundredths;
+}
+
+/* The value of a list of time values in effect at a time of the day:
+   that of the latest time value not after it, or NULL when there is
+   none, or when it is NULL and so relinquishes */
+static BACNET_APPLICATION_DATA_VALUE *Schedule_Value_At(
+    BACNET_TIME_VALUE * tv,
+    unsigned tv_count,
+    uint32_t hundredths)
+{
+    BACNET_APPLICATION_DATA_VALUE *value = NULL;
+    uint32_t latest = 0;
+    uint32_t tv_time;
+    unsigned i;
+
+    for (i = 0; i < tv_count; i++) {
+        tv_time = Schedule_Hundredths(&tv[i].Time);
+        if ((tv_time <= hundredths) && ((value == NULL) ||
+                (tv_time >= latest))) {
+            value = &tv[i].Value;
+            latest = tv_time;
+        }
+    }
+    if (value && (value->tag == BACNET_APPLICATION_TAG_NULL))
+        value = NULL;
+
+    return value;
+}
+
+/* whether two values are the same, so that going from one to the other
+   is not a transition */
+static bool Schedule_Same_Value(BACNET_APPLICATION_DATA_VALUE * value1,
+    BACNET_APPLICATION_DATA_VALUE * value2)
+{
+    if (value1 == value2)
+        return true;
+    if ((value1 == NULL) || (value2 == NULL) ||
+        (value1->tag != value2->tag))
+        return false;
+    switch (value1->tag) {
+        case BACNET_APPLICATION_TAG_NULL:
+            return true;
+#if defined (BACAPP_BOOLEAN)
+        case BACNET_APPLICATION_TAG_BOOLEAN:
+            return value1->type.Boolean == value2->type.Boolean;
+#endif
+#if defined (BACAPP_UNSIGNED)
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            return value1->type.Unsigned_Int == value2->type.Unsigned_Int;
+#endif
+#if defined (BACAPP_SIGNED)
+        case BACNET_APPLICATION_TAG_SIGNED_INT:
+            return value1->type.Signed_Int == value2->type.Signed_Int;
+#endif
+#if defined (BACAPP_REAL)
+        case BACNET_APPLICATION_TAG_REAL:
+            return value1->type.Real == value2->type.Real;
+#endif
+#if defined (BACAPP_DOUBLE)
+        case BACNET_APPLICATION_TAG_DOUBLE:
+            return value1->type.Double == value2->type.Double;
+#endif
+#if defined (BACAPP_ENUMERATED)
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            return value1->type.Enumerated == value2->type.Enumerated;
+#endif
+        default:
+            /* other values are only the same as themselves */
+            return false;
+    }
+}
+
+/* whether a date with wildcards matches a date, with the special
+   values for odd and even months and days, and the last day of the
+   month */
+static bool Schedule_Date_Match(BACNET_DATE * pattern,
+    BACNET_DATE * date)
+{
+    if ((pattern->year != 0xFF) && (pattern->year != 1900 + 0xFF) &&
+        (pattern->year != date->year))
+        return false;
+    if (pattern->month == 13) {
+        if ((date->month & 1) == 0)
+            return false;
+    } else if (pattern->month == 14) {
+        if ((date->month & 1) != 0)
+            return false;
+    } else if ((pattern->month != 0xFF) && (pattern->month != date->month))
+        return false;
+    if (pattern->day == 32) {
+        if (date->day != datetime_month_days(date->year, date->month))
+            return false;
+    } else if (pattern->day == 33) {
+        if ((date->day & 1) == 0)
+            return false;
+    } else if (pattern->day == 34) {
+        if ((date->day & 1) != 0)
+            return false;
+    } else if ((pattern->day != 0xFF) && (pattern->day != date->day))
+        return false;
+    if ((pattern->wday != 0xFF) && (pattern->wday != date->wday))
+        return false;
+
+    return true;
+}
+
+static bool Schedule_WeekNDay_Match(BACNET_WEEKNDAY * weeknday,
+    BACNET_DATE * date)
+{
+    if (weeknday->month == 13) {
+        if ((date->month & 1) == 0)
+            return false;
+    } else if (weeknday->month == 14) {
+        if ((date->month & 1) != 0)
+            return false;
+    } else if ((weeknday->month != 0xFF) && (weeknday->month != date->month))
+        return false;
+    if (weeknday->week_of_month == 6) {
+        if ((date->day + 7) <= datetime_month_days(date->year, date->month))
+            return false;
+    } else if ((weeknday->week_of_month != 0xFF) &&
+        (weeknday->week_of_month != (((date->day - 1) / 7) + 1)))
+        return false;
+    if ((weeknday->day_of_week != 0xFF) &&
+        (weeknday->day_of_week != date->wday))
+        return false;
+
+    return true;
+}
+
+bool Schedule_Special_Event_Match(BACNET_SPECIAL_EVENT * event,
+    BACNET_DATE * date)
+{
+    BACNET_CALENDAR_ENTRY *entry = &event->Calendar_Entry;
+
+    if (event->Calendar_Referenced)
+        return false;
+    switch (entry->tag) {
+        case CALENDAR_ENTRY_DATE:
+            return Schedule_Date_Match(&entry->type.Date, date);
+        case CALENDAR_ENTRY_DATE_RANGE:
+            return (datetime_wildcard_compare_date(&entry->type.Date_Range.
+                    Start_Date, date) <= 0) &&
+                (datetime_wildcard_compare_date(&entry->type.Date_Range.
+                    End_Date, date) >= 0);
+        case CALENDAR_ENTRY_WEEK_N_DAY:
+            return Schedule_WeekNDay_Match(&entry->type.WeekNDay, date);
+        default:
+            return false;
+    }
+}
+
 void Schedule_Recalculate_PV(SCHEDULE_DESCR * desc,
     BACNET_WEEKDAY wday,
     BACNET_TIME * time)
 {
-    int i;
-    desc->Present_Value = NULL;
-
-    /* for future development, here should be the loop for Exception Schedule */
-	
-	/* Just a note to developers: We have a paying customer who has asked us to fully implement the Schedule Object.
-		In good spirit, they have agreed to allow us to release the code we develop back to the Open Source community after a 6-12 month waiting period.
-		However, if you are about to work on this yourself, please ping us at info@connect-ex.com, we may be able to broker an early release on a
-		case-by-case basis. */
-		
-
-    for (i = 0;
-        i < desc->Weekly_Schedule[wday - 1].TV_Count &&
-        desc->Present_Value == NULL; i++) {
-        int diff = datetime_wildcard_compare_time(time,
-            &desc->Weekly_Schedule[wday - 1].Time_Values[i].Time);
-        if (diff >= 0 &&
-            desc->Weekly_Schedule[wday - 1].Time_Values[i].Value.tag !=
-            BACNET_APPLICATION_TAG_NULL) {
-            desc->Present_Value =
-                &desc->Weekly_Schedule[wday - 1].Time_Values[i].Value;
-        }
-    }
+    BACNET_DAILY_SCHEDULE *day = &desc->Weekly_Schedule[wday - 1];
 
+    desc->Present_Value =
+        Schedule_Value_At(day->Time_Values, day->TV_Count,
+        Schedule_Hundredths(time));
     if (desc->Present_Value == NULL)
         desc->Present_Value = &desc->Schedule_Default;
 }
 
+/* Compile the weekly and exception schedules for a day into the
+   transitions of the day. At each time value, the value in effect is
+   that of the special event of the highest priority that has one,
+   then that of the weekly schedule, then the Schedule_Default. */
+void Schedule_Compile(SCHEDULE_DESCR * desc,
+    BACNET_DATE * date)
+{
+    BACNET_SPECIAL_EVENT *events[BACNET_EXCEPTION_SCHEDULE_SIZE];
+    uint32_t times[BACNET_SCHEDULE_TRANSITIONS_SIZE];
+    BACNET_DAILY_SCHEDULE *day = NULL;
+    BACNET_SPECIAL_EVENT *event;
+    BACNET_APPLICATION_DATA_VALUE *value;
+    unsigned event_count = 0;
+    unsigned time_count = 0;
+    unsigned i, j;
+    uint32_t t;
+
+    datetime_copy_date(&desc->Transition_Date, date);
+    desc->Transition_Count = 0;
+    times[time_count++] = 0;
+    if (Schedule_In_Effective_Period(desc, date) && (date->wday >= 1) &&
+        (date->wday <= 7)) {
+        day = &desc->Weekly_Schedule[date->wday - 1];
+        for (i = 0; i < day->TV_Count; i++) {
+            times[time_count++] =
+                Schedule_Hundredths(&day->Time_Values[i].Time);
+        }
+        for (i = 0; i < desc->Exception_Count; i++) {
+            event = &desc->Exception_Schedule[i];
+            if (!Schedule_Special_Event_Match(event, date))
+                continue;
+            /* in order of priority, then of the array */
+            for (j = event_count; (j > 0) &&
+                (events[j - 1]->Priority > event->Priority); j--) {
+                events[j] = events[j - 1];
+            }
+            events[j] = event;
+            event_count++;
+            for (j = 0; j < event->TV_Count; j++) {
+                times[time_count++] =
+                    Schedule_Hundredths(&event->Time_Values[j].Time);
+            }
+        }
+    }
+    /* in order of time */
+    for (i = 1; i < time_count; i++) {
+        t = times[i];
+        for (j = i; (j > 0) && (times[j - 1] > t); j--) {
+            times[j] = times[j - 1];
+        }
+        times[j] = t;
+    }
+    for (i = 0; i < time_count; i++) {
+        if ((i > 0) && (times[i] == times[i - 1]))
+            continue;
+        value = NULL;
+        for (j = 0; (j < event_count) && (value == NULL); j++) {
+            value =
+                Schedule_Value_At(events[j]->Time_Values, events[j]->TV_Count,
+                times[i]);
+        }
+        if ((value == NULL) && day)
+            value =
+                Schedule_Value_At(day->Time_Values, day->TV_Count, times[i]);
+        if (value == NULL)
+            value = &desc->Schedule_Default;
+        if ((desc->Transition_Count == 0) ||
+            !Schedule_Same_Value(value,
+                desc->Transitions[desc->Transition_Count - 1].Value)) {
+            desc->Transitions[desc->Transition_Count].Time = times[i];
+            desc->Transitions[desc->Transition_Count].Value = value;
+            desc->Transition_Count++;
+        }
+    }
+}
+
+/* the transition in effect at a time of the compiled day */
+static unsigned Schedule_Transition_Index(SCHEDULE_DESCR * desc,
+    uint32_t hundredths)
+{
+    unsigned index = desc->Transition_Count - 1;
+
+    while ((index > 0) && (desc->Transitions[index].Time > hundredths)) {
+        index--;
+    }
+
+    return index;
+}
+
+/* Set the Present_Value to the value in effect at a date and time,
+   compiling the schedules for the date if they are not already, and
+   return whether the value changed */
+bool Schedule_Recalculate(SCHEDULE_DESCR * desc,
+    BACNET_DATE * date,
+    BACNET_TIME * time)
+{
+    BACNET_APPLICATION_DATA_VALUE *value;
+    bool changed;
+
+    if ((desc->Transition_Count == 0) ||
+        (datetime_compare_date(&desc->Transition_Date, date) != 0))
+        Schedule_Compile(desc, date);
+    value =
+        desc->Transitions[Schedule_Transition_Index(desc,
+            Schedule_Hundredths(time))].Value;
+    changed = !Schedule_Same_Value(value, desc->Present_Value);
+    desc->Present_Value = value;
+
+    return changed;
+}
+
+/* The time of the first transition after a time of the compiled day,
+   in hundredths of a second since midnight, or SCHEDULE_DAY_END if
+   there is none until the next day */
+uint32_t Schedule_Next_Transition(SCHEDULE_DESCR * desc,
+    BACNET_TIME * time)
+{
+    unsigned index;
+
+    if (desc->Transition_Count == 0)
+        return SCHEDULE_DAY_END;
+    index = Schedule_Transition_Index(desc, Schedule_Hundredths(time)) + 1;
+    if (index < desc->Transition_Count)
+        return desc->Transitions[index].Time;
+
+    return SCHEDULE_DAY_END;
+}
+
+/* Write the Present_Value to the properties of the objects of this
+   device in the List_Of_Object_Property_References */
+static void Schedule_Write_References(SCHEDULE_DESCR * desc)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+    BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE *reference;
+    int len;
+    unsigned i;
+
+    if (desc->obj_prop_ref_cnt == 0)
+        return;
+    len =
+        bacapp_encode_application_data(&wp_data.application_data[0],
+        desc->Present_Value);
+    if (len <= 0)
+        return;
+    for (i = 0; i < desc->obj_prop_ref_cnt; i++) {
+        reference = &desc->Object_Property_References[i];
+        if ((reference->deviceIndentifier.type == OBJECT_DEVICE) &&
+            (reference->deviceIndentifier.instance !=
+                Device_Object_Instance_Number()))
+            continue;
+        wp_data.object_type = reference->objectIdentifier.type;
+        wp_data.object_instance = reference->objectIdentifier.instance;
+        wp_data.object_property = reference->propertyIdentifier;
+        wp_data.array_index = reference->arrayIndex;
+        wp_data.priority = desc->Priority_For_Writing;
+        wp_data.application_data_len = len;
+        (void) Device_Write_Property(&wp_data);
+    }
+}
+
+/* Put a schedule in the slot of the wheel for its due time */
+static void Schedule_Wheel_Place(int index,
+    int slot)
+{
+    SCHEDULE_DESCR *desc = &Schedule_Descr[index];
+
+    desc->Due_Slot = slot;
+    desc->Due_Prev = -1;
+    desc->Due_Next = Schedule_Wheel[slot];
+    if (desc->Due_Next >= 0)
+        Schedule_Descr[desc->Due_Next].Due_Prev = index;
+    Schedule_Wheel[slot] = index;
+}
+
+/* Take a schedule out of the wheel */
+static void Schedule_Wheel_Remove(int index)
+{
+    SCHEDULE_DESCR *desc = &Schedule_Descr[index];
+
+    if (desc->Due_Slot < 0)
+        return;
+    if (desc->Due_Prev >= 0)
+        Schedule_Descr[desc->Due_Prev].Due_Next = desc->Due_Next;
+    else
+        Schedule_Wheel[desc->Due_Slot] = desc->Due_Next;
+    if (desc->Due_Next >= 0)
+        Schedule_Descr[desc->Due_Next].Due_Prev = desc->Due_Prev;
+    desc->Due_Slot = -1;
+}
+
+static void Schedule_Wheel_Due(int index,
+    time_t due)
+{
+    Schedule_Wheel_Remove(index);
+    Schedule_Descr[index].Due = due;
+    Schedule_Wheel_Place(index,
+        (int) (due & (SCHEDULE_WHEEL_SECONDS - 1)));
+}
+
+/* the second of a time of a day, in local time */
+static time_t Schedule_Local_Time(BACNET_DATE * date,
+    uint32_t hundredths)
+{
+    struct tm tm = { 0 };
+    uint32_t seconds = (hundredths + 99) / 100;
+
+    tm.tm_year = date->year - 1900;
+    tm.tm_mon = date->month - 1;
+    tm.tm_mday = date->day;
+    /* midnight at the end of the day is hour 24 */
+    tm.tm_hour = seconds / 3600;
+    tm.tm_min = (seconds / 60) % 60;
+    tm.tm_sec = seconds % 60;
+    tm.tm_isdst = -1;
+
+    return mktime(&tm);
+}
+
+/* Look at a schedule that is due: set its Present_Value, write it if it
+   changed, and put the schedule in the wheel for its next transition */
+static void Schedule_Run(int index,
+    time_t now)
+{
+    SCHEDULE_DESCR *desc = &Schedule_Descr[index];
+    BACNET_DATE date;
+    BACNET_TIME time;
+    struct tm *tm;
+    time_t due;
+    bool write;
+
+    tm = localtime(&now);
+    datetime_set_date(&date, (uint16_t) (tm->tm_year + 1900),
+        (uint8_t) (tm->tm_mon + 1), (uint8_t) tm->tm_mday);
+    datetime_set_time(&time, (uint8_t) tm->tm_hour, (uint8_t) tm->tm_min,
+        (uint8_t) tm->tm_sec, 0);
+    if (!desc->Out_Of_Service) {
+        /* changed schedules are written, even with the same value */
+        write = (desc->Transition_Count == 0);
+        if (Schedule_Recalculate(desc, &date, &time))
+            write = true;
+        if (write)
+            Schedule_Write_References(desc);
+    }
+    due = Schedule_Local_Time(&date, Schedule_Next_Transition(desc, &time));
+    if (due <= now)
+        due = now + 1;
+    Schedule_Wheel_Due(index, due);
+}
+
+/* Empty the wheel, and make all the schedules due after tAfter */
+static void Schedule_Wheel_All(time_t after)
+{
+    int index;
+
+    for (index = 0; index <= SCHEDULE_WHEEL_DUE; index++) {
+        Schedule_Wheel[index] = -1;
+    }
+    Schedule_Wheel_Time = after;
+    for (index = 0; index < MAX_SCHEDULES; index++) {
+        Schedule_Descr[index].Due_Slot = -1;
+        Schedule_Wheel_Due(index, after + 1);
+    }
+}
+
+/* Turn the wheel to now, and look at the schedules that have come due
+   on the way; if the clock has jumped, look at all of them */
+static void Schedule_Timer_Run(time_t now)
+{
+    SCHEDULE_DESCR *desc;
+    int slot;
+    int index;
+    int next;
+
+    if ((Schedule_Wheel_Time == 0) || (now < Schedule_Wheel_Time) ||
+        ((now - Schedule_Wheel_Time) > SCHEDULE_WHEEL_CATCH_UP))
+        Schedule_Wheel_All(now - 1);
+    while (Schedule_Wheel_Time < now) {
+        Schedule_Wheel_Time++;
+        slot = (int) (Schedule_Wheel_Time & (SCHEDULE_WHEEL_SECONDS - 1));
+        for (index = Schedule_Wheel[slot]; index >= 0; index = next) {
+            desc = &Schedule_Descr[index];
+            next = desc->Due_Next;
+            if (desc->Due <= Schedule_Wheel_Time) {
+                Schedule_Wheel_Remove(index);
+                Schedule_Wheel_Place(index, SCHEDULE_WHEEL_DUE);
+            }
+        }
+    }
+    while (Schedule_Wheel[SCHEDULE_WHEEL_DUE] >= 0) {
+        Schedule_Run(Schedule_Wheel[SCHEDULE_WHEEL_DUE], now);
+    }
+}
+
+void Schedule_Changed(uint32_t object_instance)
+{
+    unsigned index = Schedule_Instance_To_Index(object_instance);
+
+    if (index < MAX_SCHEDULES) {
+        Schedule_Descr[index].Transition_Count = 0;
+        /* looked at the next time the timer runs */
+        if (Schedule_Wheel_Time != 0)
+            Schedule_Wheel_Due((int) index, Schedule_Wheel_Time + 1);
+    }
+}
+
+/****************************************************************************
+ * Set the Present_Value of the schedules that are due for a transition,    *
+ * and write it to their references. The schedules wait in the timer        *
+ * wheel, so only those that are due are looked at each second.             *
+ ****************************************************************************/
+
+void schedule_timer(uint16_t uSeconds)
+{
+    /* unused parameter */
+    uSeconds = uSeconds;
+    /* use OS to get the current time */
+    Schedule_Timer_Run(time(NULL));
+}
+
 #ifdef TEST
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include "ctest.h"
 
+/* the writes of the schedules, to Analog Values of their instance */
+static unsigned long Test_Write_Count[MAX_SCHEDULES];
+static float Test_Write_Value[MAX_SCHEDULES];
+static uint8_t Test_Write_Priority;
+
+bool WPValidateArgType(BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    if (pValue->tag != ucExpectedTag) {
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t Device_Object_Instance_Number(void)
+{
+    return 123;
+}
+
+bool Device_Write_Property(BACNET_WRITE_PROPERTY_DATA * wp_data)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+
+    if ((wp_data->object_type != OBJECT_ANALOG_VALUE) ||
+        (wp_data->object_instance >= MAX_SCHEDULES))
+        return false;
+    (void) bacapp_decode_application_data(wp_data->application_data,
+        wp_data->application_data_len, &value);
+    Test_Write_Count[wp_data->object_instance]++;
+    Test_Write_Value[wp_data->object_instance] =
+        (value.tag == BACNET_APPLICATION_TAG_REAL) ? value.type.Real : -1;
+    Test_Write_Priority = wp_data->priority;
+
+    return true;
+}
+
+static void testScheduleTimeValue(BACNET_TIME_VALUE * tv,
+    uint8_t hour,
+    uint8_t minute,
+    float real)
+{
+    datetime_set_time(&tv->Time, hour, minute, 0, 0);
+    tv->Value.context_specific = false;
+    if (real < 0) {
+        tv->Value.tag = BACNET_APPLICATION_TAG_NULL;
+    } else {
+        tv->Value.tag = BACNET_APPLICATION_TAG_REAL;
+        tv->Value.type.Real = real;
+    }
+}
+
+/* the value in effect at a time of a day */
+static float testScheduleValue(SCHEDULE_DESCR * desc,
+    BACNET_DATE * date,
+    uint8_t hour,
+    uint8_t minute)
+{
+    BACNET_TIME time;
+
+    datetime_set_time(&time, hour, minute, 0, 0);
+    (void) Schedule_Recalculate(desc, date, &time);
+
+    return desc->Present_Value->type.Real;
+}
+
+/* Mondays 08:00-12:00 and 13:00-18:00 at 22, 16 otherwise */
+static void testScheduleWeekly(SCHEDULE_DESCR * desc)
+{
+    BACNET_DAILY_SCHEDULE *monday = &desc->Weekly_Schedule[0];
+
+    desc->Schedule_Default.tag = BACNET_APPLICATION_TAG_REAL;
+    desc->Schedule_Default.type.Real = 16.0;
+    testScheduleTimeValue(&monday->Time_Values[0], 8, 0, 22.0);
+    testScheduleTimeValue(&monday->Time_Values[1], 12, 0, -1);
+    /* not in order of time */
+    testScheduleTimeValue(&monday->Time_Values[2], 18, 0, -1);
+    testScheduleTimeValue(&monday->Time_Values[3], 13, 0, 22.0);
+    monday->TV_Count = 4;
+}
+
+void testScheduleEvaluation(Test * pTest)
+{
+    SCHEDULE_DESCR *desc = &Schedule_Descr[0];
+    BACNET_SPECIAL_EVENT *event;
+    BACNET_DATE date;
+    BACNET_TIME time;
+    static const uint32_t hours[] = { 0, 8, 10, 10, 10, 11, 12, 13, 18 };
+    static const uint32_t minutes[] = { 0, 0, 0, 30, 45, 0, 0, 0, 0 };
+    static const float values[] =
+        { 16.0, 22.0, 30.0, 40.0, 30.0, 22.0, 16.0, 22.0, 16.0 };
+    unsigned i;
+
+    Schedule_Init();
+    testScheduleWeekly(desc);
+    datetime_set_date(&date, 2016, 6, 6);
+    ct_test(pTest, date.wday == BACNET_WEEKDAY_MONDAY);
+    Schedule_Compile(desc, &date);
+    ct_test(pTest, desc->Transition_Count == 5);
+    ct_test(pTest, testScheduleValue(desc, &date, 7, 59) == 16.0);
+    ct_test(pTest, testScheduleValue(desc, &date, 8, 0) == 22.0);
+    ct_test(pTest, testScheduleValue(desc, &date, 12, 30) == 16.0);
+    ct_test(pTest, testScheduleValue(desc, &date, 17, 59) == 22.0);
+    ct_test(pTest, testScheduleValue(desc, &date, 23, 59) == 16.0);
+    datetime_set_time(&time, 8, 0, 0, 0);
+    ct_test(pTest, Schedule_Next_Transition(desc, &time) == 12 * 360000UL);
+    datetime_set_time(&time, 18, 0, 0, 0);
+    ct_test(pTest, Schedule_Next_Transition(desc, &time) == SCHEDULE_DAY_END);
+    /* the weekly schedule alone */
+    datetime_set_time(&time, 13, 0, 0, 0);
+    Schedule_Recalculate_PV(desc, BACNET_WEEKDAY_MONDAY, &time);
+    ct_test(pTest, desc->Present_Value->type.Real == 22.0);
+    datetime_set_time(&time, 12, 0, 0, 0);
+    Schedule_Recalculate_PV(desc, BACNET_WEEKDAY_MONDAY, &time);
+    ct_test(pTest, desc->Present_Value == &desc->Schedule_Default);
+
+    /* this date: 10:00-11:00 at 30 */
+    event = &desc->Exception_Schedule[0];
+    event->Calendar_Referenced = false;
+    event->Calendar_Entry.tag = CALENDAR_ENTRY_DATE;
+    datetime_set_date(&event->Calendar_Entry.type.Date, 2016, 6, 6);
+    testScheduleTimeValue(&event->Time_Values[0], 10, 0, 30.0);
+    testScheduleTimeValue(&event->Time_Values[1], 11, 0, -1);
+    event->TV_Count = 2;
+    event->Priority = 10;
+    /* the first Monday of June, with a higher priority: 10:30-10:45 at 40 */
+    event = &desc->Exception_Schedule[1];
+    event->Calendar_Referenced = false;
+    event->Calendar_Entry.tag = CALENDAR_ENTRY_WEEK_N_DAY;
+    event->Calendar_Entry.type.WeekNDay.month = 6;
+    event->Calendar_Entry.type.WeekNDay.week_of_month = 1;
+    event->Calendar_Entry.type.WeekNDay.day_of_week = 1;
+    testScheduleTimeValue(&event->Time_Values[0], 10, 30, 40.0);
+    testScheduleTimeValue(&event->Time_Values[1], 10, 45, -1);
+    event->TV_Count = 2;
+    event->Priority = 5;
+    desc->Exception_Count = 2;
+    Schedule_Compile(desc, &date);
+    ct_test(pTest, desc->Transition_Count == 9);
+    for (i = 0; i < desc->Transition_Count; i++) {
+        ct_test(pTest,
+            desc->Transitions[i].Time == (hours[i] * 60 + minutes[i]) * 6000);
+        ct_test(pTest, desc->Transitions[i].Value->type.Real == values[i]);
+    }
+    datetime_set_time(&time, 10, 40, 0, 0);
+    ct_test(pTest, Schedule_Next_Transition(desc, &time) == 645UL * 6000);
+    /* the next Monday neither matches */
+    datetime_set_date(&date, 2016, 6, 13);
+    ct_test(pTest, testScheduleValue(desc, &date, 10, 40) == 22.0);
+    ct_test(pTest, desc->Transition_Count == 5);
+    /* of the same priority, the first in the array */
+    desc->Exception_Schedule[1].Priority = 10;
+    desc->Exception_Schedule[1].Calendar_Entry.type.WeekNDay.week_of_month =
+        0xFF;
+    datetime_set_date(&date, 2016, 6, 6);
+    ct_test(pTest, testScheduleValue(desc, &date, 10, 40) == 30.0);
+    ct_test(pTest, testScheduleValue(desc, &date, 10, 50) == 30.0);
+    datetime_set_date(&date, 2016, 6, 13);
+    ct_test(pTest, testScheduleValue(desc, &date, 10, 40) == 40.0);
+    ct_test(pTest, testScheduleValue(desc, &date, 10, 50) == 22.0);
+    /* a range of dates, all day, on a Tuesday with no weekly schedule */
+    event = &desc->Exception_Schedule[2];
+    event->Calendar_Referenced = false;
+    event->Calendar_Entry.tag = CALENDAR_ENTRY_DATE_RANGE;
+    datetime_set_date(&event->Calendar_Entry.type.Date_Range.Start_Date,
+        2016, 6, 1);
+    datetime_set_date(&event->Calendar_Entry.type.Date_Range.End_Date,
+        2016, 6, 30);
+    testScheduleTimeValue(&event->Time_Values[0], 0, 0, 50.0);
+    event->TV_Count = 1;
+    event->Priority = 16;
+    desc->Exception_Count = 3;
+    datetime_set_date(&date, 2016, 6, 7);
+    ct_test(pTest, testScheduleValue(desc, &date, 0, 0) == 50.0);
+    ct_test(pTest, desc->Transition_Count == 1);
+    datetime_set_date(&date, 2016, 7, 5);
+    ct_test(pTest, testScheduleValue(desc, &date, 12, 0) == 16.0);
+    /* the last Monday of a month, and the last day */
+    desc->Exception_Schedule[1].Calendar_Entry.type.WeekNDay.week_of_month =
+        6;
+    desc->Exception_Schedule[1].Calendar_Entry.type.WeekNDay.month = 0xFF;
+    datetime_set_date(&date, 2016, 6, 27);
+    ct_test(pTest, Schedule_Special_Event_Match(&desc->Exception_Schedule[1],
+            &date));
+    datetime_set_date(&date, 2016, 6, 20);
+    ct_test(pTest, !Schedule_Special_Event_Match(&desc->Exception_Schedule[1],
+            &date));
+    event = &desc->Exception_Schedule[3];
+    event->Calendar_Referenced = false;
+    event->Calendar_Entry.tag = CALENDAR_ENTRY_DATE;
+    datetime_set_date(&event->Calendar_Entry.type.Date, 1900 + 0xFF, 2, 32);
+    event->Calendar_Entry.type.Date.wday = 0xFF;
+    datetime_set_date(&date, 2016, 2, 29);
+    ct_test(pTest, Schedule_Special_Event_Match(event, &date));
+    datetime_set_date(&date, 2015, 2, 28);
+    ct_test(pTest, Schedule_Special_Event_Match(event, &date));
+    datetime_set_date(&date, 2016, 2, 28);
+    ct_test(pTest, !Schedule_Special_Event_Match(event, &date));
+    /* there are no Calendar objects */
+    event->Calendar_Referenced = true;
+    datetime_set_date(&date, 2016, 2, 29);
+    ct_test(pTest, !Schedule_Special_Event_Match(event, &date));
+    /* outside of the Effective_Period, the Schedule_Default */
+    datetime_set_date(&desc->Start_Date, 2016, 7, 1);
+    datetime_set_date(&date, 2016, 6, 6);
+    ct_test(pTest, testScheduleValue(desc, &date, 10, 40) == 16.0);
+    ct_test(pTest, desc->Transition_Count == 1);
+}
+
+/* the second of a time of a day in June 2016, in local time */
+static time_t testScheduleTime(int day,
+    int hour,
+    int minute,
+    int second)
+{
+    struct tm tm = { 0 };
+
+    tm.tm_year = 2016 - 1900;
+    tm.tm_mon = 5;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1;
+
+    return mktime(&tm);
+}
+
+static void testScheduleReference(SCHEDULE_DESCR * desc,
+    uint32_t device_instance,
+    uint32_t object_instance)
+{
+    BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE *reference =
+        &desc->Object_Property_References[0];
+
+    reference->objectIdentifier.type = OBJECT_ANALOG_VALUE;
+    reference->objectIdentifier.instance = object_instance;
+    reference->propertyIdentifier = PROP_PRESENT_VALUE;
+    reference->arrayIndex = BACNET_ARRAY_ALL;
+    reference->deviceIndentifier.type = OBJECT_DEVICE;
+    reference->deviceIndentifier.instance = device_instance;
+    desc->obj_prop_ref_cnt = 1;
+}
+
+void testScheduleTimer(Test * pTest)
+{
+    SCHEDULE_DESCR *desc = &Schedule_Descr[0];
+    time_t t;
+
+    Schedule_Init();
+    memset(Test_Write_Count, 0, sizeof(Test_Write_Count));
+    testScheduleWeekly(desc);
+    desc->Priority_For_Writing = 9;
+    testScheduleReference(desc, 123, 0);
+    /* not of this device */
+    testScheduleWeekly(&Schedule_Descr[1]);
+    testScheduleReference(&Schedule_Descr[1], 124, 1);
+    /* written when first looked at, and then at each transition */
+    Schedule_Timer_Run(testScheduleTime(6, 7, 59, 50));
+    ct_test(pTest, Test_Write_Count[0] == 1);
+    ct_test(pTest, Test_Write_Value[0] == 16.0);
+    ct_test(pTest, Test_Write_Priority == 9);
+    ct_test(pTest, desc->Due == testScheduleTime(6, 8, 0, 0));
+    for (t = testScheduleTime(6, 7, 59, 51); t < testScheduleTime(6, 8, 0, 0);
+        t++) {
+        Schedule_Timer_Run(t);
+    }
+    ct_test(pTest, Test_Write_Count[0] == 1);
+    Schedule_Timer_Run(t);
+    ct_test(pTest, Test_Write_Count[0] == 2);
+    ct_test(pTest, Test_Write_Value[0] == 22.0);
+    ct_test(pTest, desc->Due == testScheduleTime(6, 12, 0, 0));
+    /* seconds missed */
+    Schedule_Timer_Run(testScheduleTime(6, 12, 0, 3));
+    ct_test(pTest, Test_Write_Count[0] == 3);
+    ct_test(pTest, Test_Write_Value[0] == 16.0);
+    /* the clock going back */
+    Schedule_Timer_Run(testScheduleTime(6, 9, 0, 0));
+    ct_test(pTest, Test_Write_Count[0] == 4);
+    ct_test(pTest, Test_Write_Value[0] == 22.0);
+    /* not written while out of service, and written again after */
+    Schedule_Out_Of_Service_Set(0, true);
+    Schedule_Timer_Run(testScheduleTime(6, 12, 0, 0));
+    ct_test(pTest, Test_Write_Count[0] == 4);
+    ct_test(pTest, desc->Present_Value->type.Real == 22.0);
+    Schedule_Out_Of_Service_Set(0, false);
+    Schedule_Timer_Run(testScheduleTime(6, 12, 0, 1));
+    ct_test(pTest, Test_Write_Count[0] == 5);
+    ct_test(pTest, Test_Write_Value[0] == 16.0);
+    /* written again when changed, even with the same value */
+    Schedule_Changed(0);
+    Schedule_Timer_Run(testScheduleTime(6, 12, 0, 2));
+    ct_test(pTest, Test_Write_Count[0] == 6);
+    /* midnight, to a day without transitions */
+    ct_test(pTest, desc->Due == testScheduleTime(6, 13, 0, 0));
+    for (t = testScheduleTime(6, 12, 0, 3); t <= testScheduleTime(7, 0, 0, 0);
+        t++) {
+        Schedule_Timer_Run(t);
+    }
+    ct_test(pTest, Test_Write_Count[0] == 8);
+    ct_test(pTest, desc->Due == testScheduleTime(8, 0, 0, 0));
+    ct_test(pTest, Test_Write_Count[1] == 0);
+}
+
+/* Schedules that change at many times, with exceptions */
+static void testScheduleSetup(unsigned count)
+{
+    SCHEDULE_DESCR *desc;
+    BACNET_SPECIAL_EVENT *event;
+    unsigned i, day, n;
+
+    Schedule_Init();
+    memset(Test_Write_Count, 0, sizeof(Test_Write_Count));
+    for (i = 0; i < count; i++) {
+        desc = &Schedule_Descr[i];
+        desc->Schedule_Default.type.Real = 16.0;
+        for (day = 0; day < 5; day++) {
+            n = (i * 7 + day * 13) % 480;
+            testScheduleTimeValue(&desc->Weekly_Schedule[day].Time_Values[0],
+                6 + (n / 60), n % 60, 21.0);
+            testScheduleTimeValue(&desc->Weekly_Schedule[day].Time_Values[1],
+                12 + (n / 60), (n + 17) % 60, -1);
+            desc->Weekly_Schedule[day].TV_Count = 2;
+        }
+        if ((i % 4) == 0) {
+            event = &desc->Exception_Schedule[0];
+            event->Calendar_Referenced = false;
+            event->Calendar_Entry.tag = CALENDAR_ENTRY_WEEK_N_DAY;
+            event->Calendar_Entry.type.WeekNDay.month = 0xFF;
+            event->Calendar_Entry.type.WeekNDay.week_of_month = 0xFF;
+            event->Calendar_Entry.type.WeekNDay.day_of_week = 1 + (i % 7);
+            testScheduleTimeValue(&event->Time_Values[0], 9, i % 60, 25.0);
+            testScheduleTimeValue(&event->Time_Values[1], 10, i % 60, -1);
+            event->TV_Count = 2;
+            event->Priority = 8;
+            desc->Exception_Count = 1;
+        }
+        testScheduleReference(desc, 123, i);
+    }
+}
+
+/* with the wheel, the same values are written as when every schedule
+   is looked at every second */
+void testScheduleWheel(Test * pTest)
+{
+    static unsigned long sweep_count[64];
+    static float sweep_value[64];
+    BACNET_DATE date;
+    BACNET_TIME time;
+    struct tm *tm;
+    time_t start = testScheduleTime(5, 23, 0, 0);
+    time_t t;
+    unsigned i;
+    bool same = true;
+
+    testScheduleSetup(64);
+    for (t = start; t < start + 3 * 86400L; t++) {
+        tm = localtime(&t);
+        datetime_set_date(&date, (uint16_t) (tm->tm_year + 1900),
+            (uint8_t) (tm->tm_mon + 1), (uint8_t) tm->tm_mday);
+        datetime_set_time(&time, (uint8_t) tm->tm_hour, (uint8_t) tm->tm_min,
+            (uint8_t) tm->tm_sec, 0);
+        for (i = 0; i < 64; i++) {
+            if (Schedule_Recalculate(&Schedule_Descr[i], &date, &time) ||
+                (t == start)) {
+                sweep_count[i]++;
+                sweep_value[i] = Schedule_Descr[i].Present_Value->type.Real;
+            }
+        }
+    }
+    testScheduleSetup(64);
+    for (t = start; t < start + 3 * 86400L; t++) {
+        Schedule_Timer_Run(t);
+    }
+    for (i = 0; i < 64; i++) {
+        if ((sweep_count[i] != Test_Write_Count[i]) ||
+            (sweep_value[i] != Test_Write_Value[i]))
+            same = false;
+    }
+    ct_test(pTest, same);
+    ct_test(pTest, sweep_count[0] > 4);
+}
+
+/* time the schedules looked at every second, against the wheel */
+static void testScheduleBenchmark(unsigned count,
+    unsigned seconds)
+{
+    BACNET_TIME time;
+    time_t start = testScheduleTime(6, 0, 0, 0);
+    clock_t begin;
+    unsigned long writes = 0;
+    unsigned i, s;
+
+    if (count > MAX_SCHEDULES)
+        count = MAX_SCHEDULES;
+    testScheduleSetup(count);
+    begin = clock();
+    for (s = 0; s < seconds; s++) {
+        datetime_set_time(&time, (uint8_t) (s / 3600),
+            (uint8_t) ((s / 60) % 60), (uint8_t) (s % 60), 0);
+        for (i = 0; i < count; i++) {
+            Schedule_Recalculate_PV(&Schedule_Descr[i], BACNET_WEEKDAY_MONDAY,
+                &time);
+        }
+    }
+    printf("%u schedules: every schedule %.2f us/second\n", count,
+        ((double) (clock() - begin) * 1000000.0 / CLOCKS_PER_SEC) / seconds);
+    begin = clock();
+    for (s = 0; s < seconds; s++) {
+        Schedule_Timer_Run(start + s);
+    }
+    for (i = 0; i < count; i++) {
+        writes += Test_Write_Count[i];
+    }
+    printf("%u schedules: timer wheel %.2f us/second, %lu writes\n", count,
+        ((double) (clock() - begin) * 1000000.0 / CLOCKS_PER_SEC) / seconds,
+        writes);
+}
 
 void testSchedule(Test * pTest)
 {
@@ -463,6 +1453,18 @@ void testSchedule(Test * pTest)
     len = decode_object_id(&apdu[len], &decoded_type, &decoded_instance);
     ct_test(pTest, decoded_type == rpdata.object_type);
     ct_test(pTest, decoded_instance == rpdata.object_instance);
+    /* an empty array of special events */
+    rpdata.object_property = PROP_EXCEPTION_SCHEDULE;
+    rpdata.array_index = 0;
+    len = Schedule_Read_Property(&rpdata);
+    ct_test(pTest, len > 0);
+    len = decode_tag_number_and_value(&apdu[0], &tag_number, &len_value);
+    ct_test(pTest, tag_number == BACNET_APPLICATION_TAG_UNSIGNED_INT);
+    ct_test(pTest, len_value == 1);
+    ct_test(pTest, apdu[len] == 0);
+    rpdata.array_index = 1;
+    ct_test(pTest, Schedule_Read_Property(&rpdata) == BACNET_STATUS_ERROR);
+    ct_test(pTest, rpdata.error_code == ERROR_CODE_INVALID_ARRAY_INDEX);
 
     return;
 }
@@ -470,21 +1472,36 @@ void testSchedule(Test * pTest)
 
 #ifdef TEST_SCHEDULE
 
-int main(void)
+int main(int argc,
+    char *argv[])
 {
     Test *pTest;
     bool rc;
+    unsigned count = MAX_SCHEDULES;
+    unsigned seconds = 86400;
 
     pTest = ct_create("BACnet Schedule", NULL);
     /* individual tests */
     rc = ct_addTestFunction(pTest, testSchedule);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testScheduleEvaluation);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testScheduleTimer);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testScheduleWheel);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
     (void) ct_report(pTest);
     ct_destroy(pTest);
 
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 0);
+    if (argc > 2)
+        seconds = strtoul(argv[2], NULL, 0);
+    testScheduleBenchmark(count, seconds);
+
     return 0;
 }
 
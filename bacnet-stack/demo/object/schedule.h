@@ -28,6 +28,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 #include "bacdef.h"
 #include "bacapp.h"
 #include "datetime.h"
@@ -41,6 +42,15 @@
 #define BACNET_WEEKLY_SCHEDULE_SIZE 8   /* maximum number of data points for each day */
 #endif
 
+#ifndef BACNET_EXCEPTION_SCHEDULE_SIZE
+#define BACNET_EXCEPTION_SCHEDULE_SIZE 4        /* maximum number of special events */
+#endif
+
+/* the most transitions in a day: one at midnight, and one for each
+   time value of the weekly schedule and of the special events */
+#define BACNET_SCHEDULE_TRANSITIONS_SIZE \
+    (1 + (BACNET_WEEKLY_SCHEDULE_SIZE * (1 + BACNET_EXCEPTION_SCHEDULE_SIZE)))
+
 #ifndef BACNET_SCHEDULE_OBJ_PROP_REF_SIZE
 #define BACNET_SCHEDULE_OBJ_PROP_REF_SIZE 4     /* maximum number of obj prop references */
 #endif
@@ -55,12 +65,58 @@ extern "C" {
         uint16_t TV_Count;      /* the number of time values actually used */
     } BACNET_DAILY_SCHEDULE;
 
+    /* BACnetWeekNDay - 0xFF in any field matches any day */
+    typedef struct bacnet_weeknday {
+        uint8_t month;  /* 1..12, 13 odd months, 14 even months */
+        uint8_t week_of_month;  /* 1 is days 1-7 .. 5 is days 29-31,
+                                 * 6 is the last 7 days of the month */
+        uint8_t day_of_week;    /* 1=Monday-7=Sunday */
+    } BACNET_WEEKNDAY;
+
+    typedef enum {
+        CALENDAR_ENTRY_DATE = 0,
+        CALENDAR_ENTRY_DATE_RANGE = 1,
+        CALENDAR_ENTRY_WEEK_N_DAY = 2
+    } BACNET_CALENDAR_ENTRY_CHOICE;
+
+    typedef struct bacnet_calendar_entry {
+        uint8_t tag;    /* BACNET_CALENDAR_ENTRY_CHOICE */
+        union {
+            BACNET_DATE Date;   /* may have wildcards and special days */
+            struct {
+                BACNET_DATE Start_Date;
+                BACNET_DATE End_Date;
+            } Date_Range;
+            BACNET_WEEKNDAY WeekNDay;
+        } type;
+    } BACNET_CALENDAR_ENTRY;
+
+    typedef struct bacnet_special_event {
+        /* the period is a calendar entry, or a Calendar object; there
+         * are no Calendar objects here, so an event that refers to one
+         * is never in effect */
+        bool Calendar_Referenced;
+        BACNET_CALENDAR_ENTRY Calendar_Entry;
+        uint32_t Calendar_Instance;
+        BACNET_TIME_VALUE Time_Values[BACNET_WEEKLY_SCHEDULE_SIZE];
+        uint16_t TV_Count;      /* the number of time values actually used */
+        uint8_t Priority;       /* (1..16), 1 is the highest */
+    } BACNET_SPECIAL_EVENT;
+
+    /* from Time until the next transition, Value is in effect */
+    typedef struct schedule_transition {
+        uint32_t Time;  /* hundredths of a second since midnight */
+        BACNET_APPLICATION_DATA_VALUE *Value;
+    } SCHEDULE_TRANSITION;
+
     typedef struct schedule {
         /* Effective Period: Start and End Date */
         BACNET_DATE Start_Date;
         BACNET_DATE End_Date;
         /* Properties concerning Present Value */
         BACNET_DAILY_SCHEDULE Weekly_Schedule[7];
+        BACNET_SPECIAL_EVENT Exception_Schedule[BACNET_EXCEPTION_SCHEDULE_SIZE];
+        uint8_t Exception_Count;        /* actual number of special events */
         BACNET_APPLICATION_DATA_VALUE Schedule_Default;
         BACNET_APPLICATION_DATA_VALUE *Present_Value;   /* must be set to a valid value
                                                          * default is Schedule_Default */
@@ -69,6 +125,17 @@ extern "C" {
         uint8_t obj_prop_ref_cnt;       /* actual number of obj_prop references */
         uint8_t Priority_For_Writing;   /* (1..16) */
         bool Out_Of_Service;
+        /* the day the schedules were compiled for, and its transitions
+         * in order of time; none until the first time it is compiled,
+         * or after the schedules were changed */
+        BACNET_DATE Transition_Date;
+        SCHEDULE_TRANSITION Transitions[BACNET_SCHEDULE_TRANSITIONS_SIZE];
+        uint8_t Transition_Count;
+        /* the second of the next transition, in the timer wheel */
+        time_t Due;
+        int Due_Slot;
+        int Due_Next;
+        int Due_Prev;
     } SCHEDULE_DESCR;
 
     void Schedule_Property_Lists(const int **pRequired,
@@ -87,13 +154,30 @@ extern "C" {
     int Schedule_Read_Property(BACNET_READ_PROPERTY_DATA * rpdata);
     bool Schedule_Write_Property(BACNET_WRITE_PROPERTY_DATA * wp_data);
 
-    /* utility functions for calculating current Present Value
-     * if Exception Schedule is to be added, these functions must take that into account */
+    void Schedule_Out_Of_Service_Set(uint32_t object_instance,
+        bool value);
+    /* to be called after the schedules of an object were changed */
+    void Schedule_Changed(uint32_t object_instance);
+
+    /* utility functions for calculating current Present Value */
     bool Schedule_In_Effective_Period(SCHEDULE_DESCR * desc,
         BACNET_DATE * date);
+    /* from the weekly schedule alone */
     void Schedule_Recalculate_PV(SCHEDULE_DESCR * desc,
         BACNET_WEEKDAY wday,
         BACNET_TIME * time);
+    /* from the weekly and exception schedules */
+    bool Schedule_Special_Event_Match(BACNET_SPECIAL_EVENT * event,
+        BACNET_DATE * date);
+    void Schedule_Compile(SCHEDULE_DESCR * desc,
+        BACNET_DATE * date);
+    bool Schedule_Recalculate(SCHEDULE_DESCR * desc,
+        BACNET_DATE * date,
+        BACNET_TIME * time);
+    uint32_t Schedule_Next_Transition(SCHEDULE_DESCR * desc,
+        BACNET_TIME * time);
+
+    void schedule_timer(uint16_t uSeconds);
 
 #ifdef __cplusplus
 }
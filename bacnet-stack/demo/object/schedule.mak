@@ -3,7 +3,7 @@ CC      = gcc
 SRC_DIR = ../../src
 TEST_DIR = ../../test
 INCLUDES = -I../../include -I$(TEST_DIR) -I.
-DEFINES = -DBIG_ENDIAN=0 -DTEST -DBACAPP_ALL -DTEST_SCHEDULE
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DBACAPP_ALL -DTEST_SCHEDULE -DMAX_SCHEDULES=1000
 
 CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
 
@@ -0,0 +1,1000 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trendlog.h"
+#include "tlpack.h"
+
+/** @file tlpack.c  Trend Log storage of packed records in RAM */
+
+/* The records of a log are kept in blocks of TLPACK_BLOCK_RECORDS, in
+   a ring of as many blocks as it takes for depth records and the block
+   being filled.  A block is a string of bits, most significant first,
+   each record packed against the one before it, and the first one
+   against the time stamp of the block, an interval of 0, a datum of 0
+   and no type:
+
+   time stamp, as the change of the interval from the record before:
+      '0'                      no change
+      '10'   + 7 bits          -63..64
+      '110'  + 9 bits          -255..256
+      '1110' + 12 bits         -2047..2048
+      '1111' + 32 bits         the time stamp itself
+   record type and status:
+      '0'                      as the record before
+      '1'    + 8 bits type + 8 bits status
+   length octet of a bit string, 8 bits, for TL_TYPE_BITS only
+   datum, 32 bits XORed with the datum before, for all but TL_TYPE_NULL:
+      '0'                      no change
+      '10'   + bits            the bits that changed fit between the
+                               leading and trailing zeros of the XOR of
+                               the last datum sent with '11'
+      '11'   + 5 bits leading zeros + 5 bits length - 1 + the bits */
+#define TLPACK_RECORD_OCTETS 14 /* the most a record takes */
+#define TLPACK_NO_BLOCK UINT32_MAX
+
+struct tl_pack_block {
+    uint8_t *pBits;
+    time_t tFirst;      /* time stamp of the first record */
+    uint16_t usBits;    /* bits in use */
+    uint16_t usSize;    /* octets allocated */
+};
+
+/* what the next record of a block is packed against */
+struct tl_pack_state {
+    time_t tTime;
+    time_t tDelta;
+    uint32_t ulDatum;
+    uint16_t usBit;     /* where the next record starts */
+    uint8_t ucLead;     /* leading zeros of the last XOR sent whole */
+    uint8_t ucLength;   /* its meaningful bits, 0 if none yet */
+    uint8_t ucType;
+    uint8_t ucStatus;
+    uint8_t ucBitsLen;  /* of the last bit string */
+};
+
+struct tl_pack_log {
+    struct tl_pack_state Packer;        /* of the block being filled */
+    uint32_t ulBase;    /* total record count at the last purge */
+    uint32_t ulRecordCount;
+    uint32_t ulTotalRecordCount;
+};
+
+static struct tl_pack_block *Pack_Blocks;
+static struct tl_pack_log *Pack_Logs;
+static unsigned Pack_Log_Count;
+static uint32_t Pack_Depth;
+static uint32_t Pack_Block_Count;       /* blocks in the ring of a log */
+/* the records of a block unpacked so far, by the fetches before, so
+   that fetches in order, either way, cost no more than one each */
+static struct tl_pack_cache {
+    unsigned iLog;
+    uint32_t ulBlock;   /* counting from the purge, or TLPACK_NO_BLOCK */
+    uint32_t ulCount;
+    struct tl_pack_state State; /* after the last one */
+    TL_DATA_REC Records[TLPACK_BLOCK_RECORDS];
+} Pack_Cache;
+
+static void tl_pack_put(
+    uint8_t * pBits,
+    uint16_t * pusBit,
+    uint32_t ulValue,
+    unsigned bits)
+{
+    unsigned pos = *pusBit;
+    unsigned room;
+    unsigned n;
+
+    while (bits > 0) {
+        room = 8 - (pos & 7);
+        n = (bits < room) ? bits : room;
+        if (room == 8) {
+            pBits[pos >> 3] = 0;
+        }
+        pBits[pos >> 3] |= (uint8_t)
+            (((ulValue >> (bits - n)) & ((1U << n) - 1)) << (room - n));
+        pos += n;
+        bits -= n;
+    }
+    *pusBit = (uint16_t) pos;
+}
+
+static uint32_t tl_pack_get(
+    const uint8_t * pBits,
+    uint16_t * pusBit,
+    unsigned bits)
+{
+    unsigned pos = *pusBit;
+    unsigned room;
+    unsigned n;
+    uint32_t ulValue = 0;
+
+    while (bits > 0) {
+        room = 8 - (pos & 7);
+        n = (bits < room) ? bits : room;
+        ulValue = (ulValue << n) |
+            ((pBits[pos >> 3] >> (room - n)) & ((1U << n) - 1));
+        pos += n;
+        bits -= n;
+    }
+    *pusBit = (uint16_t) pos;
+
+    return ulValue;
+}
+
+/* leading and trailing zeros of a value that is not 0 */
+static unsigned tl_pack_leading(
+    uint32_t ulValue)
+{
+    unsigned n = 0;
+
+    if ((ulValue & 0xFFFF0000UL) == 0) {
+        n += 16;
+        ulValue <<= 16;
+    }
+    if ((ulValue & 0xFF000000UL) == 0) {
+        n += 8;
+        ulValue <<= 8;
+    }
+    if ((ulValue & 0xF0000000UL) == 0) {
+        n += 4;
+        ulValue <<= 4;
+    }
+    if ((ulValue & 0xC0000000UL) == 0) {
+        n += 2;
+        ulValue <<= 2;
+    }
+    if ((ulValue & 0x80000000UL) == 0) {
+        n += 1;
+    }
+
+    return n;
+}
+
+static unsigned tl_pack_trailing(
+    uint32_t ulValue)
+{
+    unsigned n = 0;
+
+    if ((ulValue & 0x0000FFFFUL) == 0) {
+        n += 16;
+        ulValue >>= 16;
+    }
+    if ((ulValue & 0x000000FFUL) == 0) {
+        n += 8;
+        ulValue >>= 8;
+    }
+    if ((ulValue & 0x0000000FUL) == 0) {
+        n += 4;
+        ulValue >>= 4;
+    }
+    if ((ulValue & 0x00000003UL) == 0) {
+        n += 2;
+        ulValue >>= 2;
+    }
+    if ((ulValue & 0x00000001UL) == 0) {
+        n += 1;
+    }
+
+    return n;
+}
+
+/* true if records of a type have a datum */
+static bool tl_pack_has_datum(
+    uint8_t ucType)
+{
+    return (ucType <= TL_TYPE_DELTA) && (ucType != TL_TYPE_NULL);
+}
+
+/* the datum of a record as 32 bits */
+static uint32_t tl_pack_datum(
+    const TL_DATA_REC * record)
+{
+    uint32_t ulDatum = 0;
+
+    switch (record->ucRecType) {
+        case TL_TYPE_STATUS:
+            ulDatum = record->Datum.ucLogStatus;
+            break;
+        case TL_TYPE_BOOL:
+            ulDatum = record->Datum.ucBoolean;
+            break;
+        case TL_TYPE_REAL:
+            memcpy(&ulDatum, &record->Datum.fReal, 4);
+            break;
+        case TL_TYPE_DELTA:
+            memcpy(&ulDatum, &record->Datum.fTime, 4);
+            break;
+        case TL_TYPE_ENUM:
+            ulDatum = record->Datum.ulEnum;
+            break;
+        case TL_TYPE_UNSIGN:
+            ulDatum = record->Datum.ulUValue;
+            break;
+        case TL_TYPE_SIGN:
+            ulDatum = (uint32_t) record->Datum.lSValue;
+            break;
+        case TL_TYPE_BITS:
+            ulDatum = ((uint32_t) record->Datum.Bits.ucStore[0] << 24) |
+                ((uint32_t) record->Datum.Bits.ucStore[1] << 16) |
+                ((uint32_t) record->Datum.Bits.ucStore[2] << 8) |
+                record->Datum.Bits.ucStore[3];
+            break;
+        case TL_TYPE_ERROR:
+            ulDatum = ((uint32_t) record->Datum.Error.usClass << 16) |
+                record->Datum.Error.usCode;
+            break;
+        default:
+            break;
+    }
+
+    return ulDatum;
+}
+
+static void tl_pack_datum_set(
+    TL_DATA_REC * record,
+    uint32_t ulDatum)
+{
+    switch (record->ucRecType) {
+        case TL_TYPE_STATUS:
+            record->Datum.ucLogStatus = (uint8_t) ulDatum;
+            break;
+        case TL_TYPE_BOOL:
+            record->Datum.ucBoolean = (uint8_t) ulDatum;
+            break;
+        case TL_TYPE_REAL:
+            memcpy(&record->Datum.fReal, &ulDatum, 4);
+            break;
+        case TL_TYPE_DELTA:
+            memcpy(&record->Datum.fTime, &ulDatum, 4);
+            break;
+        case TL_TYPE_ENUM:
+            record->Datum.ulEnum = ulDatum;
+            break;
+        case TL_TYPE_UNSIGN:
+            record->Datum.ulUValue = ulDatum;
+            break;
+        case TL_TYPE_SIGN:
+            record->Datum.lSValue = (int32_t) ulDatum;
+            break;
+        case TL_TYPE_BITS:
+            record->Datum.Bits.ucStore[0] = (uint8_t) (ulDatum >> 24);
+            record->Datum.Bits.ucStore[1] = (uint8_t) (ulDatum >> 16);
+            record->Datum.Bits.ucStore[2] = (uint8_t) (ulDatum >> 8);
+            record->Datum.Bits.ucStore[3] = (uint8_t) ulDatum;
+            break;
+        case TL_TYPE_ERROR:
+            record->Datum.Error.usClass = (uint16_t) (ulDatum >> 16);
+            record->Datum.Error.usCode = (uint16_t) ulDatum;
+            break;
+        default:
+            break;
+    }
+}
+
+static void tl_pack_start(
+    struct tl_pack_state *State,
+    time_t tFirst)
+{
+    memset(State, 0, sizeof(struct tl_pack_state));
+    State->tTime = tFirst;
+    State->ucType = 0xFF;
+}
+
+static void tl_pack_record(
+    uint8_t * pBits,
+    struct tl_pack_state *State,
+    const TL_DATA_REC * record)
+{
+    time_t tDelta = record->tTimeStamp - State->tTime;
+    time_t tChange = tDelta - State->tDelta;
+    uint32_t ulDatum;
+    uint32_t ulXor;
+    unsigned lead;
+    unsigned trail;
+
+    if (tChange == 0) {
+        tl_pack_put(pBits, &State->usBit, 0, 1);
+    } else if ((tChange >= -63) && (tChange <= 64)) {
+        tl_pack_put(pBits, &State->usBit, 0x2, 2);
+        tl_pack_put(pBits, &State->usBit, (uint32_t) (tChange + 63), 7);
+    } else if ((tChange >= -255) && (tChange <= 256)) {
+        tl_pack_put(pBits, &State->usBit, 0x6, 3);
+        tl_pack_put(pBits, &State->usBit, (uint32_t) (tChange + 255), 9);
+    } else if ((tChange >= -2047) && (tChange <= 2048)) {
+        tl_pack_put(pBits, &State->usBit, 0xE, 4);
+        tl_pack_put(pBits, &State->usBit, (uint32_t) (tChange + 2047), 12);
+    } else {
+        tl_pack_put(pBits, &State->usBit, 0xF, 4);
+        tl_pack_put(pBits, &State->usBit, (uint32_t) record->tTimeStamp, 32);
+        /* as it is unpacked */
+        tDelta = (time_t) (uint32_t) record->tTimeStamp - State->tTime;
+    }
+    State->tTime += tDelta;
+    State->tDelta = tDelta;
+    if ((record->ucRecType == State->ucType) &&
+        (record->ucStatus == State->ucStatus)) {
+        tl_pack_put(pBits, &State->usBit, 0, 1);
+    } else {
+        tl_pack_put(pBits, &State->usBit, 1, 1);
+        tl_pack_put(pBits, &State->usBit, record->ucRecType, 8);
+        tl_pack_put(pBits, &State->usBit, record->ucStatus, 8);
+        State->ucType = record->ucRecType;
+        State->ucStatus = record->ucStatus;
+    }
+    if (record->ucRecType == TL_TYPE_BITS) {
+        tl_pack_put(pBits, &State->usBit, record->Datum.Bits.ucLen, 8);
+        State->ucBitsLen = record->Datum.Bits.ucLen;
+    }
+    if (!tl_pack_has_datum(record->ucRecType)) {
+        return;
+    }
+    ulDatum = tl_pack_datum(record);
+    ulXor = ulDatum ^ State->ulDatum;
+    State->ulDatum = ulDatum;
+    if (ulXor == 0) {
+        tl_pack_put(pBits, &State->usBit, 0, 1);
+        return;
+    }
+    lead = tl_pack_leading(ulXor);
+    trail = tl_pack_trailing(ulXor);
+    if ((State->ucLength > 0) && (lead >= State->ucLead) &&
+        (trail >= (32U - State->ucLead - State->ucLength))) {
+        tl_pack_put(pBits, &State->usBit, 0x2, 2);
+        tl_pack_put(pBits, &State->usBit,
+            ulXor >> (32U - State->ucLead - State->ucLength),
+            State->ucLength);
+    } else {
+        State->ucLead = (uint8_t) lead;
+        State->ucLength = (uint8_t) (32U - lead - trail);
+        tl_pack_put(pBits, &State->usBit, 0x3, 2);
+        tl_pack_put(pBits, &State->usBit, lead, 5);
+        tl_pack_put(pBits, &State->usBit, State->ucLength - 1U, 5);
+        tl_pack_put(pBits, &State->usBit, ulXor >> trail, State->ucLength);
+    }
+}
+
+static void tl_pack_unpack(
+    const uint8_t * pBits,
+    struct tl_pack_state *State,
+    TL_DATA_REC * record)
+{
+    unsigned bits = 0;
+    uint32_t ulXor;
+
+    memset(record, 0, sizeof(TL_DATA_REC));
+    /* the prefix of the time stamp: up to four 1s */
+    while ((bits < 4) && tl_pack_get(pBits, &State->usBit, 1)) {
+        bits++;
+    }
+    switch (bits) {
+        case 0:
+            break;
+        case 1:
+            State->tDelta +=
+                (time_t) tl_pack_get(pBits, &State->usBit, 7) - 63;
+            break;
+        case 2:
+            State->tDelta +=
+                (time_t) tl_pack_get(pBits, &State->usBit, 9) - 255;
+            break;
+        case 3:
+            State->tDelta +=
+                (time_t) tl_pack_get(pBits, &State->usBit, 12) - 2047;
+            break;
+        default:
+            State->tDelta =
+                (time_t) tl_pack_get(pBits, &State->usBit, 32) -
+                State->tTime;
+            break;
+    }
+    State->tTime += State->tDelta;
+    record->tTimeStamp = State->tTime;
+    if (tl_pack_get(pBits, &State->usBit, 1)) {
+        State->ucType = (uint8_t) tl_pack_get(pBits, &State->usBit, 8);
+        State->ucStatus = (uint8_t) tl_pack_get(pBits, &State->usBit, 8);
+    }
+    record->ucRecType = State->ucType;
+    record->ucStatus = State->ucStatus;
+    if (record->ucRecType == TL_TYPE_BITS) {
+        State->ucBitsLen = (uint8_t) tl_pack_get(pBits, &State->usBit, 8);
+        record->Datum.Bits.ucLen = State->ucBitsLen;
+    }
+    if (!tl_pack_has_datum(record->ucRecType)) {
+        return;
+    }
+    if (tl_pack_get(pBits, &State->usBit, 1)) {
+        if (tl_pack_get(pBits, &State->usBit, 1)) {
+            State->ucLead = (uint8_t) tl_pack_get(pBits, &State->usBit, 5);
+            State->ucLength =
+                (uint8_t) (tl_pack_get(pBits, &State->usBit, 5) + 1);
+        }
+        ulXor = tl_pack_get(pBits, &State->usBit, State->ucLength);
+        State->ulDatum ^=
+            ulXor << (32U - State->ucLead - State->ucLength);
+    }
+    tl_pack_datum_set(record, State->ulDatum);
+}
+
+/* a block of a log, counting the blocks from the last purge */
+static struct tl_pack_block *tl_pack_block(
+    unsigned iLog,
+    uint32_t ulBlock)
+{
+    return &Pack_Blocks[((size_t) iLog * Pack_Block_Count) +
+        (ulBlock % Pack_Block_Count)];
+}
+
+static void tl_pack_close(
+    void)
+{
+    size_t i;
+
+    if (Pack_Blocks) {
+        for (i = 0; i < ((size_t) Pack_Log_Count * Pack_Block_Count); i++) {
+            free(Pack_Blocks[i].pBits);
+        }
+        free(Pack_Blocks);
+        Pack_Blocks = NULL;
+    }
+    free(Pack_Logs);
+    Pack_Logs = NULL;
+    Pack_Log_Count = 0;
+}
+
+static bool tl_pack_open(
+    unsigned logs,
+    uint32_t depth)
+{
+    if (logs == 0) {
+        return false;
+    }
+    Pack_Block_Count =
+        ((depth + (TLPACK_BLOCK_RECORDS - 1)) / TLPACK_BLOCK_RECORDS) + 1;
+    if (Pack_Block_Count >
+        (SIZE_MAX / sizeof(struct tl_pack_block) / logs)) {
+        return false;
+    }
+    Pack_Blocks =
+        calloc((size_t) logs * Pack_Block_Count,
+        sizeof(struct tl_pack_block));
+    Pack_Logs = calloc(logs, sizeof(struct tl_pack_log));
+    Pack_Log_Count = logs;
+    if ((Pack_Blocks == NULL) || (Pack_Logs == NULL)) {
+        tl_pack_close();
+        return false;
+    }
+    Pack_Cache.ulBlock = TLPACK_NO_BLOCK;
+    Pack_Depth = depth;
+
+    return true;
+}
+
+/* A record that finds no room, when the block cannot grow, is not kept */
+static void tl_pack_append(
+    unsigned iLog,
+    const TL_DATA_REC * record)
+{
+    struct tl_pack_log *Log = &Pack_Logs[iLog];
+    struct tl_pack_block *Block;
+    uint32_t ulIndex;
+    unsigned used;
+    unsigned size;
+    uint8_t *pBits;
+
+    ulIndex = Log->ulTotalRecordCount - Log->ulBase;
+    Block = tl_pack_block(iLog, ulIndex / TLPACK_BLOCK_RECORDS);
+    ulIndex %= TLPACK_BLOCK_RECORDS;
+    /* the first record of a block takes the place of the block that
+       went out of the log */
+    used = (ulIndex == 0) ? 0 : ((Block->usBits + 7U) / 8U);
+    if ((Block->usSize - used) < TLPACK_RECORD_OCTETS) {
+        size = (Block->usSize > 0) ? (Block->usSize * 2U) : 32U;
+        if (size < (used + TLPACK_RECORD_OCTETS)) {
+            size = used + TLPACK_RECORD_OCTETS;
+        }
+        if (size > (TLPACK_BLOCK_RECORDS * TLPACK_RECORD_OCTETS)) {
+            size = TLPACK_BLOCK_RECORDS * TLPACK_RECORD_OCTETS;
+        }
+        pBits = realloc(Block->pBits, size);
+        if (pBits == NULL) {
+            return;
+        }
+        Block->pBits = pBits;
+        Block->usSize = (uint16_t) size;
+    }
+    if (ulIndex == 0) {
+        Block->tFirst = record->tTimeStamp;
+        tl_pack_start(&Log->Packer, record->tTimeStamp);
+    }
+    tl_pack_record(Block->pBits, &Log->Packer, record);
+    Block->usBits = Log->Packer.usBit;
+    Log->ulTotalRecordCount++;
+    if (Log->ulRecordCount < Pack_Depth) {
+        Log->ulRecordCount++;
+    }
+    if (ulIndex == (TLPACK_BLOCK_RECORDS - 1)) {
+        /* the block is full: give back what it did not use */
+        size = (Block->usBits + 7U) / 8U;
+        pBits = realloc(Block->pBits, size);
+        if (pBits != NULL) {
+            Block->pBits = pBits;
+            Block->usSize = (uint16_t) size;
+        }
+    }
+}
+
+static bool tl_pack_fetch(
+    unsigned iLog,
+    uint32_t ulSequence,
+    TL_DATA_REC * record)
+{
+    struct tl_pack_log *Log = &Pack_Logs[iLog];
+    struct tl_pack_block *Block;
+    uint32_t ulBack;    /* how far back from the newest record */
+    uint32_t ulBlock;
+    uint32_t ulIndex;
+
+    ulBack = Log->ulTotalRecordCount - ulSequence;
+    if (ulBack >= Log->ulRecordCount) {
+        return false;
+    }
+    if (ulBack == 0) {
+        /* the newest record, as it was packed */
+        memset(record, 0, sizeof(TL_DATA_REC));
+        record->tTimeStamp = Log->Packer.tTime;
+        record->ucRecType = Log->Packer.ucType;
+        record->ucStatus = Log->Packer.ucStatus;
+        if (record->ucRecType == TL_TYPE_BITS) {
+            record->Datum.Bits.ucLen = Log->Packer.ucBitsLen;
+        }
+        if (tl_pack_has_datum(record->ucRecType)) {
+            tl_pack_datum_set(record, Log->Packer.ulDatum);
+        }
+        return true;
+    }
+    ulIndex = ulSequence - Log->ulBase - 1;
+    ulBlock = ulIndex / TLPACK_BLOCK_RECORDS;
+    ulIndex %= TLPACK_BLOCK_RECORDS;
+    Block = tl_pack_block(iLog, ulBlock);
+    if ((Pack_Cache.iLog != iLog) || (Pack_Cache.ulBlock != ulBlock)) {
+        tl_pack_start(&Pack_Cache.State, Block->tFirst);
+        Pack_Cache.iLog = iLog;
+        Pack_Cache.ulBlock = ulBlock;
+        Pack_Cache.ulCount = 0;
+    }
+    while (Pack_Cache.ulCount <= ulIndex) {
+        tl_pack_unpack(Block->pBits, &Pack_Cache.State,
+            &Pack_Cache.Records[Pack_Cache.ulCount]);
+        Pack_Cache.ulCount++;
+    }
+    *record = Pack_Cache.Records[ulIndex];
+
+    return true;
+}
+
+static void tl_pack_counts(
+    unsigned iLog,
+    uint32_t * pulRecordCount,
+    uint32_t * pulTotalRecordCount)
+{
+    *pulRecordCount = Pack_Logs[iLog].ulRecordCount;
+    *pulTotalRecordCount = Pack_Logs[iLog].ulTotalRecordCount;
+}
+
+static void tl_pack_purge(
+    unsigned iLog,
+    uint32_t ulTotalRecordCount)
+{
+    struct tl_pack_log *Log = &Pack_Logs[iLog];
+
+    Log->ulBase = ulTotalRecordCount;
+    Log->ulRecordCount = 0;
+    Log->ulTotalRecordCount = ulTotalRecordCount;
+    if (Pack_Cache.iLog == iLog) {
+        Pack_Cache.ulBlock = TLPACK_NO_BLOCK;
+    }
+}
+
+static const TL_STORAGE TL_Pack_Storage = {
+    tl_pack_open,
+    tl_pack_close,
+    tl_pack_append,
+    tl_pack_fetch,
+    tl_pack_counts,
+    tl_pack_purge
+};
+
+/** Storage for Trend_Log_Storage_Set() that keeps the records of the
+ * Trend Logs packed in RAM.
+ *
+ * @return the storage
+ */
+const TL_STORAGE *tl_pack_storage(
+    void)
+{
+    return &TL_Pack_Storage;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+/* a record of each type in turn, sixteen at a time, mostly a minute
+   apart, with some jitter, late every 41 and 43, a jump forward every
+   50 and the clock set back every 97 */
+static void testTrendLogPackRecord(
+    TL_DATA_REC * record,
+    uint32_t ulValue)
+{
+    memset(record, 0, sizeof(TL_DATA_REC));
+    record->tTimeStamp =
+        1400000000 + (ulValue * 60) + ((ulValue % 7) ? 0 : (ulValue % 5)) +
+        ((ulValue / 50) * 100000);
+    if ((ulValue % 41) == 0) {
+        record->tTimeStamp += 200;
+    }
+    if ((ulValue % 43) == 0) {
+        record->tTimeStamp += 1500;
+    }
+    if ((ulValue % 97) == 0) {
+        record->tTimeStamp -= 5000;
+    }
+    record->ucRecType = (uint8_t) ((ulValue / 16) % 10);
+    if (((ulValue / 8) % 3) == 0) {
+        record->ucStatus = 0x80 | (ulValue & 0x07);
+    }
+    switch (record->ucRecType) {
+        case TL_TYPE_STATUS:
+            record->Datum.ucLogStatus = ulValue & 0x03;
+            break;
+        case TL_TYPE_BOOL:
+            record->Datum.ucBoolean = ulValue & 0x01;
+            break;
+        case TL_TYPE_REAL:
+            if ((ulValue % 29) == 0) {
+                record->Datum.fReal = -0.0f;
+            } else if ((ulValue % 31) == 0) {
+                record->Datum.fReal = 1.0e30f;
+            } else {
+                record->Datum.fReal = 20.0f + ((ulValue % 13) / 10.0f);
+            }
+            break;
+        case TL_TYPE_ENUM:
+            record->Datum.ulEnum = ulValue % 4;
+            break;
+        case TL_TYPE_UNSIGN:
+            record->Datum.ulUValue = ulValue * 1000;
+            break;
+        case TL_TYPE_SIGN:
+            record->Datum.lSValue = -(int32_t) ulValue;
+            break;
+        case TL_TYPE_BITS:
+            record->Datum.Bits.ucLen = 0x53;
+            record->Datum.Bits.ucStore[0] = (uint8_t) ulValue;
+            record->Datum.Bits.ucStore[3] = (uint8_t) ~ulValue;
+            break;
+        case TL_TYPE_ERROR:
+            record->Datum.Error.usClass = 2;
+            record->Datum.Error.usCode = (uint16_t) ulValue;
+            break;
+        case TL_TYPE_DELTA:
+            record->Datum.fTime = ulValue / 4.0f;
+            break;
+        default:
+            break;
+    }
+}
+
+/* true if a log holds the records first..last made by the test,
+   fetched forwards and backwards */
+static bool testTrendLogPackHolds(
+    unsigned iLog,
+    uint32_t first,
+    uint32_t last)
+{
+    TL_DATA_REC expected;
+    TL_DATA_REC record;
+    uint32_t ulCount = 0;
+    uint32_t ulTotal = 0;
+    uint32_t seq;
+
+    TL_Pack_Storage.Counts(iLog, &ulCount, &ulTotal);
+    if ((ulTotal != last) || (ulCount != (last - first + 1))) {
+        return false;
+    }
+    if (TL_Pack_Storage.Record(iLog, first - 1, &record) ||
+        TL_Pack_Storage.Record(iLog, last + 1, &record)) {
+        return false;
+    }
+    for (seq = first; seq <= last; seq++) {
+        testTrendLogPackRecord(&expected, seq);
+        if (!TL_Pack_Storage.Record(iLog, seq, &record) ||
+            (memcmp(&expected, &record, sizeof(TL_DATA_REC)) != 0)) {
+            return false;
+        }
+    }
+    for (seq = last; seq >= first; seq--) {
+        testTrendLogPackRecord(&expected, seq);
+        if (!TL_Pack_Storage.Record(iLog, seq, &record) ||
+            (memcmp(&expected, &record, sizeof(TL_DATA_REC)) != 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testTrendLogPackAppend(
+    unsigned iLog,
+    uint32_t first,
+    uint32_t last)
+{
+    TL_DATA_REC record;
+    uint32_t seq;
+
+    for (seq = first; seq <= last; seq++) {
+        testTrendLogPackRecord(&record, seq);
+        TL_Pack_Storage.Append(iLog, &record);
+    }
+}
+
+void testTrendLogPack(
+    Test * pTest)
+{
+    const TL_STORAGE *storage;
+    TL_DATA_REC record;
+    uint32_t ulCount = 0;
+    uint32_t ulTotal = 0;
+    uint32_t seq;
+    bool bSame = true;
+
+    storage = tl_pack_storage();
+    ct_test(pTest, storage != NULL);
+    /* a depth that is not a whole number of blocks */
+    ct_test(pTest, storage->Open(2, 100));
+    storage->Counts(1, &ulCount, &ulTotal);
+    ct_test(pTest, ulCount == 0);
+    ct_test(pTest, ulTotal == 0);
+    ct_test(pTest, !storage->Record(1, 0, &record));
+    ct_test(pTest, !storage->Record(1, 1, &record));
+    testTrendLogPackAppend(1, 1, 5);
+    ct_test(pTest, testTrendLogPackHolds(1, 1, 5));
+    storage->Counts(0, &ulCount, &ulTotal);
+    ct_test(pTest, ulTotal == 0);
+    /* the ring wraps, over blocks in part out of the log */
+    testTrendLogPackAppend(1, 6, 300);
+    ct_test(pTest, testTrendLogPackHolds(1, 201, 300));
+    /* fetched in any order, the two logs in turn */
+    testTrendLogPackAppend(0, 1, 100);
+    for (seq = 0; seq < 1000; seq++) {
+        TL_DATA_REC expected;
+        uint32_t ulSequence = 201 + ((seq * 37) % 100);
+
+        testTrendLogPackRecord(&expected, ulSequence);
+        if (!storage->Record(1, ulSequence, &record) ||
+            (memcmp(&expected, &record, sizeof(TL_DATA_REC)) != 0)) {
+            bSame = false;
+        }
+        testTrendLogPackRecord(&expected, ulSequence - 200);
+        if (!storage->Record(0, ulSequence - 200, &record) ||
+            (memcmp(&expected, &record, sizeof(TL_DATA_REC)) != 0)) {
+            bSame = false;
+        }
+    }
+    ct_test(pTest, bSame);
+    /* the newest record, as each one is added */
+    for (seq = 101; seq <= 400; seq++) {
+        TL_DATA_REC expected;
+
+        testTrendLogPackAppend(0, seq, seq);
+        testTrendLogPackRecord(&expected, seq);
+        if (!storage->Record(0, seq, &record) ||
+            (memcmp(&expected, &record, sizeof(TL_DATA_REC)) != 0)) {
+            bSame = false;
+        }
+    }
+    ct_test(pTest, bSame);
+    ct_test(pTest, testTrendLogPackHolds(0, 301, 400));
+    /* a purge part way through a block keeps the sequence going */
+    storage->Purge(1, 1000);
+    storage->Counts(1, &ulCount, &ulTotal);
+    ct_test(pTest, ulCount == 0);
+    ct_test(pTest, ulTotal == 1000);
+    ct_test(pTest, !storage->Record(1, 1000, &record));
+    ct_test(pTest, !storage->Record(1, 300, &record));
+    testTrendLogPackAppend(1, 1001, 1070);
+    ct_test(pTest, testTrendLogPackHolds(1, 1001, 1070));
+    testTrendLogPackAppend(1, 1071, 2000);
+    ct_test(pTest, testTrendLogPackHolds(1, 1901, 2000));
+    storage->Close();
+
+    /* a depth of whole blocks, and of one record */
+    ct_test(pTest, storage->Open(1, TLPACK_BLOCK_RECORDS * 2));
+    testTrendLogPackAppend(0, 1, TLPACK_BLOCK_RECORDS * 5);
+    ct_test(pTest, testTrendLogPackHolds(0, (TLPACK_BLOCK_RECORDS * 3) + 1,
+            TLPACK_BLOCK_RECORDS * 5));
+    storage->Close();
+    ct_test(pTest, storage->Open(1, 1));
+    testTrendLogPackAppend(0, 1, 200);
+    ct_test(pTest, testTrendLogPackHolds(0, 200, 200));
+    storage->Close();
+}
+
+#ifdef TEST_TLPACK
+#include <time.h>
+
+/* the next of a sequence of pseudo random numbers */
+static uint32_t testTrendLogPackRandom(
+    uint32_t * pulSeed)
+{
+    *pulSeed = (*pulSeed * 1103515245UL) + 12345UL;
+
+    return *pulSeed >> 8;
+}
+
+/* kinds of logs: a temperature read every minute to a tenth of a degree,
+   a value with every bit of the REAL changing, a binary value logged on
+   COV at random times, a meter logged every quarter of an hour */
+static void testTrendLogPackSample(
+    unsigned uiKind,
+    uint32_t * pulSeed,
+    uint32_t ulValue,
+    TL_DATA_REC * record)
+{
+    static int32_t lTenths;
+    static time_t tLast;
+
+    memset(record, 0, sizeof(TL_DATA_REC));
+    if (ulValue == 0) {
+        lTenths = 215;
+        tLast = 1400000000;
+    }
+    switch (uiKind) {
+        case 0:
+            lTenths += (int32_t) (testTrendLogPackRandom(pulSeed) % 3) - 1;
+            record->ucRecType = TL_TYPE_REAL;
+            record->Datum.fReal = lTenths / 10.0f;
+            tLast += 60;
+            break;
+        case 1:
+            record->ucRecType = TL_TYPE_REAL;
+            record->Datum.fReal =
+                20.0f + (testTrendLogPackRandom(pulSeed) / 16777216.0f);
+            tLast += 60;
+            break;
+        case 2:
+            record->ucRecType = TL_TYPE_BOOL;
+            record->ucStatus = 0x80;
+            record->Datum.ucBoolean = ulValue & 1;
+            tLast += 1 + (testTrendLogPackRandom(pulSeed) % 3600);
+            break;
+        default:
+            record->ucRecType = TL_TYPE_UNSIGN;
+            record->Datum.ulUValue =
+                ulValue * 40 + (testTrendLogPackRandom(pulSeed) % 8);
+            tLast += 900;
+            break;
+    }
+    record->tTimeStamp = tLast;
+}
+
+/* octets taken by a deep log of each kind, and records fetched a second
+   in order, in reverse order and at random */
+static void testTrendLogPackBenchmark(
+    uint32_t depth)
+{
+    static const char *Kinds[] = {
+        "temperature", "noisy REAL", "binary COV", "meter"
+    };
+    TL_DATA_REC record;
+    uint32_t ulSeed;
+    uint32_t seq;
+    unsigned uiKind;
+    size_t octets;
+    size_t i;
+    clock_t start;
+    double append;
+    double order;
+    double reverse;
+    double random;
+
+    for (uiKind = 0; uiKind < 4; uiKind++) {
+        if (!TL_Pack_Storage.Open(1, depth)) {
+            printf("unable to keep a log of %lu records\n",
+                (unsigned long) depth);
+            return;
+        }
+        ulSeed = 1;
+        start = clock();
+        for (seq = 0; seq < depth; seq++) {
+            testTrendLogPackSample(uiKind, &ulSeed, seq, &record);
+            TL_Pack_Storage.Append(0, &record);
+        }
+        append = (double) (clock() - start) / CLOCKS_PER_SEC;
+        octets = sizeof(struct tl_pack_log);
+        for (i = 0; i < Pack_Block_Count; i++) {
+            octets += sizeof(struct tl_pack_block) + Pack_Blocks[i].usSize;
+        }
+        start = clock();
+        for (seq = 1; seq <= depth; seq++) {
+            (void) TL_Pack_Storage.Record(0, seq, &record);
+        }
+        order = (double) (clock() - start) / CLOCKS_PER_SEC;
+        start = clock();
+        for (seq = depth; seq >= 1; seq--) {
+            (void) TL_Pack_Storage.Record(0, seq, &record);
+        }
+        reverse = (double) (clock() - start) / CLOCKS_PER_SEC;
+        ulSeed = 1;
+        start = clock();
+        for (i = 0; i < depth; i++) {
+            (void) TL_Pack_Storage.Record(0,
+                1 + (testTrendLogPackRandom(&ulSeed) % depth), &record);
+        }
+        random = (double) (clock() - start) / CLOCKS_PER_SEC;
+        TL_Pack_Storage.Close();
+        printf("%s: %.2f octets/record, %.1fx RAM (%u), "
+            "%.0f appended/s, %.0f fetched/s in order, %.0f in reverse, "
+            "%.0f at random\n",
+            Kinds[uiKind], (double) octets / depth,
+            (double) depth * sizeof(TL_DATA_REC) / octets,
+            (unsigned) sizeof(TL_DATA_REC),
+            append > 0 ? depth / append : 0.0,
+            order > 0 ? depth / order : 0.0,
+            reverse > 0 ? depth / reverse : 0.0,
+            random > 0 ? depth / random : 0.0);
+    }
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    uint32_t depth = 1000000;
+
+    pTest = ct_create("BACnet Trend Log Packed Storage", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTrendLogPack);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1)
+        depth = strtoul(argv[1], NULL, 0);
+    testTrendLogPackBenchmark(depth);
+
+    return 0;
+}
+#endif /* TEST_TLPACK */
+#endif /* TEST */
@@ -0,0 +1,65 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef TLPACK_H
+#define TLPACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "trendlog.h"
+
+/**
+* Trend Log storage that keeps the records in RAM packed in blocks of
+* TLPACK_BLOCK_RECORDS, so that the same RAM holds a much deeper log:
+* the time stamps as the change of the interval between them, and each
+* datum XORed with the one before it, as regular readings of slowly
+* changing values take only a few bits.  A record is found by its
+* block, and unpacked from the start of the block; the records of the
+* block last unpacked are kept, so that records fetched in order either
+* way, as ReadRange does, cost no more than one each.
+*
+* As with tl_mmap_storage(), the time stamps are kept to 32 bits.
+*/
+
+#ifndef TLPACK_BLOCK_RECORDS
+#define TLPACK_BLOCK_RECORDS 64 /* at most 512 */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    const TL_STORAGE *tl_pack_storage(
+        void);
+
+#ifdef TEST
+#include "ctest.h"
+    void testTrendLogPack(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
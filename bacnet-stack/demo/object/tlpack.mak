@@ -0,0 +1,32 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../../src
+TEST_DIR = ../../test
+INCLUDES = -I../../include -I$(TEST_DIR) -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_TLPACK
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = tlpack.c \
+	$(TEST_DIR)/ctest.c
+
+TARGET = tlpack
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} 
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS)
+
+include: .depend
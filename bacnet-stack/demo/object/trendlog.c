@@ -25,6 +25,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>     /* for calloc */
 #include <string.h>     /* for memmove */
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -44,13 +45,131 @@
 #include "bacfile.h"    /* object list dependency */
 #endif
 
-/* number of demo objects */
-#ifndef MAX_TREND_LOGS
-#define MAX_TREND_LOGS 8
-#endif
+static TL_LOG_INFO *LogInfo;
+static bool Trend_Log_Initialized;
+/* where the records are kept, and the number and depth of the logs */
+static const TL_STORAGE *Storage;
+static unsigned Trend_Log_Instances;
+static unsigned Trend_Log_Storage_Logs;
+static uint32_t Trend_Log_Depth;
+/* the logs that log on COV, chained in buckets by the object they log */
+static int *COV_Buckets;
+static unsigned COV_Bucket_Count;
+/*
+ * The polled and triggered logs wait in a timer wheel for the second of
+ * their next reading: 256 slots of a second, 64 slots of 256 seconds,
+ * and 64 slots of 16384 seconds. A log due later than that waits in the
+ * last slot, and is placed again when that slot comes round. One more
+ * slot holds the logs that are due now.
+ */
+#define TL_WHEEL_SECONDS 256
+#define TL_WHEEL_BLOCKS 64
+#define TL_WHEEL_BLOCK_SHIFT 8
+#define TL_WHEEL_SPANS 64
+#define TL_WHEEL_SPAN_SHIFT 14
+#define TL_WHEEL_DUE (TL_WHEEL_SECONDS + TL_WHEEL_BLOCKS + TL_WHEEL_SPANS)
+/* more seconds than this since the last turn, or going back, and the
+   logs are scheduled again rather than the wheel turned */
+#define TL_WHEEL_CATCH_UP 3600
+static int TL_Wheel[TL_WHEEL_DUE + 1];
+static time_t TL_Wheel_Time;    /* the last second the wheel turned to */
+/* readings of overdue logs that are not aligned are spread out */
+static bool TL_Spread;
+
+/* The default storage: a ring of records in RAM for each log */
+struct tl_ram_log {
+    uint32_t ulHead;    /* Current insertion point */
+    uint32_t ulRecordCount;
+    uint32_t ulTotalRecordCount;
+};
+static TL_DATA_REC *RAM_Records;
+static struct tl_ram_log *RAM_Logs;
+static uint32_t RAM_Depth;
+
+static void tl_ram_close(
+    void)
+{
+    free(RAM_Records);
+    RAM_Records = NULL;
+    free(RAM_Logs);
+    RAM_Logs = NULL;
+}
+
+static bool tl_ram_open(
+    unsigned logs,
+    uint32_t depth)
+{
+    if ((depth != 0) && (logs > (SIZE_MAX / sizeof(TL_DATA_REC)) / depth))
+        return false;
+    RAM_Records = calloc((size_t) logs * depth, sizeof(TL_DATA_REC));
+    RAM_Logs = calloc(logs, sizeof(struct tl_ram_log));
+    if ((RAM_Records == NULL) || (RAM_Logs == NULL)) {
+        tl_ram_close();
+        return false;
+    }
+    RAM_Depth = depth;
+
+    return true;
+}
+
+static void tl_ram_append(
+    unsigned iLog,
+    const TL_DATA_REC * record)
+{
+    struct tl_ram_log *Log = &RAM_Logs[iLog];
+
+    RAM_Records[((size_t) iLog * RAM_Depth) + Log->ulHead] = *record;
+    Log->ulHead++;
+    if (Log->ulHead >= RAM_Depth)
+        Log->ulHead = 0;
+    Log->ulTotalRecordCount++;
+    if (Log->ulRecordCount < RAM_Depth)
+        Log->ulRecordCount++;
+}
+
+static bool tl_ram_record(
+    unsigned iLog,
+    uint32_t ulSequence,
+    TL_DATA_REC * record)
+{
+    struct tl_ram_log *Log = &RAM_Logs[iLog];
+    uint32_t ulBack;    /* how far back from the newest record */
+
+    ulBack = Log->ulTotalRecordCount - ulSequence;
+    if (ulBack >= Log->ulRecordCount)
+        return false;
+    *record =
+        RAM_Records[((size_t) iLog * RAM_Depth) +
+        ((Log->ulHead + RAM_Depth - 1 - ulBack) % RAM_Depth)];
+
+    return true;
+}
 
-TL_DATA_REC Logs[MAX_TREND_LOGS][TL_MAX_ENTRIES];
-static TL_LOG_INFO LogInfo[MAX_TREND_LOGS];
+static void tl_ram_counts(
+    unsigned iLog,
+    uint32_t * pulRecordCount,
+    uint32_t * pulTotalRecordCount)
+{
+    *pulRecordCount = RAM_Logs[iLog].ulRecordCount;
+    *pulTotalRecordCount = RAM_Logs[iLog].ulTotalRecordCount;
+}
+
+static void tl_ram_purge(
+    unsigned iLog,
+    uint32_t ulTotalRecordCount)
+{
+    RAM_Logs[iLog].ulRecordCount = 0;
+    RAM_Logs[iLog].ulTotalRecordCount = ulTotalRecordCount;
+}
+
+static const TL_STORAGE TL_RAM_Storage = {
+    tl_ram_open,
+    tl_ram_close,
+    tl_ram_append,
+    tl_ram_record,
+    tl_ram_counts,
+    tl_ram_purge
+};
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Trend_Log_Properties_Required[] = {
@@ -75,10 +194,8 @@ static const int Trend_Log_Properties_Optional[] = {
     PROP_STOP_TIME,
     PROP_LOG_DEVICE_OBJECT_PROPERTY,
     PROP_LOG_INTERVAL,
-
-/* Required if COV logging supported
     PROP_COV_RESUBSCRIPTION_INTERVAL,
-    PROP_CLIENT_COV_INCREMENT, */
+    PROP_CLIENT_COV_INCREMENT,
 
 /* Required if intrinsic reporting supported
     PROP_NOTIFICATION_THRESHOLD,
@@ -121,7 +238,7 @@ void Trend_Log_Property_Lists(
 bool Trend_Log_Valid_Instance(
     uint32_t object_instance)
 {
-    if (object_instance < MAX_TREND_LOGS) {
+    if (object_instance < Trend_Log_Instances) {
         return true;
     }
 
@@ -133,7 +250,7 @@ bool Trend_Log_Valid_Instance(
 unsigned Trend_Log_Count(
     void)
 {
-    return MAX_TREND_LOGS;
+    return Trend_Log_Instances;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -151,15 +268,576 @@ uint32_t Trend_Log_Index_To_Instance(
 unsigned Trend_Log_Instance_To_Index(
     uint32_t object_instance)
 {
-    unsigned index = MAX_TREND_LOGS;
+    unsigned index = Trend_Log_Instances;
 
-    if (object_instance < MAX_TREND_LOGS) {
+    if (object_instance < Trend_Log_Instances) {
         index = object_instance;
     }
 
     return index;
 }
 
+/*
+ * Select where the Trend Logs keep their records, and how many logs
+ * there are with how many records each. Should be called before the
+ * logs are initialised, that is before Device_Init(). Without it, or
+ * if the storage cannot be opened, MAX_TREND_LOGS logs of
+ * TL_MAX_ENTRIES records are kept in RAM. If the logs have already been
+ * initialised, they are set up again here, in the new storage. The
+ * logs are only counted once Trend_Log_Init() has set them up.
+ */
+bool Trend_Log_Storage_Set(
+    const TL_STORAGE * storage,
+    unsigned logs,
+    uint32_t depth)
+{
+    bool reinit = false;
+    bool status = false;
+
+    if (storage == NULL)
+        storage = &TL_RAM_Storage;
+    if ((logs == 0) || (logs > BACNET_MAX_INSTANCE) || (depth == 0) ||
+        (depth > (UINT32_MAX / 2)))
+        return false;
+    if (Storage != NULL) {
+        Storage->Close();
+        Storage = NULL;
+        Trend_Log_Instances = 0;
+        free(LogInfo);
+        LogInfo = NULL;
+        free(COV_Buckets);
+        COV_Buckets = NULL;
+        reinit = Trend_Log_Initialized;
+        Trend_Log_Initialized = false;
+    }
+    if (storage->Open(logs, depth)) {
+        Storage = storage;
+        Trend_Log_Storage_Logs = logs;
+        Trend_Log_Depth = depth;
+        status = true;
+    }
+    if (reinit) {
+        Trend_Log_Init();
+    }
+
+    return status;
+}
+
+/* Copy the record counts of a log from its storage */
+static void TL_Storage_Counts(
+    int iLog)
+{
+    Storage->Counts(iLog, &LogInfo[iLog].ulRecordCount,
+        &LogInfo[iLog].ulTotalRecordCount);
+}
+
+/* Fetch the record at a BACnet 1 based position, 1 being the oldest */
+static bool TL_Record(
+    int iLog,
+    uint32_t uiPosition,
+    TL_DATA_REC * record)
+{
+    uint32_t ulSequence;
+
+    ulSequence =
+        LogInfo[iLog].ulTotalRecordCount - LogInfo[iLog].ulRecordCount +
+        uiPosition;
+
+    return Storage->Record(iLog, ulSequence, record);
+}
+
+/* Add a record to a log, in place of the oldest one if it is full */
+static void TL_Append(
+    int iLog,
+    const TL_DATA_REC * record)
+{
+    TL_DATA_REC Newest;
+
+    /* note a record older than the one before it, as when the clock
+       is set back, so that the log is not searched by time as sorted */
+    if ((LogInfo[iLog].ulRecordCount > 0) &&
+        TL_Record(iLog, LogInfo[iLog].ulRecordCount, &Newest) &&
+        (record->tTimeStamp < Newest.tTimeStamp))
+        LogInfo[iLog].ulUnorderedSeq = LogInfo[iLog].ulTotalRecordCount + 1;
+    Storage->Append(iLog, record);
+    TL_Storage_Counts(iLog);
+}
+
+/* Empty a log, keeping the count of all the records it has had */
+static void TL_Purge(
+    int iLog)
+{
+    Storage->Purge(iLog, LogInfo[iLog].ulTotalRecordCount);
+    TL_Storage_Counts(iLog);
+}
+
+/* True if the records of a log are in time order: none of those kept
+ * is older than the one before it.
+ */
+static bool TL_Ordered(
+    int iLog)
+{
+    return LogInfo[iLog].ulUnorderedSeq <=
+        (LogInfo[iLog].ulTotalRecordCount - LogInfo[iLog].ulRecordCount + 1);
+}
+
+/* Find the newest record of a log kept over a reset that is older than
+ * the one before it.
+ */
+static void TL_Find_Unordered(
+    int iLog)
+{
+    TL_DATA_REC Record;
+    time_t tPrevious = 0;
+    uint32_t uiPosition;
+
+    LogInfo[iLog].ulUnorderedSeq = 0;
+    for (uiPosition = 1; uiPosition <= LogInfo[iLog].ulRecordCount;
+        uiPosition++) {
+        if (!TL_Record(iLog, uiPosition, &Record))
+            continue;
+        if ((uiPosition > 1) && (Record.tTimeStamp < tPrevious))
+            LogInfo[iLog].ulUnorderedSeq =
+                LogInfo[iLog].ulTotalRecordCount -
+                LogInfo[iLog].ulRecordCount + uiPosition;
+        tPrevious = Record.tTimeStamp;
+    }
+}
+
+/* Binary search of a log in time order for the BACnet 1 based position
+ * of the first record later than tRefTime, or not earlier than it if
+ * bOrEqual. One past the newest record if there is none.
+ */
+static uint32_t TL_Time_Search(
+    int iLog,
+    time_t tRefTime,
+    bool bOrEqual)
+{
+    TL_DATA_REC Record;
+    uint32_t uiLow = 1;
+    uint32_t uiHigh = LogInfo[iLog].ulRecordCount + 1;
+    uint32_t uiMiddle;
+
+    while (uiLow < uiHigh) {
+        uiMiddle = uiLow + ((uiHigh - uiLow) / 2);
+        if (TL_Record(iLog, uiMiddle, &Record) &&
+            ((Record.tTimeStamp > tRefTime) || (bOrEqual &&
+                    (Record.tTimeStamp == tRefTime))))
+            uiHigh = uiMiddle;
+        else
+            uiLow = uiMiddle + 1;
+    }
+
+    return uiLow;
+}
+
+/* Keep a bit string in a log record, truncated at 32 bits */
+static void TL_Bits_To_Record(
+    BACNET_BIT_STRING * pBits,
+    TL_DATA_REC * record)
+{
+    uint8_t ucCount;
+
+    record->ucRecType = TL_TYPE_BITS;
+    if (bitstring_bits_used(pBits) < 32) {
+        /* Store the bytes used and the bits free in the last byte */
+        record->Datum.Bits.ucLen = bitstring_bytes_used(pBits) << 4;
+        record->Datum.Bits.ucLen |=
+            (8 - (bitstring_bits_used(pBits) % 8)) & 7;
+        /* Fetch the octets with the bits directly */
+        for (ucCount = 0; ucCount < bitstring_bytes_used(pBits); ucCount++)
+            record->Datum.Bits.ucStore[ucCount] =
+                bitstring_octet(pBits, ucCount);
+    } else {
+        /* We will only use the first 4 octets to save space */
+        record->Datum.Bits.ucLen = 4 << 4;
+        for (ucCount = 0; ucCount < 4; ucCount++)
+            record->Datum.Bits.ucStore[ucCount] =
+                bitstring_octet(pBits, ucCount);
+    }
+}
+
+/* Keep an application data value in a log record */
+static void TL_Value_To_Record(
+    BACNET_APPLICATION_DATA_VALUE * value,
+    TL_DATA_REC * record)
+{
+    switch (value->tag) {
+        case BACNET_APPLICATION_TAG_NULL:
+            record->ucRecType = TL_TYPE_NULL;
+            break;
+
+        case BACNET_APPLICATION_TAG_BOOLEAN:
+            record->ucRecType = TL_TYPE_BOOL;
+            record->Datum.ucBoolean = value->type.Boolean;
+            break;
+
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            record->ucRecType = TL_TYPE_UNSIGN;
+            record->Datum.ulUValue = value->type.Unsigned_Int;
+            break;
+
+        case BACNET_APPLICATION_TAG_SIGNED_INT:
+            record->ucRecType = TL_TYPE_SIGN;
+            record->Datum.lSValue = value->type.Signed_Int;
+            break;
+
+        case BACNET_APPLICATION_TAG_REAL:
+            record->ucRecType = TL_TYPE_REAL;
+            record->Datum.fReal = value->type.Real;
+            break;
+
+        case BACNET_APPLICATION_TAG_BIT_STRING:
+            TL_Bits_To_Record(&value->type.Bit_String, record);
+            break;
+
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            record->ucRecType = TL_TYPE_ENUM;
+            record->Datum.ulEnum = value->type.Enumerated;
+            break;
+
+        default:
+            /* Fake an error response for any types we cannot handle */
+            record->Datum.Error.usClass = ERROR_CLASS_PROPERTY;
+            record->Datum.Error.usCode = ERROR_CODE_DATATYPE_NOT_SUPPORTED;
+            record->ucRecType = TL_TYPE_ERROR;
+            break;
+    }
+}
+
+/*
+ * Logging on COV is done for the Present_Value of objects in this device
+ * that have a COV Value List. Such objects tell the Device object when
+ * their value or status changes, and it tells us, so there is no polling
+ * and nothing to do while the values are stable.
+ */
+static bool TL_COV_Supported(
+    BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE * Source)
+{
+    if ((Source->deviceIndentifier.type == OBJECT_DEVICE) &&
+        (Source->deviceIndentifier.instance !=
+            Device_Object_Instance_Number()))
+        return false;
+
+    return (Source->propertyIdentifier == PROP_PRESENT_VALUE) &&
+        (Source->arrayIndex == BACNET_ARRAY_ALL) &&
+        Device_Value_List_Supported(Source->objectIdentifier.type);
+}
+
+static unsigned TL_COV_Bucket(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    return (object_instance ^ ((uint32_t) object_type << 22)) &
+        (COV_Bucket_Count - 1);
+}
+
+/* Chain the COV logs in the buckets of the objects they log */
+static void TL_COV_Index(
+    void)
+{
+    unsigned uiBucket;
+    int iLog;
+
+    for (uiBucket = 0; uiBucket < COV_Bucket_Count; uiBucket++)
+        COV_Buckets[uiBucket] = -1;
+    for (iLog = (int) Trend_Log_Instances - 1; iLog >= 0; iLog--) {
+        LogInfo[iLog].iNextCOV = -1;
+        if (LogInfo[iLog].LoggingType == LOGGING_TYPE_COV) {
+            uiBucket =
+                TL_COV_Bucket(LogInfo[iLog].Source.objectIdentifier.type,
+                LogInfo[iLog].Source.objectIdentifier.instance);
+            LogInfo[iLog].iNextCOV = COV_Buckets[uiBucket];
+            COV_Buckets[uiBucket] = iLog;
+        }
+    }
+}
+
+/* The Client_COV_Increment, or if it is NULL the COV_Increment of the
+ * object, which is found once rather than on every change.
+ */
+static void TL_COV_Increment(
+    int iLog)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_APPLICATION_DATA_VALUE value;
+    uint8_t apdu[16];
+    int len;
+
+    CurrentLog->fCOVIncrement = CurrentLog->fClientCOVIncrement;
+    if (CurrentLog->bClientCOVIncrement)
+        return;
+    /* any change, unless the object has an increment */
+    CurrentLog->fCOVIncrement = 0.0f;
+    rpdata.object_type = CurrentLog->Source.objectIdentifier.type;
+    rpdata.object_instance = CurrentLog->Source.objectIdentifier.instance;
+    rpdata.object_property = PROP_COV_INCREMENT;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = sizeof(apdu);
+    len = Device_Read_Property(&rpdata);
+    if ((len > 0) && (bacapp_decode_application_data(apdu, len, &value) > 0)
+        && (value.tag == BACNET_APPLICATION_TAG_REAL))
+        CurrentLog->fCOVIncrement = value.type.Real;
+}
+
+/* Log the value of the object of a COV log, if it has changed by the
+ * COV increment or its status flags have changed since the last value
+ * logged, or if bForce.
+ */
+static void TL_COV_Log(
+    int iLog,
+    bool bForce)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    BACNET_PROPERTY_VALUE value_list[2];
+    TL_DATA_REC TempRec;
+    float fDelta;
+
+    value_list[0].next = &value_list[1];
+    value_list[1].next = NULL;
+    value_list[0].value.tag = BACNET_APPLICATION_TAG_NULL;
+    value_list[1].value.tag = BACNET_APPLICATION_TAG_NULL;
+    (void) Device_Encode_Value_List(CurrentLog->Source.objectIdentifier.type,
+        CurrentLog->Source.objectIdentifier.instance, &value_list[0]);
+    memset(&TempRec, 0, sizeof(TempRec));
+    TL_Value_To_Record(&value_list[0].value, &TempRec);
+    if (value_list[1].value.tag == BACNET_APPLICATION_TAG_BIT_STRING)
+        TempRec.ucStatus =
+            128 | bitstring_octet(&value_list[1].value.type.Bit_String, 0);
+    if (!bForce && (TempRec.ucRecType == CurrentLog->COVRecord.ucRecType) &&
+        (TempRec.ucStatus == CurrentLog->COVRecord.ucStatus)) {
+        if (TempRec.ucRecType == TL_TYPE_REAL) {
+            fDelta = TempRec.Datum.fReal - CurrentLog->COVRecord.Datum.fReal;
+            if (fDelta < 0.0f)
+                fDelta = -fDelta;
+            if ((fDelta == 0.0f) || (fDelta < CurrentLog->fCOVIncrement))
+                return;
+        } else if (memcmp(&TempRec.Datum, &CurrentLog->COVRecord.Datum,
+                sizeof(TempRec.Datum)) == 0) {
+            return;
+        }
+    }
+    TempRec.tTimeStamp = time(NULL);
+    CurrentLog->tLastDataTime = TempRec.tTimeStamp;
+    CurrentLog->COVRecord = TempRec;
+    TL_Append(iLog, &TempRec);
+}
+
+/* Start logging on COV, with the value as it is now, as the first
+ * notification of a subscription would give it.
+ */
+static void TL_COV_Subscribe(
+    int iLog)
+{
+    TL_COV_Increment(iLog);
+    TL_COV_Index();
+    if (TL_Is_Enabled(iLog))
+        TL_COV_Log(iLog, true);
+}
+
+/* Told by the Device object that a local object has changed */
+static void TL_COV_Changed(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    int iLog;
+
+    if (COV_Buckets == NULL)
+        return;
+    for (iLog = COV_Buckets[TL_COV_Bucket(object_type, object_instance)];
+        iLog >= 0; iLog = LogInfo[iLog].iNextCOV) {
+        if ((LogInfo[iLog].Source.objectIdentifier.type == object_type) &&
+            (LogInfo[iLog].Source.objectIdentifier.instance ==
+                object_instance) && TL_Is_Enabled(iLog))
+            TL_COV_Log(iLog, false);
+    }
+}
+
+/* Put a log in the slot of the wheel for its due time */
+static void TL_Wheel_Place(
+    int iLog)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    time_t tDue = CurrentLog->tDue;
+    int iSlot;
+
+    if ((tDue - TL_Wheel_Time) < TL_WHEEL_SECONDS)
+        iSlot = (int) (tDue & (TL_WHEEL_SECONDS - 1));
+    else if (((tDue >> TL_WHEEL_BLOCK_SHIFT) -
+            (TL_Wheel_Time >> TL_WHEEL_BLOCK_SHIFT)) < TL_WHEEL_BLOCKS)
+        iSlot = TL_WHEEL_SECONDS +
+            (int) ((tDue >> TL_WHEEL_BLOCK_SHIFT) & (TL_WHEEL_BLOCKS - 1));
+    else if (((tDue >> TL_WHEEL_SPAN_SHIFT) -
+            (TL_Wheel_Time >> TL_WHEEL_SPAN_SHIFT)) < TL_WHEEL_SPANS)
+        iSlot = TL_WHEEL_SECONDS + TL_WHEEL_BLOCKS +
+            (int) ((tDue >> TL_WHEEL_SPAN_SHIFT) & (TL_WHEEL_SPANS - 1));
+    else
+        iSlot = TL_WHEEL_SECONDS + TL_WHEEL_BLOCKS +
+            (int) (((TL_Wheel_Time >> TL_WHEEL_SPAN_SHIFT) +
+                TL_WHEEL_SPANS - 1) & (TL_WHEEL_SPANS - 1));
+    CurrentLog->iDueSlot = iSlot;
+    CurrentLog->iPrevDue = -1;
+    CurrentLog->iNextDue = TL_Wheel[iSlot];
+    if (CurrentLog->iNextDue >= 0)
+        LogInfo[CurrentLog->iNextDue].iPrevDue = iLog;
+    TL_Wheel[iSlot] = iLog;
+}
+
+/* Take a log out of the wheel */
+static void TL_Wheel_Remove(
+    int iLog)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+
+    if (CurrentLog->iDueSlot < 0)
+        return;
+    if (CurrentLog->iPrevDue >= 0)
+        LogInfo[CurrentLog->iPrevDue].iNextDue = CurrentLog->iNextDue;
+    else
+        TL_Wheel[CurrentLog->iDueSlot] = CurrentLog->iNextDue;
+    if (CurrentLog->iNextDue >= 0)
+        LogInfo[CurrentLog->iNextDue].iPrevDue = CurrentLog->iPrevDue;
+    CurrentLog->iDueSlot = -1;
+    CurrentLog->iNextDue = -1;
+    CurrentLog->iPrevDue = -1;
+}
+
+/* Place the logs of a slot again, now that the wheel has come to it;
+   those due now go to the due slot */
+static void TL_Wheel_Cascade(
+    int iSlot)
+{
+    int iLog;
+    int iNext;
+
+    iLog = TL_Wheel[iSlot];
+    TL_Wheel[iSlot] = -1;
+    while (iLog >= 0) {
+        iNext = LogInfo[iLog].iNextDue;
+        TL_Wheel_Place(iLog);
+        iLog = iNext;
+    }
+}
+
+/* The first second, not before tFrom, at which t % ulInterval is
+   ulPhase */
+static time_t TL_Next_Phase(
+    time_t tFrom,
+    uint32_t ulInterval,
+    uint32_t ulPhase)
+{
+    uint32_t ulNow = (uint32_t) (tFrom % ulInterval);
+
+    return tFrom + ((ulPhase + ulInterval - ulNow) % ulInterval);
+}
+
+/*
+ * The first second after tAfter at which trend_log_timer() can take a
+ * reading of a log, going by the same tests, or 0 if it cannot take one
+ * until something about the log is changed. The reading may still not
+ * be taken then; the log is just looked at again.
+ */
+static time_t TL_Next_Due(
+    int iLog,
+    time_t tAfter)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+    time_t tFrom = tAfter + 1;
+    time_t tDue;
+    time_t tCatchUp;
+    uint32_t ulInterval;
+
+    if ((CurrentLog->bEnable == false) ||
+        ((CurrentLog->LoggingType != LOGGING_TYPE_POLLED) &&
+            (CurrentLog->LoggingType != LOGGING_TYPE_TRIGGERED)))
+        return 0;
+    /* not before the start time, if there is one */
+    if (((CurrentLog->ucTimeFlags & TL_T_START_WILD) == 0) &&
+        (tFrom < CurrentLog->tStartTime))
+        tFrom = CurrentLog->tStartTime;
+    ulInterval = CurrentLog->ulLogInterval;
+    if (ulInterval == 0)
+        ulInterval = 1;
+    if (CurrentLog->bTrigger == true) {
+        tDue = tFrom;
+    } else if (CurrentLog->LoggingType == LOGGING_TYPE_TRIGGERED) {
+        return 0;
+    } else if (CurrentLog->bAlignIntervals == true) {
+        /* on the offset into the interval, or late by more than one */
+        tDue =
+            TL_Next_Phase(tFrom, ulInterval,
+            CurrentLog->ulIntervalOffset % ulInterval);
+        tCatchUp = CurrentLog->tLastDataTime + ulInterval + 1;
+        if (tCatchUp < tFrom)
+            tCatchUp = tFrom;
+        if (tCatchUp < tDue)
+            tDue = tCatchUp;
+    } else {
+        tDue = CurrentLog->tLastDataTime + ulInterval;
+        if (tDue < tFrom) {
+            tDue = tFrom;
+            /* so that logs that start together do not keep reading
+               together, an overdue log reads at a point of its interval
+               that comes from its instance */
+            if (TL_Spread)
+                tDue =
+                    TL_Next_Phase(tFrom, ulInterval,
+                    ((uint32_t) ((uint32_t) iLog * 2654435761UL) >> 16) %
+                    ulInterval);
+        }
+    }
+    /* not after the stop time, if there is one */
+    if (((CurrentLog->ucTimeFlags & TL_T_STOP_WILD) == 0) &&
+        (tDue > CurrentLog->tStopTime))
+        return 0;
+
+    return tDue;
+}
+
+/* Work out when a log is next due, after the wheel's time */
+static void TL_Schedule(
+    int iLog)
+{
+    TL_Wheel_Remove(iLog);
+    LogInfo[iLog].tDue = TL_Next_Due(iLog, TL_Wheel_Time);
+    if (LogInfo[iLog].tDue != 0)
+        TL_Wheel_Place(iLog);
+}
+
+/* Empty the wheel, and schedule all the logs after tAfter */
+static void TL_Schedule_All(
+    time_t tAfter)
+{
+    int iLog;
+
+    for (iLog = 0; iLog <= TL_WHEEL_DUE; iLog++)
+        TL_Wheel[iLog] = -1;
+    TL_Wheel_Time = tAfter;
+    for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++) {
+        LogInfo[iLog].iDueSlot = -1;
+        TL_Schedule(iLog);
+    }
+}
+
+/*
+ * Spread the readings of polled logs that are not aligned to the clock,
+ * when they are overdue, as they all are when they start together. Each
+ * such log then reads at its own point of its interval, rather than all
+ * of them in the same second. Off unless set.
+ */
+void Trend_Log_Spread_Set(
+    bool bSpread)
+{
+    int iLog;
+
+    TL_Spread = bSpread;
+    for (iLog = 0; (LogInfo != NULL) && (iLog < (int) Trend_Log_Instances);
+        iLog++)
+        TL_Schedule(iLog);
+}
+
 /*
  * Things to do when starting up the stack for Trend Logs.
  * Should be called whenever we reset the device or power it up
@@ -167,55 +845,89 @@ unsigned Trend_Log_Instance_To_Index(
 void Trend_Log_Init(
     void)
 {
-    static bool initialized = false;
     int iLog;
-    int iEntry;
+    uint32_t iEntry;
+    uint32_t ulEntries;
     struct tm TempTime;
     time_t tClock;
+    TL_DATA_REC TempRec;
+
+    if (!Trend_Log_Initialized) {
+        Trend_Log_Initialized = true;
 
-    if (!initialized) {
-        initialized = true;
+        if (Storage == NULL) {
+            if (!Trend_Log_Storage_Set(NULL, MAX_TREND_LOGS,
+                    TL_MAX_ENTRIES))
+                return;
+        }
+        LogInfo = calloc(Trend_Log_Storage_Logs, sizeof(TL_LOG_INFO));
+        for (COV_Bucket_Count = 1;
+            COV_Bucket_Count < Trend_Log_Storage_Logs;
+            COV_Bucket_Count <<= 1) {
+        }
+        COV_Buckets = calloc(COV_Bucket_Count, sizeof(int));
+        if ((LogInfo == NULL) || (COV_Buckets == NULL)) {
+            free(LogInfo);
+            LogInfo = NULL;
+            free(COV_Buckets);
+            COV_Buckets = NULL;
+            return;
+        }
+        Trend_Log_Instances = Trend_Log_Storage_Logs;
 
         /* initialize all the values */
 
-        for (iLog = 0; iLog < MAX_TREND_LOGS; iLog++) {
+        for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++) {
             /*
-             * Do we need to do anything here?
              * Trend logs are usually assumed to survive over resets
-             * and are frequently implemented using Battery Backed RAM
-             * If they are implemented using Flash or SD cards or some
-             * such mechanism there may be some RAM based setup needed
-             * for log management purposes.
-             * We probably need to look at inserting LOG_INTERRUPTED
-             * entries into any active logs if the power down or reset
-             * may have caused us to miss readings.
-             */
-
-            /* We will just fill the logs with some entries for testing
-             * purposes.
+             * and are frequently implemented using Battery Backed RAM,
+             * Flash or SD cards, which is what the storage is for.
              */
-            TempTime.tm_year = 109;
-            TempTime.tm_mon = iLog + 1; /* Different month for each log */
-            TempTime.tm_mday = 1;
-            TempTime.tm_hour = 0;
-            TempTime.tm_min = 0;
-            TempTime.tm_sec = 0;
-            tClock = mktime(&TempTime);
-
-            for (iEntry = 0; iEntry < TL_MAX_ENTRIES; iEntry++) {
-                Logs[iLog][iEntry].tTimeStamp = tClock;
-                Logs[iLog][iEntry].ucRecType = TL_TYPE_REAL;
-                Logs[iLog][iEntry].Datum.fReal =
-                    (float) (iEntry + (iLog * TL_MAX_ENTRIES));
-                /* Put status flags with every second log */
-                if ((iLog & 1) == 0)
-                    Logs[iLog][iEntry].ucStatus = 128;
-                else
-                    Logs[iLog][iEntry].ucStatus = 0;
-                tClock += 900;  /* advance 15 minutes */
+            TL_Storage_Counts(iLog);
+            if (LogInfo[iLog].ulTotalRecordCount == 0) {
+                /* A log that has never had a record: we will just fill it
+                 * with some entries for testing purposes.
+                 */
+                TempTime.tm_year = 109;
+                TempTime.tm_mon = iLog + 1;     /* Different month for each log */
+                TempTime.tm_mday = 1;
+                TempTime.tm_hour = 0;
+                TempTime.tm_min = 0;
+                TempTime.tm_sec = 0;
+                TempTime.tm_isdst = -1;
+                tClock = mktime(&TempTime);
+
+                ulEntries = Trend_Log_Depth;
+                if (ulEntries > TL_MAX_ENTRIES)
+                    ulEntries = TL_MAX_ENTRIES;
+                /* as if 10000 records have been logged */
+                Storage->Purge(iLog, 10000 - ulEntries);
+                for (iEntry = 0; iEntry < ulEntries; iEntry++) {
+                    TempRec.tTimeStamp = tClock;
+                    TempRec.ucRecType = TL_TYPE_REAL;
+                    TempRec.Datum.fReal =
+                        (float) (iEntry + (iLog * ulEntries));
+                    /* Put status flags with every second log */
+                    if ((iLog & 1) == 0)
+                        TempRec.ucStatus = 128;
+                    else
+                        TempRec.ucStatus = 0;
+                    Storage->Append(iLog, &TempRec);
+                    tClock += 900;      /* advance 15 minutes */
+                }
+                TL_Storage_Counts(iLog);
+                LogInfo[iLog].tLastDataTime = tClock - 900;
+            } else {
+                /* The records were kept over the reset, but readings may
+                 * have been missed while we were down.
+                 */
+                if ((LogInfo[iLog].ulRecordCount > 0) &&
+                    TL_Record(iLog, LogInfo[iLog].ulRecordCount, &TempRec))
+                    LogInfo[iLog].tLastDataTime = TempRec.tTimeStamp;
+                TL_Find_Unordered(iLog);
+                TL_Insert_Status_Rec(iLog, LOG_STATUS_LOG_INTERRUPTED, true);
             }
 
-            LogInfo[iLog].tLastDataTime = tClock - 900;
             LogInfo[iLog].bAlignIntervals = true;
             LogInfo[iLog].bEnable = true;
             LogInfo[iLog].bStopWhenFull = false;
@@ -224,10 +936,10 @@ void Trend_Log_Init(
             LogInfo[iLog].Source.arrayIndex = 0;
             LogInfo[iLog].ucTimeFlags = 0;
             LogInfo[iLog].ulIntervalOffset = 0;
-            LogInfo[iLog].iIndex = 0;
             LogInfo[iLog].ulLogInterval = 900;
-            LogInfo[iLog].ulRecordCount = TL_MAX_ENTRIES;
-            LogInfo[iLog].ulTotalRecordCount = 10000;
+            LogInfo[iLog].bClientCOVIncrement = false;
+            LogInfo[iLog].fClientCOVIncrement = 0.0f;
+            LogInfo[iLog].ulCOVResubscriptionInterval = 0;
 
             LogInfo[iLog].Source.deviceIndentifier.instance =
                 Device_Object_Instance_Number();
@@ -246,6 +958,9 @@ void Trend_Log_Init(
             LogInfo[iLog].tStopTime =
                 TL_BAC_Time_To_Local(&LogInfo[iLog].StopTime);
         }
+        TL_COV_Index();
+        Device_COV_Listener_Set(TL_COV_Changed);
+        TL_Schedule_All(time(NULL) - 1);
     }
 
     return;
@@ -264,7 +979,7 @@ bool Trend_Log_Object_Name(
     static char text_string[32] = "";   /* okay for single thread */
     bool status = false;
 
-    if (object_instance < MAX_TREND_LOGS) {
+    if (object_instance < Trend_Log_Instances) {
         sprintf(text_string, "Trend Log %u", object_instance);
         status = characterstring_init_ansi(object_name, text_string);
     }
@@ -322,7 +1037,7 @@ int Trend_Log_Read_Property(
             break;
 
         case PROP_BUFFER_SIZE:
-            apdu_len = encode_application_unsigned(&apdu[0], TL_MAX_ENTRIES);
+            apdu_len = encode_application_unsigned(&apdu[0], Trend_Log_Depth);
             break;
 
         case PROP_LOG_BUFFER:
@@ -409,6 +1124,21 @@ int Trend_Log_Read_Property(
                 CurrentLog->ulLogInterval * 100);
             break;
 
+        case PROP_COV_RESUBSCRIPTION_INTERVAL:
+            apdu_len =
+                encode_application_unsigned(&apdu[0],
+                CurrentLog->ulCOVResubscriptionInterval);
+            break;
+
+        case PROP_CLIENT_COV_INCREMENT:
+            if (CurrentLog->bClientCOVIncrement)
+                apdu_len =
+                    encode_application_real(&apdu[0],
+                    CurrentLog->fClientCOVIncrement);
+            else
+                apdu_len = encode_application_null(&apdu[0]);
+            break;
+
         case PROP_ALIGN_INTERVALS:
             apdu_len =
                 encode_application_boolean(&apdu[0],
@@ -488,7 +1218,7 @@ bool Trend_Log_Write_Property(
                 /* Section 12.25.5 can't enable a full log with stop when full set */
                 if ((CurrentLog->bEnable == false) &&
                     (CurrentLog->bStopWhenFull == true) &&
-                    (CurrentLog->ulRecordCount == TL_MAX_ENTRIES) &&
+                    (CurrentLog->ulRecordCount == Trend_Log_Depth) &&
                     (value.type.Boolean == true)) {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_OBJECT;
@@ -515,6 +1245,10 @@ bool Trend_Log_Write_Property(
                              */
                             TL_Insert_Status_Rec(log_index,
                                 LOG_STATUS_LOG_DISABLED, false);
+                            if (CurrentLog->LoggingType == LOGGING_TYPE_COV) {
+                                /* start again from the value as it is */
+                                TL_COV_Log(log_index, true);
+                            }
                         }
                     }
                 }
@@ -531,7 +1265,7 @@ bool Trend_Log_Write_Property(
                     CurrentLog->bStopWhenFull = value.type.Boolean;
 
                     if ((value.type.Boolean == true) &&
-                        (CurrentLog->ulRecordCount == TL_MAX_ENTRIES) &&
+                        (CurrentLog->ulRecordCount == Trend_Log_Depth) &&
                         (CurrentLog->bEnable == true)) {
 
                         /* When full log is switched from normal to stop when full
@@ -561,8 +1295,7 @@ bool Trend_Log_Write_Property(
             if (status) {
                 if (value.type.Unsigned_Int == 0) {
                     /* Time to clear down the log */
-                    CurrentLog->ulRecordCount = 0;
-                    CurrentLog->iIndex = 0;
+                    TL_Purge(log_index);
                     TL_Insert_Status_Rec(log_index, LOG_STATUS_BUFFER_PURGED,
                         true);
                 }
@@ -579,6 +1312,8 @@ bool Trend_Log_Write_Property(
             if (status) {
                 if (value.type.Enumerated != LOGGING_TYPE_COV) {
                     CurrentLog->LoggingType = value.type.Enumerated;
+                    /* no longer logging on COV, if it was */
+                    TL_COV_Index();
                     if (value.type.Enumerated == LOGGING_TYPE_POLLED) {
                         /* As per 12.25.27 pick a suitable default if interval is 0 */
                         if (CurrentLog->ulLogInterval == 0) {
@@ -589,12 +1324,16 @@ bool Trend_Log_Write_Property(
                         /* As per 12.25.27 0 the interval if triggered logging selected */
                         CurrentLog->ulLogInterval = 0;
                     }
-                } else {
-                    /* We don't currently support COV */
+                } else if (!TL_COV_Supported(&CurrentLog->Source)) {
+                    /* We only support COV of local values */
                     status = false;
                     wp_data->error_class = ERROR_CLASS_PROPERTY;
                     wp_data->error_code =
                         ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
+                } else if (CurrentLog->LoggingType != LOGGING_TYPE_COV) {
+                    CurrentLog->LoggingType = LOGGING_TYPE_COV;
+                    CurrentLog->ulLogInterval = 0;
+                    TL_COV_Subscribe(log_index);
                 }
             }
             break;
@@ -720,16 +1459,27 @@ bool Trend_Log_Write_Property(
                     break;
                     }
 
+            /* A COV log can only log what can be logged on COV */
+            if ((CurrentLog->LoggingType == LOGGING_TYPE_COV) &&
+                !TL_COV_Supported(&TempSource)) {
+                wp_data->error_class = ERROR_CLASS_PROPERTY;
+                wp_data->error_code =
+                    ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
+                break;
+            }
+
             /* Quick comparison if structures are packed ... */
             if (memcmp(&TempSource, &CurrentLog->Source,
                     sizeof(BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE)) != 0) {
                 /* Clear buffer if property being logged is changed */
-                CurrentLog->ulRecordCount = 0;
-                CurrentLog->iIndex = 0;
+                TL_Purge(log_index);
                 TL_Insert_Status_Rec(log_index, LOG_STATUS_BUFFER_PURGED,
                     true);
+                CurrentLog->Source = TempSource;
+                if (CurrentLog->LoggingType == LOGGING_TYPE_COV) {
+                    TL_COV_Subscribe(log_index);
+                }
             }
-            CurrentLog->Source = TempSource;
             status = true;
             break;
 
@@ -746,12 +1496,28 @@ bool Trend_Log_Write_Property(
             if (status) {
                 if ((CurrentLog->LoggingType == LOGGING_TYPE_POLLED) &&
                     (value.type.Unsigned_Int == 0)) {
-                    /* We don't support COV at the moment so don't allow switching
-                     * to it by clearing interval whilst in polling mode */
-                    wp_data->error_class = ERROR_CLASS_PROPERTY;
-                    wp_data->error_code =
-                        ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
-                    status = false;
+                    /* Clearing the interval whilst in polling mode switches
+                     * to COV, if the value can be logged on COV */
+                    if (TL_COV_Supported(&CurrentLog->Source)) {
+                        CurrentLog->LoggingType = LOGGING_TYPE_COV;
+                        CurrentLog->ulLogInterval = 0;
+                        TL_COV_Subscribe(log_index);
+                    } else {
+                        wp_data->error_class = ERROR_CLASS_PROPERTY;
+                        wp_data->error_code =
+                            ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
+                        status = false;
+                    }
+                } else if (CurrentLog->LoggingType == LOGGING_TYPE_COV) {
+                    /* and setting it whilst in COV mode switches back */
+                    if (value.type.Unsigned_Int != 0) {
+                        CurrentLog->LoggingType = LOGGING_TYPE_POLLED;
+                        TL_COV_Index();
+                        CurrentLog->ulLogInterval =
+                            value.type.Unsigned_Int / 100;
+                        if (0 == CurrentLog->ulLogInterval)
+                            CurrentLog->ulLogInterval = 1;
+                    }
                 } else {
                     /* We only log to 1 sec accuracy so must divide by 100 before passing it on */
                     CurrentLog->ulLogInterval = value.type.Unsigned_Int / 100;
@@ -761,6 +1527,42 @@ bool Trend_Log_Write_Property(
             }
             break;
 
+        case PROP_COV_RESUBSCRIPTION_INTERVAL:
+            /* A subscription to a local object does not lapse, but keep
+             * the interval for the clients that set it */
+            status =
+                WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+            if (status) {
+                CurrentLog->ulCOVResubscriptionInterval =
+                    value.type.Unsigned_Int;
+            }
+            break;
+
+        case PROP_CLIENT_COV_INCREMENT:
+            if (value.tag == BACNET_APPLICATION_TAG_NULL) {
+                CurrentLog->bClientCOVIncrement = false;
+                CurrentLog->fClientCOVIncrement = 0.0f;
+                status = true;
+            } else {
+                status =
+                    WPValidateArgType(&value, BACNET_APPLICATION_TAG_REAL,
+                    &wp_data->error_class, &wp_data->error_code);
+                if (status && !(value.type.Real >= 0.0f)) {
+                    wp_data->error_class = ERROR_CLASS_PROPERTY;
+                    wp_data->error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+                    status = false;
+                }
+                if (status) {
+                    CurrentLog->bClientCOVIncrement = true;
+                    CurrentLog->fClientCOVIncrement = value.type.Real;
+                }
+            }
+            if (status && (CurrentLog->LoggingType == LOGGING_TYPE_COV)) {
+                TL_COV_Increment(log_index);
+            }
+            break;
+
         case PROP_ALIGN_INTERVALS:
             status =
                 WPValidateArgType(&value, BACNET_APPLICATION_TAG_BOOLEAN,
@@ -806,6 +1608,8 @@ bool Trend_Log_Write_Property(
             wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
             break;
     }
+    if (status)
+        TL_Schedule(log_index);
 
     return status;
 }
@@ -817,7 +1621,7 @@ bool TrendLogGetRRInfo(
     int log_index;
 
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
-    if (log_index >= MAX_TREND_LOGS) {
+    if (log_index >= (int) Trend_Log_Instances) {
         pRequest->error_class = ERROR_CLASS_OBJECT;
         pRequest->error_code = ERROR_CODE_UNKNOWN_OBJECT;
     } else if (pRequest->object_property == PROP_LOG_BUFFER) {
@@ -844,11 +1648,8 @@ void TL_Insert_Status_Rec(
     BACNET_LOG_STATUS eStatus,
     bool bState)
 {
-    TL_LOG_INFO *CurrentLog;
     TL_DATA_REC TempRec;
 
-    CurrentLog = &LogInfo[iLog];
-
     TempRec.tTimeStamp = time(NULL);
     TempRec.ucRecType = TL_TYPE_STATUS;
     TempRec.ucStatus = 0;
@@ -871,26 +1672,20 @@ void TL_Insert_Status_Rec(
             break;
     }
 
-    Logs[iLog][CurrentLog->iIndex++] = TempRec;
-    if (CurrentLog->iIndex >= TL_MAX_ENTRIES)
-        CurrentLog->iIndex = 0;
-
-    CurrentLog->ulTotalRecordCount++;
-
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES)
-        CurrentLog->ulRecordCount++;
+    TL_Append(iLog, &TempRec);
 }
 
 /*****************************************************************************
  * Use the combination of the enable flag and the enable times to determine  *
- * if the log is really enabled now. See 135-2008 sections 12.25.5 - 12.25.7 *
+ * if the log is really enabled at a time. See 135-2008 sections 12.25.5 -   *
+ * 12.25.7                                                                   *
  *****************************************************************************/
 
-bool TL_Is_Enabled(
-    int iLog)
+static bool TL_Is_Enabled_At(
+    int iLog,
+    time_t tNow)
 {
     TL_LOG_INFO *CurrentLog;
-    time_t tNow;
     bool bStatus;
 
     bStatus = true;
@@ -910,7 +1705,6 @@ bool TL_Is_Enabled(
         bStatus = false;
     } else if (CurrentLog->ucTimeFlags != (TL_T_START_WILD | TL_T_STOP_WILD)) {
         /* enabled and either 1 wild card or none */
-        tNow = time(NULL);
 #if 0
         printf("\nFlags - %u, Current - %u, Start - %u, Stop - %u\n",
             (unsigned int) CurrentLog->ucTimeFlags, (unsigned int) Now,
@@ -941,6 +1735,13 @@ bool TL_Is_Enabled(
     return (bStatus);
 }
 
+/* Is the log enabled now */
+bool TL_Is_Enabled(
+    int iLog)
+{
+    return TL_Is_Enabled_At(iLog, time(NULL));
+}
+
 /*****************************************************************************
  * Convert a BACnet time into a local time in seconds since the local epoch  *
  *****************************************************************************/
@@ -969,6 +1770,8 @@ time_t TL_BAC_Time_To_Local(
     LocalTime.tm_hour = SourceTime->time.hour;
     LocalTime.tm_min = SourceTime->time.min;
     LocalTime.tm_sec = SourceTime->time.sec;
+    /* Let the library work out if daylight saving applies */
+    LocalTime.tm_isdst = -1;
 
     return (mktime(&LocalTime));
 }
@@ -1069,7 +1872,7 @@ int TL_encode_by_position(
     uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->MaxApdu - pRequest->Overhead;
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentLog = &LogInfo[log_index];
     if (pRequest->RequestType == RR_READ_ALL) {
@@ -1179,7 +1982,7 @@ int TL_encode_by_sequence(
     bool bWrapLog = false;      /* Has log sequence range spanned the max for uint32_t? */
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->MaxApdu - pRequest->Overhead;
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentLog = &LogInfo[log_index];
     /* Figure out the sequence number for the first record, last is ulTotalRecordCount */
@@ -1309,35 +2112,43 @@ int TL_encode_by_time(
     uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
     uint32_t uiFirstSeq = 0;    /* Sequence number for 1st record in log */
     time_t tRefTime = 0;        /* The time from the request in local format */
+    TL_DATA_REC Record;
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->MaxApdu - pRequest->Overhead;
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentLog = &LogInfo[log_index];
 
     tRefTime = TL_BAC_Time_To_Local(&pRequest->Range.RefTime);
-    /* Find correct position for oldest entry in log */
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES)
-        uiIndex = 0;
-    else
-        uiIndex = CurrentLog->iIndex;
 
     if (pRequest->Count < 0) {
-        /* Start at end of log and look for record which has
-         * timestamp greater than or equal to the reference.
-         */
-        iCount = CurrentLog->ulRecordCount - 1;
-        /* Start out with the sequence number for the last record */
-        uiFirstSeq = CurrentLog->ulTotalRecordCount;
-        for (;;) {
-            if (Logs[pRequest->object_instance][(uiIndex +
-                        iCount) % TL_MAX_ENTRIES].tTimeStamp < tRefTime)
-                break;
-
-            uiFirstSeq--;
-            iCount--;
+        if (TL_Ordered(log_index)) {
+            /* The last record with a timestamp less than the reference
+             * is the one before the first that is not.
+             */
+            iCount = TL_Time_Search(log_index, tRefTime, true) - 2;
             if (iCount < 0)
                 return (0);
+            uiFirstSeq =
+                CurrentLog->ulTotalRecordCount - (CurrentLog->ulRecordCount -
+                1) + iCount;
+        } else {
+            /* Start at end of log and look for record which has
+             * timestamp less than the reference.
+             */
+            iCount = CurrentLog->ulRecordCount - 1;
+            /* Start out with the sequence number for the last record */
+            uiFirstSeq = CurrentLog->ulTotalRecordCount;
+            for (;;) {
+                if (TL_Record(log_index, iCount + 1, &Record) &&
+                    (Record.tTimeStamp < tRefTime))
+                    break;
+
+                uiFirstSeq--;
+                iCount--;
+                if (iCount < 0)
+                    return (0);
+            }
         }
 
         /* We have an and point for our request,
@@ -1367,15 +2178,22 @@ int TL_encode_by_time(
         /* Figure out the sequence number for the first record, last is ulTotalRecordCount */
         uiFirstSeq =
             CurrentLog->ulTotalRecordCount - (CurrentLog->ulRecordCount - 1);
-        for (;;) {
-            if (Logs[pRequest->object_instance][(uiIndex +
-                        iCount) % TL_MAX_ENTRIES].tTimeStamp > tRefTime)
-                break;
-
-            uiFirstSeq++;
-            iCount++;
+        if (TL_Ordered(log_index)) {
+            iCount = TL_Time_Search(log_index, tRefTime, false) - 1;
             if ((uint32_t) iCount == CurrentLog->ulRecordCount)
                 return (0);
+            uiFirstSeq += iCount;
+        } else {
+            for (;;) {
+                if (TL_Record(log_index, iCount + 1, &Record) &&
+                    (Record.tTimeStamp > tRefTime))
+                    break;
+
+                uiFirstSeq++;
+                iCount++;
+                if ((uint32_t) iCount == CurrentLog->ulRecordCount)
+                    return (0);
+            }
         }
     }
 
@@ -1428,19 +2246,15 @@ int TL_encode_entry(
     int iEntry)
 {
     int iLen = 0;
-    TL_DATA_REC *pSource = NULL;
+    TL_DATA_REC Record;
+    TL_DATA_REC *pSource = &Record;
     BACNET_BIT_STRING TempBits;
     uint8_t ucCount = 0;
     BACNET_DATE_TIME TempTime;
 
-    /* Convert from BACnet 1 based to 0 based array index and then
-     * handle wrap around of the circular buffer */
-
-    if (LogInfo[iLog].ulRecordCount < TL_MAX_ENTRIES)
-        pSource = &Logs[iLog][(iEntry - 1) % TL_MAX_ENTRIES];
-    else
-        pSource =
-            &Logs[iLog][(LogInfo[iLog].iIndex + iEntry - 1) % TL_MAX_ENTRIES];
+    /* Fetch the entry at the BACnet 1 based position from the storage */
+    if (!TL_Record(iLog, iEntry, &Record))
+        return 0;
 
     iLen = 0;
     /* First stick the time stamp in with tag [0] */
@@ -1590,19 +2404,44 @@ static int local_read_property(
     return (len);
 }
 
+/* Get the logged property and status flags straight from the object, if
+ * the object can give them without encoding them for a ReadProperty.
+ */
+static bool TL_Value_Get(
+    BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE * Source,
+    TL_DATA_REC * record)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+
+    if (Source->arrayIndex != BACNET_ARRAY_ALL)
+        return false;
+    if (!Device_Value_Get(Source->objectIdentifier.type,
+            Source->objectIdentifier.instance, PROP_STATUS_FLAGS, &value) ||
+        (value.tag != BACNET_APPLICATION_TAG_BIT_STRING))
+        return false;
+    record->ucStatus = 128 | bitstring_octet(&value.type.Bit_String, 0);
+    if (!Device_Value_Get(Source->objectIdentifier.type,
+            Source->objectIdentifier.instance, Source->propertyIdentifier,
+            &value))
+        return false;
+    TL_Value_To_Record(&value, record);
+
+    return true;
+}
+
 /****************************************************************************
  * Attempt to fetch the logged property and store it in the Trend Log       *
  ****************************************************************************/
 
-void TL_fetch_property(
-    int iLog)
+static void TL_Fetch_Property_At(
+    int iLog,
+    time_t tNow)
 {
     uint8_t ValueBuf[MAX_APDU]; /* This is a big buffer in case someone selects the device object list for example */
     uint8_t StatusBuf[3];       /* Should be tag, bits unused in last octet and 1 byte of data */
     BACNET_ERROR_CLASS error_class = ERROR_CLASS_SERVICES;
     BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER;
     int iLen;
-    uint8_t ucCount;
     TL_LOG_INFO *CurrentLog;
     TL_DATA_REC TempRec;
     uint8_t tag_number = 0;
@@ -1613,10 +2452,15 @@ void TL_fetch_property(
 
     /* Record the current time in the log entry and also in the info block
      * for the log so we can figure out when the next reading is due */
-    TempRec.tTimeStamp = time(NULL);
+    TempRec.tTimeStamp = tNow;
     CurrentLog->tLastDataTime = TempRec.tTimeStamp;
     TempRec.ucStatus = 0;
 
+    if (TL_Value_Get(&CurrentLog->Source, &TempRec)) {
+        TL_Append(iLog, &TempRec);
+        return;
+    }
+    TempRec.ucStatus = 0;
     iLen =
         local_read_property(ValueBuf, StatusBuf, &LogInfo[iLog].Source,
         &error_class, &error_code);
@@ -1659,27 +2503,9 @@ void TL_fetch_property(
                 break;
 
             case BACNET_APPLICATION_TAG_BIT_STRING:
-                TempRec.ucRecType = TL_TYPE_BITS;
                 decode_bitstring(&ValueBuf[iLen], len_value_type, &TempBits);
                 /* We truncate any bitstrings at 32 bits to conserve space */
-                if (bitstring_bits_used(&TempBits) < 32) {
-                    /* Store the bytes used and the bits free in the last byte */
-                    TempRec.Datum.Bits.ucLen =
-                        bitstring_bytes_used(&TempBits) << 4;
-                    TempRec.Datum.Bits.ucLen |=
-                        (8 - (bitstring_bits_used(&TempBits) % 8)) & 7;
-                    /* Fetch the octets with the bits directly */
-                    for (ucCount = 0;
-                        ucCount < bitstring_bytes_used(&TempBits); ucCount++)
-                        TempRec.Datum.Bits.ucStore[ucCount] =
-                            bitstring_octet(&TempBits, ucCount);
-                } else {
-                    /* We will only use the first 4 octets to save space */
-                    TempRec.Datum.Bits.ucLen = 4 << 4;
-                    for (ucCount = 0; ucCount < 4; ucCount++)
-                        TempRec.Datum.Bits.ucStore[ucCount] =
-                            bitstring_octet(&TempBits, ucCount);
-                }
+                TL_Bits_To_Record(&TempBits, &TempRec);
                 break;
 
             case BACNET_APPLICATION_TAG_ENUMERATED:
@@ -1703,82 +2529,1093 @@ void TL_fetch_property(
         TempRec.ucStatus = 128 | bitstring_octet(&TempBits, 0);
     }
 
-    Logs[iLog][CurrentLog->iIndex++] = TempRec;
-    if (CurrentLog->iIndex >= TL_MAX_ENTRIES)
-        CurrentLog->iIndex = 0;
+    TL_Append(iLog, &TempRec);
+}
+
+void TL_fetch_property(
+    int iLog)
+{
+    TL_Fetch_Property_At(iLog, time(NULL));
+}
 
-    CurrentLog->ulTotalRecordCount++;
+/* Take a reading of a log if one is due at tNow */
+static void TL_Poll(
+    int iLog,
+    time_t tNow)
+{
+    TL_LOG_INFO *CurrentLog = &LogInfo[iLog];
+
+    if (TL_Is_Enabled_At(iLog, tNow)) {
+        if (CurrentLog->LoggingType == LOGGING_TYPE_POLLED) {
+            /* For polled logs we first need to see if they are clock
+             * aligned or not.
+             */
+            if (CurrentLog->bAlignIntervals == true) {
+                /* Aligned logging so use the combination of the interval
+                 * and the offset to decide when to log. Also log a reading if
+                 * more than interval time has elapsed since last reading to ensure
+                 * we don't miss a reading if we aren't called at the precise second
+                 * when the match occurrs.
+                 */
+                if ((tNow % CurrentLog->ulLogInterval) ==
+                    (CurrentLog->ulIntervalOffset %
+                        CurrentLog->ulLogInterval)) {
+                    /* Record value if time synchronised trigger condition is met
+                     * and at least one period has elapsed.
+                     */
+                    TL_Fetch_Property_At(iLog, tNow);
+                } else if ((tNow - CurrentLog->tLastDataTime) >
+                    CurrentLog->ulLogInterval) {
+                    /* Also record value if we have waited more than a period
+                     * since the last reading. This ensures we take a reading as
+                     * soon as possible after a power down if we have been off for
+                     * more than a single period.
+                     */
+                    TL_Fetch_Property_At(iLog, tNow);
+                }
+            } else if (((tNow - CurrentLog->tLastDataTime) >=
+                    CurrentLog->ulLogInterval) ||
+                (CurrentLog->bTrigger == true)) {
+                /* If not aligned take a reading when we have either waited long
+                 * enough or a trigger is set.
+                 */
+                TL_Fetch_Property_At(iLog, tNow);
+            }
 
-    if (CurrentLog->ulRecordCount < TL_MAX_ENTRIES)
-        CurrentLog->ulRecordCount++;
+            CurrentLog->bTrigger = false;       /* Clear this every time */
+        } else if (CurrentLog->LoggingType == LOGGING_TYPE_TRIGGERED) {
+            /* Triggered logs take a reading when the trigger is set and
+             * then reset the trigger to wait for the next event
+             */
+            if (CurrentLog->bTrigger == true) {
+                TL_Fetch_Property_At(iLog, tNow);
+                CurrentLog->bTrigger = false;
+            }
+        }
+    }
+}
+
+/* Turn the wheel to tNow, and look at the logs that have come due on
+   the way; if the clock has jumped, schedule all the logs again */
+static void TL_Timer_Run(
+    time_t tNow)
+{
+    int iSlot;
+    int iLog;
+
+    if ((tNow < TL_Wheel_Time) || ((tNow - TL_Wheel_Time) > TL_WHEEL_CATCH_UP))
+        TL_Schedule_All(tNow - 1);
+    while (TL_Wheel_Time < tNow) {
+        TL_Wheel_Time++;
+        if ((TL_Wheel_Time & ((1 << TL_WHEEL_SPAN_SHIFT) - 1)) == 0)
+            TL_Wheel_Cascade(TL_WHEEL_SECONDS + TL_WHEEL_BLOCKS +
+                (int) ((TL_Wheel_Time >> TL_WHEEL_SPAN_SHIFT) &
+                    (TL_WHEEL_SPANS - 1)));
+        if ((TL_Wheel_Time & (TL_WHEEL_SECONDS - 1)) == 0)
+            TL_Wheel_Cascade(TL_WHEEL_SECONDS +
+                (int) ((TL_Wheel_Time >> TL_WHEEL_BLOCK_SHIFT) &
+                    (TL_WHEEL_BLOCKS - 1)));
+        iSlot = (int) (TL_Wheel_Time & (TL_WHEEL_SECONDS - 1));
+        while (TL_Wheel[iSlot] >= 0) {
+            iLog = TL_Wheel[iSlot];
+            TL_Wheel_Remove(iLog);
+            LogInfo[iLog].iDueSlot = TL_WHEEL_DUE;
+            LogInfo[iLog].iNextDue = TL_Wheel[TL_WHEEL_DUE];
+            if (LogInfo[iLog].iNextDue >= 0)
+                LogInfo[LogInfo[iLog].iNextDue].iPrevDue = iLog;
+            TL_Wheel[TL_WHEEL_DUE] = iLog;
+        }
+    }
+    while (TL_Wheel[TL_WHEEL_DUE] >= 0) {
+        iLog = TL_Wheel[TL_WHEEL_DUE];
+        TL_Wheel_Remove(iLog);
+        TL_Poll(iLog, tNow);
+        TL_Schedule(iLog);
+    }
 }
 
 /****************************************************************************
- * Check each log to see if any data needs to be recorded.                  *
+ * Take the readings of the logs that are due. The logs wait in the timer   *
+ * wheel, so only those that are due are looked at each second.             *
  ****************************************************************************/
 
 void trend_log_timer(
     uint16_t uSeconds)
 {
-    TL_LOG_INFO *CurrentLog = NULL;
-    int iCount = 0;
-    time_t tNow = 0;
-
     /* unused parameter */
     uSeconds = uSeconds;
+    if (LogInfo == NULL)
+        return;
     /* use OS to get the current time */
-    tNow = time(NULL);
-    for (iCount = 0; iCount < MAX_TREND_LOGS; iCount++) {
-        CurrentLog = &LogInfo[iCount];
-        if (TL_Is_Enabled(iCount)) {
-            if (CurrentLog->LoggingType == LOGGING_TYPE_POLLED) {
-                /* For polled logs we first need to see if they are clock
-                 * aligned or not.
-                 */
-                if (CurrentLog->bAlignIntervals == true) {
-                    /* Aligned logging so use the combination of the interval
-                     * and the offset to decide when to log. Also log a reading if
-                     * more than interval time has elapsed since last reading to ensure
-                     * we don't miss a reading if we aren't called at the precise second
-                     * when the match occurrs.
-                     */
-/*                if(((tNow % CurrentLog->ulLogInterval) >= (CurrentLog->ulIntervalOffset % CurrentLog->ulLogInterval)) && */
-/*                   ((tNow - CurrentLog->tLastDataTime) >= CurrentLog->ulLogInterval)) { */
-                    if ((tNow % CurrentLog->ulLogInterval) ==
-                        (CurrentLog->ulIntervalOffset %
-                            CurrentLog->ulLogInterval)) {
-                        /* Record value if time synchronised trigger condition is met
-                         * and at least one period has elapsed.
-                         */
-                        TL_fetch_property(iCount);
-                    } else if ((tNow - CurrentLog->tLastDataTime) >
-                        CurrentLog->ulLogInterval) {
-                        /* Also record value if we have waited more than a period
-                         * since the last reading. This ensures we take a reading as
-                         * soon as possible after a power down if we have been off for
-                         * more than a single period.
-                         */
-                        TL_fetch_property(iCount);
-                    }
-                } else if (((tNow - CurrentLog->tLastDataTime) >=
-                        CurrentLog->ulLogInterval) ||
-                    (CurrentLog->bTrigger == true)) {
-                    /* If not aligned take a reading when we have either waited long
-                     * enough or a trigger is set.
-                     */
-                    TL_fetch_property(iCount);
-                }
+    TL_Timer_Run(time(NULL));
+}
 
-                CurrentLog->bTrigger = false;   /* Clear this every time */
-            } else if (CurrentLog->LoggingType == LOGGING_TYPE_TRIGGERED) {
-                /* Triggered logs take a reading when the trigger is set and
-                 * then reset the trigger to wait for the next event
-                 */
-                if (CurrentLog->bTrigger == true) {
-                    TL_fetch_property(iCount);
-                    CurrentLog->bTrigger = false;
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include "ctest.h"
+#include "tlpack.h"
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    if (pValue->tag != ucExpectedTag) {
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 123;
+}
+
+/* Analog Inputs with a COV Value List, as the Device object has them */
+static float Test_Present_Value[2];
+static bool Test_Out_Of_Service[2];
+static object_cov_listener_function Test_COV_Listener;
+/* whether they give their values without encoding them */
+static bool Test_Value_Get = true;
+
+static bool testTrendLogValue(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    if ((object_type != OBJECT_ANALOG_INPUT) || (object_instance > 1)) {
+        return false;
+    }
+    value->context_specific = false;
+    value->next = NULL;
+    switch (object_property) {
+        case PROP_PRESENT_VALUE:
+            value->tag = BACNET_APPLICATION_TAG_REAL;
+            value->type.Real = Test_Present_Value[object_instance];
+            break;
+        case PROP_STATUS_FLAGS:
+            value->tag = BACNET_APPLICATION_TAG_BIT_STRING;
+            bitstring_init(&value->type.Bit_String);
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_IN_ALARM,
+                false);
+            bitstring_set_bit(&value->type.Bit_String, STATUS_FLAG_FAULT,
+                false);
+            bitstring_set_bit(&value->type.Bit_String,
+                STATUS_FLAG_OVERRIDDEN, false);
+            bitstring_set_bit(&value->type.Bit_String,
+                STATUS_FLAG_OUT_OF_SERVICE,
+                Test_Out_Of_Service[object_instance]);
+            break;
+        case PROP_COV_INCREMENT:
+            value->tag = BACNET_APPLICATION_TAG_REAL;
+            value->type.Real = 1.0f;
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+int Device_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+
+    if (!testTrendLogValue(rpdata->object_type, rpdata->object_instance,
+            rpdata->object_property, &value)) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return -1;
+    }
+
+    return bacapp_encode_application_data(rpdata->application_data, &value);
+}
+
+bool Device_Value_Get(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    if (!Test_Value_Get) {
+        return false;
+    }
+
+    return testTrendLogValue(object_type, object_instance, object_property,
+        value);
+}
+
+bool Device_Value_List_Supported(
+    BACNET_OBJECT_TYPE object_type)
+{
+    return object_type == OBJECT_ANALOG_INPUT;
+}
+
+bool Device_Encode_Value_List(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_VALUE * value_list)
+{
+    if ((object_type != OBJECT_ANALOG_INPUT) || (object_instance > 1)) {
+        return false;
+    }
+    value_list->value.tag = BACNET_APPLICATION_TAG_REAL;
+    value_list->value.type.Real = Test_Present_Value[object_instance];
+    value_list = value_list->next;
+    value_list->value.tag = BACNET_APPLICATION_TAG_BIT_STRING;
+    bitstring_init(&value_list->value.type.Bit_String);
+    bitstring_set_bit(&value_list->value.type.Bit_String,
+        STATUS_FLAG_OUT_OF_SERVICE, Test_Out_Of_Service[object_instance]);
+
+    return false;
+}
+
+void Device_COV_Listener_Set(
+    object_cov_listener_function pFunction)
+{
+    Test_COV_Listener = pFunction;
+}
+
+/* fill a log with records a few seconds apart, some with the same time */
+static void testTrendLogFill(
+    int iLog,
+    uint32_t ulRecords,
+    time_t tStart)
+{
+    TL_DATA_REC Record;
+    uint32_t ulCount;
+
+    TL_Purge(iLog);
+    LogInfo[iLog].ulUnorderedSeq = 0;
+    memset(&Record, 0, sizeof(Record));
+    Record.ucRecType = TL_TYPE_UNSIGN;
+    Record.tTimeStamp = tStart;
+    for (ulCount = 0; ulCount < ulRecords; ulCount++) {
+        Record.tTimeStamp += ulCount % 3;
+        Record.Datum.ulUValue = ulCount;
+        TL_Append(iLog, &Record);
+    }
+}
+
+/* ReadRange by time of a log, as it was found before by stepping
+   through the records one by one */
+static int testTrendLogByTime(
+    uint8_t * apdu,
+    BACNET_READ_RANGE_DATA * pRequest,
+    int iLog,
+    time_t tRefTime,
+    int32_t lCount,
+    bool bStep)
+{
+    uint32_t ulUnorderedSeq = LogInfo[iLog].ulUnorderedSeq;
+    int iLen;
+
+    memset(pRequest, 0, sizeof(BACNET_READ_RANGE_DATA));
+    pRequest->object_type = OBJECT_TRENDLOG;
+    pRequest->object_instance = iLog;
+    pRequest->object_property = PROP_LOG_BUFFER;
+    pRequest->array_index = BACNET_ARRAY_ALL;
+    pRequest->RequestType = RR_BY_TIME;
+    pRequest->MaxApdu = MAX_APDU;
+    pRequest->Overhead = RR_OVERHEAD;
+    pRequest->Count = lCount;
+    bitstring_init(&pRequest->ResultFlags);
+    TL_Local_Time_To_BAC(&pRequest->Range.RefTime, tRefTime);
+    if (bStep)
+        LogInfo[iLog].ulUnorderedSeq = LogInfo[iLog].ulTotalRecordCount;
+    iLen = TL_encode_by_time(apdu, pRequest);
+    LogInfo[iLog].ulUnorderedSeq = ulUnorderedSeq;
+
+    return iLen;
+}
+
+static bool testTrendLogSame(
+    int iLog,
+    time_t tRefTime,
+    int32_t lCount)
+{
+    uint8_t apdu[MAX_APDU];
+    uint8_t step_apdu[MAX_APDU];
+    BACNET_READ_RANGE_DATA Request;
+    BACNET_READ_RANGE_DATA StepRequest;
+    int iLen;
+    int iStepLen;
+
+    iLen = testTrendLogByTime(apdu, &Request, iLog, tRefTime, lCount, false);
+    iStepLen =
+        testTrendLogByTime(step_apdu, &StepRequest, iLog, tRefTime, lCount,
+        true);
+
+    return (iLen == iStepLen) && (memcmp(apdu, step_apdu, iLen) == 0) &&
+        (Request.ItemCount == StepRequest.ItemCount) &&
+        (Request.FirstSequence == StepRequest.FirstSequence) &&
+        (Request.Count == StepRequest.Count) &&
+        bitstring_same(&Request.ResultFlags, &StepRequest.ResultFlags);
+}
+
+/* a storage that cannot be opened */
+static bool testTrendLogOpenFails(
+    unsigned logs,
+    uint32_t depth)
+{
+    (void) logs;
+    (void) depth;
+
+    return false;
+}
+
+static const TL_STORAGE Test_Closed_Storage = {
+    testTrendLogOpenFails, NULL, NULL, NULL, NULL, NULL
+};
+
+void testTrendLog(
+    Test * pTest)
+{
+    TL_DATA_REC Record;
+    time_t tStart = 1400000000;
+    time_t tRefTime;
+    unsigned uiFailures = 0;
+    uint32_t ulRecords;
+
+    ct_test(pTest, Trend_Log_Storage_Set(NULL, MAX_TREND_LOGS, 100));
+    Trend_Log_Init();
+    ct_test(pTest, Trend_Log_Count() == MAX_TREND_LOGS);
+    /* the demo data is in time order */
+    ct_test(pTest, TL_Ordered(0));
+    ct_test(pTest, LogInfo[0].ulRecordCount == 100);
+    ct_test(pTest, LogInfo[0].ulTotalRecordCount == 10000);
+
+    /* the search finds what stepping through the records finds,
+       in a log that has not wrapped and in one that has */
+    for (ulRecords = 0; ulRecords <= 250; ulRecords += 50) {
+        testTrendLogFill(1, ulRecords, tStart);
+        ct_test(pTest, TL_Ordered(1));
+        for (tRefTime = tStart - 2; tRefTime <= (tStart + 260); tRefTime++) {
+            if (!testTrendLogSame(1, tRefTime, 7) ||
+                !testTrendLogSame(1, tRefTime, -7) ||
+                !testTrendLogSame(1, tRefTime, 1000) ||
+                !testTrendLogSame(1, tRefTime, -1000)) {
+                uiFailures++;
+            }
+        }
+    }
+    ct_test(pTest, uiFailures == 0);
+
+    /* the clock is set back: the log is no longer in time order
+       until the record before that goes out of the log */
+    testTrendLogFill(1, 60, tStart);
+    memset(&Record, 0, sizeof(Record));
+    Record.ucRecType = TL_TYPE_STATUS;
+    Record.tTimeStamp = tStart;
+    TL_Append(1, &Record);
+    ct_test(pTest, !TL_Ordered(1));
+    /* ...as found when the records are kept over a reset */
+    ulRecords = LogInfo[1].ulUnorderedSeq;
+    TL_Find_Unordered(1);
+    ct_test(pTest, LogInfo[1].ulUnorderedSeq == ulRecords);
+    Record.tTimeStamp = tStart + 100;
+    for (ulRecords = 0; ulRecords < 98; ulRecords++) {
+        TL_Append(1, &Record);
+    }
+    ct_test(pTest, !TL_Ordered(1));
+    TL_Append(1, &Record);
+    ct_test(pTest, TL_Ordered(1));
+    /* a purge starts the order again */
+    testTrendLogFill(1, 60, tStart);
+    Record.tTimeStamp = tStart;
+    TL_Append(1, &Record);
+    ct_test(pTest, !TL_Ordered(1));
+    TL_Purge(1);
+    ct_test(pTest, TL_Ordered(1));
+
+    /* the storage is changed under logs that are in use: they are
+       set up again in it, rather than left counted but not there */
+    ct_test(pTest, Trend_Log_Storage_Set(NULL, 2, 50));
+    ct_test(pTest, Trend_Log_Count() == 2);
+    ct_test(pTest, Trend_Log_Valid_Instance(1));
+    ct_test(pTest, !Trend_Log_Valid_Instance(2));
+    ct_test(pTest, LogInfo[1].ulRecordCount == 50);
+    /* ...and if the storage cannot be opened, in RAM */
+    ct_test(pTest, !Trend_Log_Storage_Set(&Test_Closed_Storage, 2, 50));
+    ct_test(pTest, Trend_Log_Count() == MAX_TREND_LOGS);
+    ct_test(pTest,
+        LogInfo[MAX_TREND_LOGS - 1].ulRecordCount == TL_MAX_ENTRIES);
+}
+
+/* write a property of a log, encoded as a client would */
+static bool testTrendLogWrite(
+    int iLog,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+
+    memset(&wp_data, 0, sizeof(wp_data));
+    wp_data.object_type = OBJECT_TRENDLOG;
+    wp_data.object_instance = iLog;
+    wp_data.object_property = object_property;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.application_data_len =
+        bacapp_encode_application_data(wp_data.application_data, value);
+
+    return Trend_Log_Write_Property(&wp_data);
+}
+
+/* an Analog Input changes, and tells the Device object */
+static void testTrendLogChange(
+    uint32_t object_instance,
+    float fValue,
+    bool bOutOfService)
+{
+    Test_Present_Value[object_instance] = fValue;
+    Test_Out_Of_Service[object_instance] = bOutOfService;
+    if (Test_COV_Listener) {
+        Test_COV_Listener(OBJECT_ANALOG_INPUT, object_instance);
+    }
+}
+
+void testTrendLogCOV(
+    Test * pTest)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+    TL_DATA_REC Record;
+    int iLog = 3;
+    uint32_t ulTotal;
+
+    /* the demo logs start out polled and stopped by their stop time */
+    ct_test(pTest, Test_COV_Listener != NULL);
+    LogInfo[iLog].ucTimeFlags = TL_T_START_WILD | TL_T_STOP_WILD;
+    ct_test(pTest, TL_Is_Enabled(iLog));
+    ct_test(pTest, LogInfo[iLog].Source.objectIdentifier.type ==
+        OBJECT_ANALOG_INPUT);
+    LogInfo[iLog].Source.objectIdentifier.instance = 0;
+    Test_Present_Value[0] = 10.0f;
+
+    /* while polled, changes are not logged */
+    ulTotal = LogInfo[iLog].ulTotalRecordCount;
+    testTrendLogChange(0, 20.0f, false);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal);
+
+    /* logging on COV starts with the value as it is */
+    value.tag = BACNET_APPLICATION_TAG_ENUMERATED;
+    value.type.Enumerated = LOGGING_TYPE_COV;
+    ct_test(pTest, testTrendLogWrite(iLog, PROP_LOGGING_TYPE, &value));
+    ct_test(pTest, LogInfo[iLog].LoggingType == LOGGING_TYPE_COV);
+    ct_test(pTest, LogInfo[iLog].ulLogInterval == 0);
+    ct_test(pTest, LogInfo[iLog].fCOVIncrement == 1.0f);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 1);
+    ct_test(pTest, TL_Record(iLog, LogInfo[iLog].ulRecordCount, &Record));
+    ct_test(pTest, Record.ucRecType == TL_TYPE_REAL);
+    ct_test(pTest, Record.Datum.fReal == 20.0f);
+    ct_test(pTest, Record.ucStatus == 128);
+    /* changes less than the COV_Increment of the object are not logged */
+    testTrendLogChange(0, 20.5f, false);
+    testTrendLogChange(0, 19.5f, false);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 1);
+    testTrendLogChange(0, 21.0f, false);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 2);
+    ct_test(pTest, TL_Record(iLog, LogInfo[iLog].ulRecordCount, &Record));
+    ct_test(pTest, Record.Datum.fReal == 21.0f);
+    /* changes of status are */
+    testTrendLogChange(0, 21.0f, true);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 3);
+    ct_test(pTest, TL_Record(iLog, LogInfo[iLog].ulRecordCount, &Record));
+    ct_test(pTest, Record.ucStatus == (128 | (1 << STATUS_FLAG_OUT_OF_SERVICE)));
+    /* and changes of other objects are not */
+    testTrendLogChange(1, 99.0f, false);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 3);
+
+    /* the Client_COV_Increment is used in place of the object's */
+    value.tag = BACNET_APPLICATION_TAG_REAL;
+    value.type.Real = 0.25f;
+    ct_test(pTest, testTrendLogWrite(iLog, PROP_CLIENT_COV_INCREMENT,
+            &value));
+    ct_test(pTest, LogInfo[iLog].fCOVIncrement == 0.25f);
+    testTrendLogChange(0, 21.5f, true);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 4);
+    value.type.Real = -1.0f;
+    ct_test(pTest, !testTrendLogWrite(iLog, PROP_CLIENT_COV_INCREMENT,
+            &value));
+    value.tag = BACNET_APPLICATION_TAG_NULL;
+    ct_test(pTest, testTrendLogWrite(iLog, PROP_CLIENT_COV_INCREMENT,
+            &value));
+    ct_test(pTest, LogInfo[iLog].fCOVIncrement == 1.0f);
+
+    /* not while disabled */
+    LogInfo[iLog].bEnable = false;
+    testTrendLogChange(0, 50.0f, true);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 4);
+    LogInfo[iLog].bEnable = true;
+
+    /* a non-zero Log_Interval goes back to polling */
+    value.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+    value.type.Unsigned_Int = 6000;
+    ct_test(pTest, testTrendLogWrite(iLog, PROP_LOG_INTERVAL, &value));
+    ct_test(pTest, LogInfo[iLog].LoggingType == LOGGING_TYPE_POLLED);
+    ct_test(pTest, LogInfo[iLog].ulLogInterval == 60);
+    testTrendLogChange(0, 90.0f, true);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 4);
+    /* ...and a zero one to COV */
+    value.type.Unsigned_Int = 0;
+    ct_test(pTest, testTrendLogWrite(iLog, PROP_LOG_INTERVAL, &value));
+    ct_test(pTest, LogInfo[iLog].LoggingType == LOGGING_TYPE_COV);
+    ct_test(pTest, LogInfo[iLog].ulTotalRecordCount == ulTotal + 5);
+
+    /* only values with a COV Value List can be logged on COV */
+    LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
+    TL_COV_Index();
+    LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_VALUE;
+    value.tag = BACNET_APPLICATION_TAG_ENUMERATED;
+    value.type.Enumerated = LOGGING_TYPE_COV;
+    ct_test(pTest, !testTrendLogWrite(iLog, PROP_LOGGING_TYPE, &value));
+    ct_test(pTest, LogInfo[iLog].LoggingType == LOGGING_TYPE_POLLED);
+    LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_INPUT;
+}
+
+/* sample a log, with or without getting the value directly */
+static void testTrendLogFetch(
+    int iLog,
+    bool bValueGet,
+    TL_DATA_REC * record)
+{
+    Test_Value_Get = bValueGet;
+    TL_fetch_property(iLog);
+    Test_Value_Get = true;
+    memset(record, 0, sizeof(TL_DATA_REC));
+    (void) TL_Record(iLog, LogInfo[iLog].ulRecordCount, record);
+}
+
+void testTrendLogSample(
+    Test * pTest)
+{
+    TL_DATA_REC Direct;
+    TL_DATA_REC Read;
+    int iLog = 2;
+
+    LogInfo[iLog].Source.objectIdentifier.type = OBJECT_ANALOG_INPUT;
+    LogInfo[iLog].Source.objectIdentifier.instance = 1;
+    LogInfo[iLog].Source.propertyIdentifier = PROP_PRESENT_VALUE;
+    LogInfo[iLog].Source.arrayIndex = BACNET_ARRAY_ALL;
+    Test_Present_Value[1] = 42.5f;
+    Test_Out_Of_Service[1] = true;
+    /* the value got directly is logged as the value read would be */
+    testTrendLogFetch(iLog, true, &Direct);
+    ct_test(pTest, Direct.ucRecType == TL_TYPE_REAL);
+    ct_test(pTest, Direct.Datum.fReal == 42.5f);
+    ct_test(pTest,
+        Direct.ucStatus == (128 | (1 << STATUS_FLAG_OUT_OF_SERVICE)));
+    testTrendLogFetch(iLog, false, &Read);
+    ct_test(pTest, Read.ucRecType == Direct.ucRecType);
+    ct_test(pTest, Read.Datum.fReal == Direct.Datum.fReal);
+    ct_test(pTest, Read.ucStatus == Direct.ucStatus);
+    /* the status flags, as a bit string */
+    LogInfo[iLog].Source.propertyIdentifier = PROP_STATUS_FLAGS;
+    testTrendLogFetch(iLog, true, &Direct);
+    testTrendLogFetch(iLog, false, &Read);
+    ct_test(pTest, Direct.ucRecType == TL_TYPE_BITS);
+    ct_test(pTest, memcmp(&Read.Datum.Bits, &Direct.Datum.Bits,
+            sizeof(Direct.Datum.Bits)) == 0);
+    /* properties that are only read, and objects that are not there */
+    LogInfo[iLog].Source.propertyIdentifier = PROP_OBJECT_NAME;
+    testTrendLogFetch(iLog, true, &Direct);
+    ct_test(pTest, Direct.ucRecType == TL_TYPE_ERROR);
+    LogInfo[iLog].Source.propertyIdentifier = PROP_PRESENT_VALUE;
+    LogInfo[iLog].Source.objectIdentifier.instance = 7;
+    testTrendLogFetch(iLog, true, &Direct);
+    ct_test(pTest, Direct.ucRecType == TL_TYPE_ERROR);
+    ct_test(pTest, Direct.Datum.Error.usClass == ERROR_CLASS_OBJECT);
+    ct_test(pTest, Direct.Datum.Error.usCode == ERROR_CODE_UNKNOWN_OBJECT);
+    LogInfo[iLog].Source.objectIdentifier.instance = iLog;
+    Test_Out_Of_Service[1] = false;
+}
+
+/* set up the logs in many different ways, reading from tStart on */
+static void testTrendLogScheduleSetup(
+    time_t tStart)
+{
+    static const uint32_t Intervals[] = {
+        1, 7, 60, 300, 900, 3600, 20000, 86400
+    };
+    TL_LOG_INFO *CurrentLog;
+    uint32_t ulRandom = 12345;
+    int iLog;
+
+    for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++) {
+        CurrentLog = &LogInfo[iLog];
+        ulRandom = ulRandom * 1103515245UL + 12345;
+        CurrentLog->ulLogInterval = Intervals[(ulRandom >> 8) % 8];
+        CurrentLog->bAlignIntervals = ((ulRandom >> 12) & 1) ? true : false;
+        CurrentLog->ulIntervalOffset = (ulRandom >> 4) % 5000;
+        CurrentLog->tLastDataTime =
+            tStart - (time_t) ((ulRandom >> 16) % 100000);
+        CurrentLog->bEnable = ((ulRandom >> 13) % 8) ? true : false;
+        CurrentLog->bTrigger = false;
+        CurrentLog->LoggingType = LOGGING_TYPE_POLLED;
+        if (((ulRandom >> 20) % 8) == 0)
+            CurrentLog->LoggingType = LOGGING_TYPE_TRIGGERED;
+        else if (((ulRandom >> 20) % 8) == 1)
+            CurrentLog->LoggingType = LOGGING_TYPE_COV;
+        CurrentLog->ucTimeFlags = (uint8_t) ((ulRandom >> 24) & 3);
+        CurrentLog->tStartTime = tStart + (time_t) ((ulRandom >> 3) % 30000);
+        CurrentLog->tStopTime = tStart + (time_t) ((ulRandom >> 7) % 60000);
+        if (CurrentLog->ucTimeFlags & TL_T_STOP_WILD)
+            CurrentLog->tStopTime = 0xFFFFFFFF;
+        if (CurrentLog->ucTimeFlags & TL_T_START_WILD)
+            CurrentLog->tStartTime = 0;
+    }
+}
+
+/* take the readings from tStart for some seconds, every so many seconds,
+   either looking at every log or only those that are due; return the
+   number of readings, and for each log when it last read */
+static unsigned long testTrendLogScheduleRun(
+    time_t tStart,
+    unsigned seconds,
+    unsigned step,
+    bool bSweep,
+    time_t * tLast)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+    unsigned long ulReadings = 0;
+    unsigned i;
+    int iLog;
+    time_t tNow;
+
+    testTrendLogScheduleSetup(tStart);
+    for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++)
+        ulReadings -= LogInfo[iLog].ulTotalRecordCount;
+    TL_Schedule_All(tStart - 1);
+    for (i = 0; i < seconds; i += step) {
+        tNow = tStart + i;
+        if (i == (seconds / 2)) {
+            /* the clock is set back */
+            tNow -= 5000;
+        }
+        if ((i % 997) == 0) {
+            /* some are triggered, as a client would */
+            value.tag = BACNET_APPLICATION_TAG_BOOLEAN;
+            value.type.Boolean = true;
+            for (iLog = (i / 997) % 5; iLog < (int) Trend_Log_Instances;
+                iLog += 5)
+                (void) testTrendLogWrite(iLog, PROP_TRIGGER, &value);
+        }
+        if (bSweep) {
+            for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++)
+                TL_Poll(iLog, tNow);
+        } else {
+            TL_Timer_Run(tNow);
+        }
+    }
+    for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++) {
+        ulReadings += LogInfo[iLog].ulTotalRecordCount;
+        tLast[iLog] = LogInfo[iLog].tLastDataTime;
+    }
+
+    return ulReadings;
+}
+
+void testTrendLogSchedule(
+    Test * pTest)
+{
+    time_t tStart = 1400000000;
+    time_t tSweep[64];
+    time_t tWheel[64];
+    unsigned long ulSweep;
+    unsigned long ulWheel;
+    unsigned step;
+    int iLog;
+    bool bSame;
+    TL_DATA_REC Record;
+
+    ct_test(pTest, Trend_Log_Storage_Set(NULL, 64, 16));
+    Trend_Log_Init();
+    /* the logs read in the same seconds as when every log was looked at
+       every second, past the turns of all the parts of the wheel, and
+       when some seconds are missed */
+    for (step = 1; step <= 3; step += 2) {
+        ulSweep = testTrendLogScheduleRun(tStart, 40000, step, true, tSweep);
+        ulWheel =
+            testTrendLogScheduleRun(tStart, 40000, step, false, tWheel);
+        ct_test(pTest, ulSweep > 1000);
+        ct_test(pTest, ulSweep == ulWheel);
+        bSame = true;
+        for (iLog = 0; iLog < 64; iLog++) {
+            if (tSweep[iLog] != tWheel[iLog])
+                bSame = false;
+        }
+        ct_test(pTest, bSame);
+    }
+
+    /* a log that is due in days waits in the last part of the wheel */
+    testTrendLogScheduleSetup(tStart);
+    LogInfo[0].bEnable = true;
+    LogInfo[0].LoggingType = LOGGING_TYPE_POLLED;
+    LogInfo[0].bAlignIntervals = false;
+    LogInfo[0].ucTimeFlags = TL_T_START_WILD | TL_T_STOP_WILD;
+    LogInfo[0].ulLogInterval = 2000000;
+    LogInfo[0].tLastDataTime = tStart;
+    TL_Schedule_All(tStart);
+    ct_test(pTest, LogInfo[0].tDue == (tStart + 2000000));
+    ct_test(pTest, LogInfo[0].iDueSlot >= TL_WHEEL_SECONDS + TL_WHEEL_BLOCKS);
+    /* ...and logs that cannot read are not in it */
+    LogInfo[1].bEnable = false;
+    TL_Schedule(1);
+    ct_test(pTest, LogInfo[1].iDueSlot == -1);
+
+    /* spread out, overdue logs that are not aligned read at their own
+       point of their interval */
+    for (iLog = 0; iLog < 64; iLog++) {
+        LogInfo[iLog].bEnable = true;
+        LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
+        LogInfo[iLog].bAlignIntervals = false;
+        LogInfo[iLog].ucTimeFlags = TL_T_START_WILD | TL_T_STOP_WILD;
+        LogInfo[iLog].ulLogInterval = 60;
+        LogInfo[iLog].tLastDataTime = tStart - 600;
+    }
+    TL_Schedule_All(tStart - 1);
+    ct_test(pTest, LogInfo[63].tDue == tStart);
+    Trend_Log_Spread_Set(true);
+    bSame = true;
+    for (iLog = 0; iLog < 64; iLog++) {
+        tSweep[iLog] = LogInfo[iLog].tDue;
+        if (tSweep[iLog] != tSweep[0])
+            bSame = false;
+        ct_test(pTest, tSweep[iLog] >= tStart);
+        ct_test(pTest, tSweep[iLog] < (tStart + 60));
+    }
+    ct_test(pTest, !bSame);
+    for (step = 0; step < 60; step++)
+        TL_Timer_Run(tStart + step);
+    for (iLog = 0; iLog < 64; iLog++) {
+        ct_test(pTest, TL_Record(iLog, LogInfo[iLog].ulRecordCount,
+                &Record));
+        ct_test(pTest, Record.tTimeStamp == tSweep[iLog]);
+        /* and then keep their own interval */
+        ct_test(pTest, LogInfo[iLog].tDue == (tSweep[iLog] + 60));
+    }
+    Trend_Log_Spread_Set(false);
+}
+
+/* ReadRange of log 1 from many points, by position, by sequence and by
+   time, summed up in a hash of the answers */
+static unsigned long testTrendLogRanges(
+    void)
+{
+    static const int32_t Counts[] = { 7, -7, 1000, -1000 };
+    uint8_t apdu[MAX_APDU];
+    BACNET_READ_RANGE_DATA Request;
+    unsigned long ulHash = 0;
+    uint32_t ulRef;
+    unsigned i;
+    int iType;
+    int iLen;
+    int iOctet;
+
+    for (i = 0; i < 4; i++) {
+        for (iType = RR_BY_POSITION; iType <= RR_BY_TIME; iType <<= 1) {
+            for (ulRef = 0; ulRef <= 420; ulRef += 20) {
+                memset(&Request, 0, sizeof(Request));
+                Request.object_type = OBJECT_TRENDLOG;
+                Request.object_instance = 1;
+                Request.object_property = PROP_LOG_BUFFER;
+                Request.array_index = BACNET_ARRAY_ALL;
+                Request.RequestType = iType;
+                Request.MaxApdu = MAX_APDU;
+                Request.Overhead = RR_OVERHEAD;
+                Request.Count = Counts[i];
+                bitstring_init(&Request.ResultFlags);
+                if (iType == RR_BY_POSITION) {
+                    Request.Range.RefIndex = ulRef;
+                    iLen = TL_encode_by_position(apdu, &Request);
+                } else if (iType == RR_BY_SEQUENCE) {
+                    Request.Range.RefSeqNum = ulRef;
+                    iLen = TL_encode_by_sequence(apdu, &Request);
+                } else {
+                    TL_Local_Time_To_BAC(&Request.Range.RefTime,
+                        1400000000 + ulRef);
+                    iLen = TL_encode_by_time(apdu, &Request);
                 }
+                for (iOctet = 0; iOctet < iLen; iOctet++)
+                    ulHash = (ulHash * 31) + apdu[iOctet];
+                ulHash = (ulHash * 31) + Request.ItemCount;
+                ulHash = (ulHash * 31) + Request.FirstSequence;
+                ulHash =
+                    (ulHash * 31) + bitstring_octet(&Request.ResultFlags, 0);
+            }
+        }
+    }
+
+    return ulHash;
+}
+
+/* the packed storage answers ReadRange as the RAM storage does */
+void testTrendLogPacked(
+    Test * pTest)
+{
+    const TL_STORAGE *Storages[2];
+    unsigned long ulHash[2];
+    TL_DATA_REC Record;
+    uint32_t ulCount;
+    int iStorage;
+
+    Storages[0] = NULL;
+    Storages[1] = tl_pack_storage();
+    for (iStorage = 0; iStorage < 2; iStorage++) {
+        ct_test(pTest, Trend_Log_Storage_Set(Storages[iStorage],
+                MAX_TREND_LOGS, 250));
+        Trend_Log_Init();
+        TL_Purge(1);
+        memset(&Record, 0, sizeof(Record));
+        Record.tTimeStamp = 1400000000;
+        for (ulCount = 0; ulCount < 400; ulCount++) {
+            Record.tTimeStamp += ulCount % 3;
+            Record.ucRecType = (ulCount / 10) % 10;
+            Record.ucStatus = (ulCount & 0x10) ? (0x80 | (ulCount & 7)) : 0;
+            switch (Record.ucRecType) {
+                case TL_TYPE_REAL:
+                    Record.Datum.fReal = 20.0f + (ulCount % 7) / 4.0f;
+                    break;
+                case TL_TYPE_BITS:
+                    Record.Datum.Bits.ucLen = 0x24;
+                    Record.Datum.Bits.ucStore[0] = (uint8_t) ulCount;
+                    Record.Datum.Bits.ucStore[1] = (uint8_t) ~ulCount;
+                    break;
+                case TL_TYPE_ERROR:
+                    Record.Datum.Error.usClass = ERROR_CLASS_PROPERTY;
+                    Record.Datum.Error.usCode = ERROR_CODE_UNKNOWN_PROPERTY;
+                    break;
+                default:
+                    Record.Datum.ulUValue = ulCount % 2;
+                    break;
             }
+            TL_Append(1, &Record);
         }
+        ct_test(pTest, LogInfo[1].ulRecordCount == 250);
+        ulHash[iStorage] = testTrendLogRanges();
+    }
+    ct_test(pTest, ulHash[0] == ulHash[1]);
+}
+
+#ifdef TEST_TRENDLOG
+/* sample many polled logs, with and without getting the value directly */
+static void testTrendLogSampleBenchmark(
+    unsigned logs,
+    unsigned rounds)
+{
+    clock_t start;
+    unsigned i;
+    unsigned iLog;
+    int bValueGet;
+    double seconds;
+
+    if (!Trend_Log_Storage_Set(NULL, logs, 64)) {
+        printf("unable to keep %u logs\n", logs);
+        return;
+    }
+    Trend_Log_Init();
+    for (iLog = 0; iLog < logs; iLog++) {
+        LogInfo[iLog].Source.objectIdentifier.instance = iLog & 1;
     }
+    for (bValueGet = 1; bValueGet >= 0; bValueGet--) {
+        Test_Value_Get = bValueGet;
+        start = clock();
+        for (i = 0; i < rounds; i++) {
+            Test_Present_Value[0] = (float) i;
+            for (iLog = 0; iLog < logs; iLog++) {
+                TL_fetch_property(iLog);
+            }
+        }
+        seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+        printf("%u polled logs: %s %.0f samples/second\n", logs,
+            bValueGet ? "value get" : "read property",
+            seconds > 0 ? ((double) logs * rounds) / seconds : 0.0);
+    }
+    Test_Value_Get = true;
+}
+
+/* half the logs aligned to a quarter of an hour, half every minute and
+   not aligned, all overdue as when they start */
+static void testTrendLogScheduleBenchSetup(
+    time_t tStart)
+{
+    int iLog;
+
+    for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog++) {
+        LogInfo[iLog].bEnable = true;
+        LogInfo[iLog].LoggingType = LOGGING_TYPE_POLLED;
+        LogInfo[iLog].ucTimeFlags = TL_T_START_WILD | TL_T_STOP_WILD;
+        LogInfo[iLog].bTrigger = false;
+        LogInfo[iLog].bAlignIntervals = (iLog & 1) ? true : false;
+        LogInfo[iLog].ulLogInterval = (iLog & 1) ? 900 : 60;
+        LogInfo[iLog].ulIntervalOffset = 0;
+        LogInfo[iLog].tLastDataTime = tStart - 600;
+        LogInfo[iLog].Source.objectIdentifier.instance = iLog & 1;
+    }
+    TL_Schedule_All(tStart - 1);
+}
+
+/* the most readings taken in one second by the logs not aligned */
+static unsigned long testTrendLogSchedulePeak(
+    time_t tStart,
+    unsigned seconds)
+{
+    unsigned long ulPeak = 0;
+    unsigned long ulTotal;
+    unsigned long ulLast = 0;
+    unsigned i;
+    int iLog;
+
+    testTrendLogScheduleBenchSetup(tStart);
+    for (i = 0; i <= seconds; i++) {
+        if (i > 0)
+            TL_Timer_Run(tStart + i - 1);
+        ulTotal = 0;
+        for (iLog = 0; iLog < (int) Trend_Log_Instances; iLog += 2)
+            ulTotal += LogInfo[iLog].ulTotalRecordCount;
+        if ((i > 0) && ((ulTotal - ulLast) > ulPeak))
+            ulPeak = ulTotal - ulLast;
+        ulLast = ulTotal;
+    }
+
+    return ulPeak;
+}
+
+/* time a second of many polled logs, looking at all of them or only
+   those that are due */
+static void testTrendLogScheduleBenchmark(
+    unsigned logs,
+    unsigned seconds)
+{
+    time_t tStart = 1400000000;
+    clock_t start;
+    unsigned i;
+    int iLog;
+    int bSweep;
+
+    if (!Trend_Log_Storage_Set(NULL, logs, 16)) {
+        printf("unable to keep %u logs\n", logs);
+        return;
+    }
+    Trend_Log_Init();
+    for (bSweep = 1; bSweep >= 0; bSweep--) {
+        testTrendLogScheduleBenchSetup(tStart);
+        start = clock();
+        for (i = 0; i < seconds; i++) {
+            if (bSweep) {
+                for (iLog = 0; iLog < (int) logs; iLog++)
+                    TL_Poll(iLog, tStart + i);
+            } else {
+                TL_Timer_Run(tStart + i);
+            }
+        }
+        printf("%u polled logs: %s %.2f us/second\n", logs,
+            bSweep ? "every log" : "timer wheel",
+            ((double) (clock() - start) * 1000000.0 / CLOCKS_PER_SEC) /
+            seconds);
+    }
+    printf("%u polled logs: not aligned, at most %lu readings a second\n",
+        logs, testTrendLogSchedulePeak(tStart, seconds));
+    Trend_Log_Spread_Set(true);
+    printf("%u polled logs: not aligned and spread, at most %lu\n", logs,
+        testTrendLogSchedulePeak(tStart, seconds));
+    Trend_Log_Spread_Set(false);
+}
+
+/* time ReadRange by time of a deep log, by search and by stepping */
+static void testTrendLogBenchmark(
+    const TL_STORAGE * storage,
+    uint32_t depth,
+    unsigned requests)
+{
+    uint8_t apdu[MAX_APDU];
+    BACNET_READ_RANGE_DATA Request;
+    time_t tRefTime;
+    clock_t start;
+    unsigned i;
+    int bStep;
+    unsigned long ulItems;
+
+    if (!Trend_Log_Storage_Set(storage, MAX_TREND_LOGS, depth)) {
+        printf("unable to keep logs of %lu records\n",
+            (unsigned long) depth);
+        return;
+    }
+    Trend_Log_Init();
+    /* wrapped once, so the newest records are not at the end of RAM */
+    testTrendLogFill(0, depth + (depth / 3), 1400000000);
+    for (bStep = 0; bStep <= 1; bStep++) {
+        ulItems = 0;
+        start = clock();
+        for (i = 0; i < requests; i++) {
+            /* anywhere in the log, forwards and backwards */
+            tRefTime =
+                1400000000 + (depth / 3) + (((uint64_t) i * 7919) % depth);
+            (void) testTrendLogByTime(apdu, &Request, 0, tRefTime,
+                (i & 1) ? -20 : 20, bStep);
+            ulItems += Request.ItemCount;
+        }
+        printf("%lu records%s: %s %.2f us/request (%lu items)\n",
+            (unsigned long) depth, storage ? " packed" : "",
+            bStep ? "step" : "search",
+            ((double) (clock() - start) * 1000000.0 / CLOCKS_PER_SEC) /
+            requests, ulItems);
+    }
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    uint32_t depth = 1000000;
+    unsigned requests = 200;
+    unsigned logs = 10000;
+    unsigned rounds = 100;
+    unsigned seconds = 3600;
+
+    pTest = ct_create("BACnet Trend Log", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTrendLog);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogCOV);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogSample);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogSchedule);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrendLogPacked);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1)
+        depth = strtoul(argv[1], NULL, 0);
+    if (argc > 2)
+        requests = strtoul(argv[2], NULL, 0);
+    testTrendLogBenchmark(NULL, depth, requests);
+    testTrendLogBenchmark(tl_pack_storage(), depth, requests);
+    if (argc > 3)
+        logs = strtoul(argv[3], NULL, 0);
+    if (argc > 4)
+        rounds = strtoul(argv[4], NULL, 0);
+    testTrendLogSampleBenchmark(logs, rounds);
+    if (argc > 5)
+        seconds = strtoul(argv[5], NULL, 0);
+    testTrendLogScheduleBenchmark(logs, seconds);
+
+    return 0;
 }
+#endif /* TEST_TRENDLOG */
+#endif /* TEST */
@@ -32,6 +32,7 @@
 #include "cov.h"
 #include "rp.h"
 #include "wp.h"
+#include "readrange.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,7 +81,38 @@ extern "C" {
 #define TL_T_START_WILD 1       /* Start time is wild carded */
 #define TL_T_STOP_WILD  2       /* Stop Time is wild carded */
 
-#define TL_MAX_ENTRIES 1000     /* Entries per datalog */
+#define TL_MAX_ENTRIES 1000     /* Default entries per datalog */
+
+/* number of demo objects, unless the storage is set up for more */
+#ifndef MAX_TREND_LOGS
+#define MAX_TREND_LOGS 8
+#endif
+
+/* Storage for the records of the Trend Logs.
+ *
+ * A storage keeps a ring of a fixed number of records for each log,
+ * and numbers the records of a log in sequence from 1, the same as
+ * Total_Record_Count counts them.  Trend_Log_Storage_Set() selects
+ * the storage, and the number and depth of the logs, at run time;
+ * without it the logs are kept in RAM.
+ */
+
+    typedef struct tl_storage {
+        /* Make room for a number of logs, each of depth records */
+        bool (*Open) (unsigned logs, uint32_t depth);
+        void (*Close) (void);
+        /* Add a record, in place of the oldest one if the log is full */
+        void (*Append) (unsigned iLog, const TL_DATA_REC * record);
+        /* Fetch the record with a sequence number, if it is kept */
+        bool (*Record) (unsigned iLog, uint32_t ulSequence,
+            TL_DATA_REC * record);
+        /* Records kept, and the sequence number of the newest one */
+        void (*Counts) (unsigned iLog, uint32_t * pulRecordCount,
+            uint32_t * pulTotalRecordCount);
+        /* Empty the log; the next record gets the sequence number
+         * ulTotalRecordCount + 1 */
+        void (*Purge) (unsigned iLog, uint32_t ulTotalRecordCount);
+    } TL_STORAGE;
 
 /* Structure containing config and status info for a Trend Log */
 
@@ -94,14 +126,24 @@ extern "C" {
         BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE Source; /* Where the data comes from */
         uint32_t ulLogInterval; /* Time between entries in seconds */
         bool bStopWhenFull;     /* Log halts when full if true */
-        uint32_t ulRecordCount; /* Count of items currently in the buffer */
-        uint32_t ulTotalRecordCount;    /* Count of all items that have ever been inserted into the buffer */
+        uint32_t ulRecordCount; /* Count of items currently in the buffer - kept by the storage */
+        uint32_t ulTotalRecordCount;    /* Count of all items that have ever been inserted into the buffer - kept by the storage */
         BACNET_LOGGING_TYPE LoggingType;        /* Polled/cov/triggered */
         bool bAlignIntervals;   /* If true align to the clock */
         uint32_t ulIntervalOffset;      /* Offset from start of period for taking reading in seconds */
         bool bTrigger;  /* Set to 1 to cause a reading to be taken */
-        int iIndex;     /* Current insertion point */
         time_t tLastDataTime;
+        uint32_t ulUnorderedSeq;        /* Newest record older than the one before it */
+        bool bClientCOVIncrement;       /* False if Client_COV_Increment is NULL */
+        float fClientCOVIncrement;
+        float fCOVIncrement;    /* Increment in use when logging on COV */
+        uint32_t ulCOVResubscriptionInterval;   /* In seconds */
+        TL_DATA_REC COVRecord;  /* Last value logged on COV */
+        int iNextCOV;   /* Next COV log in the same bucket, or -1 */
+        time_t tDue;    /* Second of the next reading, when scheduled */
+        int iDueSlot;   /* Slot of the timer wheel, or -1 */
+        int iNextDue;   /* Next log in the same slot, or -1 */
+        int iPrevDue;   /* Previous log in the same slot, or -1 */
     } TL_LOG_INFO;
 
 /*
@@ -150,6 +192,12 @@ extern "C" {
         BACNET_WRITE_PROPERTY_DATA * wp_data);
     void Trend_Log_Init(
         void);
+    bool Trend_Log_Storage_Set(
+        const TL_STORAGE * storage,
+        unsigned logs,
+        uint32_t depth);
+    void Trend_Log_Spread_Set(
+        bool bSpread);
 
     void TL_Insert_Status_Rec(
         int iLog,
@@ -194,6 +242,20 @@ extern "C" {
     void trend_log_timer(
         uint16_t uSeconds);
 
+#ifdef TEST
+#include "ctest.h"
+    void testTrendLog(
+        Test * pTest);
+    void testTrendLogCOV(
+        Test * pTest);
+    void testTrendLogSample(
+        Test * pTest);
+    void testTrendLogSchedule(
+        Test * pTest);
+    void testTrendLogPacked(
+        Test * pTest);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,45 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../../src
+TEST_DIR = ../../test
+PORTS_DIR = ../../ports/linux
+INCLUDES = -I../../include -I$(TEST_DIR) -I$(PORTS_DIR) -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DBACDL_TEST -DBACAPP_ALL -DTEST_TRENDLOG
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = trendlog.c \
+	tlpack.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
+	$(SRC_DIR)/bactimevalue.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/lighting.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(TEST_DIR)/ctest.c
+
+TARGET = trendlog
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} 
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,274 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+
+/* Object_List enumeration benchmark.  The Device object is given an
+   object table with one type of as many objects as asked for, and the
+   Object_List is read the ways that clients read it: element by element
+   with an array index, encoded from an array index onwards as a
+   segmented ReadProperty does, and searched by object name. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/* local includes */
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacstr.h"
+#include "config.h"
+#include "device.h"
+#include "version.h"
+
+/* number of objects of the benchmark type */
+static unsigned Bench_Objects = 10000;
+
+static unsigned Bench_Count(
+    void)
+{
+    return Bench_Objects;
+}
+
+static uint32_t Bench_Index_To_Instance(
+    unsigned index)
+{
+    return index;
+}
+
+static bool Bench_Valid_Instance(
+    uint32_t object_instance)
+{
+    return (object_instance < Bench_Objects);
+}
+
+static bool Bench_Object_Name(
+    uint32_t object_instance,
+    BACNET_CHARACTER_STRING * object_name)
+{
+    char text_string[32] = "";
+
+    if (object_instance >= Bench_Objects) {
+        return false;
+    }
+    sprintf(text_string, "ANALOG VALUE %lu", (unsigned long) object_instance);
+
+    return characterstring_init_ansi(object_name, text_string);
+}
+
+static object_functions_t Bench_Object_Table[] = {
+    {OBJECT_DEVICE,
+            NULL /* Init - don't init Device or it will recourse! */ ,
+            Device_Count,
+            Device_Index_To_Instance,
+            Device_Valid_Object_Instance_Number,
+            Device_Object_Name,
+            Device_Read_Property_Local,
+            NULL /* Write_Property */ ,
+            NULL /* Property_Lists */ ,
+            NULL /* ReadRangeInfo */ ,
+            NULL /* Iterator */ ,
+            NULL /* Value_Lists */ ,
+            NULL /* COV */ ,
+            NULL /* COV Clear */ ,
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
+    {OBJECT_ANALOG_VALUE,
+            NULL /* Init */ ,
+            Bench_Count,
+            Bench_Index_To_Instance,
+            Bench_Valid_Instance,
+            Bench_Object_Name,
+            NULL /* Read_Property */ ,
+            NULL /* Write_Property */ ,
+            NULL /* Property_Lists */ ,
+            NULL /* ReadRangeInfo */ ,
+            NULL /* Iterator */ ,
+            NULL /* Value_Lists */ ,
+            NULL /* COV */ ,
+            NULL /* COV Clear */ ,
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
+    {MAX_BACNET_OBJECT_TYPE,
+            NULL /* Init */ ,
+            NULL /* Count */ ,
+            NULL /* Index_To_Instance */ ,
+            NULL /* Valid_Instance */ ,
+            NULL /* Object_Name */ ,
+            NULL /* Read_Property */ ,
+            NULL /* Write_Property */ ,
+            NULL /* Property_Lists */ ,
+            NULL /* ReadRangeInfo */ ,
+            NULL /* Iterator */ ,
+            NULL /* Value_Lists */ ,
+            NULL /* COV */ ,
+            NULL /* COV Clear */ ,
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ }
+};
+
+/* microseconds of processor time since a start time */
+static double elapsed_us(
+    clock_t start)
+{
+    return ((double) (clock() - start) * 1000000.0) / CLOCKS_PER_SEC;
+}
+
+static void print_usage(
+    char *filename)
+{
+    printf("Usage: %s [--objects 10000][--rounds 10]\n", filename);
+    printf("       [--version][--help]\n");
+}
+
+static void print_help(
+    char *filename)
+{
+    printf("Time the reading of the Object_List of a Device with\n"
+        "the given number of Analog Value objects.\n"
+        "--objects: number of objects besides the Device object\n"
+        "--rounds: number of times that each test is repeated\n"
+        "\n" "Example:\n" "%s --objects 50000 --rounds 4\n", filename);
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    BACNET_CHARACTER_STRING object_name;
+    uint8_t apdu[MAX_APDU];
+    char text_string[32] = "";
+    unsigned long rounds = 10;
+    unsigned long round = 0;
+    unsigned long errors = 0;
+    unsigned count = 0;
+    unsigned array_index = 0;
+    unsigned i = 0;
+    int object_type = 0;
+    uint32_t instance = 0;
+    int len = 0;
+    char *filename = NULL;
+    int argi = 0;
+    clock_t start;
+
+    filename = argv[0];
+    for (argi = 1; argi < argc; argi++) {
+        if (strcmp(argv[argi], "--help") == 0) {
+            print_usage(filename);
+            print_help(filename);
+            return 0;
+        }
+        if (strcmp(argv[argi], "--version") == 0) {
+            printf("objlist %s\n", BACnet_Version);
+            printf("Copyright (C) 2016 by Steve Karg\n"
+                "This is free software; see the source for copying conditions.\n"
+                "There is NO warranty; not even for MERCHANTABILITY or\n"
+                "FITNESS FOR A PARTICULAR PURPOSE.\n");
+            return 0;
+        }
+        if ((strcmp(argv[argi], "--objects") == 0) && (argi + 1 < argc)) {
+            Bench_Objects = strtoul(argv[++argi], NULL, 0);
+        } else if ((strcmp(argv[argi], "--rounds") == 0) &&
+            (argi + 1 < argc)) {
+            rounds = strtoul(argv[++argi], NULL, 0);
+        } else {
+            print_usage(filename);
+            return 1;
+        }
+    }
+    if (Bench_Objects == 0) {
+        Bench_Objects = 1;
+    }
+    if (rounds == 0) {
+        rounds = 1;
+    }
+    Device_Init(&Bench_Object_Table[0]);
+    count = Device_Object_List_Count();
+    printf("Objects: %u  Rounds: %lu\n", count, rounds);
+    /* the first element builds the list, after every revision */
+    start = clock();
+    for (round = 0; round < rounds; round++) {
+        Device_Inc_Database_Revision();
+        if (!Device_Object_List_Identifier(1, &object_type, &instance)) {
+            errors++;
+        }
+    }
+    printf("Build: %.1f us\n", elapsed_us(start) / rounds);
+    start = clock();
+    for (round = 0; round < rounds; round++) {
+        for (i = 1; i <= count; i++) {
+            if (!Device_Object_List_Identifier(i, &object_type, &instance)) {
+                errors++;
+            } else if ((i > 1) && (instance != (i - 2))) {
+                errors++;
+            }
+        }
+    }
+    printf("Array Index: %.3f us per element\n",
+        elapsed_us(start) / ((double) rounds * count));
+    start = clock();
+    for (round = 0; round < rounds; round++) {
+        array_index = 1;
+        while (array_index <= count) {
+            len =
+                Device_Object_List_Encode(&apdu[0], sizeof(apdu),
+                &array_index);
+            if (len <= 0) {
+                errors++;
+                break;
+            }
+        }
+    }
+    printf("Encode: %.3f us per element\n",
+        elapsed_us(start) / ((double) rounds * count));
+    start = clock();
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < Bench_Objects; i++) {
+            sprintf(text_string, "ANALOG VALUE %u", i);
+            characterstring_init_ansi(&object_name, text_string);
+            if (!Device_Valid_Object_Name(&object_name, &object_type,
+                    &instance) || (instance != i)) {
+                errors++;
+            }
+        }
+    }
+    printf("Name Found: %.3f us per lookup\n",
+        elapsed_us(start) / ((double) rounds * Bench_Objects));
+    start = clock();
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < Bench_Objects; i++) {
+            sprintf(text_string, "BINARY VALUE %u", i);
+            characterstring_init_ansi(&object_name, text_string);
+            if (Device_Valid_Object_Name(&object_name, NULL, NULL)) {
+                errors++;
+            }
+        }
+    }
+    printf("Name Not Found: %.3f us per lookup\n",
+        elapsed_us(start) / ((double) rounds * Bench_Objects));
+    printf("Errors: %lu\n", errors);
+
+    return (errors ? 2 : 0);
+}
@@ -75,7 +75,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {OBJECT_BINARY_INPUT,
             Binary_Input_Init,
             Binary_Input_Count,
@@ -90,7 +91,8 @@ static object_functions_t My_Object_Table[] = {
             Binary_Input_Encode_Value_List,
             Binary_Input_Change_Of_Value,
             Binary_Input_Change_Of_Value_Clear,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        Binary_Input_Value_Get},
     {OBJECT_BINARY_OUTPUT,
             Binary_Output_Init,
             Binary_Output_Count,
@@ -105,7 +107,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ },
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ },
     {MAX_BACNET_OBJECT_TYPE,
             NULL /* Init */ ,
             NULL /* Count */ ,
@@ -120,7 +123,8 @@ static object_functions_t My_Object_Table[] = {
             NULL /* Value_Lists */ ,
             NULL /* COV */ ,
             NULL /* COV Clear */ ,
-        NULL /* Intrinsic Reporting */ }
+            NULL /* Intrinsic Reporting */ ,
+        NULL /* Value Get */ }
 };
 
 /** Glue function to let the Device object, when called by a handler,
@@ -1516,6 +1520,34 @@ void Device_COV_Clear(
     }
 }
 
+static object_cov_listener_function COV_Listener;
+
+/** Sets the function told when the value or status of any local object
+ * with a COV Value List changes.
+ * @ingroup ObjHelpers
+ * @param [in] The function, or NULL for none.
+ */
+void Device_COV_Listener_Set(
+    object_cov_listener_function pFunction)
+{
+    COV_Listener = pFunction;
+}
+
+/** Called by an object when its Present_Value or Status_Flags change
+ * by any amount; the listener applies its own COV increment.
+ * @ingroup ObjHelpers
+ * @param [in] The object type that changed.
+ * @param [in] The object instance that changed.
+ */
+void Device_COV_Changed(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    if (COV_Listener) {
+        COV_Listener(object_type, object_instance);
+    }
+}
+
 #if defined(INTRINSIC_REPORTING)
 void Device_local_reporting(
     void)
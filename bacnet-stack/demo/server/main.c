@@ -54,6 +54,11 @@
 /* include the device object */
 #include "device.h"
 #include "trendlog.h"
+#include "tlpack.h"
+#include "schedule.h"
+#if defined(__linux__)
+#include "tlmmap.h"
+#endif
 #if defined(INTRINSIC_REPORTING)
 #include "nc.h"
 #endif /* defined(INTRINSIC_REPORTING) */
@@ -151,6 +156,54 @@ static void Init_Service_Handlers(
 #endif
 }
 
+/** Size the Trend Logs and choose where they keep their records,
+ * from the environment:
+ * BACNET_TRENDLOG_COUNT - number of Trend Log objects
+ * BACNET_TRENDLOG_DEPTH - records kept by each log
+ * BACNET_TRENDLOG_DIR - directory of files that keep the records
+ *   across restarts (Linux), instead of RAM
+ * BACNET_TRENDLOG_PACKED - if set, keep the records packed in RAM, for
+ *   deeper logs in the same memory
+ * BACNET_TRENDLOG_SPREAD - if set, spread out the readings of the logs
+ *   that are not aligned to the clock
+ */
+static void Init_Trend_Log_Storage(
+    void)
+{
+    const TL_STORAGE *storage = NULL;
+    unsigned logs = MAX_TREND_LOGS;
+    uint32_t depth = TL_MAX_ENTRIES;
+    char *pEnv = NULL;
+
+    pEnv = getenv("BACNET_TRENDLOG_COUNT");
+    if (pEnv) {
+        logs = strtoul(pEnv, NULL, 0);
+    }
+    pEnv = getenv("BACNET_TRENDLOG_DEPTH");
+    if (pEnv) {
+        depth = strtoul(pEnv, NULL, 0);
+    }
+    if (getenv("BACNET_TRENDLOG_PACKED")) {
+        storage = tl_pack_storage();
+    }
+#if defined(__linux__)
+    pEnv = getenv("BACNET_TRENDLOG_DIR");
+    if (pEnv) {
+        storage = tl_mmap_storage(pEnv);
+        if (!storage) {
+            fprintf(stderr, "BACNET_TRENDLOG_DIR is too long\n");
+        }
+    }
+#endif
+    if (!Trend_Log_Storage_Set(storage, logs, depth)) {
+        fprintf(stderr, "Unable to keep %u Trend Logs of %lu records\n",
+            logs, (unsigned long) depth);
+    }
+    if (getenv("BACNET_TRENDLOG_SPREAD")) {
+        Trend_Log_Spread_Set(true);
+    }
+}
+
 static void print_usage(const char *filename)
 {
     printf("Usage: %s [device-instance [device-name]]\n", filename);
@@ -253,6 +306,7 @@ int main(
     /* load any static address bindings to show up
        in our device bindings list */
     address_init();
+    Init_Trend_Log_Storage();
     Init_Service_Handlers();
     dlenv_init();
     atexit(datalink_cleanup);
@@ -286,6 +340,7 @@ int main(
             handler_cov_timer_seconds(elapsed_seconds);
             tsm_timer_milliseconds(elapsed_milliseconds);
             trend_log_timer(elapsed_seconds);
+            schedule_timer(elapsed_seconds);
 #if defined(INTRINSIC_REPORTING)
             Device_local_reporting();
 #endif
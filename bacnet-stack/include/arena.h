@@ -0,0 +1,101 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Memory arena: many small allocations taken from a few large blocks,
+* and all of them released together.
+*
+* @{
+*/
+struct arena_block_t;
+typedef struct arena_block_t {
+    /** next (older) block of the arena */
+    struct arena_block_t *next;
+    /** size of the data area of this block */
+    size_t size;
+    /** bytes of the data area handed out */
+    size_t used;
+} ARENA_BLOCK;
+
+typedef struct arena_t {
+    /** current block, allocations are taken from here */
+    ARENA_BLOCK *head;
+    /** minimum size of a new block */
+    size_t block_size;
+    /** number of blocks obtained from malloc() */
+    unsigned long block_count;
+    /** number of allocations handed out */
+    unsigned long alloc_count;
+    /** bytes obtained from malloc() */
+    size_t bytes_reserved;
+    /** bytes handed out, including alignment */
+    size_t bytes_used;
+} ARENA;
+/** @} */
+
+/* allocations are aligned for any of the BACnet value types */
+#define ARENA_ALIGNMENT 8
+/* default size of a block: a full MAX_APDU and its decoded values */
+#define ARENA_BLOCK_SIZE 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void arena_init(
+        ARENA * arena,
+        size_t block_size);
+
+    void *arena_alloc(
+        ARENA * arena,
+        size_t size);
+
+    void *arena_copy(
+        ARENA * arena,
+        const void *data,
+        size_t size);
+
+    void arena_reset(
+        ARENA * arena);
+
+    void arena_free(
+        ARENA * arena);
+
+#ifdef TEST
+#include "ctest.h"
+    void testArena(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -93,6 +93,39 @@ typedef struct BACnet_Application_Data_Value {
     struct BACnet_Application_Data_Value *next;
 } BACNET_APPLICATION_DATA_VALUE;
 
+/* Compact form of an application data value, for clients that decode
+   a lot of values.  Strings, and data kept encoded, refer to their
+   octets by offset from the start of the buffer they were decoded from
+   rather than embedding a BACNET_CHARACTER_STRING or OCTET_STRING. */
+struct BACnet_Compact_Value;
+typedef struct BACnet_Compact_Value {
+    bool context_specific;      /* true if context specific data */
+    uint8_t context_tag;        /* only used for context specific data */
+    /* application tag data type, or MAX_BACNET_APPLICATION_TAG for
+       data kept encoded (constructed or unknown context data) */
+    uint8_t tag;
+    union {
+        bool Boolean;
+        uint32_t Unsigned_Int;
+        int32_t Signed_Int;
+        float Real;
+        double Double;
+        uint32_t Enumerated;
+        BACNET_DATE Date;
+        BACNET_TIME Time;
+        BACNET_OBJECT_ID Object_Id;
+        /* contents octets of octet, character and bit strings (with
+           their character set or unused bits octet), and lighting
+           commands; the tags and contents of data kept encoded */
+        struct {
+            uint32_t offset;
+            uint32_t length;
+        } Octets;
+    } type;
+    /* simple linked list if needed */
+    struct BACnet_Compact_Value *next;
+} BACNET_COMPACT_VALUE;
+
 struct BACnet_Access_Error;
 typedef struct BACnet_Access_Error {
     BACNET_ERROR_CLASS error_class;
@@ -181,6 +214,18 @@ extern "C" {
         BACNET_APPLICATION_DATA_VALUE * dest_value,
         BACNET_APPLICATION_DATA_VALUE * src_value);
 
+    int bacapp_decode_compact_data(
+        uint8_t * apdu,
+        unsigned max_apdu_len,
+        uint8_t * base,
+        BACNET_COMPACT_VALUE * value,
+        BACNET_PROPERTY_ID property);
+
+    bool bacapp_compact_value_expand(
+        uint8_t * base,
+        BACNET_COMPACT_VALUE * src_value,
+        BACNET_APPLICATION_DATA_VALUE * dest_value);
+
     /* returns the length of data between an opening tag and a closing tag.
        Expects that the first octet contain the opening tag.
        Include a value property identifier for context specific data
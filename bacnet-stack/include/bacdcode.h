@@ -164,6 +164,58 @@ extern "C" {
         uint8_t tag_number,
         double value);
 
+/* Bulk encoding and decoding of arrays whose elements all have one */
+/* application tag, such as a Priority_Array of REAL */
+/* encoders return the number of apdu bytes consumed, */
+/* or BACNET_STATUS_ERROR if the elements do not fit */
+    int encode_application_real_array(
+        uint8_t * apdu,
+        int apdu_max,
+        const float *values,
+        unsigned count);
+    int encode_application_real_priority_array(
+        uint8_t * apdu,
+        int apdu_max,
+        const float *values,
+        uint16_t active_bits);
+    int encode_application_double_array(
+        uint8_t * apdu,
+        int apdu_max,
+        const double *values,
+        unsigned count);
+    int encode_application_unsigned_array(
+        uint8_t * apdu,
+        int apdu_max,
+        const uint32_t * values,
+        unsigned count);
+    int encode_application_enumerated_array(
+        uint8_t * apdu,
+        int apdu_max,
+        const uint32_t * values,
+        unsigned count);
+/* decoders stop at the first element of another type; */
+/* count is the room in values on entry, the elements decoded on return */
+    int decode_application_real_array(
+        uint8_t * apdu,
+        int apdu_len,
+        float *values,
+        unsigned *count);
+    int decode_application_double_array(
+        uint8_t * apdu,
+        int apdu_len,
+        double *values,
+        unsigned *count);
+    int decode_application_unsigned_array(
+        uint8_t * apdu,
+        int apdu_len,
+        uint32_t * values,
+        unsigned *count);
+    int decode_application_enumerated_array(
+        uint8_t * apdu,
+        int apdu_len,
+        uint32_t * values,
+        unsigned *count);
+
 /* from clause 20.2.14 Encoding of an Object Identifier Value */
 /* and 20.2.1 General Rules for Encoding BACnet Tags */
 /* returns the number of apdu bytes consumed */
@@ -0,0 +1,153 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef BACTAG_H
+#define BACTAG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacstr.h"
+#include "datetime.h"
+
+/* One tag of an encoded APDU, as found by a BACNET_TAG_CURSOR.
+   Nothing is copied: the contents octets are referenced where they
+   are in the APDU. */
+typedef struct BACnet_Tag {
+    uint8_t number;     /* tag number */
+    bool context;       /* true for a context specific tag */
+    bool opening;       /* true for an opening tag */
+    bool closing;       /* true for a closing tag */
+    /* length of the contents, or the value of an application Boolean */
+    uint32_t len_value_type;
+    /* octets of the tag itself */
+    uint8_t header_len;
+    /* the contents octets, and how many there are */
+    uint8_t *contents;
+    uint32_t contents_len;
+} BACNET_TAG;
+
+/* A cursor that walks the tags of an encoded APDU. */
+typedef struct BACnet_Tag_Cursor {
+    uint8_t *apdu;
+    uint32_t apdu_len;
+    /* offset of the next tag */
+    uint32_t offset;
+    /* opening tags that have been passed but not yet closed */
+    unsigned depth;
+    /* set when the encoding is malformed or truncated */
+    bool error;
+} BACNET_TAG_CURSOR;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void bactag_cursor_init(
+        BACNET_TAG_CURSOR * cursor,
+        uint8_t * apdu,
+        uint32_t apdu_len);
+
+    bool bactag_cursor_end(
+        BACNET_TAG_CURSOR * cursor);
+
+    bool bactag_peek(
+        BACNET_TAG_CURSOR * cursor,
+        BACNET_TAG * tag);
+
+    bool bactag_next(
+        BACNET_TAG_CURSOR * cursor,
+        BACNET_TAG * tag);
+
+    bool bactag_skip(
+        BACNET_TAG_CURSOR * cursor);
+
+    bool bactag_skip_to_closing(
+        BACNET_TAG_CURSOR * cursor);
+
+    bool bactag_find_context(
+        BACNET_TAG_CURSOR * cursor,
+        uint8_t tag_number,
+        BACNET_TAG * tag);
+
+    bool bactag_enter(
+        BACNET_TAG_CURSOR * cursor,
+        uint8_t tag_number,
+        BACNET_TAG_CURSOR * inner);
+
+    /* materialize the value of a tag */
+    bool bactag_is_application(
+        BACNET_TAG * tag,
+        BACNET_APPLICATION_TAG application_tag);
+    bool bactag_null(
+        BACNET_TAG * tag);
+    bool bactag_boolean(
+        BACNET_TAG * tag,
+        bool * value);
+    bool bactag_unsigned(
+        BACNET_TAG * tag,
+        uint32_t * value);
+    bool bactag_signed(
+        BACNET_TAG * tag,
+        int32_t * value);
+    bool bactag_enumerated(
+        BACNET_TAG * tag,
+        uint32_t * value);
+    bool bactag_real(
+        BACNET_TAG * tag,
+        float *value);
+    bool bactag_double(
+        BACNET_TAG * tag,
+        double *value);
+    bool bactag_object_id(
+        BACNET_TAG * tag,
+        BACNET_OBJECT_TYPE * object_type,
+        uint32_t * instance);
+    bool bactag_date(
+        BACNET_TAG * tag,
+        BACNET_DATE * bdate);
+    bool bactag_time(
+        BACNET_TAG * tag,
+        BACNET_TIME * btime);
+    bool bactag_character_string(
+        BACNET_TAG * tag,
+        BACNET_CHARACTER_STRING * char_string);
+    bool bactag_octet_string(
+        BACNET_TAG * tag,
+        BACNET_OCTET_STRING * octet_string);
+    bool bactag_bit_string(
+        BACNET_TAG * tag,
+        BACNET_BIT_STRING * bit_string);
+
+#ifdef TEST
+#include "ctest.h"
+    void testBACnetTagCursor(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -211,10 +211,20 @@ extern "C" {
         uint8_t * buffer,
         BACNET_EVENT_NOTIFICATION_DATA * data,
         BACNET_ADDRESS * dest);
+    int Send_UEvent_Notify_Encoded(
+        uint8_t * buffer,
+        uint8_t * apdu,
+        int apdu_len,
+        BACNET_ADDRESS * dest);
 
     uint8_t Send_CEvent_Notify(
         uint32_t device_id,
         BACNET_EVENT_NOTIFICATION_DATA * data);
+    uint8_t Send_CEvent_Notify_Encoded(
+        BACNET_ADDRESS * dest,
+        unsigned max_apdu,
+        uint8_t * apdu,
+        int apdu_len);
 
     int Send_Network_Layer_Message(
         BACNET_NETWORK_MESSAGE_TYPE network_message_type,
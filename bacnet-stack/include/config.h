@@ -116,6 +116,53 @@
 #if !defined(MAX_TSM_TRANSACTIONS)
 #define MAX_TSM_TRANSACTIONS 255
 #endif
+/* Segmentation of ComplexACK responses that do not fit in the peer's */
+/* max APDU, and reassembly of segmented ComplexACKs sent to us. */
+/* MAX_SEGMENTS is the number of segments in one message (2..64), */
+/* or zero to disable segmentation.  Each of the MAX_SEGMENT_BUFFERS */
+/* holds one whole message (MAX_SEGMENTS * MAX_APDU octets) while it */
+/* is being sent or reassembled.  A message is passed on with a 16-bit */
+/* length, so it must fit in 65535 octets: at most 44 segments of a */
+/* MAX_APDU of 1476.  Segmentation needs the TSM. */
+#if !defined(MAX_SEGMENTS) || (!MAX_TSM_TRANSACTIONS)
+#undef MAX_SEGMENTS
+#define MAX_SEGMENTS 0
+#endif
+#if ((MAX_SEGMENTS * MAX_APDU) > 65535)
+#error MAX_SEGMENTS * MAX_APDU must fit in a 16-bit APDU length
+#endif
+#if !defined(MAX_SEGMENT_BUFFERS)
+#define MAX_SEGMENT_BUFFERS 2
+#endif
+/* Cache of encoded property values that seldom change, such as the */
+/* Object_Name, Description, Units and Property_List, so that devices */
+/* polled by several clients do not encode them on every read. */
+/* MAX_PROPERTY_CACHE is the number of cached values, or zero to */
+/* disable the cache.  The cache is not keyed by device, so it is */
+/* not used with BAC_ROUTING. */
+#if !defined(MAX_PROPERTY_CACHE) || defined(BAC_ROUTING)
+#undef MAX_PROPERTY_CACHE
+#define MAX_PROPERTY_CACHE 0
+#endif
+/* Object names and descriptions that objects keep as handles into */
+/* one pool of interned strings: the size of the pool in octets, */
+/* which holds each different string once with four octets more, */
+/* plus two octets.  A string is freed when nothing refers to it. */
+#if !defined(MAX_STRING_POOL)
+#define MAX_STRING_POOL 4096
+#endif
+/* Objects in alarm or with unacknowledged transitions, kept in one */
+/* index for GetEventInformation and GetAlarmSummary.  With more of */
+/* them, the services look at every object, as without an index. */
+#if !defined(MAX_ACTIVE_EVENTS)
+#define MAX_ACTIVE_EVENTS 64
+#endif
+/* Objects with intrinsic reporting are evaluated when they are due, */
+/* from a timer wheel of one second slots.  Deadlines further away */
+/* than the number of slots go round the wheel more than once. */
+#if !defined(EVENT_SCHEDULE_SLOTS)
+#define EVENT_SCHEDULE_SLOTS 64
+#endif
 /* The address cache is used for binding to BACnet devices */
 /* The number of entries corresponds to the number of */
 /* devices that might respond to an I-Am on the network. */
@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "bacapp.h"
+#include "bactag.h"
 
 typedef struct BACnet_COV_Data {
     uint32_t subscriberProcessIdentifier;
@@ -37,6 +38,22 @@ typedef struct BACnet_COV_Data {
     BACNET_PROPERTY_VALUE *listOfValues;
 } BACNET_COV_DATA;
 
+/* PDU header, subscriberProcessIdentifier, initiatingDeviceIdentifier
+   and monitoredObjectIdentifier */
+#define MAX_COV_NOTIFY_TEMPLATE_LEN (4+5+5+5)
+
+/** A COV notification of Present_Value and Status_Flags, encoded up to
+ * its timeRemaining.  Only the invoke ID, the time remaining and the two
+ * values are filled in for each notification. */
+typedef struct BACnet_COV_Notify_Template {
+    uint8_t apdu[MAX_COV_NOTIFY_TEMPLATE_LEN];
+    uint8_t apdu_len;
+    bool confirmed;
+    uint32_t subscriberProcessIdentifier;
+    uint32_t initiatingDeviceIdentifier;
+    BACNET_OBJECT_ID monitoredObjectIdentifier;
+} BACNET_COV_NOTIFY_TEMPLATE;
+
 struct BACnet_Subscribe_COV_Data;
 typedef struct BACnet_Subscribe_COV_Data {
     uint32_t subscriberProcessIdentifier;
@@ -86,6 +103,31 @@ extern "C" {
         unsigned apdu_len,
         BACNET_COV_DATA * data);
 
+    bool cov_notify_value_find(
+        uint8_t * apdu,
+        unsigned apdu_len,
+        BACNET_PROPERTY_ID property,
+        uint32_t array_index,
+        BACNET_TAG_CURSOR * value);
+
+    void cov_notify_template_init(
+        BACNET_COV_NOTIFY_TEMPLATE * cov_template,
+        bool confirmed,
+        BACNET_COV_DATA * data);
+
+    bool cov_notify_template_valid(
+        BACNET_COV_NOTIFY_TEMPLATE * cov_template,
+        bool confirmed,
+        BACNET_COV_DATA * data);
+
+    int cov_notify_template_encode(
+        uint8_t * apdu,
+        BACNET_COV_NOTIFY_TEMPLATE * cov_template,
+        uint8_t invoke_id,
+        uint32_t timeRemaining,
+        BACNET_APPLICATION_DATA_VALUE * present_value,
+        BACNET_APPLICATION_DATA_VALUE * status_flags);
+
     int cov_subscribe_property_decode_service_request(
         uint8_t * apdu,
         unsigned apdu_len,
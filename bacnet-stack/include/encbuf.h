@@ -0,0 +1,137 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef ENCBUF_H
+#define ENCBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacenum.h"
+
+/* longest encoding that may be written via encbuf_encode_begin() */
+#define ENCBUF_SCRATCH_SIZE 16
+
+/**
+* Encode buffer: an APDU that is encoded in place, front to back, with
+* a check of the space left before each write.  A write that does not
+* fit fails and leaves the buffer as it was, and so does every write
+* after it; rolling back to a mark discards what was written since the
+* mark and clears the failure.
+*
+* The size is the number of octets the encoding may use.  The room is
+* the number of octets that may be written, which may be more than the
+* size: encoders that only know an upper limit of what they will write
+* may then write straight into the buffer via encbuf_reserve().
+* Short encodings are written via encbuf_encode_begin() and
+* encbuf_encode_end(), and go through a scratch near the end.
+*
+* @{
+*/
+typedef struct BACnet_Encode_Buffer {
+    /** start of the encoding */
+    uint8_t *buffer;
+    /** number of octets the encoding may use */
+    unsigned size;
+    /** number of octets that may be written, not less than size */
+    unsigned room;
+    /** number of octets encoded */
+    unsigned len;
+    /** set when a write did not fit */
+    bool overflow;
+    /** where short encodings go when the room is nearly used */
+    uint8_t scratch[ENCBUF_SCRATCH_SIZE];
+} BACNET_ENCODE_BUFFER;
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void encbuf_init(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t * buffer,
+        unsigned size,
+        unsigned room);
+
+    unsigned encbuf_remaining(
+        BACNET_ENCODE_BUFFER const *b);
+
+    unsigned encbuf_mark(
+        BACNET_ENCODE_BUFFER const *b);
+    void encbuf_rollback(
+        BACNET_ENCODE_BUFFER * b,
+        unsigned mark);
+
+    uint8_t *encbuf_reserve(
+        BACNET_ENCODE_BUFFER * b,
+        unsigned max_len);
+    bool encbuf_commit(
+        BACNET_ENCODE_BUFFER * b,
+        unsigned len);
+
+    uint8_t *encbuf_encode_begin(
+        BACNET_ENCODE_BUFFER * b);
+    bool encbuf_encode_end(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t * apdu,
+        int len);
+
+    bool encbuf_append(
+        BACNET_ENCODE_BUFFER * b,
+        const uint8_t * data,
+        unsigned len);
+    bool encbuf_opening_tag(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t tag_number);
+    bool encbuf_closing_tag(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t tag_number);
+    bool encbuf_application_enumerated(
+        BACNET_ENCODE_BUFFER * b,
+        uint32_t value);
+    bool encbuf_context_enumerated(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t tag_number,
+        uint32_t value);
+    bool encbuf_context_unsigned(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t tag_number,
+        uint32_t value);
+    bool encbuf_context_object_id(
+        BACNET_ENCODE_BUFFER * b,
+        uint8_t tag_number,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t instance);
+
+#ifdef TEST
+#include "ctest.h"
+    void testEncodeBuffer(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
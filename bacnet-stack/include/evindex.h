@@ -0,0 +1,88 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef EVINDEX_H
+#define EVINDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+
+/**
+* Active event index: the objects whose Event_State is not NORMAL, or
+* that have a transition that is not acknowledged, in the order of
+* their object identifiers.  GetEventInformation and GetAlarmSummary
+* read the index rather than asking every object for its events.
+*
+* Objects with intrinsic reporting call evindex_maintain() for their
+* object type when they are initialized, and evindex_update() whenever
+* their Event_State or Acked_Transitions change.  The services ask every
+* object of the other object types.  The index holds up to
+* MAX_ACTIVE_EVENTS objects; after it has run out of room, it is no
+* longer complete, and the services ask every object again.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void evindex_init(
+        void);
+
+    void evindex_maintain(
+        BACNET_OBJECT_TYPE object_type);
+    bool evindex_maintained(
+        BACNET_OBJECT_TYPE object_type);
+
+    bool evindex_update(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        unsigned object_index,
+        bool active);
+
+    bool evindex_complete(
+        void);
+    unsigned evindex_count(
+        void);
+    bool evindex_entry(
+        unsigned position,
+        BACNET_OBJECT_TYPE * object_type,
+        uint32_t * object_instance,
+        unsigned *object_index);
+    unsigned evindex_position_after(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+
+#ifdef TEST
+#include "ctest.h"
+    void testEventIndex(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,94 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef EVSCHED_H
+#define EVSCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+
+/**
+* Intrinsic reporting schedule: rather than every object being asked
+* to evaluate its event state once a second, each object with
+* intrinsic reporting keeps one timer, and is only evaluated when its
+* timer is due.
+*
+* An object initializes its timer with evsched_timer_init() once, and
+* schedules it when its Present_Value, its event parameters, or its
+* acknowledgements change, and, while a Time_Delay is counting down,
+* for the next second.  evsched_run() is called once a second, and
+* calls back for each object that is due.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    typedef struct bacnet_event_timer {
+        struct bacnet_event_timer *next;
+        struct bacnet_event_timer *prev;
+        uint32_t object_id;
+        uint32_t due;
+        uint16_t slot;
+        bool scheduled;
+    } BACNET_EVENT_TIMER;
+
+    typedef void (
+        *evsched_function) (
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+
+    void evsched_init(
+        void);
+
+    void evsched_timer_init(
+        BACNET_EVENT_TIMER * timer,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    void evsched_schedule(
+        BACNET_EVENT_TIMER * timer,
+        uint32_t seconds);
+    void evsched_cancel(
+        BACNET_EVENT_TIMER * timer);
+
+    unsigned evsched_run(
+        evsched_function callback);
+    unsigned evsched_pending(
+        void);
+    bool evsched_object_type(
+        BACNET_OBJECT_TYPE object_type);
+
+#ifdef TEST
+#include "ctest.h"
+    void testEventSchedule(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
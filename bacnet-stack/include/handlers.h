@@ -35,6 +35,7 @@
 #include "rd.h"
 #include "rp.h"
 #include "rpm.h"
+#include "rpm_ack.h"
 #include "wp.h"
 #include "readrange.h"
 #include "getevent.h"
@@ -42,6 +43,18 @@
 #include "alarm_ack.h"
 
 
+/** Gets the value of a property of an object without encoding it,
+ * such as Device_Value_Get().
+ * @return True if the value was got, else false, and the property
+ *         is read with the Read_Property function of the object.
+ */
+typedef bool(
+    *read_property_value_function) (
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value);
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -109,6 +122,9 @@ extern "C" {
         BACNET_ADDRESS * src,
         BACNET_CONFIRMED_SERVICE_DATA * service_data);
 
+    void handler_read_property_value_set(
+        read_property_value_function pFunction);
+
     void handler_read_property_ack(
         uint8_t * service_request,
         uint16_t service_len,
@@ -224,6 +240,10 @@ extern "C" {
     /* print the RPM Ack data to stdout */
     void rpm_ack_print_data(
         BACNET_READ_ACCESS_DATA * rpm_data);
+    /* print an object of a compact decoded RPM Ack to stdout */
+    void rpm_ack_print_compact(
+        BACNET_RPM_ACK_DATA * ack_data,
+        BACNET_RPM_ACK_OBJECT * rpm_object);
 
     void handler_cov_subscribe(
         uint8_t * service_request,
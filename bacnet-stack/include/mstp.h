@@ -30,6 +30,21 @@
 #include <stdbool.h>
 #include "mstpdef.h"
 
+/* counters kept by the adaptive tuning - see MSTP_Adaptive_Enable() */
+typedef struct mstp_adaptive_counters {
+    /* tokens received by this node */
+    uint32_t Tokens;
+    /* token holds that used every information frame allowed */
+    uint32_t SaturatedHolds;
+    /* token holds that ended because nothing was left to send */
+    uint32_t DrainedHolds;
+    /* number of times Nmax_info_frames was raised or lowered */
+    uint32_t InfoFramesRaised;
+    uint32_t InfoFramesLowered;
+    /* maintenance Poll For Master frames that were not sent */
+    uint32_t PollsSkipped;
+} MSTP_ADAPTIVE_COUNTERS;
+
 struct mstp_port_struct_t {
     MSTP_RECEIVE_STATE receive_state;
     /* When a master node is powered up or reset, */
@@ -154,6 +169,15 @@ struct mstp_port_struct_t {
     /* its value shall be 127. */
     uint8_t Nmax_master;
 
+    /* Timeouts of this port in milliseconds, which a port may derive */
+    /* from the bit time at its baud rate. Zero selects the default. */
+    /* Frame_Abort_Timeout is Tframe_abort: 60 bit times, at most 100ms. */
+    uint16_t Frame_Abort_Timeout;
+    /* Reply_Timeout is Treply_timeout: 255 to 300 milliseconds. */
+    uint16_t Reply_Timeout;
+    /* Usage_Timeout is Tusage_timeout: 20 to 100 milliseconds. */
+    uint16_t Usage_Timeout;
+
     /* An array of octets, used to store octets for transmitting */
     /* OutputBuffer is indexed from 0 to OutputBufferSize-1. */
     /* The maximum size of a frame is 501 octets. */
@@ -164,6 +188,31 @@ struct mstp_port_struct_t {
     uint8_t *OutputBuffer;
     uint16_t OutputBufferSize;
 
+    /* Adaptive tuning from the observed trunk load, off unless enabled */
+    /* by MSTP_Adaptive_Enable(). Nmax_info_frames is raised towards */
+    /* Nlimit_info_frames while this node keeps using every frame of its */
+    /* token holds, and lowered back towards Nmin_info_frames (the */
+    /* configured Max_Info_Frames) once its queue drains. Maintenance */
+    /* Poll For Master frames to addresses that did not answer the last */
+    /* poll are only sent every Nadaptive_repoll cycles. */
+    unsigned Adaptive:1;
+    uint8_t Nmin_info_frames;
+    uint8_t Nlimit_info_frames;
+    /* how the last token hold ended, and how many in a row saturated */
+    uint8_t HoldOutcome;
+    uint8_t SaturatedCount;
+    /* maintenance Poll For Master cycles completed */
+    uint8_t PollCycle;
+    /* one bit per master address that did not answer its last poll */
+    uint8_t PollSilent[16];
+    /* octets seen on the wire, and sent by this node, since the token */
+    /* was last received, and the same for the last full rotation */
+    uint32_t RotationOctets;
+    uint32_t RotationOwnOctets;
+    uint32_t TokenRotationOctets;
+    uint32_t TokenRotationOwnOctets;
+    MSTP_ADAPTIVE_COUNTERS AdaptiveCounters;
+
     /*Platform-specific port data */
     void *UserData;
 
@@ -184,6 +233,10 @@ extern "C" {
     void MSTP_Slave_Node_FSM(
         volatile struct mstp_port_struct_t *mstp_port);
 
+    void MSTP_Adaptive_Enable(
+        volatile struct mstp_port_struct_t *mstp_port,
+        uint8_t max_info_frames_limit);
+
     /* returns true if line is active */
     bool MSTP_Line_Active(
         volatile struct mstp_port_struct_t *mstp_port);
@@ -119,6 +119,15 @@ typedef enum {
 /* 15 milliseconds. */
 #define Tusage_delay 15
 
+/* Adaptive tuning (see MSTP_Adaptive_Enable): the number of token holds */
+/* in a row that must use every information frame before Nmax_info_frames */
+/* is raised, the share of a token rotation in percent that a node may */
+/* already use and still be raised, and the number of maintenance Poll */
+/* For Master cycles between polls of an address that did not answer. */
+#define Nadaptive_holds 2
+#define Nadaptive_share 50
+#define Nadaptive_repoll 8
+
 #define DEFAULT_MAX_INFO_FRAMES 1
 #define DEFAULT_MAX_MASTER 127
 #define DEFAULT_MAC_ADDRESS 127
@@ -47,6 +47,14 @@ typedef struct bacnet_npdu_data_t {
     uint8_t hop_count;
 } BACNET_NPDU_DATA;
 
+/** The NPDU header that this device puts on its replies, encoded once.
+ * Only the destination is filled in for each send. */
+typedef struct bacnet_npdu_template_t {
+    uint8_t npdu[MAX_NPDU];     /**< header for a local destination */
+    uint8_t npdu_len;
+    uint8_t hop_count;
+} BACNET_NPDU_TEMPLATE;
+
 struct router_port_t;
 /** The info[] string has no agreed-upon purpose, hence it is useless.
  * Keeping it short here. This size could be 0-255. */
@@ -79,6 +87,16 @@ extern "C" {
         bool data_expecting_reply,
         BACNET_MESSAGE_PRIORITY priority);
 
+    void npdu_template_init(
+        BACNET_NPDU_TEMPLATE * npdu_template,
+        BACNET_ADDRESS * src,
+        BACNET_NPDU_DATA * npdu_data);
+
+    int npdu_template_encode(
+        uint8_t * npdu,
+        BACNET_NPDU_TEMPLATE * npdu_template,
+        BACNET_ADDRESS * dest);
+
     void npdu_copy_data(
         BACNET_NPDU_DATA * dest,
         BACNET_NPDU_DATA * src);
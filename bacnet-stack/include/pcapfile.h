@@ -0,0 +1,119 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+#ifndef PCAPFILE_H
+#define PCAPFILE_H
+
+/* Functional Description: libpcap capture file writer and reader for
+   the capture tools.  The writer batches packets into a large aligned
+   buffer that is written to disk when it fills or when the flush
+   interval expires, and it starts a new file when a packet, size, or
+   time limit is reached.  The reader maps the whole file into memory and
+   hands out pointers to each packet in place.  The implementation is
+   in the ports directory. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* libpcap data link types (DLT) */
+#define PCAP_DLT_EN10MB 1
+#define PCAP_DLT_BACNET_MS_TP 165
+
+/* size of the libpcap file header and of each packet record header */
+#define PCAP_GLOBAL_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+
+/* size of the write buffer - a multiple of the page size */
+#ifndef PCAP_WRITER_BUFFER_SIZE
+#define PCAP_WRITER_BUFFER_SIZE (256UL*1024UL)
+#endif
+/* default time between writes of a partly filled buffer */
+#ifndef PCAP_WRITER_FLUSH_MILLISECONDS
+#define PCAP_WRITER_FLUSH_MILLISECONDS 1000
+#endif
+
+/* one packet from a capture file - data points into the mapped file */
+struct pcap_packet {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+    uint8_t *data;
+};
+
+/* gets a copy of every block written to the file, such as a pipe
+   to a live Wireshark.  The file header is only passed once. */
+typedef void (
+    *pcap_mirror_function) (
+    const uint8_t * buffer,
+    size_t length);
+/* called just before a full file is closed and the next one started */
+typedef void (
+    *pcap_rotate_function) (
+    const char *filename);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void Pcap_Writer_Init(
+        const char *prefix,
+        uint32_t link_type);
+    void Pcap_Writer_Rotate_Set(
+        uint32_t max_packets,
+        uint32_t max_kilobytes,
+        uint32_t max_seconds);
+    void Pcap_Writer_Flush_Interval_Set(
+        uint32_t milliseconds);
+    void Pcap_Writer_Mirror_Set(
+        pcap_mirror_function mirror);
+    void Pcap_Writer_Rotate_Callback_Set(
+        pcap_rotate_function callback);
+    bool Pcap_Writer_Open(
+        void);
+    const char *Pcap_Writer_Filename(
+        void);
+    uint8_t *Pcap_Writer_Packet(
+        uint32_t ts_sec,
+        uint32_t ts_usec,
+        uint32_t length);
+    void Pcap_Writer_Poll(
+        void);
+    void Pcap_Writer_Flush(
+        void);
+    void Pcap_Writer_Close(
+        void);
+
+    bool Pcap_Reader_Open(
+        const char *filename,
+        uint32_t * link_type);
+    bool Pcap_Reader_Next(
+        struct pcap_packet *packet);
+    void Pcap_Reader_Close(
+        void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,84 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef PROPCACHE_H
+#define PROPCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "rp.h"
+
+/* longest encoded value that is cached, at most 255 octets;
+   longer values are always encoded by the object */
+#ifndef MAX_PROPERTY_CACHE_VALUE
+#define MAX_PROPERTY_CACHE_VALUE 96
+#endif
+
+/**
+* Property cache: the encoded values of properties that seldom change,
+* keyed by object type, object instance, property and array index.
+*
+* Each object has a version, which is part of every value cached for
+* it.  Code that changes a cached property of an object - other than
+* via Device_Write_Property(), which does it already - calls
+* propcache_invalidate() for the object, which moves the version on,
+* so that the values cached with the old version are never read.
+*
+* The cache is sized by MAX_PROPERTY_CACHE in config.h.  When it is
+* zero, nothing is cached and every read is a miss.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool propcache_property_cacheable(
+        BACNET_PROPERTY_ID object_property);
+
+    int propcache_read(
+        BACNET_READ_PROPERTY_DATA * rpdata);
+    void propcache_store(
+        BACNET_READ_PROPERTY_DATA const *rpdata,
+        int apdu_len);
+
+    void propcache_invalidate(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    void propcache_invalidate_all(
+        void);
+
+#ifdef TEST
+#include "ctest.h"
+    void testPropertyCache(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -42,6 +42,7 @@ extern "C" {
         BACNET_BIT_STRING ResultFlags;  /**<  FIRST_ITEM, LAST_ITEM, MORE_ITEMS. */
         int RequestType;/**< Index, sequence or time based request. */
         int Overhead;    /**< How much space the baggage takes in the response. */
+        int MaxApdu;     /**< Size of the response APDU the items must fit in. */
         uint32_t ItemCount;
         uint32_t FirstSequence;
         union { /**< Pick the appropriate data type. */
@@ -101,7 +102,7 @@ extern "C" {
 
 /** Define pointer to function type for handling ReadRange request.
    This function will take the following parameters:
-  - 1. A pointer to a buffer of at least MAX_APDU bytes to build the response in.
+  - 1. A pointer to a buffer of at least MaxApdu bytes to build the response in.
   - 2. A pointer to a BACNET_READ_RANGE_DATA structure with all the request
       information in it. The function is responsible for applying the request
       to the property in question and returning the response. */
@@ -40,6 +40,16 @@ typedef struct BACnet_Read_Property_Data {
     BACNET_ERROR_CODE error_code;
 } BACNET_READ_PROPERTY_DATA;
 
+/* object identifier, property identifier, array index and opening tag */
+#define MAX_RP_ACK_TEMPLATE_LEN (3+5+5+6+1)
+
+/** The ReadProperty-ACK of one property, encoded up to its value.
+ * Only the invoke ID and the value are filled in for each reply. */
+typedef struct BACnet_Read_Property_Ack_Template {
+    uint8_t apdu[MAX_RP_ACK_TEMPLATE_LEN];
+    uint8_t apdu_len;
+} BACNET_RP_ACK_TEMPLATE;
+
 /* Forward declaration of RPM-style data structure */
 struct BACnet_Read_Access_Data;
 
@@ -87,6 +97,29 @@ extern "C" {
         uint8_t invoke_id,
         BACNET_READ_PROPERTY_DATA * rpdata);
 
+    /* method to encode the ack of a fixed-shape reply */
+    void rp_ack_template_init(
+        BACNET_RP_ACK_TEMPLATE * rp_template,
+        BACNET_READ_PROPERTY_DATA * rpdata);
+
+    int rp_ack_template_encode_real(
+        uint8_t * apdu,
+        BACNET_RP_ACK_TEMPLATE * rp_template,
+        uint8_t invoke_id,
+        float value);
+
+    int rp_ack_template_encode_enumerated(
+        uint8_t * apdu,
+        BACNET_RP_ACK_TEMPLATE * rp_template,
+        uint8_t invoke_id,
+        uint32_t value);
+
+    int rp_ack_template_encode_unsigned(
+        uint8_t * apdu,
+        BACNET_RP_ACK_TEMPLATE * rp_template,
+        uint8_t invoke_id,
+        uint32_t value);
+
     int rp_ack_decode_service_request(
         uint8_t * apdu,
         int apdu_len,   /* total length of the apdu */
@@ -30,6 +30,7 @@
 #include "bacdef.h"
 #include "bacapp.h"
 #include "proplist.h"
+#include "encbuf.h"
 /*
  * Bundle together commonly used data items for convenience when calling
  * rpm helper functions.
@@ -152,6 +153,29 @@ extern "C" {
     int rpm_ack_encode_apdu_object_end(
         uint8_t * apdu);
 
+/* RPM Ack - encoded in place, with capacity checks */
+    bool rpm_ack_encode_buffer_object_begin(
+        BACNET_ENCODE_BUFFER * buffer,
+        BACNET_RPM_DATA * rpmdata);
+
+    bool rpm_ack_encode_buffer_object_property(
+        BACNET_ENCODE_BUFFER * buffer,
+        BACNET_PROPERTY_ID object_property,
+        uint32_t array_index);
+
+    bool rpm_ack_encode_buffer_object_property_value(
+        BACNET_ENCODE_BUFFER * buffer,
+        uint8_t * application_data,
+        unsigned application_data_len);
+
+    bool rpm_ack_encode_buffer_object_property_error(
+        BACNET_ENCODE_BUFFER * buffer,
+        BACNET_ERROR_CLASS error_class,
+        BACNET_ERROR_CODE error_code);
+
+    bool rpm_ack_encode_buffer_object_end(
+        BACNET_ENCODE_BUFFER * buffer);
+
     int rpm_ack_decode_object_id(
         uint8_t * apdu,
         unsigned apdu_len,
@@ -186,6 +210,8 @@ extern "C" {
         Test * pTest);
     void testReadPropertyMultipleAck(
         Test * pTest);
+    void testReadPropertyMultipleAckBuffer(
+        Test * pTest);
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,110 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef RPM_ACK_H
+#define RPM_ACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacenum.h"
+#include "bacdef.h"
+#include "bacapp.h"
+#include "arena.h"
+#include "bactag.h"
+
+/*
+ * Compact decoding of a ReadPropertyMultiple-ACK: every object,
+ * property and value of the ACK is taken from one arena, values use
+ * BACNET_COMPACT_VALUE, and the whole result is released by freeing
+ * (or resetting) the arena.
+ */
+
+struct BACnet_RPM_Ack_Property;
+typedef struct BACnet_RPM_Ack_Property {
+    BACNET_PROPERTY_ID propertyIdentifier;
+    uint32_t propertyArrayIndex;        /* optional */
+    /* list of values; NULL for an error or an empty list */
+    BACNET_COMPACT_VALUE *value;
+    /* true if the property was read with an error */
+    bool error_present;
+    BACNET_ACCESS_ERROR error;
+    /* simple linked list */
+    struct BACnet_RPM_Ack_Property *next;
+} BACNET_RPM_ACK_PROPERTY;
+
+struct BACnet_RPM_Ack_Object;
+typedef struct BACnet_RPM_Ack_Object {
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    /* simple linked list of results */
+    BACNET_RPM_ACK_PROPERTY *listOfProperties;
+    struct BACnet_RPM_Ack_Object *next;
+} BACNET_RPM_ACK_OBJECT;
+
+typedef struct BACnet_RPM_Ack_Data {
+    /* the service data that the offsets of the values refer to */
+    uint8_t *service_data;
+    unsigned service_data_len;
+    /* simple linked list of objects */
+    BACNET_RPM_ACK_OBJECT *objects;
+    unsigned object_count;
+    unsigned property_count;
+    unsigned value_count;
+} BACNET_RPM_ACK_DATA;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    int rpm_ack_decode_compact(
+        uint8_t * service_request,
+        unsigned service_len,
+        bool copy,
+        ARENA * arena,
+        BACNET_RPM_ACK_DATA * ack_data);
+
+    bool rpm_ack_value_find(
+        uint8_t * service_request,
+        unsigned service_len,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID property,
+        uint32_t array_index,
+        BACNET_TAG_CURSOR * value);
+
+    bool rpm_ack_value_expand(
+        BACNET_RPM_ACK_DATA * ack_data,
+        BACNET_COMPACT_VALUE * value,
+        BACNET_APPLICATION_DATA_VALUE * application_value);
+
+#ifdef TEST
+#include "ctest.h"
+    void testRPMAckCompact(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
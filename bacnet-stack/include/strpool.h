@@ -0,0 +1,95 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "bacstr.h"
+
+#if (MAX_STRING_POOL > 65535)
+#error MAX_STRING_POOL must fit in a string handle
+#endif
+
+/* longest string in the pool */
+#define STRPOOL_STRING_MAX 255
+
+/**
+* String pool: text that objects keep, such as their names, interned in
+* one pool and referred to by a two octet handle.  Equal strings share
+* one copy and one handle, so that handles compare like the strings.
+* Handle zero is the empty string, which zero-initialized handles are.
+* Strings are counted: interning into a handle releases the string it
+* held, so a rename frees the old name once nothing else refers to it.
+*
+* @{
+*/
+typedef uint16_t BACNET_STRING_HANDLE;
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void strpool_init(
+        void);
+
+    void strpool_release(
+        BACNET_STRING_HANDLE handle);
+
+    bool strpool_intern(
+        const char *value,
+        size_t length,
+        BACNET_STRING_HANDLE * handle);
+    bool strpool_intern_ansi(
+        const char *value,
+        BACNET_STRING_HANDLE * handle);
+    bool strpool_intern_characterstring(
+        BACNET_CHARACTER_STRING * char_string,
+        BACNET_STRING_HANDLE * handle);
+
+    const char *strpool_string(
+        BACNET_STRING_HANDLE handle);
+    size_t strpool_length(
+        BACNET_STRING_HANDLE handle);
+    bool strpool_characterstring(
+        BACNET_CHARACTER_STRING * char_string,
+        BACNET_STRING_HANDLE handle);
+
+    size_t strpool_used(
+        void);
+
+#ifdef TEST
+#include "ctest.h"
+    void testStringPool(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "bacdef.h"
+#include "apdu.h"
 #include "npdu.h"
 
 /* note: TSM functionality is optional - only needed if we are
@@ -40,30 +41,49 @@ typedef enum {
     TSM_STATE_AWAIT_CONFIRMATION,
     TSM_STATE_AWAIT_RESPONSE,
     TSM_STATE_SEGMENTED_REQUEST,
-    TSM_STATE_SEGMENTED_CONFIRMATION
+    TSM_STATE_SEGMENTED_CONFIRMATION,
+    TSM_STATE_SEGMENTED_RESPONSE
 } BACNET_TSM_STATE;
 
+#if MAX_SEGMENTS
+/* size of one segment buffer: a whole segmented message */
+#define TSM_SEGMENT_BUFFER_SIZE (MAX_SEGMENTS * MAX_APDU)
+/* the window size we propose when sending or receiving segments */
+#ifndef TSM_PROPOSED_WINDOW_SIZE
+#define TSM_PROPOSED_WINDOW_SIZE 4
+#endif
+#endif
+
 /* 5.4.1 Variables And Parameters */
 /* The following variables are defined for each instance of  */
 /* Transaction State Machine: */
 typedef struct BACnet_TSM_Data {
     /* used to count APDU retries */
     uint8_t RetryCount;
+#if MAX_SEGMENTS
     /* used to count segment retries */
-    /*uint8_t SegmentRetryCount;  */
+    uint8_t SegmentRetryCount;
     /* used to control APDU retries and the acceptance of server replies */
-    /*bool SentAllSegments;  */
+    bool SentAllSegments;
     /* stores the sequence number of the last segment received in order */
-    /*uint8_t LastSequenceNumber; */
+    uint8_t LastSequenceNumber;
     /* stores the sequence number of the first segment of */
     /* a sequence of segments that fill a window */
-    /*uint8_t InitialSequenceNumber; */
+    uint8_t InitialSequenceNumber;
     /* stores the current window size */
-    /*uint8_t ActualWindowSize; */
+    uint8_t ActualWindowSize;
     /* stores the window size proposed by the segment sender */
-    /*uint8_t ProposedWindowSize;  */
-    /*  used to perform timeout on PDU segments */
-    /*uint8_t SegmentTimer; */
+    uint8_t ProposedWindowSize;
+    /*  used to perform timeout on PDU segments, in milliseconds */
+    uint16_t SegmentTimer;
+    /* the whole segmented message: the unsegmented APDU being sent,
+       or the service data reassembled so far */
+    uint8_t *segment_buffer;
+    unsigned segment_len;
+    /* number of segments, and service data octets in each segment */
+    uint8_t segment_count;
+    uint16_t segment_size;
+#endif
     /* used to perform timeout on Confirmed Requests */
     /* in milliseconds */
     uint16_t RequestTimer;
@@ -126,6 +146,33 @@ extern "C" {
     bool tsm_invoke_id_failed(
         uint8_t invokeID);
 
+#if MAX_SEGMENTS
+    uint8_t *tsm_segment_buffer_claim(
+        void);
+    void tsm_segment_buffer_release(
+        uint8_t * buffer);
+    unsigned tsm_segmented_complex_ack_max(
+        BACNET_CONFIRMED_SERVICE_DATA * service_data);
+    bool tsm_segmented_complex_ack_send(
+        BACNET_ADDRESS * dest,
+        BACNET_NPDU_DATA * npdu_data,
+        BACNET_CONFIRMED_SERVICE_DATA * service_data,
+        uint8_t * buffer,
+        unsigned apdu_len);
+    void tsm_segment_ack_handler(
+        BACNET_ADDRESS * src,
+        uint8_t * apdu,
+        uint16_t apdu_len);
+    bool tsm_segmented_complex_ack_handler(
+        BACNET_ADDRESS * src,
+        BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+        uint8_t ** service_request,
+        uint16_t * service_request_len);
+    void tsm_abort_segmented_response(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
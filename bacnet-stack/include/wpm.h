@@ -30,6 +30,7 @@
 #include "bacdcode.h"
 #include "bacapp.h"
 #include "wp.h"
+#include "encbuf.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -84,6 +85,10 @@ extern "C" {
         uint8_t * apdu,
         uint8_t invoke_id,
         BACNET_WRITE_PROPERTY_DATA * wp_data);
+    bool wpm_error_ack_encode_buffer(
+        BACNET_ENCODE_BUFFER * buffer,
+        uint8_t invoke_id,
+        BACNET_WRITE_PROPERTY_DATA * wp_data);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,433 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+#include "bittime.h"
+
+/** @file linux/bittime.c  Bit time model of an MS/TP port on Linux. */
+
+/* the MS/TP turnaround: 40 bit times */
+#define BITTIME_TURNAROUND_BITS 40
+
+/*************************************************************************
+* Description: returns the CLOCK_MONOTONIC time
+* Returns: nanoseconds
+* Notes: none
+*************************************************************************/
+uint64_t bittime_now(
+    void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/*************************************************************************
+* Description: sets the bit time from the baud rate
+* Returns: none
+* Notes: a baud rate of zero is treated as 9600
+*************************************************************************/
+void bittime_set_baud(
+    BITTIME * bt,
+    uint32_t baud)
+{
+    if (baud == 0) {
+        baud = 9600;
+    }
+    bt->bit_ns = (1000000000UL + (baud / 2)) / baud;
+}
+
+/*************************************************************************
+* Description: Initialization of the model and of its timer
+* Returns: none
+* Notes: the line is silent from now on
+*************************************************************************/
+void bittime_init(
+    BITTIME * bt,
+    uint32_t baud)
+{
+    bittime_set_baud(bt, baud);
+    bt->silence_start = bittime_now();
+    bt->tx_end = 0;
+    bt->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    bt->timer_deadline = 0;
+}
+
+void bittime_cleanup(
+    BITTIME * bt)
+{
+    if (bt->timer_fd >= 0) {
+        close(bt->timer_fd);
+        bt->timer_fd = -1;
+    }
+}
+
+/*************************************************************************
+* Description: converts bit times to time
+* Returns: nanoseconds
+* Notes: none
+*************************************************************************/
+uint64_t bittime_bits(
+    BITTIME * bt,
+    uint32_t bits)
+{
+    return (uint64_t) bits *bt->bit_ns;
+}
+
+/*************************************************************************
+* Description: converts bit times to whole milliseconds, rounding up
+*              plus one millisecond since the silence timer of the
+*              state machines only counts whole milliseconds
+* Returns: milliseconds
+* Notes: none
+*************************************************************************/
+uint16_t bittime_bits_milliseconds(
+    BITTIME * bt,
+    uint32_t bits)
+{
+    return (uint16_t) (1 + ((bittime_bits(bt, bits) + 999999) / 1000000));
+}
+
+/*************************************************************************
+* Description: time since the last activity on the line
+* Returns: nanoseconds, zero while this node is still transmitting
+* Notes: none
+*************************************************************************/
+uint64_t bittime_silence(
+    BITTIME * bt)
+{
+    uint64_t now = bittime_now();
+
+    if (now <= bt->silence_start) {
+        return 0;
+    }
+
+    return now - bt->silence_start;
+}
+
+uint32_t bittime_silence_milliseconds(
+    BITTIME * bt)
+{
+    return (uint32_t) (bittime_silence(bt) / 1000000);
+}
+
+/*************************************************************************
+* Description: restarts the silence timer on line activity
+* Returns: none
+* Notes: a frame still being transmitted keeps the line active
+*************************************************************************/
+void bittime_silence_reset(
+    BITTIME * bt)
+{
+    uint64_t now = bittime_now();
+
+    if (now > bt->tx_end) {
+        bt->silence_start = now;
+    } else {
+        bt->silence_start = bt->tx_end;
+    }
+}
+
+/*************************************************************************
+* Description: waits for the turnaround time after the last octet
+*              received before this node may enable its driver
+* Returns: none
+* Notes: no wait is needed when the last octet on the line was our own
+*************************************************************************/
+void bittime_turnaround_wait(
+    BITTIME * bt)
+{
+    uint64_t deadline;
+    struct timespec ts;
+
+    if (bt->silence_start <= bt->tx_end) {
+        return;
+    }
+    deadline =
+        bt->silence_start + bittime_bits(bt, BITTIME_TURNAROUND_BITS);
+    if (bittime_now() >= deadline) {
+        return;
+    }
+    ts.tv_sec = deadline / 1000000000ULL;
+    ts.tv_nsec = deadline % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+            NULL) == EINTR) {
+        /* sleep again for the rest of the turnaround */
+    }
+}
+
+/*************************************************************************
+* Description: accounts for a frame handed to the UART
+* Returns: none
+* Notes: the octets follow any octets still in the UART, and the
+*        silence timer starts when the last of them leaves the wire
+*************************************************************************/
+void bittime_transmit(
+    BITTIME * bt,
+    uint16_t octets)
+{
+    uint64_t now = bittime_now();
+
+    if (bt->tx_end < now) {
+        bt->tx_end = now;
+    }
+    bt->tx_end += bittime_bits(bt, (uint32_t) octets * BITTIME_OCTET_BITS);
+    bt->silence_start = bt->tx_end;
+}
+
+/*************************************************************************
+* Description: arms the timer to expire at the deadline
+* Returns: true if the timer is armed
+* Notes: a deadline of zero disarms the timer
+*************************************************************************/
+bool bittime_timer_arm(
+    BITTIME * bt,
+    uint64_t deadline)
+{
+    struct itimerspec its;
+
+    if (bt->timer_fd < 0) {
+        return false;
+    }
+    if (deadline == bt->timer_deadline) {
+        return (deadline != 0);
+    }
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = deadline / 1000000000ULL;
+    its.it_value.tv_nsec = deadline % 1000000000ULL;
+    if (timerfd_settime(bt->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        bt->timer_deadline = 0;
+        return false;
+    }
+    bt->timer_deadline = deadline;
+
+    return (deadline != 0);
+}
+
+/*************************************************************************
+* Description: acknowledges an expired timer
+* Returns: none
+* Notes: none
+*************************************************************************/
+void bittime_timer_clear(
+    BITTIME * bt)
+{
+    uint64_t expirations;
+
+    if (bt->timer_fd >= 0) {
+        if (read(bt->timer_fd, &expirations, sizeof(expirations)) > 0) {
+            bt->timer_deadline = 0;
+        }
+    }
+}
+
+#ifdef TEST_BITTIME
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <termios.h>
+
+/* a late wake up beyond this is a failure */
+#ifndef BITTIME_TEST_TOLERANCE
+#define BITTIME_TEST_TOLERANCE 2000000ULL
+#endif
+
+static int Test_Failures;
+
+/* opens both ends of a pseudo-terminal in raw mode */
+static bool test_pty_open(
+    int *master_fd,
+    int *slave_fd)
+{
+    char name[64];
+    unsigned pty_number = 0;
+    int unlock = 0;
+    struct termios tio;
+
+    *master_fd = open("/dev/ptmx", O_RDWR | O_NOCTTY);
+    if (*master_fd < 0) {
+        return false;
+    }
+    if ((ioctl(*master_fd, TIOCSPTLCK, &unlock) < 0) ||
+        (ioctl(*master_fd, TIOCGPTN, &pty_number) < 0)) {
+        close(*master_fd);
+        return false;
+    }
+    snprintf(name, sizeof(name), "/dev/pts/%u", pty_number);
+    *slave_fd = open(name, O_RDWR | O_NOCTTY);
+    if (*slave_fd < 0) {
+        close(*master_fd);
+        return false;
+    }
+    memset(&tio, 0, sizeof(tio));
+    tio.c_cflag = CS8 | CLOCAL | CREAD;
+    tcsetattr(*slave_fd, TCSANOW, &tio);
+    tcsetattr(*master_fd, TCSANOW, &tio);
+
+    return true;
+}
+
+static void test_result(
+    const char *name,
+    uint32_t baud,
+    uint64_t expected,
+    uint64_t measured)
+{
+    bool pass = (measured >= expected) &&
+        ((measured - expected) <= BITTIME_TEST_TOLERANCE);
+
+    printf("%-12s %6lu %10.1f %10.1f %8.1f  %s\n", name,
+        (unsigned long) baud, expected / 1000.0, measured / 1000.0,
+        ((double) measured - (double) expected) / 1000.0,
+        pass ? "ok" : "FAIL");
+    if (!pass) {
+        Test_Failures++;
+    }
+}
+
+/* a node sends a frame: the line stays busy for its transmit time */
+static void test_transmit(
+    BITTIME * bt,
+    int tx_fd,
+    int rx_fd,
+    uint32_t baud)
+{
+    uint8_t frame[512];
+    uint16_t octets = 60;
+    uint64_t start;
+    uint64_t expected;
+
+    memset(frame, 0x55, sizeof(frame));
+    start = bittime_now();
+    if (write(tx_fd, frame, octets) != octets) {
+        Test_Failures++;
+        return;
+    }
+    bittime_transmit(bt, octets);
+    expected = bittime_bits(bt, octets * BITTIME_OCTET_BITS);
+    while (bittime_silence(bt) == 0) {
+        /* the frame is on the wire */
+    }
+    test_result("transmit", baud, expected, bittime_now() - start);
+    tcflush(rx_fd, TCIFLUSH);
+}
+
+/* a node answers a frame: it waits for the turnaround time */
+static void test_turnaround(
+    BITTIME * bt,
+    int tx_fd,
+    int rx_fd,
+    uint32_t baud)
+{
+    uint8_t octet = 0x55;
+    uint64_t start;
+
+    if (write(tx_fd, &octet, 1) != 1) {
+        Test_Failures++;
+        return;
+    }
+    if (read(rx_fd, &octet, 1) != 1) {
+        Test_Failures++;
+        return;
+    }
+    bt->tx_end = 0;
+    bittime_silence_reset(bt);
+    start = bt->silence_start;
+    bittime_turnaround_wait(bt);
+    test_result("turnaround", baud, bittime_bits(bt,
+            BITTIME_TURNAROUND_BITS), bittime_now() - start);
+}
+
+/* a node waits for silence: the timer wakes it at the deadline */
+static void test_timer(
+    BITTIME * bt,
+    int rx_fd,
+    uint32_t baud,
+    uint32_t bits)
+{
+    fd_set input;
+    uint64_t start;
+    uint64_t expected = bittime_bits(bt, bits);
+    int max_fd;
+
+    start = bittime_now();
+    if (!bittime_timer_arm(bt, start + expected)) {
+        Test_Failures++;
+        return;
+    }
+    do {
+        FD_ZERO(&input);
+        FD_SET(rx_fd, &input);
+        FD_SET(bt->timer_fd, &input);
+        max_fd = (rx_fd > bt->timer_fd) ? rx_fd : bt->timer_fd;
+        if (select(max_fd + 1, &input, NULL, NULL, NULL) < 0) {
+            Test_Failures++;
+            return;
+        }
+    } while (!FD_ISSET(bt->timer_fd, &input));
+    bittime_timer_clear(bt);
+    test_result(bits == 60 ? "frame abort" : "timer", baud, expected,
+        bittime_now() - start);
+}
+
+int main(
+    void)
+{
+    uint32_t baud_rates[] = { 9600, 19200, 38400, 57600, 76800, 115200 };
+    BITTIME bt;
+    int master_fd, slave_fd;
+    unsigned i, j;
+
+    if (!test_pty_open(&master_fd, &slave_fd)) {
+        perror("/dev/ptmx");
+        return 1;
+    }
+    printf("%-12s %6s %10s %10s %8s\n", "test", "baud", "expect_us",
+        "actual_us", "late_us");
+    for (i = 0; i < sizeof(baud_rates) / sizeof(baud_rates[0]); i++) {
+        bittime_init(&bt, baud_rates[i]);
+        for (j = 0; j < 3; j++) {
+            test_transmit(&bt, slave_fd, master_fd, baud_rates[i]);
+            test_turnaround(&bt, master_fd, slave_fd, baud_rates[i]);
+            test_timer(&bt, slave_fd, baud_rates[i], 60);
+        }
+        bittime_cleanup(&bt);
+    }
+    close(slave_fd);
+    close(master_fd);
+    printf("%d failures\n", Test_Failures);
+
+    return Test_Failures ? 1 : 0;
+}
+#endif
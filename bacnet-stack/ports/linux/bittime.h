@@ -0,0 +1,94 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*********************************************************************/
+#ifndef BITTIME_H
+#define BITTIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Bit time model of an MS/TP port.  Times are CLOCK_MONOTONIC */
+/* nanoseconds.  The end of a frame that was handed to the UART is */
+/* predicted from the baud rate, so the silence timer starts when the */
+/* last octet leaves the wire rather than when write() returns. */
+typedef struct bittime {
+    /* nanoseconds per bit at the baud rate of the port */
+    uint32_t bit_ns;
+    /* time of the last activity on the line; in the future while */
+    /* a frame is still being shifted out */
+    uint64_t silence_start;
+    /* time the last octet written by this node leaves the wire */
+    uint64_t tx_end;
+    /* timerfd used to wake up at the next deadline, or -1 */
+    int timer_fd;
+    /* deadline the timer is armed for, zero when disarmed */
+    uint64_t timer_deadline;
+} BITTIME;
+
+/* number of bit times in an octet: start bit, 8 data bits, stop bit */
+#define BITTIME_OCTET_BITS 10
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    uint64_t bittime_now(
+        void);
+    void bittime_init(
+        BITTIME * bt,
+        uint32_t baud);
+    void bittime_cleanup(
+        BITTIME * bt);
+    void bittime_set_baud(
+        BITTIME * bt,
+        uint32_t baud);
+    uint64_t bittime_bits(
+        BITTIME * bt,
+        uint32_t bits);
+    uint16_t bittime_bits_milliseconds(
+        BITTIME * bt,
+        uint32_t bits);
+
+    uint64_t bittime_silence(
+        BITTIME * bt);
+    uint32_t bittime_silence_milliseconds(
+        BITTIME * bt);
+    void bittime_silence_reset(
+        BITTIME * bt);
+
+    void bittime_turnaround_wait(
+        BITTIME * bt);
+    void bittime_transmit(
+        BITTIME * bt,
+        uint16_t octets);
+
+    bool bittime_timer_arm(
+        BITTIME * bt,
+        uint64_t deadline);
+    void bittime_timer_clear(
+        BITTIME * bt);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -7,6 +7,7 @@ INCLUDES = -I. -I../../
 CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
 
 SRCS = rs485.c \
+	bittime.c \
 	dlmstp.c \
 	../../mstp.c \
 	../../crc.c
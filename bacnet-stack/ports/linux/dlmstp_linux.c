@@ -48,10 +48,16 @@
 #define BACNET_DATA_EXPECTING_REPLY(control) ( (control & (1 << BACNET_DATA_EXPECTING_REPLY_BIT) ) > 0 )
 
 #define INCREMENT_AND_LIMIT_UINT16(x) {if (x < 0xFFFF) x++;}
+
+/* Tframe_abort when the port does not set one: the 95 milliseconds */
+/* of src/mstp.c, as USB to RS-485 adapters deliver octets in bursts */
+#ifndef DLMSTP_TFRAME_ABORT
+#define DLMSTP_TFRAME_ABORT 95
+#endif
+
 uint32_t Timer_Silence(
     void *poPort)
 {
-    struct timeval now, tmp_diff;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port =
         (struct mstp_port_struct_t *) poPort;
@@ -63,13 +69,7 @@ uint32_t Timer_Silence(
         return -1;
     }
 
-    int32_t res;
-
-    gettimeofday(&now, NULL);
-    timersub(&poSharedData->start, &now, &tmp_diff);
-    res = ((tmp_diff.tv_sec) * 1000 + (tmp_diff.tv_usec) / 1000);
-
-    return (res >= 0 ? res : -res);
+    return bittime_silence_milliseconds(&poSharedData->Bit_Time);
 }
 
 void Timer_Silence_Reset(
@@ -86,7 +86,80 @@ void Timer_Silence_Reset(
         return;
     }
 
-    gettimeofday(&poSharedData->start, NULL);
+    bittime_silence_reset(&poSharedData->Bit_Time);
+}
+
+/* sets the timeouts of the port from its bit time */
+static void dlmstp_bit_timing(
+    struct mstp_port_struct_t *mstp_port,
+    SHARED_MSTP_DATA * poSharedData)
+{
+    uint32_t frame_abort = poSharedData->Tframe_abort;
+    uint32_t frame_abort_min =
+        bittime_bits_milliseconds(&poSharedData->Bit_Time, 60);
+
+    /* Tframe_abort: at least 60 bit times, at most 100 milliseconds */
+    if (frame_abort == 0)
+        frame_abort = DLMSTP_TFRAME_ABORT;
+    if (frame_abort < frame_abort_min)
+        frame_abort = frame_abort_min;
+    if (frame_abort > 100)
+        frame_abort = 100;
+    mstp_port->Frame_Abort_Timeout = (uint16_t) frame_abort;
+    mstp_port->Reply_Timeout = poSharedData->Treply_timeout;
+    mstp_port->Usage_Timeout = poSharedData->Tusage_timeout;
+}
+
+/* returns the silence in milliseconds after which the state machines
+   act on their own, or zero if they only act on line activity */
+static uint32_t dlmstp_next_timeout(
+    struct mstp_port_struct_t *mstp_port)
+{
+    uint32_t timeout = 0;
+
+    switch (mstp_port->master_state) {
+        case MSTP_MASTER_STATE_IDLE:
+            timeout = Tno_token;
+            break;
+        case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
+            timeout = mstp_port->Reply_Timeout;
+            break;
+        case MSTP_MASTER_STATE_PASS_TOKEN:
+        case MSTP_MASTER_STATE_POLL_FOR_MASTER:
+            timeout = mstp_port->Usage_Timeout;
+            break;
+        case MSTP_MASTER_STATE_NO_TOKEN:
+            timeout = Tno_token + (Tslot * mstp_port->This_Station);
+            break;
+        default:
+            break;
+    }
+    if ((mstp_port->receive_state != MSTP_RECEIVE_STATE_IDLE) &&
+        (mstp_port->Frame_Abort_Timeout) &&
+        ((timeout == 0) || (mstp_port->Frame_Abort_Timeout < timeout))) {
+        timeout = mstp_port->Frame_Abort_Timeout;
+    }
+
+    return timeout;
+}
+
+/* arms the port timer for the next timeout of the state machines */
+static void dlmstp_arm_timer(
+    struct mstp_port_struct_t *mstp_port,
+    SHARED_MSTP_DATA * poSharedData)
+{
+    BITTIME *bt = &poSharedData->Bit_Time;
+    uint32_t timeout = dlmstp_next_timeout(mstp_port);
+    uint64_t deadline = 0;
+
+    if (timeout) {
+        /* the state machines compare whole milliseconds of silence */
+        deadline = bt->silence_start + ((timeout + 1) * 1000000ULL);
+        if (deadline <= bittime_now()) {
+            deadline = 0;
+        }
+    }
+    bittime_timer_arm(bt, deadline);
 }
 
 void get_abstime(
@@ -121,6 +194,7 @@ void dlmstp_cleanup(
     tcsetattr(poSharedData->RS485_Handle, TCSANOW,
         &poSharedData->RS485_oldtio);
     close(poSharedData->RS485_Handle);
+    bittime_cleanup(&poSharedData->Bit_Time);
 
     pthread_cond_destroy(&poSharedData->Received_Frame_Flag);
     pthread_cond_destroy(&poSharedData->Receive_Packet_Flag);
@@ -177,7 +251,6 @@ uint16_t dlmstp_receive(
 {       /* milliseconds to wait for a packet */
     uint16_t pdu_len = 0;
     struct timespec abstime;
-    int rv = 0;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port =
         (struct mstp_port_struct_t *) poPort;
@@ -191,26 +264,28 @@ uint16_t dlmstp_receive(
     (void) max_pdu;
     /* see if there is a packet available, and a place
        to put the reply (if necessary) and process it */
-    get_abstime(&abstime, timeout);
-    rv = pthread_cond_timedwait(&poSharedData->Receive_Packet_Flag,
-        &poSharedData->Receive_Packet_Mutex, &abstime);
-    if (rv == 0) {
-        if (poSharedData->Receive_Packet.ready) {
-            if (poSharedData->Receive_Packet.pdu_len) {
-                poSharedData->MSTP_Packets++;
-                if (src) {
-                    memmove(src, &poSharedData->Receive_Packet.address,
-                        sizeof(poSharedData->Receive_Packet.address));
-                }
-                if (pdu) {
-                    memmove(pdu, &poSharedData->Receive_Packet.pdu,
-                        sizeof(poSharedData->Receive_Packet.pdu));
-                }
-                pdu_len = poSharedData->Receive_Packet.pdu_len;
+    pthread_mutex_lock(&poSharedData->Receive_Packet_Mutex);
+    if (!poSharedData->Receive_Packet.ready) {
+        get_abstime(&abstime, timeout);
+        pthread_cond_timedwait(&poSharedData->Receive_Packet_Flag,
+            &poSharedData->Receive_Packet_Mutex, &abstime);
+    }
+    if (poSharedData->Receive_Packet.ready) {
+        if (poSharedData->Receive_Packet.pdu_len) {
+            poSharedData->MSTP_Packets++;
+            if (src) {
+                memmove(src, &poSharedData->Receive_Packet.address,
+                    sizeof(poSharedData->Receive_Packet.address));
+            }
+            if (pdu) {
+                memmove(pdu, &poSharedData->Receive_Packet.pdu,
+                    sizeof(poSharedData->Receive_Packet.pdu));
             }
-            poSharedData->Receive_Packet.ready = false;
+            pdu_len = poSharedData->Receive_Packet.pdu_len;
         }
+        poSharedData->Receive_Packet.ready = false;
     }
+    pthread_mutex_unlock(&poSharedData->Receive_Packet_Mutex);
 
     return pdu_len;
 }
@@ -272,6 +347,7 @@ void *dlmstp_master_fsm_task(
     for (;;) {
         if (mstp_port->ReceivedValidFrame == false &&
             mstp_port->ReceivedInvalidFrame == false) {
+            dlmstp_arm_timer(mstp_port, poSharedData);
             RS485_Check_UART_Data(mstp_port);
             MSTP_Receive_Frame_FSM(mstp_port);
         }
@@ -347,6 +423,7 @@ uint16_t MSTP_Put_Receive(
         return 0;
     }
 
+    pthread_mutex_lock(&poSharedData->Receive_Packet_Mutex);
     if (!poSharedData->Receive_Packet.ready) {
         /* bounds check - maybe this should send an abort? */
         pdu_len = mstp_port->DataLength;
@@ -360,6 +437,7 @@ uint16_t MSTP_Put_Receive(
         poSharedData->Receive_Packet.ready = true;
         pthread_cond_signal(&poSharedData->Receive_Packet_Flag);
     }
+    pthread_mutex_unlock(&poSharedData->Receive_Packet_Mutex);
 
     return pdu_len;
 }
@@ -673,6 +751,11 @@ void dlmstp_set_max_info_frames(
 	}
 */
     if (max_info_frames >= 1) {
+        if (mstp_port->Adaptive) {
+            /* restart the tuning from the new configured value */
+            mstp_port->Nmin_info_frames = max_info_frames;
+            MSTP_Adaptive_Enable(mstp_port, mstp_port->Nlimit_info_frames);
+        }
         mstp_port->Nmax_info_frames = max_info_frames;
         /* FIXME: implement your data storage */
         /* I2C_Write_Byte(
@@ -700,9 +783,26 @@ uint8_t dlmstp_max_info_frames(
 		return 0;
 	}
 */
+    if (mstp_port->Adaptive) {
+        /* the configured value rather than the tuned one */
+        return mstp_port->Nmin_info_frames;
+    }
+
     return mstp_port->Nmax_info_frames;
 }
 
+void dlmstp_set_adaptive(
+    void *poPort,
+    uint8_t max_info_frames_limit)
+{
+    struct mstp_port_struct_t *mstp_port =
+        (struct mstp_port_struct_t *) poPort;
+    if (!mstp_port) {
+        return;
+    }
+    MSTP_Adaptive_Enable(mstp_port, max_info_frames_limit);
+}
+
 /* This parameter represents the value of the Max_Master property of the */
 /* node's Device object. The value of Max_Master specifies the highest */
 /* allowable address for master nodes. The value of Max_Master shall be */
@@ -791,8 +891,10 @@ void dlmstp_set_baud_rate(
             poSharedData->RS485_Baud = B115200;
             break;
         default:
-            break;
+            return;
     }
+    bittime_set_baud(&poSharedData->Bit_Time, baud);
+    dlmstp_bit_timing(mstp_port, poSharedData);
 }
 
 uint32_t dlmstp_baud_rate(
@@ -961,7 +1063,8 @@ bool dlmstp_init(
     mstp_port->InputBufferSize = sizeof(poSharedData->RxBuffer);
     mstp_port->OutputBuffer = &poSharedData->TxBuffer[0];
     mstp_port->OutputBufferSize = sizeof(poSharedData->TxBuffer);
-    gettimeofday(&poSharedData->start, NULL);
+    bittime_init(&poSharedData->Bit_Time, dlmstp_baud_rate(mstp_port));
+    dlmstp_bit_timing(mstp_port, poSharedData);
     mstp_port->SilenceTimer = Timer_Silence;
     mstp_port->SilenceTimerReset = Timer_Silence_Reset;
     MSTP_Init(mstp_port);
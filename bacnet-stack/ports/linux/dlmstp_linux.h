@@ -36,6 +36,7 @@
 #include <termios.h>
 #include "fifo.h"
 #include "ringbuf.h"
+#include "bittime.h"
 /* defines specific to MS/TP */
 /* preamble+type+dest+src+len+crc8+crc16 */
 #define MAX_HEADER (2+1+1+1+2+1+2)
@@ -97,6 +98,10 @@ typedef struct shared_mstp_data {
     /* a Poll For Master frame: 20 milliseconds. (Implementations may use */
     /* larger values for this timeout, not to exceed 100 milliseconds.) */
     uint8_t Tusage_timeout;
+    /* The silence after which a frame being received is aborted: at */
+    /* least 60 bit times, not to exceed 100 milliseconds. USB to RS-485 */
+    /* adapters deliver octets in bursts, so zero selects 95 milliseconds. */
+    uint16_t Tframe_abort;
     /* Timer that indicates line silence - and functions */
     uint16_t SilenceTime;
 
@@ -116,7 +121,8 @@ typedef struct shared_mstp_data {
     FIFO_BUFFER Rx_FIFO;
     /* buffer size needs to be a power of 2 */
     uint8_t Rx_Buffer[4096];
-    struct timeval start;
+    /* silence timer, turnaround and deadlines in bit times of the port */
+    BITTIME Bit_Time;
 
     RING_BUFFER PDU_Queue;
 
@@ -164,6 +170,13 @@ extern "C" {
     uint8_t dlmstp_max_info_frames(
         void *poShared);
 
+    /* Lets the node raise its Max_Info_Frames up to the given limit while */
+    /* its queue keeps every token hold busy, and skip maintenance polls of */
+    /* addresses that did not answer. A limit of 0 turns the tuning off. */
+    void dlmstp_set_adaptive(
+        void *poShared,
+        uint8_t max_info_frames_limit);
+
     /* This parameter represents the value of the Max_Master property of the */
     /* node's Device object. The value of Max_Master specifies the highest */
     /* allowable address for master nodes. The value of Max_Master shall be */
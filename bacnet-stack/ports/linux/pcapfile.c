@@ -0,0 +1,508 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "pcapfile.h"
+
+/** @file linux/pcapfile.c  Buffered libpcap file writer and
+ * memory mapped libpcap file reader. */
+
+#define PCAP_MAGIC_NUMBER 0xa1b2c3d4UL
+#define PCAP_MAGIC_NUMBER_SWAPPED 0xd4c3b2a1UL
+#define PCAP_MAGIC_NUMBER_NSEC 0xa1b23c4dUL
+#define PCAP_MAGIC_NUMBER_NSEC_SWAPPED 0x4d3cb2a1UL
+#define PCAP_SNAPLEN 65535UL
+
+/* writer */
+static char Writer_Prefix[16] = "capture";
+static char Writer_Filename[64];
+static uint32_t Writer_Link_Type = PCAP_DLT_BACNET_MS_TP;
+static int Writer_FD = -1;
+/* the buffer is page aligned so that full buffers go to the
+   page cache without an extra copy of a partial page */
+static uint8_t Writer_Buffer[PCAP_WRITER_BUFFER_SIZE]
+    __attribute__ ((aligned(4096)));
+static size_t Writer_Length;
+/* octets at the front of the buffer that the mirror already has */
+static size_t Writer_Mirror_Skip;
+static bool Writer_Mirror_Header_Sent;
+static pcap_mirror_function Writer_Mirror;
+static pcap_rotate_function Writer_Rotate_Callback;
+/* rotation limits - zero is unlimited */
+static uint32_t Writer_Max_Packets;
+static uint32_t Writer_Max_Kilobytes;
+static uint32_t Writer_Max_Seconds;
+/* current file */
+static uint32_t Writer_Packets;
+static uint64_t Writer_Bytes;
+static time_t Writer_Start;
+/* periodic flush of a partly filled buffer */
+static uint32_t Writer_Flush_Milliseconds = PCAP_WRITER_FLUSH_MILLISECONDS;
+static struct timespec Writer_Flush_Time;
+
+/* reader */
+static uint8_t *Reader_Buffer;
+static size_t Reader_Size;
+static size_t Reader_Offset;
+static bool Reader_Swapped;
+static bool Reader_Nanoseconds;
+
+static void encode_host_uint32(
+    uint8_t * buffer,
+    uint32_t value)
+{
+    memcpy(buffer, &value, sizeof(value));
+}
+
+static void encode_host_uint16(
+    uint8_t * buffer,
+    uint16_t value)
+{
+    memcpy(buffer, &value, sizeof(value));
+}
+
+static uint32_t decode_host_uint32(
+    const uint8_t * buffer)
+{
+    uint32_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+
+    return value;
+}
+
+static uint32_t swap_uint32(
+    uint32_t value)
+{
+    return ((value & 0x000000FFUL) << 24) | ((value & 0x0000FF00UL) << 8) |
+        ((value & 0x00FF0000UL) >> 8) | ((value & 0xFF000000UL) >> 24);
+}
+
+static uint32_t reader_uint32(
+    const uint8_t * buffer)
+{
+    uint32_t value = decode_host_uint32(buffer);
+
+    if (Reader_Swapped) {
+        value = swap_uint32(value);
+    }
+
+    return value;
+}
+
+static uint16_t reader_uint16(
+    const uint8_t * buffer)
+{
+    uint16_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+    if (Reader_Swapped) {
+        value = (uint16_t) ((value << 8) | (value >> 8));
+    }
+
+    return value;
+}
+
+static uint32_t milliseconds_since(
+    struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t) ((now.tv_sec - start->tv_sec) * 1000 +
+        (now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+static bool write_all(
+    int fd,
+    const uint8_t * buffer,
+    size_t length)
+{
+    ssize_t bytes;
+
+    while (length) {
+        bytes = write(fd, buffer, length);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buffer += bytes;
+        length -= (size_t) bytes;
+    }
+
+    return true;
+}
+
+/*************************************************************************
+* Description: Sets the file name prefix and the data link type
+* Returns: none
+* Notes: files are named prefix_YYYYMMDDhhmmss.cap
+*************************************************************************/
+void Pcap_Writer_Init(
+    const char *prefix,
+    uint32_t link_type)
+{
+    if (prefix) {
+        snprintf(Writer_Prefix, sizeof(Writer_Prefix), "%s", prefix);
+    }
+    Writer_Link_Type = link_type;
+}
+
+/*************************************************************************
+* Description: Sets the limits that start a new capture file
+* Returns: none
+* Notes: a limit of zero is unlimited
+*************************************************************************/
+void Pcap_Writer_Rotate_Set(
+    uint32_t max_packets,
+    uint32_t max_kilobytes,
+    uint32_t max_seconds)
+{
+    Writer_Max_Packets = max_packets;
+    Writer_Max_Kilobytes = max_kilobytes;
+    Writer_Max_Seconds = max_seconds;
+}
+
+void Pcap_Writer_Flush_Interval_Set(
+    uint32_t milliseconds)
+{
+    Writer_Flush_Milliseconds = milliseconds;
+}
+
+void Pcap_Writer_Mirror_Set(
+    pcap_mirror_function mirror)
+{
+    Writer_Mirror = mirror;
+}
+
+void Pcap_Writer_Rotate_Callback_Set(
+    pcap_rotate_function callback)
+{
+    Writer_Rotate_Callback = callback;
+}
+
+const char *Pcap_Writer_Filename(
+    void)
+{
+    return Writer_Filename;
+}
+
+/*************************************************************************
+* Description: Writes the buffered packets to the file and the mirror
+* Returns: none
+* Notes: none
+*************************************************************************/
+void Pcap_Writer_Flush(
+    void)
+{
+    if ((Writer_FD != -1) && (Writer_Length > 0)) {
+        if (!write_all(Writer_FD, Writer_Buffer, Writer_Length)) {
+            fprintf(stderr, "pcap: failed to write %s: %s\n",
+                Writer_Filename, strerror(errno));
+        }
+        if (Writer_Mirror && (Writer_Length > Writer_Mirror_Skip)) {
+            Writer_Mirror(&Writer_Buffer[Writer_Mirror_Skip],
+                Writer_Length - Writer_Mirror_Skip);
+        }
+    }
+    Writer_Length = 0;
+    Writer_Mirror_Skip = 0;
+    clock_gettime(CLOCK_MONOTONIC, &Writer_Flush_Time);
+}
+
+/*************************************************************************
+* Description: Creates a new capture file and buffers its header
+* Returns: true if the file was created
+* Notes: a sequence number is added if the name is already used
+*************************************************************************/
+bool Pcap_Writer_Open(
+    void)
+{
+    uint8_t *header;
+    time_t my_time;
+    struct tm *today;
+    unsigned sequence = 0;
+    int length;
+
+    Pcap_Writer_Close();
+    my_time = time(NULL);
+    today = localtime(&my_time);
+    length =
+        snprintf(Writer_Filename, sizeof(Writer_Filename),
+        "%s_%04d%02d%02d%02d%02d%02d", Writer_Prefix, 1900 + today->tm_year,
+        1 + today->tm_mon, today->tm_mday, today->tm_hour, today->tm_min,
+        today->tm_sec);
+    if ((length < 0) || (length >= (int) sizeof(Writer_Filename) - 12)) {
+        return false;
+    }
+    for (;;) {
+        if (sequence) {
+            sprintf(&Writer_Filename[length], "_%u.cap", sequence);
+        } else {
+            sprintf(&Writer_Filename[length], ".cap");
+        }
+        Writer_FD =
+            open(Writer_Filename, O_WRONLY | O_CREAT | O_EXCL | O_TRUNC,
+            0666);
+        if ((Writer_FD != -1) || (errno != EEXIST) || (sequence >= 999)) {
+            break;
+        }
+        sequence++;
+    }
+    if (Writer_FD == -1) {
+        fprintf(stderr, "pcap: failed to open %s: %s\n", Writer_Filename,
+            strerror(errno));
+        return false;
+    }
+    Writer_Packets = 0;
+    Writer_Bytes = PCAP_GLOBAL_HEADER_SIZE;
+    Writer_Start = my_time;
+    header = &Writer_Buffer[0];
+    encode_host_uint32(&header[0], PCAP_MAGIC_NUMBER);
+    /* version 2.4 */
+    encode_host_uint16(&header[4], 2);
+    encode_host_uint16(&header[6], 4);
+    /* GMT to local correction */
+    encode_host_uint32(&header[8], 0);
+    /* accuracy of timestamps */
+    encode_host_uint32(&header[12], 0);
+    encode_host_uint32(&header[16], PCAP_SNAPLEN);
+    encode_host_uint32(&header[20], Writer_Link_Type);
+    Writer_Length = PCAP_GLOBAL_HEADER_SIZE;
+    if (Writer_Mirror_Header_Sent) {
+        Writer_Mirror_Skip = PCAP_GLOBAL_HEADER_SIZE;
+    } else {
+        Writer_Mirror_Skip = 0;
+        Writer_Mirror_Header_Sent = true;
+    }
+    /* write the header right away so the file is valid */
+    Pcap_Writer_Flush();
+
+    return true;
+}
+
+void Pcap_Writer_Close(
+    void)
+{
+    if (Writer_FD != -1) {
+        Pcap_Writer_Flush();
+        close(Writer_FD);
+        Writer_FD = -1;
+    }
+}
+
+static bool rotation_time_expired(
+    void)
+{
+    return (Writer_Max_Seconds &&
+        ((time(NULL) - Writer_Start) >= (time_t) Writer_Max_Seconds));
+}
+
+static void rotate(
+    void)
+{
+    if (Writer_Rotate_Callback) {
+        Writer_Rotate_Callback(Writer_Filename);
+    }
+    (void) Pcap_Writer_Open();
+}
+
+/*************************************************************************
+* Description: Reserves room for one packet in the write buffer
+* Returns: where to put length octets of packet data, or NULL
+* Notes: the data must be filled in before the next writer call
+*************************************************************************/
+uint8_t *Pcap_Writer_Packet(
+    uint32_t ts_sec,
+    uint32_t ts_usec,
+    uint32_t length)
+{
+    uint8_t *record;
+    uint32_t record_length = PCAP_RECORD_HEADER_SIZE + length;
+
+    if ((Writer_FD == -1) || (length > PCAP_SNAPLEN)) {
+        return NULL;
+    }
+    if (Writer_Packets) {
+        if ((Writer_Max_Packets && (Writer_Packets >= Writer_Max_Packets)) ||
+            (Writer_Max_Kilobytes &&
+                ((Writer_Bytes + record_length) >
+                    ((uint64_t) Writer_Max_Kilobytes * 1024UL))) ||
+            rotation_time_expired()) {
+            rotate();
+            if (Writer_FD == -1) {
+                return NULL;
+            }
+        }
+    }
+    if ((Writer_Length + record_length) > sizeof(Writer_Buffer)) {
+        Pcap_Writer_Flush();
+    }
+    record = &Writer_Buffer[Writer_Length];
+    encode_host_uint32(&record[0], ts_sec);
+    encode_host_uint32(&record[4], ts_usec);
+    encode_host_uint32(&record[8], length);
+    encode_host_uint32(&record[12], length);
+    Writer_Length += record_length;
+    Writer_Bytes += record_length;
+    Writer_Packets++;
+
+    return &record[PCAP_RECORD_HEADER_SIZE];
+}
+
+/*************************************************************************
+* Description: Flushes the buffer and rotates the file when time is up
+* Returns: none
+* Notes: call this regularly from the main loop
+*************************************************************************/
+void Pcap_Writer_Poll(
+    void)
+{
+    if (Writer_FD == -1) {
+        return;
+    }
+    if (Writer_Packets && rotation_time_expired()) {
+        rotate();
+    } else if ((Writer_Length > 0) &&
+        (milliseconds_since(&Writer_Flush_Time) >= Writer_Flush_Milliseconds)) {
+        Pcap_Writer_Flush();
+    }
+}
+
+/*************************************************************************
+* Description: Maps a capture file into memory for reading
+* Returns: true if the file has a valid libpcap header
+* Notes: both byte orders and nanosecond files are accepted
+*************************************************************************/
+bool Pcap_Reader_Open(
+    const char *filename,
+    uint32_t * link_type)
+{
+    struct stat file_stat;
+    uint32_t magic_number;
+    void *buffer;
+    int fd;
+
+    Pcap_Reader_Close();
+    fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    if ((fstat(fd, &file_stat) == -1) ||
+        (file_stat.st_size < PCAP_GLOBAL_HEADER_SIZE)) {
+        close(fd);
+        return false;
+    }
+    buffer = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE,
+        fd, 0);
+    close(fd);
+    if (buffer == MAP_FAILED) {
+        return false;
+    }
+    Reader_Buffer = buffer;
+    Reader_Size = (size_t) file_stat.st_size;
+    (void) madvise(Reader_Buffer, Reader_Size, MADV_SEQUENTIAL);
+    magic_number = decode_host_uint32(&Reader_Buffer[0]);
+    Reader_Swapped = ((magic_number == PCAP_MAGIC_NUMBER_SWAPPED) ||
+        (magic_number == PCAP_MAGIC_NUMBER_NSEC_SWAPPED));
+    Reader_Nanoseconds = ((magic_number == PCAP_MAGIC_NUMBER_NSEC) ||
+        (magic_number == PCAP_MAGIC_NUMBER_NSEC_SWAPPED));
+    if ((!Reader_Swapped) && (!Reader_Nanoseconds) &&
+        (magic_number != PCAP_MAGIC_NUMBER)) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    /* major version 2 - the minor version has always been 4 */
+    if (reader_uint16(&Reader_Buffer[4]) != 2) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    if (link_type) {
+        *link_type = reader_uint32(&Reader_Buffer[20]);
+    }
+    Reader_Offset = PCAP_GLOBAL_HEADER_SIZE;
+
+    return true;
+}
+
+/*************************************************************************
+* Description: Gets the next packet from the mapped capture file
+* Returns: true if a complete packet was found
+* Notes: the packet data is valid until the reader is closed
+*************************************************************************/
+bool Pcap_Reader_Next(
+    struct pcap_packet *packet)
+{
+    uint8_t *record;
+    size_t remaining;
+
+    if (!Reader_Buffer) {
+        return false;
+    }
+    remaining = Reader_Size - Reader_Offset;
+    if (remaining < PCAP_RECORD_HEADER_SIZE) {
+        return false;
+    }
+    record = &Reader_Buffer[Reader_Offset];
+    packet->ts_sec = reader_uint32(&record[0]);
+    packet->ts_usec = reader_uint32(&record[4]);
+    if (Reader_Nanoseconds) {
+        packet->ts_usec /= 1000;
+    }
+    packet->incl_len = reader_uint32(&record[8]);
+    packet->orig_len = reader_uint32(&record[12]);
+    if (packet->incl_len > (remaining - PCAP_RECORD_HEADER_SIZE)) {
+        /* truncated capture */
+        return false;
+    }
+    packet->data = &record[PCAP_RECORD_HEADER_SIZE];
+    Reader_Offset += PCAP_RECORD_HEADER_SIZE + packet->incl_len;
+
+    return true;
+}
+
+void Pcap_Reader_Close(
+    void)
+{
+    if (Reader_Buffer) {
+        munmap(Reader_Buffer, Reader_Size);
+    }
+    Reader_Buffer = NULL;
+    Reader_Size = 0;
+    Reader_Offset = 0;
+}
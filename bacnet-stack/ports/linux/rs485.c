@@ -422,29 +422,18 @@ void RS485_Send_Frame(
             mstp_port->SilenceTimerReset((void *) mstp_port);
         }
     } else {
-        baud = RS485_Get_Port_Baud_Rate(mstp_port);
-        /* sleeping for turnaround time is necessary to give other devices
-           time to change from sending to receiving state. */
-        usleep(turnaround_time / baud);
-        /*
-           On  success,  the  number of bytes written are returned (zero indicates
-           nothing was written).  On error, -1  is  returned,  and  errno  is  set
-           appropriately.   If  count  is zero and the file descriptor refers to a
-           regular file, 0 will be returned without causing any other effect.  For
-           a special file, the results are not portable.
-         */
+        /* the turnaround is counted in bit times from the last octet
+           on the wire, and is not slept again after our own frame */
+        bittime_turnaround_wait(&poSharedData->Bit_Time);
         written = write(poSharedData->RS485_Handle, buffer, nbytes);
         greska = errno;
         if (written <= 0) {
             printf("write error: %s\n", strerror(greska));
         } else {
-            /* wait until all output has been transmitted. */
-            tcdrain(poSharedData->RS485_Handle);
-        }
-        /*  tcdrain(RS485_Handle); */
-        /* per MSTP spec, sort of */
-        if (mstp_port) {
-            mstp_port->SilenceTimerReset((void *) mstp_port);
+            /* rather than blocking in tcdrain() until the frame has left
+               the UART, the silence timer starts when its last octet is
+               due to leave the wire at the baud rate of the port */
+            bittime_transmit(&poSharedData->Bit_Time, (uint32_t) written);
         }
     }
 
@@ -464,6 +453,8 @@ void RS485_Check_UART_Data(
     struct timeval waiter;
     uint8_t buf[2048];
     int n;
+    int max_fd;
+    int timer_fd;
 
     SHARED_MSTP_DATA *poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
     if (!poSharedData) {
@@ -522,11 +513,22 @@ void RS485_Check_UART_Data(
         /* grab bytes and stuff them into the FIFO every time */
         FD_ZERO(&input);
         FD_SET(poSharedData->RS485_Handle, &input);
-        n = select(poSharedData->RS485_Handle + 1, &input, NULL, NULL,
-            &waiter);
+        max_fd = poSharedData->RS485_Handle;
+        /* wake up at the next timeout of the state machines */
+        timer_fd = poSharedData->Bit_Time.timer_fd;
+        if (timer_fd >= 0) {
+            FD_SET(timer_fd, &input);
+            if (timer_fd > max_fd) {
+                max_fd = timer_fd;
+            }
+        }
+        n = select(max_fd + 1, &input, NULL, NULL, &waiter);
         if (n < 0) {
             return;
         }
+        if ((timer_fd >= 0) && FD_ISSET(timer_fd, &input)) {
+            bittime_timer_clear(&poSharedData->Bit_Time);
+        }
         if (FD_ISSET(poSharedData->RS485_Handle, &input)) {
             n = read(poSharedData->RS485_Handle, buf, sizeof(buf));
             FIFO_Add(&poSharedData->Rx_FIFO, &buf[0], n);
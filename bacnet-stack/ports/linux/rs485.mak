@@ -14,6 +14,7 @@ LIBRARIES=-lc,-lgcc,-lrt,-lm
 LFLAGS = -Wl,-Map=$(TARGET).map,$(LIBRARIES),--gc-sections
 
 SRCS = rs485.c \
+	bittime.c \
 	${BACNET_SOURCE_DIR}/fifo.c
 
 OBJS = ${SRCS:.c=.o}
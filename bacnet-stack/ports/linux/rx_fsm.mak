@@ -8,6 +8,7 @@ INCLUDES = -I. -I$(INCDIR)
 CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
 
 SRCS = rs485.c \
+	bittime.c \
 	rx_fsm.c \
 	$(SRCDIR)/mstp.c \
 	$(SRCDIR)/mstptext.c \
@@ -0,0 +1,649 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bacdef.h"
+#include "bacint.h"
+#include "bacreal.h"
+#include "crc.h"
+#include "trendlog.h"
+#include "tlmmap.h"
+
+/** @file linux/tlmmap.c  Trend Log storage in memory mapped files */
+
+/* The header of a file, all numbers most significant octet first:
+    0  "BTL1"
+    4  record size (2 octets), 6  reserved (2 octets)
+    8  depth, the number of records of the ring
+   12  head, where the next record goes
+   16  record count
+   20  total record count, the sequence number of the newest record
+   24  reserved (8 octets)
+   The header is written after each record, and is trusted no further
+   than the records agree with it.
+
+   A record:
+    0  sequence number
+    4  time stamp, seconds since the epoch
+    8  record type, 9 status
+   10  datum (5 octets)
+   15  check: ones complement of the CRC-8 of the first 15 octets */
+#define TLMMAP_MAGIC "BTL1"
+#define TLMMAP_CHECK_OFFSET (TLMMAP_RECORD_SIZE - 1)
+
+struct tl_mmap_log {
+    uint8_t *pFile;
+    size_t size;
+    uint32_t ulHead;
+    uint32_t ulRecordCount;
+    uint32_t ulTotalRecordCount;
+};
+
+static char Directory[PATH_MAX - 32];
+static struct tl_mmap_log *Mmap_Logs;
+static unsigned Mmap_Log_Count;
+static uint32_t Mmap_Depth;
+
+static uint8_t tl_mmap_check(
+    const uint8_t * octets)
+{
+    uint8_t crc = 0xFF;
+    unsigned i;
+
+    for (i = 0; i < TLMMAP_CHECK_OFFSET; i++) {
+        crc = CRC_Calc_Header(octets[i], crc);
+    }
+
+    return (uint8_t) ~crc;
+}
+
+static uint8_t *tl_mmap_slot(
+    struct tl_mmap_log *Log,
+    uint32_t ulSlot)
+{
+    return &Log->pFile[TLMMAP_HEADER_SIZE + (ulSlot * TLMMAP_RECORD_SIZE)];
+}
+
+/* true if the record in a slot is whole and has the sequence number */
+static bool tl_mmap_valid(
+    struct tl_mmap_log *Log,
+    uint32_t ulSlot,
+    uint32_t ulSequence)
+{
+    uint8_t *octets = tl_mmap_slot(Log, ulSlot);
+    uint32_t ulRecordSequence = 0;
+
+    (void) decode_unsigned32(octets, &ulRecordSequence);
+
+    return (ulRecordSequence == ulSequence) &&
+        (octets[TLMMAP_CHECK_OFFSET] == tl_mmap_check(octets));
+}
+
+static void tl_mmap_header_write(
+    struct tl_mmap_log *Log)
+{
+    (void) encode_unsigned32(&Log->pFile[12], Log->ulHead);
+    (void) encode_unsigned32(&Log->pFile[16], Log->ulRecordCount);
+    (void) encode_unsigned32(&Log->pFile[20], Log->ulTotalRecordCount);
+}
+
+static void tl_mmap_pack(
+    uint8_t * octets,
+    uint32_t ulSequence,
+    const TL_DATA_REC * record)
+{
+    uint8_t *datum = &octets[10];
+
+    memset(octets, 0, TLMMAP_RECORD_SIZE);
+    (void) encode_unsigned32(&octets[0], ulSequence);
+    (void) encode_unsigned32(&octets[4], (uint32_t) record->tTimeStamp);
+    octets[8] = record->ucRecType;
+    octets[9] = record->ucStatus;
+    switch (record->ucRecType) {
+        case TL_TYPE_STATUS:
+            datum[0] = record->Datum.ucLogStatus;
+            break;
+        case TL_TYPE_BOOL:
+            datum[0] = record->Datum.ucBoolean;
+            break;
+        case TL_TYPE_REAL:
+            (void) encode_bacnet_real(record->Datum.fReal, datum);
+            break;
+        case TL_TYPE_DELTA:
+            (void) encode_bacnet_real(record->Datum.fTime, datum);
+            break;
+        case TL_TYPE_ENUM:
+            (void) encode_unsigned32(datum, record->Datum.ulEnum);
+            break;
+        case TL_TYPE_UNSIGN:
+            (void) encode_unsigned32(datum, record->Datum.ulUValue);
+            break;
+        case TL_TYPE_SIGN:
+            (void) encode_signed32(datum, record->Datum.lSValue);
+            break;
+        case TL_TYPE_BITS:
+            datum[0] = record->Datum.Bits.ucLen;
+            memcpy(&datum[1], record->Datum.Bits.ucStore, 4);
+            break;
+        case TL_TYPE_ERROR:
+            (void) encode_unsigned16(&datum[0], record->Datum.Error.usClass);
+            (void) encode_unsigned16(&datum[2], record->Datum.Error.usCode);
+            break;
+        default:
+            break;
+    }
+    octets[TLMMAP_CHECK_OFFSET] = tl_mmap_check(octets);
+}
+
+static void tl_mmap_unpack(
+    uint8_t * octets,
+    TL_DATA_REC * record)
+{
+    uint8_t *datum = &octets[10];
+    uint32_t ulValue = 0;
+
+    memset(record, 0, sizeof(TL_DATA_REC));
+    (void) decode_unsigned32(&octets[4], &ulValue);
+    record->tTimeStamp = (time_t) ulValue;
+    record->ucRecType = octets[8];
+    record->ucStatus = octets[9];
+    switch (record->ucRecType) {
+        case TL_TYPE_STATUS:
+            record->Datum.ucLogStatus = datum[0];
+            break;
+        case TL_TYPE_BOOL:
+            record->Datum.ucBoolean = datum[0];
+            break;
+        case TL_TYPE_REAL:
+            (void) decode_real(datum, &record->Datum.fReal);
+            break;
+        case TL_TYPE_DELTA:
+            (void) decode_real(datum, &record->Datum.fTime);
+            break;
+        case TL_TYPE_ENUM:
+            (void) decode_unsigned32(datum, &record->Datum.ulEnum);
+            break;
+        case TL_TYPE_UNSIGN:
+            (void) decode_unsigned32(datum, &record->Datum.ulUValue);
+            break;
+        case TL_TYPE_SIGN:
+            (void) decode_signed32(datum, &record->Datum.lSValue);
+            break;
+        case TL_TYPE_BITS:
+            record->Datum.Bits.ucLen = datum[0];
+            memcpy(record->Datum.Bits.ucStore, &datum[1], 4);
+            break;
+        case TL_TYPE_ERROR:
+            (void) decode_unsigned16(&datum[0], &record->Datum.Error.usClass);
+            (void) decode_unsigned16(&datum[2], &record->Datum.Error.usCode);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Find the newest record: step back over records the header counts
+   but which did not make it whole to the file, then forward over
+   records written after the header. When the ring is full, a record
+   that did not make it whole went in place of the oldest one, which
+   is dropped. */
+static void tl_mmap_recover(
+    struct tl_mmap_log *Log)
+{
+    uint32_t ulDepth = Mmap_Depth;
+
+    while ((Log->ulRecordCount > 0) &&
+        !tl_mmap_valid(Log, (Log->ulHead + ulDepth - 1) % ulDepth,
+            Log->ulTotalRecordCount)) {
+        Log->ulHead = (Log->ulHead + ulDepth - 1) % ulDepth;
+        Log->ulRecordCount--;
+        Log->ulTotalRecordCount--;
+    }
+    while (tl_mmap_valid(Log, Log->ulHead, Log->ulTotalRecordCount + 1)) {
+        Log->ulHead = (Log->ulHead + 1) % ulDepth;
+        Log->ulTotalRecordCount++;
+        if (Log->ulRecordCount < ulDepth) {
+            Log->ulRecordCount++;
+        }
+    }
+    if ((Log->ulRecordCount == ulDepth) &&
+        !tl_mmap_valid(Log, Log->ulHead,
+            Log->ulTotalRecordCount - ulDepth + 1)) {
+        Log->ulRecordCount--;
+    }
+}
+
+/* map the file of one log, making a new one if it has another depth */
+static bool tl_mmap_open_log(
+    unsigned iLog,
+    struct tl_mmap_log *Log)
+{
+    char filename[PATH_MAX];
+    struct stat st;
+    int fd;
+    bool fresh = false;
+    uint32_t ulDepth = 0;
+    uint16_t usRecordSize = 0;
+
+    Log->size = TLMMAP_HEADER_SIZE + ((size_t) Mmap_Depth * TLMMAP_RECORD_SIZE);
+    snprintf(filename, sizeof(filename), "%s/trendlog%u.dat", Directory,
+        iLog);
+    fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if ((fstat(fd, &st) < 0) || ((size_t) st.st_size != Log->size)) {
+        /* new, or of another depth: start again */
+        if ((ftruncate(fd, 0) < 0) || (ftruncate(fd, Log->size) < 0)) {
+            close(fd);
+            return false;
+        }
+        fresh = true;
+    }
+    Log->pFile =
+        mmap(NULL, Log->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (Log->pFile == MAP_FAILED) {
+        Log->pFile = NULL;
+        return false;
+    }
+    if (!fresh) {
+        (void) decode_unsigned16(&Log->pFile[4], &usRecordSize);
+        (void) decode_unsigned32(&Log->pFile[8], &ulDepth);
+        (void) decode_unsigned32(&Log->pFile[12], &Log->ulHead);
+        (void) decode_unsigned32(&Log->pFile[16], &Log->ulRecordCount);
+        (void) decode_unsigned32(&Log->pFile[20], &Log->ulTotalRecordCount);
+        if ((memcmp(Log->pFile, TLMMAP_MAGIC, 4) != 0) ||
+            (usRecordSize != TLMMAP_RECORD_SIZE) || (ulDepth != Mmap_Depth)
+            || (Log->ulHead >= Mmap_Depth) ||
+            (Log->ulRecordCount > Mmap_Depth)) {
+            memset(Log->pFile, 0, Log->size);
+            fresh = true;
+        }
+    }
+    if (fresh) {
+        memcpy(Log->pFile, TLMMAP_MAGIC, 4);
+        (void) encode_unsigned16(&Log->pFile[4], TLMMAP_RECORD_SIZE);
+        (void) encode_unsigned32(&Log->pFile[8], Mmap_Depth);
+        Log->ulHead = 0;
+        Log->ulRecordCount = 0;
+        Log->ulTotalRecordCount = 0;
+    } else {
+        tl_mmap_recover(Log);
+    }
+    tl_mmap_header_write(Log);
+
+    return true;
+}
+
+static void tl_mmap_close(
+    void)
+{
+    unsigned iLog;
+
+    if (Mmap_Logs) {
+        for (iLog = 0; iLog < Mmap_Log_Count; iLog++) {
+            if (Mmap_Logs[iLog].pFile) {
+                (void) msync(Mmap_Logs[iLog].pFile, Mmap_Logs[iLog].size,
+                    MS_SYNC);
+                (void) munmap(Mmap_Logs[iLog].pFile, Mmap_Logs[iLog].size);
+            }
+        }
+        free(Mmap_Logs);
+        Mmap_Logs = NULL;
+    }
+    Mmap_Log_Count = 0;
+}
+
+static bool tl_mmap_open(
+    unsigned logs,
+    uint32_t depth)
+{
+    unsigned iLog;
+
+    if (depth > ((SIZE_MAX - TLMMAP_HEADER_SIZE) / TLMMAP_RECORD_SIZE)) {
+        return false;
+    }
+    Mmap_Logs = calloc(logs, sizeof(struct tl_mmap_log));
+    if (Mmap_Logs == NULL) {
+        return false;
+    }
+    Mmap_Log_Count = logs;
+    Mmap_Depth = depth;
+    for (iLog = 0; iLog < logs; iLog++) {
+        if (!tl_mmap_open_log(iLog, &Mmap_Logs[iLog])) {
+            tl_mmap_close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void tl_mmap_append(
+    unsigned iLog,
+    const TL_DATA_REC * record)
+{
+    struct tl_mmap_log *Log = &Mmap_Logs[iLog];
+
+    /* the record first, then the header that counts it */
+    tl_mmap_pack(tl_mmap_slot(Log, Log->ulHead), Log->ulTotalRecordCount + 1,
+        record);
+    Log->ulHead++;
+    if (Log->ulHead >= Mmap_Depth) {
+        Log->ulHead = 0;
+    }
+    Log->ulTotalRecordCount++;
+    if (Log->ulRecordCount < Mmap_Depth) {
+        Log->ulRecordCount++;
+    }
+    tl_mmap_header_write(Log);
+}
+
+static bool tl_mmap_record(
+    unsigned iLog,
+    uint32_t ulSequence,
+    TL_DATA_REC * record)
+{
+    struct tl_mmap_log *Log = &Mmap_Logs[iLog];
+    uint32_t ulBack;    /* how far back from the newest record */
+    uint32_t ulSlot;
+
+    ulBack = Log->ulTotalRecordCount - ulSequence;
+    if (ulBack >= Log->ulRecordCount) {
+        return false;
+    }
+    ulSlot = (Log->ulHead + Mmap_Depth - 1 - ulBack) % Mmap_Depth;
+    /* not a record that was damaged in the file */
+    if (!tl_mmap_valid(Log, ulSlot, ulSequence)) {
+        return false;
+    }
+    tl_mmap_unpack(tl_mmap_slot(Log, ulSlot), record);
+
+    return true;
+}
+
+static void tl_mmap_counts(
+    unsigned iLog,
+    uint32_t * pulRecordCount,
+    uint32_t * pulTotalRecordCount)
+{
+    *pulRecordCount = Mmap_Logs[iLog].ulRecordCount;
+    *pulTotalRecordCount = Mmap_Logs[iLog].ulTotalRecordCount;
+}
+
+static void tl_mmap_purge(
+    unsigned iLog,
+    uint32_t ulTotalRecordCount)
+{
+    struct tl_mmap_log *Log = &Mmap_Logs[iLog];
+
+    Log->ulRecordCount = 0;
+    Log->ulTotalRecordCount = ulTotalRecordCount;
+    /* so that no older record looks like the next one */
+    memset(tl_mmap_slot(Log, Log->ulHead), 0, TLMMAP_RECORD_SIZE);
+    tl_mmap_header_write(Log);
+}
+
+static const TL_STORAGE TL_Mmap_Storage = {
+    tl_mmap_open,
+    tl_mmap_close,
+    tl_mmap_append,
+    tl_mmap_record,
+    tl_mmap_counts,
+    tl_mmap_purge
+};
+
+/** Storage for Trend_Log_Storage_Set() that keeps the records of the
+ * Trend Logs in memory mapped files.
+ *
+ * @param directory - where the files of the logs are kept
+ * @return the storage, or NULL if the directory name is too long
+ */
+const TL_STORAGE *tl_mmap_storage(
+    const char *directory)
+{
+    if ((directory == NULL) || (strlen(directory) >= sizeof(Directory))) {
+        return NULL;
+    }
+    strcpy(Directory, directory);
+
+    return &TL_Mmap_Storage;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+static void testTrendLogMmapRecord(
+    TL_DATA_REC * record,
+    uint32_t ulValue)
+{
+    memset(record, 0, sizeof(TL_DATA_REC));
+    record->tTimeStamp = 1400000000 + ulValue;
+    record->ucStatus = ulValue & 0x07;
+    switch (ulValue % 4) {
+        case 0:
+            record->ucRecType = TL_TYPE_REAL;
+            record->Datum.fReal = ulValue / 4.0f;
+            break;
+        case 1:
+            record->ucRecType = TL_TYPE_SIGN;
+            record->Datum.lSValue = -(int32_t) ulValue;
+            break;
+        case 2:
+            record->ucRecType = TL_TYPE_BITS;
+            record->Datum.Bits.ucLen = 0x53;
+            record->Datum.Bits.ucStore[0] = ulValue;
+            record->Datum.Bits.ucStore[3] = ~ulValue;
+            break;
+        default:
+            record->ucRecType = TL_TYPE_ERROR;
+            record->Datum.Error.usClass = 2;
+            record->Datum.Error.usCode = ulValue;
+            break;
+    }
+}
+
+/* true if a log holds the records first..last made by the test */
+static bool testTrendLogMmapHolds(
+    unsigned iLog,
+    uint32_t first,
+    uint32_t last)
+{
+    TL_DATA_REC expected;
+    TL_DATA_REC record;
+    uint32_t ulCount = 0;
+    uint32_t ulTotal = 0;
+    uint32_t seq;
+
+    TL_Mmap_Storage.Counts(iLog, &ulCount, &ulTotal);
+    if ((ulTotal != last) || (ulCount != (last - first + 1))) {
+        return false;
+    }
+    if (TL_Mmap_Storage.Record(iLog, first - 1, &record) ||
+        TL_Mmap_Storage.Record(iLog, last + 1, &record)) {
+        return false;
+    }
+    for (seq = first; seq <= last; seq++) {
+        testTrendLogMmapRecord(&expected, seq);
+        if (!TL_Mmap_Storage.Record(iLog, seq, &record) ||
+            (memcmp(&expected, &record, sizeof(TL_DATA_REC)) != 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* change the octets of a log file behind the back of the storage */
+static void testTrendLogMmapPoke(
+    Test * pTest,
+    unsigned iLog,
+    off_t offset,
+    const uint8_t * octets,
+    size_t length)
+{
+    char filename[PATH_MAX];
+    int fd;
+
+    snprintf(filename, sizeof(filename), "%s/trendlog%u.dat", Directory,
+        iLog);
+    fd = open(filename, O_RDWR);
+    ct_test(pTest, fd >= 0);
+    ct_test(pTest, pwrite(fd, octets, length, offset) == (ssize_t) length);
+    close(fd);
+}
+
+void testTrendLogMmap(
+    Test * pTest)
+{
+    char directory[] = "/tmp/tlmmapXXXXXX";
+    char filename[PATH_MAX];
+    const TL_STORAGE *storage;
+    TL_DATA_REC record;
+    uint8_t octets[12];
+    uint32_t ulCount = 0;
+    uint32_t ulTotal = 0;
+    uint32_t seq;
+    unsigned iLog;
+
+    ct_test(pTest, mkdtemp(directory) != NULL);
+    storage = tl_mmap_storage(directory);
+    ct_test(pTest, storage != NULL);
+    ct_test(pTest, storage->Open(2, 8));
+    storage->Counts(1, &ulCount, &ulTotal);
+    ct_test(pTest, ulCount == 0);
+    ct_test(pTest, ulTotal == 0);
+    for (seq = 1; seq <= 5; seq++) {
+        testTrendLogMmapRecord(&record, seq);
+        storage->Append(1, &record);
+    }
+    ct_test(pTest, testTrendLogMmapHolds(1, 1, 5));
+    storage->Counts(0, &ulCount, &ulTotal);
+    ct_test(pTest, ulTotal == 0);
+    /* the records outlive the storage */
+    storage->Close();
+    ct_test(pTest, storage->Open(2, 8));
+    ct_test(pTest, testTrendLogMmapHolds(1, 1, 5));
+    /* the ring wraps */
+    for (seq = 6; seq <= 15; seq++) {
+        testTrendLogMmapRecord(&record, seq);
+        storage->Append(1, &record);
+    }
+    ct_test(pTest, testTrendLogMmapHolds(1, 8, 15));
+    storage->Close();
+    /* the newest record was torn */
+    octets[0] = 0xA5;
+    testTrendLogMmapPoke(pTest, 1,
+        TLMMAP_HEADER_SIZE + (6 * TLMMAP_RECORD_SIZE) + 4, octets, 1);
+    ct_test(pTest, storage->Open(2, 8));
+    ct_test(pTest, testTrendLogMmapHolds(1, 8, 14));
+    /* ...and is written again */
+    testTrendLogMmapRecord(&record, 15);
+    storage->Append(1, &record);
+    ct_test(pTest, testTrendLogMmapHolds(1, 8, 15));
+    storage->Close();
+    /* the header missed the last two records */
+    (void) encode_unsigned32(&octets[0], 5);
+    (void) encode_unsigned32(&octets[4], 6);
+    (void) encode_unsigned32(&octets[8], 13);
+    testTrendLogMmapPoke(pTest, 1, 12, octets, 12);
+    ct_test(pTest, storage->Open(2, 8));
+    ct_test(pTest, testTrendLogMmapHolds(1, 8, 15));
+    storage->Close();
+    /* the next record was torn in place of the oldest one, record 8 */
+    (void) encode_unsigned32(&octets[0], 16);
+    testTrendLogMmapPoke(pTest, 1, TLMMAP_HEADER_SIZE +
+        (7 * TLMMAP_RECORD_SIZE), octets, 4);
+    ct_test(pTest, storage->Open(2, 8));
+    ct_test(pTest, testTrendLogMmapHolds(1, 9, 15));
+    testTrendLogMmapRecord(&record, 16);
+    storage->Append(1, &record);
+    ct_test(pTest, testTrendLogMmapHolds(1, 9, 16));
+    /* a record damaged in the file is not read */
+    octets[0] = 0xA5;
+    testTrendLogMmapPoke(pTest, 1, TLMMAP_HEADER_SIZE +
+        (1 * TLMMAP_RECORD_SIZE) + 10, octets, 1);
+    ct_test(pTest, storage->Record(1, 10, &record) == false);
+    ct_test(pTest, storage->Record(1, 11, &record));
+    /* a purge keeps the sequence going */
+    storage->Purge(1, 100);
+    storage->Counts(1, &ulCount, &ulTotal);
+    ct_test(pTest, ulCount == 0);
+    ct_test(pTest, ulTotal == 100);
+    storage->Close();
+    ct_test(pTest, storage->Open(2, 8));
+    storage->Counts(1, &ulCount, &ulTotal);
+    ct_test(pTest, ulCount == 0);
+    ct_test(pTest, ulTotal == 100);
+    testTrendLogMmapRecord(&record, 101);
+    storage->Append(1, &record);
+    ct_test(pTest, testTrendLogMmapHolds(1, 101, 101));
+    storage->Close();
+    /* another depth starts the logs again */
+    ct_test(pTest, storage->Open(2, 4));
+    storage->Counts(1, &ulCount, &ulTotal);
+    ct_test(pTest, ulCount == 0);
+    ct_test(pTest, ulTotal == 0);
+    storage->Close();
+
+    for (iLog = 0; iLog < 2; iLog++) {
+        snprintf(filename, sizeof(filename), "%s/trendlog%u.dat", directory,
+            iLog);
+        ct_test(pTest, unlink(filename) == 0);
+    }
+    ct_test(pTest, rmdir(directory) == 0);
+}
+
+#ifdef TEST_TLMMAP
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Trend Log Memory Mapped Storage", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTrendLogMmap);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_TLMMAP */
+#endif /* TEST */
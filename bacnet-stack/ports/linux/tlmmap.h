@@ -0,0 +1,62 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#ifndef TLMMAP_H
+#define TLMMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "trendlog.h"
+
+/**
+* Trend Log storage in memory mapped files: one file for each log,
+* named trendlog<instance>.dat in a directory, each with a ring of a
+* fixed number of records of TLMMAP_RECORD_SIZE octets.
+*
+* Every record carries its sequence number and a check octet, so that
+* after a crash the records that made it to the file are found again
+* even if the header of the file was not written, and a record that
+* was only partly written is dropped.
+*/
+
+#define TLMMAP_HEADER_SIZE 32
+#define TLMMAP_RECORD_SIZE 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    const TL_STORAGE *tl_mmap_storage(
+        const char *directory);
+
+#ifdef TEST
+#include "ctest.h"
+    void testTrendLogMmap(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,429 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#define WIN32_LEAN_AND_MEAN
+#define STRICT 1
+#include <windows.h>
+#include "pcapfile.h"
+
+/** @file win32/pcapfile.c  Buffered libpcap file writer and
+ * memory mapped libpcap file reader. */
+
+#define PCAP_MAGIC_NUMBER 0xa1b2c3d4UL
+#define PCAP_MAGIC_NUMBER_SWAPPED 0xd4c3b2a1UL
+#define PCAP_MAGIC_NUMBER_NSEC 0xa1b23c4dUL
+#define PCAP_MAGIC_NUMBER_NSEC_SWAPPED 0x4d3cb2a1UL
+#define PCAP_SNAPLEN 65535UL
+
+/* writer */
+static char Writer_Prefix[16] = "capture";
+static char Writer_Filename[64];
+static uint32_t Writer_Link_Type = PCAP_DLT_BACNET_MS_TP;
+static FILE *Writer_File;
+static uint8_t Writer_Buffer[PCAP_WRITER_BUFFER_SIZE];
+static size_t Writer_Length;
+/* octets at the front of the buffer that the mirror already has */
+static size_t Writer_Mirror_Skip;
+static bool Writer_Mirror_Header_Sent;
+static pcap_mirror_function Writer_Mirror;
+static pcap_rotate_function Writer_Rotate_Callback;
+/* rotation limits - zero is unlimited */
+static uint32_t Writer_Max_Packets;
+static uint32_t Writer_Max_Kilobytes;
+static uint32_t Writer_Max_Seconds;
+/* current file */
+static uint32_t Writer_Packets;
+static uint64_t Writer_Bytes;
+static time_t Writer_Start;
+/* periodic flush of a partly filled buffer */
+static uint32_t Writer_Flush_Milliseconds = PCAP_WRITER_FLUSH_MILLISECONDS;
+static DWORD Writer_Flush_Time;
+
+/* reader */
+static HANDLE Reader_File = INVALID_HANDLE_VALUE;
+static HANDLE Reader_Mapping;
+static uint8_t *Reader_Buffer;
+static size_t Reader_Size;
+static size_t Reader_Offset;
+static bool Reader_Swapped;
+static bool Reader_Nanoseconds;
+
+static void encode_host_uint32(
+    uint8_t * buffer,
+    uint32_t value)
+{
+    memcpy(buffer, &value, sizeof(value));
+}
+
+static void encode_host_uint16(
+    uint8_t * buffer,
+    uint16_t value)
+{
+    memcpy(buffer, &value, sizeof(value));
+}
+
+static uint32_t reader_uint32(
+    const uint8_t * buffer)
+{
+    uint32_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+    if (Reader_Swapped) {
+        value =
+            ((value & 0x000000FFUL) << 24) | ((value & 0x0000FF00UL) << 8) |
+            ((value & 0x00FF0000UL) >> 8) | ((value & 0xFF000000UL) >> 24);
+    }
+
+    return value;
+}
+
+static uint16_t reader_uint16(
+    const uint8_t * buffer)
+{
+    uint16_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+    if (Reader_Swapped) {
+        value = (uint16_t) ((value << 8) | (value >> 8));
+    }
+
+    return value;
+}
+
+void Pcap_Writer_Init(
+    const char *prefix,
+    uint32_t link_type)
+{
+    if (prefix) {
+        _snprintf(Writer_Prefix, sizeof(Writer_Prefix) - 1, "%s", prefix);
+        Writer_Prefix[sizeof(Writer_Prefix) - 1] = 0;
+    }
+    Writer_Link_Type = link_type;
+}
+
+void Pcap_Writer_Rotate_Set(
+    uint32_t max_packets,
+    uint32_t max_kilobytes,
+    uint32_t max_seconds)
+{
+    Writer_Max_Packets = max_packets;
+    Writer_Max_Kilobytes = max_kilobytes;
+    Writer_Max_Seconds = max_seconds;
+}
+
+void Pcap_Writer_Flush_Interval_Set(
+    uint32_t milliseconds)
+{
+    Writer_Flush_Milliseconds = milliseconds;
+}
+
+void Pcap_Writer_Mirror_Set(
+    pcap_mirror_function mirror)
+{
+    Writer_Mirror = mirror;
+}
+
+void Pcap_Writer_Rotate_Callback_Set(
+    pcap_rotate_function callback)
+{
+    Writer_Rotate_Callback = callback;
+}
+
+const char *Pcap_Writer_Filename(
+    void)
+{
+    return Writer_Filename;
+}
+
+void Pcap_Writer_Flush(
+    void)
+{
+    if (Writer_File && (Writer_Length > 0)) {
+        if (fwrite(Writer_Buffer, Writer_Length, 1, Writer_File) != 1) {
+            fprintf(stderr, "pcap: failed to write %s: %s\n",
+                Writer_Filename, strerror(errno));
+        }
+        fflush(Writer_File);
+        if (Writer_Mirror && (Writer_Length > Writer_Mirror_Skip)) {
+            Writer_Mirror(&Writer_Buffer[Writer_Mirror_Skip],
+                Writer_Length - Writer_Mirror_Skip);
+        }
+    }
+    Writer_Length = 0;
+    Writer_Mirror_Skip = 0;
+    Writer_Flush_Time = GetTickCount();
+}
+
+bool Pcap_Writer_Open(
+    void)
+{
+    uint8_t *header;
+    time_t my_time;
+    struct tm *today;
+    unsigned sequence = 0;
+    FILE *pFile;
+    int length;
+
+    Pcap_Writer_Close();
+    my_time = time(NULL);
+    today = localtime(&my_time);
+    length =
+        sprintf(Writer_Filename, "%.15s_%04d%02d%02d%02d%02d%02d",
+        Writer_Prefix, 1900 + today->tm_year, 1 + today->tm_mon,
+        today->tm_mday, today->tm_hour, today->tm_min, today->tm_sec);
+    for (;;) {
+        if (sequence) {
+            sprintf(&Writer_Filename[length], "_%u.cap", sequence);
+        } else {
+            sprintf(&Writer_Filename[length], ".cap");
+        }
+        /* do not overwrite a file started in the same second */
+        pFile = fopen(Writer_Filename, "rb");
+        if (!pFile) {
+            break;
+        }
+        fclose(pFile);
+        if (sequence >= 999) {
+            break;
+        }
+        sequence++;
+    }
+    Writer_File = fopen(Writer_Filename, "wb");
+    if (!Writer_File) {
+        fprintf(stderr, "pcap: failed to open %s: %s\n", Writer_Filename,
+            strerror(errno));
+        return false;
+    }
+    /* the module does its own buffering */
+    setvbuf(Writer_File, NULL, _IONBF, 0);
+    Writer_Packets = 0;
+    Writer_Bytes = PCAP_GLOBAL_HEADER_SIZE;
+    Writer_Start = my_time;
+    header = &Writer_Buffer[0];
+    encode_host_uint32(&header[0], PCAP_MAGIC_NUMBER);
+    encode_host_uint16(&header[4], 2);
+    encode_host_uint16(&header[6], 4);
+    encode_host_uint32(&header[8], 0);
+    encode_host_uint32(&header[12], 0);
+    encode_host_uint32(&header[16], PCAP_SNAPLEN);
+    encode_host_uint32(&header[20], Writer_Link_Type);
+    Writer_Length = PCAP_GLOBAL_HEADER_SIZE;
+    if (Writer_Mirror_Header_Sent) {
+        Writer_Mirror_Skip = PCAP_GLOBAL_HEADER_SIZE;
+    } else {
+        Writer_Mirror_Skip = 0;
+        Writer_Mirror_Header_Sent = true;
+    }
+    Pcap_Writer_Flush();
+
+    return true;
+}
+
+void Pcap_Writer_Close(
+    void)
+{
+    if (Writer_File) {
+        Pcap_Writer_Flush();
+        fclose(Writer_File);
+        Writer_File = NULL;
+    }
+}
+
+static bool rotation_time_expired(
+    void)
+{
+    return (Writer_Max_Seconds &&
+        ((time(NULL) - Writer_Start) >= (time_t) Writer_Max_Seconds));
+}
+
+static void rotate(
+    void)
+{
+    if (Writer_Rotate_Callback) {
+        Writer_Rotate_Callback(Writer_Filename);
+    }
+    (void) Pcap_Writer_Open();
+}
+
+uint8_t *Pcap_Writer_Packet(
+    uint32_t ts_sec,
+    uint32_t ts_usec,
+    uint32_t length)
+{
+    uint8_t *record;
+    uint32_t record_length = PCAP_RECORD_HEADER_SIZE + length;
+
+    if ((!Writer_File) || (length > PCAP_SNAPLEN)) {
+        return NULL;
+    }
+    if (Writer_Packets) {
+        if ((Writer_Max_Packets && (Writer_Packets >= Writer_Max_Packets)) ||
+            (Writer_Max_Kilobytes &&
+                ((Writer_Bytes + record_length) >
+                    ((uint64_t) Writer_Max_Kilobytes * 1024UL))) ||
+            rotation_time_expired()) {
+            rotate();
+            if (!Writer_File) {
+                return NULL;
+            }
+        }
+    }
+    if ((Writer_Length + record_length) > sizeof(Writer_Buffer)) {
+        Pcap_Writer_Flush();
+    }
+    record = &Writer_Buffer[Writer_Length];
+    encode_host_uint32(&record[0], ts_sec);
+    encode_host_uint32(&record[4], ts_usec);
+    encode_host_uint32(&record[8], length);
+    encode_host_uint32(&record[12], length);
+    Writer_Length += record_length;
+    Writer_Bytes += record_length;
+    Writer_Packets++;
+
+    return &record[PCAP_RECORD_HEADER_SIZE];
+}
+
+void Pcap_Writer_Poll(
+    void)
+{
+    if (!Writer_File) {
+        return;
+    }
+    if (Writer_Packets && rotation_time_expired()) {
+        rotate();
+    } else if ((Writer_Length > 0) &&
+        ((GetTickCount() - Writer_Flush_Time) >= Writer_Flush_Milliseconds)) {
+        Pcap_Writer_Flush();
+    }
+}
+
+bool Pcap_Reader_Open(
+    const char *filename,
+    uint32_t * link_type)
+{
+    LARGE_INTEGER file_size;
+    uint32_t magic_number;
+
+    Pcap_Reader_Close();
+    Reader_File =
+        CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (Reader_File == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    if ((!GetFileSizeEx(Reader_File, &file_size)) ||
+        (file_size.QuadPart < PCAP_GLOBAL_HEADER_SIZE)) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    Reader_Size = (size_t) file_size.QuadPart;
+    Reader_Mapping =
+        CreateFileMapping(Reader_File, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!Reader_Mapping) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    Reader_Buffer = MapViewOfFile(Reader_Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Reader_Buffer) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    memcpy(&magic_number, &Reader_Buffer[0], sizeof(magic_number));
+    Reader_Swapped = ((magic_number == PCAP_MAGIC_NUMBER_SWAPPED) ||
+        (magic_number == PCAP_MAGIC_NUMBER_NSEC_SWAPPED));
+    Reader_Nanoseconds = ((magic_number == PCAP_MAGIC_NUMBER_NSEC) ||
+        (magic_number == PCAP_MAGIC_NUMBER_NSEC_SWAPPED));
+    if ((!Reader_Swapped) && (!Reader_Nanoseconds) &&
+        (magic_number != PCAP_MAGIC_NUMBER)) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    if (reader_uint16(&Reader_Buffer[4]) != 2) {
+        Pcap_Reader_Close();
+        return false;
+    }
+    if (link_type) {
+        *link_type = reader_uint32(&Reader_Buffer[20]);
+    }
+    Reader_Offset = PCAP_GLOBAL_HEADER_SIZE;
+
+    return true;
+}
+
+bool Pcap_Reader_Next(
+    struct pcap_packet *packet)
+{
+    uint8_t *record;
+    size_t remaining;
+
+    if (!Reader_Buffer) {
+        return false;
+    }
+    remaining = Reader_Size - Reader_Offset;
+    if (remaining < PCAP_RECORD_HEADER_SIZE) {
+        return false;
+    }
+    record = &Reader_Buffer[Reader_Offset];
+    packet->ts_sec = reader_uint32(&record[0]);
+    packet->ts_usec = reader_uint32(&record[4]);
+    if (Reader_Nanoseconds) {
+        packet->ts_usec /= 1000;
+    }
+    packet->incl_len = reader_uint32(&record[8]);
+    packet->orig_len = reader_uint32(&record[12]);
+    if (packet->incl_len > (remaining - PCAP_RECORD_HEADER_SIZE)) {
+        /* truncated capture */
+        return false;
+    }
+    packet->data = &record[PCAP_RECORD_HEADER_SIZE];
+    Reader_Offset += PCAP_RECORD_HEADER_SIZE + packet->incl_len;
+
+    return true;
+}
+
+void Pcap_Reader_Close(
+    void)
+{
+    if (Reader_Buffer) {
+        UnmapViewOfFile(Reader_Buffer);
+    }
+    if (Reader_Mapping) {
+        CloseHandle(Reader_Mapping);
+    }
+    if (Reader_File != INVALID_HANDLE_VALUE) {
+        CloseHandle(Reader_File);
+    }
+    Reader_Buffer = NULL;
+    Reader_Mapping = NULL;
+    Reader_File = INVALID_HANDLE_VALUE;
+    Reader_Size = 0;
+    Reader_Offset = 0;
+}
@@ -56,6 +56,8 @@ extern int Routed_Device_Service_Approval(
 static uint16_t Timeout_Milliseconds = 3000;
 /* Number of APDU Retries */
 static uint8_t Number_Of_Retries = 3;
+/* APDU Segment Timeout in Milliseconds */
+static uint16_t Segment_Timeout_Milliseconds = 2000;
 
 /* a simple table for crossing the services supported */
 static BACNET_SERVICES_SUPPORTED
@@ -374,6 +376,18 @@ void apdu_retries_set(
     Number_Of_Retries = value;
 }
 
+uint16_t apdu_segment_timeout(
+    void)
+{
+    return Segment_Timeout_Milliseconds;
+}
+
+void apdu_segment_timeout_set(
+    uint16_t milliseconds)
+{
+    Segment_Timeout_Milliseconds = milliseconds;
+}
+
 
 /* When network communications are completely disabled,
    only DeviceCommunicationControl and ReinitializeDevice APDUs
@@ -546,6 +560,14 @@ void apdu_handler(
                 service_choice = apdu[len++];
                 service_request = &apdu[len];
                 service_request_len = apdu_len - (uint16_t) len;
+#if MAX_SEGMENTS
+                /* hand on the service data only when all segments are in */
+                if (service_ack_data.segmented_message &&
+                    !tsm_segmented_complex_ack_handler(src, &service_ack_data,
+                        &service_request, &service_request_len)) {
+                    break;
+                }
+#endif
                 switch (service_choice) {
                     case SERVICE_CONFIRMED_GET_ALARM_SUMMARY:
                     case SERVICE_CONFIRMED_GET_ENROLLMENT_SUMMARY:
@@ -577,9 +599,13 @@ void apdu_handler(
                 }
                 break;
             case PDU_TYPE_SEGMENT_ACK:
+#if MAX_SEGMENTS
+                tsm_segment_ack_handler(src, apdu, apdu_len);
+#else
                 /* FIXME: what about a denial of service attack here?
                    we could check src to see if that matched the tsm */
                 tsm_free_invoke_id(invoke_id);
+#endif
                 break;
             case PDU_TYPE_ERROR:
                 invoke_id = apdu[1];
@@ -633,6 +659,13 @@ void apdu_handler(
                 reason = apdu[2];
                 if (Abort_Function)
                     Abort_Function(src, invoke_id, reason, server);
+#if MAX_SEGMENTS
+                if (!server) {
+                    /* the client gave up on our segmented response */
+                    tsm_abort_segmented_response(src, invoke_id);
+                    break;
+                }
+#endif
                 tsm_free_invoke_id(invoke_id);
                 break;
             default:
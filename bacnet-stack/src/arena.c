@@ -0,0 +1,272 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/** @file arena.c  Memory arena for decoded data that is freed at once. */
+
+static size_t arena_align(
+    size_t size)
+{
+    return (size + (ARENA_ALIGNMENT - 1)) & ~((size_t) ARENA_ALIGNMENT - 1);
+}
+
+/* the data area follows the block header, aligned */
+static uint8_t *arena_block_data(
+    ARENA_BLOCK * block)
+{
+    return (uint8_t *) block + arena_align(sizeof(ARENA_BLOCK));
+}
+
+static ARENA_BLOCK *arena_block_new(
+    ARENA * arena,
+    size_t size)
+{
+    ARENA_BLOCK *block;
+
+    if (size < arena->block_size) {
+        size = arena->block_size;
+    }
+    block = malloc(arena_align(sizeof(ARENA_BLOCK)) + size);
+    if (block) {
+        block->next = arena->head;
+        block->size = size;
+        block->used = 0;
+        arena->head = block;
+        arena->block_count++;
+        arena->bytes_reserved += size;
+    }
+
+    return block;
+}
+
+/** Initialize an empty arena; no memory is taken until the first
+ * allocation.
+ *
+ * @param arena - arena to initialize
+ * @param block_size - minimum size of the blocks, or zero for the default
+ */
+void arena_init(
+    ARENA * arena,
+    size_t block_size)
+{
+    if (arena) {
+        arena->head = NULL;
+        arena->block_size = block_size ? block_size : ARENA_BLOCK_SIZE;
+        arena->block_count = 0;
+        arena->alloc_count = 0;
+        arena->bytes_reserved = 0;
+        arena->bytes_used = 0;
+    }
+}
+
+/** Allocate zeroed memory from the arena.  The memory is only released
+ * by arena_reset() or arena_free().
+ *
+ * @param arena - arena to allocate from
+ * @param size - number of bytes
+ * @return pointer to the memory, or NULL if out of memory
+ */
+void *arena_alloc(
+    ARENA * arena,
+    size_t size)
+{
+    ARENA_BLOCK *block;
+    uint8_t *data;
+
+    if (!arena) {
+        return NULL;
+    }
+    size = arena_align(size ? size : 1);
+    block = arena->head;
+    if (!block || ((block->size - block->used) < size)) {
+        block = arena_block_new(arena, size);
+        if (!block) {
+            return NULL;
+        }
+    }
+    data = arena_block_data(block) + block->used;
+    block->used += size;
+    arena->alloc_count++;
+    arena->bytes_used += size;
+    memset(data, 0, size);
+
+    return data;
+}
+
+/** Allocate memory from the arena and copy data into it.
+ *
+ * @param arena - arena to allocate from
+ * @param data - data to copy
+ * @param size - number of bytes of data
+ * @return pointer to the copy, or NULL if out of memory
+ */
+void *arena_copy(
+    ARENA * arena,
+    const void *data,
+    size_t size)
+{
+    void *copy;
+
+    copy = arena_alloc(arena, size);
+    if (copy && data && size) {
+        memcpy(copy, data, size);
+    }
+
+    return copy;
+}
+
+/** Release all of the allocations, but keep the memory for reuse.
+ * An arena that had grown to several blocks is merged into a single
+ * block of the total size, so that decoding the same amount of data
+ * again takes no more calls to malloc().
+ *
+ * @param arena - arena to reset
+ */
+void arena_reset(
+    ARENA * arena)
+{
+    size_t size = 0;
+
+    if (!arena || !arena->head) {
+        return;
+    }
+    if (arena->head->next) {
+        size = arena->bytes_reserved;
+        arena_free(arena);
+        (void) arena_block_new(arena, size);
+    } else {
+        arena->head->used = 0;
+    }
+    arena->alloc_count = 0;
+    arena->bytes_used = 0;
+}
+
+/** Release all of the memory of the arena in a single call.
+ *
+ * @param arena - arena to free
+ */
+void arena_free(
+    ARENA * arena)
+{
+    ARENA_BLOCK *block;
+
+    if (!arena) {
+        return;
+    }
+    while (arena->head) {
+        block = arena->head;
+        arena->head = block->next;
+        free(block);
+    }
+    arena->block_count = 0;
+    arena->alloc_count = 0;
+    arena->bytes_reserved = 0;
+    arena->bytes_used = 0;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+void testArena(
+    Test * pTest)
+{
+    ARENA arena;
+    uint8_t *data[64];
+    uint8_t pattern[100];
+    uint8_t *copy;
+    unsigned i, j;
+
+    arena_init(&arena, 256);
+    ct_test(pTest, arena.block_count == 0);
+    /* every allocation is zeroed and aligned */
+    for (i = 0; i < 64; i++) {
+        data[i] = arena_alloc(&arena, i + 1);
+        ct_test(pTest, data[i] != NULL);
+        ct_test(pTest, ((uintptr_t) data[i] % ARENA_ALIGNMENT) == 0);
+        for (j = 0; j <= i; j++) {
+            ct_test(pTest, data[i][j] == 0);
+        }
+        memset(data[i], (int) i, i + 1);
+    }
+    ct_test(pTest, arena.alloc_count == 64);
+    ct_test(pTest, arena.block_count > 1);
+    /* allocations do not overlap */
+    for (i = 0; i < 64; i++) {
+        for (j = 0; j <= i; j++) {
+            ct_test(pTest, data[i][j] == i);
+        }
+    }
+    /* larger than a block */
+    copy = arena_alloc(&arena, 1000);
+    ct_test(pTest, copy != NULL);
+    for (i = 0; i < sizeof(pattern); i++) {
+        pattern[i] = (uint8_t) i;
+    }
+    copy = arena_copy(&arena, pattern, sizeof(pattern));
+    ct_test(pTest, copy != NULL);
+    ct_test(pTest, memcmp(copy, pattern, sizeof(pattern)) == 0);
+    /* reset merges the blocks, and the same load fits again */
+    arena_reset(&arena);
+    ct_test(pTest, arena.block_count == 1);
+    ct_test(pTest, arena.alloc_count == 0);
+    for (i = 0; i < 64; i++) {
+        data[i] = arena_alloc(&arena, i + 1);
+        ct_test(pTest, data[i] != NULL);
+    }
+    ct_test(pTest, arena.block_count == 1);
+    arena_free(&arena);
+    ct_test(pTest, arena.head == NULL);
+    ct_test(pTest, arena.bytes_reserved == 0);
+    /* freeing twice is harmless */
+    arena_free(&arena);
+}
+
+#ifdef TEST_ARENA
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Arena", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testArena);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_ARENA */
+#endif /* TEST */
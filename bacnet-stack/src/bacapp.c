@@ -822,6 +822,331 @@ int bacapp_decode_context_data_len(
     return apdu_len;
 }
 
+/* returns the length of the encoding from an opening tag up to and
+   including its matching closing tag, or BACNET_STATUS_ERROR */
+static int bacapp_compact_constructed_len(
+    uint8_t * apdu,
+    unsigned max_apdu_len)
+{
+    unsigned apdu_len = 0;
+    int len = 0;
+    unsigned depth = 0;
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+
+    do {
+        if (apdu_len >= max_apdu_len) {
+            return BACNET_STATUS_ERROR;
+        }
+        len =
+            decode_tag_number_and_value_safe(&apdu[apdu_len],
+            max_apdu_len - apdu_len, &tag_number, &len_value_type);
+        if (len <= 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        if (IS_OPENING_TAG(apdu[apdu_len])) {
+            depth++;
+        } else if (IS_CLOSING_TAG(apdu[apdu_len])) {
+            depth--;
+        } else if (IS_CONTEXT_SPECIFIC(apdu[apdu_len]) ||
+            (tag_number != BACNET_APPLICATION_TAG_BOOLEAN)) {
+            /* an application boolean has its value in the tag */
+            if (len_value_type > (max_apdu_len - apdu_len - len)) {
+                return BACNET_STATUS_ERROR;
+            }
+            len += len_value_type;
+        }
+        apdu_len += len;
+    } while (depth);
+
+    return (int) apdu_len;
+}
+
+/* decodes the contents of a primitive value into its compact form */
+static int bacapp_compact_decode_data(
+    uint8_t * apdu,
+    uint32_t len_value_type,
+    uint8_t * base,
+    BACNET_COMPACT_VALUE * value)
+{
+    int len = 0;
+    uint16_t object_type = 0;
+
+    switch (value->tag) {
+        case BACNET_APPLICATION_TAG_NULL:
+            break;
+        case BACNET_APPLICATION_TAG_BOOLEAN:
+            if (value->context_specific) {
+                /* a context boolean has one contents octet */
+                if (len_value_type == 1) {
+                    value->type.Boolean = apdu[0] ? true : false;
+                    len = 1;
+                } else {
+                    len = BACNET_STATUS_ERROR;
+                }
+            } else {
+                value->type.Boolean = decode_boolean(len_value_type);
+            }
+            break;
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            if ((len_value_type == 0) || (len_value_type > 4)) {
+                len = BACNET_STATUS_ERROR;
+            } else {
+                len =
+                    decode_unsigned(apdu, len_value_type,
+                    &value->type.Unsigned_Int);
+            }
+            break;
+        case BACNET_APPLICATION_TAG_SIGNED_INT:
+            if ((len_value_type == 0) || (len_value_type > 4)) {
+                len = BACNET_STATUS_ERROR;
+            } else {
+                len =
+                    decode_signed(apdu, len_value_type,
+                    &value->type.Signed_Int);
+            }
+            break;
+        case BACNET_APPLICATION_TAG_REAL:
+            len = decode_real_safe(apdu, len_value_type, &value->type.Real);
+            break;
+        case BACNET_APPLICATION_TAG_DOUBLE:
+            len =
+                decode_double_safe(apdu, len_value_type, &value->type.Double);
+            break;
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            if ((len_value_type == 0) || (len_value_type > 4)) {
+                len = BACNET_STATUS_ERROR;
+            } else {
+                len =
+                    decode_enumerated(apdu, len_value_type,
+                    &value->type.Enumerated);
+            }
+            break;
+        case BACNET_APPLICATION_TAG_DATE:
+            len = decode_date_safe(apdu, len_value_type, &value->type.Date);
+            break;
+        case BACNET_APPLICATION_TAG_TIME:
+            len =
+                decode_bacnet_time_safe(apdu, len_value_type,
+                &value->type.Time);
+            break;
+        case BACNET_APPLICATION_TAG_OBJECT_ID:
+            len =
+                decode_object_id_safe(apdu, len_value_type, &object_type,
+                &value->type.Object_Id.instance);
+            value->type.Object_Id.type = object_type;
+            break;
+        case BACNET_APPLICATION_TAG_CHARACTER_STRING:
+        case BACNET_APPLICATION_TAG_BIT_STRING:
+            if (len_value_type == 0) {
+                /* the character set or unused bits octet is missing */
+                len = BACNET_STATUS_ERROR;
+                break;
+            }
+            /* fall through */
+        default:
+            /* octet strings, lighting commands, and anything else
+               the stack does not decode stay in the buffer */
+            value->type.Octets.offset = (uint32_t) (apdu - base);
+            value->type.Octets.length = len_value_type;
+            len = (int) len_value_type;
+            break;
+    }
+    if ((len >= 0) && ((uint32_t) len != len_value_type)) {
+        /* wrong length for the data type */
+        len = BACNET_STATUS_ERROR;
+    }
+
+    return len;
+}
+
+/** Decode one application or context tagged value into its compact form.
+ * Nothing is copied: strings, and constructed or unknown context data,
+ * are referenced by their offset from base, so the value is only
+ * usable while the buffer at base is.
+ *
+ * @param apdu [in] The encoded value.
+ * @param max_apdu_len [in] Number of octets available at apdu.
+ * @param base [in] Start of the buffer that offsets are taken from.
+ * @param value [out] The decoded value.
+ * @param property [in] Property of the value, for context tags.
+ * @return number of octets decoded, zero at a closing tag (an empty
+ *         list), or BACNET_STATUS_ERROR
+ */
+int bacapp_decode_compact_data(
+    uint8_t * apdu,
+    unsigned max_apdu_len,
+    uint8_t * base,
+    BACNET_COMPACT_VALUE * value,
+    BACNET_PROPERTY_ID property)
+{
+    int len = 0;
+    int tag_len = 0;
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+
+    if (!apdu || !base || !value || (max_apdu_len == 0) || (apdu < base)) {
+        return BACNET_STATUS_ERROR;
+    }
+    value->next = NULL;
+    if (IS_CLOSING_TAG(apdu[0])) {
+        return 0;
+    }
+    value->context_specific = IS_CONTEXT_SPECIFIC(apdu[0]);
+    if (IS_OPENING_TAG(apdu[0])) {
+        /* constructed data is kept encoded */
+        len = bacapp_compact_constructed_len(apdu, max_apdu_len);
+        if (len > 0) {
+            (void) decode_tag_number(apdu, &value->context_tag);
+            value->tag = MAX_BACNET_APPLICATION_TAG;
+            value->type.Octets.offset = (uint32_t) (apdu - base);
+            value->type.Octets.length = (uint32_t) len;
+        }
+        return len;
+    }
+    tag_len =
+        decode_tag_number_and_value_safe(apdu, max_apdu_len, &tag_number,
+        &len_value_type);
+    if (tag_len <= 0) {
+        return BACNET_STATUS_ERROR;
+    }
+    if (value->context_specific) {
+        value->context_tag = tag_number;
+        value->tag = bacapp_context_tag_type(property, tag_number);
+    } else {
+        value->context_tag = 0;
+        value->tag = tag_number;
+        if (tag_number == BACNET_APPLICATION_TAG_BOOLEAN) {
+            value->type.Boolean = decode_boolean(len_value_type);
+            return tag_len;
+        }
+    }
+    if (len_value_type > (max_apdu_len - tag_len)) {
+        return BACNET_STATUS_ERROR;
+    }
+    len =
+        bacapp_compact_decode_data(&apdu[tag_len], len_value_type, base,
+        value);
+    if (len < 0) {
+        return BACNET_STATUS_ERROR;
+    }
+
+    return tag_len + len;
+}
+
+/** Expand a compact value into a full application data value, for
+ * the functions that work on those, such as bacapp_print_value().
+ *
+ * @param base [in] Start of the buffer the compact value was decoded from.
+ * @param src_value [in] The compact value.
+ * @param dest_value [out] The application data value.
+ * @return true if the value could be expanded; data that was kept
+ *         encoded cannot be.
+ */
+bool bacapp_compact_value_expand(
+    uint8_t * base,
+    BACNET_COMPACT_VALUE * src_value,
+    BACNET_APPLICATION_DATA_VALUE * dest_value)
+{
+    bool status = true;
+
+    if (!base || !src_value || !dest_value) {
+        return false;
+    }
+    dest_value->context_specific = src_value->context_specific;
+    dest_value->context_tag = src_value->context_tag;
+    dest_value->tag = src_value->tag;
+    dest_value->next = NULL;
+    switch (src_value->tag) {
+#if defined (BACAPP_NULL)
+        case BACNET_APPLICATION_TAG_NULL:
+            break;
+#endif
+#if defined (BACAPP_BOOLEAN)
+        case BACNET_APPLICATION_TAG_BOOLEAN:
+            dest_value->type.Boolean = src_value->type.Boolean;
+            break;
+#endif
+#if defined (BACAPP_UNSIGNED)
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            dest_value->type.Unsigned_Int = src_value->type.Unsigned_Int;
+            break;
+#endif
+#if defined (BACAPP_SIGNED)
+        case BACNET_APPLICATION_TAG_SIGNED_INT:
+            dest_value->type.Signed_Int = src_value->type.Signed_Int;
+            break;
+#endif
+#if defined (BACAPP_REAL)
+        case BACNET_APPLICATION_TAG_REAL:
+            dest_value->type.Real = src_value->type.Real;
+            break;
+#endif
+#if defined (BACAPP_DOUBLE)
+        case BACNET_APPLICATION_TAG_DOUBLE:
+            dest_value->type.Double = src_value->type.Double;
+            break;
+#endif
+#if defined (BACAPP_ENUMERATED)
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            dest_value->type.Enumerated = src_value->type.Enumerated;
+            break;
+#endif
+#if defined (BACAPP_DATE)
+        case BACNET_APPLICATION_TAG_DATE:
+            dest_value->type.Date = src_value->type.Date;
+            break;
+#endif
+#if defined (BACAPP_TIME)
+        case BACNET_APPLICATION_TAG_TIME:
+            dest_value->type.Time = src_value->type.Time;
+            break;
+#endif
+#if defined (BACAPP_OBJECT_ID)
+        case BACNET_APPLICATION_TAG_OBJECT_ID:
+            dest_value->type.Object_Id = src_value->type.Object_Id;
+            break;
+#endif
+#if defined (BACAPP_OCTET_STRING)
+        case BACNET_APPLICATION_TAG_OCTET_STRING:
+            status =
+                octetstring_init(&dest_value->type.Octet_String,
+                &base[src_value->type.Octets.offset],
+                src_value->type.Octets.length);
+            break;
+#endif
+#if defined (BACAPP_CHARACTER_STRING)
+        case BACNET_APPLICATION_TAG_CHARACTER_STRING:
+            status =
+                (decode_character_string(&base[src_value->type.Octets.offset],
+                    src_value->type.Octets.length,
+                    &dest_value->type.Character_String) > 0);
+            break;
+#endif
+#if defined (BACAPP_BIT_STRING)
+        case BACNET_APPLICATION_TAG_BIT_STRING:
+            status =
+                (decode_bitstring(&base[src_value->type.Octets.offset],
+                    src_value->type.Octets.length,
+                    &dest_value->type.Bit_String) > 0);
+            break;
+#endif
+#if defined (BACAPP_LIGHTING_COMMAND)
+        case BACNET_APPLICATION_TAG_LIGHTING_COMMAND:
+            status =
+                (lighting_command_decode(&base[src_value->type.Octets.offset],
+                    src_value->type.Octets.length,
+                    &dest_value->type.Lighting_Command) > 0);
+            break;
+#endif
+        default:
+            status = false;
+            break;
+    }
+
+    return status;
+}
+
 int bacapp_encode_data(
     uint8_t * apdu,
     BACNET_APPLICATION_DATA_VALUE * value)
@@ -365,108 +365,139 @@ bool decode_is_closing_tag(
     return (bool) ((apdu[0] & 0x07) == 7);
 }
 
-/* from clause 20.2.1.3.2 Constructed Data */
-/* returns the number of apdu bytes consumed */
-int decode_tag_number_and_value(
-    uint8_t * apdu,
+/* The first octet of a tag is classified by Tag_Header_Class[]:
+   bits 0-2 hold the value of a small length/value/type (zero for an
+   opening or closing tag), and the flags tell whether the tag number
+   or the length/value/type continue in the octets that follow. */
+#define TAG_HEADER_VALUE_MASK 0x07
+#define TAG_HEADER_EXTENDED_VALUE 0x08
+#define TAG_HEADER_EXTENDED_NUMBER 0x10
+
+static const uint8_t Tag_Header_Class[256] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x08, 0x00, 0x00,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x18, 0x10, 0x10,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x18, 0x10, 0x10
+};
+
+/* big-endian loads from any alignment - compilers fold these into a
+   single load and byte swap where the target allows it */
+#define TAG_HEADER_LOAD16(p) \
+    (((uint32_t) (p)[0] << 8) | (uint32_t) (p)[1])
+#define TAG_HEADER_LOAD32(p) \
+    (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16) | \
+    ((uint32_t) (p)[2] << 8) | (uint32_t) (p)[3])
+
+/** Decode a tag header with one table lookup for the first octet.
+ *
+ * @param apdu - the tag header
+ * @param apdu_len - number of octets available in the apdu
+ * @param tag_number - the tag number, or NULL
+ * @param value - the length/value/type, or NULL
+ * @return number of octets in the header, or 0 if it was truncated
+ */
+static int decode_tag_header(
+    uint8_t * apdu,
+    uint32_t apdu_len,
     uint8_t * tag_number,
     uint32_t * value)
 {
-    int len = 1;
-    uint16_t value16;
-    uint32_t value32;
+    uint8_t header = 0;
+    uint8_t number = 0;
+    uint32_t len = 1;
+    uint32_t lvt = 0;
 
-    len = decode_tag_number(&apdu[0], tag_number);
-    if (IS_EXTENDED_VALUE(apdu[0])) {
-        /* tagged as uint32_t */
-        if (apdu[len] == 255) {
-            len++;
-            len += decode_unsigned32(&apdu[len], &value32);
-            if (value) {
-                *value = value32;
-            }
+    if (apdu_len < 1) {
+        return 0;
+    }
+    header = Tag_Header_Class[apdu[0]];
+    number = (uint8_t) (apdu[0] >> 4);
+    lvt = header & TAG_HEADER_VALUE_MASK;
+    if (header & TAG_HEADER_EXTENDED_NUMBER) {
+        if (apdu_len < 2) {
+            return 0;
         }
-        /* tagged as uint16_t */
-        else if (apdu[len] == 254) {
-            len++;
-            len += decode_unsigned16(&apdu[len], &value16);
-            if (value) {
-                *value = value16;
-            }
+        number = apdu[1];
+        len = 2;
+    }
+    if (header & TAG_HEADER_EXTENDED_VALUE) {
+        if (apdu_len <= len) {
+            return 0;
         }
-        /* no tag - must be uint8_t */
-        else {
-            if (value) {
-                *value = apdu[len];
+        lvt = apdu[len];
+        if (lvt < 254) {
+            len += 1;
+        } else if (lvt == 254) {
+            if ((apdu_len - len) < 3) {
+                return 0;
             }
-            len++;
+            lvt = TAG_HEADER_LOAD16(&apdu[len + 1]);
+            len += 3;
+        } else {
+            if ((apdu_len - len) < 5) {
+                return 0;
+            }
+            lvt = TAG_HEADER_LOAD32(&apdu[len + 1]);
+            len += 5;
         }
-    } else if (IS_OPENING_TAG(apdu[0]) && value) {
-        *value = 0;
-    } else if (IS_CLOSING_TAG(apdu[0]) && value) {
-        /* closing tag */
-        *value = 0;
-    } else if (value) {
-        /* small value */
-        *value = apdu[0] & 0x07;
+    }
+    if (tag_number) {
+        *tag_number = number;
+    }
+    if (value) {
+        *value = lvt;
     }
 
-    return len;
+    return (int) len;
 }
 
-/* Same as function above, but will safely fail is packet has been truncated */
+/* from clause 20.2.1.3.2 Constructed Data */
+/* returns the number of apdu bytes consumed */
+int decode_tag_number_and_value(
+    uint8_t * apdu,
+    uint8_t * tag_number,
+    uint32_t * value)
+{
+    /* the caller has already vouched for the header length */
+    return decode_tag_header(apdu, UINT32_MAX, tag_number, value);
+}
+
+/* Same as function above, but will safely fail if packet has been truncated */
 int decode_tag_number_and_value_safe(
     uint8_t * apdu,
     uint32_t apdu_len_remaining,
     uint8_t * tag_number,
     uint32_t * value)
 {
-    int len = 0;
-
-    len = decode_tag_number_safe(&apdu[0], apdu_len_remaining, tag_number);
-
-    if (len > 0) {
-        apdu_len_remaining -= len;
-        if (IS_EXTENDED_VALUE(apdu[0])) {
-            /* tagged as uint32_t */
-            if (apdu[len] == 255 && apdu_len_remaining >= 5) {
-                uint32_t value32;
-                len++;
-                len += decode_unsigned32(&apdu[len], &value32);
-                if (value) {
-                    *value = value32;
-                }
-            }
-            /* tagged as uint16_t */
-            else if (apdu[len] == 254 && apdu_len_remaining >= 3) {
-                uint16_t value16;
-                len++;
-                len += decode_unsigned16(&apdu[len], &value16);
-                if (value) {
-                    *value = value16;
-                }
-            }
-            /* no tag - must be uint8_t */
-            else if (apdu[len] < 254 && apdu_len_remaining >= 1) {
-                if (value) {
-                    *value = apdu[len];
-                }
-                len++;
-            } else {
-                /* packet is truncated */
-                len = 0;
-            }
-        } else if (IS_OPENING_TAG(apdu[0]) && value) {
-            *value = 0;
-        } else if (IS_CLOSING_TAG(apdu[0]) && value) {
-            /* closing tag */
-            *value = 0;
-        } else if (value) {
-            /* small value */
-            *value = apdu[0] & 0x07;
-        }
-    }
-    return len;
+    return decode_tag_header(apdu, apdu_len_remaining, tag_number, value);
 }
 
 /* from clause 20.2.1.3.2 Constructed Data */
@@ -1515,6 +1546,376 @@ int encode_context_double(
 }
 #endif
 
+/* Bulk encoding of arrays whose elements all have one application tag,
+   such as a Priority_Array of REAL or the Shed_Levels of a Load Control.
+   The tag octet of each element is made from the value range alone, and
+   a REAL is stored from one 32-bit word, so no element goes through
+   encode_tag() or an octet by octet copy. */
+
+/* stores one REAL, tag octet included: 5 octets */
+static void encode_application_real_element(
+    uint8_t * apdu,
+    float value)
+{
+    union {
+        uint32_t word;
+        float real_value;
+    } my_data;
+
+    /* NOTE: assumes the compiler stores float as IEEE-754 float,
+       in the same byte order as a 32-bit integer */
+    my_data.real_value = value;
+    apdu[0] = (BACNET_APPLICATION_TAG_REAL << 4) | 4;
+    apdu[1] = (uint8_t) (my_data.word >> 24);
+    apdu[2] = (uint8_t) (my_data.word >> 16);
+    apdu[3] = (uint8_t) (my_data.word >> 8);
+    apdu[4] = (uint8_t) my_data.word;
+}
+
+/** Encode an array of REAL, each element with its application tag.
+ *
+ * @param apdu - where the elements go
+ * @param apdu_max - number of octets that may be used
+ * @param values - the elements
+ * @param count - number of elements
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if the
+ *  elements do not fit
+ */
+int encode_application_real_array(
+    uint8_t * apdu,
+    int apdu_max,
+    const float *values,
+    unsigned count)
+{
+    unsigned i = 0;
+
+    if ((apdu_max < 0) || (count > ((unsigned) apdu_max / 5))) {
+        return BACNET_STATUS_ERROR;
+    }
+    for (i = 0; i < count; i++) {
+        encode_application_real_element(&apdu[i * 5], values[i]);
+    }
+
+    return (int) (count * 5);
+}
+
+/** Encode a Priority_Array of REAL: the elements of the priorities that
+ * are active, and NULL for the others.
+ *
+ * @param apdu - where the elements go
+ * @param apdu_max - number of octets that may be used
+ * @param values - the BACNET_MAX_PRIORITY elements
+ * @param active_bits - bit N set if priority N+1 is active
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if the
+ *  elements do not fit
+ */
+int encode_application_real_priority_array(
+    uint8_t * apdu,
+    int apdu_max,
+    const float *values,
+    uint16_t active_bits)
+{
+    int len = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
+        if (active_bits & (1 << i)) {
+            if ((len + 5) > apdu_max) {
+                return BACNET_STATUS_ERROR;
+            }
+            encode_application_real_element(&apdu[len], values[i]);
+            len += 5;
+        } else {
+            if ((len + 1) > apdu_max) {
+                return BACNET_STATUS_ERROR;
+            }
+            apdu[len] = BACNET_APPLICATION_TAG_NULL << 4;
+            len++;
+        }
+    }
+
+    return len;
+}
+
+#if BACNET_USE_DOUBLE
+/** Encode an array of Double, each element with its application tag.
+ *
+ * @param apdu - where the elements go
+ * @param apdu_max - number of octets that may be used
+ * @param values - the elements
+ * @param count - number of elements
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if the
+ *  elements do not fit
+ */
+int encode_application_double_array(
+    uint8_t * apdu,
+    int apdu_max,
+    const double *values,
+    unsigned count)
+{
+    unsigned i = 0;
+
+    if ((apdu_max < 0) || (count > ((unsigned) apdu_max / 10))) {
+        return BACNET_STATUS_ERROR;
+    }
+    for (i = 0; i < count; i++) {
+        /* the length of 8 follows the tag octet */
+        apdu[i * 10] = (BACNET_APPLICATION_TAG_DOUBLE << 4) | 5;
+        apdu[(i * 10) + 1] = 8;
+        (void) encode_bacnet_double(values[i], &apdu[(i * 10) + 2]);
+    }
+
+    return (int) (count * 10);
+}
+#endif
+
+/* array of Unsigned or Enumerated, whose encodings differ in the tag */
+static int encode_application_unsigned_tag_array(
+    uint8_t * apdu,
+    int apdu_max,
+    uint8_t tag_number,
+    const uint32_t * values,
+    unsigned count)
+{
+    int len = 0;
+    unsigned i = 0;
+    uint32_t value = 0;
+    uint8_t value_len = 0;
+
+    for (i = 0; i < count; i++) {
+        value = values[i];
+        /* length of unsigned is variable, as per 20.2.4 */
+        if (value < 0x100) {
+            value_len = 1;
+        } else if (value < 0x10000) {
+            value_len = 2;
+        } else if (value < 0x1000000) {
+            value_len = 3;
+        } else {
+            value_len = 4;
+        }
+        if ((len + 1 + value_len) > apdu_max) {
+            return BACNET_STATUS_ERROR;
+        }
+        apdu[len] = (uint8_t) ((tag_number << 4) | value_len);
+        switch (value_len) {
+            case 4:
+                apdu[len + value_len - 3] = (uint8_t) (value >> 24);
+                /* fall through */
+            case 3:
+                apdu[len + value_len - 2] = (uint8_t) (value >> 16);
+                /* fall through */
+            case 2:
+                apdu[len + value_len - 1] = (uint8_t) (value >> 8);
+                /* fall through */
+            default:
+                apdu[len + value_len] = (uint8_t) value;
+                break;
+        }
+        len += 1 + value_len;
+    }
+
+    return len;
+}
+
+/** Encode an array of Unsigned, each element with its application tag.
+ *
+ * @param apdu - where the elements go
+ * @param apdu_max - number of octets that may be used
+ * @param values - the elements
+ * @param count - number of elements
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if the
+ *  elements do not fit
+ */
+int encode_application_unsigned_array(
+    uint8_t * apdu,
+    int apdu_max,
+    const uint32_t * values,
+    unsigned count)
+{
+    return encode_application_unsigned_tag_array(apdu, apdu_max,
+        BACNET_APPLICATION_TAG_UNSIGNED_INT, values, count);
+}
+
+/** Encode an array of Enumerated, each element with its application tag.
+ *
+ * @param apdu - where the elements go
+ * @param apdu_max - number of octets that may be used
+ * @param values - the elements
+ * @param count - number of elements
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if the
+ *  elements do not fit
+ */
+int encode_application_enumerated_array(
+    uint8_t * apdu,
+    int apdu_max,
+    const uint32_t * values,
+    unsigned count)
+{
+    return encode_application_unsigned_tag_array(apdu, apdu_max,
+        BACNET_APPLICATION_TAG_ENUMERATED, values, count);
+}
+
+/** Decode the REAL elements at the start of an array, up to the first
+ * element of another type.
+ *
+ * @param apdu - the encoded elements
+ * @param apdu_len - number of octets in apdu
+ * @param values - where the elements go
+ * @param count - the number of values on entry, the number of
+ *  elements decoded on return
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if an
+ *  element is cut short
+ */
+int decode_application_real_array(
+    uint8_t * apdu,
+    int apdu_len,
+    float *values,
+    unsigned *count)
+{
+    int len = 0;
+    unsigned i = 0;
+    union {
+        uint32_t word;
+        float real_value;
+    } my_data;
+
+    for (i = 0; (i < *count) && (len < apdu_len); i++) {
+        if (apdu[len] != ((BACNET_APPLICATION_TAG_REAL << 4) | 4)) {
+            break;
+        }
+        if ((len + 5) > apdu_len) {
+            return BACNET_STATUS_ERROR;
+        }
+        my_data.word =
+            ((uint32_t) apdu[len + 1] << 24) |
+            ((uint32_t) apdu[len + 2] << 16) |
+            ((uint32_t) apdu[len + 3] << 8) | (uint32_t) apdu[len + 4];
+        values[i] = my_data.real_value;
+        len += 5;
+    }
+    *count = i;
+
+    return len;
+}
+
+#if BACNET_USE_DOUBLE
+/** Decode the Double elements at the start of an array, up to the first
+ * element of another type.
+ *
+ * @param apdu - the encoded elements
+ * @param apdu_len - number of octets in apdu
+ * @param values - where the elements go
+ * @param count - the number of values on entry, the number of
+ *  elements decoded on return
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if an
+ *  element is cut short
+ */
+int decode_application_double_array(
+    uint8_t * apdu,
+    int apdu_len,
+    double *values,
+    unsigned *count)
+{
+    int len = 0;
+    unsigned i = 0;
+
+    for (i = 0; (i < *count) && (len < apdu_len); i++) {
+        if (apdu[len] != ((BACNET_APPLICATION_TAG_DOUBLE << 4) | 5)) {
+            break;
+        }
+        if (((len + 10) > apdu_len) || (apdu[len + 1] != 8)) {
+            return BACNET_STATUS_ERROR;
+        }
+        (void) decode_double(&apdu[len + 2], &values[i]);
+        len += 10;
+    }
+    *count = i;
+
+    return len;
+}
+#endif
+
+/* array of Unsigned or Enumerated, whose encodings differ in the tag */
+static int decode_application_unsigned_tag_array(
+    uint8_t * apdu,
+    int apdu_len,
+    uint8_t tag_number,
+    uint32_t * values,
+    unsigned *count)
+{
+    int len = 0;
+    unsigned i = 0;
+    uint8_t value_len = 0;
+    uint8_t j = 0;
+    uint32_t value = 0;
+
+    for (i = 0; (i < *count) && (len < apdu_len); i++) {
+        /* application tag with a length of 1 to 4 octets */
+        if ((apdu[len] & 0xF8) != (tag_number << 4)) {
+            break;
+        }
+        value_len = apdu[len] & 0x07;
+        if ((value_len == 0) || (value_len > 4)) {
+            break;
+        }
+        if ((len + 1 + value_len) > apdu_len) {
+            return BACNET_STATUS_ERROR;
+        }
+        value = 0;
+        for (j = 1; j <= value_len; j++) {
+            value = (value << 8) | apdu[len + j];
+        }
+        values[i] = value;
+        len += 1 + value_len;
+    }
+    *count = i;
+
+    return len;
+}
+
+/** Decode the Unsigned elements at the start of an array, up to the
+ * first element of another type.
+ *
+ * @param apdu - the encoded elements
+ * @param apdu_len - number of octets in apdu
+ * @param values - where the elements go
+ * @param count - the number of values on entry, the number of
+ *  elements decoded on return
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if an
+ *  element is cut short
+ */
+int decode_application_unsigned_array(
+    uint8_t * apdu,
+    int apdu_len,
+    uint32_t * values,
+    unsigned *count)
+{
+    return decode_application_unsigned_tag_array(apdu, apdu_len,
+        BACNET_APPLICATION_TAG_UNSIGNED_INT, values, count);
+}
+
+/** Decode the Enumerated elements at the start of an array, up to the
+ * first element of another type.
+ *
+ * @param apdu - the encoded elements
+ * @param apdu_len - number of octets in apdu
+ * @param values - where the elements go
+ * @param count - the number of values on entry, the number of
+ *  elements decoded on return
+ * @return number of apdu bytes consumed, or BACNET_STATUS_ERROR if an
+ *  element is cut short
+ */
+int decode_application_enumerated_array(
+    uint8_t * apdu,
+    int apdu_len,
+    uint32_t * values,
+    unsigned *count)
+{
+    return decode_application_unsigned_tag_array(apdu, apdu_len,
+        BACNET_APPLICATION_TAG_ENUMERATED, values, count);
+}
+
 /* from clause 20.2.13 Encoding of a Time Value */
 /* and 20.2.1 General Rules for Encoding BACnet Tags */
 /* returns the number of apdu bytes consumed */
@@ -1779,6 +2180,9 @@ int encode_simple_ack(
 #include <assert.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include "ctest.h"
 
 static int get_apdu_len(
@@ -3008,6 +3412,567 @@ static void testDateContextDecodes(
     ct_test(pTest, in.year == out.year);
 }
 
+/* the tag header decoders as they were before Tag_Header_Class[],
+   kept as the reference for the differential tests and benchmark */
+static int reference_tag_number_and_value(
+    uint8_t * apdu,
+    uint8_t * tag_number,
+    uint32_t * value)
+{
+    int len = 1;
+    uint16_t value16;
+    uint32_t value32;
+
+    len = decode_tag_number(&apdu[0], tag_number);
+    if (IS_EXTENDED_VALUE(apdu[0])) {
+        /* tagged as uint32_t */
+        if (apdu[len] == 255) {
+            len++;
+            len += decode_unsigned32(&apdu[len], &value32);
+            if (value) {
+                *value = value32;
+            }
+        }
+        /* tagged as uint16_t */
+        else if (apdu[len] == 254) {
+            len++;
+            len += decode_unsigned16(&apdu[len], &value16);
+            if (value) {
+                *value = value16;
+            }
+        }
+        /* no tag - must be uint8_t */
+        else {
+            if (value) {
+                *value = apdu[len];
+            }
+            len++;
+        }
+    } else if (IS_OPENING_TAG(apdu[0]) && value) {
+        *value = 0;
+    } else if (IS_CLOSING_TAG(apdu[0]) && value) {
+        /* closing tag */
+        *value = 0;
+    } else if (value) {
+        /* small value */
+        *value = apdu[0] & 0x07;
+    }
+
+    return len;
+}
+
+static int reference_tag_number_and_value_safe(
+    uint8_t * apdu,
+    uint32_t apdu_len_remaining,
+    uint8_t * tag_number,
+    uint32_t * value)
+{
+    int len = 0;
+
+    len = decode_tag_number_safe(&apdu[0], apdu_len_remaining, tag_number);
+
+    if (len > 0) {
+        apdu_len_remaining -= len;
+        if (IS_EXTENDED_VALUE(apdu[0])) {
+            /* tagged as uint32_t */
+            if (apdu[len] == 255 && apdu_len_remaining >= 5) {
+                uint32_t value32;
+                len++;
+                len += decode_unsigned32(&apdu[len], &value32);
+                if (value) {
+                    *value = value32;
+                }
+            }
+            /* tagged as uint16_t */
+            else if (apdu[len] == 254 && apdu_len_remaining >= 3) {
+                uint16_t value16;
+                len++;
+                len += decode_unsigned16(&apdu[len], &value16);
+                if (value) {
+                    *value = value16;
+                }
+            }
+            /* no tag - must be uint8_t */
+            else if (apdu[len] < 254 && apdu_len_remaining >= 1) {
+                if (value) {
+                    *value = apdu[len];
+                }
+                len++;
+            } else {
+                /* packet is truncated */
+                len = 0;
+            }
+        } else if (IS_OPENING_TAG(apdu[0]) && value) {
+            *value = 0;
+        } else if (IS_CLOSING_TAG(apdu[0]) && value) {
+            /* closing tag */
+            *value = 0;
+        } else if (value) {
+            /* small value */
+            *value = apdu[0] & 0x07;
+        }
+    }
+    return len;
+}
+
+/** Differential check of the tag header decoders against the reference
+ * decoders, at every offset of the data.  The data is copied into a
+ * padded buffer since the reference decoders read past a truncated header.
+ *
+ * @param data - any octets
+ * @param size - number of octets
+ * @return true if every decode agreed
+ */
+static bool tag_header_differential(
+    const uint8_t * data,
+    size_t size)
+{
+    uint8_t apdu[64 + 8] = { 0 };
+    uint32_t offset = 0;
+    uint32_t remaining = 0;
+    int len = 0, ref_len = 0, safe_len = 0, ref_safe_len = 0;
+    uint8_t tag_number = 0, ref_tag_number = 0;
+    uint32_t value = 0, ref_value = 0;
+
+    if (size > 64) {
+        size = 64;
+    }
+    memcpy(apdu, data, size);
+    for (offset = 0; offset < size; offset++) {
+        remaining = (uint32_t) size - offset;
+        /* the unchecked decoders must agree on every input */
+        len = decode_tag_number_and_value(&apdu[offset], &tag_number,
+            &value);
+        ref_len = reference_tag_number_and_value(&apdu[offset],
+            &ref_tag_number, &ref_value);
+        if ((len != ref_len) || (tag_number != ref_tag_number) ||
+            (value != ref_value)) {
+            return false;
+        }
+        /* the safe decoder agrees whenever the header fits */
+        safe_len = decode_tag_number_and_value_safe(&apdu[offset],
+            remaining, &tag_number, &value);
+        if (ref_len <= (int) remaining) {
+            if ((safe_len != ref_len) || (tag_number != ref_tag_number) ||
+                (value != ref_value)) {
+                return false;
+            }
+        } else if (safe_len != 0) {
+            return false;
+        }
+        /* and with the safe reference, except where the reference took
+           a truncated extended tag number for tag number 15 */
+        ref_safe_len = reference_tag_number_and_value_safe(&apdu[offset],
+            remaining, &ref_tag_number, &ref_value);
+        if ((ref_safe_len != safe_len) &&
+            !((ref_safe_len == 1) && (remaining == 1) &&
+                IS_EXTENDED_TAG_NUMBER(apdu[offset]))) {
+            return false;
+        }
+        if (decode_tag_number_and_value_safe(&apdu[offset], remaining, NULL,
+                NULL) != safe_len) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#ifdef TEST_DECODE_FUZZER
+/* libFuzzer entry point: see the fuzz target in test/bacdcode.mak */
+int LLVMFuzzerTestOneInput(
+    const uint8_t * data,
+    size_t size)
+{
+    if (!tag_header_differential(data, size)) {
+        abort();
+    }
+
+    return 0;
+}
+#endif
+
+/* a small linear congruential generator, so runs are repeatable */
+static uint32_t tag_header_random(
+    uint32_t * seed)
+{
+    *seed = (*seed * 1103515245UL) + 12345UL;
+
+    return *seed >> 8;
+}
+
+static void testBACDCodeTagHeader(
+    Test * pTest)
+{
+    uint8_t data[16] = { 0 };
+    unsigned first = 0, second = 0, i = 0;
+    unsigned failures = 0;
+    uint32_t seed = 1;
+    size_t size = 0;
+    /* the octets that follow an extended length escape */
+    static const uint8_t tails[][4] = {
+        {0x00, 0x00, 0x00, 0x00},
+        {0x12, 0x34, 0x56, 0x78},
+        {0xFF, 0xFF, 0xFF, 0xFF},
+        {0xFE, 0xFD, 0x05, 0xF5}
+    };
+
+    /* every first and second octet, at every length */
+    for (first = 0; first < 256; first++) {
+        for (second = 0; second < 256; second++) {
+            for (i = 0; i < (sizeof(tails) / sizeof(tails[0])); i++) {
+                data[0] = (uint8_t) first;
+                data[1] = (uint8_t) second;
+                data[2] = (uint8_t) (255 - second);
+                memcpy(&data[3], tails[i], sizeof(tails[i]));
+                for (size = 1; size <= 7; size++) {
+                    if (!tag_header_differential(data, size)) {
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    ct_test(pTest, failures == 0);
+    /* random headers, biased towards the escapes */
+    failures = 0;
+    for (i = 0; i < 100000; i++) {
+        size = 1 + (tag_header_random(&seed) % sizeof(data));
+        for (first = 0; first < size; first++) {
+            data[first] = (uint8_t) tag_header_random(&seed);
+            if ((tag_header_random(&seed) & 3) == 0) {
+                data[first] |= 0xF5;
+            } else if ((tag_header_random(&seed) & 7) == 0) {
+                data[first] = 254 + (tag_header_random(&seed) & 1);
+            }
+        }
+        if (!tag_header_differential(data, size)) {
+            failures++;
+        }
+    }
+    ct_test(pTest, failures == 0);
+}
+
+/* the bulk encoders give the same octets as the element encoders */
+static void testBACDCodeArrays(
+    Test * pTest)
+{
+    uint8_t apdu[512] = { 0 };
+    uint8_t reference[512] = { 0 };
+    float real_values[BACNET_MAX_PRIORITY] = { 0.0 };
+    float real_decoded[BACNET_MAX_PRIORITY] = { 0.0 };
+    uint32_t unsigned_values[64] = { 0 };
+    uint32_t unsigned_decoded[64] = { 0 };
+#if BACNET_USE_DOUBLE
+    double double_values[8] = { 0.0 };
+    double double_decoded[8] = { 0.0 };
+#endif
+    uint16_t active_bits = 0x8125;
+    uint32_t seed = 7;
+    unsigned count = 0;
+    unsigned i = 0;
+    int len = 0, reference_len = 0;
+
+    for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
+        real_values[i] = (float) (tag_header_random(&seed) % 10000) / 7.0f;
+        reference_len +=
+            encode_application_real(&reference[reference_len],
+            real_values[i]);
+    }
+    len = encode_application_real_array(apdu, sizeof(apdu), real_values,
+        BACNET_MAX_PRIORITY);
+    ct_test(pTest, len == reference_len);
+    ct_test(pTest, memcmp(apdu, reference, len) == 0);
+    count = BACNET_MAX_PRIORITY;
+    ct_test(pTest, decode_application_real_array(apdu, len, real_decoded,
+            &count) == len);
+    ct_test(pTest, count == BACNET_MAX_PRIORITY);
+    ct_test(pTest, memcmp(real_values, real_decoded,
+            sizeof(real_values)) == 0);
+    /* no room for the last element */
+    len = encode_application_real_array(apdu, (5 * BACNET_MAX_PRIORITY) - 1,
+        real_values, BACNET_MAX_PRIORITY);
+    ct_test(pTest, len == BACNET_STATUS_ERROR);
+
+    /* a priority array with a NULL for every inactive priority */
+    reference_len = 0;
+    for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
+        if (active_bits & (1 << i)) {
+            reference_len +=
+                encode_application_real(&reference[reference_len],
+                real_values[i]);
+        } else {
+            reference_len += encode_application_null(&reference[reference_len]);
+        }
+    }
+    len = encode_application_real_priority_array(apdu, sizeof(apdu),
+        real_values, active_bits);
+    ct_test(pTest, len == reference_len);
+    ct_test(pTest, memcmp(apdu, reference, len) == 0);
+    len = encode_application_real_priority_array(apdu, reference_len - 1,
+        real_values, active_bits);
+    ct_test(pTest, len == BACNET_STATUS_ERROR);
+    /* the decoder stops at the NULL of priority 2 */
+    count = BACNET_MAX_PRIORITY;
+    len = decode_application_real_array(reference, reference_len,
+        real_decoded, &count);
+    ct_test(pTest, len == 5);
+    ct_test(pTest, count == 1);
+
+    /* unsigned and enumerated values of every length */
+    reference_len = 0;
+    for (i = 0; i < 64; i++) {
+        unsigned_values[i] = tag_header_random(&seed) >> (i % 32);
+        if (i < 4) {
+            unsigned_values[i] = 0xFFFFFFFFUL >> (8 * i);
+        }
+        reference_len +=
+            encode_application_unsigned(&reference[reference_len],
+            unsigned_values[i]);
+    }
+    len = encode_application_unsigned_array(apdu, sizeof(apdu),
+        unsigned_values, 64);
+    ct_test(pTest, len == reference_len);
+    ct_test(pTest, memcmp(apdu, reference, len) == 0);
+    count = 64;
+    ct_test(pTest, decode_application_unsigned_array(apdu, len,
+            unsigned_decoded, &count) == len);
+    ct_test(pTest, count == 64);
+    ct_test(pTest, memcmp(unsigned_values, unsigned_decoded,
+            sizeof(unsigned_values)) == 0);
+    /* an unsigned is not an enumerated */
+    count = 64;
+    ct_test(pTest, decode_application_enumerated_array(apdu, len,
+            unsigned_decoded, &count) == 0);
+    ct_test(pTest, count == 0);
+    /* the last element is cut short */
+    count = 64;
+    ct_test(pTest, decode_application_unsigned_array(apdu, len - 1,
+            unsigned_decoded, &count) == BACNET_STATUS_ERROR);
+    reference_len = 0;
+    for (i = 0; i < 64; i++) {
+        reference_len +=
+            encode_application_enumerated(&reference[reference_len],
+            unsigned_values[i]);
+    }
+    len = encode_application_enumerated_array(apdu, sizeof(apdu),
+        unsigned_values, 64);
+    ct_test(pTest, len == reference_len);
+    ct_test(pTest, memcmp(apdu, reference, len) == 0);
+    count = 64;
+    ct_test(pTest, decode_application_enumerated_array(apdu, len,
+            unsigned_decoded, &count) == len);
+    ct_test(pTest, count == 64);
+    len = encode_application_enumerated_array(apdu, reference_len - 1,
+        unsigned_values, 64);
+    ct_test(pTest, len == BACNET_STATUS_ERROR);
+
+#if BACNET_USE_DOUBLE
+    reference_len = 0;
+    for (i = 0; i < 8; i++) {
+        double_values[i] = (double) tag_header_random(&seed) / 3.0;
+        reference_len +=
+            encode_application_double(&reference[reference_len],
+            double_values[i]);
+    }
+    len = encode_application_double_array(apdu, sizeof(apdu),
+        double_values, 8);
+    ct_test(pTest, len == reference_len);
+    ct_test(pTest, memcmp(apdu, reference, len) == 0);
+    count = 8;
+    ct_test(pTest, decode_application_double_array(apdu, len,
+            double_decoded, &count) == len);
+    ct_test(pTest, count == 8);
+    ct_test(pTest, memcmp(double_values, double_decoded,
+            sizeof(double_values)) == 0);
+#endif
+}
+
+#ifdef TEST_DECODE
+/* encodes a run of tag headers like the ones found in real APDUs */
+static uint32_t tag_header_bench_encode(
+    uint8_t * apdu,
+    uint32_t max_apdu,
+    uint32_t * count)
+{
+    uint32_t len = 0;
+    uint32_t i = 0;
+    uint32_t seed = 1;
+    uint32_t lvt = 0;
+    uint8_t tag_number = 0;
+
+    *count = 0;
+    while ((len + 8) <= max_apdu) {
+        i = tag_header_random(&seed) % 16;
+        tag_number = (uint8_t) (tag_header_random(&seed) % 20);
+        if (i < 9) {
+            lvt = 1 + (i % 4);
+        } else if (i < 12) {
+            lvt = 5 + (tag_header_random(&seed) % 200);
+        } else if (i < 13) {
+            lvt = 300 + (tag_header_random(&seed) % 1000);
+        } else if (i < 14) {
+            lvt = 70000;
+        } else if (i < 15) {
+            len += encode_opening_tag(&apdu[len], tag_number);
+            (*count)++;
+            continue;
+        } else {
+            len += encode_closing_tag(&apdu[len], tag_number);
+            (*count)++;
+            continue;
+        }
+        len += encode_tag(&apdu[len], tag_number, true, lvt);
+        (*count)++;
+    }
+
+    return len;
+}
+
+static double tag_header_bench_seconds(
+    clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* decodes the same run of tag headers with each decoder */
+static void tag_header_benchmark(
+    unsigned long iterations)
+{
+    static uint8_t apdu[4096];
+    uint32_t apdu_len = 0;
+    uint32_t count = 0;
+    uint32_t offset = 0;
+    unsigned long i = 0;
+    unsigned long checksum = 0;
+    uint8_t tag_number = 0;
+    uint32_t value = 0;
+    clock_t start;
+    double seconds = 0.0;
+    double headers = 0.0;
+
+    apdu_len = tag_header_bench_encode(apdu, sizeof(apdu), &count);
+    headers = (double) count * iterations;
+    printf("%lu tag headers in %lu octets, %lu iterations\n",
+        (unsigned long) count, (unsigned long) apdu_len, iterations);
+    printf("%-32s %10s\n", "decoder", "ns/header");
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        for (offset = 0; offset < apdu_len;) {
+            offset += reference_tag_number_and_value(&apdu[offset],
+                &tag_number, &value);
+            checksum += tag_number + value;
+        }
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "reference, unchecked",
+        (seconds * 1e9) / headers);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        for (offset = 0; offset < apdu_len;) {
+            offset += decode_tag_number_and_value(&apdu[offset],
+                &tag_number, &value);
+            checksum += tag_number + value;
+        }
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "Tag_Header_Class, unchecked",
+        (seconds * 1e9) / headers);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        for (offset = 0; offset < apdu_len;) {
+            offset += reference_tag_number_and_value_safe(&apdu[offset],
+                apdu_len - offset, &tag_number, &value);
+            checksum += tag_number + value;
+        }
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "reference, safe",
+        (seconds * 1e9) / headers);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        for (offset = 0; offset < apdu_len;) {
+            offset += decode_tag_number_and_value_safe(&apdu[offset],
+                apdu_len - offset, &tag_number, &value);
+            checksum += tag_number + value;
+        }
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "Tag_Header_Class, safe",
+        (seconds * 1e9) / headers);
+    /* keeps the decodes from being optimized away */
+    printf("checksum %lu\n", checksum);
+}
+
+/* encodes the same arrays element by element and in bulk */
+static void array_benchmark(
+    unsigned long iterations)
+{
+    static uint8_t apdu[4096];
+    static float real_values[512];
+    static uint32_t unsigned_values[512];
+    uint32_t seed = 1;
+    unsigned long i = 0;
+    unsigned long checksum = 0;
+    unsigned j = 0;
+    int len = 0;
+    clock_t start;
+    double seconds = 0.0;
+    double elements = 0.0;
+
+    for (j = 0; j < 512; j++) {
+        real_values[j] = (float) (tag_header_random(&seed) % 100000) / 10.0f;
+        unsigned_values[j] = tag_header_random(&seed) >> (j % 24);
+    }
+    elements = 512.0 * iterations;
+    printf("arrays of 512 elements, %lu iterations\n", iterations);
+    printf("%-32s %10s\n", "encoder", "M elements/s");
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        len = 0;
+        for (j = 0; j < 512; j++) {
+            len += encode_application_real(&apdu[len], real_values[j]);
+        }
+        checksum += apdu[len - 1];
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "encode_application_real",
+        elements / seconds / 1e6);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        len = encode_application_real_array(apdu, sizeof(apdu), real_values,
+            512);
+        checksum += apdu[len - 1];
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "encode_application_real_array",
+        elements / seconds / 1e6);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        len = 0;
+        for (j = 0; j < 512; j++) {
+            len += encode_application_unsigned(&apdu[len],
+                unsigned_values[j]);
+        }
+        checksum += apdu[len - 1];
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "encode_application_unsigned",
+        elements / seconds / 1e6);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        len = encode_application_unsigned_array(apdu, sizeof(apdu),
+            unsigned_values, 512);
+        checksum += apdu[len - 1];
+    }
+    seconds = tag_header_bench_seconds(start);
+    printf("%-32s %10.2f\n", "encode_application_unsigned_array",
+        elements / seconds / 1e6);
+    /* keeps the encodes from being optimized away */
+    printf("checksum %lu\n", checksum);
+}
+#endif
+
 void test_BACDCode(
     Test * pTest)
 {
@@ -3062,13 +4027,19 @@ void test_BACDCode(
     assert(rc);
     rc = ct_addTestFunction(pTest, testBACDCodeDouble);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testBACDCodeTagHeader);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testBACDCodeArrays);
+    assert(rc);
 }
 
 #ifdef TEST_DECODE
 int main(
-    void)
+    int argc,
+    char *argv[])
 {
     Test *pTest;
+    unsigned long iterations = 2000;
 
     pTest = ct_create("BACDCode", NULL);
     test_BACDCode(pTest);
@@ -3079,6 +4050,12 @@ int main(
     (void) ct_report(pTest);
     ct_destroy(pTest);
 
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    tag_header_benchmark(iterations);
+    array_benchmark(iterations);
+
     return 0;
 }
 #endif /* TEST_DECODE */
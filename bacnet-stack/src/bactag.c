@@ -0,0 +1,713 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacdcode.h"
+#include "bacreal.h"
+#include "bacstr.h"
+#include "bactag.h"
+
+/** @file bactag.c  Zero copy cursor over the tags of an encoded APDU. */
+
+/* decodes the tag at the start of apdu, bounds checked.
+   Returns the length of the tag and its contents, or zero. */
+static uint32_t bactag_decode(
+    uint8_t * apdu,
+    uint32_t apdu_len,
+    BACNET_TAG * tag)
+{
+    uint32_t len = 0;
+
+    len = (uint32_t) decode_tag_number_and_value_safe(apdu, apdu_len,
+        &tag->number, &tag->len_value_type);
+    if (len == 0) {
+        return 0;
+    }
+    tag->context = IS_CONTEXT_SPECIFIC(apdu[0]);
+    tag->opening = IS_OPENING_TAG(apdu[0]);
+    tag->closing = IS_CLOSING_TAG(apdu[0]);
+    if ((tag->opening || tag->closing) && !tag->context) {
+        /* only context tags are constructed */
+        return 0;
+    }
+    tag->header_len = (uint8_t) len;
+    tag->contents = &apdu[len];
+    if (!tag->context && (tag->number == BACNET_APPLICATION_TAG_BOOLEAN)) {
+        /* the value of an application Boolean is in the tag */
+        tag->contents_len = 0;
+    } else {
+        tag->contents_len = tag->len_value_type;
+    }
+    if (tag->contents_len > (apdu_len - len)) {
+        return 0;
+    }
+
+    return len + tag->contents_len;
+}
+
+/** Start a cursor at the first tag of an encoded APDU.
+ *
+ * @param cursor - cursor to initialize
+ * @param apdu - the encoded data, which must outlive the cursor
+ * @param apdu_len - number of octets of encoded data
+ */
+void bactag_cursor_init(
+    BACNET_TAG_CURSOR * cursor,
+    uint8_t * apdu,
+    uint32_t apdu_len)
+{
+    if (cursor) {
+        cursor->apdu = apdu;
+        cursor->apdu_len = apdu ? apdu_len : 0;
+        cursor->offset = 0;
+        cursor->depth = 0;
+        cursor->error = false;
+    }
+}
+
+/** Check if the cursor has walked all of its data, or stopped on
+ * an error.
+ *
+ * @param cursor - cursor to check
+ * @return true if there are no more tags
+ */
+bool bactag_cursor_end(
+    BACNET_TAG_CURSOR * cursor)
+{
+    return (!cursor || cursor->error ||
+        (cursor->offset >= cursor->apdu_len));
+}
+
+/** Decode the next tag without moving the cursor.
+ *
+ * @param cursor - cursor of the data
+ * @param tag - the next tag
+ * @return true if there is a next tag; false at the end, or if the next
+ *         tag is malformed or truncated, which also sets the error flag
+ */
+bool bactag_peek(
+    BACNET_TAG_CURSOR * cursor,
+    BACNET_TAG * tag)
+{
+    uint32_t len = 0;
+
+    if (bactag_cursor_end(cursor) || !tag) {
+        return false;
+    }
+    len =
+        bactag_decode(&cursor->apdu[cursor->offset],
+        cursor->apdu_len - cursor->offset, tag);
+    if (len == 0) {
+        cursor->error = true;
+        return false;
+    }
+
+    return true;
+}
+
+/** Decode the next tag and move the cursor past it and its contents.
+ * The cursor enters constructed data: the tags between an opening and
+ * closing tag come next.
+ *
+ * @param cursor - cursor of the data
+ * @param tag - the tag, or NULL to just move past it
+ * @return true if there was a next tag
+ */
+bool bactag_next(
+    BACNET_TAG_CURSOR * cursor,
+    BACNET_TAG * tag)
+{
+    BACNET_TAG next_tag;
+
+    if (!tag) {
+        tag = &next_tag;
+    }
+    if (!bactag_peek(cursor, tag)) {
+        return false;
+    }
+    if (tag->opening) {
+        cursor->depth++;
+    } else if (tag->closing) {
+        if (cursor->depth == 0) {
+            /* closes something that was never opened */
+            cursor->error = true;
+            return false;
+        }
+        cursor->depth--;
+    }
+    cursor->offset += tag->header_len + tag->contents_len;
+
+    return true;
+}
+
+/** Move the cursor past the next value: a primitive tag, or all of
+ * constructed data up to and including its closing tag.
+ *
+ * @param cursor - cursor of the data
+ * @return true if a value was skipped; false at a closing tag, at the
+ *         end, or on an error
+ */
+bool bactag_skip(
+    BACNET_TAG_CURSOR * cursor)
+{
+    BACNET_TAG tag;
+    unsigned depth = 0;
+
+    if (!bactag_peek(cursor, &tag) || tag.closing) {
+        return false;
+    }
+    depth = cursor->depth;
+    (void) bactag_next(cursor, &tag);
+    while (cursor->depth > depth) {
+        if (!bactag_next(cursor, &tag)) {
+            /* the closing tag is missing */
+            cursor->error = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Move the cursor past the rest of the constructed data it is in,
+ * up to and including the closing tag.
+ *
+ * @param cursor - cursor of the data
+ * @return true if the closing tag was found
+ */
+bool bactag_skip_to_closing(
+    BACNET_TAG_CURSOR * cursor)
+{
+    BACNET_TAG tag;
+
+    if (!cursor || (cursor->depth == 0)) {
+        return false;
+    }
+    while (bactag_skip(cursor)) {
+        /* skip the values in between */
+    }
+    if (!bactag_peek(cursor, &tag) || !tag.closing) {
+        cursor->error = true;
+        return false;
+    }
+
+    return bactag_next(cursor, &tag);
+}
+
+/** Find a context tag among the values at the level of the cursor,
+ * skipping the other values, including constructed ones, without
+ * decoding them.  The search stops at the closing tag of the level.
+ * When the tag is found, the cursor is moved past it, so an opening tag
+ * is entered.
+ *
+ * @param cursor - cursor of the data
+ * @param tag_number - context tag number to find
+ * @param tag - the tag that was found, or NULL
+ * @return true if the tag was found
+ */
+bool bactag_find_context(
+    BACNET_TAG_CURSOR * cursor,
+    uint8_t tag_number,
+    BACNET_TAG * tag)
+{
+    BACNET_TAG found;
+
+    if (!tag) {
+        tag = &found;
+    }
+    while (bactag_peek(cursor, tag) && !tag->closing) {
+        if (tag->context && (tag->number == tag_number)) {
+            return bactag_next(cursor, tag);
+        }
+        if (!bactag_skip(cursor)) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+/** Set up a cursor over the contents of the constructed data that is
+ * next, and move the outer cursor past its closing tag.  This hands
+ * a part of the data to other code without decoding it.
+ *
+ * @param cursor - cursor of the data; the next tag must be the
+ *                 opening tag
+ * @param tag_number - the context tag number of the opening tag
+ * @param inner - cursor over the tags between the opening and closing tag
+ * @return true if the constructed data was found and is complete
+ */
+bool bactag_enter(
+    BACNET_TAG_CURSOR * cursor,
+    uint8_t tag_number,
+    BACNET_TAG_CURSOR * inner)
+{
+    BACNET_TAG tag;
+    uint32_t start = 0;
+    uint32_t end = 0;
+
+    if (!inner || !bactag_peek(cursor, &tag) || !tag.opening ||
+        (tag.number != tag_number)) {
+        return false;
+    }
+    start = cursor->offset + tag.header_len;
+    if (!bactag_skip(cursor)) {
+        return false;
+    }
+    /* the closing tag is the same size as the opening tag */
+    end = cursor->offset - tag.header_len;
+    bactag_cursor_init(inner, &cursor->apdu[start], end - start);
+
+    return true;
+}
+
+/** Check if a tag is an application tag of the given type.
+ *
+ * @param tag - the tag
+ * @param application_tag - the data type
+ * @return true if it is
+ */
+bool bactag_is_application(
+    BACNET_TAG * tag,
+    BACNET_APPLICATION_TAG application_tag)
+{
+    return (tag && !tag->context && (tag->number == application_tag));
+}
+
+/* The functions below materialize the value of a single tag, when the
+   caller wants it.  They return false if the tag cannot hold a value of
+   the data type: an application tag of another type, constructed data,
+   or a wrong length for the type.  Context tags are taken to be of the
+   type that the caller asks for. */
+
+/* true if the tag can hold a primitive value of the data type:
+   an application tag of that type, or any primitive context tag */
+static bool bactag_primitive(
+    BACNET_TAG * tag,
+    BACNET_APPLICATION_TAG application_tag)
+{
+    if (!tag || tag->opening || tag->closing) {
+        return false;
+    }
+
+    return (tag->context || (tag->number == application_tag));
+}
+
+bool bactag_null(
+    BACNET_TAG * tag)
+{
+    return (bactag_primitive(tag, BACNET_APPLICATION_TAG_NULL) &&
+        (tag->contents_len == 0));
+}
+
+bool bactag_boolean(
+    BACNET_TAG * tag,
+    bool * value)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_BOOLEAN) || !value) {
+        return false;
+    }
+    if (!tag->context) {
+        *value = decode_boolean(tag->len_value_type);
+    } else if (tag->contents_len == 1) {
+        *value = tag->contents[0] ? true : false;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool bactag_unsigned(
+    BACNET_TAG * tag,
+    uint32_t * value)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_UNSIGNED_INT) ||
+        !value || (tag->contents_len == 0) || (tag->contents_len > 4)) {
+        return false;
+    }
+
+    return (decode_unsigned(tag->contents, tag->contents_len, value) > 0);
+}
+
+bool bactag_signed(
+    BACNET_TAG * tag,
+    int32_t * value)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_SIGNED_INT) ||
+        !value || (tag->contents_len == 0) || (tag->contents_len > 4)) {
+        return false;
+    }
+
+    return (decode_signed(tag->contents, tag->contents_len, value) > 0);
+}
+
+bool bactag_enumerated(
+    BACNET_TAG * tag,
+    uint32_t * value)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_ENUMERATED) ||
+        !value || (tag->contents_len == 0) || (tag->contents_len > 4)) {
+        return false;
+    }
+
+    return (decode_enumerated(tag->contents, tag->contents_len, value) > 0);
+}
+
+bool bactag_real(
+    BACNET_TAG * tag,
+    float *value)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_REAL) || !value ||
+        (tag->contents_len != 4)) {
+        return false;
+    }
+
+    return (decode_real(tag->contents, value) == 4);
+}
+
+bool bactag_double(
+    BACNET_TAG * tag,
+    double *value)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_DOUBLE) || !value ||
+        (tag->contents_len != 8)) {
+        return false;
+    }
+
+    return (decode_double(tag->contents, value) == 8);
+}
+
+bool bactag_object_id(
+    BACNET_TAG * tag,
+    BACNET_OBJECT_TYPE * object_type,
+    uint32_t * instance)
+{
+    uint16_t type = 0;
+
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_OBJECT_ID) ||
+        !object_type || !instance || (tag->contents_len != 4)) {
+        return false;
+    }
+    (void) decode_object_id(tag->contents, &type, instance);
+    *object_type = (BACNET_OBJECT_TYPE) type;
+
+    return true;
+}
+
+bool bactag_date(
+    BACNET_TAG * tag,
+    BACNET_DATE * bdate)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_DATE) || !bdate ||
+        (tag->contents_len != 4)) {
+        return false;
+    }
+
+    return (decode_date(tag->contents, bdate) == 4);
+}
+
+bool bactag_time(
+    BACNET_TAG * tag,
+    BACNET_TIME * btime)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_TIME) || !btime ||
+        (tag->contents_len != 4)) {
+        return false;
+    }
+
+    return (decode_bacnet_time(tag->contents, btime) == 4);
+}
+
+bool bactag_character_string(
+    BACNET_TAG * tag,
+    BACNET_CHARACTER_STRING * char_string)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_CHARACTER_STRING) ||
+        !char_string || (tag->contents_len == 0)) {
+        return false;
+    }
+
+    return characterstring_init(char_string, tag->contents[0],
+        (char *) &tag->contents[1], tag->contents_len - 1);
+}
+
+bool bactag_octet_string(
+    BACNET_TAG * tag,
+    BACNET_OCTET_STRING * octet_string)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_OCTET_STRING) ||
+        !octet_string) {
+        return false;
+    }
+
+    return octetstring_init(octet_string, tag->contents, tag->contents_len);
+}
+
+bool bactag_bit_string(
+    BACNET_TAG * tag,
+    BACNET_BIT_STRING * bit_string)
+{
+    if (!bactag_primitive(tag, BACNET_APPLICATION_TAG_BIT_STRING) ||
+        !bit_string || (tag->contents_len == 0) ||
+        ((tag->contents_len - 1) > MAX_BITSTRING_BYTES)) {
+        return false;
+    }
+
+    return (decode_bitstring(tag->contents, tag->contents_len,
+            bit_string) > 0);
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+/* encodes a sample of tags, and returns its length */
+static int bactag_test_encode(
+    uint8_t * apdu)
+{
+    int len = 0;
+    unsigned i = 0;
+    BACNET_CHARACTER_STRING char_string;
+    BACNET_OCTET_STRING octet_string;
+    BACNET_BIT_STRING bit_string;
+    BACNET_DATE bdate = { 2016, 8, 29, 1 };
+    BACNET_TIME btime = { 12, 34, 56, 78 };
+    uint8_t octets[300];
+
+    len += encode_application_unsigned(&apdu[len], 123456);
+    len += encode_context_real(&apdu[len], 0, 3.5f);
+    len += encode_opening_tag(&apdu[len], 3);
+    characterstring_init_ansi(&char_string, "tag cursor");
+    len += encode_application_character_string(&apdu[len], &char_string);
+    len += encode_opening_tag(&apdu[len], 1);
+    len += encode_application_boolean(&apdu[len], true);
+    len += encode_context_unsigned(&apdu[len], 2, 7);
+    len += encode_closing_tag(&apdu[len], 1);
+    /* an extended tag number */
+    len += encode_context_unsigned(&apdu[len], 200, 65535);
+    len += encode_closing_tag(&apdu[len], 3);
+    /* an extended length */
+    for (i = 0; i < sizeof(octets); i++) {
+        octets[i] = (uint8_t) i;
+    }
+    octetstring_init(&octet_string, octets, sizeof(octets));
+    len += encode_application_octet_string(&apdu[len], &octet_string);
+    len += encode_application_double(&apdu[len], -1.25);
+    len += encode_application_signed(&apdu[len], -300);
+    len += encode_application_enumerated(&apdu[len], 8);
+    len += encode_application_object_id(&apdu[len], OBJECT_DEVICE, 4194302);
+    len += encode_application_date(&apdu[len], &bdate);
+    len += encode_application_time(&apdu[len], &btime);
+    bitstring_init(&bit_string);
+    bitstring_set_bit(&bit_string, 2, true);
+    len += encode_application_bitstring(&apdu[len], &bit_string);
+    len += encode_application_null(&apdu[len]);
+
+    return len;
+}
+
+void testBACnetTagCursor(
+    Test * pTest)
+{
+    uint8_t apdu[512] = { 0 };
+    int apdu_len = 0;
+    uint32_t i = 0;
+    unsigned count = 0;
+    BACNET_TAG_CURSOR cursor;
+    BACNET_TAG_CURSOR inner;
+    BACNET_TAG tag;
+    uint32_t unsigned_value = 0;
+    int32_t signed_value = 0;
+    float real_value = 0.0f;
+    double double_value = 0.0;
+    bool boolean_value = false;
+    BACNET_OBJECT_TYPE object_type = OBJECT_ANALOG_INPUT;
+    uint32_t instance = 0;
+    BACNET_DATE bdate;
+    BACNET_TIME btime;
+    BACNET_CHARACTER_STRING char_string;
+    BACNET_OCTET_STRING octet_string;
+    BACNET_BIT_STRING bit_string;
+
+    apdu_len = bactag_test_encode(&apdu[0]);
+    /* walk every tag */
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_is_application(&tag,
+            BACNET_APPLICATION_TAG_UNSIGNED_INT));
+    ct_test(pTest, bactag_unsigned(&tag, &unsigned_value));
+    ct_test(pTest, unsigned_value == 123456);
+    /* the wrong type is refused */
+    ct_test(pTest, !bactag_real(&tag, &real_value));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, tag.context && (tag.number == 0));
+    ct_test(pTest, bactag_real(&tag, &real_value));
+    ct_test(pTest, real_value == 3.5f);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, tag.opening && (tag.number == 3));
+    ct_test(pTest, cursor.depth == 1);
+    ct_test(pTest, !bactag_unsigned(&tag, &unsigned_value));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_character_string(&tag, &char_string));
+    ct_test(pTest, characterstring_ansi_same(&char_string, "tag cursor"));
+    /* the contents are referenced, not copied */
+    ct_test(pTest, (tag.contents > &apdu[0]) &&
+        (tag.contents < &apdu[apdu_len]));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, tag.opening && (tag.number == 1));
+    ct_test(pTest, cursor.depth == 2);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_boolean(&tag, &boolean_value));
+    ct_test(pTest, boolean_value == true);
+    ct_test(pTest, tag.contents_len == 0);
+    /* the rest of the inner constructed data */
+    ct_test(pTest, bactag_skip_to_closing(&cursor));
+    ct_test(pTest, cursor.depth == 1);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, tag.context && (tag.number == 200));
+    ct_test(pTest, tag.header_len == 2);
+    ct_test(pTest, bactag_unsigned(&tag, &unsigned_value));
+    ct_test(pTest, unsigned_value == 65535);
+    /* at a closing tag, there is nothing to skip */
+    ct_test(pTest, !bactag_skip(&cursor));
+    ct_test(pTest, !cursor.error);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, tag.closing && (tag.number == 3));
+    ct_test(pTest, cursor.depth == 0);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_octet_string(&tag, &octet_string));
+    ct_test(pTest, octetstring_length(&octet_string) == 300);
+    ct_test(pTest, tag.header_len == 4);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_double(&tag, &double_value));
+    ct_test(pTest, double_value == -1.25);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_signed(&tag, &signed_value));
+    ct_test(pTest, signed_value == -300);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_enumerated(&tag, &unsigned_value));
+    ct_test(pTest, unsigned_value == 8);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_object_id(&tag, &object_type, &instance));
+    ct_test(pTest, object_type == OBJECT_DEVICE);
+    ct_test(pTest, instance == 4194302);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_date(&tag, &bdate));
+    ct_test(pTest, (bdate.year == 2016) && (bdate.month == 8) &&
+        (bdate.day == 29));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_time(&tag, &btime));
+    ct_test(pTest, (btime.hour == 12) && (btime.min == 34) &&
+        (btime.sec == 56) && (btime.hundredths == 78));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_bit_string(&tag, &bit_string));
+    ct_test(pTest, bitstring_bit(&bit_string, 2));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_null(&tag));
+    ct_test(pTest, !bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_cursor_end(&cursor));
+    ct_test(pTest, !cursor.error);
+
+    /* skip whole values, and find a context tag past constructed data */
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    count = 0;
+    while (bactag_skip(&cursor)) {
+        count++;
+    }
+    ct_test(pTest, count == 12);
+    ct_test(pTest, !cursor.error);
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    ct_test(pTest, !bactag_find_context(&cursor, 200, &tag));
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    ct_test(pTest, bactag_find_context(&cursor, 3, &tag));
+    ct_test(pTest, tag.opening);
+    ct_test(pTest, bactag_find_context(&cursor, 200, &tag));
+    ct_test(pTest, bactag_unsigned(&tag, &unsigned_value));
+    ct_test(pTest, unsigned_value == 65535);
+    /* hand out the constructed data */
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    ct_test(pTest, bactag_skip(&cursor));
+    ct_test(pTest, bactag_skip(&cursor));
+    ct_test(pTest, !bactag_enter(&cursor, 1, &inner));
+    ct_test(pTest, bactag_enter(&cursor, 3, &inner));
+    ct_test(pTest, cursor.depth == 0);
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_octet_string(&tag, &octet_string));
+    count = 0;
+    while (bactag_skip(&inner)) {
+        count++;
+    }
+    ct_test(pTest, count == 3);
+    ct_test(pTest, bactag_cursor_end(&inner));
+    ct_test(pTest, !inner.error);
+
+    /* a truncated APDU is an error, and nothing beyond it is read */
+    for (i = 1; i < (uint32_t) apdu_len; i++) {
+        bactag_cursor_init(&cursor, &apdu[0], i);
+        while (bactag_next(&cursor, &tag)) {
+            ct_test(pTest, (tag.contents + tag.contents_len) <= &apdu[i]);
+        }
+        ct_test(pTest, cursor.offset <= i);
+        if (cursor.offset < i) {
+            ct_test(pTest, cursor.error);
+        }
+    }
+    /* closing a tag that was not opened */
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    apdu[0] = 0x1F;
+    ct_test(pTest, !bactag_next(&cursor, &tag));
+    ct_test(pTest, cursor.error);
+    /* an application tag cannot be constructed */
+    bactag_cursor_init(&cursor, &apdu[0], apdu_len);
+    apdu[0] = 0x26;
+    ct_test(pTest, !bactag_next(&cursor, &tag));
+    ct_test(pTest, cursor.error);
+}
+
+#ifdef TEST_BACTAG
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Tag Cursor", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testBACnetTagCursor);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_BACTAG */
+#endif /* TEST */
@@ -32,11 +32,14 @@
  -------------------------------------------
 ####COPYRIGHTEND####*/
 #include <stdint.h>
+#include <string.h>
 #include "bacenum.h"
 #include "bacdcode.h"
 #include "bacdef.h"
 #include "bacapp.h"
+#include "bacreal.h"
 #include "cov.h"
+#include "bactag.h"
 
 /** @file cov.c  Encode/Decode Change of Value (COV) services */
 
@@ -168,6 +171,161 @@ int ucov_notify_encode_apdu(
     return apdu_len;
 }
 
+/** Encode the start of a COV notification once, for a subscription
+ * that sends the Present_Value and Status_Flags of its object.
+ *
+ * @param cov_template [out] the encoded notification
+ * @param confirmed [in] true for a ConfirmedCOVNotification
+ * @param data [in] the subscriber process, initiating device and
+ *  monitored object of the notification
+ */
+void cov_notify_template_init(
+    BACNET_COV_NOTIFY_TEMPLATE * cov_template,
+    bool confirmed,
+    BACNET_COV_DATA * data)
+{
+    uint8_t *apdu = NULL;
+    int apdu_len = 0;
+
+    if (!cov_template || !data) {
+        return;
+    }
+    apdu = &cov_template->apdu[0];
+    memset(apdu, 0, sizeof(cov_template->apdu));
+    if (confirmed) {
+        apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+        apdu[2] = 0;
+        apdu[3] = SERVICE_CONFIRMED_COV_NOTIFICATION;
+        apdu_len = 4;
+    } else {
+        apdu[0] = PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST;
+        apdu[1] = SERVICE_UNCONFIRMED_COV_NOTIFICATION;
+        apdu_len = 2;
+    }
+    apdu_len +=
+        encode_context_unsigned(&apdu[apdu_len], 0,
+        data->subscriberProcessIdentifier);
+    apdu_len +=
+        encode_context_object_id(&apdu[apdu_len], 1, OBJECT_DEVICE,
+        data->initiatingDeviceIdentifier);
+    apdu_len +=
+        encode_context_object_id(&apdu[apdu_len], 2,
+        (int) data->monitoredObjectIdentifier.type,
+        data->monitoredObjectIdentifier.instance);
+    cov_template->apdu_len = (uint8_t) apdu_len;
+    cov_template->confirmed = confirmed;
+    cov_template->subscriberProcessIdentifier =
+        data->subscriberProcessIdentifier;
+    cov_template->initiatingDeviceIdentifier =
+        data->initiatingDeviceIdentifier;
+    cov_template->monitoredObjectIdentifier = data->monitoredObjectIdentifier;
+}
+
+/** Tell whether a template still encodes the start of a notification.
+ *
+ * @param cov_template [in] the encoded notification
+ * @param confirmed [in] true for a ConfirmedCOVNotification
+ * @param data [in] the subscriber process, initiating device and
+ *  monitored object of the notification
+ * @return true if the template can be used for the notification
+ */
+bool cov_notify_template_valid(
+    BACNET_COV_NOTIFY_TEMPLATE * cov_template,
+    bool confirmed,
+    BACNET_COV_DATA * data)
+{
+    if (!cov_template || !data || !cov_template->apdu_len) {
+        return false;
+    }
+
+    return (cov_template->confirmed == confirmed) &&
+        (cov_template->subscriberProcessIdentifier ==
+        data->subscriberProcessIdentifier) &&
+        (cov_template->initiatingDeviceIdentifier ==
+        data->initiatingDeviceIdentifier) &&
+        (cov_template->monitoredObjectIdentifier.type ==
+        data->monitoredObjectIdentifier.type) &&
+        (cov_template->monitoredObjectIdentifier.instance ==
+        data->monitoredObjectIdentifier.instance);
+}
+
+/** Encode a COV notification of Present_Value and Status_Flags from a
+ * template.  The result is the same as ccov_notify_encode_apdu() or
+ * ucov_notify_encode_apdu() with a list of those two values.
+ *
+ * @param apdu [out] buffer for the notification
+ * @param cov_template [in] the start encoded by cov_notify_template_init()
+ * @param invoke_id [in] the invoke ID of a confirmed notification
+ * @param timeRemaining [in] seconds left in the subscription
+ * @param present_value [in] the Present_Value of the object
+ * @param status_flags [in] the Status_Flags of the object
+ * @return number of octets encoded, or 0 on error
+ */
+int cov_notify_template_encode(
+    uint8_t * apdu,
+    BACNET_COV_NOTIFY_TEMPLATE * cov_template,
+    uint8_t invoke_id,
+    uint32_t timeRemaining,
+    BACNET_APPLICATION_DATA_VALUE * present_value,
+    BACNET_APPLICATION_DATA_VALUE * status_flags)
+{
+    int apdu_len = 0;
+
+    if (!apdu || !cov_template || !present_value || !status_flags) {
+        return 0;
+    }
+    /* a fixed size copy is a few moves instead of a call to memcpy();
+       the octets past the template are written over below */
+    memcpy(apdu, cov_template->apdu, sizeof(cov_template->apdu));
+    if (cov_template->confirmed) {
+        apdu[2] = invoke_id;
+    }
+    apdu_len = cov_template->apdu_len;
+    /* tag 3 - timeRemaining */
+    apdu_len += encode_context_unsigned(&apdu[apdu_len], 3, timeRemaining);
+    /* tag 4 - listOfValues: { [0] present-value, [2] { value } } */
+    apdu[apdu_len++] = 0x4E;
+    apdu[apdu_len++] = 0x09;
+    apdu[apdu_len++] = PROP_PRESENT_VALUE;
+    apdu[apdu_len++] = 0x2E;
+    switch (present_value->tag) {
+        case BACNET_APPLICATION_TAG_REAL:
+            apdu[apdu_len++] = (BACNET_APPLICATION_TAG_REAL << 4) | 4;
+            apdu_len +=
+                encode_bacnet_real(present_value->type.Real,
+                &apdu[apdu_len]);
+            break;
+        case BACNET_APPLICATION_TAG_ENUMERATED:
+            apdu_len +=
+                encode_application_enumerated(&apdu[apdu_len],
+                present_value->type.Enumerated);
+            break;
+        case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+            apdu_len +=
+                encode_application_unsigned(&apdu[apdu_len],
+                present_value->type.Unsigned_Int);
+            break;
+        default:
+            apdu_len +=
+                bacapp_encode_application_data(&apdu[apdu_len],
+                present_value);
+            break;
+    }
+    /* [0] status-flags, [2] { value } */
+    apdu[apdu_len++] = 0x2F;
+    apdu[apdu_len++] = 0x09;
+    apdu[apdu_len++] = PROP_STATUS_FLAGS;
+    apdu[apdu_len++] = 0x2E;
+    apdu_len +=
+        encode_application_bitstring(&apdu[apdu_len],
+        &status_flags->type.Bit_String);
+    apdu[apdu_len++] = 0x2F;
+    apdu[apdu_len++] = 0x4F;
+
+    return apdu_len;
+}
+
 /* decode the service request only */
 /* COV and Unconfirmed COV are the same */
 int cov_notify_decode_service_request(
@@ -317,6 +475,67 @@ int cov_notify_decode_service_request(
     return len;
 }
 
+/** Find the value of one property in the listOfValues of a COV
+ * notification, without decoding the rest of the notification.
+ * @ingroup DSCOV
+ *
+ * @param apdu [in] The service request of the notification.
+ * @param apdu_len [in] Length of the service request.
+ * @param property [in] The property.
+ * @param array_index [in] Its array index, or BACNET_ARRAY_ALL.
+ * @param value [out] Cursor over the tags of the value.
+ * @return true if the property is in the notification
+ */
+bool cov_notify_value_find(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_PROPERTY_ID property,
+    uint32_t array_index,
+    BACNET_TAG_CURSOR * value)
+{
+    BACNET_TAG_CURSOR cursor;
+    BACNET_TAG tag;
+    uint32_t test_property = 0;
+    uint32_t test_array_index = 0;
+
+    bactag_cursor_init(&cursor, apdu, apdu_len);
+    /* Tag 4: listOfValues */
+    if (!bactag_find_context(&cursor, 4, &tag) || !tag.opening) {
+        return false;
+    }
+    while (bactag_next(&cursor, &tag) && !tag.closing) {
+        /* Tag 0: propertyIdentifier */
+        if (!tag.context || (tag.number != 0) ||
+            !bactag_enumerated(&tag, &test_property)) {
+            return false;
+        }
+        /* Tag 1: propertyArrayIndex OPTIONAL */
+        test_array_index = BACNET_ARRAY_ALL;
+        if (bactag_peek(&cursor, &tag) && tag.context && (tag.number == 1) &&
+            !tag.opening) {
+            (void) bactag_next(&cursor, &tag);
+            if (!bactag_unsigned(&tag, &test_array_index)) {
+                return false;
+            }
+        }
+        /* Tag 2: value */
+        if ((test_property == (uint32_t) property) &&
+            (test_array_index == array_index)) {
+            return bactag_enter(&cursor, 2, value);
+        }
+        if (!bactag_skip(&cursor)) {
+            return false;
+        }
+        /* Tag 3: priority OPTIONAL */
+        if (bactag_peek(&cursor, &tag) && tag.context && (tag.number == 3) &&
+            !tag.opening) {
+            (void) bactag_next(&cursor, &tag);
+        }
+    }
+
+    return false;
+}
+
 /*
 12.11.38Active_COV_Subscriptions
 The Active_COV_Subscriptions property is a List of BACnetCOVSubscription,
@@ -681,6 +900,9 @@ void cov_data_value_list_link(
 #ifdef TEST
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include "ctest.h"
 #include "bacapp.h"
 
@@ -851,6 +1073,9 @@ void testUCOVNotifyData(
     int apdu_len = 0;
     BACNET_COV_DATA test_data;
     BACNET_PROPERTY_VALUE value_list[5] = {{0}};
+    BACNET_PROPERTY_VALUE *value;
+    BACNET_TAG_CURSOR cursor;
+    BACNET_TAG tag;
 
     len = ucov_notify_encode_apdu(&apdu[0], data);
     ct_test(pTest, len > 0);
@@ -860,6 +1085,20 @@ void testUCOVNotifyData(
     len = ucov_notify_decode_apdu(&apdu[0], apdu_len, &test_data);
     ct_test(pTest, len != -1);
     testCOVNotifyData(pTest, data, &test_data);
+
+    /* pull single values out of the service request */
+    value = data->listOfValues;
+    while (value) {
+        ct_test(pTest, cov_notify_value_find(&apdu[2], apdu_len - 2,
+                value->propertyIdentifier, value->propertyArrayIndex,
+                &cursor));
+        ct_test(pTest, bactag_next(&cursor, &tag));
+        ct_test(pTest, bactag_is_application(&tag, value->value.tag));
+        ct_test(pTest, bactag_cursor_end(&cursor));
+        value = value->next;
+    }
+    ct_test(pTest, !cov_notify_value_find(&apdu[2], apdu_len - 2,
+            PROP_OBJECT_NAME, BACNET_ARRAY_ALL, &cursor));
 }
 
 void testCCOVNotifyData(
@@ -918,6 +1157,132 @@ void testCOVNotify(
     testCCOVNotifyData(pTest, invoke_id, &data);
 }
 
+/* compares the template encoding of a notification to the generic one */
+static void testCOVNotifyTemplateData(
+    Test * pTest,
+    uint8_t invoke_id,
+    BACNET_COV_DATA * data)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    uint8_t test_apdu[MAX_APDU] = { 0 };
+    int len = 0, test_len = 0;
+    BACNET_COV_NOTIFY_TEMPLATE cov_template;
+    BACNET_PROPERTY_VALUE *value_list = data->listOfValues;
+
+    cov_notify_template_init(&cov_template, false, data);
+    ct_test(pTest, cov_notify_template_valid(&cov_template, false, data));
+    ct_test(pTest, !cov_notify_template_valid(&cov_template, true, data));
+    /* a changed subscription needs a new template */
+    data->subscriberProcessIdentifier++;
+    ct_test(pTest, !cov_notify_template_valid(&cov_template, false, data));
+    data->subscriberProcessIdentifier--;
+    len = ucov_notify_encode_apdu(&apdu[0], data);
+    test_len =
+        cov_notify_template_encode(&test_apdu[0], &cov_template, invoke_id,
+        data->timeRemaining, &value_list->value, &value_list->next->value);
+    ct_test(pTest, len == test_len);
+    ct_test(pTest, memcmp(apdu, test_apdu, (size_t) len) == 0);
+    cov_notify_template_init(&cov_template, true, data);
+    ct_test(pTest, cov_notify_template_valid(&cov_template, true, data));
+    len = ccov_notify_encode_apdu(&apdu[0], invoke_id, data);
+    test_len =
+        cov_notify_template_encode(&test_apdu[0], &cov_template, invoke_id,
+        data->timeRemaining, &value_list->value, &value_list->next->value);
+    ct_test(pTest, len == test_len);
+    ct_test(pTest, memcmp(apdu, test_apdu, (size_t) len) == 0);
+}
+
+void testCOVNotifyTemplate(
+    Test * pTest)
+{
+    BACNET_COV_DATA data;
+    BACNET_PROPERTY_VALUE value_list[2] = {{0}};
+    static const char *values[][2] = {
+        {"4", "-40.5"},
+        {"9", "1"},
+        {"2", "70000"},
+        {"1", "1"}
+    };
+    unsigned i = 0;
+
+    cov_data_value_list_link(&data, &value_list[0], 2);
+    value_list[0].propertyIdentifier = PROP_PRESENT_VALUE;
+    value_list[0].propertyArrayIndex = BACNET_ARRAY_ALL;
+    value_list[0].priority = BACNET_NO_PRIORITY;
+    value_list[1].propertyIdentifier = PROP_STATUS_FLAGS;
+    value_list[1].propertyArrayIndex = BACNET_ARRAY_ALL;
+    value_list[1].priority = BACNET_NO_PRIORITY;
+    bacapp_parse_application_data(BACNET_APPLICATION_TAG_BIT_STRING, "1010",
+        &value_list[1].value);
+    for (i = 0; i < (sizeof(values) / sizeof(values[0])); i++) {
+        data.subscriberProcessIdentifier = i ? 0xFFFFFFFF : 0;
+        data.initiatingDeviceIdentifier = 4194302;
+        data.monitoredObjectIdentifier.type = OBJECT_BINARY_VALUE;
+        data.monitoredObjectIdentifier.instance = i;
+        data.timeRemaining = i * 40000;
+        bacapp_parse_application_data((BACNET_APPLICATION_TAG)
+            atoi(values[i][0]), values[i][1], &value_list[0].value);
+        testCOVNotifyTemplateData(pTest, (uint8_t) (i + 1), &data);
+    }
+}
+
+#ifdef TEST_COV
+static double cov_bench_seconds(
+    clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* a notification of a REAL Present_Value, generic and from a template */
+static void cov_notify_template_benchmark(
+    unsigned long iterations)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    unsigned long i = 0;
+    unsigned long checksum = 0;
+    BACNET_COV_DATA data;
+    BACNET_PROPERTY_VALUE value_list[2] = {{0}};
+    BACNET_COV_NOTIFY_TEMPLATE cov_template;
+    clock_t start;
+    double seconds = 0.0;
+
+    data.subscriberProcessIdentifier = 1;
+    data.initiatingDeviceIdentifier = 260001;
+    data.monitoredObjectIdentifier.type = OBJECT_ANALOG_INPUT;
+    data.monitoredObjectIdentifier.instance = 1000;
+    data.timeRemaining = 3600;
+    cov_data_value_list_link(&data, &value_list[0], 2);
+    value_list[0].propertyIdentifier = PROP_PRESENT_VALUE;
+    value_list[0].propertyArrayIndex = BACNET_ARRAY_ALL;
+    value_list[0].value.tag = BACNET_APPLICATION_TAG_REAL;
+    value_list[1].propertyIdentifier = PROP_STATUS_FLAGS;
+    value_list[1].propertyArrayIndex = BACNET_ARRAY_ALL;
+    bacapp_parse_application_data(BACNET_APPLICATION_TAG_BIT_STRING, "0000",
+        &value_list[1].value);
+    cov_notify_template_init(&cov_template, true, &data);
+    printf("COV notification of a REAL Present_Value, %lu iterations\n",
+        iterations);
+    printf("%-26s %16s\n", "method", "ns/notification");
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        value_list[0].value.type.Real = (float) i;
+        checksum += ccov_notify_encode_apdu(&apdu[0], (uint8_t) i, &data);
+    }
+    seconds = cov_bench_seconds(start);
+    printf("%-26s %16.1f\n", "generic", (seconds * 1e9) / iterations);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        value_list[0].value.type.Real = (float) i;
+        checksum +=
+            cov_notify_template_encode(&apdu[0], &cov_template, (uint8_t) i,
+            data.timeRemaining, &value_list[0].value, &value_list[1].value);
+    }
+    seconds = cov_bench_seconds(start);
+    printf("%-26s %16.1f\n", "template", (seconds * 1e9) / iterations);
+    printf("checksum %lu\n", checksum + apdu[10]);
+}
+#endif
+
 void testCOVSubscribeData(
     Test * pTest,
     BACNET_SUBSCRIBE_COV_DATA * data,
@@ -1062,6 +1427,7 @@ int main(
 {
     Test *pTest;
     bool rc;
+    unsigned long iterations = 1000000;
 
     pTest = ct_create("BACnet COV", NULL);
     /* individual tests */
@@ -1071,12 +1437,19 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testCOVSubscribeProperty);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testCOVNotifyTemplate);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
     (void) ct_report(pTest);
     ct_destroy(pTest);
 
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    cov_notify_template_benchmark(iterations);
+
     return 0;
 }
 #endif /* TEST_COV */
@@ -0,0 +1,379 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bacdcode.h"
+#include "encbuf.h"
+
+/** @file encbuf.c  Encode an APDU in place, with capacity checks. */
+
+/** Initialize an empty encode buffer.
+ *
+ * @param b - encode buffer to initialize
+ * @param buffer - where the encoding goes
+ * @param size - number of octets the encoding may use
+ * @param room - number of octets of buffer that may be written;
+ *  if less than size, size is reduced to it
+ */
+void encbuf_init(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t * buffer,
+    unsigned size,
+    unsigned room)
+{
+    if (b) {
+        if (size > room) {
+            size = room;
+        }
+        b->buffer = buffer;
+        b->size = size;
+        b->room = room;
+        b->len = 0;
+        b->overflow = false;
+    }
+}
+
+/** Number of octets the encoding may still use.
+ *
+ * @param b - encode buffer
+ * @return number of octets left, zero after a failed write
+ */
+unsigned encbuf_remaining(
+    BACNET_ENCODE_BUFFER const *b)
+{
+    if (!b || b->overflow) {
+        return 0;
+    }
+
+    return b->size - b->len;
+}
+
+/** Mark the current end of the encoding, to roll back to.
+ *
+ * @param b - encode buffer
+ * @return the mark
+ */
+unsigned encbuf_mark(
+    BACNET_ENCODE_BUFFER const *b)
+{
+    return (b ? b->len : 0);
+}
+
+/** Discard everything written since the mark, and any failed write.
+ *
+ * @param b - encode buffer
+ * @param mark - value returned by encbuf_mark()
+ */
+void encbuf_rollback(
+    BACNET_ENCODE_BUFFER * b,
+    unsigned mark)
+{
+    if (b && (mark <= b->len)) {
+        b->len = mark;
+        b->overflow = false;
+    }
+}
+
+/** Get the end of the encoding to write up to max_len octets into.
+ * Nothing is added until encbuf_commit() is called.  Octets written
+ * past the size of the encoding, but within its room, are harmless.
+ *
+ * @param b - encode buffer
+ * @param max_len - the most octets that will be written
+ * @return where to write, or NULL if there is not that much room
+ */
+uint8_t *encbuf_reserve(
+    BACNET_ENCODE_BUFFER * b,
+    unsigned max_len)
+{
+    if (!b || b->overflow || ((b->room - b->len) < max_len)) {
+        return NULL;
+    }
+
+    return &b->buffer[b->len];
+}
+
+/** Add octets written at the end of the encoding to it.
+ *
+ * @param b - encode buffer
+ * @param len - number of octets written
+ * @return true if they fit in the size of the encoding
+ */
+bool encbuf_commit(
+    BACNET_ENCODE_BUFFER * b,
+    unsigned len)
+{
+    if (!b || b->overflow) {
+        return false;
+    }
+    if ((b->size - b->len) < len) {
+        b->overflow = true;
+        return false;
+    }
+    b->len += len;
+
+    return true;
+}
+
+/** Copy octets to the end of the encoding.
+ *
+ * @param b - encode buffer
+ * @param data - octets to copy
+ * @param len - number of octets
+ * @return true if they fit
+ */
+bool encbuf_append(
+    BACNET_ENCODE_BUFFER * b,
+    const uint8_t * data,
+    unsigned len)
+{
+    if (!b || b->overflow) {
+        return false;
+    }
+    if ((b->size - b->len) < len) {
+        b->overflow = true;
+        return false;
+    }
+    memcpy(&b->buffer[b->len], data, len);
+    b->len += len;
+
+    return true;
+}
+
+/** Get where to encode up to ENCBUF_SCRATCH_SIZE octets: at the end of
+ * the encoding, or in the scratch when there is not that much room
+ * left.  Finish with encbuf_encode_end().
+ *
+ * @param b - encode buffer
+ * @return where to encode
+ */
+uint8_t *encbuf_encode_begin(
+    BACNET_ENCODE_BUFFER * b)
+{
+    if (b->overflow || ((b->room - b->len) < ENCBUF_SCRATCH_SIZE)) {
+        return &b->scratch[0];
+    }
+
+    return &b->buffer[b->len];
+}
+
+/** Add what was encoded where encbuf_encode_begin() said.
+ *
+ * @param b - encode buffer
+ * @param apdu - value returned by encbuf_encode_begin()
+ * @param len - number of octets encoded
+ * @return true if they fit
+ */
+bool encbuf_encode_end(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t * apdu,
+    int len)
+{
+    if (len < 0) {
+        return false;
+    }
+    if (apdu == &b->scratch[0]) {
+        return encbuf_append(b, apdu, (unsigned) len);
+    }
+
+    return encbuf_commit(b, (unsigned) len);
+}
+
+bool encbuf_opening_tag(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t tag_number)
+{
+    uint8_t *apdu = encbuf_encode_begin(b);
+
+    return encbuf_encode_end(b, apdu, encode_opening_tag(apdu,
+            tag_number));
+}
+
+bool encbuf_closing_tag(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t tag_number)
+{
+    uint8_t *apdu = encbuf_encode_begin(b);
+
+    return encbuf_encode_end(b, apdu, encode_closing_tag(apdu,
+            tag_number));
+}
+
+bool encbuf_application_enumerated(
+    BACNET_ENCODE_BUFFER * b,
+    uint32_t value)
+{
+    uint8_t *apdu = encbuf_encode_begin(b);
+
+    return encbuf_encode_end(b, apdu,
+        encode_application_enumerated(apdu, value));
+}
+
+bool encbuf_context_enumerated(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t tag_number,
+    uint32_t value)
+{
+    uint8_t *apdu = encbuf_encode_begin(b);
+
+    return encbuf_encode_end(b, apdu,
+        encode_context_enumerated(apdu, tag_number, value));
+}
+
+bool encbuf_context_unsigned(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t tag_number,
+    uint32_t value)
+{
+    uint8_t *apdu = encbuf_encode_begin(b);
+
+    return encbuf_encode_end(b, apdu,
+        encode_context_unsigned(apdu, tag_number, value));
+}
+
+bool encbuf_context_object_id(
+    BACNET_ENCODE_BUFFER * b,
+    uint8_t tag_number,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t instance)
+{
+    uint8_t *apdu = encbuf_encode_begin(b);
+
+    return encbuf_encode_end(b, apdu,
+        encode_context_object_id(apdu, tag_number, (int) object_type,
+            instance));
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+void testEncodeBuffer(
+    Test * pTest)
+{
+    BACNET_ENCODE_BUFFER b;
+    uint8_t buffer[32];
+    uint8_t expected[32];
+    uint8_t data[4] = { 1, 2, 3, 4 };
+    uint8_t *apdu;
+    unsigned mark;
+    int len = 0;
+    unsigned i;
+
+    /* the writers encode the same as bacdcode */
+    encbuf_init(&b, buffer, sizeof(buffer), sizeof(buffer));
+    ct_test(pTest, encbuf_remaining(&b) == sizeof(buffer));
+    ct_test(pTest, encbuf_context_object_id(&b, 0, OBJECT_ANALOG_INPUT, 7));
+    len += encode_context_object_id(&expected[len], 0, OBJECT_ANALOG_INPUT, 7);
+    ct_test(pTest, encbuf_opening_tag(&b, 1));
+    len += encode_opening_tag(&expected[len], 1);
+    ct_test(pTest, encbuf_context_enumerated(&b, 2, PROP_PRESENT_VALUE));
+    len += encode_context_enumerated(&expected[len], 2, PROP_PRESENT_VALUE);
+    ct_test(pTest, encbuf_context_unsigned(&b, 3, 70000));
+    len += encode_context_unsigned(&expected[len], 3, 70000);
+    ct_test(pTest, encbuf_application_enumerated(&b, ERROR_CODE_OTHER));
+    len += encode_application_enumerated(&expected[len], ERROR_CODE_OTHER);
+    ct_test(pTest, encbuf_closing_tag(&b, 1));
+    len += encode_closing_tag(&expected[len], 1);
+    ct_test(pTest, b.len == (unsigned) len);
+    ct_test(pTest, memcmp(buffer, expected, len) == 0);
+    ct_test(pTest, encbuf_remaining(&b) == (sizeof(buffer) - len));
+
+    /* the size is exact: nothing is written past the room, and a
+       write that does not fit fails and fails everything after it */
+    memset(buffer, 0xAA, sizeof(buffer));
+    encbuf_init(&b, buffer, 8, 8);
+    ct_test(pTest, encbuf_append(&b, data, 4));
+    ct_test(pTest, encbuf_context_object_id(&b, 0, OBJECT_DEVICE, 1) ==
+        false);
+    ct_test(pTest, b.overflow);
+    ct_test(pTest, b.len == 4);
+    ct_test(pTest, encbuf_remaining(&b) == 0);
+    ct_test(pTest, encbuf_opening_tag(&b, 1) == false);
+    for (i = 8; i < sizeof(buffer); i++) {
+        ct_test(pTest, buffer[i] == 0xAA);
+    }
+    /* rollback clears the failure */
+    encbuf_rollback(&b, 4);
+    ct_test(pTest, b.overflow == false);
+    ct_test(pTest, encbuf_context_enumerated(&b, 2, 85));
+    ct_test(pTest, encbuf_opening_tag(&b, 4));
+    ct_test(pTest, b.len == 7);
+    ct_test(pTest, encbuf_opening_tag(&b, 4));
+    ct_test(pTest, b.len == 8);
+    ct_test(pTest, encbuf_closing_tag(&b, 4) == false);
+    ct_test(pTest, buffer[8] == 0xAA);
+    /* rollback to a mark */
+    encbuf_rollback(&b, 0);
+    ct_test(pTest, encbuf_append(&b, data, 2));
+    mark = encbuf_mark(&b);
+    ct_test(pTest, encbuf_append(&b, data, 4));
+    ct_test(pTest, encbuf_append(&b, data, 4) == false);
+    encbuf_rollback(&b, mark);
+    ct_test(pTest, b.len == 2);
+    ct_test(pTest, encbuf_append(&b, data, 4));
+    ct_test(pTest, memcmp(&buffer[2], data, 4) == 0);
+
+    /* a reservation may use the room past the size,
+       but only the size may be committed */
+    encbuf_init(&b, buffer, 8, 16);
+    apdu = encbuf_reserve(&b, 16);
+    ct_test(pTest, apdu == &buffer[0]);
+    ct_test(pTest, encbuf_reserve(&b, 17) == NULL);
+    memset(apdu, 0, 16);
+    ct_test(pTest, encbuf_commit(&b, 9) == false);
+    ct_test(pTest, encbuf_reserve(&b, 1) == NULL);
+    encbuf_rollback(&b, 0);
+    ct_test(pTest, encbuf_commit(&b, 8));
+    ct_test(pTest, encbuf_reserve(&b, 8) == &buffer[8]);
+    ct_test(pTest, encbuf_commit(&b, 1) == false);
+    /* the size is never more than the room */
+    encbuf_init(&b, buffer, 40, sizeof(buffer));
+    ct_test(pTest, b.size == sizeof(buffer));
+}
+
+#ifdef TEST_ENCBUF
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Encode Buffer", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testEncodeBuffer);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_ENCBUF */
+#endif /* TEST */
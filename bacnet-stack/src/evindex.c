@@ -0,0 +1,415 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "evindex.h"
+
+/** @file evindex.c  Index of the objects with active events */
+
+/* object identifiers of the active events, in ascending order, and
+   the index of each object in the arrays of its object type */
+static uint32_t Active_Event_Id[MAX_ACTIVE_EVENTS];
+static unsigned Active_Event_Index[MAX_ACTIVE_EVENTS];
+static unsigned Active_Event_Count;
+/* set when an active event did not fit */
+static bool Active_Event_Overflow;
+/* the object types that keep their active events in the index */
+static bool Maintained_Type[MAX_BACNET_OBJECT_TYPE];
+
+/* first position whose object identifier is not below id */
+static unsigned evindex_lower_bound(
+    uint32_t id)
+{
+    unsigned low = 0;
+    unsigned high = Active_Event_Count;
+    unsigned middle = 0;
+
+    while (low < high) {
+        middle = low + ((high - low) / 2);
+        if (Active_Event_Id[middle] < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/** Empty the index, and make it complete again.
+ * Objects with intrinsic reporting are expected to maintain the index
+ * for their object type, and to add their active events, again
+ * afterwards.
+ */
+void evindex_init(
+    void)
+{
+    unsigned i = 0;
+
+    Active_Event_Count = 0;
+    Active_Event_Overflow = false;
+    for (i = 0; i < MAX_BACNET_OBJECT_TYPE; i++) {
+        Maintained_Type[i] = false;
+    }
+}
+
+/** Declare that the objects of a type add themselves to the index
+ * with evindex_update() whenever their events become active, and
+ * remove themselves once they are not.
+ *
+ * @param object_type - type of the objects
+ */
+void evindex_maintain(
+    BACNET_OBJECT_TYPE object_type)
+{
+    if (object_type < MAX_BACNET_OBJECT_TYPE) {
+        Maintained_Type[object_type] = true;
+    }
+}
+
+/** Determine if the index holds the active events of an object type.
+ * The objects of the other types have to be asked for their events.
+ *
+ * @param object_type - type of the objects
+ * @return true if the objects of the type maintain the index
+ */
+bool evindex_maintained(
+    BACNET_OBJECT_TYPE object_type)
+{
+    if (object_type < MAX_BACNET_OBJECT_TYPE) {
+        return Maintained_Type[object_type];
+    }
+
+    return false;
+}
+
+/** Add an object to the index or remove it.
+ *
+ * @param object_type - type of the object
+ * @param object_instance - instance number of the object
+ * @param object_index - index of the object, as used by the
+ *  GetEventInformation and GetAlarmSummary functions of its type
+ * @param active - true if the Event_State of the object is not NORMAL,
+ *  or one of its transitions is not acknowledged
+ * @return false if the object did not fit, which leaves the index
+ *  incomplete
+ */
+bool evindex_update(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    unsigned object_index,
+    bool active)
+{
+    uint32_t id = BACNET_ID_VALUE(object_instance, object_type);
+    unsigned position = 0;
+    bool found = false;
+
+    position = evindex_lower_bound(id);
+    found = (position < Active_Event_Count) &&
+        (Active_Event_Id[position] == id);
+    if (active && !found) {
+        if (Active_Event_Count >= MAX_ACTIVE_EVENTS) {
+            Active_Event_Overflow = true;
+            return false;
+        }
+        memmove(&Active_Event_Id[position + 1], &Active_Event_Id[position],
+            (Active_Event_Count - position) * sizeof(Active_Event_Id[0]));
+        memmove(&Active_Event_Index[position + 1],
+            &Active_Event_Index[position],
+            (Active_Event_Count - position) * sizeof(Active_Event_Index[0]));
+        Active_Event_Id[position] = id;
+        Active_Event_Index[position] = object_index;
+        Active_Event_Count++;
+    } else if (!active && found) {
+        Active_Event_Count--;
+        memmove(&Active_Event_Id[position], &Active_Event_Id[position + 1],
+            (Active_Event_Count - position) * sizeof(Active_Event_Id[0]));
+        memmove(&Active_Event_Index[position],
+            &Active_Event_Index[position + 1],
+            (Active_Event_Count - position) * sizeof(Active_Event_Index[0]));
+    }
+
+    return true;
+}
+
+/** Determine if the index holds every active event.
+ *
+ * @return false once an active event did not fit
+ */
+bool evindex_complete(
+    void)
+{
+    return !Active_Event_Overflow;
+}
+
+/** Get the number of active events in the index.
+ *
+ * @return number of active events
+ */
+unsigned evindex_count(
+    void)
+{
+    return Active_Event_Count;
+}
+
+/** Get an active event from the index.
+ *
+ * @param position - 0 to evindex_count() - 1
+ * @param object_type - type of the object
+ * @param object_instance - instance number of the object
+ * @param object_index - index of the object in its object type
+ * @return true if there is an active event at the position
+ */
+bool evindex_entry(
+    unsigned position,
+    BACNET_OBJECT_TYPE * object_type,
+    uint32_t * object_instance,
+    unsigned *object_index)
+{
+    if (position >= Active_Event_Count) {
+        return false;
+    }
+    if (object_type) {
+        *object_type =
+            (BACNET_OBJECT_TYPE) BACNET_TYPE(Active_Event_Id[position]);
+    }
+    if (object_instance) {
+        *object_instance = BACNET_INSTANCE(Active_Event_Id[position]);
+    }
+    if (object_index) {
+        *object_index = Active_Event_Index[position];
+    }
+
+    return true;
+}
+
+/** Find where to continue after an object, such as the Last Received
+ * Object Identifier of GetEventInformation.  The object need not be
+ * in the index any more.
+ *
+ * @param object_type - type of the object
+ * @param object_instance - instance number of the object
+ * @return position of the first active event after the object
+ */
+unsigned evindex_position_after(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    uint32_t id = BACNET_ID_VALUE(object_instance, object_type);
+    unsigned position = 0;
+
+    position = evindex_lower_bound(id);
+    if ((position < Active_Event_Count) &&
+        (Active_Event_Id[position] == id)) {
+        position++;
+    }
+
+    return position;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ctest.h"
+
+void testEventIndex(
+    Test * pTest)
+{
+    BACNET_OBJECT_TYPE object_type = OBJECT_DEVICE;
+    uint32_t object_instance = 0;
+    unsigned object_index = 0;
+    unsigned i = 0;
+
+    evindex_init();
+    ct_test(pTest, evindex_complete());
+    ct_test(pTest, evindex_count() == 0);
+    ct_test(pTest, !evindex_maintained(OBJECT_ANALOG_INPUT));
+    evindex_maintain(OBJECT_ANALOG_INPUT);
+    evindex_maintain(MAX_BACNET_OBJECT_TYPE);
+    ct_test(pTest, evindex_maintained(OBJECT_ANALOG_INPUT));
+    ct_test(pTest, !evindex_maintained(OBJECT_ANALOG_VALUE));
+    ct_test(pTest, !evindex_maintained(MAX_BACNET_OBJECT_TYPE));
+    ct_test(pTest, !evindex_entry(0, &object_type, &object_instance,
+            &object_index));
+    ct_test(pTest, evindex_position_after(OBJECT_ANALOG_INPUT, 0) == 0);
+    /* kept in the order of the object identifiers */
+    ct_test(pTest, evindex_update(OBJECT_ANALOG_VALUE, 3, 3, true));
+    ct_test(pTest, evindex_update(OBJECT_ANALOG_INPUT, 7, 2, true));
+    ct_test(pTest, evindex_update(OBJECT_ANALOG_INPUT, 1, 0, true));
+    ct_test(pTest, evindex_update(OBJECT_ANALOG_INPUT, 7, 2, true));
+    ct_test(pTest, evindex_count() == 3);
+    ct_test(pTest, evindex_entry(0, &object_type, &object_instance,
+            &object_index));
+    ct_test(pTest, object_type == OBJECT_ANALOG_INPUT);
+    ct_test(pTest, object_instance == 1);
+    ct_test(pTest, object_index == 0);
+    ct_test(pTest, evindex_entry(1, &object_type, &object_instance,
+            &object_index));
+    ct_test(pTest, object_type == OBJECT_ANALOG_INPUT);
+    ct_test(pTest, object_instance == 7);
+    ct_test(pTest, object_index == 2);
+    ct_test(pTest, evindex_entry(2, &object_type, &object_instance,
+            &object_index));
+    ct_test(pTest, object_type == OBJECT_ANALOG_VALUE);
+    ct_test(pTest, object_instance == 3);
+    ct_test(pTest, object_index == 3);
+    /* continue after an object, in the index or not */
+    ct_test(pTest, evindex_position_after(OBJECT_ANALOG_INPUT, 1) == 1);
+    ct_test(pTest, evindex_position_after(OBJECT_ANALOG_INPUT, 4) == 1);
+    ct_test(pTest, evindex_position_after(OBJECT_ANALOG_INPUT, 7) == 2);
+    ct_test(pTest, evindex_position_after(OBJECT_ANALOG_VALUE, 3) == 3);
+    ct_test(pTest, evindex_position_after(OBJECT_BINARY_INPUT, 0) == 3);
+    /* back to normal */
+    ct_test(pTest, evindex_update(OBJECT_ANALOG_INPUT, 7, 2, false));
+    ct_test(pTest, evindex_update(OBJECT_ANALOG_INPUT, 9, 4, false));
+    ct_test(pTest, evindex_count() == 2);
+    ct_test(pTest, evindex_entry(1, &object_type, &object_instance,
+            &object_index));
+    ct_test(pTest, object_type == OBJECT_ANALOG_VALUE);
+    /* no room: the index is no longer complete */
+    for (i = 0; i < MAX_ACTIVE_EVENTS; i++) {
+        (void) evindex_update(OBJECT_BINARY_VALUE, i, i, true);
+    }
+    ct_test(pTest, evindex_count() == MAX_ACTIVE_EVENTS);
+    ct_test(pTest, !evindex_complete());
+    evindex_init();
+    ct_test(pTest, evindex_complete());
+    ct_test(pTest, evindex_count() == 0);
+    ct_test(pTest, !evindex_maintained(OBJECT_ANALOG_INPUT));
+}
+
+#ifdef TEST_EVINDEX
+static uint8_t Bench_Event_State[65536];
+
+/* the GetEventInformation loop: every object is asked */
+static unsigned evindex_bench_walk(
+    unsigned objects)
+{
+    unsigned found = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < objects; i++) {
+        if (Bench_Event_State[i] != EVENT_STATE_NORMAL) {
+            found++;
+        }
+    }
+
+    return found;
+}
+
+/* the same loop reading the active event index */
+static unsigned evindex_bench_index(
+    void)
+{
+    unsigned found = 0;
+    unsigned position = 0;
+    unsigned object_index = 0;
+
+    for (position = 0; position < evindex_count(); position++) {
+        (void) evindex_entry(position, NULL, NULL, &object_index);
+        if (Bench_Event_State[object_index] != EVENT_STATE_NORMAL) {
+            found++;
+        }
+    }
+
+    return found;
+}
+
+/* finds the active events among a number of objects, by asking every
+   object and by reading the index */
+static void evindex_benchmark(
+    unsigned objects,
+    unsigned active)
+{
+    unsigned long iterations = 2000;
+    unsigned long i = 0;
+    unsigned long found = 0;
+    unsigned j = 0;
+    clock_t start;
+    double seconds = 0.0;
+
+    if (objects > sizeof(Bench_Event_State)) {
+        objects = sizeof(Bench_Event_State);
+    }
+    evindex_init();
+    memset(Bench_Event_State, EVENT_STATE_NORMAL, sizeof(Bench_Event_State));
+    for (j = 0; (j < active) && (j < objects); j++) {
+        Bench_Event_State[(j * 7919) % objects] = EVENT_STATE_HIGH_LIMIT;
+        (void) evindex_update(OBJECT_ANALOG_INPUT, (j * 7919) % objects,
+            (j * 7919) % objects, true);
+    }
+    printf("%u objects, %u active events, %lu iterations\n", objects,
+        evindex_count(), iterations);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        found += evindex_bench_walk(objects);
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%-16s %10.1f ns/request\n", "every object",
+        (seconds * 1e9) / iterations);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        found += evindex_bench_index();
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%-16s %10.1f ns/request\n", "event index",
+        (seconds * 1e9) / iterations);
+    /* keeps the loops from being optimized away */
+    printf("found %lu\n", found);
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    unsigned long objects = 10000;
+
+    pTest = ct_create("Active Event Index", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testEventIndex);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1) {
+        objects = strtoul(argv[1], NULL, 0);
+    }
+    evindex_benchmark(objects, 5);
+
+    return 0;
+}
+#endif /* TEST_EVINDEX */
+#endif /* TEST */
@@ -0,0 +1,494 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "evsched.h"
+
+/** @file evsched.c  Timer wheel for the intrinsic reporting of objects */
+
+/* one list of timers for each second of the wheel, and one more for
+   the timers that are being called back by evsched_run() */
+#define EVSCHED_DUE_SLOT EVENT_SCHEDULE_SLOTS
+static BACNET_EVENT_TIMER *Wheel[EVENT_SCHEDULE_SLOTS + 1];
+/* seconds since evsched_init(), one for each evsched_run() */
+static uint32_t Wheel_Time;
+static unsigned Wheel_Pending;
+/* object types that have initialized a timer */
+static uint8_t Scheduled_Types[(MAX_BACNET_OBJECT_TYPE + 7) / 8];
+
+static void evsched_link(
+    BACNET_EVENT_TIMER * timer,
+    uint16_t slot)
+{
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = Wheel[slot];
+    if (timer->next) {
+        timer->next->prev = timer;
+    }
+    Wheel[slot] = timer;
+    timer->scheduled = true;
+    Wheel_Pending++;
+}
+
+static void evsched_unlink(
+    BACNET_EVENT_TIMER * timer)
+{
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        Wheel[timer->slot] = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->scheduled = false;
+    Wheel_Pending--;
+}
+
+/** Empty the wheel.
+ * Objects are expected to initialize their timers again afterwards.
+ */
+void evsched_init(
+    void)
+{
+    unsigned i;
+
+    for (i = 0; i <= EVENT_SCHEDULE_SLOTS; i++) {
+        while (Wheel[i]) {
+            evsched_unlink(Wheel[i]);
+        }
+    }
+    for (i = 0; i < sizeof(Scheduled_Types); i++) {
+        Scheduled_Types[i] = 0;
+    }
+    Wheel_Time = 0;
+    Wheel_Pending = 0;
+}
+
+/** Initialize the timer of an object, which is not scheduled.
+ * A timer that was scheduled is taken off the wheel first.
+ *
+ * @param timer - the timer, kept by the object
+ * @param object_type - type of the object
+ * @param object_instance - instance number of the object
+ */
+void evsched_timer_init(
+    BACNET_EVENT_TIMER * timer,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    if (timer) {
+        if (timer->scheduled) {
+            evsched_unlink(timer);
+        }
+        timer->next = NULL;
+        timer->prev = NULL;
+        timer->object_id = BACNET_ID_VALUE(object_instance, object_type);
+        timer->due = 0;
+        timer->slot = 0;
+        timer->scheduled = false;
+        if (object_type < MAX_BACNET_OBJECT_TYPE) {
+            Scheduled_Types[object_type / 8] |= (uint8_t) (1 << (object_type % 8));
+        }
+    }
+}
+
+/** Have the object evaluated after a number of seconds.
+ * A timer that is already scheduled keeps the earlier of the two times.
+ *
+ * @param timer - the timer of the object
+ * @param seconds - seconds from now; zero, like one, is the next
+ *  time that evsched_run() is called
+ */
+void evsched_schedule(
+    BACNET_EVENT_TIMER * timer,
+    uint32_t seconds)
+{
+    uint32_t due;
+
+    if (!timer) {
+        return;
+    }
+    if (seconds == 0) {
+        seconds = 1;
+    }
+    due = Wheel_Time + seconds;
+    if (timer->scheduled) {
+        if ((int32_t) (timer->due - due) <= 0) {
+            return;
+        }
+        evsched_unlink(timer);
+    }
+    timer->due = due;
+    evsched_link(timer, (uint16_t) (due % EVENT_SCHEDULE_SLOTS));
+}
+
+/** Stop the timer of an object, if it is scheduled.
+ *
+ * @param timer - the timer of the object
+ */
+void evsched_cancel(
+    BACNET_EVENT_TIMER * timer)
+{
+    if (timer && timer->scheduled) {
+        evsched_unlink(timer);
+    }
+}
+
+/** Advance the wheel by one second, and call back for every object
+ * that is due, in the order in which they were scheduled.  The
+ * callback may schedule or cancel any timer.
+ *
+ * @param callback - evaluates the event state of one object
+ * @return the number of objects that were called back
+ */
+unsigned evsched_run(
+    evsched_function callback)
+{
+    BACNET_EVENT_TIMER *timer;
+    BACNET_EVENT_TIMER *next;
+    unsigned count = 0;
+
+    Wheel_Time++;
+    /* the slot holds its timers newest first; moving the due ones
+       one by one to the front of the due list puts them oldest first */
+    timer = Wheel[Wheel_Time % EVENT_SCHEDULE_SLOTS];
+    while (timer) {
+        next = timer->next;
+        if ((int32_t) (timer->due - Wheel_Time) <= 0) {
+            evsched_unlink(timer);
+            evsched_link(timer, EVSCHED_DUE_SLOT);
+        }
+        timer = next;
+    }
+    while (Wheel[EVSCHED_DUE_SLOT]) {
+        timer = Wheel[EVSCHED_DUE_SLOT];
+        evsched_unlink(timer);
+        count++;
+        if (callback) {
+            callback((BACNET_OBJECT_TYPE) BACNET_TYPE(timer->object_id),
+                BACNET_INSTANCE(timer->object_id));
+        }
+    }
+
+    return count;
+}
+
+/** @return the number of timers that are scheduled */
+unsigned evsched_pending(
+    void)
+{
+    return Wheel_Pending;
+}
+
+/** Tells whether the objects of a type use the schedule, that is,
+ * whether any of them has initialized its timer.
+ *
+ * @param object_type - type of the objects
+ * @return true if the objects of the type are evaluated when due,
+ *  rather than once a second
+ */
+bool evsched_object_type(
+    BACNET_OBJECT_TYPE object_type)
+{
+    if (object_type < MAX_BACNET_OBJECT_TYPE) {
+        return (Scheduled_Types[object_type / 8] & (1 << (object_type % 8)))
+            != 0;
+    }
+
+    return false;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ctest.h"
+
+static uint32_t Called_Instance[16];
+static unsigned Called_Count;
+static BACNET_EVENT_TIMER Test_Timer[4];
+
+static void evsched_test_callback(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    if (Called_Count < 16) {
+        Called_Instance[Called_Count] = object_instance;
+    }
+    Called_Count++;
+    /* one object counts down a time delay of two more seconds */
+    if ((object_instance == 3) && (Called_Count < 3)) {
+        evsched_schedule(&Test_Timer[3], 1);
+    }
+    /* one object stops another that is due in the same second */
+    if (object_instance == 1) {
+        evsched_cancel(&Test_Timer[2]);
+    }
+}
+
+void testEventSchedule(
+    Test * pTest)
+{
+    unsigned i = 0;
+    unsigned count = 0;
+
+    evsched_init();
+    ct_test(pTest, !evsched_object_type(OBJECT_ANALOG_INPUT));
+    for (i = 0; i < 4; i++) {
+        evsched_timer_init(&Test_Timer[i], OBJECT_ANALOG_INPUT, i);
+    }
+    ct_test(pTest, evsched_object_type(OBJECT_ANALOG_INPUT));
+    ct_test(pTest, !evsched_object_type(OBJECT_ANALOG_VALUE));
+    ct_test(pTest, evsched_run(evsched_test_callback) == 0);
+    /* due at the next run, in the order of scheduling, once each */
+    evsched_schedule(&Test_Timer[1], 0);
+    evsched_schedule(&Test_Timer[0], 0);
+    evsched_schedule(&Test_Timer[1], 1);
+    ct_test(pTest, evsched_pending() == 2);
+    Called_Count = 0;
+    ct_test(pTest, evsched_run(evsched_test_callback) == 2);
+    ct_test(pTest, Called_Instance[0] == 1);
+    ct_test(pTest, Called_Instance[1] == 0);
+    ct_test(pTest, evsched_pending() == 0);
+    /* a later time does not delay a timer, an earlier one advances it */
+    evsched_schedule(&Test_Timer[0], 2);
+    evsched_schedule(&Test_Timer[0], 5);
+    evsched_schedule(&Test_Timer[1], 5);
+    evsched_schedule(&Test_Timer[1], 2);
+    Called_Count = 0;
+    ct_test(pTest, evsched_run(evsched_test_callback) == 0);
+    ct_test(pTest, evsched_run(evsched_test_callback) == 2);
+    ct_test(pTest, evsched_run(evsched_test_callback) == 0);
+    /* cancel */
+    evsched_schedule(&Test_Timer[0], 1);
+    evsched_cancel(&Test_Timer[0]);
+    evsched_cancel(&Test_Timer[0]);
+    ct_test(pTest, evsched_pending() == 0);
+    ct_test(pTest, evsched_run(evsched_test_callback) == 0);
+    /* a callback that schedules itself again, and one that cancels a
+       timer that is due in the same second */
+    evsched_schedule(&Test_Timer[3], 0);
+    evsched_schedule(&Test_Timer[1], 0);
+    evsched_schedule(&Test_Timer[2], 0);
+    Called_Count = 0;
+    ct_test(pTest, evsched_run(evsched_test_callback) == 2);
+    ct_test(pTest, Called_Instance[0] == 3);
+    ct_test(pTest, Called_Instance[1] == 1);
+    ct_test(pTest, evsched_pending() == 1);
+    ct_test(pTest, evsched_run(evsched_test_callback) == 1);
+    ct_test(pTest, evsched_run(evsched_test_callback) == 0);
+    ct_test(pTest, Called_Count == 3);
+    /* further away than the wheel goes round */
+    evsched_schedule(&Test_Timer[0], EVENT_SCHEDULE_SLOTS + 3);
+    evsched_schedule(&Test_Timer[1], EVENT_SCHEDULE_SLOTS);
+    Called_Count = 0;
+    for (i = 1; i <= (2 * EVENT_SCHEDULE_SLOTS); i++) {
+        count = evsched_run(evsched_test_callback);
+        if (i == EVENT_SCHEDULE_SLOTS) {
+            ct_test(pTest, count == 1);
+            ct_test(pTest, Called_Instance[0] == 1);
+        } else if (i == (EVENT_SCHEDULE_SLOTS + 3)) {
+            ct_test(pTest, count == 1);
+            ct_test(pTest, Called_Instance[1] == 0);
+        } else {
+            ct_test(pTest, count == 0);
+        }
+    }
+    ct_test(pTest, Called_Count == 2);
+    ct_test(pTest, evsched_pending() == 0);
+    /* an object that is initialized again while its timer is scheduled
+       leaves the other timers in the slot as they were */
+    evsched_schedule(&Test_Timer[0], 1);
+    evsched_schedule(&Test_Timer[1], 1);
+    evsched_schedule(&Test_Timer[2], 1);
+    evsched_timer_init(&Test_Timer[1], OBJECT_ANALOG_INPUT, 1);
+    ct_test(pTest, !Test_Timer[1].scheduled);
+    ct_test(pTest, evsched_pending() == 2);
+    Called_Count = 0;
+    ct_test(pTest, evsched_run(evsched_test_callback) == 2);
+    ct_test(pTest, Called_Instance[0] == 0);
+    ct_test(pTest, Called_Instance[1] == 2);
+    /* ...as does one initialized again after the wheel is emptied */
+    evsched_schedule(&Test_Timer[0], 1);
+    evsched_schedule(&Test_Timer[1], 1);
+    evsched_init();
+    ct_test(pTest, !Test_Timer[0].scheduled);
+    evsched_timer_init(&Test_Timer[0], OBJECT_ANALOG_INPUT, 0);
+    evsched_timer_init(&Test_Timer[1], OBJECT_ANALOG_INPUT, 1);
+    ct_test(pTest, evsched_pending() == 0);
+    evsched_schedule(&Test_Timer[1], 1);
+    Called_Count = 0;
+    ct_test(pTest, evsched_run(evsched_test_callback) == 1);
+    ct_test(pTest, Called_Instance[0] == 1);
+    ct_test(pTest, evsched_pending() == 0);
+}
+
+#ifdef TEST_EVSCHED
+typedef struct bench_point {
+    float Present_Value;
+    float High_Limit;
+    uint32_t Remaining_Time_Delay;
+    uint8_t Event_State;
+    BACNET_EVENT_TIMER Event_Timer;
+} BENCH_POINT;
+static BENCH_POINT *Bench_Point;
+
+/* a cut down intrinsic reporting: a high limit with a time delay */
+static void evsched_bench_evaluate(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BENCH_POINT *point = &Bench_Point[object_instance];
+
+    (void) object_type;
+    if ((point->Event_State == EVENT_STATE_NORMAL) &&
+        (point->Present_Value > point->High_Limit)) {
+        if (!point->Remaining_Time_Delay) {
+            point->Event_State = EVENT_STATE_HIGH_LIMIT;
+        } else {
+            point->Remaining_Time_Delay--;
+            evsched_schedule(&point->Event_Timer, 1);
+        }
+    } else if ((point->Event_State == EVENT_STATE_HIGH_LIMIT) &&
+        (point->Present_Value < point->High_Limit)) {
+        point->Event_State = EVENT_STATE_NORMAL;
+    } else {
+        point->Remaining_Time_Delay = 3;
+    }
+}
+
+/* one second of the server: some points change, and the points are
+   evaluated, either all of them or those that are due */
+static void evsched_bench_second(
+    unsigned points,
+    unsigned changes,
+    unsigned long second,
+    bool sweep)
+{
+    unsigned i = 0;
+    unsigned j = 0;
+
+    for (i = 0; i < changes; i++) {
+        j = (unsigned) ((second * changes + i) * 7919UL % points);
+        Bench_Point[j].Present_Value =
+            (Bench_Point[j].Present_Value > 50.0f) ? 20.0f : 80.0f;
+        if (!sweep) {
+            evsched_schedule(&Bench_Point[j].Event_Timer, 0);
+        }
+    }
+    if (sweep) {
+        for (i = 0; i < points; i++) {
+            evsched_bench_evaluate(OBJECT_ANALOG_INPUT, i);
+        }
+    } else {
+        (void) evsched_run(evsched_bench_evaluate);
+    }
+}
+
+static void evsched_benchmark(
+    unsigned points,
+    unsigned changes)
+{
+    unsigned long seconds = 200;
+    unsigned long i = 0;
+    unsigned j = 0;
+    unsigned alarms = 0;
+    clock_t start;
+    double elapsed = 0.0;
+    int pass = 0;
+
+    Bench_Point = calloc(points, sizeof(BENCH_POINT));
+    if (!Bench_Point) {
+        return;
+    }
+    printf("%u points, %u changes a second, %lu seconds\n", points, changes,
+        seconds);
+    for (pass = 0; pass < 2; pass++) {
+        evsched_init();
+        for (j = 0; j < points; j++) {
+            Bench_Point[j].Present_Value = 20.0f;
+            Bench_Point[j].High_Limit = 50.0f;
+            Bench_Point[j].Remaining_Time_Delay = 3;
+            Bench_Point[j].Event_State = EVENT_STATE_NORMAL;
+            evsched_timer_init(&Bench_Point[j].Event_Timer,
+                OBJECT_ANALOG_INPUT, j);
+        }
+        start = clock();
+        for (i = 0; i < seconds; i++) {
+            evsched_bench_second(points, changes, i, (pass == 0));
+        }
+        elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+        alarms = 0;
+        for (j = 0; j < points; j++) {
+            if (Bench_Point[j].Event_State != EVENT_STATE_NORMAL) {
+                alarms++;
+            }
+        }
+        printf("%-16s %10.1f us/second, %u in alarm\n",
+            (pass == 0) ? "every point" : "scheduled", (elapsed * 1e6) / seconds,
+            alarms);
+    }
+    free(Bench_Point);
+    Bench_Point = NULL;
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    unsigned long changes = 100;
+
+    pTest = ct_create("Intrinsic Reporting Schedule", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testEventSchedule);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1) {
+        changes = strtoul(argv[1], NULL, 0);
+    }
+    evsched_benchmark(10000, (unsigned) changes);
+    evsched_benchmark(100000, (unsigned) changes);
+
+    return 0;
+}
+#endif /* TEST_EVSCHED */
+#endif /* TEST */
@@ -165,6 +165,14 @@ static inline void printf_master(
 #define Tusage_timeout 95
 #endif
 
+/* the timeouts of the port, when the port has set them */
+#define Tframe_abort_port(p) \
+    ((p)->Frame_Abort_Timeout ? (p)->Frame_Abort_Timeout : Tframe_abort)
+#define Treply_timeout_port(p) \
+    ((p)->Reply_Timeout ? (p)->Reply_Timeout : Treply_timeout)
+#define Tusage_timeout_port(p) \
+    ((p)->Usage_Timeout ? (p)->Usage_Timeout : Tusage_timeout)
+
 /* we need to be able to increment without rolling over */
 #define INCREMENT_AND_LIMIT_UINT8(x) {if (x < 0xFF) x++;}
 
@@ -174,6 +182,171 @@ bool MSTP_Line_Active(
     return (mstp_port->EventCount > Nmin_octets);
 }
 
+/* how the last token hold ended, for the adaptive tuning */
+#define ADAPTIVE_HOLD_NONE 0
+#define ADAPTIVE_HOLD_SATURATED 1
+#define ADAPTIVE_HOLD_DRAINED 2
+
+/****************************************************************************
+* DESCRIPTION: Enables the adaptive tuning of Nmax_info_frames and of the
+*              maintenance Poll For Master cycle from the observed load,
+*              starting from the configured Nmax_info_frames.
+* RETURN:      none
+* NOTES:       A limit of zero, or one not above the configured value,
+*              disables the tuning and restores the configured value.
+*****************************************************************************/
+void MSTP_Adaptive_Enable(
+    volatile struct mstp_port_struct_t *mstp_port,
+    uint8_t max_info_frames_limit)
+{
+    unsigned i = 0;
+
+    if (mstp_port->Adaptive) {
+        mstp_port->Nmax_info_frames = mstp_port->Nmin_info_frames;
+    }
+    mstp_port->Adaptive = false;
+    mstp_port->Nmin_info_frames = mstp_port->Nmax_info_frames;
+    mstp_port->Nlimit_info_frames = mstp_port->Nmax_info_frames;
+    mstp_port->HoldOutcome = ADAPTIVE_HOLD_NONE;
+    mstp_port->SaturatedCount = 0;
+    mstp_port->PollCycle = 0;
+    for (i = 0; i < sizeof(mstp_port->PollSilent); i++) {
+        mstp_port->PollSilent[i] = 0;
+    }
+    mstp_port->RotationOctets = 0;
+    mstp_port->RotationOwnOctets = 0;
+    mstp_port->TokenRotationOctets = 0;
+    mstp_port->TokenRotationOwnOctets = 0;
+    mstp_port->AdaptiveCounters.Tokens = 0;
+    mstp_port->AdaptiveCounters.SaturatedHolds = 0;
+    mstp_port->AdaptiveCounters.DrainedHolds = 0;
+    mstp_port->AdaptiveCounters.InfoFramesRaised = 0;
+    mstp_port->AdaptiveCounters.InfoFramesLowered = 0;
+    mstp_port->AdaptiveCounters.PollsSkipped = 0;
+    if (max_info_frames_limit > mstp_port->Nmin_info_frames) {
+        mstp_port->Nlimit_info_frames = max_info_frames_limit;
+        mstp_port->Adaptive = true;
+    }
+}
+
+/* accounts for a valid frame seen on the wire */
+static void MSTP_Adaptive_Frame(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    uint8_t source = mstp_port->SourceAddress;
+
+    if (!mstp_port->Adaptive) {
+        return;
+    }
+    mstp_port->RotationOctets += 8;
+    if (mstp_port->DataLength) {
+        mstp_port->RotationOctets += mstp_port->DataLength + 2;
+    }
+    if (source > DEFAULT_MAX_MASTER) {
+        return;
+    }
+    switch (mstp_port->FrameType) {
+        case FRAME_TYPE_TOKEN:
+        case FRAME_TYPE_POLL_FOR_MASTER:
+        case FRAME_TYPE_REPLY_TO_POLL_FOR_MASTER:
+        case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
+            /* only master nodes send these frames */
+            mstp_port->PollSilent[source / 8] &= ~(1 << (source % 8));
+            break;
+        default:
+            break;
+    }
+}
+
+/* accounts for a frame sent by this node */
+static void MSTP_Adaptive_Sent(
+    volatile struct mstp_port_struct_t *mstp_port,
+    uint16_t length)
+{
+    if (mstp_port->Adaptive) {
+        mstp_port->RotationOctets += length;
+        mstp_port->RotationOwnOctets += length;
+    }
+}
+
+/* closes the last token rotation and adjusts Nmax_info_frames
+   from how the last token hold ended */
+static void MSTP_Adaptive_Token(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    uint8_t info_frames = mstp_port->Nmax_info_frames;
+
+    if (!mstp_port->Adaptive) {
+        return;
+    }
+    mstp_port->AdaptiveCounters.Tokens++;
+    mstp_port->TokenRotationOctets = mstp_port->RotationOctets;
+    mstp_port->TokenRotationOwnOctets = mstp_port->RotationOwnOctets;
+    mstp_port->RotationOctets = 0;
+    mstp_port->RotationOwnOctets = 0;
+    if (mstp_port->HoldOutcome == ADAPTIVE_HOLD_SATURATED) {
+        mstp_port->AdaptiveCounters.SaturatedHolds++;
+        INCREMENT_AND_LIMIT_UINT8(mstp_port->SaturatedCount);
+        if ((mstp_port->TokenRotationOwnOctets * 100UL) >
+            (mstp_port->TokenRotationOctets * Nadaptive_share)) {
+            /* already using more than its share of the rotation */
+            info_frames = info_frames / 2;
+        } else if (mstp_port->SaturatedCount >= Nadaptive_holds) {
+            /* the queue is deeper than the frames allowed per hold */
+            if (info_frames > (mstp_port->Nlimit_info_frames / 2)) {
+                info_frames = mstp_port->Nlimit_info_frames;
+            } else {
+                info_frames = info_frames * 2;
+            }
+            mstp_port->SaturatedCount = 0;
+        }
+    } else if (mstp_port->HoldOutcome == ADAPTIVE_HOLD_DRAINED) {
+        mstp_port->AdaptiveCounters.DrainedHolds++;
+        mstp_port->SaturatedCount = 0;
+        info_frames = info_frames / 2;
+    }
+    mstp_port->HoldOutcome = ADAPTIVE_HOLD_NONE;
+    if (info_frames < mstp_port->Nmin_info_frames) {
+        info_frames = mstp_port->Nmin_info_frames;
+    }
+    if (info_frames > mstp_port->Nmax_info_frames) {
+        mstp_port->AdaptiveCounters.InfoFramesRaised++;
+    } else if (info_frames < mstp_port->Nmax_info_frames) {
+        mstp_port->AdaptiveCounters.InfoFramesLowered++;
+    }
+    mstp_port->Nmax_info_frames = info_frames;
+}
+
+/* marks an address that did not answer a Poll For Master */
+static void MSTP_Adaptive_Poll_Silent(
+    volatile struct mstp_port_struct_t *mstp_port,
+    uint8_t station)
+{
+    if (mstp_port->Adaptive && (station <= DEFAULT_MAX_MASTER)) {
+        mstp_port->PollSilent[station / 8] |= (1 << (station % 8));
+    }
+}
+
+/* returns true if the maintenance poll of the station may be skipped */
+static bool MSTP_Adaptive_Poll_Skip(
+    volatile struct mstp_port_struct_t *mstp_port,
+    uint8_t station)
+{
+    if (!mstp_port->Adaptive || (station > DEFAULT_MAX_MASTER)) {
+        return false;
+    }
+    if ((mstp_port->PollCycle % Nadaptive_repoll) == 0) {
+        /* every address gets polled again once in a while */
+        return false;
+    }
+    if (mstp_port->PollSilent[station / 8] & (1 << (station % 8))) {
+        mstp_port->AdaptiveCounters.PollsSkipped++;
+        return true;
+    }
+
+    return false;
+}
+
 void MSTP_Fill_BACnet_Address(
     BACNET_ADDRESS * src,
     uint8_t mstp_address)
@@ -269,6 +442,7 @@ void MSTP_Create_And_Send_Frame(
         data_len);
 
     RS485_Send_Frame(mstp_port, (uint8_t *) & mstp_port->OutputBuffer[0], len);
+    MSTP_Adaptive_Sent(mstp_port, len);
     /* FIXME: be sure to reset SilenceTimer() after each octet is sent! */
 }
 
@@ -311,7 +485,8 @@ void MSTP_Receive_Frame_FSM(
             /* In the PREAMBLE state, the node waits for the second octet of the preamble. */
         case MSTP_RECEIVE_STATE_PREAMBLE:
             /* Timeout */
-            if (mstp_port->SilenceTimer((void *) mstp_port) > Tframe_abort) {
+            if (mstp_port->SilenceTimer((void *) mstp_port) >
+                Tframe_abort_port(mstp_port)) {
                 /* a correct preamble has not been received */
                 /* wait for the start of a frame. */
                 mstp_port->receive_state = MSTP_RECEIVE_STATE_IDLE;
@@ -349,14 +524,15 @@ void MSTP_Receive_Frame_FSM(
             /* In the HEADER state, the node waits for the fixed message header. */
         case MSTP_RECEIVE_STATE_HEADER:
             /* Timeout */
-            if (mstp_port->SilenceTimer((void *) mstp_port) > Tframe_abort) {
+            if (mstp_port->SilenceTimer((void *) mstp_port) >
+                Tframe_abort_port(mstp_port)) {
                 /* indicate that an error has occurred during the reception of a frame */
                 mstp_port->ReceivedInvalidFrame = true;
                 /* wait for the start of a frame. */
                 mstp_port->receive_state = MSTP_RECEIVE_STATE_IDLE;
                 printf_receive_error("MSTP: Rx Header: SilenceTimer %u > %d\n",
                     (unsigned) mstp_port->SilenceTimer((void *) mstp_port),
-                    Tframe_abort);
+                    (int) Tframe_abort_port(mstp_port));
             }
             /* Error */
             else if (mstp_port->ReceiveError == true) {
@@ -444,6 +620,7 @@ void MSTP_Receive_Frame_FSM(
                                 /* NotForUs */
                                 mstp_port->ReceivedValidFrameNotForUs = true;
                             }
+                            MSTP_Adaptive_Frame(mstp_port);
                             /* wait for the start of the next frame. */
                             mstp_port->receive_state = MSTP_RECEIVE_STATE_IDLE;
                         } else {
@@ -495,13 +672,14 @@ void MSTP_Receive_Frame_FSM(
         case MSTP_RECEIVE_STATE_DATA:
         case MSTP_RECEIVE_STATE_SKIP_DATA:
             /* Timeout */
-            if (mstp_port->SilenceTimer((void *) mstp_port) > Tframe_abort) {
+            if (mstp_port->SilenceTimer((void *) mstp_port) >
+                Tframe_abort_port(mstp_port)) {
                 /* indicate that an error has occurred during the reception of a frame */
                 mstp_port->ReceivedInvalidFrame = true;
                 printf_receive_error
                     ("MSTP: Rx Data: SilenceTimer %ums > %dms\n",
                     (unsigned) mstp_port->SilenceTimer((void *) mstp_port),
-                    Tframe_abort);
+                    (int) Tframe_abort_port(mstp_port));
                 /* wait for the start of the next frame. */
                 mstp_port->receive_state = MSTP_RECEIVE_STATE_IDLE;
             }
@@ -526,7 +704,7 @@ void MSTP_Receive_Frame_FSM(
                             mstp_port->DataRegister;
                     }
                     mstp_port->Index++;
-                    mstp_port->receive_state = MSTP_RECEIVE_STATE_DATA;
+                    /* remain in DATA or SKIP_DATA */
                 } else if (mstp_port->Index == mstp_port->DataLength) {
                     /* CRC1 */
                     mstp_port->DataCRC =
@@ -534,7 +712,6 @@ void MSTP_Receive_Frame_FSM(
                         mstp_port->DataCRC);
                     mstp_port->DataCRCActualMSB = mstp_port->DataRegister;
                     mstp_port->Index++;
-                    mstp_port->receive_state = MSTP_RECEIVE_STATE_DATA;
                 } else if (mstp_port->Index == (mstp_port->DataLength + 1)) {
                     /* CRC2 */
                     mstp_port->DataCRC =
@@ -554,6 +731,7 @@ void MSTP_Receive_Frame_FSM(
                             /* NotForUs */
                             mstp_port->ReceivedValidFrameNotForUs = true;
                         }
+                        MSTP_Adaptive_Frame(mstp_port);
                     } else {
                         mstp_port->ReceivedInvalidFrame = true;
                         printf_receive_error("MSTP: Rx Data: BadCRC [%02X]\n",
@@ -651,6 +829,7 @@ bool MSTP_Master_Node_FSM(
                                 break;
                             }
                             mstp_port->ReceivedValidFrame = false;
+                            MSTP_Adaptive_Token(mstp_port);
                             mstp_port->FrameCount = 0;
                             mstp_port->SoleMaster = false;
                             mstp_port->master_state =
@@ -707,6 +886,7 @@ bool MSTP_Master_Node_FSM(
             length = (unsigned) MSTP_Get_Send(mstp_port, 0);
             if (length < 1) {
                 /* NothingToSend */
+                mstp_port->HoldOutcome = ADAPTIVE_HOLD_DRAINED;
                 mstp_port->FrameCount = mstp_port->Nmax_info_frames;
                 mstp_port->master_state = MSTP_MASTER_STATE_DONE_WITH_TOKEN;
                 transition_now = true;
@@ -716,7 +896,12 @@ bool MSTP_Master_Node_FSM(
                 RS485_Send_Frame(mstp_port,
                     (uint8_t *) & mstp_port->OutputBuffer[0],
                     (uint16_t) length);
+                MSTP_Adaptive_Sent(mstp_port, (uint16_t) length);
                 mstp_port->FrameCount++;
+                if (mstp_port->FrameCount >= mstp_port->Nmax_info_frames) {
+                    /* used every frame it was allowed in this hold */
+                    mstp_port->HoldOutcome = ADAPTIVE_HOLD_SATURATED;
+                }
                 switch (frame_type) {
                     case FRAME_TYPE_BACNET_DATA_EXPECTING_REPLY:
                         if (destination == MSTP_BROADCAST_ADDRESS) {
@@ -747,7 +932,8 @@ bool MSTP_Master_Node_FSM(
         case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
             /* In the WAIT_FOR_REPLY state, the node waits for  */
             /* a reply from another node. */
-            if (mstp_port->SilenceTimer((void *) mstp_port) >= Treply_timeout) {
+            if (mstp_port->SilenceTimer((void *) mstp_port) >=
+                Treply_timeout_port(mstp_port)) {
                 /* ReplyTimeout */
                 /* assume that the request has failed */
                 mstp_port->FrameCount = mstp_port->Nmax_info_frames;
@@ -871,6 +1057,7 @@ bool MSTP_Master_Node_FSM(
                 } else {
                     /* ResetMaintenancePFM */
                     mstp_port->Poll_Station = mstp_port->This_Station;
+                    mstp_port->PollCycle++;
                     /* transmit a Token frame to NS */
                     MSTP_Create_And_Send_Frame(mstp_port, FRAME_TYPE_TOKEN,
                         mstp_port->Next_Station, mstp_port->This_Station, NULL,
@@ -881,6 +1068,12 @@ bool MSTP_Master_Node_FSM(
                     mstp_port->EventCount = 0;
                     mstp_port->master_state = MSTP_MASTER_STATE_PASS_TOKEN;
                 }
+            } else if (MSTP_Adaptive_Poll_Skip(mstp_port, next_poll_station)) {
+                /* SkipSilentPFM - adaptive tuning */
+                /* PS did not answer its last poll: move on to the next */
+                /* address without sending the Poll For Master. */
+                mstp_port->Poll_Station = next_poll_station;
+                transition_now = true;
             } else {
                 /* SendMaintenancePFM */
                 mstp_port->Poll_Station = next_poll_station;
@@ -894,7 +1087,8 @@ bool MSTP_Master_Node_FSM(
         case MSTP_MASTER_STATE_PASS_TOKEN:
             /* The PASS_TOKEN state listens for a successor to begin using */
             /* the token that this node has just attempted to pass. */
-            if (mstp_port->SilenceTimer((void *) mstp_port) <= Tusage_timeout) {
+            if (mstp_port->SilenceTimer((void *) mstp_port) <=
+                Tusage_timeout_port(mstp_port)) {
                 if (mstp_port->EventCount > Nmin_octets) {
                     /* SawTokenUser */
                     /* Assume that a frame has been sent by the new token user.  */
@@ -1015,8 +1209,12 @@ bool MSTP_Master_Node_FSM(
                 }
                 mstp_port->ReceivedValidFrame = false;
             } else if ((mstp_port->SilenceTimer((void *) mstp_port) >
-                    Tusage_timeout) ||
+                    Tusage_timeout_port(mstp_port)) ||
                 (mstp_port->ReceivedInvalidFrame == true)) {
+                if (mstp_port->ReceivedInvalidFrame == false) {
+                    MSTP_Adaptive_Poll_Silent(mstp_port,
+                        mstp_port->Poll_Station);
+                }
                 if (mstp_port->SoleMaster == true) {
                     /* SoleMaster */
                     /* There was no valid reply to the periodic poll  */
@@ -1081,6 +1279,7 @@ bool MSTP_Master_Node_FSM(
                 RS485_Send_Frame(mstp_port,
                     (uint8_t *) & mstp_port->OutputBuffer[0],
                     (uint16_t) length);
+                MSTP_Adaptive_Sent(mstp_port, (uint16_t) length);
                 mstp_port->master_state = MSTP_MASTER_STATE_IDLE;
                 /* clear our flag we were holding for comparison */
                 mstp_port->ReceivedValidFrame = false;
@@ -1126,7 +1325,10 @@ void MSTP_Slave_Node_FSM(
 {
     unsigned length = 0;
 
-    mstp_port->master_state = MSTP_MASTER_STATE_IDLE;
+    /* a slave node is IDLE unless it is waiting to answer a DER */
+    if (mstp_port->master_state != MSTP_MASTER_STATE_ANSWER_DATA_REQUEST) {
+        mstp_port->master_state = MSTP_MASTER_STATE_IDLE;
+    }
     if (mstp_port->ReceivedInvalidFrame == true) {
         /* ReceivedInvalidFrame */
         /* invalid frame was received */
@@ -1138,6 +1340,14 @@ void MSTP_Slave_Node_FSM(
                     /* The ANSWER_DATA_REQUEST state is entered when a  */
                     /* BACnet Data Expecting Reply, a Test_Request, or  */
                     /* a proprietary frame that expects a reply is received. */
+                    if (mstp_port->master_state !=
+                        MSTP_MASTER_STATE_ANSWER_DATA_REQUEST) {
+                        /* indicate successful reception to the higher
+                           layers only once while waiting for the reply */
+                        (void) MSTP_Put_Receive(mstp_port);
+                        mstp_port->master_state =
+                            MSTP_MASTER_STATE_ANSWER_DATA_REQUEST;
+                    }
                     length = (unsigned) MSTP_Get_Reply(mstp_port, 0);
                     if (length > 0) {
                         /* Reply */
@@ -1152,6 +1362,7 @@ void MSTP_Slave_Node_FSM(
                             (uint16_t) length);
                         /* clear our flag we were holding for comparison */
                         mstp_port->ReceivedValidFrame = false;
+                        mstp_port->master_state = MSTP_MASTER_STATE_IDLE;
                     } else if (mstp_port->SilenceTimer((void *) mstp_port) >
                         Treply_delay) {
                         /* If no reply will be available from the higher layers
@@ -1160,11 +1371,19 @@ void MSTP_Slave_Node_FSM(
                            this is a local matter), then no reply is possible. */
                         /* clear our flag we were holding for comparison */
                         mstp_port->ReceivedValidFrame = false;
+                        mstp_port->master_state = MSTP_MASTER_STATE_IDLE;
                     }
                 } else {
+                    /* broadcast DER is treated like a DNER */
+                    (void) MSTP_Put_Receive(mstp_port);
                     mstp_port->ReceivedValidFrame = false;
                 }
                 break;
+            case FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY:
+                /* indicate successful reception to the higher layers */
+                (void) MSTP_Put_Receive(mstp_port);
+                mstp_port->ReceivedValidFrame = false;
+                break;
             case FRAME_TYPE_TEST_REQUEST:
                 mstp_port->ReceivedValidFrame = false;
                 MSTP_Create_And_Send_Frame(mstp_port, FRAME_TYPE_TEST_RESPONSE,
@@ -1174,7 +1393,6 @@ void MSTP_Slave_Node_FSM(
             case FRAME_TYPE_TOKEN:
             case FRAME_TYPE_POLL_FOR_MASTER:
             case FRAME_TYPE_TEST_RESPONSE:
-            case FRAME_TYPE_BACNET_DATA_NOT_EXPECTING_REPLY:
             default:
                 mstp_port->ReceivedValidFrame = false;
                 break;
@@ -285,6 +285,68 @@ void npdu_encode_npdu_data(
     }
 }
 
+/** Encode the NPDU header of an APDU once, for a local destination, so
+ * that each reply from the same source only needs its destination.
+ *
+ * @param npdu_template [out] the encoded header
+ * @param src [in] the source of the replies, usually my address
+ * @param npdu_data [in] the data of an APDU; not a network layer message
+ */
+void npdu_template_init(
+    BACNET_NPDU_TEMPLATE * npdu_template,
+    BACNET_ADDRESS * src,
+    BACNET_NPDU_DATA * npdu_data)
+{
+    if (npdu_template && npdu_data) {
+        npdu_template->npdu_len = (uint8_t)
+            npdu_encode_pdu(&npdu_template->npdu[0], NULL, src, npdu_data);
+        npdu_template->hop_count = npdu_data->hop_count;
+    }
+}
+
+/** Encode the NPDU header of an APDU from a template.
+ * The result is the same as npdu_encode_pdu() with the data and source
+ * that were given to npdu_template_init().
+ *
+ * @param npdu [out] buffer for the header, at least MAX_NPDU octets
+ * @param npdu_template [in] the header encoded by npdu_template_init()
+ * @param dest [in] the destination, or NULL for a local broadcast
+ * @return number of octets encoded
+ */
+int npdu_template_encode(
+    uint8_t * npdu,
+    BACNET_NPDU_TEMPLATE * npdu_template,
+    BACNET_ADDRESS * dest)
+{
+    int len = 0;
+    uint8_t i = 0;
+
+    if (!npdu || !npdu_template) {
+        return 0;
+    }
+    if (!dest || !dest->net) {
+        for (i = 0; i < npdu_template->npdu_len; i++) {
+            npdu[i] = npdu_template->npdu[i];
+        }
+        return npdu_template->npdu_len;
+    }
+    /* DNET, DLEN and DADR go between the control octet and SNET */
+    npdu[0] = npdu_template->npdu[0];
+    npdu[1] = npdu_template->npdu[1] | BIT5;
+    len = 2;
+    len += encode_unsigned16(&npdu[len], dest->net);
+    npdu[len++] = dest->len;
+    for (i = 0; i < dest->len; i++) {
+        npdu[len++] = dest->adr[i];
+    }
+    for (i = 2; i < npdu_template->npdu_len; i++) {
+        npdu[len++] = npdu_template->npdu[i];
+    }
+    npdu[len++] = npdu_template->hop_count;
+
+    return len;
+}
+
 /** Decode the NPDU portion of a received message, particularly the NCPI byte.
  *  The Network Layer Protocol Control Information byte is described
  *  in section 6.2.2 of the BACnet standard.
@@ -573,6 +635,44 @@ void testNPDU1(
     ct_test(pTest, npdu_src.mac_len == dest.mac_len);
 }
 
+void testNPDUTemplate(
+    Test * pTest)
+{
+    uint8_t pdu[MAX_NPDU] = { 0 };
+    uint8_t test_pdu[MAX_NPDU] = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    BACNET_NPDU_TEMPLATE npdu_template;
+    int len = 0, test_len = 0;
+    unsigned i = 0, j = 0;
+
+    for (i = 0; i < 4; i++) {
+        /* local and routed sources */
+        src.net = (i & 1) ? 7 : 0;
+        src.len = (i & 1) ? 1 : 0;
+        src.adr[0] = 0x42;
+        npdu_encode_npdu_data(&npdu_data, (i & 2), MESSAGE_PRIORITY_URGENT);
+        npdu_template_init(&npdu_template, &src, &npdu_data);
+        for (j = 0; j <= MAX_MAC_LEN; j++) {
+            /* local, remote broadcast and remote station destinations */
+            dest.net = j ? 1234 : 0;
+            dest.len = (uint8_t) (j ? (j - 1) : 0);
+            memset(dest.adr, (int) j, sizeof(dest.adr));
+            len = npdu_encode_pdu(&pdu[0], &dest, &src, &npdu_data);
+            memset(test_pdu, 0, sizeof(test_pdu));
+            test_len = npdu_template_encode(&test_pdu[0], &npdu_template,
+                &dest);
+            ct_test(pTest, len == test_len);
+            ct_test(pTest, memcmp(pdu, test_pdu, (size_t) len) == 0);
+        }
+        len = npdu_encode_pdu(&pdu[0], NULL, &src, &npdu_data);
+        test_len = npdu_template_encode(&test_pdu[0], &npdu_template, NULL);
+        ct_test(pTest, len == test_len);
+        ct_test(pTest, memcmp(pdu, test_pdu, (size_t) len) == 0);
+    }
+}
+
 #ifdef TEST_NPDU
 /* dummy stub for testing */
 void tsm_free_invoke_id(
@@ -603,6 +703,8 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testNPDU2);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testNPDUTemplate);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
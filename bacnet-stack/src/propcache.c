@@ -0,0 +1,459 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "propcache.h"
+
+/** @file propcache.c  Cache of encoded property values */
+
+#if MAX_PROPERTY_CACHE
+/* one encoded value.  The cache is direct mapped: a value replaces
+   whatever was cached in its slot before. */
+typedef struct property_cache_entry {
+    uint32_t object_instance;
+    uint32_t array_index;
+    BACNET_PROPERTY_ID object_property;
+    uint16_t object_type;
+    /* zero when the slot is empty */
+    uint8_t len;
+    /* version of the object when the value was encoded */
+    uint32_t version;
+    uint8_t value[MAX_PROPERTY_CACHE_VALUE];
+} PROPERTY_CACHE_ENTRY;
+
+static PROPERTY_CACHE_ENTRY Property_Cache[MAX_PROPERTY_CACHE];
+/* object versions, hashed by object; objects that share a version
+   are invalidated together, which costs a miss and nothing else */
+static uint32_t Object_Version[MAX_PROPERTY_CACHE];
+
+static uint32_t propcache_hash(
+    uint32_t a,
+    uint32_t b)
+{
+    uint32_t h = (a ^ (b * 0x9E3779B1UL)) * 0x85EBCA6BUL;
+
+    return h ^ (h >> 16);
+}
+
+static uint32_t *propcache_version(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    uint32_t h = propcache_hash(object_instance, object_type);
+
+    return &Object_Version[h % MAX_PROPERTY_CACHE];
+}
+
+static PROPERTY_CACHE_ENTRY *propcache_entry(
+    BACNET_READ_PROPERTY_DATA const *rpdata)
+{
+    uint32_t h = propcache_hash(rpdata->object_instance,
+        rpdata->object_type);
+
+    h = propcache_hash(h, rpdata->object_property ^
+        (rpdata->array_index << 10));
+
+    return &Property_Cache[h % MAX_PROPERTY_CACHE];
+}
+#endif
+
+/** Determine if the value of a property is cached.
+ *
+ * @param object_property - property identifier
+ * @return true for properties that seldom change
+ */
+bool propcache_property_cacheable(
+    BACNET_PROPERTY_ID object_property)
+{
+#if MAX_PROPERTY_CACHE
+    switch (object_property) {
+        case PROP_OBJECT_NAME:
+        case PROP_DESCRIPTION:
+        case PROP_UNITS:
+        case PROP_PROPERTY_LIST:
+            return true;
+        default:
+            break;
+    }
+#else
+    (void) object_property;
+#endif
+
+    return false;
+}
+
+/** Copy the cached value of a property into rpdata->application_data.
+ *
+ * @param rpdata - the object, property and array index to read, and
+ *  where the value goes
+ * @return length of the value, or BACNET_STATUS_ERROR if it is not
+ *  cached, or does not fit in rpdata->application_data_len
+ */
+int propcache_read(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+#if MAX_PROPERTY_CACHE
+    PROPERTY_CACHE_ENTRY *entry;
+
+    if (rpdata && propcache_property_cacheable(rpdata->object_property)) {
+        entry = propcache_entry(rpdata);
+        if (entry->len && (entry->object_instance == rpdata->object_instance)
+            && (entry->object_type == rpdata->object_type) &&
+            (entry->object_property == rpdata->object_property) &&
+            (entry->array_index == rpdata->array_index) &&
+            (entry->version == *propcache_version(rpdata->object_type,
+                    rpdata->object_instance)) &&
+            ((int) entry->len <= rpdata->application_data_len)) {
+            memcpy(rpdata->application_data, entry->value, entry->len);
+            return entry->len;
+        }
+    }
+#else
+    (void) rpdata;
+#endif
+
+    return BACNET_STATUS_ERROR;
+}
+
+/** Cache the value of a property that was just encoded.  Values of
+ * properties that are not cacheable, errors, and values longer than
+ * MAX_PROPERTY_CACHE_VALUE are ignored.
+ *
+ * @param rpdata - the object, property and array index that were read,
+ *  with the value in rpdata->application_data
+ * @param apdu_len - length of the value, or a negative status
+ */
+void propcache_store(
+    BACNET_READ_PROPERTY_DATA const *rpdata,
+    int apdu_len)
+{
+#if MAX_PROPERTY_CACHE
+    PROPERTY_CACHE_ENTRY *entry;
+
+    if (rpdata && (apdu_len > 0) && (apdu_len <= MAX_PROPERTY_CACHE_VALUE)
+        && propcache_property_cacheable(rpdata->object_property)) {
+        entry = propcache_entry(rpdata);
+        entry->object_instance = rpdata->object_instance;
+        entry->array_index = rpdata->array_index;
+        entry->object_property = rpdata->object_property;
+        entry->object_type = (uint16_t) rpdata->object_type;
+        entry->version =
+            *propcache_version(rpdata->object_type, rpdata->object_instance);
+        entry->len = (uint8_t) apdu_len;
+        memcpy(entry->value, rpdata->application_data, apdu_len);
+    }
+#else
+    (void) rpdata;
+    (void) apdu_len;
+#endif
+}
+
+/** Forget the cached values of an object, after one of them changed.
+ *
+ * @param object_type - type of the object that changed
+ * @param object_instance - instance of the object that changed
+ */
+void propcache_invalidate(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+#if MAX_PROPERTY_CACHE
+    *propcache_version(object_type, object_instance) += 1;
+#else
+    (void) object_type;
+    (void) object_instance;
+#endif
+}
+
+/** Forget every cached value, such as when objects are renumbered. */
+void propcache_invalidate_all(
+    void)
+{
+#if MAX_PROPERTY_CACHE
+    unsigned i;
+
+    for (i = 0; i < MAX_PROPERTY_CACHE; i++) {
+        Property_Cache[i].len = 0;
+    }
+#endif
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bacdcode.h"
+#include "bacstr.h"
+#include "ctest.h"
+
+/* Property_List of an Analog Input with intrinsic reporting */
+static const BACNET_PROPERTY_ID Test_Property_List[] = {
+    PROP_PRESENT_VALUE, PROP_STATUS_FLAGS, PROP_EVENT_STATE,
+    PROP_OUT_OF_SERVICE, PROP_UNITS, PROP_DESCRIPTION, PROP_RELIABILITY,
+    PROP_COV_INCREMENT, PROP_TIME_DELAY, PROP_NOTIFICATION_CLASS,
+    PROP_HIGH_LIMIT, PROP_LOW_LIMIT, PROP_DEADBAND, PROP_LIMIT_ENABLE,
+    PROP_EVENT_ENABLE, PROP_ACKED_TRANSITIONS, PROP_NOTIFY_TYPE,
+    PROP_EVENT_TIME_STAMPS, PROP_PROFILE_NAME
+};
+
+#define TEST_PROPERTY_LIST_LEN \
+    (sizeof(Test_Property_List) / sizeof(Test_Property_List[0]))
+
+/* encodes the properties the way an object would */
+static int propcache_test_encode(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    BACNET_CHARACTER_STRING char_string;
+    char text[32];
+    unsigned i = 0;
+    int len = 0;
+
+    switch (rpdata->object_property) {
+        case PROP_OBJECT_NAME:
+            sprintf(text, "ANALOG INPUT %lu",
+                (unsigned long) rpdata->object_instance);
+            characterstring_init_ansi(&char_string, text);
+            return encode_application_character_string(
+                rpdata->application_data, &char_string);
+        case PROP_UNITS:
+            return encode_application_enumerated(rpdata->application_data,
+                UNITS_DEGREES_CELSIUS);
+        case PROP_PROPERTY_LIST:
+            if (rpdata->array_index == 0) {
+                return encode_application_unsigned(rpdata->application_data,
+                    TEST_PROPERTY_LIST_LEN);
+            }
+            if (rpdata->array_index != BACNET_ARRAY_ALL) {
+                return encode_application_enumerated(rpdata->application_data,
+                    Test_Property_List[rpdata->array_index - 1]);
+            }
+            for (i = 0; i < TEST_PROPERTY_LIST_LEN; i++) {
+                len += encode_application_enumerated(
+                    &rpdata->application_data[len], Test_Property_List[i]);
+            }
+            return len;
+        case PROP_PRESENT_VALUE:
+            return encode_application_real(rpdata->application_data, 21.5);
+        default:
+            break;
+    }
+
+    return BACNET_STATUS_ERROR;
+}
+
+/* reads via the cache, and fills it on a miss */
+static int propcache_test_read(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    int len = propcache_read(rpdata);
+
+    if (len < 0) {
+        len = propcache_test_encode(rpdata);
+        propcache_store(rpdata, len);
+    }
+
+    return len;
+}
+
+static void propcache_test_rpdata(
+    BACNET_READ_PROPERTY_DATA * rpdata,
+    uint8_t * apdu,
+    int apdu_len,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    rpdata->object_type = OBJECT_ANALOG_INPUT;
+    rpdata->object_instance = object_instance;
+    rpdata->object_property = object_property;
+    rpdata->array_index = array_index;
+    rpdata->application_data = apdu;
+    rpdata->application_data_len = apdu_len;
+}
+
+void testPropertyCache(
+    Test * pTest)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t apdu[MAX_APDU];
+    uint8_t expected[MAX_APDU];
+    int len = 0;
+    int test_len = 0;
+
+    propcache_invalidate_all();
+    ct_test(pTest, propcache_property_cacheable(PROP_OBJECT_NAME));
+    ct_test(pTest, propcache_property_cacheable(PROP_PRESENT_VALUE) == false);
+    /* a miss, then a hit with the same value */
+    propcache_test_rpdata(&rpdata, expected, sizeof(expected), 1,
+        PROP_OBJECT_NAME, BACNET_ARRAY_ALL);
+    len = propcache_test_encode(&rpdata);
+    ct_test(pTest, len > 0);
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 1, PROP_OBJECT_NAME,
+        BACNET_ARRAY_ALL);
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    propcache_store(&rpdata, propcache_test_encode(&rpdata));
+    memset(apdu, 0, sizeof(apdu));
+    ct_test(pTest, propcache_read(&rpdata) == len);
+    ct_test(pTest, memcmp(apdu, expected, len) == 0);
+    /* not when it does not fit */
+    rpdata.application_data_len = len - 1;
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    /* other objects and array indexes are other values */
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 2, PROP_OBJECT_NAME,
+        BACNET_ARRAY_ALL);
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 1,
+        PROP_PROPERTY_LIST, 0);
+    ct_test(pTest, propcache_test_read(&rpdata) == 2);
+    ct_test(pTest, propcache_read(&rpdata) == 2);
+    ct_test(pTest, apdu[1] == 19);
+    rpdata.array_index = 1;
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    ct_test(pTest, propcache_test_read(&rpdata) == 2);
+    ct_test(pTest, apdu[1] == PROP_PRESENT_VALUE);
+    /* errors, long values and other properties are not cached */
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 1,
+        PROP_DESCRIPTION, BACNET_ARRAY_ALL);
+    ct_test(pTest, propcache_test_read(&rpdata) == BACNET_STATUS_ERROR);
+    propcache_store(&rpdata, MAX_PROPERTY_CACHE_VALUE + 1);
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 1,
+        PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+    propcache_store(&rpdata, propcache_test_encode(&rpdata));
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    /* a new version of the object misses */
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 1, PROP_OBJECT_NAME,
+        BACNET_ARRAY_ALL);
+    ct_test(pTest, propcache_read(&rpdata) == len);
+    propcache_invalidate(OBJECT_ANALOG_INPUT, 1);
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    ct_test(pTest, propcache_test_read(&rpdata) == len);
+    ct_test(pTest, propcache_read(&rpdata) == len);
+    propcache_invalidate_all();
+    ct_test(pTest, propcache_read(&rpdata) == BACNET_STATUS_ERROR);
+    /* the whole Property_List is cached like any other value */
+    propcache_test_rpdata(&rpdata, expected, sizeof(expected), 1,
+        PROP_PROPERTY_LIST, BACNET_ARRAY_ALL);
+    len = propcache_test_encode(&rpdata);
+    ct_test(pTest, len > 0);
+    ct_test(pTest, len <= MAX_PROPERTY_CACHE_VALUE);
+    propcache_test_rpdata(&rpdata, apdu, sizeof(apdu), 1,
+        PROP_PROPERTY_LIST, BACNET_ARRAY_ALL);
+    test_len = propcache_test_read(&rpdata);
+    memset(apdu, 0, sizeof(apdu));
+    ct_test(pTest, propcache_read(&rpdata) == test_len);
+    ct_test(pTest, test_len == len);
+    ct_test(pTest, memcmp(apdu, expected, len) == 0);
+}
+
+#ifdef TEST_PROPCACHE
+static const BACNET_PROPERTY_ID Bench_Properties[] = {
+    PROP_OBJECT_NAME, PROP_UNITS, PROP_PROPERTY_LIST, PROP_PRESENT_VALUE
+};
+
+static double propcache_bench_seconds(
+    clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* reads of the same properties of a set of objects, as a poll does */
+static void propcache_benchmark(
+    unsigned long iterations,
+    unsigned objects)
+{
+    static uint8_t apdu[MAX_APDU];
+    BACNET_READ_PROPERTY_DATA rpdata;
+    unsigned long i = 0;
+    unsigned long octets = 0;
+    unsigned long reads = 0;
+    unsigned k = 0;
+    unsigned p = 0;
+    clock_t start;
+    double seconds = 0.0;
+    int len = 0;
+
+    printf("%u objects, %u properties each, %lu iterations\n", objects,
+        (unsigned) (sizeof(Bench_Properties) / sizeof(Bench_Properties[0])),
+        iterations);
+    printf("%-12s %8s %12s\n", "method", "octets", "ns/read");
+    for (k = 0; k < 2; k++) {
+        propcache_invalidate_all();
+        octets = 0;
+        reads = 0;
+        start = clock();
+        for (i = 0; i < iterations; i++) {
+            for (p = 0;
+                p < sizeof(Bench_Properties) / sizeof(Bench_Properties[0]);
+                p++) {
+                propcache_test_rpdata(&rpdata, apdu, sizeof(apdu),
+                    i % objects, Bench_Properties[p], BACNET_ARRAY_ALL);
+                if (k) {
+                    len = propcache_test_read(&rpdata);
+                } else {
+                    len = propcache_test_encode(&rpdata);
+                }
+                octets += len;
+                reads++;
+            }
+        }
+        seconds = propcache_bench_seconds(start);
+        printf("%-12s %8lu %12.1f\n", k ? "cached" : "encoded",
+            octets / iterations, (seconds * 1e9) / reads);
+    }
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    unsigned long iterations = 200000;
+
+    pTest = ct_create("Property Cache", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testPropertyCache);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    propcache_benchmark(iterations, MAX_PROPERTY_CACHE / 8);
+
+    return 0;
+}
+#endif /* TEST_PROPCACHE */
+#endif /* TEST */
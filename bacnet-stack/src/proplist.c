@@ -1148,6 +1148,76 @@ unsigned property_list_count(
     return property_count;
 }
 
+/* Object_Identifier, Object_Name and Object_Type are required for
+   every object but are not in the Property_List */
+static bool property_list_excluded(
+    int object_property)
+{
+    return ((object_property == PROP_OBJECT_TYPE) ||
+        (object_property == PROP_OBJECT_IDENTIFIER) ||
+        (object_property == PROP_OBJECT_NAME));
+}
+
+/* Encodes the properties of one list after apdu_len octets, and
+   returns the new length, or BACNET_STATUS_ABORT if they don't fit */
+static int property_list_encode_elements(
+    uint8_t * apdu,
+    int apdu_len,
+    int max_apdu_len,
+    const int *pList,
+    bool required)
+{
+    int len = 0;
+
+    while (pList && (*pList != -1) && (apdu_len >= 0)) {
+        if (!(required && property_list_excluded(*pList))) {
+            len = encode_application_enumerated(&apdu[apdu_len], *pList);
+            /* add it if we have room */
+            if ((apdu_len + len) < max_apdu_len) {
+                apdu_len += len;
+            } else {
+                apdu_len = BACNET_STATUS_ABORT;
+            }
+        }
+        pList++;
+    }
+
+    return apdu_len;
+}
+
+/* Finds the property at a Property_List array index (1 to N).  Only
+   the required list is searched; the others are indexed directly. */
+static int property_list_element(
+    const int *pListRequired,
+    const int *pListOptional,
+    unsigned optional_count,
+    const int *pListProprietary,
+    unsigned proprietary_count,
+    uint32_t array_index)
+{
+    uint32_t count = 0;
+
+    while (pListRequired && (*pListRequired != -1)) {
+        if (!property_list_excluded(*pListRequired)) {
+            count++;
+            if (count == array_index) {
+                return *pListRequired;
+            }
+        }
+        pListRequired++;
+    }
+    array_index -= count;
+    if (array_index <= optional_count) {
+        return pListOptional[array_index - 1];
+    }
+    array_index -= optional_count;
+    if (array_index <= proprietary_count) {
+        return pListProprietary[array_index - 1];
+    }
+
+    return -1;
+}
+
 /**
  * ReadProperty handler for this property.  For the given ReadProperty
  * data, the application_data is loaded or the error flags are set.
@@ -1171,8 +1241,7 @@ int property_list_encode(
     unsigned required_count = 0;
     unsigned optional_count = 0;
     unsigned proprietary_count = 0;
-    int len = 0;
-    unsigned i = 0; /* loop index */
+    int object_property = -1;
 
     required_count = property_list_count(pListRequired);
     optional_count = property_list_count(pListOptional);
@@ -1198,102 +1267,25 @@ int property_list_encode(
             } else if (rpdata->array_index == BACNET_ARRAY_ALL) {
                 /* if no index was specified, then try to encode the entire list */
                 /* into one packet. */
-                if (required_count > 3) {
-                    for (i = 0; i < required_count; i++) {
-                        if ((pListRequired[i] == PROP_OBJECT_TYPE) ||
-                            (pListRequired[i] == PROP_OBJECT_IDENTIFIER) ||
-                            (pListRequired[i] == PROP_OBJECT_NAME)) {
-                            continue;
-                        } else {
-                            len =
-                                encode_application_enumerated(&apdu[apdu_len],
-                                pListRequired[i]);
-                        }
-                        /* add it if we have room */
-                        if ((apdu_len + len) < max_apdu_len) {
-                            apdu_len += len;
-                        } else {
-                            rpdata->error_code =
-                                ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                            apdu_len = BACNET_STATUS_ABORT;
-                            break;
-                        }
-                    }
-                }
-                if (optional_count) {
-                    for (i = 0; i < optional_count; i++) {
-                        len =
-                            encode_application_enumerated(&apdu[apdu_len],
-                            pListOptional[i]);
-                        /* add it if we have room */
-                        if ((apdu_len + len) < max_apdu_len) {
-                            apdu_len += len;
-                        } else {
-                            rpdata->error_code =
-                                ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                            apdu_len = BACNET_STATUS_ABORT;
-                            break;
-                        }
-                    }
-                }
-                if (proprietary_count) {
-                    for (i = 0; i < proprietary_count; i++) {
-                        len =
-                            encode_application_enumerated(&apdu[apdu_len],
-                            pListProprietary[i]);
-                        /* add it if we have room */
-                        if ((apdu_len + len) < max_apdu_len) {
-                            apdu_len += len;
-                        } else {
-                            rpdata->error_code =
-                                ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                            apdu_len = BACNET_STATUS_ABORT;
-                            break;
-                        }
-                    }
+                apdu_len = property_list_encode_elements(apdu, apdu_len,
+                    max_apdu_len, pListRequired, true);
+                apdu_len = property_list_encode_elements(apdu, apdu_len,
+                    max_apdu_len, pListOptional, false);
+                apdu_len = property_list_encode_elements(apdu, apdu_len,
+                    max_apdu_len, pListProprietary, false);
+                if (apdu_len == BACNET_STATUS_ABORT) {
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
                 }
             } else {
                 if (rpdata->array_index <= count) {
-                    count = 0;
-                    if (required_count > 3) {
-                        for (i = 0; i < required_count; i++) {
-                            if ((pListRequired[i] == PROP_OBJECT_TYPE) ||
-                                (pListRequired[i] == PROP_OBJECT_IDENTIFIER) ||
-                                (pListRequired[i] == PROP_OBJECT_NAME)) {
-                                continue;
-                            } else {
-                                count++;
-                            }
-                            if (count == rpdata->array_index) {
-                                apdu_len = encode_application_enumerated(
-                                    &apdu[apdu_len],
-                                    pListRequired[i]);
-                                break;
-                            }
-                        }
-                    }
-                    if ((apdu_len == 0) && (optional_count > 0)) {
-                        for (i = 0; i < optional_count; i++) {
-                            count++;
-                            if (count == rpdata->array_index) {
-                                apdu_len = encode_application_enumerated(
-                                    &apdu[apdu_len],
-                                    pListOptional[i]);
-                                break;
-                            }
-                        }
-                    }
-                    if ((apdu_len == 0) && (proprietary_count > 0)) {
-                        for (i = 0; i < proprietary_count; i++) {
-                            count++;
-                            if (count == rpdata->array_index) {
-                                apdu_len = encode_application_enumerated(
-                                    &apdu[apdu_len],
-                                    pListProprietary[i]);
-                                break;
-                            }
-                        }
-                    }
+                    object_property = property_list_element(pListRequired,
+                        pListOptional, optional_count, pListProprietary,
+                        proprietary_count, rpdata->array_index);
+                }
+                if (object_property >= 0) {
+                    apdu_len = encode_application_enumerated(&apdu[0],
+                        object_property);
                 } else {
                     rpdata->error_class = ERROR_CLASS_PROPERTY;
                     rpdata->error_code = ERROR_CODE_INVALID_ARRAY_INDEX;
@@ -1350,6 +1342,73 @@ void testPropList(
     }
 }
 
+static const int Test_Required[] = {
+    PROP_OBJECT_IDENTIFIER, PROP_OBJECT_NAME, PROP_OBJECT_TYPE,
+    PROP_PRESENT_VALUE, PROP_STATUS_FLAGS, PROP_EVENT_STATE,
+    PROP_OUT_OF_SERVICE, PROP_UNITS, -1
+};
+
+static const int Test_Optional[] = {
+    PROP_DESCRIPTION, PROP_RELIABILITY, PROP_COV_INCREMENT, -1
+};
+
+static const int Test_Proprietary[] = {
+    512, 513, -1
+};
+
+void testPropListEncode(
+    Test * pTest)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t apdu[64];
+    uint8_t element[8];
+    uint32_t value = 0;
+    int len = 0;
+    int test_len = 0;
+    int offset = 0;
+    unsigned i = 0;
+
+    rpdata.object_type = OBJECT_ANALOG_INPUT;
+    rpdata.object_instance = 1;
+    rpdata.object_property = PROP_PROPERTY_LIST;
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = sizeof(apdu);
+    rpdata.array_index = 0;
+    len = property_list_encode(&rpdata, Test_Required, Test_Optional,
+        Test_Proprietary);
+    ct_test(pTest, len > 0);
+    decode_unsigned(&apdu[1], len - 1, &value);
+    ct_test(pTest, value == 10);
+    /* the whole list is the elements, one after the other */
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    len = property_list_encode(&rpdata, Test_Required, Test_Optional,
+        Test_Proprietary);
+    ct_test(pTest, len > 0);
+    rpdata.application_data = element;
+    rpdata.application_data_len = sizeof(element);
+    for (i = 1; i <= 10; i++) {
+        rpdata.array_index = i;
+        test_len = property_list_encode(&rpdata, Test_Required,
+            Test_Optional, Test_Proprietary);
+        ct_test(pTest, test_len > 0);
+        ct_test(pTest, memcmp(&apdu[offset], element, test_len) == 0);
+        offset += test_len;
+    }
+    ct_test(pTest, offset == len);
+    rpdata.array_index = 11;
+    ct_test(pTest, property_list_encode(&rpdata, Test_Required,
+            Test_Optional, Test_Proprietary) == BACNET_STATUS_ERROR);
+    ct_test(pTest, rpdata.error_code == ERROR_CODE_INVALID_ARRAY_INDEX);
+    /* a whole list that doesn't fit is aborted */
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = len - 1;
+    ct_test(pTest, property_list_encode(&rpdata, Test_Required,
+            Test_Optional, Test_Proprietary) == BACNET_STATUS_ABORT);
+    ct_test(pTest,
+        rpdata.error_code == ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED);
+}
+
 #ifdef TEST_PROPLIST
 int main(
     void)
@@ -1361,6 +1420,8 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testPropList);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testPropListEncode);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -32,10 +32,12 @@
  -------------------------------------------
 ####COPYRIGHTEND####*/
 #include <stdint.h>
+#include "bits.h"
 #include "bacenum.h"
 #include "bacdcode.h"
 #include "bacdef.h"
 #include "readrange.h"
+#include "bactag.h"
 
 /** @file readrange.c  Encode/Decode ReadRange requests */
 
@@ -76,7 +78,11 @@ int rr_encode_apdu(
 
     if (apdu) {
         apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+#if MAX_SEGMENTS
+        /* segmented-response-accepted */
+        apdu[0] |= BIT(1);
+#endif
+        apdu[1] = encode_max_segs_max_apdu(MAX_SEGMENTS, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_READ_RANGE; /* service choice */
         apdu_len = 4;
@@ -175,6 +181,7 @@ int rr_decode_service_request(
         len += decode_enumerated(&apdu[len], len_value_type, &UnsignedTemp);
         rrdata->object_property = (BACNET_PROPERTY_ID) UnsignedTemp;
         rrdata->Overhead = RR_OVERHEAD; /* Start with the fixed overhead */
+        rrdata->MaxApdu = MAX_APDU;
 
         /* Tag 2: Optional Array Index - set to ALL if not present */
         rrdata->array_index = BACNET_ARRAY_ALL; /* Assuming this is the most common outcome... */
@@ -332,6 +339,8 @@ int rr_ack_encode_apdu(
          */
         apdu_len += encode_opening_tag(&apdu[apdu_len], 5);
         if (rrdata->ItemCount != 0) {
+            /* copied forward, so the items may sit further along
+               in the same buffer as the APDU being built */
             for (len = 0; len < rrdata->application_data_len; len++) {
                 apdu[apdu_len++] = rrdata->application_data[len];
             }
@@ -363,10 +372,11 @@ int rr_ack_decode_service_request(
     uint32_t len_value_type = 0;
     int tag_len = 0;    /* length of tag decode */
     int len = 0;        /* total length of decodes */
-    int start_len;
     uint16_t object = 0;        /* object type */
     uint32_t property = 0;      /* for decoding */
     uint32_t array_value = 0;   /* for decoding */
+    BACNET_TAG_CURSOR cursor;
+    BACNET_TAG_CURSOR items;
 
     /* FIXME: check apdu_len against the len during decode   */
     /* Tag 0: Object ID */
@@ -410,31 +420,18 @@ int rr_ack_decode_service_request(
 
     len += decode_unsigned(&apdu[len], len_value_type, &rrdata->ItemCount);
 
-    if (decode_is_opening_tag_number(&apdu[len], 5)) {
-        len++;  /* a tag number of 5 is not extended so only one octet */
-        /* Setup the start position and length of the data returned from the request
-         * don't decode the application tag number or its data here */
-        rrdata->application_data = &apdu[len];
-        start_len = len;
-        while (len < apdu_len) {
-            if (IS_CONTEXT_SPECIFIC(apdu[len]) &&
-                (decode_is_closing_tag_number(&apdu[len], 5))) {
-                rrdata->application_data_len = len - start_len;
-                len++;  /* Step over single byte closing tag */
-                break;
-            } else {
-                /* Don't care about tag number, just skipping over anyway */
-                len +=
-                    decode_tag_number_and_value(&apdu[len], NULL,
-                    &len_value_type);
-                len += len_value_type;  /* Skip over data value as well */
-                if (len >= apdu_len)    /* APDU is exhausted so we have failed to find closing tag */
-                    return (-1);
-            }
-        }
-    } else {
+    /* Tag 5: itemData - the data returned is not decoded here, but
+       its nested tags are skipped to find the closing tag */
+    if (len >= apdu_len) {
+        return -1;
+    }
+    bactag_cursor_init(&cursor, &apdu[len], apdu_len - len);
+    if (!bactag_enter(&cursor, 5, &items)) {
         return -1;
     }
+    rrdata->application_data = items.apdu;
+    rrdata->application_data_len = items.apdu_len;
+    len += cursor.offset;
     if (len < apdu_len) {       /* Still something left to look at? */
         /* Tag 6: Item count */
         len +=
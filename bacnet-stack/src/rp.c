@@ -32,9 +32,11 @@
  -------------------------------------------
 ####COPYRIGHTEND####*/
 #include <stdint.h>
+#include <string.h>
 #include "bacenum.h"
 #include "bacdcode.h"
 #include "bacdef.h"
+#include "bacreal.h"
 #include "rp.h"
 
 /** @file rp.c  Encode/Decode Read Property and RP ACKs */
@@ -223,6 +225,113 @@ int rp_ack_encode_apdu(
     return apdu_len;
 }
 
+/** Encode the ReadProperty-ACK of one property up to its value, once,
+ * for replies where only the value changes, like a polled Present_Value.
+ *
+ * @param rp_template [out] the encoded ACK
+ * @param rpdata [in] the object, property and array index of the ACK
+ */
+void rp_ack_template_init(
+    BACNET_RP_ACK_TEMPLATE * rp_template,
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    if (rp_template && rpdata) {
+        rp_template->apdu_len = (uint8_t)
+            rp_ack_encode_apdu_init(&rp_template->apdu[0], 0, rpdata);
+    }
+}
+
+/* copies the template and fills in the invoke ID */
+static int rp_ack_template_copy(
+    uint8_t * apdu,
+    BACNET_RP_ACK_TEMPLATE * rp_template,
+    uint8_t invoke_id)
+{
+    /* a fixed size copy is a few moves instead of a call to memcpy();
+       the octets past the template are written over by the value */
+    memcpy(apdu, rp_template->apdu, sizeof(rp_template->apdu));
+    apdu[1] = invoke_id;
+
+    return rp_template->apdu_len;
+}
+
+/** Encode a ReadProperty-ACK with a REAL value from a template.
+ *
+ * @param apdu [out] buffer for the ACK, MAX_RP_ACK_TEMPLATE_LEN + 6 octets
+ * @param rp_template [in] the ACK encoded by rp_ack_template_init()
+ * @param invoke_id [in] the invoke ID of the request
+ * @param value [in] the value of the property
+ * @return number of octets encoded, or 0 if there was no buffer
+ */
+int rp_ack_template_encode_real(
+    uint8_t * apdu,
+    BACNET_RP_ACK_TEMPLATE * rp_template,
+    uint8_t invoke_id,
+    float value)
+{
+    int apdu_len = 0;
+
+    if (apdu && rp_template) {
+        apdu_len = rp_ack_template_copy(apdu, rp_template, invoke_id);
+        /* application tag 4, length 4 */
+        apdu[apdu_len++] = (BACNET_APPLICATION_TAG_REAL << 4) | 4;
+        apdu_len += encode_bacnet_real(value, &apdu[apdu_len]);
+        apdu[apdu_len++] = 0x3F;
+    }
+
+    return apdu_len;
+}
+
+/** Encode a ReadProperty-ACK with an ENUMERATED value from a template.
+ *
+ * @param apdu [out] buffer for the ACK, MAX_RP_ACK_TEMPLATE_LEN + 6 octets
+ * @param rp_template [in] the ACK encoded by rp_ack_template_init()
+ * @param invoke_id [in] the invoke ID of the request
+ * @param value [in] the value of the property
+ * @return number of octets encoded, or 0 if there was no buffer
+ */
+int rp_ack_template_encode_enumerated(
+    uint8_t * apdu,
+    BACNET_RP_ACK_TEMPLATE * rp_template,
+    uint8_t invoke_id,
+    uint32_t value)
+{
+    int apdu_len = 0;
+
+    if (apdu && rp_template) {
+        apdu_len = rp_ack_template_copy(apdu, rp_template, invoke_id);
+        apdu_len += encode_application_enumerated(&apdu[apdu_len], value);
+        apdu[apdu_len++] = 0x3F;
+    }
+
+    return apdu_len;
+}
+
+/** Encode a ReadProperty-ACK with an Unsigned value from a template.
+ *
+ * @param apdu [out] buffer for the ACK, MAX_RP_ACK_TEMPLATE_LEN + 6 octets
+ * @param rp_template [in] the ACK encoded by rp_ack_template_init()
+ * @param invoke_id [in] the invoke ID of the request
+ * @param value [in] the value of the property
+ * @return number of octets encoded, or 0 if there was no buffer
+ */
+int rp_ack_template_encode_unsigned(
+    uint8_t * apdu,
+    BACNET_RP_ACK_TEMPLATE * rp_template,
+    uint8_t invoke_id,
+    uint32_t value)
+{
+    int apdu_len = 0;
+
+    if (apdu && rp_template) {
+        apdu_len = rp_ack_template_copy(apdu, rp_template, invoke_id);
+        apdu_len += encode_application_unsigned(&apdu[apdu_len], value);
+        apdu[apdu_len++] = 0x3F;
+    }
+
+    return apdu_len;
+}
+
 
 #if BACNET_SVC_RP_A
 /** Decode the ReadProperty reply and store the result for one Property in a
@@ -292,6 +401,10 @@ int rp_ack_decode_service_request(
 #ifdef TEST
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "npdu.h"
 #include "ctest.h"
 
 int rp_decode_apdu(
@@ -430,12 +543,151 @@ void testReadProperty(
     return;
 }
 
+/* encodes the ACK the way h_rp.c does, with the value from the object */
+static int rp_ack_generic_encode(
+    uint8_t * pdu,
+    BACNET_ADDRESS * dest,
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_READ_PROPERTY_DATA * rpdata,
+    BACNET_APPLICATION_TAG tag,
+    uint32_t value,
+    float real_value)
+{
+    BACNET_NPDU_DATA npdu_data;
+    int len = 0;
+
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    len = npdu_encode_pdu(&pdu[0], dest, src, &npdu_data);
+    len += rp_ack_encode_apdu_init(&pdu[len], invoke_id, rpdata);
+    if (tag == BACNET_APPLICATION_TAG_REAL) {
+        len += encode_application_real(&pdu[len], real_value);
+    } else if (tag == BACNET_APPLICATION_TAG_ENUMERATED) {
+        len += encode_application_enumerated(&pdu[len], value);
+    } else {
+        len += encode_application_unsigned(&pdu[len], value);
+    }
+    len += rp_ack_encode_apdu_object_property_end(&pdu[len]);
+
+    return len;
+}
+
+void testReadPropertyAckTemplate(
+    Test * pTest)
+{
+    uint8_t pdu[MAX_NPDU + 64] = { 0 };
+    uint8_t test_pdu[MAX_NPDU + 64] = { 0 };
+    int len = 0, test_len = 0;
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_RP_ACK_TEMPLATE rp_template;
+    BACNET_NPDU_TEMPLATE npdu_template;
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    static const uint32_t values[] = { 0, 4, 255, 256, 65535, 65536,
+        0xFFFFFF, 0x1000000, 0xFFFFFFFF
+    };
+    unsigned i = 0, j = 0;
+
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    npdu_template_init(&npdu_template, &src, &npdu_data);
+    for (i = 0; i < 2; i++) {
+        rpdata.object_type = OBJECT_ANALOG_VALUE;
+        rpdata.object_instance = 4194303 - i;
+        rpdata.object_property = i ? PROP_PRIORITY_ARRAY : PROP_PRESENT_VALUE;
+        rpdata.array_index = i ? 16 : BACNET_ARRAY_ALL;
+        rp_ack_template_init(&rp_template, &rpdata);
+        /* routed replies too */
+        dest.net = i ? 2001 : 0;
+        dest.len = i ? 1 : 0;
+        dest.adr[0] = 127;
+        len = rp_ack_generic_encode(pdu, &dest, &src, 42, &rpdata,
+            BACNET_APPLICATION_TAG_REAL, 0, -273.15f);
+        test_len = npdu_template_encode(&test_pdu[0], &npdu_template, &dest);
+        test_len += rp_ack_template_encode_real(&test_pdu[test_len],
+            &rp_template, 42, -273.15f);
+        ct_test(pTest, len == test_len);
+        ct_test(pTest, memcmp(pdu, test_pdu, (size_t) len) == 0);
+        for (j = 0; j < (sizeof(values) / sizeof(values[0])); j++) {
+            len = rp_ack_generic_encode(pdu, &dest, &src, (uint8_t) j,
+                &rpdata, BACNET_APPLICATION_TAG_ENUMERATED, values[j], 0.0f);
+            test_len =
+                npdu_template_encode(&test_pdu[0], &npdu_template, &dest);
+            test_len += rp_ack_template_encode_enumerated(&test_pdu[test_len],
+                &rp_template, (uint8_t) j, values[j]);
+            ct_test(pTest, len == test_len);
+            ct_test(pTest, memcmp(pdu, test_pdu, (size_t) len) == 0);
+            len = rp_ack_generic_encode(pdu, &dest, &src, (uint8_t) j,
+                &rpdata, BACNET_APPLICATION_TAG_UNSIGNED_INT, values[j], 0.0f);
+            test_len =
+                npdu_template_encode(&test_pdu[0], &npdu_template, &dest);
+            test_len += rp_ack_template_encode_unsigned(&test_pdu[test_len],
+                &rp_template, (uint8_t) j, values[j]);
+            ct_test(pTest, len == test_len);
+            ct_test(pTest, memcmp(pdu, test_pdu, (size_t) len) == 0);
+        }
+    }
+}
+
 #ifdef TEST_READ_PROPERTY
+static double rp_ack_bench_seconds(
+    clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* a polled Present_Value reply, encoded the generic way and from templates */
+static void rp_ack_template_benchmark(
+    unsigned long iterations)
+{
+    uint8_t pdu[MAX_NPDU + 64] = { 0 };
+    int len = 0;
+    unsigned long i = 0;
+    unsigned long checksum = 0;
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_RP_ACK_TEMPLATE rp_template;
+    BACNET_NPDU_TEMPLATE npdu_template;
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_ADDRESS src = { 0 };
+    clock_t start;
+    double seconds = 0.0;
+
+    rpdata.object_type = OBJECT_ANALOG_INPUT;
+    rpdata.object_instance = 1000;
+    rpdata.object_property = PROP_PRESENT_VALUE;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    npdu_template_init(&npdu_template, &src, &npdu_data);
+    rp_ack_template_init(&rp_template, &rpdata);
+    printf("RP-ACK of a REAL Present_Value, %lu iterations\n", iterations);
+    printf("%-26s %10s\n", "method", "ns/reply");
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        checksum += rp_ack_generic_encode(pdu, &dest, &src, (uint8_t) i,
+            &rpdata, BACNET_APPLICATION_TAG_REAL, 0, (float) i);
+    }
+    seconds = rp_ack_bench_seconds(start);
+    printf("%-26s %10.1f\n", "generic", (seconds * 1e9) / iterations);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        len = npdu_template_encode(&pdu[0], &npdu_template, &dest);
+        len += rp_ack_template_encode_real(&pdu[len], &rp_template,
+            (uint8_t) i, (float) i);
+        checksum += len;
+    }
+    seconds = rp_ack_bench_seconds(start);
+    printf("%-26s %10.1f\n", "template", (seconds * 1e9) / iterations);
+    printf("checksum %lu\n", checksum + pdu[3]);
+}
+
 int main(
-    void)
+    int argc,
+    char *argv[])
 {
     Test *pTest;
     bool rc;
+    unsigned long iterations = 1000000;
 
     pTest = ct_create("BACnet ReadProperty", NULL);
     /* individual tests */
@@ -443,12 +695,19 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testReadPropertyAck);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyAckTemplate);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
     (void) ct_report(pTest);
     ct_destroy(pTest);
 
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    rp_ack_template_benchmark(iterations);
+
     return 0;
 }
 #endif /* TEST_READ_PROPERTY */
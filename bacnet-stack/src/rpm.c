@@ -32,12 +32,14 @@
  -------------------------------------------
 ####COPYRIGHTEND####*/
 #include <stdint.h>
+#include "bits.h"
 #include "bacenum.h"
 #include "bacerror.h"
 #include "bacdcode.h"
 #include "bacdef.h"
 #include "bacapp.h"
 #include "memcopy.h"
+#include "encbuf.h"
 #include "rpm.h"
 
 /** @file rpm.c  Encode/Decode Read Property Multiple and RPM ACKs  */
@@ -52,7 +54,11 @@ int rpm_encode_apdu_init(
 
     if (apdu) {
         apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+#if MAX_SEGMENTS
+        /* segmented-response-accepted */
+        apdu[0] |= BIT(1);
+#endif
+        apdu[1] = encode_max_segs_max_apdu(MAX_SEGMENTS, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE; /* service choice */
         apdu_len = 4;
@@ -426,6 +432,78 @@ int rpm_ack_encode_apdu_object_end(
     return apdu_len;
 }
 
+/* The encbuf versions of the RPM-ACK encoders write straight into the
+   reply, and return false when that is full.  The reply is then left
+   failed until it is rolled back; see encbuf.h.  None of them is
+   longer than ENCBUF_SCRATCH_SIZE: a property access error is 12. */
+
+bool rpm_ack_encode_buffer_object_begin(
+    BACNET_ENCODE_BUFFER * buffer,
+    BACNET_RPM_DATA * rpmdata)
+{
+    uint8_t *apdu = encbuf_encode_begin(buffer);
+
+    return encbuf_encode_end(buffer, apdu,
+        rpm_ack_encode_apdu_object_begin(apdu, rpmdata));
+}
+
+bool rpm_ack_encode_buffer_object_property(
+    BACNET_ENCODE_BUFFER * buffer,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    uint8_t *apdu = encbuf_encode_begin(buffer);
+
+    return encbuf_encode_end(buffer, apdu,
+        rpm_ack_encode_apdu_object_property(apdu, object_property,
+            array_index));
+}
+
+/* The value may have been read in place, at the end of the reply
+   just past the room for the opening tag; see encbuf_reserve() */
+bool rpm_ack_encode_buffer_object_property_value(
+    BACNET_ENCODE_BUFFER * buffer,
+    uint8_t * application_data,
+    unsigned application_data_len)
+{
+    uint8_t *apdu = NULL;
+
+    if (!buffer->overflow &&
+        (application_data == &buffer->buffer[buffer->len + 1])) {
+        apdu = &buffer->buffer[buffer->len];
+
+        return encbuf_commit(buffer,
+            rpm_ack_encode_apdu_object_property_value(apdu,
+                application_data, application_data_len));
+    }
+    /* Tag 4: propertyValue */
+    encbuf_opening_tag(buffer, 4);
+    encbuf_append(buffer, application_data, application_data_len);
+
+    return encbuf_closing_tag(buffer, 4);
+}
+
+bool rpm_ack_encode_buffer_object_property_error(
+    BACNET_ENCODE_BUFFER * buffer,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    uint8_t *apdu = encbuf_encode_begin(buffer);
+
+    return encbuf_encode_end(buffer, apdu,
+        rpm_ack_encode_apdu_object_property_error(apdu, error_class,
+            error_code));
+}
+
+bool rpm_ack_encode_buffer_object_end(
+    BACNET_ENCODE_BUFFER * buffer)
+{
+    uint8_t *apdu = encbuf_encode_begin(buffer);
+
+    return encbuf_encode_end(buffer, apdu,
+        rpm_ack_encode_apdu_object_end(apdu));
+}
+
 #if BACNET_SVC_RPM_A
 
 /* decode the object portion of the service request only */
@@ -522,7 +600,10 @@ int rpm_ack_decode_object_property(
 
 #ifdef TEST
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "ctest.h"
 
 int rpm_ack_decode_apdu(
@@ -565,7 +646,7 @@ int rpm_decode_apdu(
     if (!apdu)
         return -1;
     /* optional checking - most likely was already done prior to this call */
-    if (apdu[0] != PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
+    if ((apdu[0] & 0xF0) != PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
         return -1;
     /*  apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU); */
     *invoke_id = apdu[2];       /* invoke id - filled in by net layer */
@@ -942,12 +1023,269 @@ void testReadPropertyMultipleAck(
     ct_test(pTest, len == service_request_len);
 }
 
+/* stands in for Device_Read_Property(): encodes the value of a
+   property, or returns -1 for a property that has none.  With a
+   list_len, the last property of each four is a list of that many
+   object identifiers, as in an Object_List. */
+static int rpm_test_read_property(
+    uint8_t * application_data,
+    uint32_t object_instance,
+    unsigned property_index,
+    unsigned list_len)
+{
+    static BACNET_CHARACTER_STRING name;
+    int len = 0;
+    unsigned i;
+
+    switch (property_index % 4) {
+        case 0:
+            return encode_application_object_id(application_data,
+                OBJECT_ANALOG_INPUT, object_instance);
+        case 1:
+            if (name.length == 0) {
+                characterstring_init_ansi(&name, "ANALOG INPUT 1");
+            }
+            return encode_application_character_string(application_data,
+                &name);
+        case 2:
+            return encode_application_real(application_data,
+                (float) object_instance);
+        default:
+            break;
+    }
+    if (list_len == 0) {
+        return -1;
+    }
+    for (i = 0; i < list_len; i++) {
+        len +=
+            encode_application_object_id(&application_data[len],
+            OBJECT_ANALOG_INPUT, i);
+    }
+
+    return len;
+}
+
+/* the large replies measured: many small values, or a few lists */
+#define RPM_TEST_PROPERTIES 8
+#define RPM_TEST_OBJECTS 14
+#define RPM_TEST_LIST_LEN 130
+
+/* A large RPM-ACK built the way the handler did before the encode
+   buffer: each part in a scratch buffer, then copied into the reply */
+static int rpm_test_ack_copied(
+    uint8_t * apdu,
+    unsigned max_apdu,
+    unsigned objects,
+    unsigned list_len)
+{
+    static uint8_t Temp_Buf[MAX_APDU];
+    BACNET_RPM_DATA rpmdata;
+    int apdu_len = 0;
+    int len = 0;
+    unsigned i, j;
+
+    apdu_len = rpm_ack_encode_apdu_init(&apdu[0], 1);
+    for (i = 0; i < objects; i++) {
+        rpmdata.object_type = OBJECT_ANALOG_INPUT;
+        rpmdata.object_instance = i;
+        len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
+        if (!memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len, max_apdu)) {
+            return -1;
+        }
+        apdu_len += len;
+        for (j = 0; j < RPM_TEST_PROPERTIES; j++) {
+            len =
+                rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
+                (BACNET_PROPERTY_ID) (PROP_DESCRIPTION + j),
+                BACNET_ARRAY_ALL);
+            if (!memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len, max_apdu)) {
+                return -1;
+            }
+            apdu_len += len;
+            len = rpm_test_read_property(&Temp_Buf[0], i, j, list_len);
+            if (len < 0) {
+                len =
+                    rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
+                    ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
+                if (!memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len,
+                        max_apdu)) {
+                    return -1;
+                }
+            } else if ((apdu_len + 1 + len + 1) < (int) max_apdu) {
+                len =
+                    rpm_ack_encode_apdu_object_property_value(&apdu
+                    [apdu_len], &Temp_Buf[0], len);
+            } else {
+                return -1;
+            }
+            apdu_len += len;
+        }
+        len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
+        if (!memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len, max_apdu)) {
+            return -1;
+        }
+        apdu_len += len;
+    }
+
+    return apdu_len;
+}
+
+/* The same RPM-ACK encoded in place.  The values are read straight
+   into it while it has room for the most a value may take, which is
+   what the room past its size is for, otherwise into a scratch. */
+static int rpm_test_ack_in_place(
+    BACNET_ENCODE_BUFFER * buffer,
+    unsigned objects,
+    unsigned list_len)
+{
+    static uint8_t scratch[MAX_APDU];
+    BACNET_RPM_DATA rpmdata;
+    uint8_t *value;
+    int len = 0;
+    unsigned i, j;
+
+    encbuf_commit(buffer, (unsigned) rpm_ack_encode_apdu_init(buffer->buffer,
+            1));
+    for (i = 0; i < objects; i++) {
+        rpmdata.object_type = OBJECT_ANALOG_INPUT;
+        rpmdata.object_instance = i;
+        rpm_ack_encode_buffer_object_begin(buffer, &rpmdata);
+        for (j = 0; j < RPM_TEST_PROPERTIES; j++) {
+            rpm_ack_encode_buffer_object_property(buffer,
+                (BACNET_PROPERTY_ID) (PROP_DESCRIPTION + j),
+                BACNET_ARRAY_ALL);
+            value = encbuf_reserve(buffer, 1 + MAX_APDU + 1);
+            value = (value ? &value[1] : &scratch[0]);
+            len = rpm_test_read_property(value, i, j, list_len);
+            if (len < 0) {
+                rpm_ack_encode_buffer_object_property_error(buffer,
+                    ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
+            } else {
+                rpm_ack_encode_buffer_object_property_value(buffer, value,
+                    len);
+            }
+        }
+        if (!rpm_ack_encode_buffer_object_end(buffer)) {
+            return -1;
+        }
+    }
+
+    return (int) buffer->len;
+}
+
+void testReadPropertyMultipleAckBuffer(
+    Test * pTest)
+{
+    static uint8_t copied[MAX_APDU];
+    static uint8_t in_place[MAX_APDU + MAX_APDU];
+    BACNET_ENCODE_BUFFER buffer;
+    BACNET_RPM_DATA rpmdata;
+    unsigned mark;
+    int len = 0;
+    int test_len = 0;
+
+    /* both ways encode the same octets */
+    len = rpm_test_ack_copied(copied, MAX_APDU, RPM_TEST_OBJECTS, 0);
+    ct_test(pTest, len > 0);
+    encbuf_init(&buffer, in_place, MAX_APDU, sizeof(in_place));
+    test_len = rpm_test_ack_in_place(&buffer, RPM_TEST_OBJECTS, 0);
+    ct_test(pTest, test_len == len);
+    ct_test(pTest, memcmp(copied, in_place, len) == 0);
+    len = rpm_test_ack_copied(copied, MAX_APDU, 1, RPM_TEST_LIST_LEN);
+    ct_test(pTest, len > 0);
+    encbuf_init(&buffer, in_place, MAX_APDU, sizeof(in_place));
+    test_len = rpm_test_ack_in_place(&buffer, 1, RPM_TEST_LIST_LEN);
+    ct_test(pTest, test_len == len);
+    ct_test(pTest, memcmp(copied, in_place, len) == 0);
+    /* and without room past the size, via the scratch */
+    memset(in_place, 0, sizeof(in_place));
+    encbuf_init(&buffer, in_place, MAX_APDU, MAX_APDU);
+    test_len = rpm_test_ack_in_place(&buffer, 1, RPM_TEST_LIST_LEN);
+    ct_test(pTest, test_len == len);
+    ct_test(pTest, memcmp(copied, in_place, len) == 0);
+    /* and both fail when the reply is too small */
+    ct_test(pTest, rpm_test_ack_copied(copied, len - 1, 1,
+            RPM_TEST_LIST_LEN) == -1);
+    encbuf_init(&buffer, in_place, len - 1, sizeof(in_place));
+    ct_test(pTest, rpm_test_ack_in_place(&buffer, 1,
+            RPM_TEST_LIST_LEN) == -1);
+    ct_test(pTest, buffer.len < (unsigned) len);
+    /* a property that does not fit is rolled back */
+    encbuf_init(&buffer, in_place, 12, 12);
+    rpmdata.object_type = OBJECT_DEVICE;
+    rpmdata.object_instance = 4194302;
+    ct_test(pTest, rpm_ack_encode_buffer_object_begin(&buffer, &rpmdata));
+    ct_test(pTest, buffer.len == 6);
+    mark = encbuf_mark(&buffer);
+    ct_test(pTest, rpm_ack_encode_buffer_object_property(&buffer,
+            PROP_PRIORITY_ARRAY, 16));
+    ct_test(pTest, rpm_ack_encode_buffer_object_property_error(&buffer,
+            ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY) == false);
+    ct_test(pTest, rpm_ack_encode_buffer_object_end(&buffer) == false);
+    encbuf_rollback(&buffer, mark);
+    ct_test(pTest, rpm_ack_encode_buffer_object_end(&buffer));
+    ct_test(pTest, buffer.len == 7);
+    ct_test(pTest, in_place[6] == 0x1F);
+}
+
 #ifdef TEST_READ_PROPERTY_MULTIPLE
+static double rpm_bench_seconds(
+    clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* throughput of building a large RPM-ACK, copied and in place */
+static void rpm_ack_benchmark(
+    unsigned long iterations,
+    unsigned objects,
+    unsigned list_len)
+{
+    static uint8_t copied[MAX_APDU];
+    static uint8_t in_place[MAX_APDU + MAX_APDU];
+    BACNET_ENCODE_BUFFER buffer;
+    unsigned long i = 0;
+    unsigned long octets = 0;
+    clock_t start;
+    double seconds = 0.0;
+
+    if (list_len) {
+        printf("RPM-ACK of %u object, %u properties, lists of %u, "
+            "%lu iterations\n", objects, RPM_TEST_PROPERTIES, list_len,
+            iterations);
+    } else {
+        printf("RPM-ACK of %u objects, %u properties each, "
+            "%lu iterations\n", objects, RPM_TEST_PROPERTIES, iterations);
+    }
+    printf("%-20s %8s %12s %10s\n", "method", "octets", "ns/reply",
+        "MB/s");
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        octets += rpm_test_ack_copied(copied, MAX_APDU, objects, list_len);
+    }
+    seconds = rpm_bench_seconds(start);
+    printf("%-20s %8lu %12.1f %10.1f\n", "scratch and copy",
+        octets / iterations, (seconds * 1e9) / iterations,
+        (octets / 1e6) / seconds);
+    octets = 0;
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        encbuf_init(&buffer, in_place, MAX_APDU, sizeof(in_place));
+        octets += rpm_test_ack_in_place(&buffer, objects, list_len);
+    }
+    seconds = rpm_bench_seconds(start);
+    printf("%-20s %8lu %12.1f %10.1f\n", "encode buffer",
+        octets / iterations, (seconds * 1e9) / iterations,
+        (octets / 1e6) / seconds);
+}
+
 int main(
-    void)
+    int argc,
+    char *argv[])
 {
     Test *pTest;
     bool rc;
+    unsigned long iterations = 20000;
 
     pTest = ct_create("BACnet ReadPropertyMultiple", NULL);
     /* individual tests */
@@ -955,12 +1293,20 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testReadPropertyMultipleAck);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyMultipleAckBuffer);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
     (void) ct_report(pTest);
     ct_destroy(pTest);
 
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    rpm_ack_benchmark(iterations, RPM_TEST_OBJECTS, 0);
+    rpm_ack_benchmark(iterations, 1, RPM_TEST_LIST_LEN);
+
     return 0;
 }
 #endif /* TEST_READ_PROPERTY_MULTIPLE */
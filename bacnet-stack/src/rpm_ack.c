@@ -0,0 +1,832 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacenum.h"
+#include "bacdcode.h"
+#include "bacdef.h"
+#include "bacapp.h"
+#include "rpm.h"
+#include "rpm_ack.h"
+#include "bactag.h"
+
+/** @file rpm_ack.c  Compact decoding of ReadPropertyMultiple-ACK. */
+
+/* decodes the propertyIdentifier and optional propertyArrayIndex */
+static int rpm_ack_decode_compact_property(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_RPM_ACK_PROPERTY * rpm_property)
+{
+    int len = 0;
+    int tag_len = 0;
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+    uint32_t value = 0;
+
+    /* Tag 2: propertyIdentifier */
+    if (!IS_CONTEXT_SPECIFIC(apdu[0])) {
+        return BACNET_STATUS_ERROR;
+    }
+    tag_len =
+        decode_tag_number_and_value_safe(apdu, apdu_len, &tag_number,
+        &len_value_type);
+    if ((tag_len <= 0) || (tag_number != 2) || (len_value_type == 0) ||
+        (len_value_type > 4) ||
+        (len_value_type > (apdu_len - (unsigned) tag_len))) {
+        return BACNET_STATUS_ERROR;
+    }
+    len = tag_len;
+    len += decode_enumerated(&apdu[len], len_value_type, &value);
+    rpm_property->propertyIdentifier = (BACNET_PROPERTY_ID) value;
+    rpm_property->propertyArrayIndex = BACNET_ARRAY_ALL;
+    /* Tag 3: Optional propertyArrayIndex */
+    if (((unsigned) len < apdu_len) && IS_CONTEXT_SPECIFIC(apdu[len]) &&
+        !IS_OPENING_TAG(apdu[len]) && !IS_CLOSING_TAG(apdu[len])) {
+        tag_len =
+            decode_tag_number_and_value_safe(&apdu[len], apdu_len - len,
+            &tag_number, &len_value_type);
+        if ((tag_len <= 0) || (tag_number != 3) || (len_value_type == 0) ||
+            (len_value_type > 4) ||
+            (len_value_type > (apdu_len - len - (unsigned) tag_len))) {
+            return BACNET_STATUS_ERROR;
+        }
+        len += tag_len;
+        len += decode_unsigned(&apdu[len], len_value_type, &value);
+        rpm_property->propertyArrayIndex = value;
+    }
+
+    return len;
+}
+
+/* decodes the error class and error code of a propertyAccessError */
+static int rpm_ack_decode_compact_error(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_ACCESS_ERROR * error)
+{
+    unsigned len = 0;
+    int tag_len = 0;
+    uint8_t tag_number = 0;
+    uint32_t len_value_type = 0;
+    uint32_t values[2] = { 0, 0 };
+    unsigned i;
+
+    for (i = 0; i < 2; i++) {
+        if (len >= apdu_len) {
+            return BACNET_STATUS_ERROR;
+        }
+        tag_len =
+            decode_tag_number_and_value_safe(&apdu[len], apdu_len - len,
+            &tag_number, &len_value_type);
+        if ((tag_len <= 0) || IS_CONTEXT_SPECIFIC(apdu[len]) ||
+            (tag_number != BACNET_APPLICATION_TAG_ENUMERATED) ||
+            (len_value_type == 0) || (len_value_type > 4) ||
+            (len_value_type > (apdu_len - len - (unsigned) tag_len))) {
+            return BACNET_STATUS_ERROR;
+        }
+        len += tag_len;
+        len += decode_enumerated(&apdu[len], len_value_type, &values[i]);
+    }
+    error->error_class = (BACNET_ERROR_CLASS) values[0];
+    error->error_code = (BACNET_ERROR_CODE) values[1];
+
+    return (int) len;
+}
+
+/** Decode the service data of a ReadPropertyMultiple-ACK into compact
+ * values taken from an arena.  Nothing is allocated with malloc() except
+ * the blocks of the arena, and the whole result is released at once by
+ * arena_free() or arena_reset().
+ * @ingroup DSRPM
+ *
+ * @param service_request [in] The service data of the ACK.
+ * @param service_len [in] Length of the service data.
+ * @param copy [in] True to copy the service data into the arena, so that
+ *                  strings in the result outlive the receive buffer;
+ *                  false to refer to the service data where it is.
+ * @param arena [in] The arena that holds the result.
+ * @param ack_data [out] The decoded ACK.
+ * @return The number of bytes decoded, or BACNET_STATUS_ERROR.  On an
+ *         error, whatever was decoded stays in the arena.
+ */
+int rpm_ack_decode_compact(
+    uint8_t * service_request,
+    unsigned service_len,
+    bool copy,
+    ARENA * arena,
+    BACNET_RPM_ACK_DATA * ack_data)
+{
+    uint8_t *apdu = service_request;
+    unsigned apdu_len = 0;      /* decoded so far */
+    int len = 0;
+    BACNET_RPM_ACK_OBJECT *rpm_object;
+    BACNET_RPM_ACK_OBJECT **object_tail;
+    BACNET_RPM_ACK_PROPERTY *rpm_property;
+    BACNET_RPM_ACK_PROPERTY **property_tail;
+    BACNET_COMPACT_VALUE *value;
+    BACNET_COMPACT_VALUE **value_tail;
+
+    if (!service_request || !arena || !ack_data) {
+        return BACNET_STATUS_ERROR;
+    }
+    ack_data->objects = NULL;
+    ack_data->object_count = 0;
+    ack_data->property_count = 0;
+    ack_data->value_count = 0;
+    if (copy) {
+        apdu = arena_copy(arena, service_request, service_len);
+        if (!apdu) {
+            return BACNET_STATUS_ERROR;
+        }
+    }
+    ack_data->service_data = apdu;
+    ack_data->service_data_len = service_len;
+    object_tail = &ack_data->objects;
+    while (apdu_len < service_len) {
+        rpm_object = arena_alloc(arena, sizeof(BACNET_RPM_ACK_OBJECT));
+        if (!rpm_object) {
+            return BACNET_STATUS_ERROR;
+        }
+        /* objectIdentifier, and the opening of listOfResults */
+        if (((service_len - apdu_len) < 6) ||
+            (apdu[apdu_len] != 0x0C)) {
+            return BACNET_STATUS_ERROR;
+        }
+        len =
+            rpm_ack_decode_object_id(&apdu[apdu_len], service_len - apdu_len,
+            &rpm_object->object_type, &rpm_object->object_instance);
+        if (len <= 0) {
+            return BACNET_STATUS_ERROR;
+        }
+        apdu_len += len;
+        *object_tail = rpm_object;
+        object_tail = &rpm_object->next;
+        ack_data->object_count++;
+        property_tail = &rpm_object->listOfProperties;
+        for (;;) {
+            if (apdu_len >= service_len) {
+                /* missing the closing of listOfResults */
+                return BACNET_STATUS_ERROR;
+            }
+            if (decode_is_closing_tag_number(&apdu[apdu_len], 1)) {
+                apdu_len++;
+                break;
+            }
+            rpm_property = arena_alloc(arena, sizeof(BACNET_RPM_ACK_PROPERTY));
+            if (!rpm_property) {
+                return BACNET_STATUS_ERROR;
+            }
+            len =
+                rpm_ack_decode_compact_property(&apdu[apdu_len],
+                service_len - apdu_len, rpm_property);
+            if (len <= 0) {
+                return BACNET_STATUS_ERROR;
+            }
+            apdu_len += len;
+            if (apdu_len >= service_len) {
+                return BACNET_STATUS_ERROR;
+            }
+            *property_tail = rpm_property;
+            property_tail = &rpm_property->next;
+            ack_data->property_count++;
+            if (decode_is_opening_tag_number(&apdu[apdu_len], 4)) {
+                /* propertyValue: one value, or the elements of a list */
+                apdu_len++;
+                value_tail = &rpm_property->value;
+                for (;;) {
+                    if (apdu_len >= service_len) {
+                        return BACNET_STATUS_ERROR;
+                    }
+                    if (decode_is_closing_tag_number(&apdu[apdu_len], 4)) {
+                        apdu_len++;
+                        break;
+                    }
+                    value = arena_alloc(arena, sizeof(BACNET_COMPACT_VALUE));
+                    if (!value) {
+                        return BACNET_STATUS_ERROR;
+                    }
+                    len =
+                        bacapp_decode_compact_data(&apdu[apdu_len],
+                        service_len - apdu_len, apdu, value,
+                        rpm_property->propertyIdentifier);
+                    if (len <= 0) {
+                        return BACNET_STATUS_ERROR;
+                    }
+                    apdu_len += len;
+                    *value_tail = value;
+                    value_tail = &value->next;
+                    ack_data->value_count++;
+                }
+            } else if (decode_is_opening_tag_number(&apdu[apdu_len], 5)) {
+                /* propertyAccessError */
+                apdu_len++;
+                len =
+                    rpm_ack_decode_compact_error(&apdu[apdu_len],
+                    service_len - apdu_len, &rpm_property->error);
+                if (len <= 0) {
+                    return BACNET_STATUS_ERROR;
+                }
+                apdu_len += len;
+                if ((apdu_len >= service_len) ||
+                    !decode_is_closing_tag_number(&apdu[apdu_len], 5)) {
+                    return BACNET_STATUS_ERROR;
+                }
+                apdu_len++;
+                rpm_property->error_present = true;
+            } else {
+                return BACNET_STATUS_ERROR;
+            }
+        }
+    }
+
+    return (int) apdu_len;
+}
+
+/** Find the value of one property in a ReadPropertyMultiple-ACK without
+ * decoding anything else: the other objects, properties and values are
+ * skipped over by their tags.
+ * @ingroup DSRPM
+ *
+ * @param service_request [in] The service data of the ACK.
+ * @param service_len [in] Length of the service data.
+ * @param object_type [in] Object of the property.
+ * @param object_instance [in] Object instance of the property.
+ * @param property [in] The property.
+ * @param array_index [in] The array index that was read, or
+ *                         BACNET_ARRAY_ALL.
+ * @param value [out] Cursor over the tags of the propertyValue.
+ * @return true if the property was read with a value; false if it is
+ *         not in the ACK, was read with an error, or the ACK is malformed
+ */
+bool rpm_ack_value_find(
+    uint8_t * service_request,
+    unsigned service_len,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID property,
+    uint32_t array_index,
+    BACNET_TAG_CURSOR * value)
+{
+    BACNET_TAG_CURSOR cursor;
+    BACNET_TAG_CURSOR results;
+    BACNET_TAG tag;
+    BACNET_OBJECT_TYPE test_object_type = MAX_BACNET_OBJECT_TYPE;
+    uint32_t test_object_instance = 0;
+    uint32_t test_property = 0;
+    uint32_t test_array_index = 0;
+
+    bactag_cursor_init(&cursor, service_request, service_len);
+    while (bactag_next(&cursor, &tag)) {
+        /* objectIdentifier, then listOfResults */
+        if (!tag.context || (tag.number != 0) ||
+            !bactag_object_id(&tag, &test_object_type,
+                &test_object_instance) ||
+            !bactag_enter(&cursor, 1, &results)) {
+            return false;
+        }
+        if ((test_object_type != object_type) ||
+            (test_object_instance != object_instance)) {
+            continue;
+        }
+        while (bactag_next(&results, &tag)) {
+            /* propertyIdentifier, and the optional propertyArrayIndex */
+            if (!tag.context || (tag.number != 2) ||
+                !bactag_enumerated(&tag, &test_property)) {
+                return false;
+            }
+            test_array_index = BACNET_ARRAY_ALL;
+            if (bactag_peek(&results, &tag) && tag.context &&
+                (tag.number == 3) && !tag.opening) {
+                (void) bactag_next(&results, &tag);
+                if (!bactag_unsigned(&tag, &test_array_index)) {
+                    return false;
+                }
+            }
+            if ((test_property == (uint32_t) property) &&
+                (test_array_index == array_index)) {
+                /* propertyValue, or a propertyAccessError */
+                return bactag_enter(&results, 4, value);
+            }
+            if (!bactag_skip(&results)) {
+                return false;
+            }
+        }
+        if (results.error) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/** Expand one compact value of a decoded ACK into an application data
+ * value, such as for bacapp_print_value().
+ * @ingroup DSRPM
+ *
+ * @param ack_data [in] The decoded ACK that holds the value.
+ * @param value [in] The compact value.
+ * @param application_value [out] The expanded value.
+ * @return true if the value could be expanded
+ */
+bool rpm_ack_value_expand(
+    BACNET_RPM_ACK_DATA * ack_data,
+    BACNET_COMPACT_VALUE * value,
+    BACNET_APPLICATION_DATA_VALUE * application_value)
+{
+    if (!ack_data) {
+        return false;
+    }
+
+    return bacapp_compact_value_expand(ack_data->service_data, value,
+        application_value);
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bacstr.h"
+#include "config.h"
+#include "ctest.h"
+
+/* encodes an ACK for up to the number of objects that fit in MAX_APDU,
+   with a REAL Present_Value, Status_Flags, Object_Name, an access error,
+   and a Priority_Array of NULL and REAL elements for each */
+static int rpm_ack_test_encode(
+    uint8_t * apdu,
+    unsigned objects)
+{
+    int apdu_len = 0;
+    int len = 0;
+    unsigned i, j;
+    char name[32];
+    uint8_t value_buffer[MAX_APDU];
+    BACNET_RPM_DATA rpmdata;
+    BACNET_BIT_STRING bit_string;
+    BACNET_CHARACTER_STRING char_string;
+
+    for (i = 0; i < objects; i++) {
+        if ((apdu_len + 80) > MAX_APDU) {
+            break;
+        }
+        rpmdata.object_type = OBJECT_ANALOG_VALUE;
+        rpmdata.object_instance = i;
+        apdu_len +=
+            rpm_ack_encode_apdu_object_begin(&apdu[apdu_len], &rpmdata);
+        /* Present_Value */
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+            PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+        len = encode_application_real(&value_buffer[0], (float) i + 0.5f);
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+            &value_buffer[0], len);
+        /* Status_Flags */
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+            PROP_STATUS_FLAGS, BACNET_ARRAY_ALL);
+        bitstring_init(&bit_string);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, (i & 1));
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
+        len = encode_application_bitstring(&value_buffer[0], &bit_string);
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+            &value_buffer[0], len);
+        /* Object_Name */
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+            PROP_OBJECT_NAME, BACNET_ARRAY_ALL);
+        sprintf(name, "AV-%u", i);
+        characterstring_init_ansi(&char_string, name);
+        len =
+            encode_application_character_string(&value_buffer[0],
+            &char_string);
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+            &value_buffer[0], len);
+        /* an error */
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+            PROP_DEADBAND, BACNET_ARRAY_ALL);
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property_error(&apdu[apdu_len],
+            ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
+        /* Priority_Array */
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+            PROP_PRIORITY_ARRAY, BACNET_ARRAY_ALL);
+        len = 0;
+        for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
+            if (j == 7) {
+                len += encode_application_real(&value_buffer[len], 42.0f);
+            } else {
+                len += encode_application_null(&value_buffer[len]);
+            }
+        }
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+            &value_buffer[0], len);
+        apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+    }
+
+    return apdu_len;
+}
+
+void testRPMAckCompact(
+    Test * pTest)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    uint8_t copy[MAX_APDU] = { 0 };
+    uint8_t value_buffer[64];
+    int apdu_len = 0;
+    int len = 0;
+    int test_len = 0;
+    unsigned i = 0;
+    ARENA arena;
+    BACNET_RPM_ACK_DATA ack_data;
+    BACNET_RPM_ACK_OBJECT *rpm_object;
+    BACNET_RPM_ACK_PROPERTY *rpm_property;
+    BACNET_COMPACT_VALUE *value;
+    BACNET_APPLICATION_DATA_VALUE application_value;
+    BACNET_RPM_DATA rpmdata;
+    BACNET_TAG_CURSOR cursor;
+    BACNET_TAG tag;
+    BACNET_CHARACTER_STRING char_string;
+    float real_value = 0.0f;
+
+    apdu_len = rpm_ack_test_encode(&apdu[0], 4);
+    /* a context tagged constructed value, and an empty list */
+    rpmdata.object_type = OBJECT_DEVICE;
+    rpmdata.object_instance = 1234;
+    apdu_len += rpm_ack_encode_apdu_object_begin(&apdu[apdu_len], &rpmdata);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len], PROP_TIME_SYNCHRONIZATION_RECIPIENTS, BACNET_ARRAY_ALL);
+    len = encode_opening_tag(&value_buffer[0], 1);
+    len += encode_context_unsigned(&value_buffer[len], 0, 1);
+    len += encode_closing_tag(&value_buffer[len], 1);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &value_buffer[0], len);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+        PROP_ACTIVE_COV_SUBSCRIPTIONS, BACNET_ARRAY_ALL);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &value_buffer[0], 0);
+    apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+    memcpy(copy, apdu, apdu_len);
+
+    arena_init(&arena, 0);
+    test_len = rpm_ack_decode_compact(&copy[0], apdu_len, true, &arena,
+        &ack_data);
+    ct_test(pTest, test_len == apdu_len);
+    /* the result does not depend on the receive buffer */
+    memset(copy, 0, sizeof(copy));
+    ct_test(pTest, ack_data.object_count == 5);
+    ct_test(pTest, ack_data.property_count == 22);
+    ct_test(pTest, ack_data.value_count == (4 * (3 + 16)) + 1);
+    ct_test(pTest, arena.block_count == 1);
+    rpm_object = ack_data.objects;
+    for (i = 0; i < 4; i++) {
+        ct_test(pTest, rpm_object != NULL);
+        ct_test(pTest, rpm_object->object_type == OBJECT_ANALOG_VALUE);
+        ct_test(pTest, rpm_object->object_instance == i);
+        rpm_property = rpm_object->listOfProperties;
+        ct_test(pTest, rpm_property->propertyIdentifier == PROP_PRESENT_VALUE);
+        ct_test(pTest, rpm_property->propertyArrayIndex == BACNET_ARRAY_ALL);
+        value = rpm_property->value;
+        ct_test(pTest, value->tag == BACNET_APPLICATION_TAG_REAL);
+        ct_test(pTest, value->type.Real == ((float) i + 0.5f));
+        ct_test(pTest, value->next == NULL);
+        rpm_property = rpm_property->next;
+        value = rpm_property->value;
+        ct_test(pTest, value->tag == BACNET_APPLICATION_TAG_BIT_STRING);
+        ct_test(pTest, rpm_ack_value_expand(&ack_data, value,
+                &application_value));
+        ct_test(pTest,
+            bitstring_bit(&application_value.type.Bit_String,
+                STATUS_FLAG_FAULT) == (i & 1));
+        rpm_property = rpm_property->next;
+        value = rpm_property->value;
+        ct_test(pTest, value->tag == BACNET_APPLICATION_TAG_CHARACTER_STRING);
+        ct_test(pTest, rpm_ack_value_expand(&ack_data, value,
+                &application_value));
+        sprintf((char *) value_buffer, "AV-%u", i);
+        ct_test(pTest,
+            characterstring_ansi_same(&application_value.type.
+                Character_String, (char *) value_buffer));
+        rpm_property = rpm_property->next;
+        ct_test(pTest, rpm_property->propertyIdentifier == PROP_DEADBAND);
+        ct_test(pTest, rpm_property->value == NULL);
+        ct_test(pTest, rpm_property->error_present);
+        ct_test(pTest, rpm_property->error.error_class ==
+            ERROR_CLASS_PROPERTY);
+        ct_test(pTest, rpm_property->error.error_code ==
+            ERROR_CODE_UNKNOWN_PROPERTY);
+        rpm_property = rpm_property->next;
+        value = rpm_property->value;
+        for (len = 0; len < BACNET_MAX_PRIORITY; len++) {
+            ct_test(pTest, value != NULL);
+            if (len == 7) {
+                ct_test(pTest, value->tag == BACNET_APPLICATION_TAG_REAL);
+                ct_test(pTest, value->type.Real == 42.0f);
+            } else {
+                ct_test(pTest, value->tag == BACNET_APPLICATION_TAG_NULL);
+            }
+            value = value->next;
+        }
+        ct_test(pTest, value == NULL);
+        ct_test(pTest, rpm_property->next == NULL);
+        rpm_object = rpm_object->next;
+    }
+    ct_test(pTest, rpm_object->object_type == OBJECT_DEVICE);
+    rpm_property = rpm_object->listOfProperties;
+    value = rpm_property->value;
+    /* constructed data is kept encoded */
+    ct_test(pTest, value->context_specific);
+    ct_test(pTest, value->context_tag == 1);
+    ct_test(pTest, value->tag == MAX_BACNET_APPLICATION_TAG);
+    ct_test(pTest, value->type.Octets.length == 4);
+    ct_test(pTest, memcmp(&ack_data.service_data[value->type.Octets.offset],
+            &apdu[value->type.Octets.offset], 4) == 0);
+    ct_test(pTest, !rpm_ack_value_expand(&ack_data, value,
+            &application_value));
+    rpm_property = rpm_property->next;
+    ct_test(pTest, rpm_property->value == NULL);
+    ct_test(pTest, !rpm_property->error_present);
+    ct_test(pTest, rpm_object->next == NULL);
+    arena_free(&arena);
+
+    /* pull single values out of the ACK */
+    ct_test(pTest, rpm_ack_value_find(&apdu[0], apdu_len,
+            OBJECT_ANALOG_VALUE, 2, PROP_OBJECT_NAME, BACNET_ARRAY_ALL,
+            &cursor));
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_is_application(&tag,
+            BACNET_APPLICATION_TAG_CHARACTER_STRING));
+    ct_test(pTest, bactag_character_string(&tag, &char_string));
+    ct_test(pTest, characterstring_ansi_same(&char_string, "AV-2"));
+    ct_test(pTest, bactag_cursor_end(&cursor));
+    ct_test(pTest, rpm_ack_value_find(&apdu[0], apdu_len,
+            OBJECT_ANALOG_VALUE, 3, PROP_PRIORITY_ARRAY, BACNET_ARRAY_ALL,
+            &cursor));
+    for (i = 0; i < 7; i++) {
+        ct_test(pTest, bactag_skip(&cursor));
+    }
+    ct_test(pTest, bactag_next(&cursor, &tag));
+    ct_test(pTest, bactag_real(&tag, &real_value));
+    ct_test(pTest, real_value == 42.0f);
+    /* an error, a missing property, and a missing object */
+    ct_test(pTest, !rpm_ack_value_find(&apdu[0], apdu_len,
+            OBJECT_ANALOG_VALUE, 3, PROP_DEADBAND, BACNET_ARRAY_ALL,
+            &cursor));
+    ct_test(pTest, !rpm_ack_value_find(&apdu[0], apdu_len,
+            OBJECT_ANALOG_VALUE, 3, PROP_UNITS, BACNET_ARRAY_ALL, &cursor));
+    ct_test(pTest, !rpm_ack_value_find(&apdu[0], apdu_len,
+            OBJECT_ANALOG_VALUE, 7, PROP_OBJECT_NAME, BACNET_ARRAY_ALL,
+            &cursor));
+    ct_test(pTest, rpm_ack_value_find(&apdu[0], apdu_len, OBJECT_DEVICE,
+            1234, PROP_ACTIVE_COV_SUBSCRIPTIONS, BACNET_ARRAY_ALL, &cursor));
+    ct_test(pTest, bactag_cursor_end(&cursor));
+    for (i = 1; i < (unsigned) apdu_len; i++) {
+        /* never reads beyond a truncated ACK */
+        bactag_cursor_init(&cursor, NULL, 0);
+        (void) rpm_ack_value_find(&apdu[0], i, OBJECT_DEVICE, 1234,
+            PROP_ACTIVE_COV_SUBSCRIPTIONS, BACNET_ARRAY_ALL, &cursor);
+        ct_test(pTest, (cursor.apdu_len == 0) ||
+            ((cursor.apdu + cursor.apdu_len) <= &apdu[i]));
+    }
+
+    /* every truncation of the ACK is an error, except at the end
+       of an object, where it is a shorter ACK */
+    for (i = 1; i < (unsigned) apdu_len; i++) {
+        arena_init(&arena, 0);
+        memcpy(copy, apdu, i);
+        test_len = rpm_ack_decode_compact(&copy[0], i, true, &arena,
+            &ack_data);
+        if (decode_is_closing_tag_number(&apdu[i - 1], 1) &&
+            (apdu[i] == 0x0C)) {
+            ct_test(pTest, test_len == (int) i);
+        } else {
+            ct_test(pTest, test_len == BACNET_STATUS_ERROR);
+        }
+        arena_free(&arena);
+    }
+}
+
+/* decoded the way that h_rpm_a.c decodes into BACNET_READ_ACCESS_DATA */
+static unsigned long Bench_Allocations;
+static unsigned long Bench_Bytes;
+
+static void *rpm_ack_bench_calloc(
+    size_t size)
+{
+    Bench_Allocations++;
+    Bench_Bytes += size;
+    return calloc(1, size);
+}
+
+static unsigned rpm_ack_bench_linked_list(
+    uint8_t * apdu,
+    unsigned apdu_len)
+{
+    unsigned offset = 0;
+    int len = 0;
+    unsigned values = 0;
+    BACNET_READ_ACCESS_DATA *head = NULL;
+    BACNET_READ_ACCESS_DATA **object_tail = &head;
+    BACNET_READ_ACCESS_DATA *rpm_object;
+    BACNET_PROPERTY_REFERENCE **property_tail;
+    BACNET_PROPERTY_REFERENCE *rpm_property;
+    BACNET_APPLICATION_DATA_VALUE **value_tail;
+    BACNET_APPLICATION_DATA_VALUE *value;
+    void *old;
+
+    while (offset < apdu_len) {
+        rpm_object = rpm_ack_bench_calloc(sizeof(BACNET_READ_ACCESS_DATA));
+        *object_tail = rpm_object;
+        object_tail = &rpm_object->next;
+        offset +=
+            rpm_ack_decode_object_id(&apdu[offset], apdu_len - offset,
+            &rpm_object->object_type, &rpm_object->object_instance);
+        property_tail = &rpm_object->listOfProperties;
+        while (!rpm_ack_decode_object_end(&apdu[offset], apdu_len - offset)) {
+            rpm_property =
+                rpm_ack_bench_calloc(sizeof(BACNET_PROPERTY_REFERENCE));
+            *property_tail = rpm_property;
+            property_tail = &rpm_property->next;
+            offset +=
+                rpm_ack_decode_object_property(&apdu[offset],
+                apdu_len - offset, &rpm_property->propertyIdentifier,
+                &rpm_property->propertyArrayIndex);
+            if (decode_is_opening_tag_number(&apdu[offset], 5)) {
+                /* the errors are the same in both, skip them */
+                offset += 6;
+                continue;
+            }
+            offset++;
+            value_tail = &rpm_property->value;
+            while (!decode_is_closing_tag_number(&apdu[offset], 4)) {
+                value =
+                    rpm_ack_bench_calloc(sizeof
+                    (BACNET_APPLICATION_DATA_VALUE));
+                *value_tail = value;
+                value_tail = &value->next;
+                len =
+                    bacapp_decode_application_data(&apdu[offset],
+                    apdu_len - offset, value);
+                offset += len;
+                values++;
+            }
+            offset++;
+        }
+        offset++;
+    }
+    /* free it all */
+    while (head) {
+        while (head->listOfProperties) {
+            rpm_property = head->listOfProperties;
+            while (rpm_property->value) {
+                old = rpm_property->value;
+                rpm_property->value = rpm_property->value->next;
+                free(old);
+            }
+            head->listOfProperties = rpm_property->next;
+            free(rpm_property);
+        }
+        old = head;
+        head = head->next;
+        free(old);
+    }
+
+    return values;
+}
+
+static double rpm_ack_bench_seconds(
+    clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* decodes the largest ACK that fits in MAX_APDU with each method */
+static void rpm_ack_benchmark(
+    unsigned long iterations)
+{
+    uint8_t apdu[MAX_APDU] = { 0 };
+    int apdu_len = 0;
+    unsigned long i = 0;
+    unsigned long values = 0;
+    clock_t start;
+    double seconds = 0.0;
+    ARENA arena;
+    BACNET_RPM_ACK_DATA ack_data;
+
+    apdu_len = rpm_ack_test_encode(&apdu[0], MAX_APDU);
+    printf("RPM-ACK of %d octets, %lu iterations\n", apdu_len, iterations);
+    printf("%-26s %12s %12s %10s\n", "method", "allocs/value",
+        "bytes/value", "ns/value");
+    /* a linked list of calloc()'d BACNET_APPLICATION_DATA_VALUE */
+    Bench_Allocations = 0;
+    Bench_Bytes = 0;
+    values = 0;
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        values += rpm_ack_bench_linked_list(&apdu[0], apdu_len);
+    }
+    seconds = rpm_ack_bench_seconds(start);
+    printf("%-26s %12.3f %12.1f %10.1f\n", "calloc linked list",
+        (double) Bench_Allocations / values, (double) Bench_Bytes / values,
+        (seconds * 1e9) / values);
+    /* compact values in an arena that is freed per ACK */
+    Bench_Allocations = 0;
+    Bench_Bytes = 0;
+    values = 0;
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        arena_init(&arena, 0);
+        rpm_ack_decode_compact(&apdu[0], apdu_len, true, &arena, &ack_data);
+        values += ack_data.value_count;
+        Bench_Allocations += arena.block_count;
+        Bench_Bytes += arena.bytes_reserved;
+        arena_free(&arena);
+    }
+    seconds = rpm_ack_bench_seconds(start);
+    printf("%-26s %12.3f %12.1f %10.1f\n", "compact, arena per ACK",
+        (double) Bench_Allocations / values, (double) Bench_Bytes / values,
+        (seconds * 1e9) / values);
+    /* compact values in an arena that is reset per ACK */
+    Bench_Bytes = 0;
+    values = 0;
+    arena_init(&arena, 0);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        arena_reset(&arena);
+        rpm_ack_decode_compact(&apdu[0], apdu_len, true, &arena, &ack_data);
+        values += ack_data.value_count;
+        Bench_Bytes += arena.bytes_used;
+    }
+    seconds = rpm_ack_bench_seconds(start);
+    printf("%-26s %12.3f %12.1f %10.1f\n", "compact, arena reused",
+        (double) arena.block_count / values, (double) Bench_Bytes / values,
+        (seconds * 1e9) / values);
+    arena_free(&arena);
+}
+
+#ifdef TEST_RPM_ACK
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    unsigned long iterations = 2000;
+
+    pTest = ct_create("BACnet RPM-ACK Compact", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testArena);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testRPMAckCompact);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    rpm_ack_benchmark(iterations);
+
+    return 0;
+}
+#endif /* TEST_RPM_ACK */
+#endif /* TEST */
@@ -0,0 +1,637 @@
+/**************************************************************************
+*
+* Copyright (C) 2016 Steve Karg <skarg@users.sourceforge.net>
+*
+* Permission is hereby granted, free of charge, to any person obtaining
+* a copy of this software and associated documentation files (the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to
+* permit persons to whom the Software is furnished to do so, subject to
+* the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*
+*********************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "bacenum.h"
+#include "bacstr.h"
+#include "strpool.h"
+
+/** @file strpool.c  Pool of interned strings */
+
+/* slots of the hash index of the pool; strings that find no free slot
+   are still interned, only without being shared */
+#define STRPOOL_INDEX_SIZE ((MAX_STRING_POOL / 8) + 1)
+
+/* Each string is a two octet reference count, its length octet, its
+   characters and a NUL, and its handle is the offset of the length.
+   The empty string is the first one, at handle zero, and is not
+   counted.  A string whose count drops to zero leaves a hole, which
+   holds its size and the offset of the next hole. */
+#define STRPOOL_OVERHEAD 4
+#define STRPOOL_HOLE_MIN (STRPOOL_OVERHEAD + 1)
+#define STRPOOL_COUNT_MAX 0xFFFF
+static uint8_t String_Pool[MAX_STRING_POOL];
+static size_t String_Pool_Used = 2;
+/* offset of the first hole, in order of offset, or zero for none */
+static size_t String_Pool_Holes;
+/* octets in the holes */
+static size_t String_Pool_Free;
+/* handles of the interned strings, hashed; zero is a free slot */
+static BACNET_STRING_HANDLE String_Index[STRPOOL_INDEX_SIZE];
+
+static uint32_t strpool_hash(
+    const char *value,
+    size_t length)
+{
+    uint32_t hash = 2166136261UL;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        hash ^= (uint8_t) value[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+static size_t strpool_get16(
+    size_t offset)
+{
+    return String_Pool[offset] | ((size_t) String_Pool[offset + 1] << 8);
+}
+
+static void strpool_set16(
+    size_t offset,
+    size_t value)
+{
+    String_Pool[offset] = (uint8_t) value;
+    String_Pool[offset + 1] = (uint8_t) (value >> 8);
+}
+
+/* the index slot a string is hashed to */
+static uint32_t strpool_home(
+    BACNET_STRING_HANDLE handle)
+{
+    return strpool_hash((const char *) &String_Pool[handle + 1],
+        String_Pool[handle]) % STRPOOL_INDEX_SIZE;
+}
+
+/* take a string out of the index, moving back the strings after it
+   that were hashed to its slot or before, so that none is lost */
+static void strpool_unindex(
+    BACNET_STRING_HANDLE handle)
+{
+    uint32_t slot = strpool_home(handle);
+    uint32_t next = 0;
+    uint32_t home = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i < STRPOOL_INDEX_SIZE; i++) {
+        if (String_Index[slot] == 0) {
+            /* not shared */
+            return;
+        }
+        if (String_Index[slot] == handle) {
+            break;
+        }
+        slot = (slot + 1) % STRPOOL_INDEX_SIZE;
+    }
+    if (i == STRPOOL_INDEX_SIZE) {
+        return;
+    }
+    next = slot;
+    for (;;) {
+        next = (next + 1) % STRPOOL_INDEX_SIZE;
+        if (String_Index[next] == 0) {
+            break;
+        }
+        home = strpool_home(String_Index[next]);
+        /* can the string at next move back to slot? */
+        if ((slot <= next) ? ((home <= slot) ||
+                (home > next)) : ((home <= slot) && (home > next))) {
+            String_Index[slot] = String_Index[next];
+            slot = next;
+        }
+    }
+    String_Index[slot] = 0;
+}
+
+/* find room for a string of size octets: the first hole it fits in,
+   or the end of the pool */
+static size_t strpool_alloc(
+    size_t size)
+{
+    size_t hole = String_Pool_Holes;
+    size_t prev = 0;
+    size_t hole_size = 0;
+    size_t next = 0;
+
+    while (hole) {
+        hole_size = strpool_get16(hole);
+        next = strpool_get16(hole + 2);
+        if ((hole_size == size) || (hole_size >= (size + STRPOOL_HOLE_MIN))) {
+            if (hole_size > size) {
+                /* the rest stays a hole */
+                strpool_set16(hole + size, hole_size - size);
+                strpool_set16(hole + size + 2, next);
+                next = hole + size;
+            }
+            if (prev) {
+                strpool_set16(prev + 2, next);
+            } else {
+                String_Pool_Holes = next;
+            }
+            String_Pool_Free -= size;
+            return hole;
+        }
+        prev = hole;
+        hole = next;
+    }
+    if ((String_Pool_Used + size) > MAX_STRING_POOL) {
+        return 0;
+    }
+    hole = String_Pool_Used;
+    String_Pool_Used += size;
+
+    return hole;
+}
+
+/* return the octets of a string to the pool, joining the holes next to
+   it, and giving back the end of the pool */
+static void strpool_free(
+    size_t offset,
+    size_t size)
+{
+    size_t hole = String_Pool_Holes;
+    size_t prev = 0;
+
+    while (hole && (hole < offset)) {
+        prev = hole;
+        hole = strpool_get16(hole + 2);
+    }
+    String_Pool_Free += size;
+    if (hole && ((offset + size) == hole)) {
+        size += strpool_get16(hole);
+        hole = strpool_get16(hole + 2);
+    }
+    if (prev && ((prev + strpool_get16(prev)) == offset)) {
+        offset = prev;
+        size += strpool_get16(prev);
+    } else if (prev) {
+        strpool_set16(prev + 2, offset);
+    } else {
+        String_Pool_Holes = offset;
+    }
+    if ((offset + size) == String_Pool_Used) {
+        /* the last hole: the end of the pool moves back */
+        String_Pool_Used = offset;
+        String_Pool_Free -= size;
+        if (prev == offset) {
+            /* find the hole before it, now the last one */
+            prev = 0;
+            hole = String_Pool_Holes;
+            while (hole != offset) {
+                prev = hole;
+                hole = strpool_get16(hole + 2);
+            }
+        }
+        if (prev) {
+            strpool_set16(prev + 2, 0);
+        } else {
+            String_Pool_Holes = 0;
+        }
+    } else {
+        strpool_set16(offset, size);
+        strpool_set16(offset + 2, hole);
+    }
+}
+
+/** Empty the pool.  Every handle except zero becomes invalid. */
+void strpool_init(
+    void)
+{
+    memset(String_Index, 0, sizeof(String_Index));
+    String_Pool[0] = 0;
+    String_Pool[1] = 0;
+    String_Pool_Used = 2;
+    String_Pool_Holes = 0;
+    String_Pool_Free = 0;
+}
+
+/** Drop a reference to an interned string.  The string leaves the pool
+ * with its last reference.
+ *
+ * @param handle - handle of the string
+ */
+void strpool_release(
+    BACNET_STRING_HANDLE handle)
+{
+    size_t count = 0;
+
+    if ((handle == 0) || (handle >= String_Pool_Used)) {
+        return;
+    }
+    count = strpool_get16(handle - 2);
+    if (count == STRPOOL_COUNT_MAX) {
+        /* too many references to count: kept for good */
+        return;
+    }
+    if (count > 1) {
+        strpool_set16(handle - 2, count - 1);
+        return;
+    }
+    strpool_unindex(handle);
+    strpool_free(handle - 2, String_Pool[handle] + STRPOOL_OVERHEAD);
+}
+
+/** Intern a string, and refer to it from a handle.  The string that the
+ * handle referred to is released, so that a rename frees the old name.
+ *
+ * @param value - the characters, which may not include a NUL
+ * @param length - number of characters, up to STRPOOL_STRING_MAX
+ * @param handle - the handle of the string, which holds zero or the
+ *  handle of a string that it referred to
+ * @return true if the string is in the pool, false if it is too long,
+ *  includes a NUL, or does not fit, leaving the handle as it was
+ */
+bool strpool_intern(
+    const char *value,
+    size_t length,
+    BACNET_STRING_HANDLE * handle)
+{
+    uint32_t slot = 0;
+    uint32_t i = 0;
+    size_t offset = 0;
+    size_t count = 0;
+    BACNET_STRING_HANDLE index_handle = 0;
+    BACNET_STRING_HANDLE *free_slot = NULL;
+
+    if (!handle) {
+        return false;
+    }
+    if (length == 0) {
+        strpool_release(*handle);
+        *handle = 0;
+        return true;
+    }
+    if ((!value) || (length > STRPOOL_STRING_MAX) ||
+        memchr(value, 0, length)) {
+        return false;
+    }
+    slot = strpool_hash(value, length) % STRPOOL_INDEX_SIZE;
+    for (i = 0; i < STRPOOL_INDEX_SIZE; i++) {
+        index_handle = String_Index[slot];
+        if (index_handle == 0) {
+            free_slot = &String_Index[slot];
+            break;
+        }
+        if ((String_Pool[index_handle] == length) &&
+            (memcmp(&String_Pool[index_handle + 1], value, length) == 0)) {
+            count = strpool_get16(index_handle - 2);
+            if (count < STRPOOL_COUNT_MAX) {
+                strpool_set16(index_handle - 2, count + 1);
+            }
+            strpool_release(*handle);
+            *handle = index_handle;
+            return true;
+        }
+        slot++;
+        if (slot == STRPOOL_INDEX_SIZE) {
+            slot = 0;
+        }
+    }
+    offset = strpool_alloc(length + STRPOOL_OVERHEAD);
+    if (offset == 0) {
+        return false;
+    }
+    strpool_set16(offset, 1);
+    String_Pool[offset + 2] = (uint8_t) length;
+    memcpy(&String_Pool[offset + 3], value, length);
+    String_Pool[offset + 3 + length] = 0;
+    if (free_slot) {
+        *free_slot = (BACNET_STRING_HANDLE) (offset + 2);
+    }
+    strpool_release(*handle);
+    *handle = (BACNET_STRING_HANDLE) (offset + 2);
+
+    return true;
+}
+
+/** Intern a NUL terminated string.
+ *
+ * @param value - the string, or NULL for the empty string
+ * @param handle - where the handle of the string goes
+ * @return true if the string is in the pool
+ */
+bool strpool_intern_ansi(
+    const char *value,
+    BACNET_STRING_HANDLE * handle)
+{
+    return strpool_intern(value, value ? strlen(value) : 0, handle);
+}
+
+/** Intern the value of a character string.
+ *
+ * @param char_string - an ANSI X3.4 / UTF-8 character string
+ * @param handle - where the handle of the string goes
+ * @return true if the string is in the pool, false if it has another
+ *  encoding or does not fit
+ */
+bool strpool_intern_characterstring(
+    BACNET_CHARACTER_STRING * char_string,
+    BACNET_STRING_HANDLE * handle)
+{
+    if (char_string && (characterstring_encoding(char_string) ==
+            CHARACTER_UTF8)) {
+        return strpool_intern(characterstring_value(char_string),
+            characterstring_length(char_string), handle);
+    }
+
+    return false;
+}
+
+/** The NUL terminated characters of an interned string.
+ *
+ * @param handle - handle of the string
+ * @return the characters, which may not be changed
+ */
+const char *strpool_string(
+    BACNET_STRING_HANDLE handle)
+{
+    if (handle >= String_Pool_Used) {
+        handle = 0;
+    }
+
+    return (const char *) &String_Pool[handle + 1];
+}
+
+/** The length of an interned string.
+ *
+ * @param handle - handle of the string
+ * @return number of characters
+ */
+size_t strpool_length(
+    BACNET_STRING_HANDLE handle)
+{
+    if (handle >= String_Pool_Used) {
+        handle = 0;
+    }
+
+    return String_Pool[handle];
+}
+
+/** Initialize a character string with an interned string.
+ *
+ * @param char_string - the character string to initialize
+ * @param handle - handle of the string
+ * @return true if the character string was initialized
+ */
+bool strpool_characterstring(
+    BACNET_CHARACTER_STRING * char_string,
+    BACNET_STRING_HANDLE handle)
+{
+    return characterstring_init(char_string, CHARACTER_UTF8,
+        strpool_string(handle), strpool_length(handle));
+}
+
+/** Number of octets of the pool in use.
+ *
+ * @return octets used, of MAX_STRING_POOL
+ */
+size_t strpool_used(
+    void)
+{
+    return String_Pool_Used - String_Pool_Free;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ctest.h"
+
+void testStringPool(
+    Test * pTest)
+{
+    BACNET_STRING_HANDLE handle = 0;
+    BACNET_STRING_HANDLE other = 0;
+    BACNET_STRING_HANDLE names[64];
+    char copies[64][48];
+    BACNET_CHARACTER_STRING char_string;
+    char text[STRPOOL_STRING_MAX + 2];
+    size_t used = 0;
+    unsigned i = 0;
+    unsigned j = 0;
+    bool interned = false;
+
+    strpool_init();
+    ct_test(pTest, strpool_used() == 2);
+    /* the empty string is handle zero */
+    ct_test(pTest, strpool_length(0) == 0);
+    ct_test(pTest, strcmp(strpool_string(0), "") == 0);
+    ct_test(pTest, strpool_intern_ansi("", &handle));
+    ct_test(pTest, handle == 0);
+    ct_test(pTest, strpool_intern_ansi(NULL, &handle));
+    ct_test(pTest, handle == 0);
+    /* equal strings share a handle */
+    ct_test(pTest, strpool_intern_ansi("ANALOG INPUT 1", &handle));
+    ct_test(pTest, handle != 0);
+    ct_test(pTest, strpool_length(handle) == 14);
+    ct_test(pTest, strcmp(strpool_string(handle), "ANALOG INPUT 1") == 0);
+    used = strpool_used();
+    ct_test(pTest, strpool_intern("ANALOG INPUT 1", 14, &other));
+    ct_test(pTest, other == handle);
+    ct_test(pTest, strpool_used() == used);
+    ct_test(pTest, strpool_intern("ANALOG INPUT 12", 14, &other));
+    ct_test(pTest, other == handle);
+    ct_test(pTest, strpool_intern_ansi("ANALOG INPUT 12", &other));
+    ct_test(pTest, other != handle);
+    ct_test(pTest, strcmp(strpool_string(other), "ANALOG INPUT 12") == 0);
+    /* to and from character strings */
+    ct_test(pTest, strpool_characterstring(&char_string, handle));
+    ct_test(pTest, characterstring_ansi_same(&char_string,
+            "ANALOG INPUT 1"));
+    ct_test(pTest, strpool_intern_characterstring(&char_string, &other));
+    ct_test(pTest, other == handle);
+    /* the other handle no longer refers to ANALOG INPUT 12 */
+    ct_test(pTest, strpool_used() == used);
+    characterstring_init(&char_string, CHARACTER_UCS2, "AB", 2);
+    ct_test(pTest, strpool_intern_characterstring(&char_string,
+            &other) == false);
+    ct_test(pTest, other == handle);
+    /* strings that can't be interned */
+    ct_test(pTest, strpool_intern("A\0B", 3, &other) == false);
+    memset(text, 'A', sizeof(text));
+    ct_test(pTest, strpool_intern(text, STRPOOL_STRING_MAX + 1,
+            &other) == false);
+    ct_test(pTest, other == handle);
+    /* released with the last reference */
+    strpool_release(other);
+    ct_test(pTest, strpool_used() == used);
+    ct_test(pTest, strcmp(strpool_string(handle), "ANALOG INPUT 1") == 0);
+    strpool_release(handle);
+    ct_test(pTest, strpool_used() == 2);
+
+    /* renames reuse the pool, however many there are */
+    strpool_init();
+    memset(names, 0, sizeof(names));
+    for (i = 0; i < 64; i++) {
+        sprintf(text, "OBJECT %u", i);
+        ct_test(pTest, strpool_intern_ansi(text, &names[i]));
+    }
+    used = strpool_used();
+    interned = true;
+    for (i = 0; interned && (i < 100000); i++) {
+        /* names of different lengths, to leave holes of all sizes */
+        sprintf(text, "RENAMED %0*u", (int) (1 + (i % 7)), i);
+        interned = strpool_intern_ansi(text, &names[(i * 7) % 64]);
+    }
+    ct_test(pTest, interned);
+    for (i = 0; i < 64; i++) {
+        sprintf(text, "OBJECT %u", i);
+        ct_test(pTest, strpool_intern_ansi(text, &names[i]));
+    }
+    ct_test(pTest, strpool_used() == used);
+    for (i = 0; i < 64; i++) {
+        sprintf(text, "OBJECT %u", i);
+        ct_test(pTest, strcmp(strpool_string(names[i]), text) == 0);
+        strpool_release(names[i]);
+    }
+    ct_test(pTest, strpool_used() == 2);
+
+    /* random renames, shared or not, checked against copies */
+    srand(1);
+    memset(names, 0, sizeof(names));
+    memset(copies, 0, sizeof(copies));
+    for (i = 0; i < 20000; i++) {
+        j = rand() % 64;
+        sprintf(text, "N%u %.*s", (unsigned) (rand() % 100),
+            (int) (rand() % 30), "0123456789ABCDEFGHIJKLMNOPQRST");
+        ct_test(pTest, strpool_intern_ansi(text, &names[j]));
+        strcpy(copies[j], text);
+        if ((i % 100) == 0) {
+            for (j = 0; j < 64; j++) {
+                ct_test(pTest, strcmp(strpool_string(names[j]),
+                        copies[j]) == 0);
+            }
+        }
+    }
+    for (i = 0; i < 64; i++) {
+        strpool_release(names[i]);
+    }
+    ct_test(pTest, strpool_used() == 2);
+
+    /* until the pool is full */
+    memset(text, 'A', sizeof(text));
+    handle = 0;
+    ct_test(pTest, strpool_intern(text, STRPOOL_STRING_MAX, &handle));
+    ct_test(pTest, strpool_length(handle) == STRPOOL_STRING_MAX);
+    used = 0;
+    interned = true;
+    while (interned &&
+        (strpool_used() + STRPOOL_OVERHEAD + 16 <= MAX_STRING_POOL)) {
+        sprintf(text, "%016lu", (unsigned long) used);
+        other = 0;
+        interned = strpool_intern_ansi(text, &other);
+        used++;
+    }
+    ct_test(pTest, interned);
+    used = strpool_used();
+    other = 0;
+    ct_test(pTest, strpool_intern_ansi("0123456789ABCDEF", &other) == false);
+    ct_test(pTest, other == 0);
+    ct_test(pTest, strpool_used() == used);
+    ct_test(pTest, strpool_intern_ansi("0000000000000000", &other));
+    ct_test(pTest, strpool_used() == used);
+    /* a freed string makes room */
+    strpool_release(handle);
+    ct_test(pTest, strpool_intern_ansi("0123456789ABCDEF", &handle));
+    /* and empty again */
+    strpool_init();
+    ct_test(pTest, strpool_used() == 2);
+    other = 0;
+    ct_test(pTest, strpool_intern_ansi("ANALOG INPUT 1", &other));
+    ct_test(pTest, other == 4);
+}
+
+#ifdef TEST_STRPOOL
+/* names and descriptions of a set of objects, in 64 octet buffers and
+   in the pool */
+static void strpool_benchmark(
+    unsigned objects,
+    unsigned descriptions)
+{
+    BACNET_STRING_HANDLE *handles = NULL;
+    char text[64];
+    unsigned i = 0;
+    clock_t start;
+    double seconds = 0.0;
+
+    handles = calloc(objects * 2, sizeof(BACNET_STRING_HANDLE));
+    if (!handles) {
+        return;
+    }
+    strpool_init();
+    start = clock();
+    for (i = 0; i < objects; i++) {
+        sprintf(text, "AHU-%u ZONE TEMP %u", i / 20, i);
+        (void) strpool_intern_ansi(text, &handles[i * 2]);
+        sprintf(text, "ZONE TEMPERATURE SENSOR %u", i % descriptions);
+        (void) strpool_intern_ansi(text, &handles[(i * 2) + 1]);
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%u objects, %u different descriptions\n", objects,
+        descriptions);
+    printf("%-16s %10lu octets\n", "fixed buffers",
+        (unsigned long) objects * 2 * 64);
+    printf("%-16s %10lu octets (%lu in handles), %.1f ns/intern\n",
+        "string pool",
+        (unsigned long) strpool_used(),
+        (unsigned long) objects * 2 * sizeof(BACNET_STRING_HANDLE),
+        (seconds * 1e9) / (objects * 2));
+    free(handles);
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    Test *pTest;
+    bool rc;
+    unsigned long objects = 1000;
+
+    pTest = ct_create("String Pool", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testStringPool);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    if (argc > 1) {
+        objects = strtoul(argv[1], NULL, 0);
+    }
+    strpool_benchmark(objects, 10);
+
+    return 0;
+}
+#endif /* TEST_STRPOOL */
+#endif /* TEST */
@@ -35,11 +35,13 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "bits.h"
 #include "apdu.h"
 #include "bacdef.h"
 #include "bacdcode.h"
 #include "bacenum.h"
+#include "abort.h"
 #include "tsm.h"
 #include "config.h"
 #include "datalink.h"
@@ -55,8 +57,6 @@
 /* If we are only a server and only initiate broadcasts, */
 /* then we don't need a TSM layer. */
 
-/* FIXME: not coded for segmentation */
-
 /* declare space for the TSM transactions, and set it up in the init. */
 /* table rules: an Invoke ID = 0 is an unused spot in the table */
 static BACNET_TSM_DATA TSM_List[MAX_TSM_TRANSACTIONS];
@@ -259,6 +259,495 @@ bool tsm_get_transaction_pdu(
     return found;
 }
 
+#if MAX_SEGMENTS
+/* buffers that each hold a whole segmented message */
+static uint8_t Segment_Buffer[MAX_SEGMENT_BUFFERS][TSM_SEGMENT_BUFFER_SIZE];
+static bool Segment_Buffer_Used[MAX_SEGMENT_BUFFERS];
+/* transactions where we are the server sending a segmented ComplexACK.
+   These are keyed by the peer address and the invoke ID of the peer,
+   and there can be no more of them than there are segment buffers. */
+static BACNET_TSM_DATA TSM_Server_List[MAX_SEGMENT_BUFFERS];
+
+/** Claim a buffer large enough for a whole segmented message.
+ * @return pointer to TSM_SEGMENT_BUFFER_SIZE octets, or NULL if none free
+ */
+uint8_t *tsm_segment_buffer_claim(
+    void)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        if (!Segment_Buffer_Used[i]) {
+            Segment_Buffer_Used[i] = true;
+            return &Segment_Buffer[i][0];
+        }
+    }
+
+    return NULL;
+}
+
+/** Return a buffer from tsm_segment_buffer_claim() to the pool.
+ * @param buffer [in] the claimed buffer, or NULL
+ */
+void tsm_segment_buffer_release(
+    uint8_t * buffer)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        if (buffer == &Segment_Buffer[i][0]) {
+            Segment_Buffer_Used[i] = false;
+            break;
+        }
+    }
+}
+
+/* service data octets in each segment sent to a peer with this max APDU */
+static unsigned tsm_segment_size(
+    int max_resp)
+{
+    unsigned segment_apdu = MAX_APDU;
+
+    if ((max_resp > 0) && (max_resp < MAX_APDU)) {
+        segment_apdu = (unsigned) max_resp;
+    }
+
+    /* PDU type, invoke ID, sequence number, window size, service choice */
+    return segment_apdu - 5;
+}
+
+/* true if sequence_number is within the window starting at initial */
+static bool tsm_in_window(
+    uint8_t sequence_number,
+    uint8_t initial,
+    uint8_t window)
+{
+    return ((uint8_t) (sequence_number - initial) < window);
+}
+
+static int segment_ack_encode_apdu(
+    uint8_t * apdu,
+    bool negative,
+    bool server,
+    uint8_t invoke_id,
+    uint8_t sequence_number,
+    uint8_t window)
+{
+    apdu[0] = PDU_TYPE_SEGMENT_ACK;
+    if (negative) {
+        apdu[0] |= BIT(1);
+    }
+    if (server) {
+        apdu[0] |= BIT(0);
+    }
+    apdu[1] = invoke_id;
+    apdu[2] = sequence_number;
+    apdu[3] = window;
+
+    return 4;
+}
+
+/* send a SegmentACK or Abort for the segmented ComplexACK we are receiving */
+static void tsm_segment_reply_send(
+    BACNET_ADDRESS * dest,
+    BACNET_TSM_DATA * tsm,
+    bool negative,
+    bool abort)
+{
+    uint8_t pdu[MAX_NPDU + 4];
+    BACNET_ADDRESS my_address;
+    BACNET_NPDU_DATA npdu_data;
+    int pdu_len = 0;
+
+    datalink_get_my_address(&my_address);
+    npdu_encode_npdu_data(&npdu_data, false, tsm->npdu_data.priority);
+    pdu_len = npdu_encode_pdu(&pdu[0], dest, &my_address, &npdu_data);
+    if (abort) {
+        pdu_len +=
+            abort_encode_apdu(&pdu[pdu_len], tsm->InvokeID,
+            ABORT_REASON_BUFFER_OVERFLOW, false);
+    } else {
+        pdu_len +=
+            segment_ack_encode_apdu(&pdu[pdu_len], negative, false,
+            tsm->InvokeID, tsm->LastSequenceNumber, tsm->ActualWindowSize);
+    }
+    datalink_send_pdu(dest, &npdu_data, &pdu[0], pdu_len);
+}
+
+/* send one segment of the ComplexACK held in the segment buffer */
+static void tsm_segment_send(
+    BACNET_TSM_DATA * tsm,
+    uint8_t sequence_number)
+{
+    BACNET_ADDRESS my_address;
+    uint8_t *pdu = &tsm->apdu[0];
+    unsigned offset = 0;
+    unsigned len = 0;
+    int pdu_len = 0;
+
+    datalink_get_my_address(&my_address);
+    pdu_len =
+        npdu_encode_pdu(&pdu[0], &tsm->dest, &my_address, &tsm->npdu_data);
+    offset = (unsigned) sequence_number *tsm->segment_size;
+    len = tsm->segment_len - offset;
+    pdu[pdu_len] = PDU_TYPE_COMPLEX_ACK | BIT(3);
+    if (len > tsm->segment_size) {
+        len = tsm->segment_size;
+        /* more follows */
+        pdu[pdu_len] |= BIT(2);
+    }
+    pdu_len++;
+    pdu[pdu_len++] = tsm->InvokeID;
+    pdu[pdu_len++] = sequence_number;
+    pdu[pdu_len++] = tsm->ProposedWindowSize;
+    /* service choice from the unsegmented APDU header */
+    pdu[pdu_len++] = tsm->segment_buffer[2];
+    memcpy(&pdu[pdu_len], &tsm->segment_buffer[3 + offset], len);
+    datalink_send_pdu(&tsm->dest, &tsm->npdu_data, &pdu[0], pdu_len + len);
+}
+
+/* FillWindow: send the segments of the window beginning at sequence_number */
+static void tsm_fill_window(
+    BACNET_TSM_DATA * tsm,
+    uint8_t sequence_number)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < tsm->ActualWindowSize; i++) {
+        if ((sequence_number + i) >= tsm->segment_count) {
+            break;
+        }
+        tsm_segment_send(tsm, (uint8_t) (sequence_number + i));
+        if ((sequence_number + i + 1) == tsm->segment_count) {
+            tsm->SentAllSegments = true;
+        }
+    }
+    tsm->SegmentTimer = apdu_segment_timeout();
+}
+
+static void tsm_segment_transaction_free(
+    BACNET_TSM_DATA * tsm)
+{
+    tsm_segment_buffer_release(tsm->segment_buffer);
+    tsm->segment_buffer = NULL;
+    tsm->segment_len = 0;
+}
+
+static BACNET_TSM_DATA *tsm_server_find(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        if ((TSM_Server_List[i].state == TSM_STATE_SEGMENTED_RESPONSE) &&
+            (TSM_Server_List[i].InvokeID == invokeID) &&
+            bacnet_address_same(&TSM_Server_List[i].dest, src)) {
+            return &TSM_Server_List[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void tsm_server_free(
+    BACNET_TSM_DATA * tsm)
+{
+    tsm_segment_transaction_free(tsm);
+    tsm->state = TSM_STATE_IDLE;
+    tsm->InvokeID = 0;
+}
+
+/** Determine the largest ComplexACK, in APDU octets, that can be sent
+ * to the client of this request using segmentation.
+ * @param service_data [in] the decoded header of the confirmed request
+ * @return the APDU length limit, or 0 if the client does not accept
+ *  segmented responses
+ */
+unsigned tsm_segmented_complex_ack_max(
+    BACNET_CONFIRMED_SERVICE_DATA * service_data)
+{
+    unsigned max_segs = MAX_SEGMENTS;
+
+    if (!service_data->segmented_response_accepted) {
+        return 0;
+    }
+    /* zero is an unspecified number of segments */
+    if ((service_data->max_segs > 0) &&
+        ((unsigned) service_data->max_segs < max_segs)) {
+        max_segs = (unsigned) service_data->max_segs;
+    }
+
+    return 3 + (max_segs * tsm_segment_size(service_data->max_resp));
+}
+
+/** Send a ComplexACK too large for the client's max APDU as segments.
+ * SendSegmentedComplexACK: the first segment is sent with a window of one,
+ * and the client's SegmentACKs set the window for the rest.
+ * @param dest [in] the client address
+ * @param npdu_data [in] the network layer info for the reply
+ * @param service_data [in] the decoded header of the confirmed request
+ * @param buffer [in] a buffer from tsm_segment_buffer_claim() holding the
+ *  whole unsegmented ComplexACK APDU.  The TSM releases it when done.
+ * @param apdu_len [in] length of the unsegmented APDU
+ * @return true if the first segment was sent
+ */
+bool tsm_segmented_complex_ack_send(
+    BACNET_ADDRESS * dest,
+    BACNET_NPDU_DATA * npdu_data,
+    BACNET_CONFIRMED_SERVICE_DATA * service_data,
+    uint8_t * buffer,
+    unsigned apdu_len)
+{
+    BACNET_TSM_DATA *tsm = NULL;
+    unsigned segment_size = 0;
+    unsigned segment_count = 0;
+    unsigned i = 0;
+
+    if (apdu_len <= 3) {
+        tsm_segment_buffer_release(buffer);
+        return false;
+    }
+    segment_size = tsm_segment_size(service_data->max_resp);
+    segment_count = ((apdu_len - 3) + segment_size - 1) / segment_size;
+    if (apdu_len > tsm_segmented_complex_ack_max(service_data)) {
+        tsm_segment_buffer_release(buffer);
+        return false;
+    }
+    /* a retried request replaces the response in progress */
+    tsm = tsm_server_find(dest, service_data->invoke_id);
+    if (tsm) {
+        tsm_server_free(tsm);
+    } else {
+        for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+            if (TSM_Server_List[i].state == TSM_STATE_IDLE) {
+                tsm = &TSM_Server_List[i];
+                break;
+            }
+        }
+    }
+    if (!tsm) {
+        tsm_segment_buffer_release(buffer);
+        return false;
+    }
+    tsm->state = TSM_STATE_SEGMENTED_RESPONSE;
+    tsm->InvokeID = service_data->invoke_id;
+    bacnet_address_copy(&tsm->dest, dest);
+    npdu_copy_data(&tsm->npdu_data, npdu_data);
+    tsm->npdu_data.data_expecting_reply = true;
+    tsm->segment_buffer = buffer;
+    tsm->segment_len = apdu_len - 3;
+    tsm->segment_count = (uint8_t) segment_count;
+    tsm->segment_size = (uint16_t) segment_size;
+    tsm->SegmentRetryCount = 0;
+    tsm->SentAllSegments = false;
+    tsm->InitialSequenceNumber = 0;
+    tsm->ActualWindowSize = 1;
+    tsm->ProposedWindowSize = TSM_PROPOSED_WINDOW_SIZE;
+    tsm_fill_window(tsm, 0);
+
+    return true;
+}
+
+/** Handle a SegmentACK from a client for a segmented ComplexACK we send.
+ * @param src [in] the client address
+ * @param apdu [in] the SegmentACK APDU
+ * @param apdu_len [in] length of the APDU
+ */
+void tsm_segment_ack_handler(
+    BACNET_ADDRESS * src,
+    uint8_t * apdu,
+    uint16_t apdu_len)
+{
+    BACNET_TSM_DATA *tsm = NULL;
+    bool negative = false;
+    uint8_t sequence_number = 0;
+    uint8_t window = 0;
+
+    /* acks sent by a server are for segmented requests - not sent by us */
+    if ((apdu_len < 4) || (apdu[0] & BIT(0))) {
+        return;
+    }
+    negative = (apdu[0] & BIT(1)) ? true : false;
+    sequence_number = apdu[2];
+    window = apdu[3];
+    tsm = tsm_server_find(src, apdu[1]);
+    if (!tsm) {
+        return;
+    }
+    if (tsm_in_window(sequence_number, tsm->InitialSequenceNumber,
+            tsm->ActualWindowSize)) {
+        if (tsm->SentAllSegments &&
+            (sequence_number == (tsm->segment_count - 1))) {
+            /* FinalACK */
+            tsm_server_free(tsm);
+            return;
+        }
+        /* NewACK */
+        tsm->InitialSequenceNumber = sequence_number + 1;
+        if (window == 0) {
+            window = 1;
+        } else if (window > TSM_PROPOSED_WINDOW_SIZE) {
+            window = TSM_PROPOSED_WINDOW_SIZE;
+        }
+        tsm->ActualWindowSize = window;
+        tsm->SegmentRetryCount = 0;
+        tsm_fill_window(tsm, tsm->InitialSequenceNumber);
+    } else if (negative &&
+        (sequence_number == (uint8_t) (tsm->InitialSequenceNumber - 1))) {
+        /* the client lost the first segment of the window */
+        tsm_fill_window(tsm, tsm->InitialSequenceNumber);
+    } else {
+        /* DuplicateACK */
+        tsm->SegmentTimer = apdu_segment_timeout();
+    }
+}
+
+/** Handle a segment of a segmented ComplexACK for a request we sent,
+ * reassembling the segments and acknowledging each window.
+ * @param src [in] the server address
+ * @param service_data [in] the decoded ComplexACK header
+ * @param service_request [in,out] the segment service data on entry,
+ *  the whole reassembled service data when complete
+ * @param service_request_len [in,out] length of the service data
+ * @return true when the last segment arrived and the reassembled service
+ *  data is ready; it stays valid until tsm_free_invoke_id()
+ */
+bool tsm_segmented_complex_ack_handler(
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+    uint8_t ** service_request,
+    uint16_t * service_request_len)
+{
+    BACNET_TSM_DATA *tsm = NULL;
+    uint8_t index = 0;
+    uint8_t sequence_number = service_data->sequence_number;
+    uint8_t window = 0;
+    unsigned len = *service_request_len;
+
+    index = tsm_find_invokeID_index(service_data->invoke_id);
+    if ((service_data->invoke_id == 0) || (index >= MAX_TSM_TRANSACTIONS)) {
+        return false;
+    }
+    tsm = &TSM_List[index];
+    if (tsm->state == TSM_STATE_AWAIT_CONFIRMATION) {
+        if (sequence_number != 0) {
+            return false;
+        }
+        window = service_data->proposed_window_number;
+        if (window == 0) {
+            window = 1;
+        } else if (window > TSM_PROPOSED_WINDOW_SIZE) {
+            window = TSM_PROPOSED_WINDOW_SIZE;
+        }
+        tsm->ProposedWindowSize = service_data->proposed_window_number;
+        tsm->ActualWindowSize = window;
+        tsm->segment_buffer = tsm_segment_buffer_claim();
+        tsm->segment_len = 0;
+        if (!tsm->segment_buffer) {
+            /* no room to reassemble: the transaction fails */
+            tsm_segment_reply_send(src, tsm, false, true);
+            tsm->state = TSM_STATE_IDLE;
+            return false;
+        }
+        tsm->state = TSM_STATE_SEGMENTED_CONFIRMATION;
+        tsm->InitialSequenceNumber = 0;
+        tsm->LastSequenceNumber = 0;
+    } else if (tsm->state == TSM_STATE_SEGMENTED_CONFIRMATION) {
+        if (sequence_number != (uint8_t) (tsm->LastSequenceNumber + 1)) {
+            /* SegmentReceivedOutOfOrder */
+            tsm_segment_reply_send(src, tsm, true, false);
+            tsm->InitialSequenceNumber = tsm->LastSequenceNumber;
+            tsm->SegmentTimer = 4 * apdu_segment_timeout();
+            return false;
+        }
+        tsm->LastSequenceNumber = sequence_number;
+    } else {
+        return false;
+    }
+    if ((tsm->segment_len + len) > TSM_SEGMENT_BUFFER_SIZE) {
+        tsm_segment_reply_send(src, tsm, false, true);
+        tsm_segment_transaction_free(tsm);
+        tsm->state = TSM_STATE_IDLE;
+        return false;
+    }
+    memcpy(&tsm->segment_buffer[tsm->segment_len], *service_request, len);
+    tsm->segment_len += len;
+    tsm->SegmentTimer = 4 * apdu_segment_timeout();
+    if (!service_data->more_follows) {
+        /* LastSegmentOfComplexACK_Received */
+        tsm_segment_reply_send(src, tsm, false, false);
+        *service_request = tsm->segment_buffer;
+        *service_request_len = (uint16_t) tsm->segment_len;
+        return true;
+    }
+    if ((sequence_number == 0) ||
+        (sequence_number ==
+            (uint8_t) (tsm->InitialSequenceNumber + tsm->ActualWindowSize))) {
+        /* the first segment, or the last one of the window */
+        tsm_segment_reply_send(src, tsm, false, false);
+        tsm->InitialSequenceNumber = sequence_number;
+    }
+
+    return false;
+}
+
+/** Cancel the segmented ComplexACK we send when the client aborts it.
+ * @param src [in] the client address
+ * @param invokeID [in] the invoke ID of the client request
+ */
+void tsm_abort_segmented_response(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *tsm = NULL;
+
+    tsm = tsm_server_find(src, invokeID);
+    if (tsm) {
+        tsm_server_free(tsm);
+    }
+}
+
+/* segment timers for both the server and client transactions */
+static void tsm_segment_timer_milliseconds(
+    uint16_t milliseconds)
+{
+    BACNET_TSM_DATA *tsm = NULL;
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        tsm = &TSM_Server_List[i];
+        if (tsm->state != TSM_STATE_SEGMENTED_RESPONSE) {
+            continue;
+        }
+        if (tsm->SegmentTimer > milliseconds) {
+            tsm->SegmentTimer -= milliseconds;
+        } else if (tsm->SegmentRetryCount < apdu_retries()) {
+            tsm->SegmentRetryCount++;
+            tsm_fill_window(tsm, tsm->InitialSequenceNumber);
+        } else {
+            tsm_server_free(tsm);
+        }
+    }
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        tsm = &TSM_List[i];
+        if (tsm->state != TSM_STATE_SEGMENTED_CONFIRMATION) {
+            continue;
+        }
+        if (tsm->SegmentTimer > milliseconds) {
+            tsm->SegmentTimer -= milliseconds;
+        } else {
+            /* a failed transaction is IDLE with a valid invoke id */
+            tsm_segment_transaction_free(tsm);
+            tsm->state = TSM_STATE_IDLE;
+            if (Timeout_Function) {
+                Timeout_Function(tsm->InvokeID);
+            }
+        }
+    }
+}
+#endif
+
 /* called once a millisecond or slower */
 void tsm_timer_milliseconds(
     uint16_t milliseconds)
@@ -293,6 +782,9 @@ void tsm_timer_milliseconds(
             }
         }
     }
+#if MAX_SEGMENTS
+    tsm_segment_timer_milliseconds(milliseconds);
+#endif
 }
 
 /* frees the invokeID and sets its state to IDLE */
@@ -303,6 +795,9 @@ void tsm_free_invoke_id(
 
     index = tsm_find_invokeID_index(invokeID);
     if (index < MAX_TSM_TRANSACTIONS) {
+#if MAX_SEGMENTS
+        tsm_segment_transaction_free(&TSM_List[index]);
+#endif
         TSM_List[index].state = TSM_STATE_IDLE;
         TSM_List[index].InvokeID = 0;
     }
@@ -351,12 +846,21 @@ bool tsm_invoke_id_failed(
 
 #ifdef TEST
 #include <assert.h>
-#include <string.h>
 #include "ctest.h"
 
 /* flag to send an I-Am */
 bool I_Am_Request = true;
 
+/* PDUs sent through the datalink stub wait here for delivery */
+#define TEST_PDU_QUEUE 256
+static uint8_t Test_PDU[TEST_PDU_QUEUE][MAX_PDU];
+static unsigned Test_PDU_Len[TEST_PDU_QUEUE];
+static unsigned Test_PDU_Head;
+static unsigned Test_PDU_Tail;
+/* counts of PDUs sent, so that a test can drop one */
+static unsigned Test_PDU_Count;
+static unsigned Test_PDU_Drop;
+
 /* dummy function stubs */
 int datalink_send_pdu(
     BACNET_ADDRESS * dest,
@@ -366,10 +870,18 @@ int datalink_send_pdu(
 {
     (void) dest;
     (void) npdu_data;
-    (void) pdu;
-    (void) pdu_len;
 
-    return 0;
+    Test_PDU_Count++;
+    if (Test_PDU_Count == Test_PDU_Drop) {
+        return (int) pdu_len;
+    }
+    if ((Test_PDU_Head - Test_PDU_Tail) < TEST_PDU_QUEUE) {
+        memcpy(&Test_PDU[Test_PDU_Head % TEST_PDU_QUEUE][0], pdu, pdu_len);
+        Test_PDU_Len[Test_PDU_Head % TEST_PDU_QUEUE] = pdu_len;
+        Test_PDU_Head++;
+    }
+
+    return (int) pdu_len;
 }
 
 /* dummy function stubs */
@@ -379,6 +891,15 @@ void datalink_get_broadcast_address(
     (void) dest;
 }
 
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    my_address->mac_len = 1;
+    my_address->mac[0] = 1;
+    my_address->net = 0;
+    my_address->len = 0;
+}
+
 void testTSM(
     Test * pTest)
 {
@@ -386,22 +907,440 @@ void testTSM(
     return;
 }
 
+#if MAX_SEGMENTS
+static void test_address(
+    BACNET_ADDRESS * address,
+    uint8_t mac)
+{
+    memset(address, 0, sizeof(BACNET_ADDRESS));
+    address->mac_len = 1;
+    address->mac[0] = mac;
+}
+
+static void test_queue_reset(
+    void)
+{
+    Test_PDU_Head = Test_PDU_Tail = 0;
+    Test_PDU_Count = 0;
+    Test_PDU_Drop = 0;
+}
+
+/* the results of delivering the queued PDUs between client and server */
+typedef struct test_transfer {
+    unsigned segments;
+    unsigned segment_acks;
+    unsigned negative_acks;
+    unsigned aborts;
+    uint8_t *data;
+    uint16_t data_len;
+} TEST_TRANSFER;
+
+/* Deliver the queued PDUs: segments to the client side of the TSM and
+   SegmentACKs to the server side, until none are left.
+   Returns true when the client has the whole ComplexACK. */
+static bool test_deliver(
+    BACNET_ADDRESS * client,
+    BACNET_ADDRESS * server,
+    TEST_TRANSFER * transfer)
+{
+    BACNET_CONFIRMED_SERVICE_ACK_DATA ack_data;
+    BACNET_ADDRESS dest, src;
+    BACNET_NPDU_DATA npdu_data;
+    uint8_t *pdu = NULL;
+    uint8_t *apdu = NULL;
+    uint8_t *service_request = NULL;
+    uint16_t service_request_len = 0;
+    uint16_t apdu_len = 0;
+    int len = 0;
+    bool complete = false;
+
+    while (Test_PDU_Tail != Test_PDU_Head) {
+        pdu = &Test_PDU[Test_PDU_Tail % TEST_PDU_QUEUE][0];
+        len = npdu_decode(pdu, &dest, &src, &npdu_data);
+        apdu = &pdu[len];
+        apdu_len = (uint16_t) (Test_PDU_Len[Test_PDU_Tail % TEST_PDU_QUEUE] -
+            len);
+        Test_PDU_Tail++;
+        switch (apdu[0] & 0xF0) {
+            case PDU_TYPE_COMPLEX_ACK:
+                transfer->segments++;
+                ack_data.segmented_message = (apdu[0] & BIT(3)) ? true : false;
+                ack_data.more_follows = (apdu[0] & BIT(2)) ? true : false;
+                ack_data.invoke_id = apdu[1];
+                ack_data.sequence_number = apdu[2];
+                ack_data.proposed_window_number = apdu[3];
+                service_request = &apdu[5];
+                service_request_len = apdu_len - 5;
+                if (tsm_segmented_complex_ack_handler(server, &ack_data,
+                        &service_request, &service_request_len)) {
+                    transfer->data = service_request;
+                    transfer->data_len = service_request_len;
+                    complete = true;
+                }
+                break;
+            case PDU_TYPE_SEGMENT_ACK:
+                transfer->segment_acks++;
+                if (apdu[0] & BIT(1)) {
+                    transfer->negative_acks++;
+                }
+                tsm_segment_ack_handler(client, apdu, apdu_len);
+                break;
+            case PDU_TYPE_ABORT:
+                transfer->aborts++;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return complete;
+}
+
+/* fill a segment buffer with an unsegmented ComplexACK */
+static unsigned test_complex_ack(
+    uint8_t * buffer,
+    uint8_t invoke_id,
+    unsigned service_len)
+{
+    unsigned i = 0;
+
+    buffer[0] = PDU_TYPE_COMPLEX_ACK;
+    buffer[1] = invoke_id;
+    buffer[2] = SERVICE_CONFIRMED_READ_RANGE;
+    for (i = 0; i < service_len; i++) {
+        buffer[3 + i] = (uint8_t) (i * 7 + (i >> 8));
+    }
+
+    return 3 + service_len;
+}
+
+/* start a confirmed request from the client side and the segmented
+   response to it from the server side */
+static uint8_t test_transfer_start(
+    BACNET_ADDRESS * client,
+    BACNET_ADDRESS * server,
+    int max_resp,
+    unsigned service_len,
+    uint8_t ** response)
+{
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_NPDU_DATA npdu_data;
+    uint8_t request[4] = { 0x02, 0x05, 0, SERVICE_CONFIRMED_READ_RANGE };
+    uint8_t *buffer = NULL;
+    uint8_t invoke_id = 0;
+    unsigned apdu_len = 0;
+
+    invoke_id = tsm_next_free_invokeID();
+    request[2] = invoke_id;
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, server, &npdu_data,
+        &request[0], sizeof(request));
+    service_data.segmented_response_accepted = true;
+    service_data.max_segs = MAX_SEGMENTS;
+    service_data.max_resp = max_resp;
+    service_data.invoke_id = invoke_id;
+    buffer = tsm_segment_buffer_claim();
+    if (buffer) {
+        apdu_len = test_complex_ack(buffer, invoke_id, service_len);
+        /* a copy to compare against the reassembled data */
+        if (response) {
+            *response = buffer;
+        }
+        npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+        if (!tsm_segmented_complex_ack_send(client, &npdu_data,
+                &service_data, buffer, apdu_len)) {
+            invoke_id = 0;
+        }
+    }
+
+    return invoke_id;
+}
+
+static unsigned test_buffers_free(
+    void)
+{
+    uint8_t *buffers[MAX_SEGMENT_BUFFERS];
+    unsigned count = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        buffers[i] = tsm_segment_buffer_claim();
+        if (buffers[i]) {
+            count++;
+        }
+    }
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        tsm_segment_buffer_release(buffers[i]);
+    }
+
+    return count;
+}
+
+void testTSMSegmentBuffers(
+    Test * pTest)
+{
+    uint8_t *buffers[MAX_SEGMENT_BUFFERS];
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        buffers[i] = tsm_segment_buffer_claim();
+        ct_test(pTest, buffers[i] != NULL);
+    }
+    ct_test(pTest, tsm_segment_buffer_claim() == NULL);
+    tsm_segment_buffer_release(buffers[0]);
+    ct_test(pTest, tsm_segment_buffer_claim() == buffers[0]);
+    for (i = 0; i < MAX_SEGMENT_BUFFERS; i++) {
+        tsm_segment_buffer_release(buffers[i]);
+    }
+    /* releasing nothing is harmless */
+    tsm_segment_buffer_release(NULL);
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+}
+
+void testTSMSegmentedComplexAck(
+    Test * pTest)
+{
+    BACNET_ADDRESS client, server;
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_NPDU_DATA npdu_data;
+    TEST_TRANSFER transfer;
+    uint8_t expected[TSM_SEGMENT_BUFFER_SIZE];
+    uint8_t *response = NULL;
+    uint8_t *buffer = NULL;
+    uint8_t invoke_id = 0;
+    unsigned service_len = 0;
+    unsigned segments = 0;
+    unsigned windows = 0;
+    unsigned limit = 0;
+
+    test_address(&client, 10);
+    test_address(&server, 20);
+    service_data.segmented_response_accepted = false;
+    ct_test(pTest, tsm_segmented_complex_ack_max(&service_data) == 0);
+    service_data.segmented_response_accepted = true;
+    service_data.max_resp = 128;
+    service_data.max_segs = 4;
+    ct_test(pTest, tsm_segmented_complex_ack_max(&service_data) ==
+        3 + 4 * (128 - 5));
+    /* unspecified is as many as we can send */
+    service_data.max_segs = 0;
+    ct_test(pTest, tsm_segmented_complex_ack_max(&service_data) ==
+        3 + MAX_SEGMENTS * (128 - 5));
+
+    /* segments with several full windows and a short last segment */
+    test_queue_reset();
+    memset(&transfer, 0, sizeof(transfer));
+    service_len = 13 * (128 - 5) + 50;
+    segments = 14;
+    invoke_id =
+        test_transfer_start(&client, &server, 128, service_len, &response);
+    ct_test(pTest, invoke_id != 0);
+    memcpy(expected, &response[3], service_len);
+    ct_test(pTest, test_deliver(&client, &server, &transfer));
+    ct_test(pTest, transfer.segments == segments);
+    ct_test(pTest, transfer.data_len == service_len);
+    ct_test(pTest, memcmp(transfer.data, expected, service_len) == 0);
+    /* an ack for the first segment, each full window, and the last */
+    windows = (segments - 1 + TSM_PROPOSED_WINDOW_SIZE - 1) /
+        TSM_PROPOSED_WINDOW_SIZE;
+    ct_test(pTest, transfer.segment_acks == 1 + windows);
+    ct_test(pTest, transfer.negative_acks == 0);
+    /* one buffer is still reassembling until the invoke ID is freed */
+    ct_test(pTest, test_buffers_free() == (MAX_SEGMENT_BUFFERS - 1));
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+
+    /* a lost segment is asked for again */
+    test_queue_reset();
+    memset(&transfer, 0, sizeof(transfer));
+    Test_PDU_Drop = 4;
+    invoke_id =
+        test_transfer_start(&client, &server, 128, service_len, &response);
+    memcpy(expected, &response[3], service_len);
+    ct_test(pTest, test_deliver(&client, &server, &transfer));
+    ct_test(pTest, transfer.negative_acks > 0);
+    ct_test(pTest, transfer.data_len == service_len);
+    ct_test(pTest, memcmp(transfer.data, expected, service_len) == 0);
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+
+    /* a lost SegmentACK: the server sends the window again on timeout */
+    test_queue_reset();
+    memset(&transfer, 0, sizeof(transfer));
+    Test_PDU_Drop = 2;
+    invoke_id =
+        test_transfer_start(&client, &server, 128, service_len, &response);
+    memcpy(expected, &response[3], service_len);
+    ct_test(pTest, !test_deliver(&client, &server, &transfer));
+    tsm_timer_milliseconds(apdu_segment_timeout());
+    ct_test(pTest, test_deliver(&client, &server, &transfer));
+    ct_test(pTest, memcmp(transfer.data, expected, service_len) == 0);
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+
+    /* the client aborts: the server stops sending */
+    test_queue_reset();
+    memset(&transfer, 0, sizeof(transfer));
+    invoke_id =
+        test_transfer_start(&client, &server, 128, service_len, &response);
+    ct_test(pTest, test_buffers_free() == (MAX_SEGMENT_BUFFERS - 1));
+    tsm_abort_segmented_response(&client, invoke_id);
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+    tsm_free_invoke_id(invoke_id);
+
+    /* the server goes quiet: the client transaction fails */
+    test_queue_reset();
+    memset(&transfer, 0, sizeof(transfer));
+    invoke_id =
+        test_transfer_start(&client, &server, 128, service_len, &response);
+    tsm_abort_segmented_response(&client, invoke_id);
+    ct_test(pTest, !test_deliver(&client, &server, &transfer));
+    ct_test(pTest, transfer.segments == 1);
+    ct_test(pTest, !tsm_invoke_id_failed(invoke_id));
+    tsm_timer_milliseconds(4 * apdu_segment_timeout());
+    ct_test(pTest, tsm_invoke_id_failed(invoke_id));
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+    tsm_free_invoke_id(invoke_id);
+
+    /* more than the client accepts is refused, and the buffer released */
+    service_data.max_resp = 128;
+    service_data.max_segs = 2;
+    service_data.invoke_id = 1;
+    limit = tsm_segmented_complex_ack_max(&service_data);
+    buffer = tsm_segment_buffer_claim();
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    ct_test(pTest, !tsm_segmented_complex_ack_send(&client, &npdu_data,
+            &service_data, buffer, test_complex_ack(buffer, 1, limit - 2)));
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+    buffer = tsm_segment_buffer_claim();
+    test_queue_reset();
+    ct_test(pTest, tsm_segmented_complex_ack_send(&client, &npdu_data,
+            &service_data, buffer, test_complex_ack(buffer, 1, limit - 3)));
+    tsm_abort_segmented_response(&client, 1);
+    ct_test(pTest, test_buffers_free() == MAX_SEGMENT_BUFFERS);
+}
+#endif
+
 #ifdef TEST_TSM
+#if MAX_SEGMENTS
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Bulk transfer of one large ComplexACK as segments, against the same
+   data fetched unsegmented: one request and max_resp sized response
+   for each piece.  Round trips dominate on MS/TP and WAN links. */
+static void tsm_segmentation_benchmark(
+    unsigned long iterations,
+    int max_resp)
+{
+    BACNET_ADDRESS client, server;
+    BACNET_NPDU_DATA npdu_data;
+    TEST_TRANSFER transfer;
+    uint8_t request[4] = { 0x02, 0x05, 0, SERVICE_CONFIRMED_READ_RANGE };
+    uint8_t pdu[MAX_PDU];
+    unsigned service_len = MAX_SEGMENTS * (max_resp - 5);
+    unsigned piece_len = max_resp - 3;
+    unsigned round_trips = 0;
+    unsigned pieces = 0;
+    unsigned offset = 0;
+    unsigned len = 0;
+    unsigned long i = 0;
+    uint8_t invoke_id = 0;
+    static uint8_t response[TSM_SEGMENT_BUFFER_SIZE];
+    clock_t start;
+    double seconds;
+
+    test_address(&client, 10);
+    test_address(&server, 20);
+    npdu_encode_npdu_data(&npdu_data, true, MESSAGE_PRIORITY_NORMAL);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        test_queue_reset();
+        memset(&transfer, 0, sizeof(transfer));
+        invoke_id =
+            test_transfer_start(&client, &server, max_resp, service_len,
+            NULL);
+        (void) test_deliver(&client, &server, &transfer);
+        tsm_free_invoke_id(invoke_id);
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    (void) test_complex_ack(response, 0, service_len);
+    /* one request, then one round trip per acknowledged window */
+    round_trips = transfer.segment_acks;
+    printf("%u octets, max APDU %d, window %u: segmented %u PDUs, "
+        "%u round trips, %.1f us, %.1f MB/s\n", service_len, max_resp,
+        (unsigned) TSM_PROPOSED_WINDOW_SIZE,
+        1 + transfer.segments + transfer.segment_acks, round_trips,
+        seconds * 1e6 / iterations,
+        (double) service_len * iterations / seconds / 1e6);
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        test_queue_reset();
+        pieces = 0;
+        for (offset = 0; offset < service_len; offset += piece_len) {
+            len = service_len - offset;
+            if (len > piece_len) {
+                len = piece_len;
+            }
+            invoke_id = tsm_next_free_invokeID();
+            request[2] = invoke_id;
+            tsm_set_confirmed_unsegmented_transaction(invoke_id, &server,
+                &npdu_data, &request[0], sizeof(request));
+            (void) datalink_send_pdu(&server, &npdu_data, &request[0],
+                sizeof(request));
+            pdu[0] = PDU_TYPE_COMPLEX_ACK;
+            pdu[1] = invoke_id;
+            pdu[2] = SERVICE_CONFIRMED_READ_RANGE;
+            memcpy(&pdu[3], &response[3 + offset], len);
+            (void) datalink_send_pdu(&client, &npdu_data, &pdu[0], 3 + len);
+            tsm_free_invoke_id(invoke_id);
+            Test_PDU_Head = Test_PDU_Tail = 0;
+            pieces++;
+        }
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%u octets, max APDU %d: unsegmented %u PDUs, "
+        "%u round trips, %.1f us, %.1f MB/s\n", service_len, max_resp,
+        2 * pieces, pieces, seconds * 1e6 / iterations,
+        (double) service_len * iterations / seconds / 1e6);
+}
+#endif
+
 int main(
-    void)
+    int argc,
+    char *argv[])
 {
     Test *pTest;
     bool rc;
+    unsigned long iterations = 2000;
 
     pTest = ct_create("BACnet TSM", NULL);
     /* individual tests */
     rc = ct_addTestFunction(pTest, testTSM);
     assert(rc);
+#if MAX_SEGMENTS
+    rc = ct_addTestFunction(pTest, testTSMSegmentBuffers);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMSegmentedComplexAck);
+    assert(rc);
+#endif
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
     (void) ct_report(pTest);
     ct_destroy(pTest);
+#if MAX_SEGMENTS
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    tsm_segmentation_benchmark(iterations, 128);
+    tsm_segmentation_benchmark(iterations, 480);
+#else
+    (void) argc;
+    (void) argv;
+#endif
 
     return 0;
 }
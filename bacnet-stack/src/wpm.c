@@ -29,6 +29,7 @@
 #include "bacdcode.h"
 #include "bacdef.h"
 #include "wp.h"
+#include "encbuf.h"
 #include "wpm.h"
 #include "string.h"
 
@@ -356,3 +357,33 @@ int wpm_error_ack_encode_apdu(
     }
     return len;
 }
+
+/* The WritePropertyMultiple-Error encoded straight into the reply;
+   returns false when it does not fit, see encbuf.h */
+bool wpm_error_ack_encode_buffer(
+    BACNET_ENCODE_BUFFER * buffer,
+    uint8_t invoke_id,
+    BACNET_WRITE_PROPERTY_DATA * wp_data)
+{
+    uint8_t header[3];
+
+    header[0] = PDU_TYPE_ERROR;
+    header[1] = invoke_id;
+    header[2] = SERVICE_CONFIRMED_WRITE_PROP_MULTIPLE;
+    encbuf_append(buffer, header, sizeof(header));
+
+    encbuf_opening_tag(buffer, 0);
+    encbuf_application_enumerated(buffer, wp_data->error_class);
+    encbuf_application_enumerated(buffer, wp_data->error_code);
+    encbuf_closing_tag(buffer, 0);
+
+    encbuf_opening_tag(buffer, 1);
+    encbuf_context_object_id(buffer, 0, wp_data->object_type,
+        wp_data->object_instance);
+    encbuf_context_enumerated(buffer, 1, wp_data->object_property);
+    if (wp_data->array_index != BACNET_ARRAY_ALL) {
+        encbuf_context_unsigned(buffer, 2, wp_data->array_index);
+    }
+
+    return encbuf_closing_tag(buffer, 1);
+}
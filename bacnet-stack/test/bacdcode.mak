@@ -24,11 +24,21 @@ ${TARGET}: ${OBJS}
 .c.o:
 	${CC} -c ${CFLAGS} $*.c -o $@
 
+# differential fuzzing of the tag header decoders, using libFuzzer
+FUZZ_TARGET = ${TARGET}_fuzz
+FUZZ_DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_DECODE_FUZZER -DMAX_APDU=50
+
+fuzz: ${FUZZ_TARGET}
+
+${FUZZ_TARGET}: ${SRCS}
+	clang -g -O1 -fsanitize=fuzzer,address $(INCLUDES) $(FUZZ_DEFINES) \
+		${SRCS} -o $@
+
 depend:
 	rm -f .depend
 	${CC} -MM ${CFLAGS} *.c >> .depend
 
 clean:
-	rm -rf ${OBJS} ${TARGET}
+	rm -rf ${OBJS} ${TARGET} ${FUZZ_TARGET}
 
 include: .depend
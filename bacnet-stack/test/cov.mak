@@ -17,6 +17,7 @@ SRCS = $(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/indtext.c \
 	$(SRC_DIR)/bactext.c \
 	$(SRC_DIR)/cov.c \
+	$(SRC_DIR)/bactag.c \
 	ctest.c
 
 OBJS = ${SRCS:.c=.o}
@@ -10,6 +10,7 @@ SRCS = $(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bacint.c \
 	$(SRC_DIR)/bacstr.c \
 	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/npdu.c \
 	$(SRC_DIR)/rp.c \
 	ctest.c
 
@@ -16,6 +16,7 @@ SRCS = $(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bactext.c \
 	$(SRC_DIR)/indtext.c \
 	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/encbuf.c \
 	$(SRC_DIR)/lighting.c \
 	$(SRC_DIR)/memcopy.c \
 	$(SRC_DIR)/rpm.c \